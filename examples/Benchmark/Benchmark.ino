@@ -0,0 +1,235 @@
+/*
+  SmartMatrix Benchmark - Louis Beaudoin (Pixelmatix)
+  This example code is released into the public domain
+
+  Measures drawing throughput on each layer type, swap cost, the CPU time the refresh takes at this refreshDepth, and the highest
+  refresh rate that holds without being lowered, then prints the results as CSV:
+    board,width,height,refreshDepth,test,value,unit
+
+  Refresh depth, size and panel type are compile-time settings, so build and run once for each configuration to compare, e.g. at
+  kRefreshDepth 24, 36 and 48.  Everything is measured with refresh running, drawing shares the CPU with it as in a real sketch.
+
+  On Teensy 4 the refresh load and max refresh rate also depend on where the row buffers are, uncomment the SM_T4_ROW_BUFFER_PLACEMENT
+  line below to compare DTCM with the default OCRAM.
+*/
+
+// uncomment one line to select your MatrixHardware configuration - configuration header needs to be included before <SmartMatrix.h>
+//#include <MatrixHardware_Teensy3_ShieldV4.h>        // SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_Teensy4_ShieldV5.h>        // SmartLED Shield for Teensy 4 (V5)
+//#include <MatrixHardware_Teensy3_ShieldV1toV3.h>    // SmartMatrix Shield for Teensy 3 V1-V3
+//#include <MatrixHardware_Teensy4_ShieldV4Adapter.h> // Teensy 4 Adapter attached to SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_ESP32_V0.h>                // This file contains multiple ESP32 hardware configurations, edit the file to define GPIOPINOUT (or add #define GPIOPINOUT with a hardcoded number before this #include)
+//#include "MatrixHardware_Custom.h"                  // Copy an existing MatrixHardware file to your Sketch directory, rename, customize, and you can include it like this
+//#define SM_T4_ROW_BUFFER_PLACEMENT SM_T4_ROW_BUFFER_DTCM    // Teensy 4: row buffers in uncached DTCM instead of DMAMEM
+#include <SmartMatrix.h>
+
+#define COLOR_DEPTH 24                  // Choose the color depth used for storing pixels in the layers: 24 or 48 (24 is good for most sketches - If the sketch uses type `rgb24` directly, COLOR_DEPTH must be 24)
+const uint16_t kMatrixWidth = 32;       // Set to the width of your display, must be a multiple of 8
+const uint16_t kMatrixHeight = 32;      // Set to the height of your display
+const uint8_t kRefreshDepth = 36;       // Tradeoff of color quality vs refresh rate, max brightness, and RAM usage.  36 is typically good, drop down to 24 if you need to.  On Teensy, multiples of 3, up to 48: 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45, 48.  On ESP32: 24, 36, 48
+const uint8_t kDmaBufferRows = 4;       // known working: 2-4, use 2 to save RAM, more to keep from dropping frames and automatically lowering refresh rate.  (This isn't used on ESP32, leave as default)
+const uint8_t kPanelType = SM_PANELTYPE_HUB75_32ROW_MOD16SCAN;   // Choose the configuration that matches your panels.  See more details in MatrixCommonHub75.h and the docs: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint32_t kMatrixOptions = (SM_HUB75_OPTIONS_NONE);        // see docs for options: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint8_t kBackgroundLayerOptions = (SM_BACKGROUND_OPTIONS_NONE);
+const uint8_t kScrollingLayerOptions = (SM_SCROLLING_OPTIONS_NONE);
+const uint8_t kIndexedLayerOptions = (SM_INDEXED_OPTIONS_NONE);
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kBackgroundLayerOptions);
+SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(scrollingLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kScrollingLayerOptions);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kIndexedLayerOptions);
+
+// each test runs for about this long
+const uint32_t testDurationMs = 500;
+// the refresh rate search starts here and holds each rate this long
+const uint16_t maxRefreshRateToTry = 480;
+const uint32_t refreshRateHoldMs = 2000;
+
+#if defined(ARDUINO_TEENSY41)
+const char boardName[] = "Teensy 4.1";
+#elif defined(ARDUINO_TEENSY40)
+const char boardName[] = "Teensy 4.0";
+#elif defined(ARDUINO_TEENSY36)
+const char boardName[] = "Teensy 3.6";
+#elif defined(ARDUINO_TEENSY35)
+const char boardName[] = "Teensy 3.5";
+#elif defined(ARDUINO_TEENSY32) || defined(ARDUINO_TEENSY31)
+const char boardName[] = "Teensy 3.2";
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+const char boardName[] = "ESP32-S3";
+#elif defined(ESP32)
+const char boardName[] = "ESP32";
+#else
+const char boardName[] = "unknown";
+#endif
+
+// width * height pixels, filled in setup()
+rgb24 testBitmap[kMatrixWidth * kMatrixHeight];
+
+void report(const char * test, float value, const char * unit) {
+  Serial.print(boardName);
+  Serial.print(',');
+  Serial.print(kMatrixWidth);
+  Serial.print(',');
+  Serial.print(kMatrixHeight);
+  Serial.print(',');
+  Serial.print(kRefreshDepth);
+  Serial.print(',');
+  Serial.print(test);
+  Serial.print(',');
+  Serial.print(value, 1);
+  Serial.print(',');
+  Serial.println(unit);
+}
+
+// calls draw(i) with i counting up until testDurationMs has passed, returns calls per second
+template <typename F> float callsPerSecond(F draw) {
+  uint32_t count = 0;
+  uint32_t start = micros();
+  uint32_t elapsed;
+  do {
+    // check the time every 16 calls, so micros() isn't a large part of quick calls
+    for (int i = 0; i < 16; i++)
+      draw(count++);
+    elapsed = micros() - start;
+  } while (elapsed < testDurationMs * 1000);
+  return count * 1e6f / elapsed;
+}
+
+// loop iterations possible in testDurationMs, used to see how much CPU refresh takes
+uint32_t countIdleLoops(void) {
+  volatile uint32_t count = 0;
+  uint32_t start = millis();
+  while (millis() - start < testDurationMs)
+    count++;
+  return count;
+}
+
+void benchmarkBackgroundLayer(void) {
+  const float screenPixels = (float)kMatrixWidth * kMatrixHeight;
+
+  report("background drawPixel", callsPerSecond([](uint32_t i) {
+    backgroundLayer.drawPixel(i % kMatrixWidth, (i / kMatrixWidth) % kMatrixHeight, rgb24(i, i >> 8, i >> 16));
+  }), "pixels/s");
+
+  report("background fillRectangle", screenPixels * callsPerSecond([](uint32_t i) {
+    backgroundLayer.fillRectangle(0, 0, kMatrixWidth - 1, kMatrixHeight - 1, rgb24(i, 0, 255 - i));
+  }), "pixels/s");
+
+  // pixels drawn, the whole character cell for each character
+  backgroundLayer.setFont(font6x10);
+  report("background drawString", 5 * 6 * 10 * callsPerSecond([](uint32_t i) {
+    backgroundLayer.drawString(i % 2, i % (kMatrixHeight - 10), rgb24(255, 255, 255), rgb24(0, 0, 0), "SMART");
+  }), "pixels/s");
+
+  report("background drawBitmap rgb24", screenPixels * callsPerSecond([](uint32_t i) {
+    backgroundLayer.drawBitmap(0, 0, kMatrixWidth, kMatrixHeight, testBitmap, SM_BITMAP_FORMAT_RGB24);
+  }), "pixels/s");
+
+  // swaps wait for refresh to take the previous frame, so this is limited by the refresh rate unless the layer is triple buffered
+  report("background swapBuffers copy", 1e6f / callsPerSecond([](uint32_t i) {
+    backgroundLayer.swapBuffers(true);
+  }), "us/swap");
+
+  report("background swapBuffers no copy", 1e6f / callsPerSecond([](uint32_t i) {
+    backgroundLayer.swapBuffers(false);
+  }), "us/swap");
+
+  backgroundLayer.fillScreen(rgb24(0, 0, 0));
+  backgroundLayer.swapBuffers(false);
+}
+
+void benchmarkIndexedLayer(void) {
+  indexedLayer.setIndexedColor(1, rgb24(255, 255, 255));
+
+  report("indexed drawPixel", callsPerSecond([](uint32_t i) {
+    indexedLayer.drawPixel(i % kMatrixWidth, (i / kMatrixWidth) % kMatrixHeight, i & 1);
+  }), "pixels/s");
+
+  indexedLayer.setFont(font6x10);
+  report("indexed drawString", 5 * 6 * 10 * callsPerSecond([](uint32_t i) {
+    indexedLayer.drawString(i % 2, i % (kMatrixHeight - 10), 1, "SMART");
+  }), "pixels/s");
+
+  report("indexed swapBuffers copy", 1e6f / callsPerSecond([](uint32_t i) {
+    indexedLayer.swapBuffers(true);
+  }), "us/swap");
+
+  indexedLayer.fillScreen(0);
+  indexedLayer.swapBuffers(false);
+}
+
+void benchmarkScrollingLayer(void) {
+  // the scrolling layer renders its text once per start() or update(), then only moves it
+  scrollingLayer.setFont(font6x10);
+  report("scrolling update", callsPerSecond([](uint32_t i) {
+    scrollingLayer.update((i & 1) ? "SmartMatrix" : "Benchmark");
+  }), "updates/s");
+  scrollingLayer.stop();
+}
+
+// CPU time refresh takes, from how much the loop count drops with the matrix running
+void benchmarkRefreshLoad(uint32_t idleLoopsBeforeBegin, const char * test) {
+  uint32_t loops = countIdleLoops();
+  float load = (loops < idleLoopsBeforeBegin) ? 1.0f - (float)loops / idleLoopsBeforeBegin : 0.0f;
+  report(test, load * 100, "% CPU");
+  report((String(test) + " per frame").c_str(), load * 1e6f / matrix.getRefreshRate(), "us/frame");
+}
+
+// raises the refresh rate from a low start until the calc has to lower it, with all layers drawing
+void benchmarkMaxRefreshRate(void) {
+  uint16_t sustained = 0;
+
+  scrollingLayer.start("SmartMatrix Benchmark", -1);
+  backgroundLayer.drawBitmap(0, 0, kMatrixWidth, kMatrixHeight, testBitmap, SM_BITMAP_FORMAT_RGB24);
+  backgroundLayer.swapBuffers(true);
+
+  for (uint16_t rate = 60; rate <= maxRefreshRateToTry; rate += 30) {
+    matrix.setRefreshRate(rate);
+    matrix.getRefreshRateLoweredFlag();
+    delay(refreshRateHoldMs);
+    if (matrix.getRefreshRateLoweredFlag() || matrix.getRefreshRate() < rate)
+      break;
+    sustained = rate;
+  }
+
+  report("max refresh rate", sustained, "Hz");
+  if (sustained)
+    matrix.setRefreshRate(sustained);
+  scrollingLayer.stop();
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000);
+
+  for (int i = 0; i < kMatrixWidth * kMatrixHeight; i++)
+    testBitmap[i] = rgb24(i, i * 3, i * 7);
+
+  uint32_t idleLoops = countIdleLoops();
+
+  matrix.addLayer(&backgroundLayer);
+  matrix.addLayer(&scrollingLayer);
+  matrix.addLayer(&indexedLayer);
+  matrix.begin();
+  matrix.setBrightness(255);
+
+  Serial.println("board,width,height,refreshDepth,test,value,unit");
+  report("refresh rate", matrix.getRefreshRate(), "Hz");
+#if defined(__IMXRT1062__)
+  report((SM_T4_ROW_BUFFER_PLACEMENT == SM_T4_ROW_BUFFER_DTCM) ? "row buffers in DTCM" : "row buffers in OCRAM", kDmaBufferRows, "rows");
+#endif
+  benchmarkRefreshLoad(idleLoops, "refresh load");
+
+  benchmarkBackgroundLayer();
+  benchmarkIndexedLayer();
+  benchmarkScrollingLayer();
+
+  benchmarkMaxRefreshRate();
+  benchmarkRefreshLoad(idleLoops, "refresh load at max rate");
+
+  Serial.println("done");
+}
+
+void loop() {
+}
@@ -43,20 +43,8 @@ int led = -1;   // Set to -1 to disable LED flash, only needed for debugging pur
 //int led = 13; // builtin LED pin on the Teensy, interferes with refresh on Teensy 4
 
 void drawBitmap(int16_t x, int16_t y, const gimp32x32bitmap* bitmap) {
-  for(unsigned int i=0; i < bitmap->height; i++) {
-    for(unsigned int j=0; j < bitmap->width; j++) {
-      SM_RGB pixel = { bitmap->pixel_data[(i*bitmap->width + j)*3 + 0],
-                      bitmap->pixel_data[(i*bitmap->width + j)*3 + 1],
-                      bitmap->pixel_data[(i*bitmap->width + j)*3 + 2] };
-      if(COLOR_DEPTH == 48) {
-          pixel.red = pixel.red << 8;
-          pixel.green = pixel.green << 8;
-          pixel.blue = pixel.blue << 8;
-      }
-
-      backgroundLayer.drawPixel(x + j, y + i, pixel);
-    }
-  }
+  // the layer clips and converts the RGB pixel data to COLOR_DEPTH itself
+  backgroundLayer.drawBitmap(x, y, bitmap->width, bitmap->height, bitmap->pixel_data, SM_BITMAP_FORMAT_RGB24);
 }
 
 void setup() {
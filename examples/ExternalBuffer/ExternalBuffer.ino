@@ -0,0 +1,80 @@
+/*
+  SmartMatrix External Buffer Layer - Louis Beaudoin (Pixelmatix)
+  This example code is released into the public domain
+
+  Shows how to refresh straight from pixel buffers owned by the sketch, the way FastLED sketches keep their own CRGB array.
+  The layer reads the buffer during refresh, so nothing is copied into a layer after drawing.
+
+  Two buffers are drawn in turn: swapBuffers() hands the finished one to refresh at the start of the next frame, and returns once
+  refresh has switched to it, so the other buffer is free to draw into.  A sketch with a single buffer can call setBuffer() once
+  and draw to it at any time, see the comments in loop().
+*/
+
+// uncomment one line to select your MatrixHardware configuration - configuration header needs to be included before <SmartMatrix.h>
+//#include <MatrixHardware_Teensy3_ShieldV4.h>        // SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_Teensy4_ShieldV5.h>        // SmartLED Shield for Teensy 4 (V5)
+//#include <MatrixHardware_Teensy3_ShieldV1toV3.h>    // SmartMatrix Shield for Teensy 3 V1-V3
+//#include <MatrixHardware_Teensy4_ShieldV4Adapter.h> // Teensy 4 Adapter attached to SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_ESP32_V0.h>                // This file contains multiple ESP32 hardware configurations, edit the file to define GPIOPINOUT (or add #define GPIOPINOUT with a hardcoded number before this #include)
+//#include "MatrixHardware_Custom.h"                  // Copy an existing MatrixHardware file to your Sketch directory, rename, customize, and you can include it like this
+#include <SmartMatrix.h>
+
+#define COLOR_DEPTH 24                  // Choose the color depth used for storing pixels in the layers: 24 or 48 (24 is good for most sketches - If the sketch uses type `rgb24` directly, COLOR_DEPTH must be 24)
+const uint16_t kMatrixWidth = 32;       // Set to the width of your display, must be a multiple of 8
+const uint16_t kMatrixHeight = 32;      // Set to the height of your display
+const uint8_t kRefreshDepth = 36;       // Tradeoff of color quality vs refresh rate, max brightness, and RAM usage.  36 is typically good, drop down to 24 if you need to.  On Teensy, multiples of 3, up to 48: 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45, 48.  On ESP32: 24, 36, 48
+const uint8_t kDmaBufferRows = 4;       // known working: 2-4, use 2 to save RAM, more to keep from dropping frames and automatically lowering refresh rate.  (This isn't used on ESP32, leave as default)
+const uint8_t kPanelType = SM_PANELTYPE_HUB75_32ROW_MOD16SCAN;   // Choose the configuration that matches your panels.  See more details in MatrixCommonHub75.h and the docs: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint32_t kMatrixOptions = (SM_HUB75_OPTIONS_NONE);        // see docs for options: https://github.com/pixelmatix/SmartMatrix/wiki
+// with manual changes the layer is only repacked after a swap, instead of every frame
+const uint8_t kExternalLayerOptions = (SM_EXTERNAL_OPTIONS_MANUAL_CHANGES);
+const uint8_t kScrollingLayerOptions = (SM_SCROLLING_OPTIONS_NONE);
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
+SMARTMATRIX_ALLOCATE_EXTERNAL_LAYER(externalLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kExternalLayerOptions);
+SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(scrollingLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kScrollingLayerOptions);
+
+// the sketch's own pixels, 3 bytes per pixel in red, green, blue order like FastLED's CRGB
+rgb24 leds[2][kMatrixWidth * kMatrixHeight];
+uint8_t drawBuffer = 0;
+
+// FastLED style mapping from a pixel to its index in the buffer, rows are stored left to right
+uint16_t XY(uint16_t x, uint16_t y) {
+  return y * kMatrixWidth + x;
+}
+
+void setup() {
+  matrix.addLayer(&externalLayer);
+  matrix.addLayer(&scrollingLayer);
+  matrix.begin();
+
+  matrix.setBrightness(128);
+
+  // format and layout are set once, swapBuffers() only replaces the buffer pointer
+  externalLayer.setBuffer(leds[1], SM_EXTERNAL_FORMAT_RGB24);
+
+  scrollingLayer.setColor({0xff, 0xff, 0xff});
+  scrollingLayer.setFont(font5x7);
+  scrollingLayer.start("External buffer", -1);
+}
+
+void loop() {
+  static uint8_t frame = 0;
+  rgb24 * buffer = leds[drawBuffer];
+
+  // diagonal color bands moving across the display
+  for (uint16_t y = 0; y < kMatrixHeight; y++) {
+    for (uint16_t x = 0; x < kMatrixWidth; x++) {
+      uint8_t phase = (x + y) * 8 + frame;
+      buffer[XY(x, y)] = rgb24(phase, 255 - phase, (x * 255) / kMatrixWidth);
+    }
+  }
+  frame += 2;
+
+  // refresh reads this buffer from the next frame on, and the other one is free once swapBuffers() returns
+  // with a single buffer: draw to it directly, then call externalLayer.markBufferChanged() when done
+  externalLayer.swapBuffers(buffer);
+  drawBuffer ^= 1;
+
+  delay(20);
+}
@@ -0,0 +1,84 @@
+/*
+  SmartMatrix Frame Sync - Louis Beaudoin (Pixelmatix)
+  This example code is released into the public domain
+
+  Lines up the frames of several boards that each drive part of one display, so animations drawn on all of them swap together.
+
+  Load the same sketch on every board.  Set kIsMaster to true on one of them, wire its kSyncOutputPin to kSyncInputPin on every
+  other board, and connect the grounds.  The master pulses its output pin at the start of each frame, and the others hold each new frame
+  (and the pending swapBuffers()) until the pulse arrives.  A follower can pass the pulse on from its own output pin to the next board.
+
+  Each board draws the same bar moving across the display, offset by kBoardColumn, so the bar crosses from one board to the next without
+  tearing.  The followers print how far behind the master their frames start, and how many frames they fell behind.
+*/
+
+// uncomment one line to select your MatrixHardware configuration - configuration header needs to be included before <SmartMatrix.h>
+//#include <MatrixHardware_Teensy3_ShieldV4.h>        // SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_Teensy4_ShieldV5.h>        // SmartLED Shield for Teensy 4 (V5)
+//#include <MatrixHardware_Teensy3_ShieldV1toV3.h>    // SmartMatrix Shield for Teensy 3 V1-V3
+//#include <MatrixHardware_Teensy4_ShieldV4Adapter.h> // Teensy 4 Adapter attached to SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_ESP32_V0.h>                // This file contains multiple ESP32 hardware configurations, edit the file to define GPIOPINOUT (or add #define GPIOPINOUT with a hardcoded number before this #include)
+//#include "MatrixHardware_Custom.h"                  // Copy an existing MatrixHardware file to your Sketch directory, rename, customize, and you can include it like this
+#include <SmartMatrix.h>
+
+#define COLOR_DEPTH 24                  // Choose the color depth used for storing pixels in the layers: 24 or 48 (24 is good for most sketches - If the sketch uses type `rgb24` directly, COLOR_DEPTH must be 24)
+const uint16_t kMatrixWidth = 32;       // Set to the width of your display, must be a multiple of 8
+const uint16_t kMatrixHeight = 32;      // Set to the height of your display
+const uint8_t kRefreshDepth = 36;       // Tradeoff of color quality vs refresh rate, max brightness, and RAM usage.  36 is typically good, drop down to 24 if you need to.  On Teensy, multiples of 3, up to 48: 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45, 48.  On ESP32: 24, 36, 48
+const uint8_t kDmaBufferRows = 4;       // known working: 2-4, use 2 to save RAM, more to keep from dropping frames and automatically lowering refresh rate.  (This isn't used on ESP32, leave as default)
+const uint8_t kPanelType = SM_PANELTYPE_HUB75_32ROW_MOD16SCAN;   // Choose the configuration that matches your panels.  See more details in MatrixCommonHub75.h and the docs: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint32_t kMatrixOptions = (SM_HUB75_OPTIONS_NONE);        // see docs for options: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint8_t kBackgroundLayerOptions = (SM_BACKGROUND_OPTIONS_NONE);
+
+// set to true on the one board that drives the sync pulse
+const bool kIsMaster = false;
+// pins used for the sync pulse, pick ones your hardware configuration leaves free
+const int8_t kSyncOutputPin = 2;
+const int8_t kSyncInputPin = 3;
+// where this board's part of the display starts, in pixels from the left edge of the whole display
+const uint16_t kBoardColumn = 0;
+const uint16_t kDisplayWidth = 2 * kMatrixWidth;
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kBackgroundLayerOptions);
+
+void setup() {
+  Serial.begin(115200);
+
+  matrix.addLayer(&backgroundLayer);
+  matrix.begin();
+
+  matrix.setBrightness(128);
+
+  if (kIsMaster) {
+    matrix.setFrameSyncOutput(kSyncOutputPin);
+  } else {
+    matrix.setFrameSyncInput(kSyncInputPin);
+    // uncomment to pass the pulse on to another board
+    //matrix.setFrameSyncOutput(kSyncOutputPin);
+  }
+}
+
+void loop() {
+  static uint16_t barPosition = 0;
+  static uint32_t lastPrintMillis = 0;
+
+  backgroundLayer.fillScreen(rgb24(0, 0, 0x20));
+
+  // the bar's position on the whole display, drawn if it's on this board
+  int16_t localX = (int16_t)barPosition - kBoardColumn;
+  if (localX > -4 && localX < kMatrixWidth)
+    backgroundLayer.fillRectangle(localX, 0, localX + 3, kMatrixHeight - 1, rgb24(0xff, 0xff, 0xff));
+
+  // the swap is taken at the next frame start, which a follower holds until the master's pulse
+  backgroundLayer.swapBuffers();
+  barPosition = (barPosition + 1) % kDisplayWidth;
+
+  if (!kIsMaster && millis() - lastPrintMillis > 1000) {
+    lastPrintMillis = millis();
+    Serial.print("drift (us): ");
+    Serial.print(matrix.getFrameSyncDrift());
+    Serial.print(" missed pulses: ");
+    Serial.println(matrix.getFrameSyncMissedPulses());
+  }
+}
@@ -0,0 +1,120 @@
+/*
+  SmartMatrix Memory Planner - Louis Beaudoin (Pixelmatix)
+  This example code is released into the public domain
+
+  Shows how to check a configuration's memory use before flashing, and compare it with what the library really allocated.
+
+  The SM_MEMORY_* macros in MatrixMemoryPlanner.h take the same arguments as the allocation macros and give the size of each
+  buffer they create.  Define SM_MEMORY_BUDGET_BYTES before including SmartMatrix.h and SM_MEMORY_CHECK_BUDGET() fails the build
+  with a readable message when the planned buffers don't fit.
+
+  After begin() the sketch prints the planned sizes, then smPrintMemoryReport(), the allocations recorded at runtime split by
+  subsystem and memory type.  On ESP32 the buffers are allocated from the heap, so the two can be compared directly and the sketch
+  prints whether they match.  On Teensy the buffers are static and the sizes are known at compile time, see static_assert below.
+*/
+
+// uncomment one line to select your MatrixHardware configuration - configuration header needs to be included before <SmartMatrix.h>
+//#include <MatrixHardware_Teensy3_ShieldV4.h>        // SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_Teensy4_ShieldV5.h>        // SmartLED Shield for Teensy 4 (V5)
+//#include <MatrixHardware_Teensy3_ShieldV1toV3.h>    // SmartMatrix Shield for Teensy 3 V1-V3
+//#include <MatrixHardware_Teensy4_ShieldV4Adapter.h> // Teensy 4 Adapter attached to SmartLED Shield for Teensy 3 (V4)
+//#include <MatrixHardware_ESP32_V0.h>                // This file contains multiple ESP32 hardware configurations, edit the file to define GPIOPINOUT (or add #define GPIOPINOUT with a hardcoded number before this #include)
+//#include "MatrixHardware_Custom.h"                  // Copy an existing MatrixHardware file to your Sketch directory, rename, customize, and you can include it like this
+
+// fail the build if the planned buffers are over this many bytes, lower it to see the error
+#define SM_MEMORY_BUDGET_BYTES  (200 * 1024)
+#include <SmartMatrix.h>
+
+#define COLOR_DEPTH 24                  // Choose the color depth used for storing pixels in the layers: 24 or 48 (24 is good for most sketches - If the sketch uses type `rgb24` directly, COLOR_DEPTH must be 24)
+const uint16_t kMatrixWidth = 32;       // Set to the width of your display, must be a multiple of 8
+const uint16_t kMatrixHeight = 32;      // Set to the height of your display
+const uint8_t kRefreshDepth = 36;       // Tradeoff of color quality vs refresh rate, max brightness, and RAM usage.  36 is typically good, drop down to 24 if you need to.  On Teensy, multiples of 3, up to 48: 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45, 48.  On ESP32: 24, 36, 48
+const uint8_t kDmaBufferRows = 4;       // known working: 2-4, use 2 to save RAM, more to keep from dropping frames and automatically lowering refresh rate.  (This isn't used on ESP32, leave as default)
+const uint8_t kPanelType = SM_PANELTYPE_HUB75_32ROW_MOD16SCAN;   // Choose the configuration that matches your panels.  See more details in MatrixCommonHub75.h and the docs: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint32_t kMatrixOptions = (SM_HUB75_OPTIONS_NONE);        // see docs for options: https://github.com/pixelmatix/SmartMatrix/wiki
+const uint8_t kBackgroundLayerOptions = (SM_BACKGROUND_OPTIONS_NONE);
+const uint8_t kScrollingLayerOptions = (SM_SCROLLING_OPTIONS_NONE);
+const uint8_t kIndexedLayerOptions = (SM_INDEXED_OPTIONS_NONE);
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kBackgroundLayerOptions);
+SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(scrollingLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kScrollingLayerOptions);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kIndexedLayerOptions);
+
+const uint32_t kPlannedRefreshBytes = SM_MEMORY_HUB75_REFRESH_BYTES(kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
+const uint32_t kPlannedBackgroundBytes = SM_MEMORY_BACKGROUND_LAYER_BYTES(kMatrixWidth, kMatrixHeight, COLOR_DEPTH, kBackgroundLayerOptions);
+const uint32_t kPlannedScrollingBytes = SM_MEMORY_SCROLLING_LAYER_BYTES(kMatrixWidth, kMatrixHeight);
+const uint32_t kPlannedIndexedBytes = SM_MEMORY_INDEXED_LAYER_BYTES(kMatrixWidth, kMatrixHeight);
+
+#if defined(ESP32)
+// the descriptors depend on the lsbMsbTransitionBit refresh picks in begin(), 0 is the most they can take
+const uint32_t kPlannedDescriptorBytes = SM_MEMORY_ESP32_DESCRIPTOR_BYTES(kRefreshDepth, kPanelType, kMatrixOptions, 0);
+#else
+const uint32_t kPlannedDescriptorBytes = 0;
+#endif
+
+SM_MEMORY_CHECK_BUDGET(kPlannedRefreshBytes + kPlannedDescriptorBytes + kPlannedBackgroundBytes + kPlannedScrollingBytes + kPlannedIndexedBytes);
+
+#if !defined(ESP32) && !defined(USE_ADAFRUIT_GFX_LAYERS)
+// on Teensy the allocation macros declare static buffers, so the plan can be checked against them when compiling
+static_assert(kPlannedScrollingBytes == sizeof(scrollingLayerBitmap), "scrolling layer size doesn't match the plan");
+static_assert(kPlannedIndexedBytes == sizeof(indexedLayerBitmap), "indexed layer size doesn't match the plan");
+#endif
+
+void printPlanned(const char * name, uint32_t bytes) {
+  Serial.printf("%-12s %9lu\r\n", name, (unsigned long)bytes);
+}
+
+uint32_t recordedBytes(smMemorySubsystem subsystem) {
+  const smMemoryReport & report = smGetMemoryReport();
+  uint32_t sum = 0;
+  for (int i = 0; i < smMemoryNumTypes; i++)
+    sum += report.bytes[subsystem][i];
+  return sum;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  matrix.addLayer(&backgroundLayer);
+  matrix.addLayer(&scrollingLayer);
+  matrix.addLayer(&indexedLayer);
+  matrix.begin();
+
+  Serial.println("Planned buffer sizes in bytes:");
+  printPlanned("refresh", kPlannedRefreshBytes);
+#if defined(ESP32)
+  printPlanned("descriptors", kPlannedDescriptorBytes);
+#endif
+  printPlanned("background", kPlannedBackgroundBytes);
+  printPlanned("scrolling", kPlannedScrollingBytes);
+  printPlanned("indexed", kPlannedIndexedBytes);
+  Serial.println();
+
+  Serial.println("Allocated at runtime:");
+  smPrintMemoryReport();
+  Serial.println();
+
+#if defined(ESP32)
+  // the background LUT is counted with the LUTs at runtime, add it back to compare the layers as a whole
+  uint32_t recordedLayers = recordedBytes(smMemoryLayers) + recordedBytes(smMemoryLUTs);
+  uint32_t plannedLayers = kPlannedBackgroundBytes + kPlannedScrollingBytes + kPlannedIndexedBytes;
+  Serial.printf("frames: planned %lu, allocated %lu, %s\r\n", (unsigned long)kPlannedRefreshBytes, (unsigned long)recordedBytes(smMemoryFrames),
+    (kPlannedRefreshBytes == recordedBytes(smMemoryFrames)) ? "match" : "MISMATCH");
+  Serial.printf("descriptors: at most %lu, allocated %lu, %s\r\n", (unsigned long)kPlannedDescriptorBytes, (unsigned long)recordedBytes(smMemoryDescriptors),
+    (recordedBytes(smMemoryDescriptors) <= kPlannedDescriptorBytes) ? "ok" : "OVER PLAN");
+  Serial.printf("layers: planned %lu, allocated %lu, %s\r\n", (unsigned long)plannedLayers, (unsigned long)recordedLayers,
+    (plannedLayers == recordedLayers) ? "match" : "MISMATCH");
+#else
+  Serial.println("Teensy buffers are static, their sizes were checked against the plan when compiling");
+#endif
+
+  backgroundLayer.fillScreen(rgb24(0, 0, 0x40));
+  backgroundLayer.swapBuffers();
+  scrollingLayer.setFont(font5x7);
+  scrollingLayer.start("Memory plan checked", -1);
+}
+
+void loop() {
+}
@@ -0,0 +1,150 @@
+/*
+ * SmartMatrix Library - Arduino API subset for the host build
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _SM_HOST_ARDUINO_H_
+#define _SM_HOST_ARDUINO_H_
+
+// Just enough of the Arduino core for the layers and calc to build and run on a desktop, see benchmark.cpp.  Time comes from
+// the host's monotonic clock, Serial writes to stdout and pin functions do nothing.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#define SM_HOST_BUILD
+
+#define PROGMEM
+#define FASTRUN
+#define FLASHMEM
+#define DMAMEM
+#define EXTMEM
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t *)(addr))
+
+#define LOW             0
+#define HIGH            1
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+#define CHANGE          2
+#define FALLING         3
+#define RISING          4
+
+#define DEC             10
+#define HEX             16
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+static inline uint64_t smHostMicros64(void) {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static inline unsigned long micros(void) { return (unsigned long)(uint32_t)smHostMicros64(); }
+static inline unsigned long millis(void) { return (unsigned long)(uint32_t)(smHostMicros64() / 1000); }
+static inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+static inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+static inline void yield(void) {}
+
+// stands in for the Teensy cycle counter read with SM_PROFILING_ENABLED, counting nanoseconds
+#define ARM_DWT_CYCCNT  ((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count())
+
+// templates rather than the usual macros, so std::min and std::max still work
+template <typename A, typename B> static inline auto min(A a, B b) -> decltype(a + b) { return (b < a) ? b : a; }
+template <typename A, typename B> static inline auto max(A a, B b) -> decltype(a + b) { return (a < b) ? b : a; }
+template <typename T, typename L, typename H> static inline T constrain(T x, L low, H high) { return (x < low) ? low : ((x > high) ? high : x); }
+
+static inline void pinMode(uint8_t, uint8_t) {}
+static inline void digitalWrite(uint8_t, uint8_t) {}
+static inline int digitalRead(uint8_t) { return LOW; }
+static inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+static inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+static inline void detachInterrupt(uint8_t) {}
+static inline void noInterrupts(void) {}
+static inline void interrupts(void) {}
+
+class Print {
+    public:
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t * buffer, size_t size) {
+            size_t n = 0;
+            while(size--)
+                n += write(*buffer++);
+            return n;
+        };
+        size_t write(const char * str) { return write((const uint8_t *)str, strlen(str)); };
+
+        size_t print(const char * str) { return write(str); };
+        size_t print(char c) { return write((uint8_t)c); };
+        size_t print(long n, int base = DEC) { return printf(base == HEX ? "%lx" : "%ld", n); };
+        size_t print(int n, int base = DEC) { return print((long)n, base); };
+        size_t print(unsigned long n, int base = DEC) { return printf(base == HEX ? "%lx" : "%lu", n); };
+        size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); };
+        size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); };
+        size_t println(void) { return write("\n"); };
+        template <typename T> size_t println(T value) { return print(value) + println(); };
+        template <typename T> size_t println(T value, int format) { return print(value, format) + println(); };
+
+        template <typename... Args> size_t printf(const char * format, Args... args) {
+            char buffer[256];
+            int n = snprintf(buffer, sizeof(buffer), format, args...);
+            return write((const uint8_t *)buffer, std::min<size_t>(n, sizeof(buffer) - 1));
+        };
+        size_t printf(const char * format) { return write(format); };
+};
+
+class Stream : public Print {
+    public:
+        virtual int available(void) = 0;
+        virtual int read(void) = 0;
+        size_t readBytes(char * buffer, size_t length) {
+            size_t n = 0;
+            while(n < length && available() > 0)
+                buffer[n++] = read();
+            return n;
+        };
+};
+
+// stdout for output, nothing to read
+class SMHostSerial : public Stream {
+    public:
+        void begin(unsigned long) {};
+        operator bool() const { return true; };
+        size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; };
+        size_t write(const uint8_t * buffer, size_t size) { return fwrite(buffer, 1, size, stdout); };
+        using Print::write;
+        int available(void) { return 0; };
+        int read(void) { return -1; };
+};
+
+static SMHostSerial Serial;
+
+#endif
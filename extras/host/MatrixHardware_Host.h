@@ -0,0 +1,47 @@
+/*
+ * SmartMatrix Library - Hardware-specific header file for the host build
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Include instead of a MatrixHardware_*.h file when building for the host (see benchmark.cpp).  The host refresh stands in for
+// the Teensy 4 FlexIO refresh, these are the FlexIO data bit positions the calc packs the color channels into.
+
+#ifndef MATRIX_HARDWARE_H
+#define MATRIX_HARDWARE_H
+
+#define SM_HOST_FLEXIO_BIT_R0   0
+#define SM_HOST_FLEXIO_BIT_G0   1
+#define SM_HOST_FLEXIO_BIT_B0   2
+#define SM_HOST_FLEXIO_BIT_R1   3
+#define SM_HOST_FLEXIO_BIT_G1   4
+#define SM_HOST_FLEXIO_BIT_B1   5
+
+// second chain, used with SM_HUB75_OPTIONS_T4_DUAL_CHAIN
+#define SM_HOST_FLEXIO_BIT_CHAIN1_R0    6
+#define SM_HOST_FLEXIO_BIT_CHAIN1_G0    7
+#define SM_HOST_FLEXIO_BIT_CHAIN1_B0    8
+#define SM_HOST_FLEXIO_BIT_CHAIN1_R1    9
+#define SM_HOST_FLEXIO_BIT_CHAIN1_G1    10
+#define SM_HOST_FLEXIO_BIT_CHAIN1_B1    11
+
+#else
+    #pragma GCC error "Multiple MatrixHardware*.h files included"
+#endif
@@ -0,0 +1,291 @@
+/*
+ * SmartMatrix Library - Refresh stand-in for the host build
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SMARTMATRIXREFRESHT4_H
+#define SMARTMATRIXREFRESHT4_H
+
+// Replaces the Teensy 4 refresh class for the host build, so the Teensy 4 calc (layers, loadMatrixBuffers48 and the bitplane
+// packing) runs unchanged.  There's no DMA: refreshFrames() empties the row buffer and calls the calc until the requested number of
+// refresh frames have been written.  With setCapture(true), every row written is also copied into a frame capture, the bitplane
+// buffers as they would be shifted out, for checking against expected output.
+
+// the placement only changes section attributes and cache maintenance, which the host doesn't have
+#define SM_T4_ROW_BUFFER_OCRAM          0
+#define SM_T4_ROW_BUFFER_DTCM           1
+#ifndef SM_T4_ROW_BUFFER_PLACEMENT
+#define SM_T4_ROW_BUFFER_PLACEMENT      SM_T4_ROW_BUFFER_OCRAM
+#endif
+#define SM_T4_ROW_BUFFER_MEMSECTION
+
+#define RGBDATA_SHIFTERS                4
+#define PAD_PIXELS                      (((-PIXELS_PER_LATCH) % SHIFTER_PIXELS + SHIFTER_PIXELS) % SHIFTER_PIXELS + SHIFTER_PIXELS)
+#define PIXELS_PER_WORD                 ((HUB75_PARALLEL_CHAINS > 1) ? 1 : 2)
+#define SHIFTER_PIXELS                  (RGBDATA_SHIFTERS*PIXELS_PER_WORD)
+
+#define INLINE __attribute__( ( always_inline ) ) inline
+
+// no timer to overflow or pixel clock to keep up with
+#define MIN_REFRESH_RATE                1
+#define MAX_REFRESH_RATE                10000
+
+template <bool wide> struct smT4ClockWord { typedef uint16_t type; };
+template <> struct smT4ClockWord<true> { typedef uint32_t type; };
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+class SmartMatrixRefreshT4 {
+    public:
+        typedef typename smT4ClockWord<(HUB75_PARALLEL_CHAINS > 1)>::type clockWord;
+
+        struct __attribute__((packed, aligned(2))) timerpair {
+            uint16_t timer_oe;
+            uint16_t timer_period;
+        };
+
+        struct __attribute__((packed, aligned(4))) rowBitStruct {
+            clockWord data[PAD_PIXELS + PIXELS_PER_LATCH];
+            uint32_t rowAddress;
+            timerpair timerValues __attribute__((aligned(2)));
+        };
+
+        struct rowDataStruct {
+            rowBitStruct rowbits[refreshDepth / COLOR_CHANNELS_PER_PIXEL];
+        };
+
+        struct flexPinConfigStruct {
+            union { uint8_t r0; uint8_t addx0; };
+            union { uint8_t g0; uint8_t addx1; };
+            union { uint8_t b0; uint8_t addx2; };
+            union { uint8_t r1; uint8_t addx3; };
+            union { uint8_t g1; uint8_t addx4; };
+            uint8_t b1;
+        };
+
+        typedef void (*matrix_underrun_callback)(void);
+        typedef void (*matrix_calc_callback)(bool initial);
+
+        SmartMatrixRefreshT4(uint8_t bufferrows, volatile rowDataStruct * rowDataBuf) {
+            dmaBufferNumRows = bufferrows;
+            dmaBufferDepth = bufferrows;
+            matrixUpdateRows = rowDataBuf;
+        };
+
+        static void begin(void) {
+            flexPinConfig.r0 = SM_HOST_FLEXIO_BIT_R0;
+            flexPinConfig.g0 = SM_HOST_FLEXIO_BIT_G0;
+            flexPinConfig.b0 = SM_HOST_FLEXIO_BIT_B0;
+            flexPinConfig.r1 = SM_HOST_FLEXIO_BIT_R1;
+            flexPinConfig.g1 = SM_HOST_FLEXIO_BIT_G1;
+            flexPinConfig.b1 = SM_HOST_FLEXIO_BIT_B1;
+            flexPinConfigChain1.r0 = SM_HOST_FLEXIO_BIT_CHAIN1_R0;
+            flexPinConfigChain1.g0 = SM_HOST_FLEXIO_BIT_CHAIN1_G0;
+            flexPinConfigChain1.b0 = SM_HOST_FLEXIO_BIT_CHAIN1_B0;
+            flexPinConfigChain1.r1 = SM_HOST_FLEXIO_BIT_CHAIN1_R1;
+            flexPinConfigChain1.g1 = SM_HOST_FLEXIO_BIT_CHAIN1_G1;
+            flexPinConfigChain1.b1 = SM_HOST_FLEXIO_BIT_CHAIN1_B1;
+            rowsQueued = 0;
+            writeIndex = 0;
+            frameReplayAvailable = (optionFlags & SM_HUB75_OPTIONS_T4_FRAME_REPLAY) && dmaBufferNumRows >= MATRIX_SCAN_MOD;
+            frameReplay = false;
+            matrixCalcCallback(true);
+        };
+
+        static volatile rowDataStruct * getNextRowBufferPtr(void) { return &matrixUpdateRows[writeIndex]; };
+        static void writeRowBuffer(uint8_t currentRow) {
+            if (capture) {
+                memcpy(&capture[currentRow], (const void *)&matrixUpdateRows[writeIndex], sizeof(rowDataStruct));
+                // blanked bitplanes are dark on the panel whatever was left in them
+                for (int i = 0; i < skippedPlanes; i++)
+                    memset(capture[currentRow].rowbits[i].data, 0x00, sizeof(capture[currentRow].rowbits[i].data));
+            }
+            if (++writeIndex >= (frameReplayAvailable ? MATRIX_SCAN_MOD : dmaBufferNumRows))
+                writeIndex = 0;
+            rowsQueued++;
+            rowsWritten++;
+        };
+        static void recoverFromDmaUnderrun(void) {};
+        static bool isRowBufferFree(void) { return rowsQueued < dmaBufferDepth; };
+        static void setRowBufferDepth(uint8_t rows) { dmaBufferDepth = constrain(rows, 2, dmaBufferNumRows); };
+        static uint8_t getRowBufferQueuedRows(void) { return rowsQueued; };
+        static bool isFrameReplayAvailable(void) { return frameReplayAvailable; };
+        static uint8_t getNextRowBufferIndex(void) { return writeIndex; };
+        static void setFrameReplay(bool enabled) { frameReplay = enabled && frameReplayAvailable; };
+        static bool getTimerLUTChanged(void) {
+            bool changed = timerLUTChanged;
+            timerLUTChanged = false;
+            return changed;
+        };
+        static void setRefreshRate(uint16_t newRefreshRate) { timerLUTChanged = true; };
+        static void setPixelClockDivider(uint16_t divider) { pixelClockDivider = constrain(divider & ~1, 10, 512); timerLUTChanged = true; };
+        static uint16_t getPixelClockDivider(void) { return pixelClockDivider; };
+        static void setBrightness(uint8_t newBrightness) { brightness = newBrightness; timerLUTChanged = true; };
+        // one tick per brightness step, so a row is lit for brightness/255 of its period
+        static uint32_t getRowLitTicks(void) { return brightness; };
+        static uint32_t getRowPeriodTicks(void) { return 255; };
+        // no timer LUT here, only the content planes are blanked, with the same delay before a lower count is unblanked
+        static void setContentLowPlanes(uint8_t lowPlanes) {
+            bool unblank = unblankFrames && !--unblankFrames;
+            if (lowPlanes == contentLowPlanes && !unblank)
+                return;
+            contentLowPlanes = lowPlanes;
+            if (unblank)
+                skippedPlanes = packedPlanes;
+
+            uint8_t planes = min((int)lowPlanes, refreshDepth / COLOR_CHANNELS_PER_PIXEL - 1);
+            if (planes >= skippedPlanes) {
+                skippedPlanes = planes;
+                unblankFrames = 0;
+            } else if (!unblankFrames || planes < packedPlanes) {
+                unblankFrames = 2;
+            }
+            packedPlanes = planes;
+            timerLUTChanged = true;
+        };
+        static uint8_t getSkippedPlanes(void) { return packedPlanes; };
+        static uint8_t getBrightness(void) { return brightness; };
+        static void setMatrixCalculationsCallback(matrix_calc_callback f) { matrixCalcCallback = f; };
+        static void setMatrixUnderrunCallback(matrix_underrun_callback f) {};
+        static void markNextRowBuffer(void) {
+            markedRowShifted = false;
+            markedRowBuffer = writeIndex;
+        };
+        static bool getMarkedRowShiftMicros(uint32_t & shiftMicros) {
+            if (!markedRowShifted)
+                return false;
+            shiftMicros = markedRowShiftMicros;
+            markedRowShifted = false;
+            return true;
+        };
+        static const flexPinConfigStruct & getFlexPinConfig(uint8_t chain = 0) { return chain ? flexPinConfigChain1 : flexPinConfig; };
+
+        // runs the calc as the refresh ISR would, until frames more refresh frames (every row once) have been written, or replayed
+        // from the buffer with SM_HUB75_OPTIONS_T4_FRAME_REPLAY
+        static void refreshFrames(uint32_t frames) {
+            uint32_t target = rowsWritten + rowsReplayed + frames * MATRIX_SCAN_MOD;
+            while (rowsWritten + rowsReplayed < target) {
+                // everything queued has been shown
+                if (rowsQueued && markedRowBuffer >= 0) {
+                    markedRowShiftMicros = micros();
+                    markedRowShifted = true;
+                    markedRowBuffer = -1;
+                }
+                rowsQueued = 0;
+                SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_ENTRY, 0);
+                matrixCalcCallback(false);
+                SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_EXIT, rowsQueued);
+                // nothing new, the next slot is shown again
+                if (!rowsQueued && frameReplay) {
+                    if (++writeIndex >= MATRIX_SCAN_MOD)
+                        writeIndex = 0;
+                    rowsReplayed++;
+                }
+            }
+        };
+
+        // copies each row written into a buffer of MATRIX_SCAN_MOD rows, allocated here
+        static bool setCapture(bool enable) {
+            if (enable && !capture)
+                capture = (rowDataStruct *)calloc(MATRIX_SCAN_MOD, sizeof(rowDataStruct));
+            if (!enable) {
+                free(capture);
+                capture = NULL;
+            }
+            return !enable || capture;
+        };
+        static const rowDataStruct * getCapturedRow(unsigned int row) { return capture ? &capture[row] : NULL; };
+        static uint32_t getRowsWritten(void) { return rowsWritten; };
+        static uint32_t getRowsReplayed(void) { return rowsReplayed; };
+
+    private:
+        static uint8_t dmaBufferNumRows;
+        static uint8_t dmaBufferDepth;
+        static uint8_t rowsQueued;
+        static uint8_t writeIndex;
+        static uint32_t rowsWritten;
+        static uint32_t rowsReplayed;
+        static bool frameReplayAvailable;
+        static bool frameReplay;
+        static bool timerLUTChanged;
+        static volatile rowDataStruct * matrixUpdateRows;
+        static rowDataStruct * capture;
+        static matrix_calc_callback matrixCalcCallback;
+        static flexPinConfigStruct flexPinConfig;
+        static flexPinConfigStruct flexPinConfigChain1;
+        static int8_t markedRowBuffer;
+        static bool markedRowShifted;
+        static uint32_t markedRowShiftMicros;
+        static uint8_t brightness;
+        static uint8_t contentLowPlanes;
+        static uint8_t skippedPlanes;
+        static uint8_t packedPlanes;
+        static uint8_t unblankFrames;
+        static uint16_t pixelClockDivider;
+};
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferNumRows;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferDepth;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowsQueued;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeIndex;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowsWritten;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowsReplayed;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameReplayAvailable;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameReplay;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerLUTChanged;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct * SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct * SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::capture;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrix_calc_callback SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalcCallback;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfig;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigChain1;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowBuffer = -1;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness = 255;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::contentLowPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::skippedPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packedPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::unblankFrames = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::pixelClockDivider = 26;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowShifted;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowShiftMicros;
+
+#endif
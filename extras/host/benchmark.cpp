@@ -0,0 +1,170 @@
+/*
+ * SmartMatrix Library - Host benchmark
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Builds the layers and the Teensy 4 calc for a desktop, with a refresh stand-in (MatrixHostHub75Refresh.h) in place of FlexIO and
+// DMA, and times drawing, swapping and refresh calculations at a few sizes and depths.  Results are CSV on stdout:
+//   config,benchmark,value,unit
+// The capture checksum is a hash of the bitplane buffers the calc produced for a fixed test frame, it changes when the refresh
+// output changes.  From the library directory:
+//
+//   g++ -O2 -g -std=gnu++14 -Iextras/host -Isrc extras/host/benchmark.cpp src/Layer.cpp src/MatrixFont.cpp src/MatrixPanelMaps.cpp src/Font_*.c -o smbenchmark
+//   ./smbenchmark [scale]
+//
+// scale multiplies the iteration counts.  Builds with -fsanitize=address,undefined, and runs under perf and valgrind --tool=cachegrind.
+
+#include "Arduino.h"
+#include "MatrixHardware_Host.h"
+#include "SmartMatrix.h"
+
+static double iterationScale = 1.0;
+
+static uint32_t iterations(uint32_t count) {
+    return std::max<uint32_t>(1, count * iterationScale);
+}
+
+static void report(const char * config, const char * benchmark, double value, const char * unit) {
+    printf("%s,%s,%.1f,%s\n", config, benchmark, value, unit);
+}
+
+static uint64_t elapsedMicros(uint64_t start) {
+    return std::max<uint64_t>(1, smHostMicros64() - start);
+}
+
+template <int width, int height, int refreshDepth, unsigned char panelType>
+static void benchmarkConfig(void) {
+    typedef SmartMatrixRefreshT4<refreshDepth, width, height, panelType, SM_HUB75_OPTIONS_NONE> Refresh;
+    const uint8_t bufferRows = 4;
+    const int frames = iterations(200);
+    uint64_t start;
+    char config[48];
+
+    snprintf(config, sizeof(config), "%dx%d depth %d scan %d", width, height, refreshDepth, CONVERT_PANELTYPE_TO_MATRIXSCANMOD(panelType));
+
+    // SMARTMATRIX_ALLOCATE_BUFFERS() without the template keywords it can't have
+    static volatile typename Refresh::rowDataStruct rowsDataBuffer[bufferRows];
+    static Refresh matrixRefresh(bufferRows, rowsDataBuffer);
+    static SmartMatrixHub75Calc<refreshDepth, width, height, panelType, SM_HUB75_OPTIONS_NONE> matrix(bufferRows, rowsDataBuffer);
+    SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, width, height, 24, SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER);
+    SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(scrollingLayer, width, height, 24, SM_SCROLLING_OPTIONS_NONE);
+    SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, width, height, 24, SM_INDEXED_OPTIONS_NONE);
+
+    // the memory planner has to report the sizes the allocation macros above actually allocate
+    static_assert(SM_MEMORY_HUB75_REFRESH_BYTES(width, height, refreshDepth, bufferRows, panelType, SM_HUB75_OPTIONS_NONE) == sizeof(rowsDataBuffer),
+        "SM_MEMORY_HUB75_REFRESH_BYTES doesn't match the row buffers");
+    static_assert(SM_MEMORY_BACKGROUND_LAYER_BYTES(width, height, 24, SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) ==
+        sizeof(backgroundLayerBitmap) + sizeof(backgroundLayercolorCorrectionLUT), "SM_MEMORY_BACKGROUND_LAYER_BYTES doesn't match the background layer");
+    static_assert(SM_MEMORY_SCROLLING_LAYER_BYTES(width, height) == sizeof(scrollingLayerBitmap), "SM_MEMORY_SCROLLING_LAYER_BYTES doesn't match the scrolling layer");
+    static_assert(SM_MEMORY_INDEXED_LAYER_BYTES(width, height) == sizeof(indexedLayerBitmap), "SM_MEMORY_INDEXED_LAYER_BYTES doesn't match the indexed layer");
+
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&scrollingLayer);
+    matrix.addLayer(&indexedLayer);
+    matrix.begin();
+
+    // calc with empty layers: mostly the bitplane packing
+    start = smHostMicros64();
+    Refresh::refreshFrames(frames);
+    report(config, "calc empty layers", (double)elapsedMicros(start) / frames, "us/frame");
+
+    // drawing primitives, swaps without copies so only the drawing is timed
+    uint32_t count = iterations(2000000);
+    start = smHostMicros64();
+    for (uint32_t i = 0; i < count; i++)
+        backgroundLayer.drawPixel(i % width, (i / width) % height, rgb24(i, i >> 8, i >> 16));
+    report(config, "drawPixel", count / (elapsedMicros(start) / 1e6), "pixels/s");
+
+    count = iterations(20000);
+    uint64_t area = 0;
+    start = smHostMicros64();
+    for (uint32_t i = 0; i < count; i++) {
+        backgroundLayer.fillRectangle(i % 8, i % 4, width - 1 - (i % 8), height - 1 - (i % 4), rgb24(i, 0, 255 - i));
+        area += (width - 2 * (i % 8)) * (height - 2 * (i % 4));
+    }
+    report(config, "fillRectangle", area / (elapsedMicros(start) / 1e6), "pixels/s");
+
+    backgroundLayer.setFont(font6x10);
+    count = iterations(200000);
+    start = smHostMicros64();
+    for (uint32_t i = 0; i < count; i++)
+        backgroundLayer.drawString(i % 4, i % (height - 10), rgb24(255, 255, 255), "SMART");
+    report(config, "drawString", count * 5.0 / (elapsedMicros(start) / 1e6), "chars/s");
+
+    static rgb24 bitmap[width * height];
+    for (int i = 0; i < width * height; i++)
+        bitmap[i] = rgb24(i, i * 3, i * 7);
+    count = iterations(20000);
+    start = smHostMicros64();
+    for (uint32_t i = 0; i < count; i++)
+        backgroundLayer.drawBitmap(0, 0, width, height, bitmap, SM_BITMAP_FORMAT_RGB24);
+    report(config, "drawBitmap rgb24", (double)count * width * height / (elapsedMicros(start) / 1e6), "pixels/s");
+
+    count = iterations(20000);
+    start = smHostMicros64();
+    for (uint32_t i = 0; i < count; i++)
+        backgroundLayer.swapBuffers(true);
+    report(config, "swapBuffers copy", (double)elapsedMicros(start) / count, "us/swap");
+
+    // a fixed test frame in the background layer
+    backgroundLayer.fillScreen(rgb24(0x20, 0x40, 0x80));
+    backgroundLayer.drawBitmap(0, 0, width, height / 2, bitmap, SM_BITMAP_FORMAT_RGB24);
+    backgroundLayer.swapBuffers(true);
+    // hash one frame of bitplanes, before the scrolling text starts moving
+    Refresh::refreshFrames(1);
+    Refresh::setCapture(true);
+    Refresh::refreshFrames(1);
+    uint32_t hash = 2166136261u;
+    for (int row = 0; row < MATRIX_SCAN_MOD; row++) {
+        const uint8_t * bytes = (const uint8_t *)Refresh::getCapturedRow(row);
+        for (size_t i = 0; i < sizeof(typename Refresh::rowDataStruct); i++)
+            hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    Refresh::setCapture(false);
+    printf("%s,capture checksum,%08x,fnv1a\n", config, hash);
+
+    // then something in every layer
+    scrollingLayer.setFont(font5x7);
+    scrollingLayer.start("SmartMatrix host benchmark", -1);
+    indexedLayer.setFont(font3x5);
+    indexedLayer.setIndexedColor(1, rgb24(255, 0, 0));
+    indexedLayer.drawString(0, height - 6, 1, "HOST");
+    indexedLayer.swapBuffers(false);
+
+    start = smHostMicros64();
+    Refresh::refreshFrames(frames);
+    report(config, "calc three layers", (double)elapsedMicros(start) / frames, "us/frame");
+}
+
+int main(int argc, char * argv[]) {
+    if (argc > 1)
+        iterationScale = atof(argv[1]);
+
+    printf("config,benchmark,value,unit\n");
+    benchmarkConfig<32, 32, 24, SM_PANELTYPE_HUB75_32ROW_MOD16SCAN>();
+    benchmarkConfig<32, 32, 36, SM_PANELTYPE_HUB75_32ROW_MOD16SCAN>();
+    benchmarkConfig<32, 32, 48, SM_PANELTYPE_HUB75_32ROW_MOD16SCAN>();
+    benchmarkConfig<64, 32, 36, SM_PANELTYPE_HUB75_16ROW_MOD8SCAN>();
+    benchmarkConfig<64, 64, 36, SM_PANELTYPE_HUB75_64ROW_MOD32SCAN>();
+    benchmarkConfig<128, 64, 36, SM_PANELTYPE_HUB75_32ROW_MOD16SCAN>();
+    benchmarkConfig<128, 64, 48, SM_PANELTYPE_HUB75_32ROW_MOD16SCAN>();
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * SmartMatrix Library - Host golden output check
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Renders a reference scene through the Teensy 4 calc for every panel type, with each stacking option, HUB12 mode and dual chain,
+// and compares the bitplane buffers the calc produced against golden.txt.  Run it before and after changing the packing, panel
+// maps or layer code: every line of golden.txt is a config and the hash of each of its refresh rows, a mismatch lists the rows
+// that changed.  From the library directory:
+//
+//   g++ -O2 -g -std=gnu++14 -Iextras/host -Isrc extras/host/golden.cpp src/Layer.cpp src/MatrixFont.cpp src/MatrixPanelMaps.cpp src/Font_*.c -o smgolden
+//   ./smgolden [--update] [--dump directory] [golden file]
+//
+// The golden file defaults to extras/host/golden.txt.  --update rewrites it from this build, only do that when the output is meant
+// to change.  --dump writes each config's captured rows to a file in directory, for comparing two builds with cmp.  Add
+// -DSM_T4_PIXEL_PACKING=SM_T4_PACKING_SCALAR to check the scalar packing against the same golden file.  The font lookup check at the
+// end only compares glyph rows, build with -fsanitize=address to have it catch reads past the fonts' tables as well.
+
+#include <map>
+#include <string>
+
+#include "Arduino.h"
+#include "MatrixHardware_Host.h"
+#include "SmartMatrix.h"
+
+static std::map<std::string, std::string> golden;
+static FILE * updateFile = NULL;
+static const char * dumpDirectory = NULL;
+static int configsChecked = 0;
+static int configsFailed = 0;
+
+static uint32_t fnv1a(const void * data, size_t size) {
+    const uint8_t * bytes = (const uint8_t *)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+static void loadGolden(const char * filename) {
+    FILE * file = fopen(filename, "r");
+    char line[1024];
+
+    if (!file)
+        return;
+    while (fgets(line, sizeof(line), file)) {
+        char * separator = strchr(line, ':');
+        if (line[0] == '#' || !separator)
+            continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        golden[std::string(line, separator - line)] = separator + 1;
+    }
+    fclose(file);
+}
+
+// compares the row hashes with the golden file, and lists the rows that differ
+static void checkConfig(const char * config, const uint32_t * rowHashes, int rows) {
+    std::string hashes;
+    char hash[16];
+
+    for (int row = 0; row < rows; row++) {
+        snprintf(hash, sizeof(hash), " %08x", rowHashes[row]);
+        hashes += hash;
+    }
+
+    configsChecked++;
+    if (updateFile) {
+        fprintf(updateFile, "%s:%s\n", config, hashes.c_str());
+        return;
+    }
+
+    std::map<std::string, std::string>::iterator expected = golden.find(config);
+    if (expected == golden.end()) {
+        printf("MISSING %s\n", config);
+        configsFailed++;
+        return;
+    }
+    if (expected->second == hashes)
+        return;
+
+    printf("FAILED  %s, rows", config);
+    for (int row = 0; row < rows; row++) {
+        unsigned int expectedHash;
+        if (sscanf(expected->second.c_str() + row * 9, " %08x", &expectedHash) != 1 || expectedHash != rowHashes[row])
+            printf(" %d", row);
+    }
+    printf("\n");
+    configsFailed++;
+}
+
+template <int width, int height, int refreshDepth, unsigned char panelType, uint32_t optionFlags>
+static void goldenConfig(const char * panelName, const char * optionName) {
+    typedef SmartMatrixRefreshT4<refreshDepth, width, height, panelType, optionFlags> Refresh;
+    const uint8_t bufferRows = 4;
+    char config[160];
+
+    snprintf(config, sizeof(config), "%s %s %dx%d depth %d", panelName, optionName, width, height, refreshDepth);
+
+    // SMARTMATRIX_ALLOCATE_BUFFERS() without the template keywords it can't have
+    static volatile typename Refresh::rowDataStruct rowsDataBuffer[bufferRows];
+    static Refresh matrixRefresh(bufferRows, rowsDataBuffer);
+    static SmartMatrixHub75Calc<refreshDepth, width, height, panelType, optionFlags> matrix(bufferRows, rowsDataBuffer);
+    SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, width, height, 48, SM_BACKGROUND_OPTIONS_NONE);
+    SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, width, height, 48, SM_INDEXED_OPTIONS_NONE);
+
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&indexedLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+
+    // adaptive bitplanes start from a scene with the low 8 bits clear, so the scene below brings the low bitplanes back, and has to
+    // match the same config without the option once they're unblanked
+    if (optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) {
+        backgroundLayer.fillScreen(rgb48(0x8000, 0x4000, 0xff00));
+        backgroundLayer.swapBuffers(false);
+        Refresh::refreshFrames(3);
+    }
+
+    // every pixel a different color using all 16 bits of each channel, so misplaced pixels and bits both show up
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            backgroundLayer.drawPixel(x, y, rgb48((x * 2731 + y * 97) ^ (y << 11), x * y * 523 + 0x1234, (x ^ y) * 4099 + (x << 8)));
+    }
+    backgroundLayer.swapBuffers(false);
+
+    // a transparent layer on top with text crossing the panel boundaries
+    indexedLayer.enableColorCorrection(false);
+    indexedLayer.setFont(font5x7);
+    indexedLayer.setIndexedColor(1, rgb24(0xff, 0x80, 0x01));
+    indexedLayer.drawString(width / 2 - 7, height / 2 - 4, 1, "SMT4");
+    indexedLayer.drawString(0, 0, 1, "0");
+    indexedLayer.swapBuffers(false);
+
+    // the first frame picks up the swaps, capture the second, or the first with all bitplanes unblanked again
+    Refresh::refreshFrames((optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) ? 4 : 1);
+    Refresh::setCapture(true);
+    Refresh::refreshFrames(1);
+
+    uint32_t rowHashes[MATRIX_SCAN_MOD];
+    for (int row = 0; row < MATRIX_SCAN_MOD; row++)
+        rowHashes[row] = fnv1a(Refresh::getCapturedRow(row), sizeof(typename Refresh::rowDataStruct));
+    checkConfig(config, rowHashes, MATRIX_SCAN_MOD);
+
+    if (dumpDirectory) {
+        char filename[320];
+        snprintf(filename, sizeof(filename), "%s/%s.bin", dumpDirectory, config);
+        for (char * c = filename + strlen(dumpDirectory) + 1; *c; c++) {
+            if (*c == ' ' || *c == '|')
+                *c = '_';
+        }
+        FILE * file = fopen(filename, "wb");
+        if (file) {
+            for (int row = 0; row < MATRIX_SCAN_MOD; row++)
+                fwrite(Refresh::getCapturedRow(row), sizeof(typename Refresh::rowDataStruct), 1, file);
+            fclose(file);
+        } else {
+            printf("Error: can't write %s\n", filename);
+        }
+    }
+
+    Refresh::setCapture(false);
+}
+
+// glyph lookups that miss the font, checked against the rows every lookup should return rather than golden.txt
+static void checkFontLookups(void) {
+    const char * config = "font lookups";
+    bool passed = true;
+
+    // the same codepoint past the font's Index twice, a miss used to leave the next search starting one entry past the end
+    for (int i = 0; i < 2; i++) {
+        if (getBitmapFontCodepointRows(0x20AC, &apple5x7))
+            passed = false;
+    }
+    passed = passed && getBitmapFontCodepointRows('A', &apple5x7) == getBitmapFontGlyphRows('A', &apple5x7);
+
+    // a location saved from a larger font has to be dropped by a smaller one, a copy of a bundled font isn't cached so it's searched
+    bitmap_font largerFont = apple5x7;
+    bitmap_font smallerFont = gohufont6x11;
+    passed = passed && getBitmapFontCodepointRows(0xFF, &largerFont) == getBitmapFontGlyphRows(0xFF, &apple5x7);
+    passed = passed && getBitmapFontCodepointRows('A', &smallerFont) == getBitmapFontGlyphRows('A', &gohufont6x11);
+
+    // and "€€" drawn as text, through the UTF-8 decoding
+    SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(fontLayer, 32, 16, 24, SM_BACKGROUND_OPTIONS_NONE);
+    fontLayer.begin();
+    fontLayer.setRotation(rotation0);
+    fontLayer.setFont(font5x7);
+    fontLayer.drawString(0, 0, rgb24(0xff, 0xff, 0xff), "\xe2\x82\xac\xe2\x82\xac");
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 32; x++) {
+            rgb24 pixel = fontLayer.readPixel(x, y);
+            passed = passed && !pixel.red && !pixel.green && !pixel.blue;
+        }
+    }
+
+    configsChecked++;
+    if (!passed) {
+        printf("FAILED  %s\n", config);
+        configsFailed++;
+    }
+}
+
+// two panels wide and at least two stacked, so the stacking options have something to do, and at least 8 rows for the indexed layer
+#define GOLDEN_WIDTH(panelType)     (2 * CONVERT_PANELTYPE_TO_MATRIXPANELWIDTH(panelType))
+#define GOLDEN_HEIGHT(panelType)    ((CONVERT_PANELTYPE_TO_MATRIXPANELHEIGHT(panelType) < 4 ? 4 : 2) * CONVERT_PANELTYPE_TO_MATRIXPANELHEIGHT(panelType))
+
+#define GOLDEN_OPTION(panelType, panelName, depth, options, chains) \
+    goldenConfig<GOLDEN_WIDTH(panelType), chains * GOLDEN_HEIGHT(panelType), depth, panelType, options>(panelName, #options)
+
+#define GOLDEN_PANEL(panelType) \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_NONE, 1); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_C_SHAPE_STACKING, 1); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_BOTTOM_TO_TOP_STACKING, 1); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_C_SHAPE_STACKING | SM_HUB75_OPTIONS_BOTTOM_TO_TOP_STACKING, 1); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_HUB12_MODE, 1); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_T4_DUAL_CHAIN, 2); \
+    GOLDEN_OPTION(panelType, #panelType, 36, SM_HUB75_OPTIONS_T4_DUAL_CHAIN | SM_HUB75_OPTIONS_C_SHAPE_STACKING, 2)
+
+int main(int argc, char * argv[]) {
+    const char * goldenFilename = "extras/host/golden.txt";
+    bool update = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update"))
+            update = true;
+        else if (!strcmp(argv[i], "--dump") && i + 1 < argc)
+            dumpDirectory = argv[++i];
+        else
+            goldenFilename = argv[i];
+    }
+
+    if (update) {
+        updateFile = fopen(goldenFilename, "w");
+        if (!updateFile) {
+            printf("Error: can't write %s\n", goldenFilename);
+            return 1;
+        }
+        fprintf(updateFile, "# SmartMatrix golden output, written by extras/host/golden.cpp --update\n");
+        fprintf(updateFile, "# config: FNV-1a hash of each captured refresh row\n");
+    } else {
+        loadGolden(goldenFilename);
+        if (golden.empty()) {
+            printf("Error: no golden output in %s\n", goldenFilename);
+            return 1;
+        }
+    }
+
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_MOD8SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_64ROW_MOD32SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_4ROW_MOD2SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_8ROW_MOD4SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD2SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB12_16ROW_32COL_MOD4SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_2ROW_MOD1SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN_V2);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_32ROW_64COL_MOD8SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_64ROW_64COL_MOD16SCAN);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN_V3);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN_V4);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_16ROW_32COL_MOD2SCAN_V2);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_4ROW_MOD2SCAN_ALT_ADDX);
+    GOLDEN_PANEL(SM_PANELTYPE_HUB75_8ROW_MOD4SCAN_ALT_ADDX);
+
+    // the other refresh depths, on the most common panel
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 24, SM_HUB75_OPTIONS_NONE, 1);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 48, SM_HUB75_OPTIONS_NONE, 1);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 24, SM_HUB75_OPTIONS_T4_DUAL_CHAIN, 2);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 48, SM_HUB75_OPTIONS_T4_DUAL_CHAIN, 2);
+
+    // pipelined temp rows must match the same configs without them, with and without multi row refresh
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 36, SM_HUB75_OPTIONS_T4_PIPELINED_ROWS, 1);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 36, SM_HUB75_OPTIONS_T4_DUAL_CHAIN | SM_HUB75_OPTIONS_T4_PIPELINED_ROWS, 2);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN, "SM_PANELTYPE_HUB75_16ROW_32COL_MOD4SCAN", 36, SM_HUB75_OPTIONS_T4_PIPELINED_ROWS, 1);
+
+    // adaptive bitplanes must match the same configs without them once the low bitplanes are back
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 36, SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES, 1);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 48, SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES, 1);
+    GOLDEN_OPTION(SM_PANELTYPE_HUB75_32ROW_MOD16SCAN, "SM_PANELTYPE_HUB75_32ROW_MOD16SCAN", 36, SM_HUB75_OPTIONS_T4_DUAL_CHAIN | SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES, 2);
+
+    // not a config in golden.txt, so it's skipped when updating
+    if (!updateFile)
+        checkFontLookups();
+
+    if (updateFile) {
+        fclose(updateFile);
+        printf("%d configs written to %s\n", configsChecked, goldenFilename);
+        return 0;
+    }
+
+    printf("%d configs checked, %d failed\n", configsChecked, configsFailed);
+    return configsFailed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+#
+# SmartMatrix Library - converts images and animated GIFs to SmartMatrix animation files (.sma) for SMAnimationPlayer
+#
+# Each frame after the first stores only the row bands that changed since the previous frame, cropped to the changed columns,
+# RLE compressed in the pixel format of the layer that will play it (rgb24, rgb16 or rgb8 storage).  See MatrixAnimation.h.
+#
+#   python3 smanim.py --width 128 --height 64 --format rgb24 animation.gif animation.sma
+#   python3 smanim.py --width 64 --height 32 --format rgb16 --header logo frame*.png logo.h
+#
+# With --header the output is a C header with a const array, for SMMemorySource.  Needs Pillow.
+
+import argparse
+import struct
+import sys
+
+FORMATS = {'rgb24': 0, 'rgb16': 1, 'rgb8': 2}
+# rows per band when looking for changed regions, smaller bands find tighter regions but cost 8 bytes of rectangle header each
+BAND_ROWS = 8
+
+
+def convert_pixel(r, g, b, fmt):
+    if fmt == 'rgb16':
+        return struct.pack('<H', ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+    if fmt == 'rgb8':
+        return bytes([(r & 0xE0) | ((g & 0xE0) >> 3) | (b >> 6)])
+    return bytes([r, g, b])
+
+
+def convert_frame(rgb, width, height, fmt):
+    return [convert_pixel(rgb[i], rgb[i + 1], rgb[i + 2], fmt) for i in range(0, width * height * 3, 3)]
+
+
+def encode_rle(pixels):
+    out = bytearray()
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:128]
+            del literal[:128]
+            out.append(len(chunk) - 1)
+            for p in chunk:
+                out.extend(p)
+
+    i = 0
+    while i < len(pixels):
+        run = 1
+        while i + run < len(pixels) and run < 128 and pixels[i + run] == pixels[i]:
+            run += 1
+        if run >= 2:
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out.extend(pixels[i])
+            i += run
+        else:
+            literal.append(pixels[i])
+            i += 1
+    flush_literal()
+    return bytes(out)
+
+
+def encode_rect(pixels, width, x, y, w, h):
+    region = [pixels[(y + row) * width + x + col] for row in range(h) for col in range(w)]
+    return struct.pack('<HHHH', x, y, w, h) + encode_rle(region)
+
+
+def changed_rects(pixels, previous, width, height):
+    if previous is None:
+        return [(0, 0, width, height)]
+
+    rects = []
+    for band in range(0, height, BAND_ROWS):
+        rows = range(band, min(band + BAND_ROWS, height))
+        changed = [x for x in range(width) if any(pixels[y * width + x] != previous[y * width + x] for y in rows)]
+        if not changed:
+            continue
+        changed_rows = [y for y in rows if any(pixels[y * width + x] != previous[y * width + x] for x in changed)]
+        x0, x1 = changed[0], changed[-1]
+        y0, y1 = changed_rows[0], changed_rows[-1]
+        # merge with the band above when they touch and cover the same columns
+        if rects and rects[-1][1] + rects[-1][3] == y0 and rects[-1][0] == x0 and rects[-1][2] == x1 - x0 + 1:
+            px, py, pw, ph = rects.pop()
+            rects.append((px, py, pw, y1 - py + 1))
+        else:
+            rects.append((x0, y0, x1 - x0 + 1, y1 - y0 + 1))
+    return rects
+
+
+def load_frames(paths, width, height):
+    from PIL import Image, ImageSequence
+    frames = []
+    for path in paths:
+        image = Image.open(path)
+        for frame in ImageSequence.Iterator(image):
+            delay = frame.info.get('duration', 100) or 100
+            frames.append((frame.convert('RGB').resize((width, height)).tobytes(), delay))
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert images to a SmartMatrix animation')
+    parser.add_argument('--width', type=int, required=True)
+    parser.add_argument('--height', type=int, required=True)
+    parser.add_argument('--format', choices=FORMATS.keys(), default='rgb24', help='storage type of the layer playing it')
+    parser.add_argument('--delay', type=int, default=0, help='frame delay in ms, overriding the delays in the images')
+    parser.add_argument('--header', metavar='NAME', help='write a C header with a const array called NAME')
+    parser.add_argument('inputs', nargs='+')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    frames = load_frames(args.inputs, args.width, args.height)
+    if not frames or len(frames) > 0xFFFF:
+        print('no frames, or too many frames')
+        return 1
+
+    out = bytearray(b'SMA1' + struct.pack('<HHBBHI', args.width, args.height, FORMATS[args.format], 0, len(frames), 0))
+    previous = None
+    for rgb, delay in frames:
+        pixels = convert_frame(rgb, args.width, args.height, args.format)
+        rects = changed_rects(pixels, previous, args.width, args.height)
+        out += struct.pack('<HH', min(args.delay or delay, 0xFFFF), len(rects))
+        for rect in rects:
+            out += encode_rect(pixels, args.width, *rect)
+        previous = pixels
+
+    if args.header:
+        with open(args.output, 'w') as f:
+            f.write('// %dx%d %s animation, %d frames, made with smanim.py\n' % (args.width, args.height, args.format, len(frames)))
+            f.write('const uint8_t %s[%d] = {\n' % (args.header, len(out)))
+            for i in range(0, len(out), 16):
+                f.write('    ' + ', '.join('0x%02x' % b for b in out[i:i + 16]) + ',\n')
+            f.write('};\n')
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(out)
+
+    raw = len(frames) * args.width * args.height * len(convert_pixel(0, 0, 0, args.format))
+    print('%d frames, %d bytes (%.1f%% of uncompressed)' % (len(frames), len(out), 100.0 * len(out) / raw))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# SmartMatrix Library - packs bitmaps and animations into an asset pack for SMFlashAssets (MatrixFlashAssets.h)
+#
+# Images are converted to the given storage format (match the layer's storage type so drawBitmap() can memcpy rows), .sma files
+# (made with smanim.py) and other files are stored as they are.  Asset names are the file names without extension, up to 15 characters.
+#
+#   python3 smassets.py --format rgb24 logo.png arrow.png intro.sma assets.bin
+#   python3 smassets.py --format rgb16 --header assets logo.png assets.h
+#
+# ESP32: add a data partition to the partition table, e.g. "assets, data, 0x40, , 1M", and write the pack to it with
+#   parttool.py --port /dev/ttyUSB0 write_partition --partition-name assets --input assets.bin
+# Teensy 4: with --header the output is a C header with a PROGMEM array, which stays in flash and is read in place.
+# Images need Pillow.
+
+import argparse
+import os
+import struct
+import sys
+
+FORMATS = {'rgb24': 0, 'rgb16': 1, 'rgb8': 2}
+BITMAP = 0
+ANIMATION = 1
+DATA = 2
+HEADER_SIZE = 8
+ENTRY_SIZE = 32
+NAME_LENGTH = 16
+IMAGE_EXTENSIONS = ('.png', '.bmp', '.gif', '.jpg', '.jpeg')
+
+
+def convert_image(path, fmt):
+    from PIL import Image
+    image = Image.open(path).convert('RGB')
+    rgb = image.tobytes()
+    out = bytearray()
+    for i in range(0, len(rgb), 3):
+        r, g, b = rgb[i], rgb[i + 1], rgb[i + 2]
+        if fmt == 'rgb16':
+            out += struct.pack('<H', ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+        elif fmt == 'rgb8':
+            out.append((r & 0xE0) | ((g & 0xE0) >> 3) | (b >> 6))
+        else:
+            out += bytes([r, g, b])
+    return bytes(out), image.width, image.height
+
+
+def load_asset(path, fmt):
+    name, extension = os.path.splitext(os.path.basename(path))
+    if len(name) >= NAME_LENGTH:
+        raise ValueError('asset name too long: ' + name)
+    extension = extension.lower()
+    if extension in IMAGE_EXTENSIONS:
+        data, width, height = convert_image(path, fmt)
+        return name, data, BITMAP, FORMATS[fmt], width, height
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:4] == b'SMA1':
+        width, height, anim_format = struct.unpack('<HHB', data[4:9])
+        return name, data, ANIMATION, anim_format, width, height
+    return name, data, DATA, 0, 0, 0
+
+
+def build_pack(assets):
+    offset = HEADER_SIZE + len(assets) * ENTRY_SIZE
+    entries = bytearray()
+    body = bytearray()
+    for name, data, asset_type, fmt, width, height in assets:
+        # 4-byte aligned, so rgb16 rows start on a 2-byte boundary
+        padding = -(offset + len(body)) % 4
+        body += bytes(padding)
+        entries += name.encode('ascii').ljust(NAME_LENGTH, b'\0')
+        entries += struct.pack('<IIBBHHH', offset + len(body), len(data), asset_type, fmt, width, height, 0)
+        body += data
+    return b'SMAP' + struct.pack('<HH', len(assets), 0) + bytes(entries) + bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack bitmaps and animations for SMFlashAssets')
+    parser.add_argument('--format', choices=FORMATS.keys(), default='rgb24', help='storage type of the layer drawing the images')
+    parser.add_argument('--header', metavar='NAME', help='write a C header with a PROGMEM array called NAME')
+    parser.add_argument('inputs', nargs='+')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    assets = [load_asset(path, args.format) for path in args.inputs]
+    if len(assets) > 0xFFFF:
+        print('too many assets')
+        return 1
+    pack = build_pack(assets)
+
+    if args.header:
+        with open(args.output, 'w') as f:
+            f.write('// SmartMatrix asset pack, %d assets, made with smassets.py\n' % len(assets))
+            f.write('const uint8_t %s[%d] PROGMEM __attribute__((aligned(4))) = {\n' % (args.header, len(pack)))
+            for i in range(0, len(pack), 16):
+                f.write('    ' + ', '.join('0x%02x' % b for b in pack[i:i + 16]) + ',\n')
+            f.write('};\n')
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(pack)
+
+    for name, data, asset_type, fmt, width, height in assets:
+        print('%-15s %-9s %4dx%-4d %7d bytes' % (name, ('bitmap', 'animation', 'data')[asset_type], width, height, len(data)))
+    print('%d assets, %d bytes' % (len(assets), len(pack)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+#
+# SmartMatrix Library - converts a BDF bitmap font into a packed font for loadPackedBitmapFont() (MatrixFontCommon.h)
+#
+# Only the codepoints in --ranges are kept, looked up through a sparse index of runs of consecutive codepoints, and each character
+# is stored with its blank top and bottom rows dropped and repeated rows run length encoded, so fonts with Latin extended and
+# Cyrillic characters don't need a dense table.  Characters can be up to 8 pixels wide and 32 rows high.
+#
+#   python3 smfont.py --ranges 0x20-0x7e,0xa0-0x17f,0x400-0x45f 6x10.bdf font6x10.smf
+#   python3 smfont.py --ranges 0x20-0x7e,0x400-0x45f --header font6x10 6x10.bdf font6x10.h
+#
+# The .smf file can be written to flash (e.g. in an asset pack made with smassets.py) or read from SD into a 4-byte aligned buffer.
+# With --header the output is a C header with a PROGMEM array, which stays in flash and is read in place.
+
+import argparse
+import struct
+import sys
+
+HAS_WIDTHS = 0x01
+MAX_WIDTH = 8
+MAX_HEIGHT = 32
+
+
+def parse_ranges(text):
+    codepoints = set()
+    for part in text.split(','):
+        first, _, last = part.partition('-')
+        first = int(first, 0)
+        last = int(last, 0) if last else first
+        codepoints.update(range(first, last + 1))
+    return codepoints
+
+
+def load_bdf(path):
+    glyphs = {}
+    ascent = descent = None
+    bounding_box = None
+    glyph = None
+    bitmap = None
+    with open(path) as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            keyword = words[0]
+            if bitmap is not None:
+                if keyword == 'ENDCHAR':
+                    glyph['bitmap'] = bitmap
+                    if glyph.get('encoding', -1) >= 0:
+                        glyphs[glyph['encoding']] = glyph
+                    glyph = bitmap = None
+                else:
+                    bitmap.append((int(keyword, 16), 4 * len(keyword)))
+            elif keyword == 'FONTBOUNDINGBOX':
+                bounding_box = [int(w) for w in words[1:5]]
+            elif keyword == 'FONT_ASCENT':
+                ascent = int(words[1])
+            elif keyword == 'FONT_DESCENT':
+                descent = int(words[1])
+            elif keyword == 'STARTCHAR':
+                glyph = {}
+            elif keyword == 'ENCODING' and glyph is not None:
+                glyph['encoding'] = int(words[1])
+            elif keyword == 'DWIDTH' and glyph is not None:
+                glyph['dwidth'] = int(words[1])
+            elif keyword == 'BBX' and glyph is not None:
+                glyph['bbx'] = [int(w) for w in words[1:5]]
+            elif keyword == 'BITMAP' and glyph is not None:
+                bitmap = []
+    if bounding_box is None:
+        raise ValueError('no FONTBOUNDINGBOX in ' + path)
+    if ascent is None or descent is None:
+        ascent = bounding_box[1] + bounding_box[3]
+        descent = -bounding_box[3]
+    return glyphs, ascent, descent, bounding_box
+
+
+# rows of the character cell, MSB is the leftmost pixel
+def glyph_rows(glyph, ascent, height, bounding_box):
+    width, rows, x_offset, y_offset = glyph['bbx']
+    left = x_offset - bounding_box[2]
+    top = ascent - (y_offset + rows)
+    cell = [0] * height
+    for y, (bits, num_bits) in enumerate(glyph['bitmap']):
+        if 0 <= top + y < height:
+            for x in range(min(width, num_bits)):
+                if bits & (1 << (num_bits - 1 - x)) and 0 <= left + x < MAX_WIDTH:
+                    cell[top + y] |= 0x80 >> (left + x)
+    return cell
+
+
+# first row with pixels, number of rows with pixels, then a bit stream: 1 repeats the previous row, 0 is followed by width pixels
+def pack_glyph(rows, width):
+    used = [y for y, row in enumerate(rows) if row]
+    if not used:
+        return bytes([0, 0])
+    first, last = used[0], used[-1]
+    bits = []
+    previous = 0
+    for row in rows[first:last + 1]:
+        if row == previous:
+            bits.append(1)
+        else:
+            bits.append(0)
+            bits.extend((row >> (7 - x)) & 1 for x in range(width))
+        previous = row
+    data = bytearray([first, last - first + 1])
+    for i in range(0, len(bits), 8):
+        chunk = bits[i:i + 8]
+        data.append(sum(bit << (7 - n) for n, bit in enumerate(chunk)))
+    return bytes(data)
+
+
+def build_font(glyphs, ascent, descent, bounding_box, codepoints, width, proportional):
+    height = ascent + descent
+    if height > MAX_HEIGHT:
+        raise ValueError('font is %d rows high, at most %d are supported' % (height, MAX_HEIGHT))
+    selected = sorted(c for c in codepoints if c in glyphs)
+
+    ranges = []
+    for index, codepoint in enumerate(selected):
+        if ranges and ranges[-1][0] + ranges[-1][1] == codepoint and ranges[-1][1] < 0xFFFF:
+            ranges[-1][1] += 1
+        else:
+            ranges.append([codepoint, 1, index])
+
+    # identical characters share their packed data
+    offsets = []
+    widths = bytearray()
+    bitmap = bytearray()
+    packed_offsets = {}
+    for codepoint in selected:
+        packed = pack_glyph(glyph_rows(glyphs[codepoint], ascent, height, bounding_box), width)
+        if packed not in packed_offsets:
+            packed_offsets[packed] = len(bitmap)
+            bitmap += packed
+        offsets.append(packed_offsets[packed])
+        widths.append(min(glyphs[codepoint].get('dwidth', width), 255))
+    if offsets and max(offsets) > 0xFFFF:
+        raise ValueError('packed characters are larger than 64KB, use fewer --ranges')
+
+    # the loader checks every character has room for its longest possible bit stream
+    longest = 2 + (height * (width + 1) + 7) // 8
+    if offsets:
+        bitmap += bytes(max(0, max(offsets) + longest - len(bitmap)))
+
+    flags = HAS_WIDTHS if proportional else 0
+    data = b'SMF1' + struct.pack('<BBBBHHI', width, height, flags, 0, len(ranges), len(selected), len(bitmap))
+    for first, count, index in ranges:
+        data += struct.pack('<IHH', first, count, index)
+    data += struct.pack('<%dH' % len(offsets), *offsets)
+    if proportional:
+        data += bytes(widths)
+    data += bytes(bitmap)
+    return data, len(selected), len(ranges), height
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a BDF font into a packed SmartMatrix font')
+    parser.add_argument('--ranges', default='0x20-0x7e', help='codepoints to keep, e.g. 0x20-0x7e,0xa0-0x17f,0x400-0x45f')
+    parser.add_argument('--width', type=int, help='character width, default: the widest character kept (up to 8)')
+    parser.add_argument('--proportional', action='store_true', help='store the width of each character')
+    parser.add_argument('--header', metavar='NAME', help='write a C header with a PROGMEM array called NAME')
+    parser.add_argument('input')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    glyphs, ascent, descent, bounding_box = load_bdf(args.input)
+    codepoints = parse_ranges(args.ranges)
+    width = args.width or max([glyphs[c].get('dwidth', 0) for c in codepoints if c in glyphs] or [0])
+    if not 0 < width <= MAX_WIDTH:
+        print('character width %d not supported, at most %d' % (width, MAX_WIDTH))
+        return 1
+
+    data, chars, num_ranges, height = build_font(glyphs, ascent, descent, bounding_box, codepoints, width, args.proportional)
+
+    if args.header:
+        with open(args.output, 'w') as f:
+            f.write('// SmartMatrix packed font, %d characters, made with smfont.py\n' % chars)
+            f.write('const uint8_t %s[%d] PROGMEM __attribute__((aligned(4))) = {\n' % (args.header, len(data)))
+            for i in range(0, len(data), 16):
+                f.write('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',\n')
+            f.write('};\n')
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(data)
+
+    print('%dx%d, %d characters in %d ranges, %d bytes (%d unpacked)' % (width, height, chars, num_ranges, len(data), chars * (height + 2)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
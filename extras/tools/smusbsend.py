@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+# SmartMatrix Library - reference sender for SMUsbFrameReceiver (MatrixUsbReceiver.h)
+#
+# Streams frames over USB serial using the raw, RLE or delta-row encodings, picking the smallest encoding for each frame with
+# --encoding auto.  Frames come from images (needs Pillow, animated GIFs are played frame by frame) or a built-in test pattern.
+#
+#   python3 smusbsend.py --port /dev/ttyACM0 --width 128 --height 64
+#   python3 smusbsend.py --port COM5 --width 64 --height 32 --fps 60 animation.gif
+#
+# Needs pyserial.  The USB serial baud rate setting is ignored by Teensy, data moves at the USB speed.
+
+import argparse
+import struct
+import sys
+import time
+
+RAW = 0
+RLE = 1
+DELTA_ROWS = 2
+END_OF_ROWS = 0xFFFF
+
+
+def header(encoding, width, height):
+    return b'SMF' + struct.pack('<BHH', encoding, width, height)
+
+
+def encode_raw(frame, width, height):
+    return header(RAW, width, height) + frame
+
+
+def encode_rle(frame, width, height):
+    out = bytearray(header(RLE, width, height))
+    pixels = [frame[i:i + 3] for i in range(0, len(frame), 3)]
+    i = 0
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:128]
+            del literal[:128]
+            out.append(len(chunk) - 1)
+            for p in chunk:
+                out.extend(p)
+
+    while i < len(pixels):
+        run = 1
+        while i + run < len(pixels) and run < 128 and pixels[i + run] == pixels[i]:
+            run += 1
+        if run >= 2:
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out += pixels[i]
+            i += run
+        else:
+            literal.append(pixels[i])
+            i += 1
+    flush_literal()
+    return bytes(out)
+
+
+def encode_delta(frame, previous, width, height):
+    out = bytearray(header(DELTA_ROWS, width, height))
+    row_bytes = width * 3
+    for y in range(height):
+        row = frame[y * row_bytes:(y + 1) * row_bytes]
+        if previous is None or row != previous[y * row_bytes:(y + 1) * row_bytes]:
+            out += struct.pack('<H', y) + row
+    out += struct.pack('<H', END_OF_ROWS)
+    return bytes(out)
+
+
+def encode(frame, previous, width, height, encoding):
+    if encoding == 'raw':
+        return encode_raw(frame, width, height)
+    if encoding == 'rle':
+        return encode_rle(frame, width, height)
+    if encoding == 'delta':
+        return encode_delta(frame, previous, width, height)
+    candidates = [encode_raw(frame, width, height), encode_rle(frame, width, height)]
+    if previous is not None:
+        candidates.append(encode_delta(frame, previous, width, height))
+    return min(candidates, key=len)
+
+
+def image_frames(paths, width, height):
+    from PIL import Image, ImageSequence
+    frames = []
+    for path in paths:
+        image = Image.open(path)
+        for frame in ImageSequence.Iterator(image):
+            frames.append(frame.convert('RGB').resize((width, height)).tobytes())
+    while True:
+        for frame in frames:
+            yield frame
+
+
+def test_pattern_frames(width, height):
+    t = 0
+    while True:
+        frame = bytearray(width * height * 3)
+        # a moving gradient in the top half, and a mostly static bottom half that delta and RLE encode well
+        for y in range(height):
+            for x in range(width):
+                i = (y * width + x) * 3
+                if y < height // 2:
+                    frame[i] = (x * 4 + t) & 0xFF
+                    frame[i + 1] = (y * 8) & 0xFF
+                    frame[i + 2] = (t * 2) & 0xFF
+                elif x == (t % width):
+                    frame[i:i + 3] = b'\xff\xff\xff'
+        yield bytes(frame)
+        t += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream frames to SMUsbFrameReceiver')
+    parser.add_argument('--port', required=True)
+    parser.add_argument('--width', type=int, required=True)
+    parser.add_argument('--height', type=int, required=True)
+    parser.add_argument('--encoding', choices=['raw', 'rle', 'delta', 'auto'], default='auto')
+    parser.add_argument('--fps', type=float, default=0, help='frame rate limit, 0 sends as fast as USB allows')
+    parser.add_argument('images', nargs='*')
+    args = parser.parse_args()
+
+    import serial
+    link = serial.Serial(args.port, 115200)
+    frames = image_frames(args.images, args.width, args.height) if args.images else test_pattern_frames(args.width, args.height)
+
+    previous = None
+    sent_frames = 0
+    sent_bytes = 0
+    raw_bytes = 0
+    stats_start = time.time()
+    next_frame = time.time()
+
+    try:
+        for frame in frames:
+            packet = encode(frame, previous, args.width, args.height, args.encoding)
+            link.write(packet)
+            previous = frame
+
+            sent_frames += 1
+            sent_bytes += len(packet)
+            raw_bytes += len(frame)
+
+            now = time.time()
+            if now - stats_start >= 1.0:
+                elapsed = now - stats_start
+                print('%.1f fps, %.2f MB/s, %.0f%% of raw' % (sent_frames / elapsed, sent_bytes / elapsed / 1e6,
+                                                             100.0 * sent_bytes / raw_bytes))
+                sent_frames = sent_bytes = raw_bytes = 0
+                stats_start = now
+
+            if args.fps:
+                next_frame += 1.0 / args.fps
+                delay = next_frame - time.time()
+                if delay > 0:
+                    time.sleep(delay)
+    except KeyboardInterrupt:
+        pass
+    link.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
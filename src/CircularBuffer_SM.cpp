@@ -7,39 +7,47 @@ modified to only contain indexes and not any data elements, and allow for peekin
 
 #include "CircularBuffer_SM.h"
 
+// on ESP32 the frame start ISR and the calc use these, keep them in IRAM so they work while the flash cache is disabled
+#if defined(ESP32)
+  #include "esp_attr.h"
+  #define CB_IRAM   IRAM_ATTR
+#else
+  #define CB_IRAM
+#endif
 
-void cbInit(CircularBuffer_SM *cb, int size) {
+
+void CB_IRAM cbInit(CircularBuffer_SM *cb, int size) {
     cb->size  = size;
     cb->start = 0;
     cb->count = 0;
 }
 
 /* below from fill count mods */
-int cbIsFull(CircularBuffer_SM *cb) {
+int CB_IRAM cbIsFull(CircularBuffer_SM *cb) {
     return cb->count == cb->size;
 }
 
-int cbIsEmpty(CircularBuffer_SM *cb) {
+int CB_IRAM cbIsEmpty(CircularBuffer_SM *cb) {
     return cb->count == 0;
 }
 
 // returns index of next free element
-int cbGetNextWrite(CircularBuffer_SM *cb) {
+int CB_IRAM cbGetNextWrite(CircularBuffer_SM *cb) {
     return (cb->start + cb->count) % cb->size;
 }
 
-void cbRead(CircularBuffer_SM *cb) {
+void CB_IRAM cbRead(CircularBuffer_SM *cb) {
     cb->start = (cb->start + 1) % cb->size;
     -- cb->count;
 }
 
-void cbWrite(CircularBuffer_SM *cb) {
+void CB_IRAM cbWrite(CircularBuffer_SM *cb) {
     if (cb->count == cb->size)
         cb->start = (cb->start + 1) % cb->size; /* full, overwrite */
     else
         ++ cb->count;
 }
 
-int cbGetNextRead(CircularBuffer_SM *cb) {
+int CB_IRAM cbGetNextRead(CircularBuffer_SM *cb) {
     return cb->start;
 }
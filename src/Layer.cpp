@@ -21,7 +21,67 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <Arduino.h>
+#include <assert.h>
+#include <stdlib.h>
 #include "Layer.h"
+#include "MatrixMemoryPlanner.h"
+
+static struct {
+    color_chan_t * table;
+    uint8_t brightness;
+    uint8_t gain;
+    uint8_t users;
+} sharedLUTs[SM_SHARED_LUT_MAX_TABLES];
+
+const color_chan_t * smAcquireShared12BitLUT(uint8_t backgroundBrightness, uint8_t channelGain) {
+    if(backgroundBrightness == 255 && channelGain == 255)
+        return lightPowerMap12to16bit;
+
+    int freeSlot = -1;
+    for(int i=0; i<SM_SHARED_LUT_MAX_TABLES; i++) {
+        if(!sharedLUTs[i].users) {
+            if(freeSlot < 0)
+                freeSlot = i;
+            continue;
+        }
+        if(sharedLUTs[i].brightness == backgroundBrightness && sharedLUTs[i].gain == channelGain) {
+            sharedLUTs[i].users++;
+            return sharedLUTs[i].table;
+        }
+    }
+
+    color_chan_t * table = (color_chan_t *)malloc(sizeof(color_chan_t) * 4096);
+    assert(table != NULL);
+    smRecordAllocation(smMemoryLUTs, table, sizeof(color_chan_t) * 4096);
+    calculate12BitBackgroundLUT(table, backgroundBrightness, channelGain);
+
+    // more distinct brightness/gain combinations in use than SM_SHARED_LUT_MAX_TABLES: the table isn't tracked, and is freed on release
+    if(freeSlot < 0)
+        return table;
+
+    sharedLUTs[freeSlot].table = table;
+    sharedLUTs[freeSlot].brightness = backgroundBrightness;
+    sharedLUTs[freeSlot].gain = channelGain;
+    sharedLUTs[freeSlot].users = 1;
+    return table;
+}
+
+void smReleaseShared12BitLUT(const color_chan_t * lut) {
+    for(int i=0; i<SM_SHARED_LUT_MAX_TABLES; i++) {
+        if(sharedLUTs[i].users && sharedLUTs[i].table == lut) {
+            if(!--sharedLUTs[i].users) {
+                free(sharedLUTs[i].table);
+                sharedLUTs[i].table = NULL;
+            }
+            return;
+        }
+    }
+
+    // a private table from smAcquireShared12BitLUT()
+    if(lut != lightPowerMap12to16bit)
+        free((void *)lut);
+}
 
 void SM_Layer::setRotation(rotationDegrees newrotation) {
     layerRotation = newrotation;
@@ -39,10 +99,234 @@ void SM_Layer::setRefreshRate(uint8_t newRefreshRate) {
     refreshRate = newRefreshRate;
 }
 
-int SM_Layer::getRequestedBrightnessShifts() {
+int SM_FLASH_SAFE_IRAM SM_Layer::getRequestedBrightnessShifts() {
     return 0;
 }
 
-bool SM_Layer::isLayerChanged() {
+bool SM_FLASH_SAFE_IRAM SM_Layer::isLayerChanged() {
+    return true;
+}
+
+bool SM_FLASH_SAFE_IRAM SM_Layer::isLayerOpaque() {
+    return false;
+}
+
+void SM_FLASH_SAFE_IRAM SM_Layer::prefetchRefreshRow(uint16_t hardwareY) {
+}
+
+bool SM_FLASH_SAFE_IRAM SM_Layer::getChangedRows(uint16_t &firstRow, uint16_t &lastRow) {
+    if (changedRowsFirst > changedRowsLast)
+        return false;
+
+    firstRow = changedRowsFirst;
+    lastRow = (changedRowsLast < matrixHeight) ? changedRowsLast : matrixHeight - 1;
+    return true;
+}
+
+void SM_FLASH_SAFE_IRAM SM_Layer::clearChangedRows(void) {
+    changedRowsFirst = 0xFFFF;
+    changedRowsLast = 0;
+
+    if (blendModeChanged) {
+        blendModeChanged = false;
+        markAllRowsChanged();
+    }
+}
+
+// add hardware rows to the changed range, clipped to the hardware height
+void SM_FLASH_SAFE_IRAM SM_Layer::markRowsChanged(int firstRow, int lastRow) {
+    if (firstRow < 0)
+        firstRow = 0;
+    if (lastRow >= matrixHeight)
+        lastRow = matrixHeight - 1;
+    if (firstRow > lastRow)
+        return;
+
+    if (firstRow < changedRowsFirst)
+        changedRowsFirst = firstRow;
+    if (lastRow > changedRowsLast)
+        changedRowsLast = lastRow;
+}
+
+void SM_FLASH_SAFE_IRAM SM_Layer::markAllRowsChanged(void) {
+    changedRowsFirst = 0;
+    changedRowsLast = matrixHeight - 1;
+}
+
+void SM_FLASH_SAFE_IRAM SM_Layer::setCoveredRows(int firstRow, int lastRow) {
+    coveredRowsFirst = std::max(firstRow, 0);
+    coveredRowsLast = std::min(lastRow, matrixHeight - 1);
+}
+
+void SM_FLASH_SAFE_IRAM SM_Layer::setCoveredLocalRows(int firstLocalRow, int lastLocalRow) {
+    if (firstLocalRow > lastLocalRow)
+        setCoveredRows(0x7FFF, -1);
+    else if (layerRotation == rotation0)
+        setCoveredRows(firstLocalRow, lastLocalRow);
+    else if (layerRotation == rotation180)
+        setCoveredRows((matrixHeight - 1) - lastLocalRow, (matrixHeight - 1) - firstLocalRow);
+    else
+        setCoveredRows(0, matrixHeight - 1);
+}
+
+// add rows in local (rotated) coordinates to the changed range, with rotation90/270 a local row covers every hardware row
+void SM_FLASH_SAFE_IRAM SM_Layer::markLocalRowsChanged(int firstLocalRow, int lastLocalRow) {
+    if (firstLocalRow > lastLocalRow)
+        return;
+
+    if (layerRotation == rotation0)
+        markRowsChanged(firstLocalRow, lastLocalRow);
+    else if (layerRotation == rotation180)
+        markRowsChanged((matrixHeight - 1) - lastLocalRow, (matrixHeight - 1) - firstLocalRow);
+    else
+        markAllRowsChanged();
+}
+
+void smLayerChain::beginEdit(void) {
+    editSequence++;
+    __sync_synchronize();
+}
+
+void smLayerChain::endEdit(void) {
+    __sync_synchronize();
+    editSequence++;
+}
+
+bool smLayerChain::contains(const SM_Layer * layer) const {
+    for (SM_Layer * templayer = head; templayer; templayer = templayer->chainNextLayer) {
+        if (templayer == layer)
+            return true;
+    }
+    return false;
+}
+
+// every store leaves a list a concurrent publish can walk
+void smLayerChain::unlink(SM_Layer * layer) {
+    if (head == layer) {
+        head = layer->chainNextLayer;
+        return;
+    }
+    for (SM_Layer * templayer = head; templayer; templayer = templayer->chainNextLayer) {
+        if (templayer->chainNextLayer == layer) {
+            templayer->chainNextLayer = layer->chainNextLayer;
+            return;
+        }
+    }
+}
+
+void smLayerChain::begin(void) {
+    for (SM_Layer * templayer = head; templayer; templayer = templayer->chainNextLayer) {
+        if (!templayer->chainStarted) {
+            templayer->begin();
+            templayer->chainStarted = true;
+        }
+    }
+    started = true;
+}
+
+void smLayerChain::add(SM_Layer * layer, rotationDegrees rotation) {
+    if (!layer || contains(layer))
+        return;
+
+    if (started) {
+        if (!layer->chainStarted) {
+            layer->begin();
+            layer->chainStarted = true;
+        }
+        layer->setRotation(rotation);
+    }
+
+    beginEdit();
+    layer->chainNextLayer = NULL;
+    if (!head) {
+        head = layer;
+    } else {
+        SM_Layer * templayer = head;
+        while (templayer->chainNextLayer)
+            templayer = templayer->chainNextLayer;
+        templayer->chainNextLayer = layer;
+    }
+    endEdit();
+}
+
+void smLayerChain::remove(SM_Layer * layer) {
+    if (!layer || !contains(layer))
+        return;
+
+    beginEdit();
+    unlink(layer);
+    endEdit();
+
+    // publish() only exchanges the whole list, so a compare and swap push can't lose a layer
+    SM_Layer * oldHead;
+    do {
+        oldHead = removedHead;
+        layer->chainRemovedNext = oldHead;
+    } while (!__atomic_compare_exchange_n(&removedHead, &oldHead, layer, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void smLayerChain::move(SM_Layer * layer, SM_Layer * belowLayer) {
+    if (!layer || layer == belowLayer || !contains(layer) || (belowLayer && !contains(belowLayer)))
+        return;
+
+    beginEdit();
+    unlink(layer);
+    if (belowLayer) {
+        layer->chainNextLayer = belowLayer->chainNextLayer;
+        belowLayer->chainNextLayer = layer;
+    } else {
+        layer->chainNextLayer = head;
+        head = layer;
+    }
+    endEdit();
+}
+
+void smLayerChain::setVisible(SM_Layer * layer, bool visible) {
+    if (!layer || layer->chainVisible == visible)
+        return;
+
+    beginEdit();
+    layer->chainVisible = visible;
+    endEdit();
+}
+
+bool SM_FLASH_SAFE_IRAM smLayerChain::publish(SM_Layer * & baseLayer) {
+    // layers the calc no longer refreshes take their pending swaps here, or a swapBuffers() waiting for one would never return
+    SM_Layer * removed = __atomic_exchange_n(&removedHead, (SM_Layer *)NULL, __ATOMIC_ACQUIRE);
+    while (removed) {
+        SM_Layer * next = removed->chainRemovedNext;
+        if (removed->chainStarted)
+            removed->frameRefreshCallback();
+        removed = next;
+    }
+    int walked = 0;
+    for (SM_Layer * templayer = head; templayer && walked < SM_LAYER_CHAIN_MAX_LAYERS; templayer = templayer->chainNextLayer, walked++) {
+        if (!templayer->chainVisible && templayer->chainStarted)
+            templayer->frameRefreshCallback();
+    }
+
+    uint32_t sequence = editSequence;
+    if (sequence == publishedSequence || (sequence & 1))
+        return false;
+    __sync_synchronize();
+
+    // a layer already linked by this publish is skipped, so even a walk that overlaps a move can't link a loop
+    publishCount++;
+    SM_Layer * first = NULL;
+    SM_Layer ** link = &first;
+    int count = 0;
+    for (SM_Layer * templayer = head; templayer && count < SM_LAYER_CHAIN_MAX_LAYERS; templayer = templayer->chainNextLayer, count++) {
+        if (!templayer->chainVisible || templayer->chainPublishStamp == publishCount)
+            continue;
+        templayer->chainPublishStamp = publishCount;
+        *link = templayer;
+        link = &templayer->nextLayer;
+    }
+    *link = NULL;
+    baseLayer = first;
+
+    __sync_synchronize();
+    if (editSequence == sequence)
+        publishedSequence = sequence;
     return true;
 }
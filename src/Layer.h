@@ -26,6 +26,55 @@
 
 #include "MatrixCommon.h"
 
+// mapping between local (rotated) and hardware coordinates for one rotation, the rotation is a template parameter so each
+// instantiation compiles to fixed add/subtract arithmetic; layers pick the instantiation for their rotation once in setRotation()
+template <rotationDegrees rotation>
+struct SMRotationPolicy {
+    static inline void localToHardware(int16_t x, int16_t y, uint16_t matrixWidth, uint16_t matrixHeight, int16_t &hwx, int16_t &hwy) {
+        if (rotation == rotation0) {
+            hwx = x;
+            hwy = y;
+        } else if (rotation == rotation180) {
+            hwx = (matrixWidth - 1) - x;
+            hwy = (matrixHeight - 1) - y;
+        } else if (rotation == rotation90) {
+            hwx = (matrixWidth - 1) - y;
+            hwy = x;
+        } else { /* if (rotation == rotation270)*/
+            hwx = y;
+            hwy = (matrixHeight - 1) - x;
+        }
+    }
+
+    static inline void hardwareToLocal(int16_t hwx, int16_t hwy, uint16_t matrixWidth, uint16_t matrixHeight, int16_t &x, int16_t &y) {
+        if (rotation == rotation0) {
+            x = hwx;
+            y = hwy;
+        } else if (rotation == rotation180) {
+            x = (matrixWidth - 1) - hwx;
+            y = (matrixHeight - 1) - hwy;
+        } else if (rotation == rotation90) {
+            x = hwy;
+            y = (matrixWidth - 1) - hwx;
+        } else { /* if (rotation == rotation270)*/
+            x = (matrixHeight - 1) - hwy;
+            y = hwx;
+        }
+    }
+};
+
+typedef void (*smCoordinateMapFunction)(int16_t, int16_t, uint16_t, uint16_t, int16_t &, int16_t &);
+
+// calls the member function template function<rotation> instantiated for the layer's current rotation, so loops inside it map
+// each pixel with fixed arithmetic instead of testing the rotation or calling through a pointer per pixel
+#define SM_CALL_FOR_LAYER_ROTATION(function, ...) \
+    switch (this->layerRotation) { \
+        case rotation180: function<rotation180>(__VA_ARGS__); break; \
+        case rotation90: function<rotation90>(__VA_ARGS__); break; \
+        case rotation270: function<rotation270>(__VA_ARGS__); break; \
+        default: function<rotation0>(__VA_ARGS__); break; \
+    }
+
 class SM_Layer {
     public:
         virtual void begin() = 0;
@@ -44,11 +93,55 @@ class SM_Layer {
         virtual void setRefreshRate(uint8_t newRefreshRate);
         virtual int getRequestedBrightnessShifts();
         virtual bool isLayerChanged();
+        // true if fillRefreshRow() overwrites every pixel in refreshRow on every row, so the row doesn't need to be cleared before filling
+        virtual bool isLayerOpaque();
+        // range of hardware rows that changed in the last frameRefreshCallback(), returns false if no rows changed
+        // layers that don't track changes report every row as changed
+        virtual bool getChangedRows(uint16_t &firstRow, uint16_t &lastRow);
+        // hint from the calc that fillRefreshRow() will soon be called for hardwareY, layers with slow source memory can stage the row early
+        virtual void prefetchRefreshRow(uint16_t hardwareY);
+
+        // how fillRefreshRow() combines the layer with the layers below it, smBlendReplace (the default) draws over them
+        // only SMLayerBackground and SMLayerRGBA use the other modes, takes effect at the next frame
+        void setBlendMode(smBlendMode mode) { blendMode = mode; blendModeChanged = true; };
+        smBlendMode getBlendMode(void) const { return blendMode; };
+
+        // false if fillRefreshRow() would leave hardwareY untouched, from the range the layer set in its last frameRefreshCallback()
+        bool isRowCovered(uint16_t hardwareY) const { return (int)hardwareY >= coveredRowsFirst && (int)hardwareY <= coveredRowsLast; };
+        // used by the calc instead of fillRefreshRow(), so rows a layer doesn't cover cost a compare instead of a virtual call
+        template <typename RGB_OUT>
+        void fillCoveredRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts = 0) {
+            if(isRowCovered(hardwareY))
+                fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+        };
+
+        // micros() when swapBuffers() was called and when frameRefreshCallback() picked up that swap, returns false if no swap was
+        // picked up since the last call.  Only recorded with SM_PROFILING_ENABLED, the calc reads it for the swap latency stats
+        bool getSwapLatencyMicros(uint32_t &requestedMicros, uint32_t &pickedUpMicros) {
+            if (!swapLatencyReady)
+                return false;
+            requestedMicros = swapLatencyRequestedMicros;
+            pickedUpMicros = swapPickedUpMicros;
+            swapLatencyReady = false;
+            return true;
+        };
 
         SM_Layer * nextLayer;
 
     protected:
         rotationDegrees layerRotation;
+
+        // set by the SM_PROFILE_SWAP_* macros in swapBuffers() and handleBufferSwap()
+        volatile uint32_t swapRequestedMicros = 0;
+        volatile uint32_t swapLatencyRequestedMicros = 0;
+        volatile uint32_t swapPickedUpMicros = 0;
+        volatile bool swapLatencyReady = false;
+        void recordSwapRequested(void) { swapRequestedMicros = micros(); };
+        void recordSwapPickedUp(void) {
+            swapLatencyRequestedMicros = swapRequestedMicros;
+            swapPickedUpMicros = micros();
+            swapLatencyReady = true;
+        };
         
         // matrixWidth/Height: the dimensions of the physical hardware, with physical row 0 column 0 always in the upper left, independent of any rotation done in software
         uint16_t matrixWidth, matrixHeight;
@@ -57,8 +150,172 @@ class SM_Layer {
         // the local dimensions of this layer with rotation applied, local x=0,y=0 in the upper left
         uint16_t localWidth, localHeight;
         uint8_t refreshRate;
+
+        volatile smBlendMode blendMode = smBlendReplace;
+        // set by setBlendMode(), the next clearChangedRows() reports every row as changed
+        volatile bool blendModeChanged = false;
+
+        // hardware rows changed in the last frameRefreshCallback(), changedRowsFirst > changedRowsLast means no rows changed
+        // the default covers all rows, so layers that never call clearChangedRows() are always treated as fully changed
+        uint16_t changedRowsFirst = 0;
+        uint16_t changedRowsLast = 0xFFFF;
+        void clearChangedRows(void);
+        void markRowsChanged(int firstRow, int lastRow);
+        void markAllRowsChanged(void);
+        void markLocalRowsChanged(int firstLocalRow, int lastLocalRow);
+
+        // hardware rows fillRefreshRow() may draw on, coveredRowsFirst > coveredRowsLast means none; the default covers every row
+        int16_t coveredRowsFirst = 0;
+        int16_t coveredRowsLast = 0x7FFF;
+        void setCoveredRows(int firstRow, int lastRow);
+        // with rotation90/270 a local row covers every hardware row
+        void setCoveredLocalRows(int firstLocalRow, int lastLocalRow);
+
+        // 1bpp helpers for fillRefreshRow(): write color into refreshRow only where bits are set (clear, with invert), leaving other pixels alone
+        // fillSpansFrom1bppRow reads bits [firstBit, firstBit + numBits) of an MSB first row 32 bits at a time, skipping empty runs, into
+        // refreshRow[0..numBits) or when reversed into refreshRow[numBits-1..0]
+        template <typename RGB_OUT>
+        static void fillSpansFrom1bppRow(const uint8_t * rowBits, int firstBit, int numBits, bool invert, bool reversed, const RGB_OUT & color, RGB_OUT refreshRow[]);
+        // for rotation 90/270, where a refresh row is a column of the bitmap: refreshRow[i] comes from bit x of row (firstRow + i * rowStep)
+        template <typename RGB_OUT>
+        static void fillPixelsFrom1bppColumn(const uint8_t * bitmap, int rowSize, int x, int firstRow, int rowStep, int numPixels, const RGB_OUT & color, RGB_OUT refreshRow[]);
+
+        // fills refreshRow from a local 1bpp bitmap of localWidth x localHeight, applying layerRotation with a once per row setup
+        template <typename RGB_OUT>
+        void fillRefreshRowFrom1bppBitmap(const uint8_t * bitmap, uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]) const;
         
     private:
+        // the calc's list of layers, see smLayerChain
+        friend class smLayerChain;
+        SM_Layer * chainNextLayer = NULL;
+        bool chainVisible = true;
+        bool chainStarted = false;
+        uint32_t chainPublishStamp = 0;
+        SM_Layer * chainRemovedNext = NULL;
 };
 
+#ifndef SM_LAYER_CHAIN_MAX_LAYERS
+#define SM_LAYER_CHAIN_MAX_LAYERS       32
+#endif
+
+// the layers added to a calc, bottom layer first: the sketch edits this list and the calc publishes its visible layers to the
+// baseLayer/nextLayer chain it refreshes from at the start of a frame, so refresh never walks a chain that's being changed and
+// hidden layers aren't filled.  Edits are bracketed by a sequence number that's odd during an edit, without locks: a publish
+// that overlaps an edit links a chain of valid layers without repeats, and is published again at the next frame
+class smLayerChain {
+    public:
+        // starts every layer added so far
+        void begin(void);
+        // layers added after begin() are started and set to rotation by add(), so they can be drawn to before the next frame
+        void add(SM_Layer * layer, rotationDegrees rotation);
+        // a removed layer may be refreshed until the next frame starts, wait for a frame (e.g. waitForFrame()) before reusing its memory
+        // it gets one more frameRefreshCallback() at that frame, so a swap that was pending when it was removed completes
+        void remove(SM_Layer * layer);
+        // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+        void move(SM_Layer * layer, SM_Layer * belowLayer);
+        // hidden layers keep their place and still get frameRefreshCallback() each frame, so swaps complete, but aren't filled or checked for changes
+        void setVisible(SM_Layer * layer, bool visible);
+        bool isVisible(const SM_Layer * layer) const { return layer->chainVisible; };
+
+        // called by the calc at the start of a frame, returns true if baseLayer's chain was relinked
+        // also calls frameRefreshCallback() for hidden layers, and layers removed since the last frame, as they aren't in baseLayer's chain
+        bool publish(SM_Layer * & baseLayer);
+
+    private:
+        SM_Layer * head = NULL;
+        // pushed by remove(), taken by publish()
+        SM_Layer * volatile removedHead = NULL;
+        bool started = false;
+        volatile uint32_t editSequence = 0;
+        uint32_t publishedSequence = 0;
+        uint32_t publishCount = 0;
+
+        void beginEdit(void);
+        void endEdit(void);
+        bool contains(const SM_Layer * layer) const;
+        void unlink(SM_Layer * layer);
+};
+
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SM_Layer::fillSpansFrom1bppRow(const uint8_t * rowBits, int firstBit, int numBits, bool invert, bool reversed, const RGB_OUT & color, RGB_OUT refreshRow[]) {
+    int bit = 0;
+    while(bit < numBits) {
+        int srcBit = firstBit + bit;
+        const uint8_t * ptr = rowBits + (srcBit / 8);
+        int shift = srcBit % 8;
+
+        // only read the bytes holding the next (up to) 32 bits, so a partial word never reads past the end of the row
+        int validBits = (numBits - bit < 32 - shift) ? (numBits - bit) : (32 - shift);
+        int numBytes = (shift + validBits + 7) / 8;
+        uint32_t word = 0;
+        for(int b=0; b<4; b++) {
+            word <<= 8;
+            if(b < numBytes)
+                word |= ptr[b];
+        }
+        if(invert)
+            word = ~word;
+        word <<= shift;
+        if(validBits < 32)
+            word &= ~(0xFFFFFFFFUL >> validBits);
+
+        int pos = 0;
+        while(word) {
+            int skip = __builtin_clz(word);
+            word <<= skip;
+            pos += skip;
+
+            int run = (~word) ? __builtin_clz(~word) : (32 - pos);
+            int x = bit + pos;
+            if(reversed) {
+                for(int i=0; i<run; i++)
+                    refreshRow[numBits - 1 - (x + i)] = color;
+            } else {
+                for(int i=0; i<run; i++)
+                    refreshRow[x + i] = color;
+            }
+
+            word = (run < 32) ? (word << run) : 0;
+            pos += run;
+        }
+
+        bit += validBits;
+    }
+}
+
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SM_Layer::fillPixelsFrom1bppColumn(const uint8_t * bitmap, int rowSize, int x, int firstRow, int rowStep, int numPixels, const RGB_OUT & color, RGB_OUT refreshRow[]) {
+    const uint8_t * ptr = bitmap + (firstRow * rowSize) + (x / 8);
+    const uint8_t bitmask = 0x80 >> (x % 8);
+    const int ptrStep = rowStep * rowSize;
+
+    for(int i=0; i<numPixels; i++) {
+        if(*ptr & bitmask)
+            refreshRow[i] = color;
+        ptr += ptrStep;
+    }
+}
+
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SM_Layer::fillRefreshRowFrom1bppBitmap(const uint8_t * bitmap, uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]) const {
+    const int rowSize = localWidth / 8;
+
+    switch(layerRotation) {
+      case rotation0 :
+        fillSpansFrom1bppRow(bitmap + (hardwareY * rowSize), 0, matrixWidth, false, false, color, refreshRow);
+        break;
+      case rotation180 :
+        fillSpansFrom1bppRow(bitmap + (((matrixHeight - 1) - hardwareY) * rowSize), 0, matrixWidth, false, true, color, refreshRow);
+        break;
+      case rotation90 :
+        fillPixelsFrom1bppColumn(bitmap, rowSize, hardwareY, matrixWidth - 1, -1, matrixWidth, color, refreshRow);
+        break;
+      case rotation270 :
+        fillPixelsFrom1bppColumn(bitmap, rowSize, (matrixHeight - 1) - hardwareY, 0, 1, matrixWidth, color, refreshRow);
+        break;
+      default:
+        break;
+    }
+}
+
 #endif
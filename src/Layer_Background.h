@@ -29,11 +29,69 @@
 #include "MatrixFontCommon.h"
 
 #define SM_BACKGROUND_OPTIONS_NONE     0
+// keep a separate color correction table per channel so setWhiteBalance() can be used, the LUT buffer passed in needs to be 3x the size
+#define SM_BACKGROUND_OPTIONS_WHITE_BALANCE    (1 << 0)
+// use a third buffer so swapBuffers() never waits for refresh, the buffer passed in needs to hold 3 frames
+#define SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER     (1 << 1)
+// ESP32 and Teensy 4: keep a small ring of refresh rows in internal RAM, filled ahead of fillRefreshRow() by the calc, for buffers in PSRAM
+// on Teensy 4 the rows are copied by eDMA into a buffer passed to the constructor (in DTCM), while the calc packs the current row
+#define SM_BACKGROUND_OPTIONS_ROW_CACHE         (1 << 2)
+// rgb48 layers: share one color correction table between layers at the same brightness (and white balance gain) instead of one per layer
+// at full brightness the const lightPowerMap12to16bit table is used directly, see smAcquireShared12BitLUT()
+#define SM_BACKGROUND_OPTIONS_SHARED_LUT        (1 << 3)
+
+// flag in sharedLUTState, see SMLayerBackground
+#define SM_SHARED_LUT_SET_PENDING               (1 << 1)
+
+#ifndef SM_BACKGROUND_ROW_CACHE_ROWS
+#define SM_BACKGROUND_ROW_CACHE_ROWS            8
+#endif
+
+// Teensy 4: eDMA channels a row cache layer copies rows with, the calc only waits for a copy when more rows than this are in flight
+#ifndef SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS
+#define SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS    4
+#endif
+
+// number of color_chan_t entries to allocate for the LUT buffer passed to the constructor, layers using shared tables don't need one
+#define SM_BACKGROUND_LUT_BUFFER_SIZE(RGB, options)     ((((options) & SM_BACKGROUND_OPTIONS_SHARED_LUT) && sizeof(RGB) > 3) ? 1 : \
+                                                        SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, (options) & SM_BACKGROUND_OPTIONS_WHITE_BALANCE))
+
+// number of RGB values to allocate for the row cache buffer passed to the constructor
+#define SM_BACKGROUND_ROW_CACHE_SIZE(options, width)    (((options) & SM_BACKGROUND_OPTIONS_ROW_CACHE) ? SM_BACKGROUND_ROW_CACHE_ROWS * (width) : 1)
+
+#if defined(__IMXRT1062__)
+#include "DMAChannel.h"
+#endif
+
+// source pixel formats for drawBitmap()
+typedef enum smBitmapFormat {
+    SM_BITMAP_FORMAT_RGB24,     // 3 bytes per pixel: red, green, blue
+    SM_BITMAP_FORMAT_RGB565,    // 16-bit rgb16 per pixel, rows must start on a 2-byte boundary
+    SM_BITMAP_FORMAT_RGB332,    // 8-bit rgb8 per pixel
+    SM_BITMAP_FORMAT_INDEXED8,  // 8-bit index per pixel into an rgb24 palette
+} smBitmapFormat;
+
+// resampling for drawBitmapScaled()
+typedef enum smScaleMode {
+    SM_SCALE_NEAREST,           // each pixel copies the closest source pixel
+    SM_SCALE_BILINEAR,          // each pixel blends the four closest source pixels
+} smScaleMode;
+
+// largest radius for blurBox() and blurGaussian(), the box blur keeps radius + 1 pixels on the stack
+#ifndef SM_BLUR_MAX_RADIUS
+#define SM_BLUR_MAX_RADIUS              8
+#endif
+
+// drawBitmapScaled() builds its source column tables this many columns at a time, on the stack
+#define SM_SCALED_BITMAP_CHUNK_COLUMNS  64
+
+#define SM_BACKGROUND_NUM_BUFFERS(options)      (((options) & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) ? 3 : 2)
+#define SM_BACKGROUND_SPARE_BUFFER_READY        0x80
 
 template <typename RGB, unsigned int optionFlags>
 class SMLayerBackground : public SM_Layer {
     public:
-        SMLayerBackground(RGB * buffer, uint16_t width, uint16_t height, color_chan_t * colorCorrectionLUT);
+        SMLayerBackground(RGB * buffer, uint16_t width, uint16_t height, color_chan_t * colorCorrectionLUT, RGB * rowCacheBuffer = NULL);
         SMLayerBackground(uint16_t width, uint16_t height);
         void begin(void);
         void frameRefreshCallback();
@@ -41,12 +99,28 @@ class SMLayerBackground : public SM_Layer {
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
         int getRequestedBrightnessShifts();
         bool isLayerChanged();
+        bool isLayerOpaque();
+        void prefetchRefreshRow(uint16_t hardwareY);
+        void setRotation(rotationDegrees newrotation);
         
         void swapBuffers(bool copy = true);
         bool isSwapPending();
         void copyRefreshToDrawing(void);
         void setBrightnessShifts(int numShifts);
 
+        // scroll the displayed image without redrawing it: screen pixel x, y shows drawing buffer pixel x + offsetX, y + offsetY, wrapping at the edges
+        // the offset is part of the drawn frame and shows up with the next swapBuffers(), together with any newly exposed pixels drawn before it
+        void setViewportOffset(int16_t offsetX, int16_t offsetY);
+        // after each swapBuffers(), refresh blends from the previous frame to the new one over numFrames refresh frames (0 = off)
+        // the previous frame must stay unchanged until the fade finishes, so swapBuffers() waits for it before handing back that buffer
+        void setCrossfadeFrames(uint8_t numFrames);
+
+        // region drawn since the last swapBuffers() in screen coordinates, swapBuffers(true) only copies this region to the new drawing buffer
+        // returns false if nothing was drawn, the whole screen is returned if the drawing buffer can't be tracked (raw buffer access, or swap without copy)
+        bool getDirtyRegion(int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1);
+        // add a region to the dirty region, e.g. after changing pixels without using the drawing functions
+        void markRegionDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+
         void drawPixel(int16_t x, int16_t y, const RGB& color);
         void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
         void drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color);
@@ -67,10 +141,52 @@ class SMLayerBackground : public SM_Layer {
         void fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius,
             const RGB& outlineColor, const RGB& fillColor);
         void fillScreen(const RGB& color);
+        // starts filling the drawing buffer with color in the background (eDMA on Teensy 4, other platforms finish the fill before returning)
+        // don't draw until isFillComplete() returns true, swapBuffers() waits for the fill to finish
+        void fillScreenAsync(const RGB& color);
+        bool isFillComplete(void);
         void drawChar(int16_t x, int16_t y, const RGB& charColor, char character);
+        // drawString() takes UTF-8, drawCodepoint() draws one Unicode character
+        void drawCodepoint(int16_t x, int16_t y, const RGB& charColor, uint32_t codepoint);
         void drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]);
         void drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]);
         void drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, const RGB& bitmapColor, const uint8_t *bitmap);
+        // copies a width x height image to x, y, clipped to the layer; stride is the bytes per source row (0 = width pixels)
+        // rows are copied with memcpy when the source format matches the layer and the layer isn't rotated by 90/270, otherwise converted
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, smBitmapFormat format, uint16_t stride = 0, const rgb24 *palette = NULL);
+        // draws a srcWidth x srcHeight image scaled to fill width x height at x, y, clipped to the layer, stride as with drawBitmap()
+        // rows that sample the same source row as the row before are copied instead of resampled, e.g. every row of an integer upscale after the first
+        void drawBitmapScaled(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, uint16_t srcWidth, uint16_t srcHeight,
+            smBitmapFormat format, smScaleMode mode = SM_SCALE_NEAREST, uint16_t stride = 0, const rgb24 *palette = NULL);
+
+        // spectrum and level displays: numBars bars starting at x, barWidth pixels wide with barSpacing pixels between them, growing up from
+        // row baseY, heights[i] pixels high; the pixel n rows above the base is colorRamp[n] and heights are clipped to rampLength
+        // with backColor, the rest of each bar up to rampLength is filled with it, so bars can be redrawn without clearing the layer first
+        void drawBarGraph(int16_t x, int16_t baseY, uint8_t barWidth, uint8_t barSpacing, const uint8_t heights[], uint16_t numBars,
+            const RGB colorRamp[], uint16_t rampLength, const RGB *backColor = NULL);
+        // one pixel high marker at the top of each peaks[i] high bar, laid out as with drawBarGraph(), a peak of 0 draws nothing
+        void drawPeakMarkers(int16_t x, int16_t baseY, uint8_t barWidth, uint8_t barSpacing, const uint8_t peaks[], uint16_t numBars, const RGB& color);
+        // fill a rectangle with a linear gradient from the first color at y0 (or x0) to the second at y1 (or x1)
+        void fillGradientVertical(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& topColor, const RGB& bottomColor);
+        void fillGradientHorizontal(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& leftColor, const RGB& rightColor);
+        // fill ramp with length colors from startColor to endColor, e.g. the colorRamp for drawBarGraph(), computed once instead of every frame
+        static void fillColorRamp(RGB ramp[], uint16_t length, const RGB& startColor, const RGB& endColor);
+
+        // effects that change the whole drawing buffer in place, e.g. for generative sketches that work on backBuffer() every frame
+        // scale every pixel towards black: amount 0 leaves the buffer unchanged and 255 clears it, like FastLED's fadeToBlackBy()
+        void fadeToBlackBy(uint8_t amount);
+        // separable blurs with the edge pixels extended: a box of 2 * radius + 1 pixels, or [1 2 1] applied radius times, which is
+        // close to a gaussian; radius is limited to SM_BLUR_MAX_RADIUS
+        void blurBox(uint8_t radius);
+        void blurGaussian(uint8_t radius);
+        // moves the image by dx, dy pixels and fills the pixels moved in from the edges with fillColor
+        // (setViewportOffset() scrolls the displayed image with wrapping, without moving any pixels)
+        void shiftImage(int16_t dx, int16_t dy, const RGB& fillColor);
+        // adds the last frame passed to swapBuffers(), scaled by weight (0-255), to the drawing buffer with saturation: feed the previous
+        // frame back in after swapBuffers(false), instead of copying it with swapBuffers(true) and fading it.  Call it first, right
+        // after the swap: it waits until refresh has picked up the swap, before that the drawing buffer is still being refreshed
+        // (or wait for !isSwapPending() before drawing anything else)
+        void addFeedback(uint8_t weight);
 
         // reads pixel from drawing buffer, not refresh buffer
         const RGB readPixel(int16_t x, int16_t y);
@@ -81,8 +197,11 @@ class SMLayerBackground : public SM_Layer {
         RGB *getRealBackBuffer();
 
         void setFont(fontChoices newFont);
+        // e.g. a font filled by loadPackedBitmapFont(), it has to stay valid while it's used
+        void setFont(const bitmap_font *newFont);
         void setBrightness(uint8_t brightness);
         void enableColorCorrection(bool enabled);
+        void setWhiteBalance(uint8_t redGain, uint8_t greenGain, uint8_t blueGain);
 
 
         RGB getChromaKeyColor() const
@@ -93,6 +212,7 @@ class SMLayerBackground : public SM_Layer {
         void setChromaKeyColor(RGB color)
         {
             chromaKeyColor = color;
+            refreshSettingsChanged = true;
         }
 
         void enableChromaKey(bool bEnabled, int firstline = 0, int lastline = 0)
@@ -100,6 +220,7 @@ class SMLayerBackground : public SM_Layer {
             firstOverlayLine = firstline;
             lastOverlayLine  = lastline == 0 ? matrixHeight - 1 : lastline;
             bEnableChromaKey = bEnabled;
+            refreshSettingsChanged = true;
         }
 
         bool isChromaKeyEnabled() const
@@ -118,23 +239,96 @@ class SMLayerBackground : public SM_Layer {
         RGB *currentDrawBufferPtr;
         RGB *currentRefreshBufferPtr;
 
-        RGB *backgroundBuffers[2];
+        RGB *backgroundBuffers[3];
 
         RGB *getCurrentRefreshRow(uint16_t y);
 
         void loadPixelToDrawBuffer(int16_t hwx, int16_t hwy, const RGB& color);
         const RGB readPixelFromDrawBuffer(int16_t hwx, int16_t hwy);
+
+        // per pixel functions instantiated for each rotation, readPixel() uses the one picked in setRotation(), drawPixel() and the
+        // shapes below pick theirs once per call with SM_CALL_FOR_LAYER_ROTATION
+        typedef const RGB (SMLayerBackground::*readPixelFunction)(int16_t x, int16_t y);
+        template <rotationDegrees rotation> void drawPixelRotated(int16_t x, int16_t y, const RGB& color);
+        // drawPixelRotated() for coordinates that may be off the layer
+        template <rotationDegrees rotation> void drawPixelClipped(int16_t x, int16_t y, const RGB& color);
+        template <rotationDegrees rotation> const RGB readPixelRotated(int16_t x, int16_t y);
+        readPixelFunction readPixelForRotation = &SMLayerBackground::template readPixelRotated<rotation0>;
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+        smCoordinateMapFunction hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
         void getBackgroundRefreshPixel(uint16_t x, uint16_t y, RGB &refreshPixel);
         bool getForegroundRefreshPixel(uint16_t x, uint16_t y, RGB &xyPixel);
 
+        // pixel loops of the outlined shapes for one rotation, see SM_CALL_FOR_LAYER_ROTATION
+        template <rotationDegrees rotation> void drawCircleRotated(int16_t x0, int16_t y0, uint16_t radius, const RGB& color);
+        template <rotationDegrees rotation> void fillCircleRotated(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor);
+        template <rotationDegrees rotation> void drawEllipseRotated(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color);
+        template <rotationDegrees rotation> void fillRoundRectangleRotated(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& outlineColor, const RGB& fillColor);
+        template <rotationDegrees rotation> void drawRoundRectangleRotated(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& outlineColor);
+
         // drawing functions not meant for user
         void drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color);
         void drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color);
-        void bresteepline(int16_t x3, int16_t y3, int16_t x4, int16_t y4, const RGB& color);
+        // in bounds local spans, x0 <= x1 and y0 <= y1, drawn as a hardware row or a strided hardware column depending on rotation
+        void drawLocalHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color);
+        void drawLocalVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color);
+        // true if no part of the box x0-x1, y0-y1 is on the layer
+        bool isRegionOffLayer(int x0, int y0, int x1, int y1);
+        // Bresenham line from (u1, v1) to (u2, v2) with u1 <= u2 and |v2 - v1| <= u2 - u1, u is x (or y when steep), clipped to the layer
+        // in the line's steps before walking it, and drawn as runs along u
+        void drawClippedLine(int16_t u1, int16_t v1, int16_t u2, int16_t v2, bool steep, const RGB& color);
         void fillFlatSideTriangleInt(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& color);
 
+        // draw buffer index of local pixel (x, y) is origin + x * xStride + y * yStride for the current rotation
+        void getLocalToHardwareStrides(int &origin, int &xStride, int &yStride);
+        // fill numPixels pixels from ptr, xStride pixels apart
+        static void fillStridedRGB(RGB *ptr, int xStride, uint16_t numPixels, const RGB& color);
+        // blur length pixels in place, stride pixels apart (a row or a column of the drawing buffer)
+        static void blurLineBox(RGB *line, int stride, int length, int radius);
+        static void blurLineBinomial(RGB *line, int stride, int length);
+        // color position steps of length - 1 from startColor to endColor
+        static RGB interpolateRGB(const rgb48& startColor, const rgb48& endColor, uint32_t position, uint32_t length);
+        // draws a 1bpp image (MSB first, rowBytes per row, NULL for all clear) clipped to the layer, with backColor (if not NULL) for clear pixels
+        void drawMonoSpans(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *bits, uint16_t rowBytes, const RGB& color, const RGB *backColor);
+        // converts numRows source rows of SRC pixels into the draw buffer, walking it with the strides from getLocalToHardwareStrides()
+        template <typename SRC>
+        void drawBitmapRows(RGB *dstRow, int xStride, int yStride, const uint8_t *srcRow, uint16_t srcStride, uint16_t numPixels, uint16_t numRows);
+        // source pixel col of row as DST, an index into palette when palette isn't NULL (SRC is then rgb8, for its size)
+        template <typename DST, typename SRC>
+        static DST scaledBitmapPixel(const uint8_t *row, uint16_t col, const rgb24 *palette);
+        // drawBitmapScaled() for columns col0-col1 and rows row0-row1 of the scaled image, dstOrigin is pixel (col0, row0), steps are 16.16 source pixels per pixel
+        template <typename SRC>
+        void drawScaledBitmapRows(RGB *dstOrigin, int xStride, int yStride, const uint8_t *src, uint16_t srcStride, uint16_t srcWidth, uint16_t srcHeight,
+            int col0, int col1, int row0, int row1, uint32_t xStep, uint32_t yStep, smScaleMode mode, const rgb24 *palette);
+
         uint8_t backgroundBrightness = 255;
+        // brightness, chroma key and blend mode refresh uses for the whole frame, latched in frameRefreshCallback() so the sketch
+        // changing them mid frame can't make isLayerOpaque() and fillRefreshRow() disagree about a row
+        uint8_t refreshBackgroundBrightness = 255;
+        bool refreshChromaKeyEnabled = false;
+        smBlendMode refreshBlendMode = smBlendReplace;
+        bool refreshOpaque = false;
         color_chan_t * backgroundColorCorrectionLUT;
+
+        // color correction tables for red, green, blue (all pointing at backgroundColorCorrectionLUT without white balance)
+        // the tables are only rebuilt in frameRefreshCallback() when brightness, white balance, or the brightnessShifts used by refresh changes
+        const color_chan_t * channelColorCorrectionLUT[3];
+        color_chan_t * ownedChannelLUT(int channel);
+        void calculateColorCorrectionLUTs(int brightnessShifts);
+
+        // SM_BACKGROUND_OPTIONS_SHARED_LUT: the sketch acquires a new set of shared tables into the set refresh isn't using and
+        // queues it, refresh switches to it at the next frame, and the set it stopped using is released by the next update
+        // bit 0 of sharedLUTState is the set refresh uses, SM_SHARED_LUT_SET_PENDING means the other set is queued; both change in
+        // one atomic operation, so the sketch can't release a set the calc (on either ESP32 core) is switching to
+        bool isLUTShared(void) const { return (optionFlags & SM_BACKGROUND_OPTIONS_SHARED_LUT) && sizeof(RGB) > 3; }
+        const color_chan_t * sharedLUTs[2][3] = {{NULL, NULL, NULL}, {NULL, NULL, NULL}};
+        volatile uint8_t sharedLUTState = 0;
+        void updateSharedLUTs(void);
+        void switchSharedLUTs(void);
+        uint8_t whiteBalanceGain[3] = {255, 255, 255};
+        volatile bool colorCorrectionLUTChanged = true;
+        int lutBrightnessShifts = 0;
+        volatile int refreshBrightnessShifts = 0;
         bitmap_font *font;
 
         // idealBrightnessShifts is the number of shifts towards MSB the pixel data can handle without overflowing
@@ -147,6 +341,71 @@ class SMLayerBackground : public SM_Layer {
         volatile unsigned char currentRefreshBuffer;
         volatile bool swapPending;
         void handleBufferSwap(void);
+
+        // triple buffering: index of the buffer that is neither drawn to nor refreshed, with SM_BACKGROUND_SPARE_BUFFER_READY set while it holds
+        // a completed frame that refresh hasn't picked up yet; only ever changed with a single atomic exchange by either side
+        volatile uint8_t spareBuffer;
+        // the buffer last handed to refresh by swapBuffers(), read by addFeedback()
+        unsigned char lastSwappedBuffer = 1;
+
+        // changed region tracking: hardware rows and columns drawn since the last swapBuffers(), and the rows that will change when the pending swap happens
+        uint16_t drawnRowsFirst = 0xFFFF;
+        uint16_t drawnRowsLast = 0;
+        uint16_t drawnColsFirst = 0xFFFF;
+        uint16_t drawnColsLast = 0;
+        uint16_t swapRowsFirst = 0;
+        uint16_t swapRowsLast = 0xFFFF;
+        void clearDrawnRegion(void);
+        void markHardwareRegionDrawn(uint16_t hwx0, uint16_t hwy0, uint16_t hwx1, uint16_t hwy1);
+        void mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy);
+        void mapHardwareToLocal(int16_t hwx, int16_t hwy, int16_t &x, int16_t &y);
+        // viewport offset set by the sketch, the hardware offset each buffer was swapped in with, and the hardware offset used for refresh
+        int16_t viewportX = 0;
+        int16_t viewportY = 0;
+        uint16_t bufferViewport[3][2] = {{0, 0}, {0, 0}, {0, 0}};
+        uint16_t refreshViewportX = 0;
+        uint16_t refreshViewportY = 0;
+        void storeBufferViewport(unsigned char buffer);
+        void loadRefreshViewport(void);
+        void startCrossfade(void);
+        // crossfade state, fadeFromBufferPtr is the previous refresh buffer while a fade is running (NULL = no fade)
+        uint8_t crossfadeFrames = 0;
+        uint8_t fadeFramesShown = 0;
+        uint16_t fadeWeight = 0;
+        RGB * volatile fadeFromBufferPtr = NULL;
+        uint16_t fadeViewportX = 0;
+        uint16_t fadeViewportY = 0;
+        rgb48 getRefreshPixelValue(const RGB & pixel, int brightnessShifts);
+        template <typename RGB_OUT>
+        void fillRefreshRowCrossfade(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts);
+        // false if the drawing buffer may differ from the refresh buffer in rows that weren't drawn (swap without copy, or raw buffer access)
+        bool drawBufferMatchesRefresh = false;
+        // brightness, color correction, or chroma key changed, affecting every row
+        volatile bool refreshSettingsChanged = true;
+
+        // row cache (SM_BACKGROUND_OPTIONS_ROW_CACHE): copies of refresh buffer rows in internal SRAM, written only by prefetchRefreshRow() in the calc task
+        // rowCacheTags holds the hardware row in each slot (0xFFFF = empty), slots are reused oldest first, and the cache is emptied when the refresh buffer changes
+        RGB * rowCache = NULL;
+        RGB * rowCacheSource = NULL;
+        uint16_t rowCacheTags[SM_BACKGROUND_ROW_CACHE_ROWS];
+        uint8_t rowCacheNextSlot = 0;
+        void invalidateRowCache(void);
+        const RGB * getRefreshRowSource(uint16_t hardwareY);
+#if defined(__IMXRT1062__)
+        // one row copy can be in flight on each channel, used in turn, rowCachePendingSlot is the slot each one is writing to (-1 = none)
+        DMAChannel * rowCacheDMA[SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS] = {};
+        int8_t rowCachePendingSlot[SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS];
+        uint8_t rowCacheNextDMA = 0;
+        void waitForRowCacheDMA(int channel);
+        void waitForRowCacheDMA(void);
+        void waitForRowCacheSlot(int slot);
+        void flushBufferForRowCache(RGB * buffer, uint16_t firstRow = 0, uint16_t lastRow = 0xFFFF);
+
+        // fillScreenAsync(): the CPU fills the first row, then eDMA copies it down the rest of the buffer
+        DMAChannel * fillDMA = NULL;
+        bool fillPending = false;
+#endif
+        void waitForFill(void);
 };
 
 #include "Layer_Background_Impl.h"
@@ -32,6 +32,8 @@
 #include "MatrixGfxFontCommon.h"
 
 #define SM_BACKGROUND_GFX_OPTIONS_NONE     0
+// keep a separate color correction table per channel so setWhiteBalance() can be used, the LUT buffer passed in needs to be 3x the size
+#define SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE    (1 << 0)
 
 #define SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
 //#define SM_BACKGROUND_GFX_OLD_DRAWING_FUNCTIONS
@@ -76,9 +78,11 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         void setBrightnessShifts(int numShifts);
         int getRequestedBrightnessShifts();
         bool isLayerChanged();
+        bool isLayerOpaque();
         bool isSwapPending();
         void setBrightness(uint8_t brightness);
         void enableColorCorrection(bool enabled);
+        void setWhiteBalance(uint8_t redGain, uint8_t greenGain, uint8_t blueGain);
         void setRotation(rotationDegrees newrotation);
 
         /* Shared SmartMatrix Library 3.0 Backwards Compatibility */
@@ -117,9 +121,19 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         using Adafruit_GFX::fillTriangle;
         using Adafruit_GFX::setFont;
         using Adafruit_GFX::drawChar;
-        using Adafruit_GFX::fillScreen;
-        using Adafruit_GFX::drawFastVLine;
-        using Adafruit_GFX::drawFastHLine;
+        using Adafruit_GFX::drawRGBBitmap;
+
+        // native versions of the Adafruit_GFX batch hooks, so text, bitmaps, and fills don't call the virtual drawPixel() for every pixel
+        void writePixel(int16_t x, int16_t y, uint16_t color);
+        void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void fillScreen(uint16_t color);
+        void drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w, int16_t h);
+        void drawRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h);
 
     protected:
         // Note we'd use a function template for the public functions but are keeping them fixed with rgb24/rgb48 parameters for backwards compatibility
@@ -129,6 +143,10 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         // drawing functions not meant for user
         void drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color);
         void drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color);
+        // corners in local coordinates and in any order, clipped to the layer
+        void fillLocalRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        // color used for Adafruit_GFX drawing, overridden by the SmartMatrix 3.0 text functions passing an RGB color through
+        inline const RGB gfxColor(uint16_t color) { return passThruColorFlag ? passThruColor : RGB(rgb16(color)); }
 
         bool ccEnabled = true;
 
@@ -142,6 +160,14 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
 
         void loadPixelToDrawBuffer(int16_t hwx, int16_t hwy, const RGB& color);
         const RGB readPixelFromDrawBuffer(int16_t hwx, int16_t hwy);
+
+        // per pixel functions instantiated for each rotation, readPixel() uses the one picked in setRotation(), drawPixel() picks
+        // its own with SM_CALL_FOR_LAYER_ROTATION
+        typedef const RGB (SMLayerBackgroundGFX::*readPixelFunction)(int16_t x, int16_t y);
+        template <rotationDegrees rotation> void drawPixelRotated(int16_t x, int16_t y, const RGB& color);
+        template <rotationDegrees rotation> const RGB readPixelRotated(int16_t x, int16_t y);
+        readPixelFunction readPixelForRotation = &SMLayerBackgroundGFX::template readPixelRotated<rotation0>;
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
         void getBackgroundRefreshPixel(uint16_t x, uint16_t y, RGB &refreshPixel);
         bool getForegroundRefreshPixel(uint16_t x, uint16_t y, RGB &xyPixel);
 
@@ -155,6 +181,15 @@ class SMLayerBackgroundGFX : public SM_Layer, public Adafruit_GFX {
         uint8_t backgroundBrightness = 255;
         color_chan_t * backgroundColorCorrectionLUT;
 
+        // color correction tables for red, green, blue (all pointing at backgroundColorCorrectionLUT without white balance)
+        // the tables are only rebuilt in frameRefreshCallback() when brightness, white balance, or the brightnessShifts used by refresh changes
+        color_chan_t * channelColorCorrectionLUT[3];
+        void calculateColorCorrectionLUTs(int brightnessShifts);
+        uint8_t whiteBalanceGain[3] = {255, 255, 255};
+        volatile bool colorCorrectionLUTChanged = true;
+        int lutBrightnessShifts = 0;
+        volatile int refreshBrightnessShifts = 0;
+
         int16_t layerXOffset = 0;
         int16_t layerYOffset = 0;
 
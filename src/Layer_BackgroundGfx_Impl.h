@@ -66,14 +66,21 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::begin(void) {
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
         memset(backgroundBuffers[0], 0x00, sizeof(RGB) * this->matrixWidth * this->matrixHeight);
         memset(backgroundBuffers[1], 0x00, sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+        smRecordAllocation(smMemoryLayers, backgroundBuffers[0], sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+        smRecordAllocation(smMemoryLayers, backgroundBuffers[1], sizeof(RGB) * this->matrixWidth * this->matrixHeight);
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
     }
     if(!backgroundColorCorrectionLUT) {
-        backgroundColorCorrectionLUT = (color_chan_t *)malloc(sizeof(color_chan_t) * (sizeof(RGB) <= 3 ? 256 : 4096));
+        backgroundColorCorrectionLUT = (color_chan_t *)malloc(sizeof(color_chan_t) * SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, optionFlags & SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE));
         assert(backgroundColorCorrectionLUT != NULL);
+        smRecordAllocation(smMemoryLUTs, backgroundColorCorrectionLUT, sizeof(color_chan_t) * SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, optionFlags & SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE));
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
     }
 #endif
+
+    for(int i=0; i<3; i++)
+        channelColorCorrectionLUT[i] = backgroundColorCorrectionLUT + ((optionFlags & SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE) ? i * (sizeof(RGB) <= 3 ? 256 : 4096) : 0);
+    colorCorrectionLUTChanged = true;
     
     currentDrawBuffer = 0;
     currentRefreshBuffer = 1;
@@ -88,7 +95,7 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::begin(void) {
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::handleBufferSwap(void) {
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::handleBufferSwap(void) {
     if (!swapPending)
         return;
 
@@ -100,24 +107,45 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::handleBufferSwap(void) {
     currentRefreshBufferPtr = backgroundBuffers[currentRefreshBuffer];
     currentDrawBufferPtr = backgroundBuffers[currentDrawBuffer];
 
+    SM_PROFILE_SWAP_PICKED_UP();
     swapPending = false;
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::frameRefreshCallback(void) {
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::frameRefreshCallback(void) {
     handleBufferSwap();
 
-    if(sizeof(RGB) > 3)
-        calculate12BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
-    else
-        calculate8BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+    // only the 8-bit tables depend on brightnessShifts; they follow the value used for the previous frame, so a change takes effect one frame late
+    if(colorCorrectionLUTChanged || (sizeof(RGB) <= 3 && lutBrightnessShifts != refreshBrightnessShifts)) {
+        colorCorrectionLUTChanged = false;
+        calculateColorCorrectionLUTs(refreshBrightnessShifts);
+    }
+}
+
+// called at the frame boundary from frameRefreshCallback(), so refresh never reads a partly updated table
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::calculateColorCorrectionLUTs(int brightnessShifts) {
+    int numTables = (optionFlags & SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE) ? 3 : 1;
+
+    for(int i=0; i<numTables; i++) {
+        uint8_t gain = (numTables > 1) ? whiteBalanceGain[i] : 255;
+
+        if(sizeof(RGB) > 3)
+            calculate12BitBackgroundLUT(channelColorCorrectionLUT[i], backgroundBrightness, gain);
+        else
+            calculate8BitBackgroundLUT(channelColorCorrectionLUT[i], backgroundBrightness, gain, brightnessShifts);
+    }
+
+    lutBrightnessShifts = brightnessShifts;
 }
 
 template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
-void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
     RGB currentPixel;
     int i;
 
+    refreshBrightnessShifts = brightnessShifts;
+
     // if the row requested is outside of this layer with the layerYOffset applied, we have nothing to do
     if(((hardwareY - layerYOffset) > (this->matrixHeight - 1)) || ((hardwareY - layerYOffset) < 0))
         return;
@@ -140,15 +168,15 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t ha
             currentPixel = *ptr++;
             // load background pixel with color correction
             if(sizeof(RGB) <= 3) {
-                // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
+                // 24-bit source (8 bits per color channel): brightnessShifts is already applied in the 8-bit table, returns 16-bit value
+                refreshRow[i] = rgb48(channelColorCorrectionLUT[0][currentPixel.red],
+                    channelColorCorrectionLUT[1][currentPixel.green],
+                    channelColorCorrectionLUT[2][currentPixel.blue]);                
             } else {
                 // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
+                refreshRow[i] = rgb48(channelColorCorrectionLUT[0][currentPixel.red >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[1][currentPixel.green >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[2][currentPixel.blue >> (4 - brightnessShifts)]);
             }
         }
     } else {
@@ -171,12 +199,12 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t ha
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
     fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+void SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
     fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
 }
 
@@ -191,6 +219,7 @@ template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::swapBuffers(bool copy) {
     while (swapPending);
 
+    SM_PROFILE_SWAP_REQUESTED();
     swapPending = true;
 
     if (copy) {
@@ -223,29 +252,21 @@ INLINE void SMLayerBackgroundGFX<RGB, optionFlags>::loadPixelToDrawBuffer(int16_
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
-    int hwx, hwy;
+template <rotationDegrees rotation>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixelRotated(int16_t x, int16_t y, const RGB& color) {
+    int16_t hwx, hwy;
+
+    SMRotationPolicy<rotation>::localToHardware(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+    loadPixelToDrawBuffer(hwx, hwy, color);
+}
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return;
 
-    // map pixel into hardware buffer before writing
-    if (this->layerRotation == rotation0) {
-        hwx = x;
-        hwy = y;
-    } else if (this->layerRotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
-    } else if (this->layerRotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
-    } else { /* if (layerRotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
-    }
-
-    loadPixelToDrawBuffer(hwx, hwy, color);
+    SM_CALL_FOR_LAYER_ROTATION(drawPixelRotated, x, y, color);
 }
 
 
@@ -253,114 +274,156 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, con
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint16_t color) {
-    if(passThruColorFlag)
-        drawPixel(x, y, passThruColor);
-    else
-        drawPixel(x, y, (rgb16)color);
+    drawPixel(x, y, gfxColor(color));
 }
 
-/* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
-
-#ifdef SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
-
-// x0, x1, and y must be in bounds (0-this->localWidth/Height-1), x1 > x0
+// x0, x1, and y must be in bounds (0-this->matrixWidth/Height-1), x1 >= x0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color) {
-    int i;
-
-    for (i = x0; i <= x1; i++) {
-        loadPixelToDrawBuffer(i, y, color);
-    }
+    fillRGB(&currentDrawBufferPtr[(y * this->matrixWidth) + x0], x1 - x0 + 1, color);
 }
 
-// x, y0, and y1 must be in bounds (0-this->localWidth/Height-1), y1 > y0
+// x, y0, and y1 must be in bounds (0-this->matrixWidth/Height-1), y1 >= y0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color) {
-    int i;
+    RGB *ptr = &currentDrawBufferPtr[(y0 * this->matrixWidth) + x];
 
-    for (i = y0; i <= y1; i++) {
-        loadPixelToDrawBuffer(x, i, color);
+    for (int i = y0; i <= y1; i++, ptr += this->matrixWidth) {
+        *ptr = color;
     }
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color) {
-    // make sure line goes from x0 to x1
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillLocalRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
     if (x1 < x0)
         SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
 
-    // check for completely out of bounds line
-    if (x1 < 0 || x0 >= this->localWidth || y < 0 || y >= this->localHeight)
+    // check for completely out of bounds rectangle
+    if (x1 < 0 || x0 >= this->localWidth || y1 < 0 || y0 >= this->localHeight)
         return;
 
     // truncate if partially out of bounds
-    if (x0 < 0)
-        x0 = 0;
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    // a local rectangle is still a rectangle in hardware coordinates, so only the corners need mapping
+    int16_t ax, ay, bx, by;
+    localToHardwareForRotation(x0, y0, this->matrixWidth, this->matrixHeight, ax, ay);
+    localToHardwareForRotation(x1, y1, this->matrixWidth, this->matrixHeight, bx, by);
+    if (bx < ax)
+        SWAPint(bx, ax);
+    if (by < ay)
+        SWAPint(by, ay);
+
+    if (ax == bx) {
+        drawHardwareVLine(ax, ay, by, color);
+    } else {
+        for (int i = ay; i <= by; i++)
+            drawHardwareHLine(ax, bx, i, color);
+    }
+}
 
-    if (x1 >= this->localWidth)
-        x1 = this->localWidth - 1;
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::writePixel(int16_t x, int16_t y, uint16_t color) {
+    drawPixel(x, y, gfxColor(color));
+}
 
-    // map to hardware drawline function
-    if (this->layerRotation == rotation0) {
-        drawHardwareHLine(x0, x1, y, color);
-    } else if (this->layerRotation == rotation180) {
-        drawHardwareHLine((this->matrixWidth - 1) - x1, (this->matrixWidth - 1) - x0, (this->matrixHeight - 1) - y, color);
-    } else if (this->layerRotation == rotation90) {
-        drawHardwareVLine((this->matrixWidth - 1) - y, x0, x1, color);
-    } else { /* if (rotation == rotation270)*/
-        drawHardwareVLine(y, (this->matrixHeight - 1) - x1, (this->matrixHeight - 1) - x0, color);
-    }
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (w)
+        fillLocalRect(x, y, smGfxSpanEnd(x, w), y, gfxColor(color));
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color) {
-    // make sure line goes from y0 to y1
-    if (y1 < y0)
-        SWAPint(y1, y0);
+void SMLayerBackgroundGFX<RGB, optionFlags>::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (h)
+        fillLocalRect(x, y, x, smGfxSpanEnd(y, h), gfxColor(color));
+}
 
-    // check for completely out of bounds line
-    if (y1 < 0 || y0 >= this->localHeight || x < 0 || x >= this->localWidth)
-        return;
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w && h)
+        fillLocalRect(x, y, smGfxSpanEnd(x, w), smGfxSpanEnd(y, h), gfxColor(color));
+}
 
-    // truncate if partially out of bounds
-    if (y0 < 0)
-        y0 = 0;
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    writeFastHLine(x, y, w, color);
+}
 
-    if (y1 >= this->localHeight)
-        y1 = this->localHeight - 1;
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    writeFastVLine(x, y, h, color);
+}
 
-    // map to hardware drawline function
-    if (this->layerRotation == rotation0) {
-        drawHardwareVLine(x, y0, y1, color);
-    } else if (this->layerRotation == rotation180) {
-        drawHardwareVLine((this->matrixWidth - 1) - x, (this->matrixHeight - 1) - y1, (this->matrixHeight - 1) - y0, color);
-    } else if (this->layerRotation == rotation90) {
-        drawHardwareHLine((this->matrixWidth - 1) - y1, (this->matrixWidth - 1) - y0, x, color);
-    } else { /* if (layerRotation == rotation270)*/
-        drawHardwareHLine(y0, y1, (this->matrixHeight - 1) - x, color);
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    writeFillRect(x, y, w, h, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::fillScreen(uint16_t color) {
+    fillRGB(currentDrawBufferPtr, this->matrixWidth * this->matrixHeight, gfxColor(color));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w, int16_t h) {
+    // clip the bitmap to the layer once, instead of per pixel
+    int16_t i0 = std::max<int16_t>(0, -x);
+    int16_t j0 = std::max<int16_t>(0, -y);
+    int16_t i1 = std::min<int16_t>(w, this->localWidth - x);
+    int16_t j1 = std::min<int16_t>(h, this->localHeight - y);
+    if (i0 >= i1 || j0 >= j1)
+        return;
+
+    // step through the draw buffer along a local row, +/-1 for rotation0/180 and +/-matrixWidth for rotation90/270
+    int16_t ax, ay, bx, by;
+    localToHardwareForRotation(x + i0, y + j0, this->matrixWidth, this->matrixHeight, ax, ay);
+    localToHardwareForRotation(x + i0 + 1, y + j0, this->matrixWidth, this->matrixHeight, bx, by);
+    int columnStep = (by - ay) * this->matrixWidth + (bx - ax);
+    localToHardwareForRotation(x + i0, y + j0 + 1, this->matrixWidth, this->matrixHeight, bx, by);
+    int rowStep = (by - ay) * this->matrixWidth + (bx - ax);
+
+    RGB *rowPtr = &currentDrawBufferPtr[(ay * this->matrixWidth) + ax];
+    for (int j = j0; j < j1; j++, rowPtr += rowStep) {
+        const uint16_t *src = &bitmap[j * w + i0];
+        RGB *ptr = rowPtr;
+        for (int i = i0; i < i1; i++, ptr += columnStep)
+            *ptr = gfxColor(pgm_read_word(src++));
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h) {
+    drawRGBBitmap(x, y, (const uint16_t *)bitmap, w, h);
+}
+
+/* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
+
+#ifdef SM_BACKGROUND_GFX_BACKWARDS_COMPATIBILITY
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color) {
+    fillLocalRect(x0, y, x1, y, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color) {
+    fillLocalRect(x, y0, x, y1, color);
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
-    int i;
-    // Loop only works if y1 > y0
-    if (y0 > y1) {
-        SWAPint(y0, y1);
-    };
-    // Putting the x coordinates in order saves multiple swaps in drawFastHLine
-    if (x0 > x1) {
-        SWAPint(x0, x1);
-    };
-
-    for (i = y0; i <= y1; i++) {
-        drawFastHLine(x0, x1, i, color);
-    }
+    fillLocalRect(x0, y0, x1, y1, color);
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::fillScreen(const RGB& color) {
-    fillRectangle(0, 0, this->localWidth - 1, this->localHeight - 1, color);
+    fillRGB(currentDrawBufferPtr, this->matrixWidth * this->matrixHeight, color);
 }
 #endif
 
@@ -375,27 +438,19 @@ INLINE const RGB SMLayerBackgroundGFX<RGB, optionFlags>::readPixelFromDrawBuffer
 // reads pixel from drawing buffer, not refresh buffer
 template<typename RGB, unsigned int optionFlags>
 const RGB SMLayerBackgroundGFX<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
-    int hwx, hwy;
-
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return (RGB){0, 0, 0};
 
-    // map pixel into hardware buffer before reading
-    if (this->layerRotation == rotation0) {
-        hwx = x;
-        hwy = y;
-    } else if (this->layerRotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
-    } else if (this->layerRotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
-    } else { /* if (layerRotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
-    }
+    return (this->*readPixelForRotation)(x, y);
+}
 
+template<typename RGB, unsigned int optionFlags>
+template <rotationDegrees rotation>
+const RGB SMLayerBackgroundGFX<RGB, optionFlags>::readPixelRotated(int16_t x, int16_t y) {
+    int16_t hwx, hwy;
+
+    SMRotationPolicy<rotation>::localToHardware(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
     return readPixelFromDrawBuffer(hwx, hwy);
 }
 
@@ -425,15 +480,21 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::setBrightnessShifts(int numShifts)
 }
 
 template <typename RGB, unsigned int optionFlags>
-int SMLayerBackgroundGFX<RGB, optionFlags>::getRequestedBrightnessShifts() {
+int SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::getRequestedBrightnessShifts() {
     return idealBrightnessShifts;
 }
 
 template <typename RGB, unsigned int optionFlags>
-bool SMLayerBackgroundGFX<RGB, optionFlags>::isLayerChanged() {
+bool SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::isLayerChanged() {
     return swapPending;
 }
 
+// every pixel in the row is overwritten unless the layer is offset, leaving part of the row untouched
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerBackgroundGFX<RGB, optionFlags>::isLayerOpaque() {
+    return (layerXOffset == 0) && (layerYOffset == 0);
+}
+
 template <typename RGB, unsigned int optionFlags>
 bool SMLayerBackgroundGFX<RGB, optionFlags>::isSwapPending(void) {
     return swapPending;
@@ -442,6 +503,7 @@ bool SMLayerBackgroundGFX<RGB, optionFlags>::isSwapPending(void) {
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::setBrightness(uint8_t brightness) {
     backgroundBrightness = brightness;
+    colorCorrectionLUTChanged = true;
 }
 
 template<typename RGB, unsigned int optionFlags>
@@ -449,6 +511,15 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::enableColorCorrection(bool enabled)
     this->ccEnabled = enabled;
 }
 
+// gains scale each channel's color correction table (255 = no change), only has an effect with SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE
+template<typename RGB, unsigned int optionFlags>
+void SMLayerBackgroundGFX<RGB, optionFlags>::setWhiteBalance(uint8_t redGain, uint8_t greenGain, uint8_t blueGain) {
+    whiteBalanceGain[0] = redGain;
+    whiteBalanceGain[1] = greenGain;
+    whiteBalanceGain[2] = blueGain;
+    colorCorrectionLUTChanged = true;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
     this->layerRotation = newrotation;
@@ -467,6 +538,20 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::setRotation(rotationDegrees newrota
         _width = this->matrixHeight;
         _height = this->matrixWidth;        
     }
+
+    if (this->layerRotation == rotation0) {
+        readPixelForRotation = &SMLayerBackgroundGFX::template readPixelRotated<rotation0>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+    } else if (this->layerRotation == rotation180) {
+        readPixelForRotation = &SMLayerBackgroundGFX::template readPixelRotated<rotation180>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+    } else if (this->layerRotation == rotation90) {
+        readPixelForRotation = &SMLayerBackgroundGFX::template readPixelRotated<rotation90>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+    } else { /* if (layerRotation == rotation270)*/
+        readPixelForRotation = &SMLayerBackgroundGFX::template readPixelRotated<rotation270>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+    }
 }
 
 /* Shared SmartMatrix Library 3.0 Backwards Compatibility */
@@ -476,10 +561,14 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::setRotation(rotationDegrees newrota
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::drawChar(int16_t x, int16_t y, const RGB& charColor, char character) {
     int xcnt, ycnt;
+    const unsigned char *rows = getBitmapFontGlyphRows(character, font);
+
+    if (!rows)
+        return;
 
     for (ycnt = 0; ycnt < font->Height; ycnt++) {
         for (xcnt = 0; xcnt < font->Width; xcnt++) {
-            if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
+            if (rows[ycnt] & (0x80 >> xcnt)) {
                 drawPixel(x + xcnt, y + ycnt, charColor);
             }
         }
@@ -492,9 +581,11 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawString(int16_t x, int16_t y, co
     char character;
 
     while ((character = text[offset++]) != '\0') {
-        for (ycnt = 0; ycnt < font->Height; ycnt++) {
+        const unsigned char *rows = getBitmapFontGlyphRows(character, font);
+
+        for (ycnt = 0; rows && ycnt < font->Height; ycnt++) {
             for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
+                if (rows[ycnt] & (0x80 >> xcnt)) {
                     drawPixel(x + xcnt, y + ycnt, charColor);
                 }
             }
@@ -510,9 +601,11 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawString(int16_t x, int16_t y, co
     char character;
 
     while ((character = text[offset++]) != '\0') {
+        const unsigned char *rows = getBitmapFontGlyphRows(character, font);
+
         for (ycnt = 0; ycnt < font->Height; ycnt++) {
             for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
+                if (rows && (rows[ycnt] & (0x80 >> xcnt))) {
                     drawPixel(x + xcnt, y + ycnt, charColor);
                 } else {
                     drawPixel(x + xcnt, y + ycnt, backColor);
@@ -540,6 +633,10 @@ void SMLayerBackgroundGFX<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackgroundGFX<RGB, optionFlags>::setFont(fontChoices newFont) {
     font = (bitmap_font *)fontLookup(newFont);
+
+#ifdef SM_FONT_PRELOAD_ASCII
+    preloadBitmapFontGlyphs(font, ' ', '~');
+#endif
 }
 
 #else // !defined(SM_BACKGROUND_GFX_OLD_DRAWING_FUNCTIONS)
@@ -25,10 +25,15 @@
 
 // call when backgroundBuffers and backgroundColorCorrectionLUT buffer is allocated outside of class
 template <typename RGB, unsigned int optionFlags>
-SMLayerBackground<RGB, optionFlags>::SMLayerBackground(RGB * buffer, uint16_t width, uint16_t height, color_chan_t * colorCorrectionLUT) {
+SMLayerBackground<RGB, optionFlags>::SMLayerBackground(RGB * buffer, uint16_t width, uint16_t height, color_chan_t * colorCorrectionLUT, RGB * rowCacheBuffer) {
     backgroundBuffers[0] = buffer;
     backgroundBuffers[1] = buffer + (width * height);
+    backgroundBuffers[2] = (optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) ? buffer + 2 * (width * height) : NULL;
     backgroundColorCorrectionLUT = colorCorrectionLUT;
+#if defined(__IMXRT1062__)
+    if(optionFlags & SM_BACKGROUND_OPTIONS_ROW_CACHE)
+        rowCache = rowCacheBuffer;
+#endif
     this->matrixWidth = width;
     this->matrixHeight = height;
 }
@@ -62,42 +67,323 @@ void SMLayerBackground<RGB, optionFlags>::begin(void) {
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
         memset(backgroundBuffers[0], 0x00, sizeof(RGB) * this->matrixWidth * this->matrixHeight);
         memset(backgroundBuffers[1], 0x00, sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+        smRecordAllocation(smMemoryLayers, backgroundBuffers[0], sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+        smRecordAllocation(smMemoryLayers, backgroundBuffers[1], sizeof(RGB) * this->matrixWidth * this->matrixHeight);
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+        if(optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) {
+            backgroundBuffers[2] = (RGB *)ESPmalloc(sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+            assert(backgroundBuffers[2] != NULL);
+            memset(backgroundBuffers[2], 0x00, sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+            smRecordAllocation(smMemoryLayers, backgroundBuffers[2], sizeof(RGB) * this->matrixWidth * this->matrixHeight);
+        }
     }
-    if(!backgroundColorCorrectionLUT) {
-        backgroundColorCorrectionLUT = (color_chan_t *)malloc(sizeof(color_chan_t) * (sizeof(RGB) <= 3 ? 256 : 4096));
+    if(!backgroundColorCorrectionLUT && !isLUTShared()) {
+        backgroundColorCorrectionLUT = (color_chan_t *)malloc(sizeof(color_chan_t) * SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE));
         assert(backgroundColorCorrectionLUT != NULL);
+        smRecordAllocation(smMemoryLUTs, backgroundColorCorrectionLUT, sizeof(color_chan_t) * SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE));
         //printf("largest free block %d: \r\n", heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
     }
+    if((optionFlags & SM_BACKGROUND_OPTIONS_ROW_CACHE) && !rowCache) {
+        // the cache only helps if it's faster than the buffers, so it must be internal RAM even when malloc would return PSRAM
+        rowCache = (RGB *)heap_caps_malloc(sizeof(RGB) * this->matrixWidth * SM_BACKGROUND_ROW_CACHE_ROWS, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        assert(rowCache != NULL);
+        smRecordAllocation(smMemoryLayers, rowCache, sizeof(RGB) * this->matrixWidth * SM_BACKGROUND_ROW_CACHE_ROWS);
+    }
+#endif
+#if defined(__IMXRT1062__)
+    for(int i=0; rowCache && i<SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS; i++) {
+        if(!rowCacheDMA[i]) {
+            rowCacheDMA[i] = new DMAChannel();
+            rowCachePendingSlot[i] = -1;
+        }
+    }
 #endif
+
+    if(isLUTShared()) {
+        updateSharedLUTs();
+        switchSharedLUTs();
+    } else {
+        for(int i=0; i<3; i++)
+            channelColorCorrectionLUT[i] = ownedChannelLUT(i);
+    }
+    colorCorrectionLUTChanged = true;
     
     currentDrawBuffer = 0;
     currentRefreshBuffer = 1;
+    spareBuffer = 2;
     swapPending = false;
     font = (bitmap_font *) &apple3x5;
 
     currentDrawBufferPtr = backgroundBuffers[0];
     currentRefreshBufferPtr = backgroundBuffers[1];
+    invalidateRowCache();
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::frameRefreshCallback(void) {
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    refreshBackgroundBrightness = backgroundBrightness;
+    refreshChromaKeyEnabled = isChromaKeyEnabled();
+    refreshBlendMode = this->blendMode;
+    refreshOpaque = (refreshBackgroundBrightness == 255) && !refreshChromaKeyEnabled && (refreshBlendMode == smBlendReplace);
+
     handleBufferSwap();
 
-    if(sizeof(RGB) > 3)
-        calculate12BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+    // each frame of a crossfade changes every row, the frame after the last one shows the new buffer alone
+    if(fadeFromBufferPtr) {
+        if(++fadeFramesShown >= crossfadeFrames)
+            fadeFromBufferPtr = NULL;
+        else
+            fadeWeight = (256 * fadeFramesShown) / crossfadeFrames;
+        this->markAllRowsChanged();
+    }
+
+    if(rowCache && rowCacheSource != currentRefreshBufferPtr)
+        invalidateRowCache();
+
+    if(refreshSettingsChanged) {
+        this->markAllRowsChanged();
+        refreshSettingsChanged = false;
+    }
+
+    // with chroma key the layer only draws between the overlay lines, at brightness 0 it draws nothing
+    if(refreshBackgroundBrightness == 0)
+        this->setCoveredRows(0x7FFF, -1);
+    else if(refreshChromaKeyEnabled)
+        this->setCoveredRows(firstOverlayLine, lastOverlayLine);
     else
-        calculate8BitBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+        this->setCoveredRows(0, this->matrixHeight - 1);
+
+    // only the 8-bit tables depend on brightnessShifts; they follow the value used for the previous frame, so a change takes effect one frame late
+    if(isLUTShared())
+        switchSharedLUTs();
+    else if(colorCorrectionLUTChanged || (sizeof(RGB) <= 3 && lutBrightnessShifts != refreshBrightnessShifts)) {
+        colorCorrectionLUTChanged = false;
+        calculateColorCorrectionLUTs(refreshBrightnessShifts);
+    }
+}
+
+// rgb8/rgb16 always use a small table per channel (at most 64 entries each), which fits in the 256 entries of a single 8-bit table
+template <typename RGB, unsigned int optionFlags>
+color_chan_t * SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::ownedChannelLUT(int channel) {
+    if(sizeof(RGB) <= 2)
+        return backgroundColorCorrectionLUT + channel * 64;
+
+    return backgroundColorCorrectionLUT + ((optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE) ? channel * (sizeof(RGB) <= 3 ? 256 : 4096) : 0);
+}
+
+// called from the sketch when brightness or white balance changes
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::updateSharedLUTs(void) {
+    // with nothing pending refresh can't switch sets, the set it isn't using (including a set it never picked up) can be reused
+    uint8_t set = 1 - (__atomic_fetch_and(&sharedLUTState, (uint8_t)~SM_SHARED_LUT_SET_PENDING, __ATOMIC_ACQ_REL) & 1);
+
+    for(int i=0; i<3; i++) {
+        if(sharedLUTs[set][i])
+            smReleaseShared12BitLUT(sharedLUTs[set][i]);
+        sharedLUTs[set][i] = NULL;
+    }
+
+    // at brightness 0 the layer isn't drawn, the full brightness table avoids allocating one that's never read
+    uint8_t brightness = backgroundBrightness ? backgroundBrightness : 255;
+    int numTables = (optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE) ? 3 : 1;
+    for(int i=0; i<numTables; i++)
+        sharedLUTs[set][i] = smAcquireShared12BitLUT(brightness, (numTables > 1) ? whiteBalanceGain[i] : 255);
+
+    __atomic_fetch_or(&sharedLUTState, (uint8_t)SM_SHARED_LUT_SET_PENDING, __ATOMIC_RELEASE);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::switchSharedLUTs(void) {
+    uint8_t state = __atomic_load_n(&sharedLUTState, __ATOMIC_ACQUIRE);
+    uint8_t set;
+    do {
+        if(!(state & SM_SHARED_LUT_SET_PENDING))
+            return;
+        set = 1 - (state & 1);
+    } while(!__atomic_compare_exchange_n(&sharedLUTState, &state, set, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    for(int i=0; i<3; i++)
+        channelColorCorrectionLUT[i] = sharedLUTs[set][(optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE) ? i : 0];
+}
+
+// called at the frame boundary from frameRefreshCallback(), so refresh never reads a partly updated table
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::calculateColorCorrectionLUTs(int brightnessShifts) {
+    if(sizeof(RGB) <= 2) {
+        static const uint8_t * const SM_FLASH_SAFE_DRAM expand332[3] = {cs_scale3to8, cs_scale3to8, cs_scale2to8};
+        static const uint8_t * const SM_FLASH_SAFE_DRAM expand565[3] = {cs_scale5to8, cs_scale6to8, cs_scale5to8};
+        static const int SM_FLASH_SAFE_DRAM numEntries332[3] = {8, 8, 4};
+        static const int SM_FLASH_SAFE_DRAM numEntries565[3] = {32, 64, 32};
+
+        for(int i=0; i<3; i++) {
+            uint8_t gain = (optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE) ? whiteBalanceGain[i] : 255;
+
+            if(sizeof(RGB) == 1)
+                calculateNarrowBackgroundLUT(ownedChannelLUT(i), expand332[i], numEntries332[i], backgroundBrightness, gain, brightnessShifts);
+            else
+                calculateNarrowBackgroundLUT(ownedChannelLUT(i), expand565[i], numEntries565[i], backgroundBrightness, gain, brightnessShifts);
+        }
+
+        lutBrightnessShifts = brightnessShifts;
+        return;
+    }
+
+    int numTables = (optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE) ? 3 : 1;
+
+    for(int i=0; i<numTables; i++) {
+        uint8_t gain = (numTables > 1) ? whiteBalanceGain[i] : 255;
+
+        if(sizeof(RGB) > 3)
+            calculate12BitBackgroundLUT(ownedChannelLUT(i), backgroundBrightness, gain);
+        else
+            calculate8BitBackgroundLUT(ownedChannelLUT(i), backgroundBrightness, gain, brightnessShifts);
+    }
+
+    lutBrightnessShifts = brightnessShifts;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::invalidateRowCache(void) {
+#if defined(__IMXRT1062__)
+    waitForRowCacheDMA();
+#endif
+    for(int i=0; i<SM_BACKGROUND_ROW_CACHE_ROWS; i++)
+        rowCacheTags[i] = 0xFFFF;
+    rowCacheNextSlot = 0;
+    rowCacheSource = currentRefreshBufferPtr;
+}
+
+// copy a refresh buffer row into the next cache slot with one sequential burst, instead of fillRefreshRow() stalling on PSRAM pixel by pixel
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::prefetchRefreshRow(uint16_t hardwareY) {
+    if(!rowCache || hardwareY >= this->matrixHeight)
+        return;
+
+    // slots are tagged with the buffer row, which is only the hardware row without a viewport offset
+    uint16_t sourceY = hardwareY + refreshViewportY;
+    if(sourceY >= this->matrixHeight)
+        sourceY -= this->matrixHeight;
+
+    for(int i=0; i<SM_BACKGROUND_ROW_CACHE_ROWS; i++) {
+        if(rowCacheTags[i] == sourceY)
+            return;
+    }
+
+    int slot = rowCacheNextSlot;
+    rowCacheNextSlot = (slot + 1) % SM_BACKGROUND_ROW_CACHE_ROWS;
+
+    RGB * src = currentRefreshBufferPtr + (sourceY * this->matrixWidth);
+    RGB * dst = &rowCache[slot * this->matrixWidth];
+    uint32_t numBytes = sizeof(RGB) * this->matrixWidth;
+
+#if defined(__IMXRT1062__)
+    // a single descriptor copies the whole row in one minor loop, the calc carries on packing while it runs
+    // the slot may still be the target of an older copy, and the next channel may still be busy with the oldest copy in flight
+    waitForRowCacheSlot(slot);
+    int channel = rowCacheNextDMA;
+    rowCacheNextDMA = (channel + 1) % SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS;
+    waitForRowCacheDMA(channel);
+    rowCacheTags[slot] = 0xFFFF;
+
+    DMAChannel * dma = rowCacheDMA[channel];
+    int transferSize = (((uint32_t)src | (uint32_t)dst | numBytes) & 3) ? 1 : 4;
+    dma->TCD->SADDR = src;
+    dma->TCD->SOFF = transferSize;
+    dma->TCD->ATTR = (transferSize == 4) ? (DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2)) : (DMA_TCD_ATTR_SSIZE(0) | DMA_TCD_ATTR_DSIZE(0));
+    dma->TCD->NBYTES_MLNO = numBytes;
+    dma->TCD->SLAST = 0;
+    dma->TCD->DADDR = dst;
+    dma->TCD->DOFF = transferSize;
+    dma->TCD->CITER_ELINKNO = 1;
+    dma->TCD->DLASTSGA = 0;
+    dma->TCD->BITER_ELINKNO = 1;
+    dma->TCD->CSR = DMA_TCD_CSR_DREQ;
+    dma->triggerManual();
+
+    rowCachePendingSlot[channel] = slot;
+    rowCacheTags[slot] = sourceY;
+#else
+    rowCacheTags[slot] = 0xFFFF;
+    memcpy((void *)dst, src, numBytes);
+    rowCacheTags[slot] = sourceY;
+#endif
+}
+
+#if defined(__IMXRT1062__)
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::waitForRowCacheDMA(int channel) {
+    if(rowCachePendingSlot[channel] < 0)
+        return;
+
+    while(!rowCacheDMA[channel]->complete());
+    rowCacheDMA[channel]->clearComplete();
+    rowCachePendingSlot[channel] = -1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::waitForRowCacheDMA(void) {
+    for(int i=0; i<SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS; i++) {
+        if(rowCacheDMA[i])
+            waitForRowCacheDMA(i);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::waitForRowCacheSlot(int slot) {
+    for(int i=0; i<SM_BACKGROUND_ROW_CACHE_DMA_CHANNELS; i++) {
+        if(rowCacheDMA[i] && rowCachePendingSlot[i] == slot)
+            waitForRowCacheDMA(i);
+    }
+}
+
+// eDMA reads EXTMEM directly, so pixels written by the CPU that are still in the data cache must be written out before refresh can see the buffer
+// only the given rows are flushed, rows the CPU didn't write since the last flush have no dirty cache lines
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::flushBufferForRowCache(RGB * buffer, uint16_t firstRow, uint16_t lastRow) {
+    if(!rowCache)
+        return;
+
+    if(lastRow >= this->matrixHeight)
+        lastRow = this->matrixHeight - 1;
+    if(firstRow > lastRow)
+        return;
+
+    arm_dcache_flush(buffer + firstRow * this->matrixWidth, sizeof(RGB) * this->matrixWidth * (lastRow - firstRow + 1));
+}
+#endif
+
+template <typename RGB, unsigned int optionFlags>
+const RGB * SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::getRefreshRowSource(uint16_t hardwareY) {
+    if(rowCache) {
+        for(int i=0; i<SM_BACKGROUND_ROW_CACHE_ROWS; i++) {
+            if(rowCacheTags[i] == hardwareY) {
+#if defined(__IMXRT1062__)
+                waitForRowCacheSlot(i);
+#endif
+                return &rowCache[i * this->matrixWidth];
+            }
+        }
+    }
+
+    return currentRefreshBufferPtr + (hardwareY * this->matrixWidth);
 }
 
 template <typename RGB, unsigned int optionFlags>
-int SMLayerBackground<RGB, optionFlags>::getRequestedBrightnessShifts() {
+int SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::getRequestedBrightnessShifts() {
     return idealBrightnessShifts;
 }
 
 template <typename RGB, unsigned int optionFlags>
-bool SMLayerBackground<RGB, optionFlags>::isLayerChanged() {
-    return swapPending;
+bool SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::isLayerChanged() {
+    return isSwapPending() || fadeFromBufferPtr || this->blendModeChanged;
+}
+
+// at full brightness without chroma key or a blend mode every pixel in the row is overwritten, nothing from lower layers shows through
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::isLayerOpaque() {
+    return refreshOpaque;
 }
 
 // numShifts must be in range of 0-4, otherwise 16-bit to 12-bit conversion code breaks (would be an easy fix, but 4 is enough for APA102 GBC application)
@@ -107,64 +393,88 @@ void SMLayerBackground<RGB, optionFlags>::setBrightnessShifts(int numShifts) {
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) 
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) 
 {
-    if (backgroundBrightness == 0)
+    // stored only on a change: with SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE both calc tasks fill rows of the same frame, with the same brightnessShifts
+    if(refreshBrightnessShifts != brightnessShifts)
+        refreshBrightnessShifts = brightnessShifts;
+
+    if (refreshBackgroundBrightness == 0)
         return;
 
     // If ChromaKey is enabled, and we're outside the first/last lines, we can bail
-    if (isChromaKeyEnabled() && (hardwareY < firstOverlayLine || hardwareY > lastOverlayLine))
+    if (refreshChromaKeyEnabled && (hardwareY < firstOverlayLine || hardwareY > lastOverlayLine))
         return;
 
+    if(fadeFromBufferPtr) {
+        fillRefreshRowCrossfade(hardwareY, refreshRow, brightnessShifts);
+        return;
+    }
+
     RGB currentPixel;
-    double brightLower = (255.0-backgroundBrightness) / 255.0;
-    double brightUpper = backgroundBrightness / 255.0;
+    uint16_t blendWeight = blendAlphaToWeight(refreshBackgroundBrightness);
+    smBlendMode layerBlendMode = refreshBlendMode;
 
-    RGB *ptr = currentRefreshBufferPtr + (hardwareY * this->matrixWidth);
+    // with a viewport offset the row starts refreshViewportX pixels into a different buffer row, and wraps back to the start of that row at wrapColumn
+    uint16_t sourceY = hardwareY + refreshViewportY;
+    if(sourceY >= this->matrixHeight)
+        sourceY -= this->matrixHeight;
+    const RGB *ptr = getRefreshRowSource(sourceY) + refreshViewportX;
+    int wrapColumn = this->matrixWidth - refreshViewportX;
 
     if(this->ccEnabled) 
     {
         for(int i=0; i<this->matrixWidth; i++)
         {
+            if(i == wrapColumn)
+                ptr -= this->matrixWidth;
             currentPixel = *ptr++;
 
-            if (isChromaKeyEnabled() && currentPixel == getChromaKeyColor())
+            if (refreshChromaKeyEnabled && currentPixel == getChromaKeyColor())
                 continue;
 
-            RGB newPixel;
+            rgb48 newPixel;
             if(sizeof(RGB) <= 3) 
             {
-                // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                newPixel = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
+                // 8/16/24-bit source: the table is indexed by the stored channel value and already has brightnessShifts applied, returns 16-bit value
+                newPixel = rgb48(channelColorCorrectionLUT[0][currentPixel.red],
+                    channelColorCorrectionLUT[1][currentPixel.green],
+                    channelColorCorrectionLUT[2][currentPixel.blue]);                
             } 
             else 
             {
                 // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                newPixel = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
+                newPixel = rgb48(channelColorCorrectionLUT[0][currentPixel.red >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[1][currentPixel.green >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[2][currentPixel.blue >> (4 - brightnessShifts)]);
             }
-            refreshRow[i] =  (refreshRow[i] * brightLower + newPixel * brightUpper) / (brightLower + brightUpper);
+            if (layerBlendMode != smBlendReplace)
+                refreshRow[i] = blendRGBModeWeighted(refreshRow[i], newPixel, layerBlendMode, blendWeight);
+            else if (refreshBackgroundBrightness == 255)
+                refreshRow[i] = newPixel;
+            else
+                refreshRow[i] = blendRGB(refreshRow[i], newPixel, blendWeight);
         }
     } 
     else 
     {
         for(int i=0; i<this->matrixWidth; i++) 
         {
+            if(i == wrapColumn)
+                ptr -= this->matrixWidth;
             currentPixel = *ptr++;
 
-            if (isChromaKeyEnabled() && currentPixel == getChromaKeyColor())
+            if (refreshChromaKeyEnabled && currentPixel == getChromaKeyColor())
                 continue;
 
-            // load background pixel without color correction
-            RGB newPixel;
+            // load background pixel without color correction, rgb8/rgb16 are expanded to 8 bits per channel first
+            rgb48 newPixel;
             if(sizeof(RGB) <= 3) 
             {
-                newPixel = rgb24(currentPixel.red << brightnessShifts,
-                    currentPixel.green << brightnessShifts,
-                    currentPixel.blue << brightnessShifts);
+                rgb24 expandedPixel = currentPixel;
+                newPixel = rgb24(expandedPixel.red << brightnessShifts,
+                    expandedPixel.green << brightnessShifts,
+                    expandedPixel.blue << brightnessShifts);
             } 
             else 
             {
@@ -172,90 +482,202 @@ void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb
                     currentPixel.green << brightnessShifts,
                     currentPixel.blue << brightnessShifts);
             }
-            refreshRow[i] =  refreshRow[i] * brightLower + newPixel * brightUpper;
+
+            if (layerBlendMode != smBlendReplace)
+                refreshRow[i] = blendRGBModeWeighted(refreshRow[i], newPixel, layerBlendMode, blendWeight);
+            else if (refreshBackgroundBrightness == 255)
+                refreshRow[i] = newPixel;
+            else
+                refreshRow[i] = blendRGB(refreshRow[i], rgb48(newPixel), blendWeight);
         }    
     }
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) 
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) 
 {
-    if (backgroundBrightness == 0)
+    // stored only on a change: with SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE both calc tasks fill rows of the same frame, with the same brightnessShifts
+    if(refreshBrightnessShifts != brightnessShifts)
+        refreshBrightnessShifts = brightnessShifts;
+
+    if (refreshBackgroundBrightness == 0)
         return;
     // If ChromaKey is enabled, and we're outside the first/last lines, we can bail
-    if (isChromaKeyEnabled() && (hardwareY < firstOverlayLine || hardwareY > lastOverlayLine))
+    if (refreshChromaKeyEnabled && (hardwareY < firstOverlayLine || hardwareY > lastOverlayLine))
+        return;
+
+    if(fadeFromBufferPtr) {
+        fillRefreshRowCrossfade(hardwareY, refreshRow, brightnessShifts);
         return;
+    }
 
     RGB currentPixel;
-    double brightLower = (255.0-backgroundBrightness) / 255.0;
-    double brightUpper = backgroundBrightness / 255.0;
-    RGB *ptr = currentRefreshBufferPtr + (hardwareY * this->matrixWidth);
+    uint16_t blendWeight = blendAlphaToWeight(refreshBackgroundBrightness);
+    smBlendMode layerBlendMode = refreshBlendMode;
+    uint16_t sourceY = hardwareY + refreshViewportY;
+    if(sourceY >= this->matrixHeight)
+        sourceY -= this->matrixHeight;
+    const RGB *ptr = getRefreshRowSource(sourceY) + refreshViewportX;
+    int wrapColumn = this->matrixWidth - refreshViewportX;
     RGB  chromaColor = getChromaKeyColor();
-    bool bChroma = isChromaKeyEnabled();
+    bool bChroma = refreshChromaKeyEnabled;
 
     if(this->ccEnabled) 
     {
         for(int i=0; i<this->matrixWidth; i++)
         {
+            if(i == wrapColumn)
+                ptr -= this->matrixWidth;
             currentPixel = *ptr++;
 
             if (bChroma && currentPixel == chromaColor)
                 continue;
 
-            RGB newPixel;
+            rgb24 newPixel;
             if(sizeof(RGB) <= 3) {
-                // 24-bit source (8 bits per color channel): backgroundColorCorrectionLUT expects 8-bit value, returns 16-bit value
-                newPixel = rgb48(backgroundColorCorrectionLUT[currentPixel.red << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.green << brightnessShifts],
-                    backgroundColorCorrectionLUT[currentPixel.blue << brightnessShifts]);                
+                // 8/16/24-bit source: the table is indexed by the stored channel value and already has brightnessShifts applied, returns 16-bit value
+                newPixel = rgb48(channelColorCorrectionLUT[0][currentPixel.red],
+                    channelColorCorrectionLUT[1][currentPixel.green],
+                    channelColorCorrectionLUT[2][currentPixel.blue]);                
             } else {
                 // 48-bit source (16 bits per color channel): backgroundColorCorrectionLUT expects 12-bit value, returns 16-bit value
-                newPixel = rgb48(backgroundColorCorrectionLUT[currentPixel.red >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.green >> (4 - brightnessShifts)],
-                    backgroundColorCorrectionLUT[currentPixel.blue >> (4 - brightnessShifts)]);
+                newPixel = rgb48(channelColorCorrectionLUT[0][currentPixel.red >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[1][currentPixel.green >> (4 - brightnessShifts)],
+                    channelColorCorrectionLUT[2][currentPixel.blue >> (4 - brightnessShifts)]);
             }
-            if (backgroundBrightness == 255)
+            if (layerBlendMode != smBlendReplace)
+                refreshRow[i] = blendRGBModeWeighted(refreshRow[i], newPixel, layerBlendMode, blendWeight);
+            else if (refreshBackgroundBrightness == 255)
                 refreshRow[i] = newPixel;
             else
-                refreshRow[i] =  refreshRow[i] * brightLower + newPixel * brightUpper;
+                refreshRow[i] = blendRGB(refreshRow[i], newPixel, blendWeight);
         }
     } 
     else 
     {
         for(int i=0; i<this->matrixWidth; i++) 
         {
+            if(i == wrapColumn)
+                ptr -= this->matrixWidth;
             currentPixel = *ptr++;
             if (bChroma && currentPixel == chromaColor)
                 continue;
 
-            // load background pixel without color correction
-            RGB newPixel;
+            // load background pixel without color correction, rgb8/rgb16 are expanded to 8 bits per channel first
+            rgb24 newPixel;
             if(sizeof(RGB) <= 3) {
-                newPixel = rgb24(currentPixel.red << brightnessShifts,
-                    currentPixel.green << brightnessShifts,
-                    currentPixel.blue << brightnessShifts);
+                rgb24 expandedPixel = currentPixel;
+                newPixel = rgb24(expandedPixel.red << brightnessShifts,
+                    expandedPixel.green << brightnessShifts,
+                    expandedPixel.blue << brightnessShifts);
             } else {
                 newPixel = rgb48(currentPixel.red << brightnessShifts,
                     currentPixel.green << brightnessShifts,
                     currentPixel.blue << brightnessShifts);
             }
 
-            if (backgroundBrightness == 255)
+            if (layerBlendMode != smBlendReplace)
+                refreshRow[i] = blendRGBModeWeighted(refreshRow[i], newPixel, layerBlendMode, blendWeight);
+            else if (refreshBackgroundBrightness == 255)
                 refreshRow[i] = newPixel;
             else
-                refreshRow[i] =  refreshRow[i] * brightLower + newPixel * brightUpper;
+                refreshRow[i] = blendRGB(refreshRow[i], rgb24(newPixel), blendWeight);
         }    
     }
 }
 
-extern volatile int totalFramesToInterpolate;
-extern volatile int framesInterpolated;
-
 #define INLINE __attribute__( ( always_inline ) ) inline
 
+// value fillRefreshRow() would write for a stored pixel at full brightness
+template <typename RGB, unsigned int optionFlags>
+INLINE rgb48 SMLayerBackground<RGB, optionFlags>::getRefreshPixelValue(const RGB & pixel, int brightnessShifts) {
+    if(this->ccEnabled) {
+        if(sizeof(RGB) <= 3)
+            return rgb48(channelColorCorrectionLUT[0][pixel.red],
+                channelColorCorrectionLUT[1][pixel.green],
+                channelColorCorrectionLUT[2][pixel.blue]);
+
+        return rgb48(channelColorCorrectionLUT[0][pixel.red >> (4 - brightnessShifts)],
+            channelColorCorrectionLUT[1][pixel.green >> (4 - brightnessShifts)],
+            channelColorCorrectionLUT[2][pixel.blue >> (4 - brightnessShifts)]);
+    }
+
+    if(sizeof(RGB) <= 3) {
+        rgb24 expandedPixel = pixel;
+        return rgb24(expandedPixel.red << brightnessShifts,
+            expandedPixel.green << brightnessShifts,
+            expandedPixel.blue << brightnessShifts);
+    }
+
+    return rgb48(pixel.red << brightnessShifts,
+        pixel.green << brightnessShifts,
+        pixel.blue << brightnessShifts);
+}
+
+// blends the previous and current refresh buffers with fadeWeight, both with their own viewport offset
+// a chroma keyed pixel in either frame fades from or to whatever the lower layers drew
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::fillRefreshRowCrossfade(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
+    uint16_t blendWeight = blendAlphaToWeight(refreshBackgroundBrightness);
+    smBlendMode layerBlendMode = refreshBlendMode;
+    RGB chromaColor = getChromaKeyColor();
+    bool bChroma = refreshChromaKeyEnabled;
+
+    uint16_t sourceY = hardwareY + refreshViewportY;
+    if(sourceY >= this->matrixHeight)
+        sourceY -= this->matrixHeight;
+    const RGB *ptr = getRefreshRowSource(sourceY) + refreshViewportX;
+    int wrapColumn = this->matrixWidth - refreshViewportX;
+
+    uint16_t fadeY = hardwareY + fadeViewportY;
+    if(fadeY >= this->matrixHeight)
+        fadeY -= this->matrixHeight;
+    const RGB *fadePtr = fadeFromBufferPtr + (fadeY * this->matrixWidth) + fadeViewportX;
+    int fadeWrapColumn = this->matrixWidth - fadeViewportX;
+
+    for(int i=0; i<this->matrixWidth; i++) {
+        if(i == wrapColumn)
+            ptr -= this->matrixWidth;
+        if(i == fadeWrapColumn)
+            fadePtr -= this->matrixWidth;
+        RGB newPixel = *ptr++;
+        RGB oldPixel = *fadePtr++;
+
+        bool newKeyed = bChroma && newPixel == chromaColor;
+        bool oldKeyed = bChroma && oldPixel == chromaColor;
+        if(newKeyed && oldKeyed)
+            continue;
+
+        // with a blend mode a keyed pixel fades from or to the color that leaves the lower layers unchanged
+        rgb48 keyedValue = rgb48(refreshRow[i]);
+        if (layerBlendMode != smBlendReplace)
+            keyedValue = (layerBlendMode == smBlendMultiply) ? rgb48(0xFFFF, 0xFFFF, 0xFFFF) : rgb48(0, 0, 0);
+        rgb48 newValue = newKeyed ? keyedValue : getRefreshPixelValue(newPixel, brightnessShifts);
+        rgb48 oldValue = oldKeyed ? keyedValue : getRefreshPixelValue(oldPixel, brightnessShifts);
+        rgb48 fadedPixel = blendRGB(oldValue, newValue, fadeWeight);
+
+        if (layerBlendMode != smBlendReplace)
+            refreshRow[i] = blendRGBModeWeighted(rgb48(refreshRow[i]), fadedPixel, layerBlendMode, blendWeight);
+        else if (refreshBackgroundBrightness == 255)
+            refreshRow[i] = fadedPixel;
+        else
+            refreshRow[i] = blendRGB(rgb48(refreshRow[i]), fadedPixel, blendWeight);
+    }
+}
+
 template <typename RGB, unsigned int optionFlags>
 INLINE void SMLayerBackground<RGB, optionFlags>::loadPixelToDrawBuffer(int16_t hwx, int16_t hwy, const RGB& color) {
     currentDrawBufferPtr[(hwy * this->matrixWidth) + hwx] = color;
+
+    if(hwy < drawnRowsFirst)
+        drawnRowsFirst = hwy;
+    if(hwy > drawnRowsLast)
+        drawnRowsLast = hwy;
+    if(hwx < drawnColsFirst)
+        drawnColsFirst = hwx;
+    if(hwx > drawnColsLast)
+        drawnColsLast = hwx;
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -265,49 +687,77 @@ INLINE const RGB SMLayerBackground<RGB, optionFlags>::readPixelFromDrawBuffer(in
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
-    int hwx, hwy;
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::drawPixelRotated(int16_t x, int16_t y, const RGB& color) {
+    int16_t hwx, hwy;
+
+    SMRotationPolicy<rotation>::localToHardware(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+    loadPixelToDrawBuffer(hwx, hwy, color);
+}
 
+template <typename RGB, unsigned int optionFlags>
+template <rotationDegrees rotation>
+INLINE void SMLayerBackground<RGB, optionFlags>::drawPixelClipped(int16_t x, int16_t y, const RGB& color) {
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return;
 
-    // map pixel into hardware buffer before writing
+    drawPixelRotated<rotation>(x, y, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <rotationDegrees rotation>
+const RGB SMLayerBackground<RGB, optionFlags>::readPixelRotated(int16_t x, int16_t y) {
+    int16_t hwx, hwy;
+
+    SMRotationPolicy<rotation>::localToHardware(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+    return readPixelFromDrawBuffer(hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
     if (this->layerRotation == rotation0) {
-        hwx = x;
-        hwy = y;
+        readPixelForRotation = &SMLayerBackground::template readPixelRotated<rotation0>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
     } else if (this->layerRotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
+        readPixelForRotation = &SMLayerBackground::template readPixelRotated<rotation180>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation180>::hardwareToLocal;
     } else if (this->layerRotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
+        readPixelForRotation = &SMLayerBackground::template readPixelRotated<rotation90>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation90>::hardwareToLocal;
     } else { /* if (layerRotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
+        readPixelForRotation = &SMLayerBackground::template readPixelRotated<rotation270>;
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation270>::hardwareToLocal;
     }
+}
 
-    loadPixelToDrawBuffer(hwx, hwy, color);
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
+    SM_CALL_FOR_LAYER_ROTATION(drawPixelClipped, x, y, color);
 }
 
 // x0, x1, and y must be in bounds (0-this->localWidth/Height-1), x1 > x0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color) {
-    int i;
-
-    for (i = x0; i <= x1; i++) {
-        loadPixelToDrawBuffer(i, y, color);
-    }
+    fillRGB(&currentDrawBufferPtr[(y * this->matrixWidth) + x0], x1 - x0 + 1, color);
+    markHardwareRegionDrawn(x0, y, x1, y);
 }
 
 // x, y0, and y1 must be in bounds (0-this->localWidth/Height-1), y1 > y0
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color) {
-    int i;
+    RGB *ptr = &currentDrawBufferPtr[(y0 * this->matrixWidth) + x];
 
-    for (i = y0; i <= y1; i++) {
-        loadPixelToDrawBuffer(x, i, color);
+    for (int i = y0; i <= y1; i++, ptr += this->matrixWidth) {
+        *ptr = color;
     }
+    markHardwareRegionDrawn(x, y0, x, y1);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -327,16 +777,7 @@ void SMLayerBackground<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1,
     if (x1 >= this->localWidth)
         x1 = this->localWidth - 1;
 
-    // map to hardware drawline function
-    if (this->layerRotation == rotation0) {
-        drawHardwareHLine(x0, x1, y, color);
-    } else if (this->layerRotation == rotation180) {
-        drawHardwareHLine((this->matrixWidth - 1) - x1, (this->matrixWidth - 1) - x0, (this->matrixHeight - 1) - y, color);
-    } else if (this->layerRotation == rotation90) {
-        drawHardwareVLine((this->matrixWidth - 1) - y, x0, x1, color);
-    } else { /* if (rotation == rotation270)*/
-        drawHardwareVLine(y, (this->matrixHeight - 1) - x1, (this->matrixHeight - 1) - x0, color);
-    }
+    drawLocalHLine(x0, x1, y, color);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -356,35 +797,82 @@ void SMLayerBackground<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, i
     if (y1 >= this->localHeight)
         y1 = this->localHeight - 1;
 
-    // map to hardware drawline function
-    if (this->layerRotation == rotation0) {
-        drawHardwareVLine(x, y0, y1, color);
-    } else if (this->layerRotation == rotation180) {
-        drawHardwareVLine((this->matrixWidth - 1) - x, (this->matrixHeight - 1) - y1, (this->matrixHeight - 1) - y0, color);
-    } else if (this->layerRotation == rotation90) {
-        drawHardwareHLine((this->matrixWidth - 1) - y1, (this->matrixWidth - 1) - y0, x, color);
-    } else { /* if (layerRotation == rotation270)*/
-        drawHardwareHLine(y0, y1, (this->matrixHeight - 1) - x, color);
-    }
+    drawLocalVLine(x, y0, y1, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackground<RGB, optionFlags>::drawLocalHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color) {
+    // map to hardware drawline function, the line is a hardware row for rotation0/180 and a strided hardware column for rotation90/270
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y, ax, ay);
+    mapLocalToHardware(x1, y, bx, by);
+
+    if (ay == by)
+        drawHardwareHLine(std::min(ax, bx), std::max(ax, bx), ay, color);
+    else
+        drawHardwareVLine(ax, std::min(ay, by), std::max(ay, by), color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackground<RGB, optionFlags>::drawLocalVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color) {
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x, y0, ax, ay);
+    mapLocalToHardware(x, y1, bx, by);
+
+    if (ay == by)
+        drawHardwareHLine(std::min(ax, bx), std::max(ax, bx), ay, color);
+    else
+        drawHardwareVLine(ax, std::min(ay, by), std::max(ay, by), color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+INLINE bool SMLayerBackground<RGB, optionFlags>::isRegionOffLayer(int x0, int y0, int x1, int y1) {
+    return (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight);
 }
 
+// steps along u pixel i is v1 + k(i) * direction from, with k(i) = max(0, ceil((i * Dy - du) / Dx)), the same error term the
+// original stepping loop keeps, so the walk can start at the first step on the layer with the same pixels as walking from u1
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::bresteepline(int16_t x3, int16_t y3, int16_t x4, int16_t y4, const RGB& color) {
-    // if point x3, y3 is on the right side of point x4, y4, change them
-    if ((x3 - x4) > 0) {
-        bresteepline(x4, y4, x3, y3, color);
+void SMLayerBackground<RGB, optionFlags>::drawClippedLine(int16_t u1, int16_t v1, int16_t u2, int16_t v2, bool steep, const RGB& color) {
+    int uMax = (steep ? this->localHeight : this->localWidth) - 1;
+    int vMax = (steep ? this->localWidth : this->localHeight) - 1;
+    int du = u2 - u1, dv = abs(v2 - v1);
+    int32_t Dx = 2 * du, Dy = 2 * dv;
+    int direction = ((v2 - v1) > 0) ? 1 : -1;
+
+    // steps with u on the layer
+    int first = std::max(0, -u1);
+    int last = std::min(du, uMax - u1);
+
+    // k(i) only grows, so the steps with v on the layer are a range too
+    int kLow = (direction > 0) ? -v1 : v1 - vMax;
+    int kHigh = (direction > 0) ? vMax - v1 : v1;
+    if (kHigh < 0 || kLow > dv)
+        return;
+    if (kLow > 0)
+        first = std::max<int64_t>(first, ((int64_t)(kLow - 1) * Dx + du) / Dy + 1);
+    if (kHigh < dv)
+        last = std::min<int64_t>(last, ((int64_t)kHigh * Dx + du) / Dy);
+    if (first > last)
         return;
-    }
 
-    int x = x3, y = y3, sum = x4 - x3,  Dx = 2 * (x4 - x3), Dy = abs(2 * (y4 - y3));
-    int prirastokDy = ((y4 - y3) > 0) ? 1 : -1;
+    int64_t over = (int64_t)first * Dy - du;
+    int32_t k = (over > 0) ? (over + Dx - 1) / Dx : 0;
+    int32_t sum = du - (int64_t)first * Dy + (int64_t)k * Dx;
+    int u = u1 + first, v = v1 + direction * k;
+    int runStart = u;
 
-    for (int i = 0; i <= x4 - x3; i++) {
-        drawPixel(y, x, color);
-        x++;
+    for (int i = first; i <= last; i++, u++) {
         sum -= Dy;
+        if (sum < 0 || i == last) {
+            if (steep)
+                drawLocalVLine(v, runStart, u, color);
+            else
+                drawLocalHLine(runStart, u, v, color);
+            runStart = u + 1;
+        }
         if (sum < 0) {
-            y = y + prirastokDy;
+            v += direction;
             sum += Dx;
         }
     }
@@ -398,51 +886,43 @@ void SMLayerBackground<RGB, optionFlags>::drawLine(int16_t x1, int16_t y1, int16
         drawLine(x2, y2, x1, y1, color);
         return;
     }
-    // test inclination of line
-    // function Math.abs(y) defines absolute value y
+    // a steep line is walked along y from its top point
     if (abs(y2 - y1) > abs(x2 - x1)) {
-        // line and y axis angle is less then 45 degrees
-        // thats why go on the next procedure
-        bresteepline(y1, x1, y2, x2, color); return;
-    }
-    // line and x axis angle is less then 45 degrees, so x is guiding
-    // auxiliary variables
-    int x = x1, y = y1, sum = x2 - x1, Dx = 2 * (x2 - x1), Dy = abs(2 * (y2 - y1));
-    int prirastokDy = ((y2 - y1) > 0) ? 1 : -1;
-    // draw line
-    for (int i = 0; i <= x2 - x1; i++) {
-        drawPixel(x, y, color);
-        x++;
-        sum -= Dy;
-        if (sum < 0) {
-            y = y + prirastokDy;
-            sum += Dx;
-        }
+        if (y1 > y2)
+            drawClippedLine(y2, x2, y1, x1, true, color);
+        else
+            drawClippedLine(y1, x1, y2, x2, true, color);
+        return;
     }
+    drawClippedLine(x1, y1, x2, y2, false, color);
 }
 
 // algorithm from http://en.wikipedia.org/wiki/Midpoint_circle_algorithm
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color)
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::drawCircleRotated(int16_t x0, int16_t y0, uint16_t radius, const RGB& color)
 {
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
+    if (isRegionOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
+        return;
+
     if (radius == 0) {
-        drawPixel(x0, y0, color);
+        drawPixelClipped<rotation>(x0, y0, color);
         return;
     }
 
     while (a >= b)
     {
-        drawPixel(a + x0, b + y0, color);
-        drawPixel(b + x0, a + y0, color);
-        drawPixel(-a + x0, b + y0, color);
-        drawPixel(-b + x0, a + y0, color);
-        drawPixel(-a + x0, -b + y0, color);
-        drawPixel(-b + x0, -a + y0, color);
-        drawPixel(a + x0, -b + y0, color);
-        drawPixel(b + x0, -a + y0, color);
+        drawPixelClipped<rotation>(a + x0, b + y0, color);
+        drawPixelClipped<rotation>(b + x0, a + y0, color);
+        drawPixelClipped<rotation>(-a + x0, b + y0, color);
+        drawPixelClipped<rotation>(-b + x0, a + y0, color);
+        drawPixelClipped<rotation>(-a + x0, -b + y0, color);
+        drawPixelClipped<rotation>(-b + x0, -a + y0, color);
+        drawPixelClipped<rotation>(a + x0, -b + y0, color);
+        drawPixelClipped<rotation>(b + x0, -a + y0, color);
 
         b++;
         if (radiusError < 0)
@@ -455,14 +935,21 @@ void SMLayerBackground<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uin
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color)
+{
+    SM_CALL_FOR_LAYER_ROTATION(drawCircleRotated, x0, y0, radius, color);
+}
+
 // algorithm from drawCircle rearranged with hlines drawn between points on the radius
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor)
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::fillCircleRotated(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor)
 {
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
-    if (radius == 0)
+    if (radius == 0 || isRegionOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
         return;
 
     // only draw one line per row, skipping the top and bottom
@@ -471,22 +958,22 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
     while (a >= b)
     {
         // this pair sweeps from horizontal center down
-        drawPixel(a + x0, b + y0, outlineColor);
-        drawPixel(-a + x0, b + y0, outlineColor);
+        drawPixelClipped<rotation>(a + x0, b + y0, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, b + y0, outlineColor);
         drawFastHLine((a - 1) + x0, (-a + 1) + x0, b + y0, fillColor);
 
         // this pair sweeps from bottom up
-        drawPixel(b + x0, a + y0, outlineColor);
-        drawPixel(-b + x0, a + y0, outlineColor);
+        drawPixelClipped<rotation>(b + x0, a + y0, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, a + y0, outlineColor);
 
         // this pair sweeps from horizontal center up
-        drawPixel(-a + x0, -b + y0, outlineColor);
-        drawPixel(a + x0, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(a + x0, -b + y0, outlineColor);
         drawFastHLine((a - 1) + x0, (-a + 1) + x0, -b + y0, fillColor);
 
         // this pair sweeps from top down
-        drawPixel(-b + x0, -a + y0, outlineColor);
-        drawPixel(b + x0, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(b + x0, -a + y0, outlineColor);
 
         if (b > 1 && !hlineDrawn) {
             drawFastHLine((b - 1) + x0, (-b + 1) + x0, a + y0, fillColor);
@@ -505,6 +992,12 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor)
+{
+    SM_CALL_FOR_LAYER_ROTATION(fillCircleRotated, x0, y0, radius, outlineColor, fillColor);
+}
+
 // algorithm from drawCircle rearranged with hlines drawn between points on the raidus
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& fillColor)
@@ -512,7 +1005,7 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
-    if (radius == 0)
+    if (radius == 0 || isRegionOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
         return;
 
     // only draw one line per row, skipping the top and bottom
@@ -545,7 +1038,17 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
 
 // from https://web.archive.org/web/20120225095359/http://homepage.smc.edu/kennedy_john/belipse.pdf
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color) {
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::drawEllipseRotated(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color) {
+    if (isRegionOffLayer(x0 - radiusX, y0 - radiusY, x0 + radiusX, y0 + radiusY))
+        return;
+
+    // the point set loops below never end with both radii 0
+    if (!radiusX && !radiusY) {
+        drawPixelClipped<rotation>(x0, y0, color);
+        return;
+    }
+
     int32_t twoASquare = 2 * radiusX * radiusX;
     int32_t twoBSquare = 2 * radiusY * radiusY;
     
@@ -558,10 +1061,10 @@ void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, ui
     int32_t stoppingY = 0;
     
     while (stoppingX >= stoppingY) {    // first set of points, y' > -1
-        drawPixel(x0 + x, y0 + y, color);
-        drawPixel(x0 - x, y0 + y, color);
-        drawPixel(x0 - x, y0 - y, color);
-        drawPixel(x0 + x, y0 - y, color);
+        drawPixelClipped<rotation>(x0 + x, y0 + y, color);
+        drawPixelClipped<rotation>(x0 - x, y0 + y, color);
+        drawPixelClipped<rotation>(x0 - x, y0 - y, color);
+        drawPixelClipped<rotation>(x0 + x, y0 - y, color);
         
         y++;
         stoppingY += twoASquare;
@@ -587,10 +1090,10 @@ void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, ui
     stoppingY = twoASquare * radiusY;
     
     while (stoppingX <= stoppingY) {    // second set of points, y' < -1
-        drawPixel(x0 + x, y0 + y, color);
-        drawPixel(x0 - x, y0 + y, color);
-        drawPixel(x0 - x, y0 - y, color);
-        drawPixel(x0 + x, y0 - y, color);
+        drawPixelClipped<rotation>(x0 + x, y0 + y, color);
+        drawPixelClipped<rotation>(x0 - x, y0 + y, color);
+        drawPixelClipped<rotation>(x0 - x, y0 - y, color);
+        drawPixelClipped<rotation>(x0 + x, y0 - y, color);
         
         x++;
         stoppingX += twoBSquare;
@@ -606,6 +1109,11 @@ void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, ui
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color) {
+    SM_CALL_FOR_LAYER_ROTATION(drawEllipseRotated, x0, y0, radiusX, radiusY, color);
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
   uint16_t radius, const RGB& fillColor) {
@@ -613,7 +1121,8 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::fillRoundRectangleRotated(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
   uint16_t radius, const RGB& outlineColor, const RGB& fillColor) {
     if (x1 < x0)
         SWAPint(x1, x0);
@@ -627,11 +1136,15 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
     if(radius > (y1-y0)/2)
         radius = (y1-y0)/2;
 
+    if (isRegionOffLayer(x0, y0, x1, y1))
+        return;
+
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
     if (radius == 0) {
         fillRectangle(x0, y0, x1, y1, outlineColor, fillColor);
+        return;
     }
 
     // draw straight part of outline
@@ -653,12 +1166,12 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
     while (a >= b)
     {
         // this pair sweeps from far left towards right
-        drawPixel(-a + x0, -b + y0, outlineColor);
-        drawPixel(-a + x0, b + y1, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, b + y1, outlineColor);
 
         // this pair sweeps from far right towards left
-        drawPixel(a + x1, -b + y0, outlineColor);
-        drawPixel(a + x1, b + y1, outlineColor);
+        drawPixelClipped<rotation>(a + x1, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(a + x1, b + y1, outlineColor);
 
         if (!vlineDrawn) {
             drawFastVLine(-a + x0, (-b + 1) + y0, (b - 1) + y1, fillColor);
@@ -667,12 +1180,12 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
         }
 
         // this pair sweeps from very top towards bottom
-        drawPixel(-b + x0, -a + y0, outlineColor);
-        drawPixel(b + x1, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(b + x1, -a + y0, outlineColor);
 
         // this pair sweeps from bottom up
-        drawPixel(-b + x0, a + y1, outlineColor);
-        drawPixel(b + x1, a + y1, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, a + y1, outlineColor);
+        drawPixelClipped<rotation>(b + x1, a + y1, outlineColor);
 
         if (!hlineDrawn) {
             drawFastHLine((-b + 1) + x0, (b - 1) + x1, -a + y0, fillColor);
@@ -696,7 +1209,14 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+  uint16_t radius, const RGB& outlineColor, const RGB& fillColor) {
+    SM_CALL_FOR_LAYER_ROTATION(fillRoundRectangleRotated, x0, y0, x1, y1, radius, outlineColor, fillColor);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <rotationDegrees rotation>
+void SMLayerBackground<RGB, optionFlags>::drawRoundRectangleRotated(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
   uint16_t radius, const RGB& outlineColor) {
     if (x1 < x0)
         SWAPint(x1, x0);
@@ -710,6 +1230,9 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     if(radius > (y1-y0)/2)
         radius = (y1-y0)/2;
 
+    if (isRegionOffLayer(x0, y0, x1, y1))
+        return;
+
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
@@ -728,20 +1251,20 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     while (a >= b)
     {
         // this pair sweeps from far left towards right
-        drawPixel(-a + x0, -b + y0, outlineColor);
-        drawPixel(-a + x0, b + y1, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(-a + x0, b + y1, outlineColor);
 
         // this pair sweeps from far right towards left
-        drawPixel(a + x1, -b + y0, outlineColor);
-        drawPixel(a + x1, b + y1, outlineColor);
+        drawPixelClipped<rotation>(a + x1, -b + y0, outlineColor);
+        drawPixelClipped<rotation>(a + x1, b + y1, outlineColor);
 
         // this pair sweeps from very top towards bottom
-        drawPixel(-b + x0, -a + y0, outlineColor);
-        drawPixel(b + x1, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, -a + y0, outlineColor);
+        drawPixelClipped<rotation>(b + x1, -a + y0, outlineColor);
 
         // this pair sweeps from bottom up
-        drawPixel(-b + x0, a + y1, outlineColor);
-        drawPixel(b + x1, a + y1, outlineColor);
+        drawPixelClipped<rotation>(-b + x0, a + y1, outlineColor);
+        drawPixelClipped<rotation>(b + x1, a + y1, outlineColor);
 
         b++;
         if (radiusError < 0) {
@@ -753,6 +1276,12 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+  uint16_t radius, const RGB& outlineColor) {
+    SM_CALL_FOR_LAYER_ROTATION(drawRoundRectangleRotated, x0, y0, x1, y1, radius, outlineColor);
+}
+
 // Code from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, int16_t y1, int16_t x2, int16_t y2,
@@ -799,6 +1328,10 @@ void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, in
 
     for (i = 0; i <= dx1; i++)
     {
+        // rows only move away from the apex, so once past the far edge of the layer the rest of the triangle is off it too
+        if ((signy1 > 0) ? (t1y >= this->localHeight) : (t1y < 0))
+            break;
+
         drawFastHLine(t1x, t2x, t1y, color);
 
         while (dx1 > 0 && e1 >= 0)
@@ -844,6 +1377,9 @@ void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, in
 // Code from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& fillColor) {
+    if (isRegionOffLayer(std::min(x1, std::min(x2, x3)), std::min(y1, std::min(y2, y3)), std::max(x1, std::max(x2, x3)), std::max(y1, std::max(y2, y3))))
+        return;
+
     // Sort vertices
     if (y1 > y2) {
         SWAPint(y1, y2);
@@ -912,14 +1448,110 @@ void SMLayerBackground<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0,
         SWAPint(x0, x1);
     };
 
-    for (i = y0; i <= y1; i++) {
-        drawFastHLine(x0, x1, i, color);
+    // check for completely out of bounds rectangle, and truncate if partially out of bounds
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    waitForFill();
+
+    // every rotation maps the rectangle to a rectangle in the hardware buffer, which is filled one hardware row at a time
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+
+    uint16_t hwx0 = std::min(ax, bx);
+    uint16_t hwx1 = std::max(ax, bx);
+    uint16_t hwy0 = std::min(ay, by);
+    uint16_t hwy1 = std::max(ay, by);
+
+    RGB *rowPtr = &currentDrawBufferPtr[(hwy0 * this->matrixWidth) + hwx0];
+    for (i = hwy0; i <= hwy1; i++, rowPtr += this->matrixWidth) {
+        fillRGB(rowPtr, hwx1 - hwx0 + 1, color);
     }
+    markHardwareRegionDrawn(hwx0, hwy0, hwx1, hwy1);
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillScreen(const RGB& color) {
-    fillRectangle(0, 0, this->localWidth - 1, this->localHeight - 1, color);
+    waitForFill();
+
+    fillRGB(currentDrawBufferPtr, this->matrixWidth * this->matrixHeight, color);
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillScreenAsync(const RGB& color) {
+    waitForFill();
+
+#if defined(__IMXRT1062__)
+    uint32_t rowBytes = sizeof(RGB) * this->matrixWidth;
+    int numRows = this->matrixHeight - 1;
+
+    // with minor loop linking the major loop count is limited to 9 bits
+    if(numRows < 1 || numRows > 511) {
+        fillScreen(color);
+        return;
+    }
+
+    if(!fillDMA)
+        fillDMA = new DMAChannel();
+
+    fillRGB(currentDrawBufferPtr, this->matrixWidth, color);
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+
+    // write out the first row for eDMA to read, and drop any cached lines of the rows eDMA is about to write
+    arm_dcache_flush_delete(currentDrawBufferPtr, rowBytes * this->matrixHeight);
+
+    // each minor loop copies the previous row into the next, reading only bytes it has already written, and links to itself to request the next row
+    // so other channels (e.g. refresh) get the bus between rows
+    int transferSize = (((uint32_t)currentDrawBufferPtr | rowBytes) & 3) ? 1 : 4;
+    fillDMA->TCD->SADDR = currentDrawBufferPtr;
+    fillDMA->TCD->SOFF = transferSize;
+    fillDMA->TCD->ATTR = (transferSize == 4) ? (DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2)) : (DMA_TCD_ATTR_SSIZE(0) | DMA_TCD_ATTR_DSIZE(0));
+    fillDMA->TCD->NBYTES_MLNO = rowBytes;
+    fillDMA->TCD->SLAST = 0;
+    fillDMA->TCD->DADDR = currentDrawBufferPtr + this->matrixWidth;
+    fillDMA->TCD->DOFF = transferSize;
+    fillDMA->TCD->CITER_ELINKYES = DMA_TCD_CITER_ELINKYES_ELINK | DMA_TCD_CITER_ELINKYES_LINKCH(fillDMA->channel) | DMA_TCD_CITER_ELINKYES_CITER_ELINKYES(numRows);
+    fillDMA->TCD->DLASTSGA = 0;
+    fillDMA->TCD->BITER_ELINKYES = DMA_TCD_BITER_ELINKYES_ELINK | DMA_TCD_BITER_ELINKYES_LINKCH(fillDMA->channel) | DMA_TCD_BITER_ELINKYES_BITER_ELINKYES(numRows);
+    fillDMA->TCD->CSR = DMA_TCD_CSR_DREQ;
+    fillDMA->triggerManual();
+
+    fillPending = true;
+#else
+    // no memory to memory DMA available for the layer buffers, fill with wide stores instead
+    fillScreen(color);
+#endif
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isFillComplete(void) {
+#if defined(__IMXRT1062__)
+    if(fillPending && fillDMA->complete())
+        waitForFill();
+
+    return !fillPending;
+#else
+    return true;
+#endif
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::waitForFill(void) {
+#if defined(__IMXRT1062__)
+    if(!fillPending)
+        return;
+
+    while(!fillDMA->complete());
+    fillDMA->clearComplete();
+    fillPending = false;
+#endif
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -930,179 +1562,1040 @@ void SMLayerBackground<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0,
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setFont(fontChoices newFont) {
-    font = (bitmap_font *)fontLookup(newFont);
+    setFont(fontLookup(newFont));
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawChar(int16_t x, int16_t y, const RGB& charColor, char character) {
-    int xcnt, ycnt;
+void SMLayerBackground<RGB, optionFlags>::setFont(const bitmap_font *newFont) {
+    font = (bitmap_font *)newFont;
 
-    for (ycnt = 0; ycnt < font->Height; ycnt++) {
-        for (xcnt = 0; xcnt < font->Width; xcnt++) {
-            if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
-                drawPixel(x + xcnt, y + ycnt, charColor);
-            }
-        }
-    }
+#ifdef SM_FONT_PRELOAD_ASCII
+    preloadBitmapFontGlyphs(font, ' ', '~');
+#endif
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]) {
-    int xcnt, ycnt, offset = 0;
-    char character;
-
-    while ((character = text[offset++]) != '\0') {
-        for (ycnt = 0; ycnt < font->Height; ycnt++) {
-            for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
-                    drawPixel(x + xcnt, y + ycnt, charColor);
-                }
-            }
+void SMLayerBackground<RGB, optionFlags>::getLocalToHardwareStrides(int &origin, int &xStride, int &yStride) {
+    // the mapping is linear, so the strides are the steps from local (0,0) to (1,0) and (0,1)
+    int16_t hwx, hwy;
+
+    mapLocalToHardware(0, 0, hwx, hwy);
+    origin = (hwy * this->matrixWidth) + hwx;
+    mapLocalToHardware(1, 0, hwx, hwy);
+    xStride = (hwy * this->matrixWidth) + hwx - origin;
+    mapLocalToHardware(0, 1, hwx, hwy);
+    yStride = (hwy * this->matrixWidth) + hwx - origin;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename SRC>
+void SMLayerBackground<RGB, optionFlags>::drawBitmapRows(RGB *dstRow, int xStride, int yStride, const uint8_t *srcRow, uint16_t srcStride, uint16_t numPixels, uint16_t numRows) {
+    for (int row = 0; row < numRows; row++, dstRow += yStride, srcRow += srcStride) {
+        const SRC *src = (const SRC *)srcRow;
+
+        // each pixel type has a different size, so equal sizes means the source is already in the layer's format
+        if (sizeof(SRC) == sizeof(RGB) && xStride == 1) {
+            memcpy((void *)dstRow, src, sizeof(RGB) * numPixels);
+        } else {
+            RGB *dst = dstRow;
+            for (int i = 0; i < numPixels; i++, dst += xStride)
+                *dst = RGB(src[i]);
         }
-        x += font->Width;
     }
 }
 
-// draw string while clearing background
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]) {
-    int xcnt, ycnt, offset = 0;
-    char character;
-
-    while ((character = text[offset++]) != '\0') {
-        for (ycnt = 0; ycnt < font->Height; ycnt++) {
-            for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
-                    drawPixel(x + xcnt, y + ycnt, charColor);
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, smBitmapFormat format, uint16_t stride, const rgb24 *palette) {
+    const uint8_t srcPixelBytes[] = {3, 2, 1, 1};
+    if (!src || (format == SM_BITMAP_FORMAT_INDEXED8 && !palette))
+        return;
+
+    if (!stride)
+        stride = width * srcPixelBytes[format];
+
+    // clip against the layer once
+    int col0 = (x < 0) ? -x : 0;
+    int row0 = (y < 0) ? -y : 0;
+    int col1 = std::min<int>(width, this->localWidth - x);
+    int row1 = std::min<int>(height, this->localHeight - y);
+
+    if (col1 <= col0 || row1 <= row0)
+        return;
+
+    waitForFill();
+    markRegionDirty(x + col0, y + row0, x + col1 - 1, y + row1 - 1);
+
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+    RGB *dstRow = currentDrawBufferPtr + origin + ((x + col0) * xStride) + ((y + row0) * yStride);
+    const uint8_t *srcRow = (const uint8_t *)src + (row0 * stride) + (col0 * srcPixelBytes[format]);
+    uint16_t numPixels = col1 - col0;
+    uint16_t numRows = row1 - row0;
+
+    switch (format) {
+        case SM_BITMAP_FORMAT_RGB24:
+            drawBitmapRows<rgb24>(dstRow, xStride, yStride, srcRow, stride, numPixels, numRows);
+            break;
+        case SM_BITMAP_FORMAT_RGB565:
+            drawBitmapRows<rgb16>(dstRow, xStride, yStride, srcRow, stride, numPixels, numRows);
+            break;
+        case SM_BITMAP_FORMAT_RGB332:
+            drawBitmapRows<rgb8>(dstRow, xStride, yStride, srcRow, stride, numPixels, numRows);
+            break;
+        case SM_BITMAP_FORMAT_INDEXED8:
+            for (int row = 0; row < numRows; row++, dstRow += yStride, srcRow += stride) {
+                RGB *dst = dstRow;
+                for (int i = 0; i < numPixels; i++, dst += xStride)
+                    *dst = RGB(palette[srcRow[i]]);
+            }
+            break;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename DST, typename SRC>
+INLINE DST SMLayerBackground<RGB, optionFlags>::scaledBitmapPixel(const uint8_t *row, uint16_t col, const rgb24 *palette) {
+    if (palette)
+        return DST(palette[row[col]]);
+    return DST(((const SRC *)row)[col]);
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename SRC>
+void SMLayerBackground<RGB, optionFlags>::drawScaledBitmapRows(RGB *dstOrigin, int xStride, int yStride, const uint8_t *src, uint16_t srcStride,
+  uint16_t srcWidth, uint16_t srcHeight, int col0, int col1, int row0, int row1, uint32_t xStep, uint32_t yStep, smScaleMode mode, const rgb24 *palette) {
+    uint16_t srcCols[SM_SCALED_BITMAP_CHUNK_COLUMNS];
+    uint16_t srcNextCols[SM_SCALED_BITMAP_CHUNK_COLUMNS];
+    uint8_t colWeights[SM_SCALED_BITMAP_CHUNK_COLUMNS];
+
+    for (int chunk = col0; chunk < col1; chunk += SM_SCALED_BITMAP_CHUNK_COLUMNS) {
+        int numPixels = std::min<int>(SM_SCALED_BITMAP_CHUNK_COLUMNS, col1 - chunk);
+
+        // sample at the center of each pixel, bilinear blends toward the next column by the fraction past the center of the source pixel
+        for (int i = 0; i < numPixels; i++) {
+            uint32_t position = (chunk + i) * xStep + (xStep >> 1);
+            if (mode == SM_SCALE_BILINEAR)
+                position = (position >= 0x8000) ? position - 0x8000 : 0;
+            srcCols[i] = std::min<uint32_t>(position >> 16, srcWidth - 1);
+            srcNextCols[i] = std::min<int>(srcCols[i] + 1, srcWidth - 1);
+            colWeights[i] = (position >> 8) & 0xff;
+        }
+
+        RGB *lastDst = NULL;
+        int lastSrcRow = -1;
+        uint8_t lastRowWeight = 0;
+
+        for (int row = row0; row < row1; row++) {
+            RGB *dst = dstOrigin + ((chunk - col0) * xStride) + ((row - row0) * yStride);
+
+            uint32_t position = row * yStep + (yStep >> 1);
+            if (mode == SM_SCALE_BILINEAR)
+                position = (position >= 0x8000) ? position - 0x8000 : 0;
+            int srcRow = std::min<uint32_t>(position >> 16, srcHeight - 1);
+            int srcNextRow = std::min<int>(srcRow + 1, srcHeight - 1);
+            uint8_t rowWeight = (mode == SM_SCALE_BILINEAR && srcNextRow != srcRow) ? (position >> 8) & 0xff : 0;
+
+            // same source row and weight as the last row, so the same pixels
+            if (lastDst && srcRow == lastSrcRow && rowWeight == lastRowWeight) {
+                if (xStride == 1) {
+                    memcpy(dst, lastDst, sizeof(RGB) * numPixels);
                 } else {
-                    drawPixel(x + xcnt, y + ycnt, backColor);
+                    for (int i = 0; i < numPixels; i++)
+                        dst[i * xStride] = lastDst[i * xStride];
                 }
+                lastDst = dst;
+                continue;
             }
+
+            const uint8_t *srcLine = src + (srcRow * srcStride);
+            const uint8_t *srcNextLine = src + (srcNextRow * srcStride);
+
+            if (mode == SM_SCALE_NEAREST) {
+                for (int i = 0; i < numPixels; i++)
+                    dst[i * xStride] = scaledBitmapPixel<RGB, SRC>(srcLine, srcCols[i], palette);
+            } else {
+                for (int i = 0; i < numPixels; i++) {
+                    uint32_t colWeight = colWeights[i];
+                    rgb48 left = scaledBitmapPixel<rgb48, SRC>(srcLine, srcCols[i], palette);
+                    rgb48 right = scaledBitmapPixel<rgb48, SRC>(srcLine, srcNextCols[i], palette);
+                    uint32_t r = (left.red * (256 - colWeight) + right.red * colWeight) >> 8;
+                    uint32_t g = (left.green * (256 - colWeight) + right.green * colWeight) >> 8;
+                    uint32_t b = (left.blue * (256 - colWeight) + right.blue * colWeight) >> 8;
+
+                    if (rowWeight) {
+                        left = scaledBitmapPixel<rgb48, SRC>(srcNextLine, srcCols[i], palette);
+                        right = scaledBitmapPixel<rgb48, SRC>(srcNextLine, srcNextCols[i], palette);
+                        uint32_t nextR = (left.red * (256 - colWeight) + right.red * colWeight) >> 8;
+                        uint32_t nextG = (left.green * (256 - colWeight) + right.green * colWeight) >> 8;
+                        uint32_t nextB = (left.blue * (256 - colWeight) + right.blue * colWeight) >> 8;
+                        r = (r * (256 - rowWeight) + nextR * rowWeight) >> 8;
+                        g = (g * (256 - rowWeight) + nextG * rowWeight) >> 8;
+                        b = (b * (256 - rowWeight) + nextB * rowWeight) >> 8;
+                    }
+                    dst[i * xStride] = RGB(rgb48(r, g, b));
+                }
+            }
+
+            lastDst = dst;
+            lastSrcRow = srcRow;
+            lastRowWeight = rowWeight;
         }
-        x += font->Width;
     }
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height,
-  const RGB& bitmapColor, const uint8_t *bitmap) {
-    int xcnt, ycnt;
+void SMLayerBackground<RGB, optionFlags>::drawBitmapScaled(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, uint16_t srcWidth, uint16_t srcHeight,
+  smBitmapFormat format, smScaleMode mode, uint16_t stride, const rgb24 *palette) {
+    const uint8_t srcPixelBytes[] = {3, 2, 1, 1};
+    if (!src || !width || !height || !srcWidth || !srcHeight || (format == SM_BITMAP_FORMAT_INDEXED8 && !palette))
+        return;
+
+    // unscaled is a plain copy
+    if (width == srcWidth && height == srcHeight) {
+        drawBitmap(x, y, width, height, src, format, stride, palette);
+        return;
+    }
+
+    if (!stride)
+        stride = srcWidth * srcPixelBytes[format];
+
+    int col0 = (x < 0) ? -x : 0;
+    int row0 = (y < 0) ? -y : 0;
+    int col1 = std::min<int>(width, this->localWidth - x);
+    int row1 = std::min<int>(height, this->localHeight - y);
+
+    if (col1 <= col0 || row1 <= row0)
+        return;
+
+    waitForFill();
+    markRegionDirty(x + col0, y + row0, x + col1 - 1, y + row1 - 1);
+
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+    RGB *dstOrigin = currentDrawBufferPtr + origin + ((x + col0) * xStride) + ((y + row0) * yStride);
+    uint32_t xStep = ((uint32_t)srcWidth << 16) / width;
+    uint32_t yStep = ((uint32_t)srcHeight << 16) / height;
+    const uint8_t *srcBytes = (const uint8_t *)src;
+
+    switch (format) {
+        case SM_BITMAP_FORMAT_RGB24:
+            drawScaledBitmapRows<rgb24>(dstOrigin, xStride, yStride, srcBytes, stride, srcWidth, srcHeight, col0, col1, row0, row1, xStep, yStep, mode, NULL);
+            break;
+        case SM_BITMAP_FORMAT_RGB565:
+            drawScaledBitmapRows<rgb16>(dstOrigin, xStride, yStride, srcBytes, stride, srcWidth, srcHeight, col0, col1, row0, row1, xStep, yStep, mode, NULL);
+            break;
+        case SM_BITMAP_FORMAT_RGB332:
+            drawScaledBitmapRows<rgb8>(dstOrigin, xStride, yStride, srcBytes, stride, srcWidth, srcHeight, col0, col1, row0, row1, xStep, yStep, mode, NULL);
+            break;
+        case SM_BITMAP_FORMAT_INDEXED8:
+            drawScaledBitmapRows<rgb8>(dstOrigin, xStride, yStride, srcBytes, stride, srcWidth, srcHeight, col0, col1, row0, row1, xStep, yStep, mode, palette);
+            break;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackground<RGB, optionFlags>::fillStridedRGB(RGB *ptr, int xStride, uint16_t numPixels, const RGB& color) {
+    if (xStride == 1) {
+        fillRGB(ptr, numPixels, color);
+    } else {
+        for (int i = 0; i < numPixels; i++, ptr += xStride)
+            *ptr = color;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+RGB SMLayerBackground<RGB, optionFlags>::interpolateRGB(const rgb48& startColor, const rgb48& endColor, uint32_t position, uint32_t length) {
+    if (length < 2)
+        return RGB(startColor);
+
+    int64_t steps = length - 1;
+    return RGB(rgb48(startColor.red + ((int64_t)(endColor.red - startColor.red) * position) / steps,
+        startColor.green + ((int64_t)(endColor.green - startColor.green) * position) / steps,
+        startColor.blue + ((int64_t)(endColor.blue - startColor.blue) * position) / steps));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillColorRamp(RGB ramp[], uint16_t length, const RGB& startColor, const RGB& endColor) {
+    for (int i = 0; i < length; i++)
+        ramp[i] = interpolateRGB(rgb48(startColor), rgb48(endColor), i, length);
+}
+
+// rgb24 and rgb48 buffers are handled as one run of channels, rgb24 four channels per word; rgb8 and rgb16 a pixel at a time
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fadeToBlackBy(uint8_t amount) {
+    waitForFill();
+
+    uint16_t weight = 256 - blendAlphaToWeight(amount);
+    uint32_t numPixels = this->matrixWidth * this->matrixHeight;
+    RGB * buffer = currentDrawBufferPtr;
+
+    if(sizeof(RGB) == 3) {
+        scaleChannels8((uint8_t *)buffer, 3 * numPixels, weight);
+    } else if(sizeof(RGB) == 6) {
+        sm_alias_uint16_t * channels = (sm_alias_uint16_t *)buffer;
+        for(uint32_t i=0; i<3 * numPixels; i++)
+            channels[i] = ((uint32_t)channels[i] * weight) >> 8;
+    } else {
+        for(uint32_t i=0; i<numPixels; i++)
+            buffer[i] = RGB(scaleRGB(rgb48(buffer[i]), weight));
+    }
+
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+// running sum over the window, the source pixels that have already been replaced are kept in a ring of the last radius + 1 pixels
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::blurLineBox(RGB *line, int stride, int length, int radius) {
+    RGB ring[SM_BLUR_MAX_RADIUS + 1];
+    const int window = 2 * radius + 1;
+    // 8-bit channels divide by multiplying with a 16.16 reciprocal, rounded up so a full window of the largest value stays the largest value
+    const uint32_t reciprocal = (65536 + window - 1) / window;
+
+    uint32_t sumRed = line[0].red * (radius + 1);
+    uint32_t sumGreen = line[0].green * (radius + 1);
+    uint32_t sumBlue = line[0].blue * (radius + 1);
+    for(int i=1; i<=radius; i++) {
+        const RGB & pixel = line[std::min(i, length - 1) * stride];
+        sumRed += pixel.red;
+        sumGreen += pixel.green;
+        sumBlue += pixel.blue;
+    }
+    for(int i=0; i<=radius; i++)
+        ring[i] = line[0];
+
+    for(int i=0; i<length; i++) {
+        RGB & pixel = line[i * stride];
+        ring[i % (radius + 1)] = pixel;
+
+        if(sizeof(RGB) > 3) {
+            pixel.red = sumRed / window;
+            pixel.green = sumGreen / window;
+            pixel.blue = sumBlue / window;
+        } else {
+            pixel.red = (sumRed * reciprocal) >> 16;
+            pixel.green = (sumGreen * reciprocal) >> 16;
+            pixel.blue = (sumBlue * reciprocal) >> 16;
+        }
+
+        // slide the window: the pixel leaving it is in the ring, the pixel entering it hasn't been replaced yet
+        const RGB & leaving = ring[(i + 1) % (radius + 1)];
+        const RGB & entering = line[std::min(i + radius + 1, length - 1) * stride];
+        sumRed += entering.red - leaving.red;
+        sumGreen += entering.green - leaving.green;
+        sumBlue += entering.blue - leaving.blue;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::blurLineBinomial(RGB *line, int stride, int length) {
+    RGB previous = line[0];
+
+    for(int i=0; i<length; i++) {
+        RGB & pixel = line[i * stride];
+        RGB current = pixel;
+        const RGB & next = line[std::min(i + 1, length - 1) * stride];
+
+        pixel.red = ((uint32_t)previous.red + 2 * current.red + next.red + 2) >> 2;
+        pixel.green = ((uint32_t)previous.green + 2 * current.green + next.green + 2) >> 2;
+        pixel.blue = ((uint32_t)previous.blue + 2 * current.blue + next.blue + 2) >> 2;
+        previous = current;
+    }
+}
+
+// both blurs are the same in every direction, so they run on hardware rows and columns without looking at the rotation
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::blurBox(uint8_t radius) {
+    radius = std::min<uint8_t>(radius, SM_BLUR_MAX_RADIUS);
+    if(!radius)
+        return;
+
+    waitForFill();
+
+    RGB * buffer = currentDrawBufferPtr;
+    for(int y=0; y<this->matrixHeight; y++)
+        blurLineBox(buffer + y * this->matrixWidth, 1, this->matrixWidth, radius);
+    for(int x=0; x<this->matrixWidth; x++)
+        blurLineBox(buffer + x, this->matrixWidth, this->matrixHeight, radius);
+
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::blurGaussian(uint8_t radius) {
+    radius = std::min<uint8_t>(radius, SM_BLUR_MAX_RADIUS);
+    if(!radius)
+        return;
+
+    waitForFill();
+
+    RGB * buffer = currentDrawBufferPtr;
+    for(int y=0; y<this->matrixHeight; y++) {
+        for(int pass=0; pass<radius; pass++)
+            blurLineBinomial(buffer + y * this->matrixWidth, 1, this->matrixWidth);
+    }
+    for(int x=0; x<this->matrixWidth; x++) {
+        for(int pass=0; pass<radius; pass++)
+            blurLineBinomial(buffer + x, this->matrixWidth, this->matrixHeight);
+    }
+
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+// the local shift is converted to a hardware shift, then each row is moved with one memmove, walking the rows so no
+// source row is overwritten before it's moved
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::shiftImage(int16_t dx, int16_t dy, const RGB& fillColor) {
+    int16_t originX, originY, shiftedX, shiftedY;
+    localToHardwareForRotation(0, 0, this->matrixWidth, this->matrixHeight, originX, originY);
+    localToHardwareForRotation(dx, dy, this->matrixWidth, this->matrixHeight, shiftedX, shiftedY);
+    int hwdx = shiftedX - originX;
+    int hwdy = shiftedY - originY;
+
+    if(!hwdx && !hwdy)
+        return;
+
+    if(abs(hwdx) >= this->matrixWidth || abs(hwdy) >= this->matrixHeight) {
+        fillScreen(fillColor);
+        return;
+    }
+
+    waitForFill();
+
+    RGB * buffer = currentDrawBufferPtr;
+    const int width = this->matrixWidth;
+    const int moved = width - abs(hwdx);
+
+    for(int i=0; i<this->matrixHeight; i++) {
+        int y = (hwdy > 0) ? (this->matrixHeight - 1) - i : i;
+        int srcY = y - hwdy;
+        RGB * dstRow = buffer + y * width;
+
+        if(srcY < 0 || srcY >= this->matrixHeight) {
+            fillRGB(dstRow, width, fillColor);
+            continue;
+        }
+
+        RGB * srcRow = buffer + srcY * width;
+        if(hwdx >= 0) {
+            memmove(dstRow + hwdx, srcRow, sizeof(RGB) * moved);
+            fillRGB(dstRow, hwdx, fillColor);
+        } else {
+            memmove(dstRow, srcRow - hwdx, sizeof(RGB) * moved);
+            fillRGB(dstRow + moved, -hwdx, fillColor);
+        }
+    }
+
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::addFeedback(uint8_t weight) {
+    waitForFill();
+
+    // the last frame is only the refresh buffer once refresh has picked it up
+    if(!(optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER))
+        while(swapPending);
+
+    uint16_t srcWeight = blendAlphaToWeight(weight);
+    uint32_t numPixels = this->matrixWidth * this->matrixHeight;
+    RGB * buffer = currentDrawBufferPtr;
+    const RGB * previous = backgroundBuffers[lastSwappedBuffer];
+
+    if(previous == buffer || !srcWeight)
+        return;
+
+    if(sizeof(RGB) == 3) {
+        addScaledChannels8((uint8_t *)buffer, (const uint8_t *)previous, 3 * numPixels, srcWeight);
+    } else if(sizeof(RGB) == 6) {
+        sm_alias_uint16_t * channels = (sm_alias_uint16_t *)buffer;
+        const sm_alias_uint16_t * previousChannels = (const sm_alias_uint16_t *)previous;
+        for(uint32_t i=0; i<3 * numPixels; i++)
+            channels[i] = std::min<uint32_t>(0xFFFF, channels[i] + (((uint32_t)previousChannels[i] * srcWeight) >> 8));
+    } else {
+        for(uint32_t i=0; i<numPixels; i++)
+            buffer[i] = RGB(addRGBSaturating(rgb48(buffer[i]), scaleRGB(rgb48(previous[i]), srcWeight)));
+    }
+
+    markHardwareRegionDrawn(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBarGraph(int16_t x, int16_t baseY, uint8_t barWidth, uint8_t barSpacing, const uint8_t heights[], uint16_t numBars,
+  const RGB colorRamp[], uint16_t rampLength, const RGB *backColor) {
+    if (!heights || !colorRamp || !numBars || !barWidth || !rampLength)
+        return;
+
+    // rows of the ramp that are on the layer, n rows above the base is local row baseY - n
+    int firstRow = std::max<int>(0, baseY - (this->localHeight - 1));
+    int lastRow = std::min<int>(rampLength - 1, baseY);
+    if (lastRow < firstRow)
+        return;
+
+    waitForFill();
+
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+
+    int drawnX0 = this->localWidth;
+    int drawnX1 = -1;
+    int drawnTop = baseY;
+
+    for (int bar = 0; bar < numBars; bar++) {
+        // clip the bar's columns, once for all of its rows
+        int col0 = std::max<int>(0, x + bar * (barWidth + barSpacing));
+        int col1 = std::min<int>(this->localWidth - 1, x + bar * (barWidth + barSpacing) + barWidth - 1);
+        if (col1 < col0)
+            continue;
+
+        int height = std::min<int>(heights[bar], rampLength);
+        int fillTo = backColor ? lastRow : std::min(lastRow, height - 1);
+        if (fillTo < firstRow)
+            continue;
+
+        RGB *ptr = currentDrawBufferPtr + origin + (col0 * xStride) + ((baseY - firstRow) * yStride);
+        for (int n = firstRow; n <= fillTo; n++, ptr -= yStride)
+            fillStridedRGB(ptr, xStride, col1 - col0 + 1, (n < height) ? colorRamp[n] : *backColor);
+
+        drawnX0 = std::min(drawnX0, col0);
+        drawnX1 = std::max(drawnX1, col1);
+        drawnTop = std::min(drawnTop, baseY - fillTo);
+    }
+
+    if (drawnX1 >= drawnX0)
+        markRegionDirty(drawnX0, drawnTop, drawnX1, baseY - firstRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawPeakMarkers(int16_t x, int16_t baseY, uint8_t barWidth, uint8_t barSpacing, const uint8_t peaks[], uint16_t numBars, const RGB& color) {
+    if (!peaks || !barWidth)
+        return;
+
+    for (int bar = 0; bar < numBars; bar++) {
+        if (!peaks[bar])
+            continue;
+        int col0 = x + bar * (barWidth + barSpacing);
+        drawFastHLine(col0, col0 + barWidth - 1, baseY - (peaks[bar] - 1), color);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillGradientVertical(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& topColor, const RGB& bottomColor) {
+    // the gradient is laid out over the whole rectangle before it's clipped
+    if (x0 > x1)
+        SWAPint(x0, x1);
+    int length = abs(y1 - y0) + 1;
+    int direction = (y1 >= y0) ? 1 : -1;
+
+    int first = std::max<int>(0, std::min(y0, y1));
+    int last = std::min<int>(this->localHeight - 1, std::max(y0, y1));
+    int col0 = std::max<int>(0, x0);
+    int col1 = std::min<int>(this->localWidth - 1, x1);
+    if (last < first || col1 < col0)
+        return;
+
+    waitForFill();
+    markRegionDirty(col0, first, col1, last);
+
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+    RGB *rowPtr = currentDrawBufferPtr + origin + (col0 * xStride) + (first * yStride);
+    const rgb48 start(topColor);
+    const rgb48 end(bottomColor);
 
-    for (ycnt = 0; ycnt < height; ycnt++) {
-        for (xcnt = 0; xcnt < width; xcnt++) {
-            if (getBitmapPixelAtXY(xcnt, ycnt, width, height, bitmap)) {
-                drawPixel(x + xcnt, y + ycnt, bitmapColor);
+    // one color per row
+    for (int y = first; y <= last; y++, rowPtr += yStride)
+        fillStridedRGB(rowPtr, xStride, col1 - col0 + 1, interpolateRGB(start, end, (y - y0) * direction, length));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::fillGradientHorizontal(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& leftColor, const RGB& rightColor) {
+    // the gradient is laid out over the whole rectangle before it's clipped
+    if (y0 > y1)
+        SWAPint(y0, y1);
+    int length = abs(x1 - x0) + 1;
+    int direction = (x1 >= x0) ? 1 : -1;
+
+    int first = std::max<int>(0, std::min(x0, x1));
+    int last = std::min<int>(this->localWidth - 1, std::max(x0, x1));
+    int row0 = std::max<int>(0, y0);
+    int row1 = std::min<int>(this->localHeight - 1, y1);
+    if (last < first || row1 < row0)
+        return;
+
+    waitForFill();
+    markRegionDirty(first, row0, last, row1);
+
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+    RGB *firstRow = currentDrawBufferPtr + origin + (first * xStride) + (row0 * yStride);
+    const rgb48 start(leftColor);
+    const rgb48 end(rightColor);
+
+    // the colors are calculated for the first row only, the other rows are copies of it
+    RGB *ptr = firstRow;
+    for (int x = first; x <= last; x++, ptr += xStride)
+        *ptr = interpolateRGB(start, end, (x - x0) * direction, length);
+
+    RGB *rowPtr = firstRow + yStride;
+    for (int y = row0 + 1; y <= row1; y++, rowPtr += yStride) {
+        if (xStride == 1) {
+            memcpy(rowPtr, firstRow, sizeof(RGB) * (last - first + 1));
+        } else {
+            RGB *src = firstRow;
+            RGB *dst = rowPtr;
+            for (int x = first; x <= last; x++, src += xStride, dst += xStride)
+                *dst = *src;
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawMonoSpans(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *bits, uint16_t rowBytes,
+  const RGB& color, const RGB *backColor) {
+    // clip against the layer once
+    int col0 = (x < 0) ? -x : 0;
+    int row0 = (y < 0) ? -y : 0;
+    int col1 = std::min<int>(width, this->localWidth - x);
+    int row1 = std::min<int>(height, this->localHeight - y);
+
+    if (col1 <= col0 || row1 <= row0)
+        return;
+
+    markRegionDirty(x + col0, y + row0, x + col1 - 1, y + row1 - 1);
+
+    // then walk the draw buffer with fixed strides for this rotation, no bounds checks or rotation per pixel
+    int origin, xStride, yStride;
+    getLocalToHardwareStrides(origin, xStride, yStride);
+    RGB *rowPtr = currentDrawBufferPtr + origin + ((x + col0) * xStride) + ((y + row0) * yStride);
+
+    for (int row = row0; row < row1; row++, rowPtr += yStride) {
+        const uint8_t *src = bits ? &bits[row * rowBytes] : NULL;
+        RGB *ptr = rowPtr;
+
+        // rows without set pixels only need the back color, or nothing at all
+        bool empty = true;
+        for (int b = col0 / 8; src && b <= (col1 - 1) / 8; b++) {
+            if (src[b]) {
+                empty = false;
+                break;
             }
         }
+
+        if (empty) {
+            if (backColor) {
+                for (int col = col0; col < col1; col++, ptr += xStride)
+                    *ptr = *backColor;
+            }
+            continue;
+        }
+
+        for (int col = col0; col < col1; col++, ptr += xStride) {
+            if (src[col / 8] & (0x80 >> (col % 8)))
+                *ptr = color;
+            else if (backColor)
+                *ptr = *backColor;
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawChar(int16_t x, int16_t y, const RGB& charColor, char character) {
+    drawCodepoint(x, y, charColor, (unsigned char)character);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawCodepoint(int16_t x, int16_t y, const RGB& charColor, uint32_t codepoint) {
+    const unsigned char *rows = getBitmapFontCodepointRows(codepoint, font);
+
+    if (!rows)
+        return;
+
+    drawMonoSpans(x, y, font->Width, font->Height, rows, 1, charColor, NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]) {
+    while (*text) {
+        const unsigned char *rows = getBitmapFontCodepointRows(getNextUtf8Codepoint(&text), font);
+
+        if (rows)
+            drawMonoSpans(x, y, font->Width, font->Height, rows, 1, charColor, NULL);
+        x += font->Width;
     }
 }
 
+// draw string while clearing background
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]) {
+    while (*text) {
+        drawMonoSpans(x, y, font->Width, font->Height, getBitmapFontCodepointRows(getNextUtf8Codepoint(&text), font), 1, charColor, &backColor);
+        x += font->Width;
+    }
+}
+
+// bitmap rows are (width / 8) + 1 bytes, see getBitmapPixelAtXY()
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height,
+  const RGB& bitmapColor, const uint8_t *bitmap) {
+    drawMonoSpans(x, y, width, height, bitmap, (width / 8) + 1, bitmapColor, NULL);
+}
+
 template <typename RGB, unsigned int optionFlags>
 bool SMLayerBackground<RGB, optionFlags>::isSwapPending(void) {
+    if(optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER)
+        return (spareBuffer & SM_BACKGROUND_SPARE_BUFFER_READY);
+
     return swapPending;
 }
 
+// called before the refresh buffer changes, the buffer being replaced becomes the start of the fade
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::handleBufferSwap(void) {
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::startCrossfade(void) {
+    if(!crossfadeFrames) {
+        fadeFromBufferPtr = NULL;
+        return;
+    }
+
+    fadeViewportX = refreshViewportX;
+    fadeViewportY = refreshViewportY;
+    fadeFramesShown = 0;
+    fadeFromBufferPtr = currentRefreshBufferPtr;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::setCrossfadeFrames(uint8_t numFrames) {
+    crossfadeFrames = numFrames;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::handleBufferSwap(void) {
+    if(optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) {
+        if(!(spareBuffer & SM_BACKGROUND_SPARE_BUFFER_READY))
+            return;
+
+        // refresh the newest completed frame, the buffer refresh was using becomes the spare
+        // the drawing thread can replace the spare at any time (picking up a newer frame is fine), so this must be one exchange
+        uint8_t newRefreshBuffer = __atomic_exchange_n(&spareBuffer, (uint8_t)currentRefreshBuffer, __ATOMIC_ACQ_REL) & ~SM_BACKGROUND_SPARE_BUFFER_READY;
+
+        startCrossfade();
+        currentRefreshBuffer = newRefreshBuffer;
+        currentRefreshBufferPtr = backgroundBuffers[currentRefreshBuffer];
+        loadRefreshViewport();
+
+        // the new frame may be two frames newer than the last one refreshed if a frame was dropped, so the changed rows aren't known
+        this->markAllRowsChanged();
+        SM_PROFILE_SWAP_PICKED_UP();
+        return;
+    }
+
     if (!swapPending)
         return;
 
     unsigned char newDrawBuffer = currentRefreshBuffer;
 
+    startCrossfade();
     currentRefreshBuffer = currentDrawBuffer;
     currentDrawBuffer = newDrawBuffer;
 
     currentRefreshBufferPtr = backgroundBuffers[currentRefreshBuffer];
     currentDrawBufferPtr = backgroundBuffers[currentDrawBuffer];
 
+    uint16_t previousViewportX = refreshViewportX;
+    uint16_t previousViewportY = refreshViewportY;
+    loadRefreshViewport();
+
+    // swapRows are buffer rows, refreshed refreshViewportY rows higher on the screen; every row moves if the offset changed
+    if(refreshViewportX != previousViewportX || refreshViewportY != previousViewportY)
+        this->markAllRowsChanged();
+    else if(refreshViewportY == 0 || swapRowsFirst > swapRowsLast)
+        this->markRowsChanged(swapRowsFirst, swapRowsLast);
+    else if(swapRowsFirst >= refreshViewportY)
+        this->markRowsChanged(swapRowsFirst - refreshViewportY, swapRowsLast - refreshViewportY);
+    else if(swapRowsLast < refreshViewportY)
+        this->markRowsChanged(swapRowsFirst + this->matrixHeight - refreshViewportY, swapRowsLast + this->matrixHeight - refreshViewportY);
+    else
+        this->markAllRowsChanged();
+
+    SM_PROFILE_SWAP_PICKED_UP();
     swapPending = false;
 }
 
 // waits until previous swap is complete
 // waits until current swap is complete if copy is enabled
+// with SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER never waits, a frame that refresh didn't pick up before the next swap is dropped
+// with crossfade enabled the buffer being faded from isn't handed back until the fade finishes, which paces the sketch to the fade
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::swapBuffers(bool copy) {
+    waitForFill();
+
+    if(optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) {
+        // the spare is the buffer being faded from, and a ready spare picked up now would become it
+        if(crossfadeFrames)
+            while(isSwapPending() || fadeFromBufferPtr);
+
+        unsigned char finishedBuffer = currentDrawBuffer;
+#if defined(__IMXRT1062__)
+        flushBufferForRowCache(backgroundBuffers[finishedBuffer]);
+#endif
+
+        storeBufferViewport(finishedBuffer);
+        lastSwappedBuffer = finishedBuffer;
+
+        // hand the finished frame to refresh and continue drawing in the spare buffer
+        SM_PROFILE_SWAP_REQUESTED();
+        currentDrawBuffer = __atomic_exchange_n(&spareBuffer, (uint8_t)(finishedBuffer | SM_BACKGROUND_SPARE_BUFFER_READY), __ATOMIC_ACQ_REL) & ~SM_BACKGROUND_SPARE_BUFFER_READY;
+        currentDrawBufferPtr = backgroundBuffers[currentDrawBuffer];
+
+        // the spare buffer is one or two frames old, the whole frame has to be copied
+        if(copy)
+            memcpy((void *)currentDrawBufferPtr, backgroundBuffers[finishedBuffer], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+
+        clearDrawnRegion();
+        drawBufferMatchesRefresh = false;
+        return;
+    }
+
     while (swapPending);
 
+    // if the drawing buffer matched the refresh buffer before drawing, the buffers only differ in the drawn region
+    bool copyDrawnRegionOnly = drawBufferMatchesRefresh;
+    uint16_t copyRowsFirst = drawnRowsFirst;
+    uint16_t copyRowsLast = drawnRowsLast;
+    uint16_t copyColsFirst = drawnColsFirst;
+    uint16_t copyColsLast = drawnColsLast;
+
+    // hand off the rows that will change with this swap to handleBufferSwap()
+    if(drawBufferMatchesRefresh) {
+        swapRowsFirst = drawnRowsFirst;
+        swapRowsLast = drawnRowsLast;
+    } else {
+        swapRowsFirst = 0;
+        swapRowsLast = 0xFFFF;
+    }
+    clearDrawnRegion();
+    drawBufferMatchesRefresh = copy;
+
+#if defined(__IMXRT1062__)
+    if(copyDrawnRegionOnly)
+        flushBufferForRowCache(currentDrawBufferPtr, copyRowsFirst, copyRowsLast);
+    else
+        flushBufferForRowCache(currentDrawBufferPtr);
+#endif
+    storeBufferViewport(currentDrawBuffer);
+    lastSwappedBuffer = currentDrawBuffer;
+    SM_PROFILE_SWAP_REQUESTED();
     swapPending = true;
 
+    // the new drawing buffer is the one being faded from
+    if(crossfadeFrames)
+        while(swapPending || fadeFromBufferPtr);
+
     if (copy) {
         while (swapPending);
-#if 1
-        // workaround for bizarre (optimization) bug - currentDrawBuffer and currentRefreshBuffer are volatile and are changed by an ISR while we're waiting for swapPending here.  They can't be used as parameters to memcpy directly though.  
-        if(currentDrawBuffer)
-            memcpy(backgroundBuffers[1], backgroundBuffers[0], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
-        else
-            memcpy(backgroundBuffers[0], backgroundBuffers[1], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
-#else
-        // Similar code also drawing from volatile variables doesn't work if optimization is turned on: currentDrawBuffer will be equal to currentRefreshBuffer and cause a crash from memcpy copying a buffer to itself.  Why?
-        memcpy(backgroundBuffers[currentDrawBuffer], backgroundBuffers[currentRefreshBuffer], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
-
-        // this also doesn't work
-        //copyRefreshToDrawing();  
 
-        // first checking for (currentDrawBuffer != currentRefreshBuffer) prevents a crash by skipping the copy, but currentDrawBuffer should never be equal to currentRefreshBuffer, except briefly inside an ISR during handleBufferSwap() call
-        //if(currentDrawBuffer != currentRefreshBuffer)     
-        //   memcpy(backgroundBuffers[currentDrawBuffer], backgroundBuffers[currentRefreshBuffer], sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+        // workaround for bizarre (optimization) bug - currentDrawBuffer and currentRefreshBuffer are volatile and are changed by an ISR while we're waiting for swapPending here.  They can't be used as parameters to memcpy directly though.
+        // (using currentDrawBuffer and currentRefreshBuffer directly as indexes makes currentDrawBuffer equal to currentRefreshBuffer with optimization turned on and crashes memcpy copying a buffer to itself)
+        RGB * dst = currentDrawBuffer ? backgroundBuffers[1] : backgroundBuffers[0];
+        RGB * src = currentDrawBuffer ? backgroundBuffers[0] : backgroundBuffers[1];
+
+        if(!copyDrawnRegionOnly) {
+            memcpy((void *)dst, src, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+        } else if(copyRowsFirst <= copyRowsLast) {
+            int offset = copyRowsFirst * this->matrixWidth + copyColsFirst;
+            for(int y = copyRowsFirst; y <= copyRowsLast; y++) {
+                memcpy((void *)(dst + offset), src + offset, sizeof(RGB) * (copyColsLast - copyColsFirst + 1));
+                offset += this->matrixWidth;
+            }
+        }
+#if defined(__IMXRT1062__)
+        // the next swap only flushes the rows drawn after this copy
+        if(copyDrawnRegionOnly)
+            flushBufferForRowCache(dst, copyRowsFirst, copyRowsLast);
+        else
+            flushBufferForRowCache(dst);
 #endif
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::setViewportOffset(int16_t offsetX, int16_t offsetY) {
+    viewportX = offsetX;
+    viewportY = offsetY;
+}
+
+// converts the local viewport offset to a hardware offset for the current rotation, and stores it with the buffer being handed to refresh
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::storeBufferViewport(unsigned char buffer) {
+    int16_t x = viewportX % (int16_t)this->localWidth;
+    int16_t y = viewportY % (int16_t)this->localHeight;
+    if(x < 0)
+        x += this->localWidth;
+    if(y < 0)
+        y += this->localHeight;
+
+    // the rotation mappings are a translation plus sign changes, so the offset maps like any other vector
+    int16_t originX, originY, hwx, hwy;
+    mapLocalToHardware(0, 0, originX, originY);
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    int offsetX = hwx - originX;
+    int offsetY = hwy - originY;
+    bufferViewport[buffer][0] = (offsetX < 0) ? offsetX + this->matrixWidth : offsetX;
+    bufferViewport[buffer][1] = (offsetY < 0) ? offsetY + this->matrixHeight : offsetY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerBackground<RGB, optionFlags>::loadRefreshViewport(void) {
+    refreshViewportX = bufferViewport[currentRefreshBuffer][0];
+    refreshViewportY = bufferViewport[currentRefreshBuffer][1];
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::copyRefreshToDrawing() {
+    waitForFill();
     memcpy(currentDrawBufferPtr, currentRefreshBufferPtr, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+#if defined(__IMXRT1062__)
+    flushBufferForRowCache(currentDrawBufferPtr);
+#endif
+    drawBufferMatchesRefresh = true;
+    clearDrawnRegion();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::clearDrawnRegion(void) {
+    drawnRowsFirst = 0xFFFF;
+    drawnRowsLast = 0;
+    drawnColsFirst = 0xFFFF;
+    drawnColsLast = 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+INLINE void SMLayerBackground<RGB, optionFlags>::markHardwareRegionDrawn(uint16_t hwx0, uint16_t hwy0, uint16_t hwx1, uint16_t hwy1) {
+    if(hwy0 < drawnRowsFirst)
+        drawnRowsFirst = hwy0;
+    if(hwy1 > drawnRowsLast)
+        drawnRowsLast = hwy1;
+    if(hwx0 < drawnColsFirst)
+        drawnColsFirst = hwx0;
+    if(hwx1 > drawnColsLast)
+        drawnColsLast = hwx1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy) {
+    localToHardwareForRotation(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::mapHardwareToLocal(int16_t hwx, int16_t hwy, int16_t &x, int16_t &y) {
+    hardwareToLocalForRotation(hwx, hwy, this->matrixWidth, this->matrixHeight, x, y);
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::getDirtyRegion(int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1) {
+    if(!drawBufferMatchesRefresh) {
+        x0 = 0;
+        y0 = 0;
+        x1 = this->localWidth - 1;
+        y1 = this->localHeight - 1;
+        return true;
+    }
+
+    if(drawnRowsFirst > drawnRowsLast)
+        return false;
+
+    // opposite corners of the hardware region are opposite corners of the rotated region
+    int16_t ax, ay, bx, by;
+    mapHardwareToLocal(drawnColsFirst, drawnRowsFirst, ax, ay);
+    mapHardwareToLocal(drawnColsLast, drawnRowsLast, bx, by);
+
+    x0 = std::min(ax, bx);
+    x1 = std::max(ax, bx);
+    y0 = std::min(ay, by);
+    y1 = std::max(ay, by);
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::markRegionDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    if (x1 < x0)
+        SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
+
+    // check for completely out of bounds region, and truncate if partially out of bounds
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+
+    markHardwareRegionDrawn(std::min(ax, bx), std::min(ay, by), std::max(ax, bx), std::max(ay, by));
 }
 
 // return pointer to start of currentDrawBuffer, so application can do efficient loading of bitmaps
 template <typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::backBuffer(void) {
+    waitForFill();
+
+    // changes made directly to the buffer can't be tracked
+    drawBufferMatchesRefresh = false;
     return currentDrawBufferPtr;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBackBuffer(RGB *newBuffer) {
+  waitForFill();
+  drawBufferMatchesRefresh = false;
   currentDrawBufferPtr = newBuffer;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBrightness(uint8_t brightness) {
     backgroundBrightness = brightness;
+    colorCorrectionLUTChanged = true;
+    refreshSettingsChanged = true;
+    if(isLUTShared())
+        updateSharedLUTs();
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = enabled;
+    refreshSettingsChanged = true;
+}
+
+// gains scale each channel's color correction table (255 = no change), only has an effect with SM_BACKGROUND_OPTIONS_WHITE_BALANCE
+template<typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::setWhiteBalance(uint8_t redGain, uint8_t greenGain, uint8_t blueGain) {
+    whiteBalanceGain[0] = redGain;
+    whiteBalanceGain[1] = greenGain;
+    whiteBalanceGain[2] = blueGain;
+    colorCorrectionLUTChanged = true;
+    refreshSettingsChanged = true;
+    if(isLUTShared() && (optionFlags & SM_BACKGROUND_OPTIONS_WHITE_BALANCE))
+        updateSharedLUTs();
 }
 
 // reads pixel from drawing buffer, not refresh buffer
 template<typename RGB, unsigned int optionFlags>
 const RGB SMLayerBackground<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
-    int hwx, hwy;
-
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return (RGB){0, 0, 0};
 
-    // map pixel into hardware buffer before reading
-    if (this->layerRotation == rotation0) {
-        hwx = x;
-        hwy = y;
-    } else if (this->layerRotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
-    } else if (this->layerRotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
-    } else { /* if (layerRotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
-    }
-
-    return readPixelFromDrawBuffer(hwx, hwy);
+    return (this->*readPixelForRotation)(x, y);
 }
 
 template<typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::getRealBackBuffer() {
+  drawBufferMatchesRefresh = false;
   return backgroundBuffers[currentDrawBuffer];
 }
 
@@ -0,0 +1,115 @@
+/*
+ * SmartMatrix Library - External Buffer Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_EXTERNAL_H_
+#define _LAYER_EXTERNAL_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_EXTERNAL_OPTIONS_NONE            0
+// the buffer is only treated as changed after swapBuffers() or markBufferChanged(), instead of every frame
+#define SM_EXTERNAL_OPTIONS_MANUAL_CHANGES  (1 << 0)
+
+// pixel formats of the external buffer
+typedef enum smExternalFormat {
+    SM_EXTERNAL_FORMAT_RGB24,   // 3 bytes per pixel: red, green, blue, the layout of FastLED's CRGB and rgb24
+    SM_EXTERNAL_FORMAT_RGB565,  // 16-bit rgb16 per pixel
+} smExternalFormat;
+
+#define SM_EXTERNAL_SETTINGS_READY          0x80
+
+// layout flags
+// odd rows run right to left, like a serpentine wired LED matrix
+#define SM_EXTERNAL_LAYOUT_SERPENTINE       (1 << 0)
+
+// maps a local pixel to its index in the buffer, like the XY() function FastLED sketches already have
+typedef uint32_t (*smExternalXYFunction)(uint16_t x, uint16_t y);
+
+// refreshes straight from a buffer owned by the sketch, so pixels drawn by FastLED style code don't need to be copied into a layer
+template <typename RGB, unsigned int optionFlags>
+class SMLayerExternal : public SM_Layer {
+    public:
+        SMLayerExternal(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+        bool isLayerChanged();
+        bool isLayerOpaque();
+
+        void enableColorCorrection(bool enabled);
+
+        // buffer holds localWidth x localHeight pixels and is read during refresh, stride is the number of pixels from one row to the next (0 = localWidth)
+        void setBuffer(const void * buffer, smExternalFormat format, uint16_t stride = 0, uint8_t layoutFlags = 0);
+        // replaces stride and layout flags with the sketch's own mapping, NULL to go back to them
+        void setXYFunction(smExternalXYFunction xy);
+        // double buffering without copies: refresh switches to newBuffer (same format and layout) at the start of the next frame
+        void swapBuffers(const void * newBuffer, bool waitForSwap = true);
+        bool isSwapPending(void);
+        // with SM_EXTERNAL_OPTIONS_MANUAL_CHANGES: the single buffer was drawn to, refresh it next frame
+        void markBufferChanged(void);
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        // copies numPixels starting at buffer index, stepping step pixels in the buffer per pixel
+        template <typename RGB_OUT>
+        void readPixels(const uint8_t * buffer, int32_t index, int step, int numPixels, RGB_OUT * dst);
+        template <typename RGB_OUT>
+        void correctColor(const RGB & in, RGB_OUT & out);
+        int32_t getPixelIndex(int16_t x, int16_t y) const;
+
+        // buffer and layout from setBuffer(), triple buffered so refresh switches to a new set with one exchange
+        struct bufferSettings {
+            const uint8_t * buffer;
+            smExternalFormat format;
+            // 0 = localWidth, resolved while refreshing as the rotation may not be set yet
+            uint16_t stride;
+            uint8_t layout;
+        };
+        bufferSettings settingsSlots[3] = {};
+        // slot setBuffer() fills next, slot refresh reads from, and the slot in between with SM_EXTERNAL_SETTINGS_READY set while it holds
+        // settings refresh hasn't taken yet
+        uint8_t settingsDraw = 0;
+        uint8_t settingsRefresh = 1;
+        volatile uint8_t settingsSpare = 2;
+
+        // only changed in frameRefreshCallback(), so a frame is read with one buffer, layout and opaque state
+        const uint8_t * refreshBuffer = NULL;
+        smExternalXYFunction refreshXYFunction = NULL;
+
+        const uint8_t * volatile pendingBuffer = NULL;
+        smExternalXYFunction volatile xyFunction = NULL;
+
+        smCoordinateMapFunction hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        volatile bool refreshSettingsChanged = true;
+};
+
+#include "Layer_External_Impl.h"
+
+#endif
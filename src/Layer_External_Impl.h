@@ -0,0 +1,210 @@
+/*
+ * SmartMatrix Library - External Buffer Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerExternal<RGB, optionFlags>::SMLayerExternal(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::begin(void) {
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    if(settingsSpare & SM_EXTERNAL_SETTINGS_READY) {
+        settingsRefresh = __atomic_exchange_n(&settingsSpare, settingsRefresh, __ATOMIC_ACQ_REL) & ~SM_EXTERNAL_SETTINGS_READY;
+        refreshBuffer = settingsSlots[settingsRefresh].buffer;
+        refreshSettingsChanged = true;
+    }
+
+    if(xyFunction != refreshXYFunction) {
+        refreshXYFunction = xyFunction;
+        refreshSettingsChanged = true;
+    }
+
+    // a swapBuffers() between the load and the store isn't lost
+    const uint8_t * swappedBuffer = __atomic_exchange_n(&pendingBuffer, (const uint8_t *)NULL, __ATOMIC_ACQUIRE);
+    if(swappedBuffer) {
+        refreshBuffer = swappedBuffer;
+        refreshSettingsChanged = true;
+        SM_PROFILE_SWAP_PICKED_UP();
+    }
+
+    // without manual changes the sketch can write to the buffer at any time, so every frame is treated as changed
+    if(refreshSettingsChanged || !(optionFlags & SM_EXTERNAL_OPTIONS_MANUAL_CHANGES)) {
+        this->markAllRowsChanged();
+        refreshSettingsChanged = false;
+    }
+
+    if(refreshBuffer)
+        this->setCoveredRows(0, this->matrixHeight - 1);
+    else
+        this->setCoveredRows(0x7FFF, -1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::isLayerChanged() {
+    return pendingBuffer || (settingsSpare & SM_EXTERNAL_SETTINGS_READY) || xyFunction != refreshXYFunction || refreshSettingsChanged || !(optionFlags & SM_EXTERNAL_OPTIONS_MANUAL_CHANGES);
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::isLayerOpaque() {
+    // latched with the buffer in frameRefreshCallback()
+    return refreshBuffer != NULL;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+    else if (this->layerRotation == rotation180)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation180>::hardwareToLocal;
+    else if (this->layerRotation == rotation90)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation90>::hardwareToLocal;
+    else /* if (layerRotation == rotation270)*/
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation270>::hardwareToLocal;
+
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+inline void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::correctColor(const RGB & in, RGB_OUT & out) {
+    if(ccEnabled)
+        colorCorrection(in, out);
+    else
+        out = in;
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline int32_t SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::getPixelIndex(int16_t x, int16_t y) const {
+    if(refreshXYFunction)
+        return refreshXYFunction(x, y);
+
+    const bufferSettings & settings = settingsSlots[settingsRefresh];
+    if((settings.layout & SM_EXTERNAL_LAYOUT_SERPENTINE) && (y & 1))
+        x = (this->localWidth - 1) - x;
+
+    return (int32_t)y * (settings.stride ? settings.stride : this->localWidth) + x;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::readPixels(const uint8_t * buffer, int32_t index, int step, int numPixels, RGB_OUT * dst) {
+    if(settingsSlots[settingsRefresh].format == SM_EXTERNAL_FORMAT_RGB565) {
+        const uint16_t * src = (const uint16_t *)buffer + index;
+        for(int i=0; i<numPixels; i++, src += step)
+            correctColor(RGB(rgb16(*src)), dst[i]);
+    } else { /* if(bufferFormat == SM_EXTERNAL_FORMAT_RGB24) */
+        const uint8_t * src = buffer + index * 3;
+        for(int i=0; i<numPixels; i++, src += 3 * step)
+            correctColor(RGB(rgb24(src[0], src[1], src[2])), dst[i]);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    const uint8_t * buffer = refreshBuffer;
+    if(!buffer)
+        return;
+
+    // local pixel of hardware column 0, and the local step for each following column
+    int16_t lx, ly, nextX, nextY;
+    hardwareToLocalForRotation(0, hardwareY, this->matrixWidth, this->matrixHeight, lx, ly);
+    hardwareToLocalForRotation(1, hardwareY, this->matrixWidth, this->matrixHeight, nextX, nextY);
+    int dx = nextX - lx;
+    int dy = nextY - ly;
+
+    if(dy == 0 && !refreshXYFunction) {
+        // rotation0/180: the hardware row is one buffer row, read in one pass forwards or backwards
+        int step = ((settingsSlots[settingsRefresh].layout & SM_EXTERNAL_LAYOUT_SERPENTINE) && (ly & 1)) ? -dx : dx;
+        readPixels(buffer, getPixelIndex(lx, ly), step, this->matrixWidth, refreshRow);
+    } else {
+        for(int i=0; i<this->matrixWidth; i++, lx += dx, ly += dy)
+            readPixels(buffer, getPixelIndex(lx, ly), 0, 1, &refreshRow[i]);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerExternal<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::setBuffer(const void * buffer, smExternalFormat format, uint16_t stride, uint8_t layoutFlags) {
+    // a pending swap was for the old buffer and layout
+    pendingBuffer = NULL;
+
+    // refresh never reads the draw slot, the exchange hands it over complete
+    bufferSettings & settings = settingsSlots[settingsDraw];
+    settings.buffer = (const uint8_t *)buffer;
+    settings.format = format;
+    settings.stride = stride;
+    settings.layout = layoutFlags;
+    settingsDraw = __atomic_exchange_n(&settingsSpare, (uint8_t)(settingsDraw | SM_EXTERNAL_SETTINGS_READY), __ATOMIC_ACQ_REL) & ~SM_EXTERNAL_SETTINGS_READY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::setXYFunction(smExternalXYFunction xy) {
+    // taken by refresh at the next frame, like the buffer
+    xyFunction = xy;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::swapBuffers(const void * newBuffer, bool waitForSwap) {
+    // a swap still pending is replaced, so the newest buffer is shown next
+    SM_PROFILE_SWAP_REQUESTED();
+    pendingBuffer = (const uint8_t *)newBuffer;
+
+    while(waitForSwap && isSwapPending());
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerExternal<RGB, optionFlags>::isSwapPending(void) {
+    return pendingBuffer != NULL;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerExternal<RGB, optionFlags>::markBufferChanged(void) {
+    refreshSettingsChanged = true;
+}
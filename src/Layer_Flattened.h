@@ -0,0 +1,68 @@
+/*
+ * SmartMatrix Library - Flattened Layer Stack Class
+ *
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_FLATTENED_H_
+#define _LAYER_FLATTENED_H_
+
+#include "Layer_Stack.h"
+
+// an SMLayerStack that keeps its composited rows in an RGB buffer of width x height, for layers under a dynamic one that rarely
+// change (a background, a logo, static labels): rows are composited once and copied out on later frames, and only the rows the
+// layers report through getChangedRows() (every row, for layers that don't track changes) are composited again.  The stack has to
+// be the bottom layer, as it overwrites every pixel, with the dynamic layers added above it as usual:
+//
+//   SMLayerFlattened<rgb24, decltype(backgroundLayer), decltype(indexedLayer)> staticLayers(kMatrixWidth, kMatrixHeight, &backgroundLayer, &indexedLayer);
+//   matrix.addLayer(&staticLayers);
+//   matrix.addLayer(&scrollingLayer);
+//
+// The buffer is allocated in begin(), RGB is the precision the composited rows are kept at
+template <typename RGB, typename... LAYERS>
+class SMLayerFlattened : public SMLayerStack<LAYERS...> {
+    public:
+        SMLayerFlattened(uint16_t width, uint16_t height, LAYERS *... layers);
+        void begin(void);
+        void frameRefreshCallback(void);
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void prefetchRefreshRow(uint16_t hardwareY);
+        void setRotation(rotationDegrees newrotation);
+        bool isLayerOpaque();
+
+    private:
+        // the brightnessShifts each cached row was composited with, -1 once the row has to be composited again
+        static const int8_t rowNotCached = -1;
+        void invalidateRows(int firstRow, int lastRow);
+        RGB * cachedRow(uint16_t hardwareY, int brightnessShifts);
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts);
+
+        uint16_t cacheWidth, cacheHeight;
+        RGB * cacheBuffer = NULL;
+        int8_t * cacheRowShifts = NULL;
+};
+
+#include "Layer_Flattened_Impl.h"
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * SmartMatrix Library - Flattened Layer Stack Class
+ *
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+template <typename RGB, typename... LAYERS>
+SMLayerFlattened<RGB, LAYERS...>::SMLayerFlattened(uint16_t width, uint16_t height, LAYERS *... layers) : SMLayerStack<LAYERS...>(layers...) {
+    cacheWidth = width;
+    cacheHeight = height;
+}
+
+template <typename RGB, typename... LAYERS>
+void SMLayerFlattened<RGB, LAYERS...>::begin(void) {
+    SMLayerStack<LAYERS...>::begin();
+
+    if(!cacheBuffer) {
+        cacheBuffer = (RGB *)malloc(sizeof(RGB) * cacheWidth * cacheHeight);
+        assert(cacheBuffer != NULL);
+        cacheRowShifts = (int8_t *)malloc(cacheHeight);
+        assert(cacheRowShifts != NULL);
+    }
+    invalidateRows(0, cacheHeight - 1);
+}
+
+template <typename RGB, typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::invalidateRows(int firstRow, int lastRow) {
+    if(lastRow >= cacheHeight)
+        lastRow = cacheHeight - 1;
+    for(int i = firstRow; i <= lastRow; i++)
+        cacheRowShifts[i] = rowNotCached;
+}
+
+template <typename RGB, typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::frameRefreshCallback(void) {
+    SMLayerStack<LAYERS...>::frameRefreshCallback();
+
+    uint16_t firstRow, lastRow;
+    if(this->layers.getChangedRows(firstRow, lastRow))
+        invalidateRows(firstRow, lastRow);
+}
+
+// rows are only touched by the fill for that row, so calcs filling rows from two tasks don't share any state
+template <typename RGB, typename... LAYERS>
+RGB * SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::cachedRow(uint16_t hardwareY, int brightnessShifts) {
+    RGB * row = &cacheBuffer[hardwareY * cacheWidth];
+
+    if(cacheRowShifts[hardwareY] != brightnessShifts) {
+        // composited over black, like the calc's cleared row under the bottom layer
+        memset((void *)row, 0x00, sizeof(RGB) * cacheWidth);
+        this->layers.fillRefreshRow(hardwareY, row, brightnessShifts);
+        cacheRowShifts[hardwareY] = brightnessShifts;
+    }
+
+    return row;
+}
+
+// rows below the buffer aren't cached, they're composited over black straight into refreshRow
+template <typename RGB, typename... LAYERS> template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
+    if(hardwareY >= cacheHeight) {
+        memset((void *)refreshRow, 0x00, sizeof(RGB_OUT) * cacheWidth);
+        this->layers.fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+        return;
+    }
+
+    const RGB * row = cachedRow(hardwareY, brightnessShifts);
+    for(int i = 0; i < cacheWidth; i++)
+        refreshRow[i] = row[i];
+}
+
+template <typename RGB, typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+}
+
+template <typename RGB, typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+}
+
+// a cached row is copied out of the buffer, only a row that will be composited again needs the layers' prefetch
+template <typename RGB, typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::prefetchRefreshRow(uint16_t hardwareY) {
+    if(hardwareY >= cacheHeight || cacheRowShifts[hardwareY] == rowNotCached)
+        this->layers.prefetchRefreshRow(hardwareY);
+}
+
+template <typename RGB, typename... LAYERS>
+void SMLayerFlattened<RGB, LAYERS...>::setRotation(rotationDegrees newrotation) {
+    SMLayerStack<LAYERS...>::setRotation(newrotation);
+
+    if(cacheRowShifts)
+        invalidateRows(0, cacheHeight - 1);
+}
+
+template <typename RGB, typename... LAYERS>
+bool SM_FLASH_SAFE_IRAM SMLayerFlattened<RGB, LAYERS...>::isLayerOpaque() {
+    return true;
+}
@@ -33,6 +33,28 @@
 
 #define SM_GFX_MONO_OPTIONS_NONE     0
 
+// number of strings whose bounds and glyph positions are kept, so repeating or rotating messages aren't measured again
+#ifndef SM_GFX_TEXT_LAYOUT_CACHE_SIZE
+#define SM_GFX_TEXT_LAYOUT_CACHE_SIZE   4
+#endif
+// longer strings are still cached but always redrawn in full
+#ifndef SM_GFX_TEXT_LAYOUT_MAX_GLYPHS
+#define SM_GFX_TEXT_LAYOUT_MAX_GLYPHS   32
+#endif
+
+// bounds from getTextBounds() for one string with one font and text size, plus the cursor x of each glyph relative to x1
+typedef struct smGfxTextLayout {
+    uint32_t hash;
+    const GFXfont * font;
+    uint8_t textSizeX, textSizeY;
+    uint16_t length;
+    // false if glyphX isn't filled: the string is too long or has characters that don't advance along one line
+    bool perGlyph;
+    int16_t x1, y1;
+    uint16_t w, h;
+    int16_t glyphX[SM_GFX_TEXT_LAYOUT_MAX_GLYPHS];
+} smGfxTextLayout;
+
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
     public:
@@ -100,6 +122,15 @@ class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
         using Adafruit_GFX::setFont;
         using Adafruit_GFX::drawChar;
 
+        // native versions of the Adafruit_GFX batch hooks, so text and fills don't call the virtual drawPixel() for every pixel
+        void writePixel(int16_t x, int16_t y, uint16_t color);
+        void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+        void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
         /* Adafruit_GFX wrappers for lazily typed colors (with color defaulting as int) */
         inline void fillScreen(int color) { fillScreen((rgb1)(color > 0)); };
         inline void drawPixel(int16_t x, int16_t y, int color) { drawPixel(x, y, (rgb1)(color > 0)); };
@@ -108,15 +139,36 @@ class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
         /* RGB specific */
         void handleBufferSwap(void);
 
+        // corners in local coordinates and in any order, clipped to the layer
+        void fillLocalRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const rgb1 index);
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+
         // Note we'd use a function template for the public functions but are keeping them fixed with rgb24/rgb48 parameters for backwards compatibility
         template <typename RGB_OUT>
-        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts);
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], const RGB_OUT colors[2]);
+        // both colors in both refresh formats, converted in frameRefreshCallback() after refreshSettingsChanged is set
+        rgb48 refreshColors48[2];
+        rgb24 refreshColors24[2];
+        template <typename RGB_OUT>
+        void convertRefreshColors(RGB_OUT colors[2]);
         // bitmap size is 32 rows (supporting maximum dimension of screen height in all rotations), by 32 bits
         // double buffered to prevent flicker while drawing
         uint8_t * indexedBitmap;
 
         size_t bufferSize;
 
+        // rows of each buffer that may hold set pixels (one bit per layer row), and the columns they may be in, so refresh
+        // returns early for empty rows and only scans the occupied columns of the rest.  Drawing set pixels only grows these,
+        // clearing pixels leaves them as a bound, and they're reset when a whole buffer is cleared
+        uint8_t * occupiedRows[2];
+        uint16_t occupiedRowsMax;
+        uint16_t occupiedColumnsFirst[2] = {0xFFFF, 0xFFFF};
+        uint16_t occupiedColumnsLast[2] = {0, 0};
+        void allocateOccupancy(void);
+        void markOccupied(int hwx0, int hwy0, int hwx1, int hwy1);
+        void clearOccupied(unsigned char buffer);
+        bool isRowOccupied(unsigned char buffer, int layerY) const { return occupiedRows[buffer][layerY / 8] & (0x80 >> (layerY % 8)); };
+
         RGB_API indexedColor[2];
         rgb1 transparentColor = false;
         bool transparencyEnabled = true;
@@ -133,6 +185,26 @@ class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
         
         // returns -1 if text is too big to fit into layer
         int resizeLayerToText(const char inputtext[]);
+
+        // text layout cache: a hit skips getTextBounds() and the per glyph walk
+        const smGfxTextLayout * layoutText(const char text[]);
+        smGfxTextLayout layoutCache[SM_GFX_TEXT_LAYOUT_CACHE_SIZE];
+        uint8_t layoutCacheCount = 0;
+        uint8_t layoutCacheNext = 0;
+
+        // the text drawn in each buffer by resizeLayerToText(), so text that keeps its size only redraws the glyphs that changed
+        // invalid after anything else draws to the buffer, a valid empty (length 0) text means a cleared buffer
+        struct renderedText {
+            bool valid;
+            smGfxTextLayout layout;
+            char text[SM_GFX_TEXT_LAYOUT_MAX_GLYPHS];
+        } renderedTexts[2];
+        bool renderingText = false;
+        void invalidateRenderedText(void) { if(!renderingText) renderedTexts[currentDrawBuffer].valid = false; };
+        void setRenderedTextsEmpty(void);
+        // local columns a glyph drawn at cursor x may set, returns false for glyphs without pixels
+        bool getGlyphColumns(char character, int16_t x, int16_t &firstColumn, int16_t &lastColumn);
+        void redrawChangedGlyphs(const smGfxTextLayout * layout, const char text[]);
         void setMinMax(void);
         unsigned char currentframe = 0;
         unsigned char pixelsPerSecond = 30;
@@ -152,6 +224,9 @@ class SMLayerGFXMono : public SM_Layer, public Adafruit_GFX {
         volatile unsigned char currentDrawBuffer;
         volatile unsigned char currentRefreshBuffer;
         volatile bool swapPending;
+
+        // color or color correction changed, affecting every row covered by the layer
+        volatile bool refreshSettingsChanged = true;
 };
 
 #include "Layer_Gfx_Mono_Impl.h"
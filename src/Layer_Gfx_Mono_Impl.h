@@ -35,6 +35,8 @@ SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::SMLayerGFXMono(uint8_t * bitm
     this->layerHeight = layerHeight;
     bufferSize = 2 * RGB1_BUFFER_SIZE;
     indexedBitmap = bitmap;
+    allocateOccupancy();
+    setRenderedTextsEmpty();
     this->indexedColor[1] = rgb48(0xffff, 0xffff, 0xffff);
     this->indexedColor[0] = rgb48(0, 0, 0);
 }
@@ -53,10 +55,50 @@ SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::SMLayerGFXMono(uint16_t width
     //this->assert(indexedBitmap != NULL);
 #endif
     memset(indexedBitmap, 0x00, 2 * RGB1_BUFFER_SIZE);
+    smRecordAllocation(smMemoryLayers, indexedBitmap, bufferSize);
+    allocateOccupancy();
+    setRenderedTextsEmpty();
     this->indexedColor[1] = rgb48(0xffff, 0xffff, 0xffff);
     this->indexedColor[0] = rgb48(0, 0, 0);
 }
 
+// layers are at least 8 pixels wide, so a buffer has at most one row per byte, including after resizeLayer()
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::allocateOccupancy(void) {
+    occupiedRowsMax = bufferSize / 2;
+    int rowBytes = (occupiedRowsMax + 7) / 8;
+    occupiedRows[0] = (uint8_t*)malloc(2 * rowBytes);
+#ifdef ESP32
+    assert(occupiedRows[0] != NULL);
+#endif
+    smRecordAllocation(smMemoryLayers, occupiedRows[0], 2 * rowBytes);
+    occupiedRows[1] = occupiedRows[0] + rowBytes;
+    clearOccupied(0);
+    clearOccupied(1);
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::clearOccupied(unsigned char buffer) {
+    memset(occupiedRows[buffer], 0x00, (occupiedRowsMax + 7) / 8);
+    occupiedColumnsFirst[buffer] = 0xFFFF;
+    occupiedColumnsLast[buffer] = 0;
+}
+
+// hardware (layer buffer) coordinates in the drawing buffer, in order
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::markOccupied(int hwx0, int hwy0, int hwx1, int hwy1) {
+    unsigned char buffer = currentDrawBuffer;
+
+    hwy1 = std::min<int>(hwy1, occupiedRowsMax - 1);
+    for(int y = hwy0; y <= hwy1; y++)
+        occupiedRows[buffer][y / 8] |= 0x80 >> (y % 8);
+
+    if(hwx0 < occupiedColumnsFirst[buffer])
+        occupiedColumnsFirst[buffer] = hwx0;
+    if(hwx1 > occupiedColumnsLast[buffer])
+        occupiedColumnsLast[buffer] = hwx1;
+}
+
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::begin(void) {
     currentDrawBuffer = 0;
@@ -65,7 +107,7 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::begin(void) {
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::handleBufferSwap(void) {
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::handleBufferSwap(void) {
     if (!swapPending)
         return;
 
@@ -74,22 +116,43 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::handleBufferSwap(void) {
     currentRefreshBuffer = currentDrawBuffer;
     currentDrawBuffer = newDrawBuffer;
 
+    SM_PROFILE_SWAP_PICKED_UP();
     swapPending = false;
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::frameRefreshCallback(void) {
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::frameRefreshCallback(void) {
+    bool layerChanged = swapPending || refreshSettingsChanged;
+
+    // cleared before converting, so a color set while converting is picked up next frame
+    if(refreshSettingsChanged) {
+        refreshSettingsChanged = false;
+        convertRefreshColors(refreshColors48);
+        convertRefreshColors(refreshColors24);
+    }
+
+    this->clearChangedRows();
+
     updateScrollingText();
     handleBufferSwap();
+
+    // the layer changes the rows it covered last frame and the rows it covers now if it moved, was resized, or has new content
+    int16_t newCoveredRowsFirst = layerYOffset;
+    int16_t newCoveredRowsLast = layerYOffset + this->layerHeight - 1;
+
+    if(layerChanged || newCoveredRowsFirst != this->coveredRowsFirst || newCoveredRowsLast != this->coveredRowsLast) {
+        this->markRowsChanged(this->coveredRowsFirst, this->coveredRowsLast);
+        this->markRowsChanged(newCoveredRowsFirst, newCoveredRowsLast);
+    }
+
+    // also lets the calc skip the layer on rows outside it
+    this->coveredRowsFirst = newCoveredRowsFirst;
+    this->coveredRowsLast = newCoveredRowsLast;
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags> template <typename RGB_OUT>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
-    RGB_API currentPixel;
-    RGB_OUT finalIndexedColor[2];
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], const RGB_OUT colors[2]) {
     int xOffset = 0;
-    uint8_t bitmask;
-    int i;
 
     // "i" sweeps across the refresh row with dimensions 0..matrixWidth
     // simplest case: the layer is sized the same as the refresh row and we sweep 0..matrixWidth
@@ -118,69 +181,69 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRowTemplated(
     if((layerY > (this->layerHeight - 1)) || (layerY < 0))
         return;
 
+    // with color 0 transparent only set pixels are drawn, so empty rows and the columns outside the set pixels are skipped
+    if(transparencyEnabled && !transparentColor) {
+        unsigned char buffer = currentRefreshBuffer;
+        if(!isRowOccupied(buffer, layerY))
+            return;
+
+        iRangeMin = max((int)iRangeMin, (int)(occupiedColumnsFirst[buffer] + layerXOffset));
+        iRangeMax = min((int)iRangeMax, (int)(occupiedColumnsLast[buffer] + layerXOffset + 1));
+    }
+
+    if(iRangeMax <= iRangeMin)
+        return;
+
     // point to (0, hardwareY)
     uint8_t *ptr = &indexedBitmap[(currentRefreshBuffer * RGB1_BUFFER_SIZE) + (layerY * RGB1_BUFFER_HARDWARE_ROW_SIZE)];
 
     // xOffset represents the difference between "i" (position in the hardware buffer) and the position in the layer buffer
+    // (if iRangeMin > 0, xOffset <= 0 and vice versa, so the first layer pixel read is always iRangeMin + xOffset >= 0)
     xOffset = -layerXOffset;
 
-    // when the layer starts to the left of the hardware, we sweep the layer starting from xOffset
-    if(xOffset > 0)
-        ptr += xOffset/8;           // we sweep this layer starting from x=xOffset
-
-    // at this point, we need xOffset to be positive and we only care about the remainder, so we add a large multiple of 8 to it
-    if(xOffset < 0)
-        xOffset += 0x8000;
-
-    // prepare initial position of bitmask (this works because if iRangeMin > 0, xOffset == 0, and vice versa)
-    bitmask = 0x80 >> ((iRangeMin + xOffset) % 8);
-
-    if(this->ccEnabled) {
-        colorCorrection(indexedColor[0], finalIndexedColor[0]);
-        colorCorrection(indexedColor[1], finalIndexedColor[1]);
+    // with one color transparent, only the runs of the other color are written
+    // with transparency disabled, the set bits are drawn over a row filled with color 0
+    if(!transparencyEnabled) {
+        for(int i=iRangeMin; i<iRangeMax; i++)
+            refreshRow[i] = colors[0];
+        fillSpansFrom1bppRow(ptr, iRangeMin + xOffset, iRangeMax - iRangeMin, false, false, colors[1], &refreshRow[iRangeMin]);
+    } else if(transparentColor) {
+        fillSpansFrom1bppRow(ptr, iRangeMin + xOffset, iRangeMax - iRangeMin, true, false, colors[0], &refreshRow[iRangeMin]);
     } else {
-        finalIndexedColor[0] = indexedColor[0];
-        finalIndexedColor[1] = indexedColor[1];
-    }
-
-    for(i=iRangeMin; i<iRangeMax; i++) {
-        bool currentBit = (*ptr & bitmask);
-
-        // every 8 bits, reload mask and ptr++ (this works because if iRangeMin > 0, xOffset == 0, and vice versa)
-        if((i + xOffset + 1)%8 == 0) {
-            bitmask = 0x80;
-            ptr++;
-        } else {
-            bitmask >>= 1;
-        }
-
-        // skip transparent pixels
-        if(transparencyEnabled && currentBit == transparentColor)
-            continue;
-
-        if(currentBit)
-            currentPixel = finalIndexedColor[1];
-        else
-            currentPixel = finalIndexedColor[0];
-
-        colorCorrection(currentPixel, refreshRow[i]);
+        fillSpansFrom1bppRow(ptr, iRangeMin + xOffset, iRangeMax - iRangeMin, false, false, colors[1], &refreshRow[iRangeMin]);
     }
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, refreshColors48);
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, refreshColors24);
+}
+
+// matches the conversion fillRefreshRow() used to do for every row: the corrected color goes through colorCorrection() once more on its way to RGB_OUT
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags> template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::convertRefreshColors(RGB_OUT colors[2]) {
+    for(int c=0; c<2; c++) {
+        RGB_OUT converted;
+        if(this->ccEnabled)
+            colorCorrection(indexedColor[c], converted);
+        else
+            converted = indexedColor[c];
+
+        RGB_API currentPixel = converted;
+        colorCorrection(currentPixel, colors[c]);
+    }
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::swapBuffers(bool copy) {
     while (swapPending);
 
+    SM_PROFILE_SWAP_REQUESTED();
     swapPending = true;
 
     if(copy) {
@@ -192,6 +255,12 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::swapBuffers(bool copy) {
             memcpy(&indexedBitmap[RGB1_BUFFER_SIZE], &indexedBitmap[0], RGB1_BUFFER_SIZE);
         else
             memcpy(&indexedBitmap[0], &indexedBitmap[RGB1_BUFFER_SIZE], RGB1_BUFFER_SIZE);
+
+        unsigned char drawBuffer = currentDrawBuffer;
+        memcpy(occupiedRows[drawBuffer], occupiedRows[!drawBuffer], (occupiedRowsMax + 7) / 8);
+        occupiedColumnsFirst[drawBuffer] = occupiedColumnsFirst[!drawBuffer];
+        occupiedColumnsLast[drawBuffer] = occupiedColumnsLast[!drawBuffer];
+        renderedTexts[drawBuffer] = renderedTexts[!drawBuffer];
 #else
         // below is untested after copying from backgroundLayer to indexedLayer:
 
@@ -211,11 +280,13 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::swapBuffers(bool copy) {
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setIndexedColor(uint8_t index, const RGB_API & newColor) {
     indexedColor[index % 2] = newColor;
+    refreshSettingsChanged = true;
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = enabled;
+    refreshSettingsChanged = true;
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
@@ -236,6 +307,15 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setRotation(rotationDegr
         _width = this->layerHeight;
         _height = this->layerWidth;        
     }
+
+    if (this->layerRotation == rotation0)
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+    else if (this->layerRotation == rotation180)
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+    else if (this->layerRotation == rotation90)
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+    else
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
 }
 
 /* RGB Specific Core Drawing Methods */
@@ -249,6 +329,8 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::drawPixel(int16_t x, int
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return;
 
+    invalidateRenderedText();
+
     // map pixel into hardware buffer before writing
     if (this->layerRotation == rotation0) {
         hwx = x;
@@ -267,6 +349,7 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::drawPixel(int16_t x, int
     if(index) {
         tempBitmask = 0x80 >> (hwx%8);
         indexedBitmap[currentDrawBuffer*RGB1_BUFFER_SIZE + (hwy * RGB1_BUFFER_HARDWARE_ROW_SIZE) + (hwx/8)] |= tempBitmask;
+        markOccupied(hwx, hwy, hwx, hwy);
     } else {
         tempBitmask = ~(0x80 >> (hwx%8));
         indexedBitmap[currentDrawBuffer*RGB1_BUFFER_SIZE + (hwy * RGB1_BUFFER_HARDWARE_ROW_SIZE) + (hwx/8)] &= tempBitmask;
@@ -282,6 +365,12 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillScreen(const rgb1 in
         fillValue = 0x00;
 
     memset(&indexedBitmap[currentDrawBuffer*RGB1_BUFFER_SIZE], fillValue, RGB1_BUFFER_SIZE);
+    invalidateRenderedText();
+
+    if(index)
+        markOccupied(0, 0, this->layerWidth - 1, this->layerHeight - 1);
+    else
+        clearOccupied(currentDrawBuffer);
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
@@ -342,6 +431,101 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillScreen(uint16_t colo
     fillScreen(index);
 }
 
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillLocalRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const rgb1 index) {
+    if (x1 < x0)
+        SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
+
+    // check for completely out of bounds rectangle
+    if (x1 < 0 || x0 >= this->localWidth || y1 < 0 || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    // a local rectangle is still a rectangle in hardware coordinates, so only the corners need mapping
+    int16_t ax, ay, bx, by;
+    localToHardwareForRotation(x0, y0, this->layerWidth, this->layerHeight, ax, ay);
+    localToHardwareForRotation(x1, y1, this->layerWidth, this->layerHeight, bx, by);
+    if (bx < ax)
+        SWAPint(bx, ax);
+    if (by < ay)
+        SWAPint(by, ay);
+
+    // set or clear whole bytes between the partial first and last bytes of each hardware row
+    int firstByte = ax / 8;
+    int lastByte = bx / 8;
+    uint8_t firstMask = 0xFF >> (ax % 8);
+    uint8_t lastMask = (uint8_t)(0xFF << (7 - (bx % 8)));
+    if (firstByte == lastByte)
+        firstMask &= lastMask;
+
+    invalidateRenderedText();
+    if (index)
+        markOccupied(ax, ay, bx, by);
+
+    uint8_t *ptr = &indexedBitmap[currentDrawBuffer*RGB1_BUFFER_SIZE + (ay * RGB1_BUFFER_HARDWARE_ROW_SIZE)];
+    for (int i = ay; i <= by; i++, ptr += RGB1_BUFFER_HARDWARE_ROW_SIZE) {
+        if (index)
+            ptr[firstByte] |= firstMask;
+        else
+            ptr[firstByte] &= ~firstMask;
+
+        if (firstByte == lastByte)
+            continue;
+
+        memset(&ptr[firstByte + 1], index ? 0xFF : 0x00, lastByte - firstByte - 1);
+
+        if (index)
+            ptr[lastByte] |= lastMask;
+        else
+            ptr[lastByte] &= ~lastMask;
+    }
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::writePixel(int16_t x, int16_t y, uint16_t color) {
+    drawPixel(x, y, (rgb1)(color ? true : false));
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (w)
+        fillLocalRect(x, y, smGfxSpanEnd(x, w), y, (rgb1)(color ? true : false));
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (h)
+        fillLocalRect(x, y, x, smGfxSpanEnd(y, h), (rgb1)(color ? true : false));
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w && h)
+        fillLocalRect(x, y, smGfxSpanEnd(x, w), smGfxSpanEnd(y, h), (rgb1)(color ? true : false));
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    writeFastHLine(x, y, w, color);
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    writeFastVLine(x, y, h, color);
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    writeFillRect(x, y, w, h, color);
+}
+
 /* RGB Specific SmartMatrix Library 3.0 Backwards Compatibility */
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
@@ -451,7 +635,7 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setRotation(uint8_t x) {
 // called once per frame to update (virtual) bitmap
 // function needs major efficiency improvments
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
-void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::updateScrollingText(void) {
+void SM_FLASH_SAFE_IRAM SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::updateScrollingText(void) {
     // return if not ready to update
     if (!scrollcounter || ++currentframe <= framesperscroll)
         return;
@@ -517,24 +701,180 @@ int SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::getStatus(void) const {
     return scrollcounter;
 }
 
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+const smGfxTextLayout * SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::layoutText(const char text[]) {
+    // FNV-1a, the length, font and text size are compared too
+    uint32_t hash = 2166136261UL;
+    uint16_t length = 0;
+    while(text[length]) {
+        hash = (hash ^ (uint8_t)text[length]) * 16777619UL;
+        length++;
+    }
+
+    wrap = false;
+
+    for(int i=0; i<layoutCacheCount; i++) {
+        const smGfxTextLayout & entry = layoutCache[i];
+        if(entry.hash == hash && entry.length == length && entry.font == gfxFont && entry.textSizeX == textsize_x && entry.textSizeY == textsize_y)
+            return &entry;
+    }
+
+    smGfxTextLayout & layout = layoutCache[layoutCacheNext];
+    layoutCacheNext = (layoutCacheNext + 1) % SM_GFX_TEXT_LAYOUT_CACHE_SIZE;
+    if(layoutCacheCount < SM_GFX_TEXT_LAYOUT_CACHE_SIZE)
+        layoutCacheCount++;
+
+    layout.hash = hash;
+    layout.length = length;
+    layout.font = gfxFont;
+    layout.textSizeX = textsize_x;
+    layout.textSizeY = textsize_y;
+    getTextBounds(text, 0, 0, &layout.x1, &layout.y1, &layout.w, &layout.h);
+
+    // the cursor advances the same way as in Adafruit_GFX::write(), characters outside a custom font don't move it
+    layout.perGlyph = (length <= SM_GFX_TEXT_LAYOUT_MAX_GLYPHS);
+    int16_t cursor = 0;
+    for(int i=0; layout.perGlyph && i<length; i++) {
+        uint8_t c = text[i];
+        if(c == '\n' || c == '\r') {
+            layout.perGlyph = false;
+            break;
+        }
+
+        layout.glyphX[i] = cursor;
+        if(gfxFont) {
+            if(c >= pgm_read_word(&gfxFont->first) && c <= pgm_read_word(&gfxFont->last))
+                cursor += (int16_t)textsize_x * (uint8_t)pgm_read_byte(&gfxFont->glyph[c - pgm_read_word(&gfxFont->first)].xAdvance);
+        } else {
+            cursor += (int16_t)textsize_x * 6;
+        }
+    }
+
+    return &layout;
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+bool SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::getGlyphColumns(char character, int16_t x, int16_t &firstColumn, int16_t &lastColumn) {
+    uint8_t c = character;
+
+    if(!gfxFont) {
+        firstColumn = x;
+        lastColumn = x + (int16_t)textsize_x * 6 - 1;
+        return true;
+    }
+
+    uint16_t first = pgm_read_word(&gfxFont->first);
+    if(c < first || c > pgm_read_word(&gfxFont->last))
+        return false;
+
+    const GFXglyph * glyph = &gfxFont->glyph[c - first];
+    uint8_t width = pgm_read_byte(&glyph->width);
+    if(!width)
+        return false;
+
+    firstColumn = x + (int16_t)textsize_x * (int8_t)pgm_read_byte(&glyph->xOffset);
+    lastColumn = firstColumn + (int16_t)textsize_x * width - 1;
+    return true;
+}
+
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setRenderedTextsEmpty(void) {
+    for(int i=0; i<2; i++) {
+        renderedTexts[i].valid = true;
+        renderedTexts[i].layout.length = 0;
+    }
+}
+
+// clears the columns of glyphs that changed (old and new), then draws every new glyph touching a cleared column
+template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
+void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::redrawChangedGlyphs(const smGfxTextLayout * layout, const char text[]) {
+    renderedText & previous = renderedTexts[currentDrawBuffer];
+    int16_t clearedFirst[2 * SM_GFX_TEXT_LAYOUT_MAX_GLYPHS];
+    int16_t clearedLast[2 * SM_GFX_TEXT_LAYOUT_MAX_GLYPHS];
+    int numCleared = 0;
+    int16_t first, last;
+
+    renderingText = true;
+
+    int length = std::max(previous.layout.length, layout->length);
+    for(int i=0; i<length; i++) {
+        bool inPrevious = i < previous.layout.length;
+        bool inNew = i < layout->length;
+
+        if(inPrevious && inNew && previous.text[i] == text[i] && previous.layout.glyphX[i] == layout->glyphX[i])
+            continue;
+
+        if(inPrevious && getGlyphColumns(previous.text[i], previous.layout.glyphX[i] - previous.layout.x1, first, last)) {
+            clearedFirst[numCleared] = first;
+            clearedLast[numCleared++] = last;
+            fillLocalRect(first, 0, last, this->localHeight - 1, (rgb1)false);
+        }
+        if(inNew && getGlyphColumns(text[i], layout->glyphX[i] - layout->x1, first, last)) {
+            clearedFirst[numCleared] = first;
+            clearedLast[numCleared++] = last;
+            fillLocalRect(first, 0, last, this->localHeight - 1, (rgb1)false);
+        }
+    }
+
+    for(int i=0; i<layout->length; i++) {
+        int16_t x = layout->glyphX[i] - layout->x1;
+        if(!getGlyphColumns(text[i], x, first, last))
+            continue;
+
+        for(int j=0; j<numCleared; j++) {
+            if(first <= clearedLast[j] && last >= clearedFirst[j]) {
+                setCursor(x, -layout->y1);
+                write(text[i]);
+                break;
+            }
+        }
+    }
+
+    renderingText = false;
+
+    previous.layout = *layout;
+    memcpy(previous.text, text, layout->length);
+    previous.valid = true;
+}
+
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 int SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::resizeLayerToText(const char inputtext[]) {
-    int16_t x1, y1;
-    uint16_t w, h;
     bool resizeWasTooBig = false;
+    bool rotated = (this->layerRotation == rotation90 || this->layerRotation == rotation270);
 
     // size this layer to the text we want to draw
-    wrap = false;
-    getTextBounds(inputtext, 0, 0, &x1, &y1, &w, &h);
-    if(this->layerRotation == rotation90 || this->layerRotation == rotation270)
+    const smGfxTextLayout * layout = layoutText(inputtext);
+    uint16_t w = layout->w;
+    uint16_t h = layout->h;
+
+    // text that keeps the layer size and position in the buffer only needs the glyphs that changed redrawn
+    const renderedText & previous = renderedTexts[currentDrawBuffer];
+    if(layout->perGlyph && previous.valid &&
+        ROUND_UP_TO_MULTIPLE_OF_8(rotated ? h : w) == this->layerWidth && ROUND_UP_TO_MULTIPLE_OF_8(rotated ? w : h) == this->layerHeight &&
+        (!previous.layout.length || (previous.layout.font == layout->font && previous.layout.textSizeX == layout->textSizeX &&
+        previous.layout.textSizeY == layout->textSizeY && previous.layout.x1 == layout->x1 && previous.layout.y1 == layout->y1))) {
+        redrawChangedGlyphs(layout, inputtext);
+        return 0;
+    }
+
+    if(rotated)
         resizeWasTooBig = resizeLayer(h, w);
     else
         resizeWasTooBig = resizeLayer(w, h);
 
     // draw text to the now empty layer
     // set the cursor so the text fits within (0,0..localWidth,localHeight)
-    setCursor(-x1, -y1);
+    renderingText = true;
+    setCursor(-layout->x1, -layout->y1);
     print(inputtext);
+    renderingText = false;
+
+    renderedText & rendered = renderedTexts[currentDrawBuffer];
+    rendered.valid = layout->perGlyph && !resizeWasTooBig;
+    if(rendered.valid) {
+        rendered.layout = *layout;
+        memcpy(rendered.text, inputtext, layout->length);
+    }
 
     if(resizeWasTooBig)
         return -1;
@@ -544,23 +884,20 @@ int SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::resizeLayerToText(const c
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::getDimensionsOfPrintedString(const char text[], uint16_t *w, uint16_t *h) {
-    int16_t x1, y1;
-    uint16_t width, height;
-
     // get the bounds of the text
-    wrap = false;
-    getTextBounds(text, 0, 0, &x1, &y1, &width, &height);
+    const smGfxTextLayout * layout = layoutText(text);
 
     // round up to multiple of 8 for width, to match Layer's requirements
-    width = ROUND_UP_TO_MULTIPLE_OF_8(width);
-    height = ROUND_UP_TO_MULTIPLE_OF_8(height);
-    *w = width;
-    *h = height;
+    *w = ROUND_UP_TO_MULTIPLE_OF_8(layout->w);
+    *h = ROUND_UP_TO_MULTIPLE_OF_8(layout->h);
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::clearRefreshAndDrawingBuffers() {
     memset(indexedBitmap, 0x00, RGB1_BUFFER_SIZE*2);
+    clearOccupied(0);
+    clearOccupied(1);
+    setRenderedTextsEmpty();
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
@@ -678,6 +1015,7 @@ void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setStartOffsetFromLeft(i
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
 void SMLayerGFXMono<RGB_API, RGB_STORAGE, optionFlags>::setColor(const RGB_API & newColor) {
     indexedColor[1] = newColor;
+    refreshSettingsChanged = true;
 }
 
 template <typename RGB_API, typename RGB_STORAGE, unsigned int optionFlags>
@@ -46,12 +46,17 @@ class SMLayerIndexed : public SM_Layer {
 
         void setIndexedColor(uint8_t index, const RGB & newColor);
         void fillScreen(uint8_t index);
-        // behavior is a little different from SMLayerBackground.swapBuffers() - will always copy, but bool forces waiting to avoid updating the drawing buffer before refresh is updated
+        // with copy, waits for the swap and copies the rows drawn since the last swap to the new drawing buffer, the other rows already
+        // match; after a swap without copy the next copy is of every row
         void swapBuffers(bool copy = true);
         void drawPixel(int16_t x, int16_t y, uint8_t index);
         void setFont(fontChoices newFont);
+        // e.g. a font filled by loadPackedBitmapFont(), it has to stay valid while it's used
+        void setFont(const bitmap_font *newFont);
         // todo: handle index (draw transparent)
         void drawChar(int16_t x, int16_t y, uint8_t index, char character);
+        // drawString() takes UTF-8, drawCodepoint() draws one Unicode character
+        void drawCodepoint(int16_t x, int16_t y, uint8_t index, uint32_t codepoint);
         void drawString(int16_t x, int16_t y, uint8_t index, const char text []);
         void drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t index, uint8_t *bitmap);
 
@@ -68,6 +73,10 @@ class SMLayerIndexed : public SM_Layer {
 
 
         RGB color;
+        // color in both refresh formats, converted in frameRefreshCallback() after the color or color correction changes
+        rgb48 refreshColor48;
+        rgb24 refreshColor24;
+        void convertRefreshColor(void);
         unsigned char currentframe = 0;
         char text[textLayerMaxStringLength];
 
@@ -94,6 +103,17 @@ class SMLayerIndexed : public SM_Layer {
         volatile bool swapPending;
         void handleBufferSwap(void);
 
+        // changed row tracking: local rows drawn since the last swapBuffers(), and the rows that will change when the pending swap happens
+        void markRowsDrawn(int firstRow, int lastRow);
+        int16_t drawnRowsFirst = 0x7FFF;
+        int16_t drawnRowsLast = -1;
+        int16_t swapRowsFirst = 0;
+        int16_t swapRowsLast = 0x7FFF;
+        // false if the drawing buffer may differ from the refresh buffer in rows that weren't drawn (swap without copy)
+        bool drawBufferMatchesRefresh = false;
+        // color or color correction changed, affecting every row
+        volatile bool refreshSettingsChanged = true;
+
         bitmap_font *layerFont = (bitmap_font *) &apple3x5;
 };
 
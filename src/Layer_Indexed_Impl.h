@@ -45,6 +45,7 @@ SMLayerIndexed<RGB, optionFlags>::SMLayerIndexed(uint16_t width, uint16_t height
     //this->assert(indexedBitmap != NULL);
 #endif
     memset(indexedBitmap, 0x00, 2 * width * (height / 8));
+    smRecordAllocation(smMemoryLayers, indexedBitmap, 2 * width * (height / 8));
     this->matrixWidth = width;
     this->matrixHeight = height;
     this->color = rgb48(0xffff, 0xffff, 0xffff);
@@ -58,8 +59,35 @@ void SMLayerIndexed<RGB, optionFlags>::begin(void) {
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::frameRefreshCallback(void) {
+void SM_FLASH_SAFE_IRAM SMLayerIndexed<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
     handleBufferSwap();
+
+    if(refreshSettingsChanged) {
+        this->markAllRowsChanged();
+        refreshSettingsChanged = false;
+        convertRefreshColor();
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerIndexed<RGB, optionFlags>::convertRefreshColor(void) {
+    if(this->ccEnabled) {
+        colorCorrection(color, refreshColor48);
+        colorCorrection(color, refreshColor24);
+    } else {
+        refreshColor48 = color;
+        refreshColor24 = color;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::markRowsDrawn(int firstRow, int lastRow) {
+    if(firstRow < drawnRowsFirst)
+        drawnRowsFirst = firstRow;
+    if(lastRow > drawnRowsLast)
+        drawnRowsLast = lastRow;
 }
 
 // returns true and copies color to xyPixel if pixel is opaque, returns false if not
@@ -101,59 +129,25 @@ bool SMLayerIndexed<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t har
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
-    int i;
-
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
-
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
-
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
-        }
-    }
+void SM_FLASH_SAFE_IRAM SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    this->fillRefreshRowFrom1bppBitmap(&indexedBitmap[currentRefreshBuffer * INDEXED_BUFFER_SIZE], hardwareY, refreshColor48, refreshRow);
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    RGB currentPixel;
-    int i;
-
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
-
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
-
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
-        }
-    }
+void SM_FLASH_SAFE_IRAM SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    this->fillRefreshRowFrom1bppBitmap(&indexedBitmap[currentRefreshBuffer * INDEXED_BUFFER_SIZE], hardwareY, refreshColor24, refreshRow);
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::setIndexedColor(uint8_t index, const RGB & newColor) {
     color = newColor;
+    refreshSettingsChanged = true;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -165,23 +159,46 @@ void SMLayerIndexed<RGB, optionFlags>::fillScreen(uint8_t index) {
         fillValue = 0x00;
 
     memset(&indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE], fillValue, INDEXED_BUFFER_SIZE);
+    markRowsDrawn(0, this->localHeight - 1);
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::swapBuffers(bool copy) {
     while (swapPending);
 
+    // hand off the rows that will change with this swap to handleBufferSwap()
+    if(drawBufferMatchesRefresh) {
+        swapRowsFirst = drawnRowsFirst;
+        swapRowsLast = drawnRowsLast;
+    } else {
+        swapRowsFirst = 0;
+        swapRowsLast = 0x7FFF;
+    }
+    drawnRowsFirst = 0x7FFF;
+    drawnRowsLast = -1;
+    drawBufferMatchesRefresh = copy;
+
+    SM_PROFILE_SWAP_REQUESTED();
     swapPending = true;
 
     if(copy) {
         while(swapPending);
 
 #if 1
+        // the buffers only differ in the rows drawn before this swap (all rows after a swap without copy), so only those are copied
+        int firstRow = max((int)swapRowsFirst, 0);
+        int lastRow = min((int)swapRowsLast, this->localHeight - 1);
+        if(firstRow > lastRow)
+            return;
+
+        int offset = firstRow * INDEXED_BUFFER_ROW_SIZE;
+        int length = (lastRow - firstRow + 1) * INDEXED_BUFFER_ROW_SIZE;
+
         // workaround for bizarre (optimization) bug - currentDrawBuffer and currentRefreshBuffer are volatile and are changed by an ISR while we're waiting for swapPending here.  They can't be used as parameters to memcpy directly though.  
         if(currentDrawBuffer)
-            memcpy(&indexedBitmap[INDEXED_BUFFER_SIZE], &indexedBitmap[0], INDEXED_BUFFER_SIZE);
+            memcpy(&indexedBitmap[INDEXED_BUFFER_SIZE + offset], &indexedBitmap[offset], length);
         else
-            memcpy(&indexedBitmap[0], &indexedBitmap[INDEXED_BUFFER_SIZE], INDEXED_BUFFER_SIZE);
+            memcpy(&indexedBitmap[offset], &indexedBitmap[INDEXED_BUFFER_SIZE + offset], length);
 #else
         // below is untested after copying from backgroundLayer to indexedLayer:
 
@@ -199,7 +216,7 @@ void SMLayerIndexed<RGB, optionFlags>::swapBuffers(bool copy) {
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::handleBufferSwap(void) {
+void SM_FLASH_SAFE_IRAM SMLayerIndexed<RGB, optionFlags>::handleBufferSwap(void) {
     if (!swapPending)
         return;
 
@@ -208,6 +225,9 @@ void SMLayerIndexed<RGB, optionFlags>::handleBufferSwap(void) {
     currentRefreshBuffer = currentDrawBuffer;
     currentDrawBuffer = newDrawBuffer;
 
+    this->markLocalRowsChanged(swapRowsFirst, swapRowsLast);
+
+    SM_PROFILE_SWAP_PICKED_UP();
     swapPending = false;
 }
 
@@ -218,6 +238,8 @@ void SMLayerIndexed<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint8_t i
     if(x < 0 || x >= this->localWidth || y < 0 || y >= this->localHeight)
         return;
 
+    markRowsDrawn(y, y);
+
     if(index) {
         tempBitmask = 0x80 >> (x%8);
         indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x/8)] |= tempBitmask;
@@ -229,12 +251,26 @@ void SMLayerIndexed<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint8_t i
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::setFont(fontChoices newFont) {
-    layerFont = (bitmap_font *)fontLookup(newFont);
+    setFont(fontLookup(newFont));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::setFont(const bitmap_font *newFont) {
+    layerFont = (bitmap_font *)newFont;
     majorScrollFontChange = true;
+
+#ifdef SM_FONT_PRELOAD_ASCII
+    preloadBitmapFontGlyphs(layerFont, ' ', '~');
+#endif
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t index, char character) {
+    drawCodepoint(x, y, index, (unsigned char)character);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::drawCodepoint(int16_t x, int16_t y, uint8_t index, uint32_t codepoint) {
     uint8_t tempBitmask;
     int k;
 
@@ -243,12 +279,18 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
         return;
     }
 
+    const unsigned char *rows = getBitmapFontCodepointRows(codepoint, layerFont);
+    if (!rows)
+        return;
+
+    markRowsDrawn(y, y + layerFont->Height - 1);
+
     for (k = y; k < y+layerFont->Height; k++) {
         // ignore rows that are not on the screen
         if(k < 0) continue;
         if (k >= this->localHeight) return;
 
-        tempBitmask = getBitmapFontRowAtXY(character, k - y, layerFont);
+        tempBitmask = rows[k - y];
         if (x < 0) {
             indexedBitmap[currentDrawBuffer*INDEXED_BUFFER_SIZE + (k * INDEXED_BUFFER_ROW_SIZE) + 0] |= tempBitmask << -x;
         } else {
@@ -262,11 +304,8 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::drawString(int16_t x, int16_t y, uint8_t index, const char text []) {
-    int offset = 0;
-    char character;
-
-    while ((character = text[offset++]) != '\0') {
-        drawChar(x, y, index, character);
+    while (*text) {
+        drawCodepoint(x, y, index, getNextUtf8Codepoint(&text));
         x += layerFont->Width;
     }
 }
@@ -0,0 +1,149 @@
+/*
+ * SmartMatrix Library - Paletted Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_PALETTED_H_
+#define _LAYER_PALETTED_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+// font
+#include "MatrixFontCommon.h"
+
+// 8 bits per pixel (256 colors) unless 2BPP (4 colors) or 4BPP (16 colors) is set
+#define SM_PALETTED_OPTIONS_NONE        0
+#define SM_PALETTED_OPTIONS_2BPP        (1 << 0)
+#define SM_PALETTED_OPTIONS_4BPP        (1 << 1)
+// index 0 is transparent unless OPAQUE is set, and then the layer covers the layers below it
+#define SM_PALETTED_OPTIONS_OPAQUE      (1 << 2)
+
+#define SM_PALETTED_BITS_PER_PIXEL(options)             (((options) & SM_PALETTED_OPTIONS_2BPP) ? 2 : (((options) & SM_PALETTED_OPTIONS_4BPP) ? 4 : 8))
+// bytes in one of the two buffers, width * bits per pixel has to be a multiple of 8
+#define SM_PALETTED_BUFFER_SIZE(width, height, options) (((width) * SM_PALETTED_BITS_PER_PIXEL(options) / 8) * (height))
+
+// Pixels are palette indexes, packed MSB first in hardware row order, so refresh reads each row straight through and skips empty
+// (transparent) words.  The palette is converted to the refresh formats at the start of a frame after it changes, so changing
+// colors or cycling part of the palette costs a palette conversion instead of redrawing the pixels.
+template <typename RGB, unsigned int optionFlags>
+class SMLayerPaletted : public SM_Layer {
+    public:
+        // buffer holds 2 * SM_PALETTED_BUFFER_SIZE(width, height, optionFlags) bytes (drawing and refresh)
+        SMLayerPaletted(uint8_t * buffer, uint16_t width, uint16_t height);
+        SMLayerPaletted(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+        bool isLayerOpaque();
+
+        void enableColorCorrection(bool enabled);
+
+        // palette changes take effect together at the start of the next refresh frame, affecting the pixels already drawn
+        void setPaletteColor(uint8_t index, const RGB & newColor);
+        void setPalette(const RGB * colors, uint16_t firstIndex, uint16_t numColors);
+        const RGB & getPaletteColor(uint8_t index) const { return palette[index & (paletteSize - 1)]; };
+        // every framesPerStep refresh frames, the colors of entries firstIndex..lastIndex move down one entry (with the first
+        // wrapping around to lastIndex), framesPerStep 0 stops cycling and shows the palette as set again
+        void setPaletteCycle(uint8_t firstIndex, uint8_t lastIndex, uint8_t framesPerStep);
+
+        // waits until the previous swap is complete, and with copy waits for this swap and copies the new refresh buffer to the drawing buffer
+        void swapBuffers(bool copy = true);
+
+        void fillScreen(uint8_t index);
+        void drawPixel(int16_t x, int16_t y, uint8_t index);
+        uint8_t readPixel(int16_t x, int16_t y);
+        void fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t index);
+        // src has one index per byte, stride is the bytes per source row (0 = width), srcTransparent skips that index (-1 = none)
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *src, uint16_t stride = 0, int16_t srcTransparent = -1);
+        void setFont(fontChoices newFont);
+        // e.g. a font filled by loadPackedBitmapFont(), it has to stay valid while it's used
+        void setFont(const bitmap_font *newFont);
+        void drawChar(int16_t x, int16_t y, uint8_t index, char character);
+        // drawString() takes UTF-8, drawCodepoint() draws one Unicode character
+        void drawCodepoint(int16_t x, int16_t y, uint8_t index, uint32_t codepoint);
+        void drawString(int16_t x, int16_t y, uint8_t index, const char text []);
+
+    protected:
+        static const int bitsPerPixel = SM_PALETTED_BITS_PER_PIXEL(optionFlags);
+        static const int paletteSize = 1 << bitsPerPixel;
+        static const int pixelsPerByte = 8 / bitsPerPixel;
+
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, const RGB_OUT * colors, RGB_OUT refreshRow[]);
+        void convertPalette(void);
+        void beginPaletteEdit(void);
+        void endPaletteEdit(void);
+        void mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy);
+        void setHardwarePixel(uint8_t * buffer, int hwx, int hwy, uint8_t index);
+        void markHardwareRowsDrawn(int hwy0, int hwy1);
+
+        uint8_t * palettedBuffers[2];
+        uint16_t rowBytes;
+
+        RGB palette[paletteSize];
+        // palette in both refresh formats with color correction and cycling applied, converted in frameRefreshCallback()
+        rgb48 refreshPalette48[paletteSize];
+        rgb24 refreshPalette24[paletteSize];
+        // palette, cycle range and color correction edits are bracketed by a sequence number that's odd during an edit: refresh copies
+        // them to paletteSnapshot and only converts the copy if the sequence didn't change meanwhile, otherwise it tries at the next frame
+        volatile uint32_t paletteSequence = 0;
+        uint32_t convertedSequence = 1;
+        RGB paletteSnapshot[paletteSize];
+
+        volatile uint8_t cycleFirst = 0;
+        volatile uint8_t cycleLast = 0;
+        volatile uint8_t cycleFramesPerStep = 0;
+        // owned by refresh: the cycle range last converted, and the position in it
+        uint8_t refreshCycleFirst = 0;
+        uint8_t refreshCycleLast = 0;
+        uint8_t refreshCycleFramesPerStep = 0;
+        bool refreshCcEnabled = false;
+        uint8_t cycleFrameCount = 0;
+        uint8_t cycleOffset = 0;
+
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+
+        // keeping track of drawing buffers
+        volatile unsigned char currentDrawBuffer;
+        volatile unsigned char currentRefreshBuffer;
+        volatile bool swapPending;
+        void handleBufferSwap(void);
+
+        // changed row tracking: hardware rows drawn since the last swapBuffers(), and the rows that will change when the pending swap happens
+        uint16_t drawnRowsFirst = 0xFFFF;
+        uint16_t drawnRowsLast = 0;
+        uint16_t swapRowsFirst = 0;
+        uint16_t swapRowsLast = 0xFFFF;
+        // false if the drawing buffer may differ from the refresh buffer in rows that weren't drawn (swap without copy)
+        bool drawBufferMatchesRefresh = false;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+
+        bitmap_font *layerFont = (bitmap_font *) &apple3x5;
+};
+
+#include "Layer_Paletted_Impl.h"
+
+#endif
@@ -0,0 +1,467 @@
+/*
+ * SmartMatrix Library - Paletted Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#define PALETTED_BUFFER_SIZE            (rowBytes * this->matrixHeight)
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerPaletted<RGB, optionFlags>::SMLayerPaletted(uint8_t * buffer, uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    rowBytes = width / pixelsPerByte;
+    palettedBuffers[0] = buffer;
+    palettedBuffers[1] = buffer + PALETTED_BUFFER_SIZE;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerPaletted<RGB, optionFlags>::SMLayerPaletted(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    rowBytes = width / pixelsPerByte;
+    palettedBuffers[0] = (uint8_t *)malloc(2 * PALETTED_BUFFER_SIZE);
+#ifdef ESP32
+    assert(palettedBuffers[0] != NULL);
+#endif
+    smRecordAllocation(smMemoryLayers, palettedBuffers[0], 2 * PALETTED_BUFFER_SIZE);
+    palettedBuffers[1] = palettedBuffers[0] + PALETTED_BUFFER_SIZE;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::begin(void) {
+    currentDrawBuffer = 0;
+    currentRefreshBuffer = 1;
+    swapPending = false;
+
+    // both buffers start out as index 0 (transparent unless the layer is opaque)
+    memset(palettedBuffers[0], 0x00, 2 * PALETTED_BUFFER_SIZE);
+    drawBufferMatchesRefresh = true;
+    convertedSequence = paletteSequence + 1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    handleBufferSwap();
+
+    // nothing is read while the sketch is editing, the edit is picked up at a later frame
+    uint32_t sequence = paletteSequence;
+    if(sequence & 1)
+        return;
+    __sync_synchronize();
+
+    memcpy(paletteSnapshot, palette, sizeof(palette));
+    uint8_t first = cycleFirst;
+    uint8_t last = cycleLast;
+    uint8_t framesPerStep = cycleFramesPerStep;
+    bool ccEnabled = this->ccEnabled;
+
+    // an edit that overlapped the copy may have left it half old and half new
+    __sync_synchronize();
+    if(paletteSequence != sequence)
+        return;
+
+    bool changed = (sequence != convertedSequence);
+    convertedSequence = sequence;
+    refreshCcEnabled = ccEnabled;
+
+    // a new range starts cycling from the palette as set
+    if(first != refreshCycleFirst || last != refreshCycleLast || framesPerStep != refreshCycleFramesPerStep) {
+        refreshCycleFirst = first;
+        refreshCycleLast = last;
+        refreshCycleFramesPerStep = framesPerStep;
+        cycleOffset = 0;
+        cycleFrameCount = 0;
+    }
+
+    if(framesPerStep && ++cycleFrameCount >= framesPerStep) {
+        cycleFrameCount = 0;
+        cycleOffset = (cycleOffset + 1) % (last - first + 1);
+        changed = true;
+    }
+
+    if(changed) {
+        convertPalette();
+        this->markAllRowsChanged();
+    }
+}
+
+// converts paletteSnapshot with the cycle range and color correction frameRefreshCallback() took with it
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::convertPalette(void) {
+    int first = refreshCycleFirst;
+    int length = refreshCycleFramesPerStep ? (refreshCycleLast - refreshCycleFirst + 1) : 0;
+
+    for(int i=0; i<paletteSize; i++) {
+        int source = i;
+        if(i >= first && i < first + length)
+            source = first + (i - first + cycleOffset) % length;
+
+        if(refreshCcEnabled) {
+            colorCorrection(paletteSnapshot[source], refreshPalette48[i]);
+            colorCorrection(paletteSnapshot[source], refreshPalette24[i]);
+        } else {
+            refreshPalette48[i] = paletteSnapshot[source];
+            refreshPalette24[i] = paletteSnapshot[source];
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+    else if (this->layerRotation == rotation180)
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+    else if (this->layerRotation == rotation90)
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+    else /* if (layerRotation == rotation270)*/
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::isLayerOpaque() {
+    return (optionFlags & SM_PALETTED_OPTIONS_OPAQUE) ? true : false;
+}
+
+// the row is stored in hardware order, so it's read straight through; without OPAQUE, runs of four transparent bytes are
+// skipped with one compare, and the pixels in each byte are unpacked with constant shifts
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, const RGB_OUT * colors, RGB_OUT refreshRow[]) {
+    const bool opaque = (optionFlags & SM_PALETTED_OPTIONS_OPAQUE);
+    const uint8_t indexMask = (1 << bitsPerPixel) - 1;
+    const uint8_t * src = &palettedBuffers[currentRefreshBuffer][hardwareY * rowBytes];
+
+    int i = 0;
+    while(i < rowBytes) {
+        if(!opaque && i + 4 <= rowBytes) {
+            uint32_t word;
+            memcpy(&word, &src[i], sizeof(word));
+            if(!word) {
+                i += 4;
+                continue;
+            }
+        }
+
+        uint8_t pixels = src[i];
+        RGB_OUT * dst = &refreshRow[i * pixelsPerByte];
+        i++;
+
+        if(!opaque && !pixels)
+            continue;
+
+        for(int p=0; p<pixelsPerByte; p++) {
+            uint8_t index = (pixels >> (8 - bitsPerPixel * (p + 1))) & indexMask;
+            if(opaque || index)
+                dst[p] = colors[index];
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshPalette48, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshPalette24, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    beginPaletteEdit();
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    endPaletteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::beginPaletteEdit(void) {
+    paletteSequence = paletteSequence + 1;
+    __sync_synchronize();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::endPaletteEdit(void) {
+    __sync_synchronize();
+    paletteSequence = paletteSequence + 1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setPaletteColor(uint8_t index, const RGB & newColor) {
+    setPalette(&newColor, index, 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setPalette(const RGB * colors, uint16_t firstIndex, uint16_t numColors) {
+    if(firstIndex >= paletteSize)
+        return;
+    if(firstIndex + numColors > paletteSize)
+        numColors = paletteSize - firstIndex;
+
+    beginPaletteEdit();
+    for(int i=0; i<numColors; i++)
+        palette[firstIndex + i] = colors[i];
+    endPaletteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setPaletteCycle(uint8_t firstIndex, uint8_t lastIndex, uint8_t framesPerStep) {
+    firstIndex &= (paletteSize - 1);
+    lastIndex &= (paletteSize - 1);
+    if(lastIndex < firstIndex)
+        SWAPint(firstIndex, lastIndex);
+
+    // refresh restarts the cycle when it sees a new range
+    beginPaletteEdit();
+    cycleFirst = firstIndex;
+    cycleLast = lastIndex;
+    cycleFramesPerStep = (lastIndex > firstIndex) ? framesPerStep : 0;
+    endPaletteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPaletted<RGB, optionFlags>::handleBufferSwap(void) {
+    if (!swapPending)
+        return;
+
+    unsigned char newDrawBuffer = currentRefreshBuffer;
+
+    currentRefreshBuffer = currentDrawBuffer;
+    currentDrawBuffer = newDrawBuffer;
+
+    this->markRowsChanged(swapRowsFirst, swapRowsLast);
+
+    SM_PROFILE_SWAP_PICKED_UP();
+    swapPending = false;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::swapBuffers(bool copy) {
+    while (swapPending);
+
+    // hand off the rows that will change with this swap to handleBufferSwap()
+    if(drawBufferMatchesRefresh) {
+        swapRowsFirst = drawnRowsFirst;
+        swapRowsLast = drawnRowsLast;
+    } else {
+        swapRowsFirst = 0;
+        swapRowsLast = 0xFFFF;
+    }
+    drawnRowsFirst = 0xFFFF;
+    drawnRowsLast = 0;
+    drawBufferMatchesRefresh = copy;
+
+    SM_PROFILE_SWAP_REQUESTED();
+    swapPending = true;
+
+    if (copy) {
+        while (swapPending);
+
+        // the volatile indexes are only read once, see SMLayerBackground::swapBuffers()
+        unsigned char drawBuffer = currentDrawBuffer;
+        memcpy(palettedBuffers[drawBuffer], palettedBuffers[!drawBuffer], PALETTED_BUFFER_SIZE);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy) {
+    localToHardwareForRotation(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerPaletted<RGB, optionFlags>::setHardwarePixel(uint8_t * buffer, int hwx, int hwy, uint8_t index) {
+    uint8_t & pixels = buffer[hwy * rowBytes + hwx / pixelsPerByte];
+    int shift = 8 - bitsPerPixel * ((hwx % pixelsPerByte) + 1);
+    uint8_t mask = ((1 << bitsPerPixel) - 1) << shift;
+
+    pixels = (pixels & ~mask) | ((index << shift) & mask);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::markHardwareRowsDrawn(int hwy0, int hwy1) {
+    if(hwy0 < drawnRowsFirst)
+        drawnRowsFirst = hwy0;
+    if(hwy1 > drawnRowsLast)
+        drawnRowsLast = hwy1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::fillScreen(uint8_t index) {
+    index &= (paletteSize - 1);
+
+    // repeat the index to fill a byte
+    uint8_t pixels = index;
+    for(int p=1; p<pixelsPerByte; p++)
+        pixels = (pixels << bitsPerPixel) | index;
+
+    memset(palettedBuffers[currentDrawBuffer], pixels, PALETTED_BUFFER_SIZE);
+    markHardwareRowsDrawn(0, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint8_t index) {
+    if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
+        return;
+
+    int16_t hwx, hwy;
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    setHardwarePixel(palettedBuffers[currentDrawBuffer], hwx, hwy, index);
+    markHardwareRowsDrawn(hwy, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerPaletted<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
+    if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
+        return 0;
+
+    int16_t hwx, hwy;
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    uint8_t pixels = palettedBuffers[currentDrawBuffer][hwy * rowBytes + hwx / pixelsPerByte];
+    return (pixels >> (8 - bitsPerPixel * ((hwx % pixelsPerByte) + 1))) & ((1 << bitsPerPixel) - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t index) {
+    if (x1 < x0)
+        SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
+
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    // opposite corners of the local rectangle are opposite corners of the hardware rectangle
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+    int16_t hwx0 = std::min(ax, bx), hwx1 = std::max(ax, bx);
+    int16_t hwy0 = std::min(ay, by), hwy1 = std::max(ay, by);
+
+    uint8_t * buffer = palettedBuffers[currentDrawBuffer];
+
+    for(int hwy = hwy0; hwy <= hwy1; hwy++) {
+        if(bitsPerPixel == 8) {
+            memset(&buffer[hwy * rowBytes + hwx0], index, hwx1 - hwx0 + 1);
+        } else {
+            for(int hwx = hwx0; hwx <= hwx1; hwx++)
+                setHardwarePixel(buffer, hwx, hwy, index);
+        }
+    }
+
+    markHardwareRowsDrawn(hwy0, hwy1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *src, uint16_t stride, int16_t srcTransparent) {
+    if(!stride)
+        stride = width;
+
+    // clip to the layer once, then walk the visible part of the source
+    int x0 = std::max<int>(x, 0);
+    int y0 = std::max<int>(y, 0);
+    int x1 = std::min<int>(x + width, this->localWidth) - 1;
+    int y1 = std::min<int>(y + height, this->localHeight) - 1;
+
+    if(x0 > x1 || y0 > y1)
+        return;
+
+    uint8_t * buffer = palettedBuffers[currentDrawBuffer];
+
+    for(int ly = y0; ly <= y1; ly++) {
+        const uint8_t * srcPixel = src + (ly - y) * stride + (x0 - x);
+
+        for(int lx = x0; lx <= x1; lx++, srcPixel++) {
+            if(*srcPixel == srcTransparent)
+                continue;
+
+            int16_t hwx, hwy;
+            mapLocalToHardware(lx, ly, hwx, hwy);
+            setHardwarePixel(buffer, hwx, hwy, *srcPixel);
+        }
+    }
+
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+    markHardwareRowsDrawn(std::min(ay, by), std::max(ay, by));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setFont(fontChoices newFont) {
+    setFont(fontLookup(newFont));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::setFont(const bitmap_font *newFont) {
+    layerFont = (bitmap_font *)newFont;
+
+#ifdef SM_FONT_PRELOAD_ASCII
+    preloadBitmapFontGlyphs(layerFont, ' ', '~');
+#endif
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t index, char character) {
+    drawCodepoint(x, y, index, (unsigned char)character);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::drawCodepoint(int16_t x, int16_t y, uint8_t index, uint32_t codepoint) {
+    // only draw if character is on the screen
+    if (x + layerFont->Width < 0 || x >= this->localWidth || y + layerFont->Height < 0 || y >= this->localHeight)
+        return;
+
+    const unsigned char *rows = getBitmapFontCodepointRows(codepoint, layerFont);
+    if (!rows)
+        return;
+
+    for (int k = 0; k < layerFont->Height; k++) {
+        uint8_t tempBitmask = rows[k];
+
+        for (int i = 0; tempBitmask; i++, tempBitmask <<= 1) {
+            if (tempBitmask & 0x80)
+                drawPixel(x + i, y + k, index);
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPaletted<RGB, optionFlags>::drawString(int16_t x, int16_t y, uint8_t index, const char text []) {
+    while (*text) {
+        drawCodepoint(x, y, index, getNextUtf8Codepoint(&text));
+        x += layerFont->Width;
+    }
+}
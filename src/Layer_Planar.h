@@ -0,0 +1,123 @@
+/*
+ * SmartMatrix Library - Planar Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_PLANAR_H_
+#define _LAYER_PLANAR_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_PLANAR_OPTIONS_NONE      0
+
+// channels are stored with 8 bits (rgb8, rgb16 and rgb24 layers) or 16 bits (rgb48 layers)
+template <typename RGB> struct SMPlanarTraits { typedef uint8_t channel; typedef rgb24 color; };
+template <> struct SMPlanarTraits<rgb48> { typedef uint16_t channel; typedef rgb48 color; };
+
+// number of channel values to allocate for the buffer passed to the constructor: red, green and blue planes for drawing and refresh
+#define SM_PLANAR_BUFFER_SIZE(width, height)    (2 * 3 * (width) * (height))
+
+// An opaque full color layer that keeps each channel in its own plane instead of interleaving red, green and blue.  Planes are stored
+// in hardware row order, so refresh converts a row one channel at a time, each a contiguous read through a single table, and effects
+// that work on one channel (or the same way on all three) can loop over a plane from getPlane() with no stride.
+template <typename RGB, unsigned int optionFlags>
+class SMLayerPlanar : public SM_Layer {
+    public:
+        typedef typename SMPlanarTraits<RGB>::channel planeChannel;
+        typedef typename SMPlanarTraits<RGB>::color planeColor;
+
+        // buffer holds SM_PLANAR_BUFFER_SIZE(width, height) channel values
+        SMLayerPlanar(planeChannel * buffer, uint16_t width, uint16_t height);
+        SMLayerPlanar(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+        bool isLayerChanged();
+        bool isLayerOpaque();
+
+        void enableColorCorrection(bool enabled);
+        void setBrightness(uint8_t brightness);
+
+        // waits until the previous swap is complete, and with copy waits for this swap and copies the rows drawn before it to the new drawing buffer
+        void swapBuffers(bool copy = true);
+        bool isSwapPending(void);
+
+        void fillScreen(const RGB& color);
+        void drawPixel(int16_t x, int16_t y, const RGB& color);
+        void drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color);
+        void drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color);
+        void fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        // reads pixel from drawing buffer, not refresh buffer
+        const RGB readPixel(int16_t x, int16_t y);
+
+        // drawing buffer plane for channel 0 (red), 1 (green) or 2 (blue): matrixWidth x matrixHeight values in hardware row order
+        // the whole buffer is treated as drawn at the next swapBuffers(), as the layer can't tell which rows were changed
+        planeChannel * getPlane(uint8_t channel);
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts);
+        // converts one plane row into one channel of refreshRow
+        template <typename RGB_OUT, typename CHAN_OUT>
+        void fillRefreshRowChannel(const planeChannel * src, CHAN_OUT RGB_OUT::*channel, RGB_OUT refreshRow[], int brightnessShifts);
+        void calculateRefreshLUT(void);
+        void mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy);
+        static void fillPlaneSpan(planeChannel * dst, planeChannel value, uint16_t numValues);
+        void markHardwareRowsDrawn(int hwy0, int hwy1);
+
+        planeChannel * planarBuffers[2];
+        uint32_t planeSize;
+
+        // 8-bit planes: refresh value for each stored value with color correction and brightness, rebuilt in frameRefreshCallback()
+        // rgb24 refresh rows use the top 8 bits; 16-bit planes are only scaled by brightness
+        uint16_t refreshLUT[sizeof(planeChannel) == 1 ? 256 : 1];
+        uint8_t refreshBrightness = 255;
+        volatile uint8_t layerBrightness = 255;
+        volatile bool refreshSettingsChanged = true;
+        // brightnessShifts the 8-bit table was built with, and the value refresh last passed to fillRefreshRow()
+        int lutBrightnessShifts = 0;
+        volatile int refreshBrightnessShifts = 0;
+
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+
+        // keeping track of drawing buffers
+        volatile unsigned char currentDrawBuffer;
+        volatile unsigned char currentRefreshBuffer;
+        volatile bool swapPending;
+        void handleBufferSwap(void);
+
+        // changed row tracking: hardware rows drawn since the last swapBuffers(), and the rows that will change when the pending swap happens
+        uint16_t drawnRowsFirst = 0xFFFF;
+        uint16_t drawnRowsLast = 0;
+        uint16_t swapRowsFirst = 0;
+        uint16_t swapRowsLast = 0xFFFF;
+        // false if the drawing buffer may differ from the refresh buffer in rows that weren't drawn (swap without copy)
+        bool drawBufferMatchesRefresh = false;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+};
+
+#include "Layer_Planar_Impl.h"
+
+#endif
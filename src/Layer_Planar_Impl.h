@@ -0,0 +1,349 @@
+/*
+ * SmartMatrix Library - Planar Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerPlanar<RGB, optionFlags>::SMLayerPlanar(planeChannel * buffer, uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    planeSize = (uint32_t)width * height;
+    planarBuffers[0] = buffer;
+    planarBuffers[1] = buffer + 3 * planeSize;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerPlanar<RGB, optionFlags>::SMLayerPlanar(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    planeSize = (uint32_t)width * height;
+    planarBuffers[0] = (planeChannel *)malloc(sizeof(planeChannel) * SM_PLANAR_BUFFER_SIZE(width, height));
+#ifdef ESP32
+    assert(planarBuffers[0] != NULL);
+#endif
+    smRecordAllocation(smMemoryLayers, planarBuffers[0], sizeof(planeChannel) * SM_PLANAR_BUFFER_SIZE(width, height));
+    planarBuffers[1] = planarBuffers[0] + 3 * planeSize;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::begin(void) {
+    currentDrawBuffer = 0;
+    currentRefreshBuffer = 1;
+    swapPending = false;
+
+    memset(planarBuffers[0], 0x00, sizeof(planeChannel) * SM_PLANAR_BUFFER_SIZE(this->matrixWidth, this->matrixHeight));
+    drawBufferMatchesRefresh = true;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    handleBufferSwap();
+
+    if(refreshSettingsChanged) {
+        refreshSettingsChanged = false;
+        refreshBrightness = layerBrightness;
+        calculateRefreshLUT();
+        this->markAllRowsChanged();
+    } else if(sizeof(planeChannel) == 1 && lutBrightnessShifts != refreshBrightnessShifts) {
+        // the table follows the brightnessShifts used for the previous frame, so a change takes effect one frame late
+        calculateRefreshLUT();
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::calculateRefreshLUT(void) {
+    if(sizeof(planeChannel) != 1)
+        return;
+
+    // brightnessShifts is applied while building the table, so it's indexed with the unshifted value
+    const int shifts = refreshBrightnessShifts;
+    uint16_t * lut = refreshLUT;
+    for(int i=0; i<256; i++) {
+        int shifted = std::min(255, i << shifts);
+        uint32_t value = ccEnabled ? lightPowerMap16bit[shifted] : shifted * 257;
+        lut[i] = (value * (refreshBrightness + 1)) >> 8;
+    }
+    lutBrightnessShifts = shifts;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::isLayerChanged() {
+    return swapPending || refreshSettingsChanged;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+    else if (this->layerRotation == rotation180)
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+    else if (this->layerRotation == rotation90)
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+    else /* if (layerRotation == rotation270)*/
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::isLayerOpaque() {
+    return true;
+}
+
+// each channel is a straight pass over one plane row with a table lookup (8-bit planes) or a multiply (16-bit planes), instead of
+// loading a whole pixel to correct three channels
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT, typename CHAN_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::fillRefreshRowChannel(const planeChannel * src, CHAN_OUT RGB_OUT::*channel, RGB_OUT refreshRow[], int brightnessShifts) {
+    const int shift = (sizeof(CHAN_OUT) == 1) ? 8 : 0;
+
+    if(sizeof(planeChannel) == 1) {
+        // the table already has brightnessShifts applied
+        const uint16_t * lut = refreshLUT;
+        for(int i=0; i<this->matrixWidth; i++)
+            refreshRow[i].*channel = lut[src[i]] >> shift;
+    } else {
+        const uint32_t scale = refreshBrightness + 1;
+        for(int i=0; i<this->matrixWidth; i++)
+            refreshRow[i].*channel = std::min<uint32_t>(((src[i] << brightnessShifts) * scale) >> 8, 0xFFFF) >> shift;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
+    const planeChannel * src = planarBuffers[currentRefreshBuffer] + hardwareY * this->matrixWidth;
+
+    // stored only on a change: with SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE both calc tasks fill rows of the same frame, with the same brightnessShifts
+    if(refreshBrightnessShifts != brightnessShifts)
+        refreshBrightnessShifts = brightnessShifts;
+
+    fillRefreshRowChannel(src, &RGB_OUT::red, refreshRow, brightnessShifts);
+    fillRefreshRowChannel(src + planeSize, &RGB_OUT::green, refreshRow, brightnessShifts);
+    fillRefreshRowChannel(src + 2 * planeSize, &RGB_OUT::blue, refreshRow, brightnessShifts);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow, brightnessShifts);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::setBrightness(uint8_t brightness) {
+    layerBrightness = brightness;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerPlanar<RGB, optionFlags>::handleBufferSwap(void) {
+    if (!swapPending)
+        return;
+
+    unsigned char newDrawBuffer = currentRefreshBuffer;
+
+    currentRefreshBuffer = currentDrawBuffer;
+    currentDrawBuffer = newDrawBuffer;
+
+    this->markRowsChanged(swapRowsFirst, swapRowsLast);
+
+    SM_PROFILE_SWAP_PICKED_UP();
+    swapPending = false;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::swapBuffers(bool copy) {
+    while (swapPending);
+
+    // hand off the rows that will change with this swap to handleBufferSwap()
+    if(drawBufferMatchesRefresh) {
+        swapRowsFirst = drawnRowsFirst;
+        swapRowsLast = drawnRowsLast;
+    } else {
+        swapRowsFirst = 0;
+        swapRowsLast = 0xFFFF;
+    }
+    drawnRowsFirst = 0xFFFF;
+    drawnRowsLast = 0;
+    drawBufferMatchesRefresh = copy;
+
+    SM_PROFILE_SWAP_REQUESTED();
+    swapPending = true;
+
+    if (copy) {
+        while (swapPending);
+
+        // the buffers only differ in the rows handed off with this swap, the rows of each plane are contiguous
+        int lastRow = std::min<int>(swapRowsLast, this->matrixHeight - 1);
+        if(swapRowsFirst > lastRow)
+            return;
+
+        uint32_t offset = swapRowsFirst * this->matrixWidth;
+        uint32_t length = (lastRow - swapRowsFirst + 1) * this->matrixWidth;
+
+        // the volatile indexes are only read once, see SMLayerBackground::swapBuffers()
+        unsigned char drawBuffer = currentDrawBuffer;
+        for(int i=0; i<3; i++)
+            memcpy(planarBuffers[drawBuffer] + i * planeSize + offset, planarBuffers[!drawBuffer] + i * planeSize + offset, sizeof(planeChannel) * length);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerPlanar<RGB, optionFlags>::isSwapPending(void) {
+    return swapPending;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy) {
+    localToHardwareForRotation(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::markHardwareRowsDrawn(int hwy0, int hwy1) {
+    if(hwy0 < drawnRowsFirst)
+        drawnRowsFirst = hwy0;
+    if(hwy1 > drawnRowsLast)
+        drawnRowsLast = hwy1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::fillPlaneSpan(planeChannel * dst, planeChannel value, uint16_t numValues) {
+    if(sizeof(planeChannel) == 1) {
+        memset(dst, value, numValues);
+    } else {
+        for(int i=0; i<numValues; i++)
+            dst[i] = value;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::fillScreen(const RGB& color) {
+    planeColor value(color);
+    planeChannel * buffer = planarBuffers[currentDrawBuffer];
+
+    // a plane can be larger than the 16-bit span length, so fill it a row at a time
+    for(int hwy=0; hwy<this->matrixHeight; hwy++) {
+        planeChannel * row = buffer + hwy * this->matrixWidth;
+        fillPlaneSpan(row, value.red, this->matrixWidth);
+        fillPlaneSpan(row + planeSize, value.green, this->matrixWidth);
+        fillPlaneSpan(row + 2 * planeSize, value.blue, this->matrixWidth);
+    }
+
+    markHardwareRowsDrawn(0, this->matrixHeight - 1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
+    if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
+        return;
+
+    int16_t hwx, hwy;
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    planeColor value(color);
+    planeChannel * pixel = planarBuffers[currentDrawBuffer] + hwy * this->matrixWidth + hwx;
+    pixel[0] = value.red;
+    pixel[planeSize] = value.green;
+    pixel[2 * planeSize] = value.blue;
+    markHardwareRowsDrawn(hwy, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+const RGB SMLayerPlanar<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
+    if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
+        return RGB(0, 0, 0);
+
+    int16_t hwx, hwy;
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    const planeChannel * pixel = planarBuffers[currentDrawBuffer] + hwy * this->matrixWidth + hwx;
+    return RGB(planeColor(pixel[0], pixel[planeSize], pixel[2 * planeSize]));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color) {
+    fillRectangle(x0, y, x1, y, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color) {
+    fillRectangle(x, y0, x, y1, color);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerPlanar<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    if (x1 < x0)
+        SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
+
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    // opposite corners of the local rectangle are opposite corners of the hardware rectangle
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+    int16_t hwx0 = std::min(ax, bx), hwx1 = std::max(ax, bx);
+    int16_t hwy0 = std::min(ay, by), hwy1 = std::max(ay, by);
+
+    planeColor value(color);
+    planeChannel * buffer = planarBuffers[currentDrawBuffer];
+
+    // one plane at a time, so each pass is a run of single channel stores
+    for(int hwy = hwy0; hwy <= hwy1; hwy++)
+        fillPlaneSpan(buffer + hwy * this->matrixWidth + hwx0, value.red, hwx1 - hwx0 + 1);
+    for(int hwy = hwy0; hwy <= hwy1; hwy++)
+        fillPlaneSpan(buffer + planeSize + hwy * this->matrixWidth + hwx0, value.green, hwx1 - hwx0 + 1);
+    for(int hwy = hwy0; hwy <= hwy1; hwy++)
+        fillPlaneSpan(buffer + 2 * planeSize + hwy * this->matrixWidth + hwx0, value.blue, hwx1 - hwx0 + 1);
+
+    markHardwareRowsDrawn(hwy0, hwy1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+typename SMLayerPlanar<RGB, optionFlags>::planeChannel * SMLayerPlanar<RGB, optionFlags>::getPlane(uint8_t channel) {
+    if(channel > 2)
+        return NULL;
+
+    markHardwareRowsDrawn(0, this->matrixHeight - 1);
+    return planarBuffers[currentDrawBuffer] + channel * planeSize;
+}
@@ -0,0 +1,106 @@
+/*
+ * SmartMatrix Library - RGBA Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_RGBA_H_
+#define _LAYER_RGBA_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_RGBA_OPTIONS_NONE     0
+
+// stored pixel: color already multiplied by alpha, so a fully transparent pixel is all zeros and blending needs no multiply for the source
+typedef struct rgba32 {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t alpha;
+} rgba32;
+
+// number of uint16_t values to allocate for the span buffer passed to the constructor
+#define SM_RGBA_SPAN_BUFFER_SIZE(height)     (2 * 2 * (height))
+
+template <typename RGB, unsigned int optionFlags>
+class SMLayerRGBA : public SM_Layer {
+    public:
+        // buffer holds 2 * width * height pixels (drawing and refresh), spanBuffer holds SM_RGBA_SPAN_BUFFER_SIZE(height) entries
+        SMLayerRGBA(rgba32 * buffer, uint16_t * spanBuffer, uint16_t width, uint16_t height);
+        SMLayerRGBA(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+
+        // colors are corrected when they're drawn so refresh only has to blend, changing this doesn't affect pixels already drawn
+        void enableColorCorrection(bool enabled);
+
+        // waits until the previous swap is complete, and with copy waits for this swap and copies the new refresh buffer to the drawing buffer
+        void swapBuffers(bool copy = true);
+
+        // replaces every pixel, fillScreen(color, 0) clears the layer to fully transparent
+        void fillScreen(const RGB& color, uint8_t alpha);
+        // drawPixel, fillRectangle and drawBitmap composite over what's already in the drawing buffer (alpha 255 overwrites)
+        void drawPixel(int16_t x, int16_t y, const RGB& color, uint8_t alpha = 255);
+        void fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color, uint8_t alpha = 255);
+        // src is 4 bytes per pixel: red, green, blue, alpha (not premultiplied); stride is the bytes per source row (0 = width pixels)
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *src, uint16_t stride = 0);
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+
+        rgba32 premultiply(const rgb24& color, uint8_t alpha);
+        // draws src over the draw buffer pixel at hardware x, y
+        void compositePixel(int16_t hwx, int16_t hwy, const rgba32& src);
+        void mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy);
+        // extends the draw buffer spans, and the drawn rows, to cover a hardware region
+        void markHardwareRegionDrawn(uint16_t hwx0, uint16_t hwy0, uint16_t hwx1, uint16_t hwy1);
+
+        rgba32 * rgbaBuffers[2];
+        // first and last column of each hardware row that may hold a non transparent pixel, first > last for an empty row
+        uint16_t * rowSpans[2];
+
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+
+        // keeping track of drawing buffers
+        volatile unsigned char currentDrawBuffer;
+        volatile unsigned char currentRefreshBuffer;
+        volatile bool swapPending;
+        void handleBufferSwap(void);
+
+        // changed row tracking: hardware rows drawn since the last swapBuffers(), and the rows that will change when the pending swap happens
+        uint16_t drawnRowsFirst = 0xFFFF;
+        uint16_t drawnRowsLast = 0;
+        uint16_t swapRowsFirst = 0;
+        uint16_t swapRowsLast = 0xFFFF;
+        // false if the drawing buffer may differ from the refresh buffer in rows that weren't drawn (swap without copy)
+        bool drawBufferMatchesRefresh = false;
+
+        bool ccEnabled = true;
+};
+
+#include "Layer_RGBA_Impl.h"
+
+#endif
@@ -0,0 +1,357 @@
+/*
+ * SmartMatrix Library - RGBA Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#define RGBA_BUFFER_SIZE            (this->matrixWidth * this->matrixHeight)
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerRGBA<RGB, optionFlags>::SMLayerRGBA(rgba32 * buffer, uint16_t * spanBuffer, uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    rgbaBuffers[0] = buffer;
+    rgbaBuffers[1] = buffer + RGBA_BUFFER_SIZE;
+    rowSpans[0] = spanBuffer;
+    rowSpans[1] = spanBuffer + 2 * height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerRGBA<RGB, optionFlags>::SMLayerRGBA(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+    rgbaBuffers[0] = (rgba32 *)malloc(sizeof(rgba32) * 2 * RGBA_BUFFER_SIZE);
+    rowSpans[0] = (uint16_t *)malloc(sizeof(uint16_t) * SM_RGBA_SPAN_BUFFER_SIZE(height));
+#ifdef ESP32
+    assert(rgbaBuffers[0] != NULL && rowSpans[0] != NULL);
+#endif
+    smRecordAllocation(smMemoryLayers, rgbaBuffers[0], sizeof(rgba32) * 2 * RGBA_BUFFER_SIZE);
+    smRecordAllocation(smMemoryLayers, rowSpans[0], sizeof(uint16_t) * SM_RGBA_SPAN_BUFFER_SIZE(height));
+    rgbaBuffers[1] = rgbaBuffers[0] + RGBA_BUFFER_SIZE;
+    rowSpans[1] = rowSpans[0] + 2 * height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::begin(void) {
+    currentDrawBuffer = 0;
+    currentRefreshBuffer = 1;
+    swapPending = false;
+
+    // both buffers start out fully transparent with empty spans
+    memset(rgbaBuffers[0], 0x00, sizeof(rgba32) * 2 * RGBA_BUFFER_SIZE);
+    for(int i=0; i<2 * this->matrixHeight; i++) {
+        rowSpans[0][i * 2] = 0xFFFF;
+        rowSpans[0][i * 2 + 1] = 0;
+    }
+    drawBufferMatchesRefresh = true;
+    this->setCoveredRows(0x7FFF, -1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRGBA<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    handleBufferSwap();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+    else if (this->layerRotation == rotation180)
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+    else if (this->layerRotation == rotation90)
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+    else /* if (layerRotation == rotation270)*/
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+}
+
+// premultiplied source pixel widened to the refresh row format
+static inline void loadPremultipliedPixel(const rgba32 & in, rgb24 & out) {
+    out = rgb24(in.red, in.green, in.blue);
+}
+
+static inline void loadPremultipliedPixel(const rgba32 & in, rgb48 & out) {
+    out = rgb48(in.red * 257, in.green * 257, in.blue * 257);
+}
+
+// only the span of each row that holds drawn pixels is visited, and fully transparent pixels inside it are skipped
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerRGBA<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    const uint16_t * span = &rowSpans[currentRefreshBuffer][hardwareY * 2];
+    int first = span[0];
+    int last = span[1];
+
+    if(first > last)
+        return;
+
+    const rgba32 * src = &rgbaBuffers[currentRefreshBuffer][hardwareY * this->matrixWidth];
+    smBlendMode layerBlendMode = this->blendMode;
+
+    for(int i=first; i<=last; i++) {
+        const rgba32 & pixel = src[i];
+
+        if(!pixel.alpha)
+            continue;
+
+        RGB_OUT premultiplied;
+        loadPremultipliedPixel(pixel, premultiplied);
+
+        // add, subtract and screen with a premultiplied source already give the alpha weighted result, multiply still has to fade
+        // from dst to dst * color by alpha, which is dst * (1 - alpha) + dst * premultiplied
+        if(layerBlendMode == smBlendMultiply)
+            refreshRow[i] = blendRGBPremultiplied(refreshRow[i], multiplyRGB(refreshRow[i], premultiplied), blendAlphaToWeight(pixel.alpha));
+        else if(layerBlendMode != smBlendReplace)
+            refreshRow[i] = blendRGBMode(refreshRow[i], premultiplied, layerBlendMode);
+        else if(pixel.alpha == 255)
+            refreshRow[i] = premultiplied;
+        else
+            refreshRow[i] = blendRGBPremultiplied(refreshRow[i], premultiplied, blendAlphaToWeight(pixel.alpha));
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRGBA<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRGBA<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = enabled;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRGBA<RGB, optionFlags>::handleBufferSwap(void) {
+    if (!swapPending)
+        return;
+
+    unsigned char newDrawBuffer = currentRefreshBuffer;
+
+    currentRefreshBuffer = currentDrawBuffer;
+    currentDrawBuffer = newDrawBuffer;
+
+    this->markRowsChanged(swapRowsFirst, swapRowsLast);
+
+    // rows with an empty span are skipped by the calc
+    const uint16_t * spans = rowSpans[currentRefreshBuffer];
+    int first = 0x7FFF, last = -1;
+    for(int y=0; y<this->matrixHeight; y++) {
+        if(spans[y * 2] <= spans[y * 2 + 1]) {
+            first = std::min(first, y);
+            last = y;
+        }
+    }
+    this->setCoveredRows(first, last);
+
+    SM_PROFILE_SWAP_PICKED_UP();
+    swapPending = false;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::swapBuffers(bool copy) {
+    while (swapPending);
+
+    // hand off the rows that will change with this swap to handleBufferSwap()
+    if(drawBufferMatchesRefresh) {
+        swapRowsFirst = drawnRowsFirst;
+        swapRowsLast = drawnRowsLast;
+    } else {
+        swapRowsFirst = 0;
+        swapRowsLast = 0xFFFF;
+    }
+    drawnRowsFirst = 0xFFFF;
+    drawnRowsLast = 0;
+    drawBufferMatchesRefresh = copy;
+
+    SM_PROFILE_SWAP_REQUESTED();
+    swapPending = true;
+
+    if (copy) {
+        while (swapPending);
+
+        // the volatile indexes are only read once, see SMLayerBackground::swapBuffers()
+        unsigned char drawBuffer = currentDrawBuffer;
+        memcpy(rgbaBuffers[drawBuffer], rgbaBuffers[!drawBuffer], sizeof(rgba32) * RGBA_BUFFER_SIZE);
+        memcpy(rowSpans[drawBuffer], rowSpans[!drawBuffer], sizeof(uint16_t) * 2 * this->matrixHeight);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+rgba32 SMLayerRGBA<RGB, optionFlags>::premultiply(const rgb24& color, uint8_t alpha) {
+    // colors are converted to 8 bits per channel first, so the correction table can be used for any color depth
+    rgb24 corrected = color;
+    if(ccEnabled)
+        colorCorrection(color, corrected);
+
+    corrected = scaleRGB(corrected, blendAlphaToWeight(alpha));
+    return (rgba32){corrected.red, corrected.green, corrected.blue, alpha};
+}
+
+// Porter-Duff "over" on premultiplied pixels: dst = src + dst * (1 - src alpha), for color and alpha alike
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::compositePixel(int16_t hwx, int16_t hwy, const rgba32& src) {
+    rgba32 & dst = rgbaBuffers[currentDrawBuffer][hwy * this->matrixWidth + hwx];
+
+    if(src.alpha == 255) {
+        dst = src;
+        return;
+    }
+
+    uint16_t weight = blendAlphaToWeight(src.alpha);
+    rgb24 color = blendRGBPremultiplied(rgb24(dst.red, dst.green, dst.blue), rgb24(src.red, src.green, src.blue), weight);
+    dst.alpha = std::min(255, src.alpha + ((dst.alpha * (256 - weight)) >> 8));
+    dst.red = color.red;
+    dst.green = color.green;
+    dst.blue = color.blue;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::mapLocalToHardware(int16_t x, int16_t y, int16_t &hwx, int16_t &hwy) {
+    localToHardwareForRotation(x, y, this->matrixWidth, this->matrixHeight, hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::markHardwareRegionDrawn(uint16_t hwx0, uint16_t hwy0, uint16_t hwx1, uint16_t hwy1) {
+    uint16_t * spans = rowSpans[currentDrawBuffer];
+
+    for(int y = hwy0; y <= hwy1; y++) {
+        if(hwx0 < spans[y * 2])
+            spans[y * 2] = hwx0;
+        if(hwx1 > spans[y * 2 + 1])
+            spans[y * 2 + 1] = hwx1;
+    }
+
+    if(hwy0 < drawnRowsFirst)
+        drawnRowsFirst = hwy0;
+    if(hwy1 > drawnRowsLast)
+        drawnRowsLast = hwy1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::fillScreen(const RGB& color, uint8_t alpha) {
+    rgba32 pixel = premultiply(color, alpha);
+    rgba32 * dst = rgbaBuffers[currentDrawBuffer];
+    uint16_t * spans = rowSpans[currentDrawBuffer];
+
+    if(alpha)
+        fillRGB(dst, RGBA_BUFFER_SIZE, pixel);
+    else
+        memset(dst, 0x00, sizeof(rgba32) * RGBA_BUFFER_SIZE);
+
+    for(int y=0; y<this->matrixHeight; y++) {
+        spans[y * 2] = alpha ? 0 : 0xFFFF;
+        spans[y * 2 + 1] = alpha ? this->matrixWidth - 1 : 0;
+    }
+
+    drawnRowsFirst = 0;
+    drawnRowsLast = this->matrixHeight - 1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color, uint8_t alpha) {
+    if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight || !alpha)
+        return;
+
+    int16_t hwx, hwy;
+    mapLocalToHardware(x, y, hwx, hwy);
+
+    compositePixel(hwx, hwy, premultiply(color, alpha));
+    markHardwareRegionDrawn(hwx, hwy, hwx, hwy);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color, uint8_t alpha) {
+    if (x1 < x0)
+        SWAPint(x1, x0);
+    if (y1 < y0)
+        SWAPint(y1, y0);
+
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight || !alpha)
+        return;
+
+    x0 = std::max<int16_t>(x0, 0);
+    y0 = std::max<int16_t>(y0, 0);
+    x1 = std::min<int16_t>(x1, this->localWidth - 1);
+    y1 = std::min<int16_t>(y1, this->localHeight - 1);
+
+    // opposite corners of the local rectangle are opposite corners of the hardware rectangle
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+    int16_t hwx0 = std::min(ax, bx), hwx1 = std::max(ax, bx);
+    int16_t hwy0 = std::min(ay, by), hwy1 = std::max(ay, by);
+
+    rgba32 pixel = premultiply(color, alpha);
+
+    for(int hwy = hwy0; hwy <= hwy1; hwy++) {
+        if(alpha == 255) {
+            fillRGB(&rgbaBuffers[currentDrawBuffer][hwy * this->matrixWidth + hwx0], hwx1 - hwx0 + 1, pixel);
+        } else {
+            for(int hwx = hwx0; hwx <= hwx1; hwx++)
+                compositePixel(hwx, hwy, pixel);
+        }
+    }
+
+    markHardwareRegionDrawn(hwx0, hwy0, hwx1, hwy1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRGBA<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint8_t *src, uint16_t stride) {
+    if(!stride)
+        stride = width * 4;
+
+    // clip to the layer once, then walk the visible part of the source
+    int x0 = std::max<int>(x, 0);
+    int y0 = std::max<int>(y, 0);
+    int x1 = std::min<int>(x + width, this->localWidth) - 1;
+    int y1 = std::min<int>(y + height, this->localHeight) - 1;
+
+    if(x0 > x1 || y0 > y1)
+        return;
+
+    for(int ly = y0; ly <= y1; ly++) {
+        const uint8_t * srcPixel = src + (ly - y) * stride + (x0 - x) * 4;
+
+        for(int lx = x0; lx <= x1; lx++, srcPixel += 4) {
+            if(!srcPixel[3])
+                continue;
+
+            int16_t hwx, hwy;
+            mapLocalToHardware(lx, ly, hwx, hwy);
+            compositePixel(hwx, hwy, premultiply(rgb24(srcPixel[0], srcPixel[1], srcPixel[2]), srcPixel[3]));
+        }
+    }
+
+    // the spans only need to be a bound, so the whole clipped rectangle is added even if parts of it are transparent
+    int16_t ax, ay, bx, by;
+    mapLocalToHardware(x0, y0, ax, ay);
+    mapLocalToHardware(x1, y1, bx, by);
+    markHardwareRegionDrawn(std::min(ax, bx), std::min(ay, by), std::max(ax, bx), std::max(ay, by));
+}
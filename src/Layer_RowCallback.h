@@ -0,0 +1,90 @@
+/*
+ * SmartMatrix Library - Row Callback Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_ROWCALLBACK_H_
+#define _LAYER_ROWCALLBACK_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_ROWCALLBACK_OPTIONS_NONE         0
+// black pixels from the callback are transparent, showing the layers below
+#define SM_ROWCALLBACK_OPTIONS_TRANSPARENT  (1 << 0)
+
+// with SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE a calc task on each core fills rows at the same time, each gets its own line buffer
+#if defined(ESP32)
+#define SM_ROWCALLBACK_LINE_BUFFERS         portNUM_PROCESSORS
+#define SM_ROWCALLBACK_LINE_BUFFER_INDEX()  xPortGetCoreID()
+#else
+#define SM_ROWCALLBACK_LINE_BUFFERS         1
+#define SM_ROWCALLBACK_LINE_BUFFER_INDEX()  0
+#endif
+
+// no framebuffer: the sketch's callback draws each row as the calc needs it, for procedural effects, traces and bars that should show
+// the newest data within the same refresh frame.  The callbacks run in the calc (the refresh interrupt on Teensy, the calc task on
+// ESP32), so they need to be short and can't use Serial, malloc or anything else that isn't safe there.  With
+// SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE the row callback is called from both cores at once, for different rows.
+template <typename RGB, unsigned int optionFlags>
+class SMLayerRowCallback : public SM_Layer {
+    public:
+        // fills count pixels of local row index from x = 0, or with rotation90/270 where a hardware row is a local column, count
+        // pixels of local column index from y = 0 (column is true)
+        typedef void (*RowFunction)(uint16_t index, bool column, RGB pixels[], uint16_t count);
+        // called at the start of each refresh frame, before any row of it is drawn
+        typedef void (*FrameFunction)(void);
+
+        SMLayerRowCallback(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+        bool isLayerOpaque();
+
+        void enableColorCorrection(bool enabled);
+
+        // NULL stops drawing the layer
+        void setRowCallback(RowFunction rowFunction);
+        void setFrameCallback(FrameFunction frameFunction);
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+
+        volatile RowFunction rowCallback = NULL;
+        volatile FrameFunction frameCallback = NULL;
+        // rowCallback as of the start of the frame, so every row of a frame and isLayerOpaque() agree
+        RowFunction refreshRowCallback = NULL;
+        // the pixels of one line from the callback, the longer of the matrix width and height, one per calc core
+        RGB * lineBuffers[SM_ROWCALLBACK_LINE_BUFFERS] = {};
+        bool lineBuffersReady = false;
+
+        smCoordinateMapFunction hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+};
+
+#include "Layer_RowCallback_Impl.h"
+
+#endif
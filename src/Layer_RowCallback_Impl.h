@@ -0,0 +1,136 @@
+/*
+ * SmartMatrix Library - Row Callback Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerRowCallback<RGB, optionFlags>::SMLayerRowCallback(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRowCallback<RGB, optionFlags>::begin(void) {
+    lineBuffersReady = true;
+    for(int i=0; i<SM_ROWCALLBACK_LINE_BUFFERS; i++) {
+        if(!lineBuffers[i])
+            lineBuffers[i] = (RGB *)malloc(sizeof(RGB) * std::max(this->matrixWidth, this->matrixHeight));
+        if(!lineBuffers[i])
+            lineBuffersReady = false;
+    }
+    if(!lineBuffersReady)
+        Serial.println("Error: can't allocate row callback line buffer");
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRowCallback<RGB, optionFlags>::frameRefreshCallback(void) {
+    FrameFunction frame = frameCallback;
+    if(frame)
+        frame();
+
+    // a row callback set or cleared during the frame is taken at the next one
+    refreshRowCallback = lineBuffersReady ? (RowFunction)rowCallback : NULL;
+
+    if(refreshRowCallback)
+        this->setCoveredRows(0, this->matrixHeight - 1);
+    else
+        this->setCoveredRows(0x7FFF, -1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerRowCallback<RGB, optionFlags>::isLayerOpaque() {
+    return !(optionFlags & SM_ROWCALLBACK_OPTIONS_TRANSPARENT) && refreshRowCallback;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRowCallback<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+    else if (this->layerRotation == rotation180)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation180>::hardwareToLocal;
+    else if (this->layerRotation == rotation90)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation90>::hardwareToLocal;
+    else /* if (layerRotation == rotation270)*/
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation270>::hardwareToLocal;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerRowCallback<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    RowFunction row = refreshRowCallback;
+    if(!row)
+        return;
+    RGB * lineBuffer = lineBuffers[SM_ROWCALLBACK_LINE_BUFFER_INDEX()];
+
+    // local pixel of hardware column 0, and the local step for each following column
+    int16_t lx, ly, nextX, nextY;
+    hardwareToLocalForRotation(0, hardwareY, this->matrixWidth, this->matrixHeight, lx, ly);
+    hardwareToLocalForRotation(1, hardwareY, this->matrixWidth, this->matrixHeight, nextX, nextY);
+
+    // rotation0/180: the hardware row is a local row, forwards or backwards; rotation90/270: a local column
+    int index, step;
+    if(nextY == ly) {
+        row(ly, false, lineBuffer, this->localWidth);
+        index = lx;
+        step = nextX - lx;
+    } else {
+        row(lx, true, lineBuffer, this->localHeight);
+        index = ly;
+        step = nextY - ly;
+    }
+
+    for(int i=0; i<this->matrixWidth; i++, index += step) {
+        const RGB & pixel = lineBuffer[index];
+        if((optionFlags & SM_ROWCALLBACK_OPTIONS_TRANSPARENT) && !pixel.red && !pixel.green && !pixel.blue)
+            continue;
+        if(ccEnabled)
+            colorCorrection(pixel, refreshRow[i]);
+        else
+            refreshRow[i] = pixel;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRowCallback<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerRowCallback<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerRowCallback<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRowCallback<RGB, optionFlags>::setRowCallback(RowFunction rowFunction) {
+    rowCallback = rowFunction;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerRowCallback<RGB, optionFlags>::setFrameCallback(FrameFunction frameFunction) {
+    frameCallback = frameFunction;
+}
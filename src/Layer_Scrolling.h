@@ -31,10 +31,76 @@
 const int textLayerMaxStringLength = 100;
 
 #define SM_SCROLLING_OPTIONS_NONE     0
+// rasterize the whole message once in start()/update() and scroll a window over it, instead of redrawing the layer bitmap every step
+#define SM_SCROLLING_OPTIONS_TEXT_STRIP     (1<<0)
+// move the text by elapsed time (micros()) instead of counting frames, so the speed isn't rounded to a whole number of frames
+// per pixel and doesn't change with the refresh rate or when the calc skips frames
+#define SM_SCROLLING_OPTIONS_TIMED          (1<<1)
+// timed scrolling that also draws the fraction of a pixel between steps, blending the text color over two pixels (needs TEXT_STRIP)
+#define SM_SCROLLING_OPTIONS_SUBPIXEL       (1<<2)
+
+// the strip holds textLayerMaxStringLength glyphs up to 8 pixels wide (font rows are 8 bits), and up to this many rows of the font
+#ifndef SM_SCROLLING_STRIP_MAX_FONT_HEIGHT
+#define SM_SCROLLING_STRIP_MAX_FONT_HEIGHT  16
+#endif
+#define SM_SCROLLING_STRIP_ROW_SIZE         (((textLayerMaxStringLength * 8) + 31) / 32 * 4)
 
 // font
 #include "MatrixFontCommon.h"
 
+// characters for SMLayerScrolling::startStream(), asked for in order as they're about to scroll into view and never asked for again.
+// Called from frameRefreshCallback() (Teensy: the refresh interrupt, ESP32: the calc task), so nextCodepoint() has to return quickly
+class SMTextSource {
+    public:
+        // the next character, or 0 if none is available yet: a space scrolls in instead and the layer asks again one character later
+        virtual uint32_t nextCodepoint(void) = 0;
+};
+
+// a source for feeds that are appended to from loop(): append() is the only writer and the layer the only reader, so no locks are needed
+template <int capacity>
+class SMTextRingBuffer : public SMTextSource {
+    public:
+        // text is UTF-8, adds as many characters as fit and returns how many were added
+        int append(const char text[]) {
+            int added = 0;
+            uint16_t nextHead = head;
+
+            while (*text) {
+                uint16_t next = (nextHead + 1) % capacity;
+                if (next == tail)
+                    break;
+                uint32_t codepoint = getNextUtf8Codepoint(&text);
+                codepoints[nextHead] = (codepoint <= 0xFFFF) ? codepoint : '?';
+                nextHead = next;
+                added++;
+            }
+
+            // the characters are stored before the reader can see them, the barrier keeps the compiler and CPU from reordering them
+            __sync_synchronize();
+            head = nextHead;
+            return added;
+        };
+        // characters that can be appended before the buffer is full
+        int getFree(void) const {
+            return (capacity - 1) - ((head + capacity - tail) % capacity);
+        };
+        uint32_t nextCodepoint(void) {
+            if (tail == head)
+                return 0;
+            // read the character only after seeing head, and before append() can see the space it frees
+            __sync_synchronize();
+            uint32_t codepoint = codepoints[tail];
+            __sync_synchronize();
+            tail = (tail + 1) % capacity;
+            return codepoint;
+        };
+
+    protected:
+        uint16_t codepoints[capacity];
+        volatile uint16_t head = 0;
+        volatile uint16_t tail = 0;
+};
+
 template <typename RGB, unsigned int optionFlags>
 class SMLayerScrolling : public SM_Layer {
     public:
@@ -54,10 +120,16 @@ class SMLayerScrolling : public SM_Layer {
         int getStatus(void) const;
         void start(const char inputtext[], int numScrolls);
         void update(const char inputtext[]);
+        // scrolls characters from source right to left until stop() or start(), pulling them from the source only as they're about to
+        // scroll in, so a message can be any length and grow while it scrolls.  Only the characters on screen plus the next one are
+        // kept (up to textLayerMaxStringLength), and rendered into the text strip with SM_SCROLLING_OPTIONS_TEXT_STRIP
+        void startStream(SMTextSource * source);
         void setMode(ScrollMode mode);
         void setColor(const RGB & newColor);
         void setSpeed(unsigned char pixels_per_second);
         void setFont(fontChoices newFont);
+        // e.g. a font filled by loadPackedBitmapFont(), it has to stay valid while it's used
+        void setFont(const bitmap_font *newFont);
         void setOffsetFromTop(int offset);
         void setStartOffsetFromLeft(int offset);
         void enableColorCorrection(bool enabled);
@@ -68,16 +140,47 @@ class SMLayerScrolling : public SM_Layer {
 
         void updateScrollingText(void);
 
+        // streaming: text[] holds the characters from scrollPosition to one past the right edge
+        SMTextSource * volatile textSource = NULL;
+        bool textWindowChanged = false;
+        bool advanceTextWindow(SMTextSource * source);
+        // one pixel of movement in the current mode, counting down scrollcounter at the end of a scroll
+        void stepScrollPosition(void);
+
+        // timed scrolling: whole pixels of movement since the last frame, leaving the remainder in scrollMicroPixels
+        static const bool timedScrolling = (optionFlags & (SM_SCROLLING_OPTIONS_TIMED | SM_SCROLLING_OPTIONS_SUBPIXEL));
+        int getTimedScrollSteps(void);
+        uint32_t lastScrollMicros = 0;
+        bool scrollTimerRunning = false;
+        // pixels per second * microseconds toward the next step, a step is 1000000
+        uint32_t scrollMicroPixels = 0;
+        // scrollPosition * 256 plus the fraction of the next step, what the text strip is drawn at with SUBPIXEL
+        volatile int32_t scrollPositionFixed = 0;
+        // set by setMinMax() when new text starts, so SUBPIXEL redraws it even if the position didn't move
+        volatile bool scrollTextStarted = false;
+        template <typename RGB_OUT>
+        void fillRefreshRowFromTextStripSubpixel(uint16_t hardwareY, int32_t position, const RGB_OUT & color, RGB_OUT refreshRow[]);
+
+        // text strip: textStripWidth pixels of the current message, one row for each font row
+        uint8_t * textStrip = NULL;
+        uint16_t textStripWidth = 0;
+        bool allocateTextStrip(void);
+        void renderTextStrip(void);
+        template <typename RGB_OUT>
+        void fillRefreshRowFromTextStrip(uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]);
+
         template <typename RGB_OUT>
         bool getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel);
         bool getPixel(uint16_t hardwareX, uint16_t hardwareY);
 
         RGB textcolor;
         unsigned char currentframe = 0;
-        char text[textLayerMaxStringLength];
+        // one codepoint per character (up to U+FFFF), decoded from UTF-8 by setText()
+        uint16_t text[textLayerMaxStringLength];
+        void setText(const char inputtext[]);
         unsigned char pixelsPerSecond = 30;
 
-        unsigned char textlen;
+        unsigned char textlen = 0;
         volatile int scrollcounter = 0;
         const bitmap_font *scrollFont = &apple5x7;
 
@@ -93,6 +196,13 @@ class SMLayerScrolling : public SM_Layer {
         unsigned int textWidth;
         int scrollMin, scrollMax;
         int scrollPosition;
+
+        // color, font, or color correction changed, affecting every row
+        volatile bool refreshSettingsChanged = true;
+        // text color in both refresh formats, converted in frameRefreshCallback() after refreshSettingsChanged is set
+        rgb48 refreshColor48;
+        rgb24 refreshColor24;
+        void convertRefreshColor(void);
 };
 
 #include "Layer_Scrolling_Impl.h"
@@ -43,6 +43,7 @@ SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint16_t width, uint16_t he
     //this->assert(scrollingBitmap != NULL);
 #endif
     memset(scrollingBitmap, 0x00, width * (height / 8));
+    smRecordAllocation(smMemoryLayers, scrollingBitmap, width * (height / 8));
     this->matrixWidth = width;
     this->matrixHeight = height;
     this->textcolor = rgb48(0xffff, 0xffff, 0xffff);
@@ -50,11 +51,217 @@ SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint16_t width, uint16_t he
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::begin(void) {
+    if(optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP)
+        allocateTextStrip();
 }
 
+// the strip is only read by refresh, so it can go in slower external RAM when available
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::frameRefreshCallback(void) {
+bool SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::allocateTextStrip(void) {
+    if(textStrip)
+        return true;
+
+    const size_t stripBytes = SM_SCROLLING_STRIP_ROW_SIZE * SM_SCROLLING_STRIP_MAX_FONT_HEIGHT;
+#if defined(ESP32) && defined(BOARD_HAS_PSRAM) && defined(SMARTMATRIX_USE_PSRAM)
+    textStrip = (uint8_t *)ps_malloc(stripBytes);
+#elif defined(__IMXRT1062__) && defined(SMARTMATRIX_USE_PSRAM)
+    textStrip = (uint8_t *)extmem_malloc(stripBytes);
+#else
+    textStrip = (uint8_t *)malloc(stripBytes);
+#endif
+    if(!textStrip)
+        return false;
+
+    memset(textStrip, 0x00, stripBytes);
+    textStripWidth = 0;
+    smRecordAllocation(smMemoryLayers, textStrip, stripBytes);
+    return true;
+}
+
+// draws every glyph of text into the strip, called when the text or font changes rather than every scroll step
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::renderTextStrip(void) {
+    if(!allocateTextStrip())
+        return;
+
+    int numRows = min((int)scrollFont->Height, SM_SCROLLING_STRIP_MAX_FONT_HEIGHT);
+    int charWidth = min((int)scrollFont->Width, 8);
+
+    // hide the strip while it's redrawn, so a refresh in the middle sees an empty row rather than half old and half new text
+    textStripWidth = 0;
+    memset(textStrip, 0x00, SM_SCROLLING_STRIP_ROW_SIZE * SM_SCROLLING_STRIP_MAX_FONT_HEIGHT);
+
+    for(int k = 0; k < numRows; k++) {
+        uint8_t * row = &textStrip[k * SM_SCROLLING_STRIP_ROW_SIZE];
+
+        for(int textPosition = 0; textPosition < textlen; textPosition++) {
+            int charPosition = textPosition * charWidth;
+            const unsigned char *rows = getBitmapFontCodepointRowsForRefresh(text[textPosition], scrollFont);
+            uint8_t tempBitmask = rows ? rows[k] : 0;
+
+            row[charPosition/8] |= tempBitmask >> (charPosition%8);
+            if(charPosition % 8)
+                row[(charPosition/8) + 1] |= tempBitmask << (8-(charPosition%8));
+        }
+    }
+
+    textStripWidth = textlen * charWidth;
+}
+
+// copies the part of the strip under the window at scrollPosition into refreshRow, only writing set pixels
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::fillRefreshRowFromTextStrip(uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]) {
+    const int numRows = min((int)scrollFont->Height, SM_SCROLLING_STRIP_MAX_FONT_HEIGHT);
+    int position = scrollPosition;
+    const int stripWidth = textStripWidth;
+
+    if(optionFlags & SM_SCROLLING_OPTIONS_SUBPIXEL) {
+        const int32_t fixedPosition = scrollPositionFixed;
+        if(fixedPosition & 0xFF) {
+            fillRefreshRowFromTextStripSubpixel(hardwareY, fixedPosition, color, refreshRow);
+            return;
+        }
+        position = fixedPosition >> 8;
+    }
+
+    switch( this->layerRotation ) {
+      case rotation0 :
+      case rotation180 : {
+        int localY = (this->layerRotation == rotation0) ? hardwareY : (this->matrixHeight - 1) - hardwareY;
+        int stripRow = localY - fontTopOffset;
+        if(stripRow < 0 || stripRow >= numRows)
+            return;
+
+        // local x range covered by the strip, clipped to the screen
+        int x0 = max(0, position);
+        int x1 = min((int)this->localWidth, position + stripWidth);
+        if(x1 <= x0)
+            return;
+
+        const uint8_t * row = &textStrip[stripRow * SM_SCROLLING_STRIP_ROW_SIZE];
+        if(this->layerRotation == rotation0)
+            this->fillSpansFrom1bppRow(row, x0 - position, x1 - x0, false, false, color, &refreshRow[x0]);
+        else
+            this->fillSpansFrom1bppRow(row, x0 - position, x1 - x0, false, true, color, &refreshRow[this->matrixWidth - x1]);
+        break;
+      }
+      case rotation90 :
+      case rotation270 : {
+        int localX = (this->layerRotation == rotation90) ? hardwareY : (this->matrixHeight - 1) - hardwareY;
+        int stripX = localX - position;
+        if(stripX < 0 || stripX >= stripWidth)
+            return;
+
+        // strip rows visible on the screen
+        int r0 = max(0, -fontTopOffset);
+        int r1 = min(numRows, (int)this->localHeight - fontTopOffset);
+        if(r1 <= r0)
+            return;
+
+        // localY = fontTopOffset + r, hardware x is (matrixWidth - 1) - localY for 90 degrees, localY for 270 degrees
+        if(this->layerRotation == rotation90)
+            this->fillPixelsFrom1bppColumn(textStrip, SM_SCROLLING_STRIP_ROW_SIZE, stripX, r1 - 1, -1, r1 - r0, color, &refreshRow[(this->matrixWidth - 1) - (fontTopOffset + r1 - 1)]);
+        else
+            this->fillPixelsFrom1bppColumn(textStrip, SM_SCROLLING_STRIP_ROW_SIZE, stripX, r0, 1, r1 - r0, color, &refreshRow[fontTopOffset + r0]);
+        break;
+      }
+      default:
+        break;
+    }
+}
+
+// the strip is drawn at (position / 256) pixels: local pixel x is covered by strip column (x - whole) for (256 - fraction) and by
+// column (x - whole - 1) for fraction, and the text color is blended over the row by that coverage
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::fillRefreshRowFromTextStripSubpixel(uint16_t hardwareY, int32_t position, const RGB_OUT & color, RGB_OUT refreshRow[]) {
+    const int numRows = min((int)scrollFont->Height, SM_SCROLLING_STRIP_MAX_FONT_HEIGHT);
+    const int stripWidth = textStripWidth;
+    const int whole = position >> 8;
+    const uint16_t fraction = position & 0xFF;
+
+    switch( this->layerRotation ) {
+      case rotation0 :
+      case rotation180 : {
+        int localY = (this->layerRotation == rotation0) ? hardwareY : (this->matrixHeight - 1) - hardwareY;
+        int stripRow = localY - fontTopOffset;
+        if(stripRow < 0 || stripRow >= numRows)
+            return;
+
+        // the last strip column reaches one pixel further than without a fraction
+        int x0 = max(0, whole);
+        int x1 = min((int)this->localWidth, whole + stripWidth + 1);
+        const uint8_t * row = &textStrip[stripRow * SM_SCROLLING_STRIP_ROW_SIZE];
+
+        for(int x = x0; x < x1; x++) {
+            int c = x - whole;
+            uint16_t coverage = 0;
+            if(c < stripWidth && (row[c / 8] & (0x80 >> (c % 8))))
+                coverage += 256 - fraction;
+            if(c > 0 && (row[(c - 1) / 8] & (0x80 >> ((c - 1) % 8))))
+                coverage += fraction;
+            if(!coverage)
+                continue;
+
+            int hwx = (this->layerRotation == rotation0) ? x : (this->matrixWidth - 1) - x;
+            refreshRow[hwx] = blendRGB(refreshRow[hwx], color, coverage);
+        }
+        break;
+      }
+      case rotation90 :
+      case rotation270 : {
+        int localX = (this->layerRotation == rotation90) ? hardwareY : (this->matrixHeight - 1) - hardwareY;
+        int c = localX - whole;
+        if(c < 0 || c > stripWidth)
+            return;
+
+        int r0 = max(0, -fontTopOffset);
+        int r1 = min(numRows, (int)this->localHeight - fontTopOffset);
+
+        for(int r = r0; r < r1; r++) {
+            const uint8_t * row = &textStrip[r * SM_SCROLLING_STRIP_ROW_SIZE];
+            uint16_t coverage = 0;
+            if(c < stripWidth && (row[c / 8] & (0x80 >> (c % 8))))
+                coverage += 256 - fraction;
+            if(c > 0 && (row[(c - 1) / 8] & (0x80 >> ((c - 1) % 8))))
+                coverage += fraction;
+            if(!coverage)
+                continue;
+
+            int hwx = (this->layerRotation == rotation90) ? (this->matrixWidth - 1) - (fontTopOffset + r) : fontTopOffset + r;
+            refreshRow[hwx] = blendRGB(refreshRow[hwx], color, coverage);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
     updateScrollingText();
+
+    // text is only drawn on the font rows, the calc can skip the layer everywhere else
+    this->setCoveredLocalRows(fontTopOffset, fontTopOffset + scrollFont->Height - 1);
+
+    if(refreshSettingsChanged) {
+        this->markAllRowsChanged();
+        refreshSettingsChanged = false;
+        convertRefreshColor();
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::convertRefreshColor(void) {
+    if(this->ccEnabled) {
+        colorCorrection(textcolor, refreshColor48);
+        colorCorrection(textcolor, refreshColor24);
+    } else {
+        refreshColor48 = textcolor;
+        refreshColor24 = textcolor;
+    }
 }
 
 // returns true and copies color to xyPixel if pixel is opaque, returns false if not
@@ -132,59 +339,51 @@ bool SMLayerScrolling<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t h
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
-    rgb48 currentPixel;
-    int i;
-
-    if(this->ccEnabled)
-        colorCorrection(textcolor, currentPixel);
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    if((optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP) && textStrip)
+        fillRefreshRowFromTextStrip(hardwareY, refreshColor48, refreshRow);
     else
-        currentPixel = textcolor;
-
-    for(i=0; i<this->matrixWidth; i++) {
-        if(!getPixel(i, hardwareY))
-            continue;
-
-        refreshRow[i] = currentPixel;
-    }
+        this->fillRefreshRowFrom1bppBitmap(scrollingBitmap, hardwareY, refreshColor48, refreshRow);
 }
 
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
-    rgb24 currentPixel;
-    int i;
-
-    if(this->ccEnabled)
-        colorCorrection(textcolor, currentPixel);
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    if((optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP) && textStrip)
+        fillRefreshRowFromTextStrip(hardwareY, refreshColor24, refreshRow);
     else
-        currentPixel = textcolor;
-
-    for(i=0; i<this->matrixWidth; i++) {
-        if(!getPixel(i, hardwareY))
-            continue;
-
-        refreshRow[i] = currentPixel;
-    }
+        this->fillRefreshRowFrom1bppBitmap(scrollingBitmap, hardwareY, refreshColor24, refreshRow);
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setColor(const RGB & newColor) {
     textcolor = newColor;
+    refreshSettingsChanged = true;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
 }
 
 // stops the scrolling text on the next refresh
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::stop(void) {
+    // a stream ends with nothing left to scroll off
+    if (textSource) {
+        textSource = NULL;
+        textlen = 0;
+        textWidth = 0;
+        scrollMin = 0;
+        textWindowChanged = true;
+    }
+
     // setup conditions for ending scrolling:
     // scrollcounter is next to zero
     scrollcounter = 1;
     // position text at the end of the cycle
     scrollPosition = scrollMin;
+    scrollMicroPixels = 0;
 }
 
 // returns 0 if stopped
@@ -222,47 +421,78 @@ void SMLayerScrolling<RGB, optionFlags>::setMinMax(void) {
         break;
     }
 
+    // timed scrolling starts over from the new position at the next frame
+    scrollTimerRunning = false;
+    scrollMicroPixels = 0;
+    scrollPositionFixed = scrollPosition * 256;
+    scrollTextStarted = true;
 }
 
+// inputtext is UTF-8, up to textLayerMaxStringLength characters are kept
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::start(const char inputtext[], int numScrolls) {
-    int length = strlen((const char *)inputtext);
-    if (length > textLayerMaxStringLength)
-        length = textLayerMaxStringLength;
-    strncpy(text, (const char *)inputtext, length);
+void SMLayerScrolling<RGB, optionFlags>::setText(const char inputtext[]) {
+    int length = 0;
+
+    while (*inputtext && length < textLayerMaxStringLength) {
+        uint32_t codepoint = getNextUtf8Codepoint(&inputtext);
+        text[length++] = (codepoint <= 0xFFFF) ? codepoint : '?';
+    }
     textlen = length;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::start(const char inputtext[], int numScrolls) {
+    textSource = NULL;
+    setText(inputtext);
     scrollcounter = numScrolls;
 
     textWidth = (textlen * scrollFont->Width) - 1;
 
+    if(optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP)
+        renderTextStrip();
+
     setMinMax();
  }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::startStream(SMTextSource * source) {
+    textSource = NULL;
+    textlen = 0;
+    textWidth = 0;
+    scrollmode = wrapForward;
+
+    if(optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP)
+        renderTextStrip();
+
+    // the first character is pulled at the next step, just inside the right edge
+    setMinMax();
+    scrollcounter = -1;
+    textSource = source;
+}
+
 //Updates the text that is currently scrolling to the new value
 //Useful for a clock display where the time changes.
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::update(const char inputtext[]){
-    int length = strlen((const char *)inputtext);
-    if (length > textLayerMaxStringLength)
-        length = textLayerMaxStringLength;
-    strncpy(text, (const char *)inputtext, length);
-    textlen = length;
+    textSource = NULL;
+    setText(inputtext);
     textWidth = (textlen * scrollFont->Width) - 1;
 
+    if(optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP)
+        renderTextStrip();
+
     setMinMax();
 }
 
-// called once per frame to update (virtual) bitmap
-// function needs major efficiency improvments
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
-    bool resetScrolls = false;
-
-    // return if not ready to update
-    if (!scrollcounter || ++currentframe <= framesperscroll)
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::stepScrollPosition(void) {
+    SMTextSource * source = textSource;
+    if (source) {
+        scrollPosition--;
+        if (advanceTextWindow(source))
+            textWindowChanged = true;
         return;
-
-    currentframe = 0;
+    }
 
     switch (scrollmode) {
     case wrapForward:
@@ -293,9 +523,101 @@ void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
     default:
     case stopped:
         scrollPosition = fontLeftOffset;
-        resetScrolls = true;
         break;
     }
+}
+
+// drops the characters that scrolled off the left edge, and pulls characters from source until there's one past the right edge
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::advanceTextWindow(SMTextSource * source) {
+    const int charWidth = scrollFont->Width;
+    int dropped = 0;
+    int length = textlen;
+
+    while (dropped < length && scrollPosition + charWidth <= 0) {
+        scrollPosition += charWidth;
+        dropped++;
+    }
+
+    if (dropped) {
+        length -= dropped;
+        memmove(text, &text[dropped], length * sizeof(text[0]));
+    }
+
+    bool added = false;
+    while (length < textLayerMaxStringLength && scrollPosition + length * charWidth < this->localWidth + charWidth) {
+        uint32_t codepoint = source->nextCodepoint();
+        text[length++] = codepoint ? ((codepoint <= 0xFFFF) ? codepoint : '?') : ' ';
+        added = true;
+    }
+
+    textlen = length;
+    textWidth = (length * charWidth) - 1;
+    return dropped || added;
+}
+
+// pixelsPerSecond * elapsed microseconds is added up, so the speed stays exact at any frame rate; a long gap between frames
+// (e.g. refresh paused) is limited to a second of movement
+template <typename RGB, unsigned int optionFlags>
+int SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::getTimedScrollSteps(void) {
+    uint32_t now = micros();
+    uint32_t elapsed = scrollTimerRunning ? (now - lastScrollMicros) : 0;
+    lastScrollMicros = now;
+    scrollTimerRunning = true;
+
+    if(elapsed > 1000000)
+        elapsed = 1000000;
+
+    scrollMicroPixels += elapsed * pixelsPerSecond;
+    int steps = scrollMicroPixels / 1000000;
+    scrollMicroPixels %= 1000000;
+    return steps;
+}
+
+// called once per frame to update (virtual) bitmap
+// function needs major efficiency improvments
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
+    bool resetScrolls = false;
+    int steps = 1;
+
+    if (!scrollcounter) {
+        scrollTimerRunning = false;
+        return;
+    }
+
+    if (timedScrolling) {
+        steps = getTimedScrollSteps();
+
+        if (optionFlags & SM_SCROLLING_OPTIONS_SUBPIXEL) {
+            // fraction of the next step, in the direction the text is moving
+            for (int i = 0; i < steps && scrollcounter; i++)
+                stepScrollPosition();
+
+            int direction = (scrollmode == bounceReverse) ? 1 : ((scrollmode == stopped) ? 0 : -1);
+            int32_t fixedPosition = scrollPosition * 256 + direction * (int32_t)((scrollMicroPixels * 256) / 1000000);
+            // nothing to redraw or mark unless the text moved, changed, or finished scrolling in this update
+            if (fixedPosition == scrollPositionFixed && !majorScrollFontChange && !textWindowChanged && !scrollTextStarted && scrollcounter)
+                return;
+            scrollPositionFixed = fixedPosition;
+            scrollTextStarted = false;
+            steps = 0;
+        } else if (!steps) {
+            return;
+        }
+    } else {
+        // return if not ready to update
+        if (++currentframe <= framesperscroll)
+            return;
+
+        currentframe = 0;
+    }
+
+    for (int i = 0; i < steps && scrollcounter; i++)
+        stepScrollPosition();
+
+    if (scrollmode == stopped)
+        resetScrolls = true;
 
     // done scrolling - move text off screen and disable
     if (!scrollcounter) {
@@ -306,7 +628,21 @@ void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
     // TODO: reset only when necessary, and update just the pixels that need it
     resetScrolls = true;
     if (resetScrolls) {
-        redrawScrollingText();
+        // a major change clears the whole bitmap, otherwise only the rows used by the font are redrawn
+        if (majorScrollFontChange)
+            this->markAllRowsChanged();
+        else
+            this->markLocalRowsChanged(fontTopOffset, fontTopOffset + scrollFont->Height - 1);
+
+        // with a text strip, moving scrollPosition is all it takes, unless a stream changed the characters in the strip
+        if((optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP) && textStrip) {
+            if (textWindowChanged)
+                renderTextStrip();
+            majorScrollFontChange = false;
+        } else {
+            redrawScrollingText();
+        }
+        textWindowChanged = false;
     }
 }
 
@@ -330,7 +666,20 @@ void SMLayerScrolling<RGB, optionFlags>::setSpeed(unsigned char pixels_per_secon
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setFont(fontChoices newFont) {
-    scrollFont = fontLookup(newFont);
+    setFont(fontLookup(newFont));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::setFont(const bitmap_font *newFont) {
+    scrollFont = newFont;
+    refreshSettingsChanged = true;
+
+#ifdef SM_FONT_PRELOAD_ASCII
+    preloadBitmapFontGlyphs(scrollFont, ' ', '~');
+#endif
+
+    if((optionFlags & SM_SCROLLING_OPTIONS_TEXT_STRIP) && textlen)
+        renderTextStrip();
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -346,7 +695,7 @@ void SMLayerScrolling<RGB, optionFlags>::setStartOffsetFromLeft(int offset) {
 
 // if font size or position changed since the last call, redraw the whole frame
 template <typename RGB, unsigned int optionFlags>
-void SMLayerScrolling<RGB, optionFlags>::redrawScrollingText(void) {
+void SM_FLASH_SAFE_IRAM SMLayerScrolling<RGB, optionFlags>::redrawScrollingText(void) {
     int j, k;
     int charPosition, textPosition;
     uint16_t charY0, charY1;
@@ -391,7 +740,8 @@ void SMLayerScrolling<RGB, optionFlags>::redrawScrollingText(void) {
             uint8_t tempBitmask;
             // draw character from top to bottom
             for (k = charY0; k < charY1; k++) {
-                tempBitmask = getBitmapFontRowAtXY(text[textPosition], k, scrollFont);
+                const unsigned char *rows = getBitmapFontCodepointRowsForRefresh(text[textPosition], scrollFont);
+                tempBitmask = rows ? rows[k] : 0;
                 //tempBitmask = 0xAA;
                 if (charPosition < 0) {
                     scrollingBitmap[((j + k - charY0) * SCROLLING_BUFFER_ROW_SIZE) + 0] |= tempBitmask << -charPosition;
@@ -0,0 +1,129 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_SPRITES_H_
+#define _LAYER_SPRITES_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_SPRITES_OPTIONS_NONE     0
+
+// the per row active sprite lists are bitmasks, so a layer holds at most this many sprites
+#define SM_SPRITES_MAX_SPRITES      64
+
+// sprite source formats
+typedef enum smSpriteFormat {
+    SM_SPRITE_FORMAT_1BPP,      // MSB first, (width+7)/8 bytes per row, set pixels drawn with the sprite color, clear pixels transparent
+    SM_SPRITE_FORMAT_INDEXED8,  // one byte per pixel into the sprite palette, index 0 is transparent
+    SM_SPRITE_FORMAT_RGB24,     // 3 bytes per pixel: red, green, blue, opaque unless SM_SPRITE_KEY_COLOR is set
+} smSpriteFormat;
+
+// sprite flags
+#define SM_SPRITE_FLIP_X            (1 << 0)
+#define SM_SPRITE_FLIP_Y            (1 << 1)
+// rgb24 sprites: pixels matching the sprite color are transparent
+#define SM_SPRITE_KEY_COLOR         (1 << 2)
+#define SM_SPRITE_VISIBLE           (1 << 7)
+
+template <typename RGB, unsigned int optionFlags>
+class SMLayerSprites : public SM_Layer {
+    public:
+        struct sprite {
+            const uint8_t * bitmap;
+            const RGB * palette;
+            RGB color;
+            // local (rotated) position of the sprite's upper left corner, may be partly or completely off screen
+            int16_t x, y;
+            uint8_t width, height;
+            uint8_t format;
+            uint8_t flags;
+            // higher z is drawn on top, sprites with equal z are drawn in the order they were added
+            int8_t z;
+            bool used;
+        };
+
+        // spriteTable holds 3 * maxSprites entries (one table for drawing, two for refresh), rowMasks holds height entries
+        SMLayerSprites(sprite * spriteTable, uint64_t * rowMasks, uint8_t maxSprites, uint16_t width, uint16_t height);
+        SMLayerSprites(uint8_t maxSprites, uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+
+        void enableColorCorrection(bool enabled);
+
+        // returns a handle for the other sprite functions, or -1 if the table is full; new sprites are visible at 0,0 with z 0
+        int addSprite(const void * bitmap, smSpriteFormat format, uint8_t width, uint8_t height, const RGB * palette = NULL);
+        void removeSprite(int handle);
+        void removeAllSprites(void);
+        // changes take effect at the start of the next refresh frame, all changes made between two frames show up together
+        void setSpritePosition(int handle, int16_t x, int16_t y);
+        void setSpriteZ(int handle, int8_t z);
+        void setSpriteFlip(int handle, bool flipX, bool flipY);
+        void setSpriteVisible(int handle, bool visible);
+        // swap in a new frame of the same size and format, e.g. for animation
+        void setSpriteBitmap(int handle, const void * bitmap);
+        void setSpritePalette(int handle, const RGB * palette);
+        // 1bpp sprites: color of set pixels, rgb24 sprites: transparent color if enabled
+        void setSpriteColor(int handle, const RGB & color, bool keyColorEnabled = false);
+        int16_t getSpriteX(int handle) const;
+        int16_t getSpriteY(int handle) const;
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void correctColor(const RGB & in, RGB_OUT & out);
+        bool rebuildRefreshTable(void);
+        bool isValidHandle(int handle) const;
+        // wrap every change to drawSprites, so refresh can tell a copy made while the sketch was changing a sprite
+        void startSpriteEdit(void);
+        void finishSpriteEdit(void);
+
+        uint8_t maxSprites;
+        // sprites as set by the sketch, copied in z order to nextRefreshSprites by frameRefreshCallback() after a change, which
+        // becomes refreshSprites by swapping the pointers only if no edit overlapped the copy
+        sprite * drawSprites;
+        sprite * refreshSprites;
+        sprite * nextRefreshSprites;
+        // odd while the sketch is changing drawSprites, incremented at the start and end of every change
+        volatile uint32_t spriteEditSequence = 0;
+        uint8_t numRefreshSprites = 0;
+        // bit n of rowMasks[hardwareY] is set if refreshSprites[n] covers that hardware row
+        uint64_t * rowMasks;
+        // first and last hardware column covered by each refreshSprites entry
+        uint16_t refreshSpriteCols[SM_SPRITES_MAX_SPRITES][2];
+
+        smCoordinateMapFunction localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+        smCoordinateMapFunction hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+
+        volatile bool spritesChanged = true;
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        volatile bool refreshSettingsChanged = true;
+};
+
+#include "Layer_Sprites_Impl.h"
+
+#endif
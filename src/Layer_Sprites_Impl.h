@@ -0,0 +1,424 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerSprites<RGB, optionFlags>::SMLayerSprites(sprite * spriteTable, uint64_t * rowMasks, uint8_t maxSprites, uint16_t width, uint16_t height) {
+    this->maxSprites = std::min<uint8_t>(maxSprites, SM_SPRITES_MAX_SPRITES);
+    drawSprites = spriteTable;
+    refreshSprites = spriteTable + this->maxSprites;
+    nextRefreshSprites = spriteTable + 2 * this->maxSprites;
+    this->rowMasks = rowMasks;
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+
+    memset((void *)drawSprites, 0x00, sizeof(sprite) * this->maxSprites);
+    memset(rowMasks, 0x00, sizeof(uint64_t) * height);
+    this->coveredRowsFirst = 0x7FFF;
+    this->coveredRowsLast = -1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerSprites<RGB, optionFlags>::SMLayerSprites(uint8_t maxSprites, uint16_t width, uint16_t height) {
+    this->maxSprites = std::min<uint8_t>(maxSprites, SM_SPRITES_MAX_SPRITES);
+    drawSprites = (sprite *)malloc(sizeof(sprite) * 3 * this->maxSprites);
+    rowMasks = (uint64_t *)malloc(sizeof(uint64_t) * height);
+#ifdef ESP32
+    assert(drawSprites != NULL && rowMasks != NULL);
+#endif
+    smRecordAllocation(smMemoryLayers, drawSprites, sizeof(sprite) * 3 * this->maxSprites);
+    smRecordAllocation(smMemoryLayers, rowMasks, sizeof(uint64_t) * height);
+    refreshSprites = drawSprites + this->maxSprites;
+    nextRefreshSprites = drawSprites + 2 * this->maxSprites;
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+
+    memset((void *)drawSprites, 0x00, sizeof(sprite) * this->maxSprites);
+    memset(rowMasks, 0x00, sizeof(uint64_t) * height);
+    this->coveredRowsFirst = 0x7FFF;
+    this->coveredRowsLast = -1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::begin(void) {
+    spritesChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    if(spritesChanged) {
+        // cleared before copying, so a change made while copying is picked up next frame
+        spritesChanged = false;
+        if(!rebuildRefreshTable())
+            spritesChanged = true;
+    }
+
+    if(refreshSettingsChanged) {
+        this->markRowsChanged(this->coveredRowsFirst, this->coveredRowsLast);
+        refreshSettingsChanged = false;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0) {
+        localToHardwareForRotation = &SMRotationPolicy<rotation0>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+    } else if (this->layerRotation == rotation180) {
+        localToHardwareForRotation = &SMRotationPolicy<rotation180>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation180>::hardwareToLocal;
+    } else if (this->layerRotation == rotation90) {
+        localToHardwareForRotation = &SMRotationPolicy<rotation90>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation90>::hardwareToLocal;
+    } else { /* if (layerRotation == rotation270)*/
+        localToHardwareForRotation = &SMRotationPolicy<rotation270>::localToHardware;
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation270>::hardwareToLocal;
+    }
+
+    spritesChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::startSpriteEdit(void) {
+    __atomic_add_fetch(&spriteEditSequence, 1, __ATOMIC_SEQ_CST);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::finishSpriteEdit(void) {
+    __atomic_add_fetch(&spriteEditSequence, 1, __ATOMIC_SEQ_CST);
+    spritesChanged = true;
+}
+
+// copy the visible sprites to the refresh table sorted by z, and build the per row active sprite lists
+// returns false and keeps the current refresh table if the sketch was changing a sprite during the copy
+template <typename RGB, unsigned int optionFlags>
+bool SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::rebuildRefreshTable(void) {
+    int oldRowsFirst = this->coveredRowsFirst;
+    int oldRowsLast = this->coveredRowsLast;
+
+    // an edit interrupted by refresh (Teensy) can't finish until refresh returns, try again next frame
+    uint32_t sequence = __atomic_load_n(&spriteEditSequence, __ATOMIC_ACQUIRE);
+    if(sequence & 1)
+        return false;
+
+    // insertion sort keeps sprites with equal z in table order, the table is small
+    int numSprites = 0;
+    for(int i=0; i<maxSprites; i++) {
+        const sprite s = drawSprites[i];
+        if(!s.used || !(s.flags & SM_SPRITE_VISIBLE) || !s.bitmap)
+            continue;
+        if(s.format == SM_SPRITE_FORMAT_INDEXED8 && !s.palette)
+            continue;
+
+        int pos = numSprites++;
+        while(pos > 0 && nextRefreshSprites[pos - 1].z > s.z) {
+            nextRefreshSprites[pos] = nextRefreshSprites[pos - 1];
+            pos--;
+        }
+        nextRefreshSprites[pos] = s;
+    }
+
+    // an edit on the other core (ESP32) overlapped the copy, which may hold half of a change
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&spriteEditSequence, __ATOMIC_RELAXED) != sequence)
+        return false;
+
+    sprite * previous = refreshSprites;
+    refreshSprites = nextRefreshSprites;
+    nextRefreshSprites = previous;
+    numRefreshSprites = numSprites;
+
+    // the covered rows are rebuilt along with the row lists, rows without sprites are skipped by the calc
+    memset(rowMasks, 0x00, sizeof(uint64_t) * this->matrixHeight);
+    this->coveredRowsFirst = 0x7FFF;
+    this->coveredRowsLast = -1;
+
+    for(int n=0; n<numRefreshSprites; n++) {
+        const sprite &s = refreshSprites[n];
+
+        // clip to the layer, sprites completely off screen stay out of every row list
+        int x0 = std::max<int>(s.x, 0);
+        int y0 = std::max<int>(s.y, 0);
+        int x1 = std::min<int>(s.x + s.width - 1, this->localWidth - 1);
+        int y1 = std::min<int>(s.y + s.height - 1, this->localHeight - 1);
+        if(x1 < x0 || y1 < y0)
+            continue;
+
+        // opposite corners of the local rectangle are opposite corners of the hardware rectangle
+        int16_t ax, ay, bx, by;
+        localToHardwareForRotation(x0, y0, this->matrixWidth, this->matrixHeight, ax, ay);
+        localToHardwareForRotation(x1, y1, this->matrixWidth, this->matrixHeight, bx, by);
+
+        refreshSpriteCols[n][0] = std::min(ax, bx);
+        refreshSpriteCols[n][1] = std::max(ax, bx);
+
+        int hwy0 = std::min(ay, by);
+        int hwy1 = std::max(ay, by);
+        for(int row = hwy0; row <= hwy1; row++)
+            rowMasks[row] |= (uint64_t)1 << n;
+
+        this->coveredRowsFirst = std::min<int>(this->coveredRowsFirst, hwy0);
+        this->coveredRowsLast = std::max<int>(this->coveredRowsLast, hwy1);
+    }
+
+    // rows the sprites left and rows they moved into both change
+    this->markRowsChanged(std::min<int>(oldRowsFirst, this->coveredRowsFirst), std::max<int>(oldRowsLast, this->coveredRowsLast));
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+inline void SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::correctColor(const RGB & in, RGB_OUT & out) {
+    if(ccEnabled)
+        colorCorrection(in, out);
+    else
+        out = in;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    uint64_t mask = rowMasks[hardwareY];
+
+    // lowest z first, so sprites with higher z overwrite it
+    while(mask) {
+        int n = __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        const sprite &s = refreshSprites[n];
+        int hwx = refreshSpriteCols[n][0];
+        int numPixels = refreshSpriteCols[n][1] - hwx + 1;
+
+        // sprite pixel under the first hardware column, and the step through the sprite for each following column
+        int16_t lx, ly, nextX, nextY;
+        hardwareToLocalForRotation(hwx, hardwareY, this->matrixWidth, this->matrixHeight, lx, ly);
+        hardwareToLocalForRotation(hwx + 1, hardwareY, this->matrixWidth, this->matrixHeight, nextX, nextY);
+
+        int sx = lx - s.x;
+        int sy = ly - s.y;
+        int dx = nextX - lx;
+        int dy = nextY - ly;
+
+        if(s.flags & SM_SPRITE_FLIP_X) {
+            sx = (s.width - 1) - sx;
+            dx = -dx;
+        }
+        if(s.flags & SM_SPRITE_FLIP_Y) {
+            sy = (s.height - 1) - sy;
+            dy = -dy;
+        }
+
+        RGB_OUT * dst = &refreshRow[hwx];
+
+        if(s.format == SM_SPRITE_FORMAT_1BPP) {
+            // one color for the whole sprite, corrected once
+            RGB_OUT color;
+            correctColor(s.color, color);
+
+            int rowBytes = (s.width + 7) / 8;
+            for(int i=0; i<numPixels; i++, sx += dx, sy += dy) {
+                if(s.bitmap[(sy * rowBytes) + (sx / 8)] & (0x80 >> (sx % 8)))
+                    dst[i] = color;
+            }
+        } else if(s.format == SM_SPRITE_FORMAT_INDEXED8) {
+            for(int i=0; i<numPixels; i++, sx += dx, sy += dy) {
+                uint8_t index = s.bitmap[(sy * s.width) + sx];
+                if(index)
+                    correctColor(s.palette[index], dst[i]);
+            }
+        } else { /* if(s.format == SM_SPRITE_FORMAT_RGB24) */
+            bool keyed = s.flags & SM_SPRITE_KEY_COLOR;
+            rgb24 key = rgb24(s.color);
+
+            for(int i=0; i<numPixels; i++, sx += dx, sy += dy) {
+                const uint8_t * src = &s.bitmap[((sy * s.width) + sx) * 3];
+                if(keyed && src[0] == key.red && src[1] == key.green && src[2] == key.blue)
+                    continue;
+                correctColor(RGB(rgb24(src[0], src[1], src[2])), dst[i]);
+            }
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerSprites<RGB, optionFlags>::isValidHandle(int handle) const {
+    return handle >= 0 && handle < maxSprites && drawSprites[handle].used;
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerSprites<RGB, optionFlags>::addSprite(const void * bitmap, smSpriteFormat format, uint8_t width, uint8_t height, const RGB * palette) {
+    for(int i=0; i<maxSprites; i++) {
+        if(drawSprites[i].used)
+            continue;
+
+        startSpriteEdit();
+        sprite &s = drawSprites[i];
+        s.bitmap = (const uint8_t *)bitmap;
+        s.palette = palette;
+        s.color = RGB(rgb24(0xff, 0xff, 0xff));
+        s.x = 0;
+        s.y = 0;
+        s.width = width;
+        s.height = height;
+        s.format = format;
+        s.flags = SM_SPRITE_VISIBLE;
+        s.z = 0;
+        s.used = true;
+        finishSpriteEdit();
+        return i;
+    }
+
+    return -1;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::removeSprite(int handle) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].used = false;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::removeAllSprites(void) {
+    startSpriteEdit();
+    for(int i=0; i<maxSprites; i++)
+        drawSprites[i].used = false;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpritePosition(int handle, int16_t x, int16_t y) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].x = x;
+    drawSprites[handle].y = y;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteZ(int handle, int8_t z) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].z = z;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteFlip(int handle, bool flipX, bool flipY) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    uint8_t flags = drawSprites[handle].flags & ~(SM_SPRITE_FLIP_X | SM_SPRITE_FLIP_Y);
+    if(flipX)
+        flags |= SM_SPRITE_FLIP_X;
+    if(flipY)
+        flags |= SM_SPRITE_FLIP_Y;
+    drawSprites[handle].flags = flags;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteVisible(int handle, bool visible) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    if(visible)
+        drawSprites[handle].flags |= SM_SPRITE_VISIBLE;
+    else
+        drawSprites[handle].flags &= ~SM_SPRITE_VISIBLE;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteBitmap(int handle, const void * bitmap) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].bitmap = (const uint8_t *)bitmap;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpritePalette(int handle, const RGB * palette) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].palette = palette;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteColor(int handle, const RGB & color, bool keyColorEnabled) {
+    if(!isValidHandle(handle))
+        return;
+
+    startSpriteEdit();
+    drawSprites[handle].color = color;
+    if(keyColorEnabled)
+        drawSprites[handle].flags |= SM_SPRITE_KEY_COLOR;
+    else
+        drawSprites[handle].flags &= ~SM_SPRITE_KEY_COLOR;
+    finishSpriteEdit();
+}
+
+template <typename RGB, unsigned int optionFlags>
+int16_t SMLayerSprites<RGB, optionFlags>::getSpriteX(int handle) const {
+    return isValidHandle(handle) ? drawSprites[handle].x : 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+int16_t SMLayerSprites<RGB, optionFlags>::getSpriteY(int handle) const {
+    return isValidHandle(handle) ? drawSprites[handle].y : 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * SmartMatrix Library - Layer Stack Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _LAYER_STACK_H_
+#define _LAYER_STACK_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+// the layers of an SMLayerStack, bottom layer first, each called through its own type so the calls aren't virtual and can be inlined
+template <typename... LAYERS>
+struct smLayerStackList;
+
+template <>
+struct smLayerStackList<> {
+    void begin(void) {};
+    void frameRefreshCallback(void) {};
+    template <typename RGB_OUT>
+    inline void fillRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {};
+    void setRotation(rotationDegrees newrotation) {};
+    void setRefreshRate(uint8_t newRefreshRate) {};
+    int getRequestedBrightnessShifts(void) { return 0; };
+    bool isLayerChanged(void) { return false; };
+    bool getChangedRows(uint16_t &firstRow, uint16_t &lastRow) { return false; };
+    void prefetchRefreshRow(uint16_t hardwareY) {};
+    bool getSwapLatencyMicros(uint32_t &requestedMicros, uint32_t &pickedUpMicros) { return false; };
+};
+
+template <typename LAYER, typename... REST>
+struct smLayerStackList<LAYER, REST...> {
+    smLayerStackList(LAYER * layer, REST *... rest) : layer(layer), rest(rest...) {};
+
+    void begin(void) { layer->LAYER::begin(); rest.begin(); };
+    void frameRefreshCallback(void) { layer->LAYER::frameRefreshCallback(); rest.frameRefreshCallback(); };
+    template <typename RGB_OUT>
+    inline void fillRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[], int brightnessShifts) {
+        if(layer->isRowCovered(hardwareY))
+            layer->LAYER::fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+        rest.fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+    };
+    void setRotation(rotationDegrees newrotation) { layer->LAYER::setRotation(newrotation); rest.setRotation(newrotation); };
+    void setRefreshRate(uint8_t newRefreshRate) { layer->LAYER::setRefreshRate(newRefreshRate); rest.setRefreshRate(newRefreshRate); };
+    int getRequestedBrightnessShifts(void) {
+        int shifts = layer->LAYER::getRequestedBrightnessShifts();
+        int restShifts = rest.getRequestedBrightnessShifts();
+        return (restShifts > shifts) ? restShifts : shifts;
+    };
+    bool isLayerChanged(void) {
+        bool changed = layer->LAYER::isLayerChanged();
+        return rest.isLayerChanged() || changed;
+    };
+    // the union of the layers' changed rows
+    bool getChangedRows(uint16_t &firstRow, uint16_t &lastRow) {
+        uint16_t restFirst, restLast;
+        bool changed = layer->LAYER::getChangedRows(firstRow, lastRow);
+        if(!rest.getChangedRows(restFirst, restLast))
+            return changed;
+        if(changed) {
+            if(restFirst < firstRow)
+                firstRow = restFirst;
+            if(restLast > lastRow)
+                lastRow = restLast;
+        } else {
+            firstRow = restFirst;
+            lastRow = restLast;
+        }
+        return true;
+    };
+    void prefetchRefreshRow(uint16_t hardwareY) { layer->LAYER::prefetchRefreshRow(hardwareY); rest.prefetchRefreshRow(hardwareY); };
+    bool getSwapLatencyMicros(uint32_t &requestedMicros, uint32_t &pickedUpMicros) {
+        if(layer->getSwapLatencyMicros(requestedMicros, pickedUpMicros))
+            return true;
+        return rest.getSwapLatencyMicros(requestedMicros, pickedUpMicros);
+    };
+
+    LAYER * const layer;
+    smLayerStackList<REST...> rest;
+};
+
+// a fixed set of layers added to the calc as one layer, for sketches whose layers never change: the calc makes one virtual
+// fillRefreshRow() call per row for the whole stack, and the stack calls each layer's fillRefreshRow() directly through its type, so
+// the compiler can inline the layers into one row fill.  Layers are listed bottom first, and aren't added to the calc themselves:
+//
+//   SMLayerStack<decltype(backgroundLayer), decltype(scrollingLayer), decltype(indexedLayer)> layerStack(&backgroundLayer, &scrollingLayer, &indexedLayer);
+//   matrix.addLayer(&layerStack);
+//
+// The layers' types have to be exactly the types of the objects, a stack of SM_Layer * calls them virtually like the calc would.
+template <typename... LAYERS>
+class SMLayerStack : public SM_Layer {
+    public:
+        SMLayerStack(LAYERS *... layers);
+        void begin(void);
+        void frameRefreshCallback(void);
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+        void setRefreshRate(uint8_t newRefreshRate);
+        int getRequestedBrightnessShifts();
+        bool isLayerChanged();
+        // opaque if the bottom layer is
+        bool isLayerOpaque();
+        bool getChangedRows(uint16_t &firstRow, uint16_t &lastRow);
+        void prefetchRefreshRow(uint16_t hardwareY);
+
+    protected:
+        smLayerStackList<LAYERS...> layers;
+};
+
+#include "Layer_Stack_Impl.h"
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * SmartMatrix Library - Layer Stack Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+template <typename... LAYERS>
+SMLayerStack<LAYERS...>::SMLayerStack(LAYERS *... layers) : layers(layers...) {
+    static_assert(sizeof...(LAYERS) > 0, "SMLayerStack needs at least one layer");
+}
+
+template <typename... LAYERS>
+void SMLayerStack<LAYERS...>::begin(void) {
+    layers.begin();
+}
+
+template <typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::frameRefreshCallback(void) {
+    layers.frameRefreshCallback();
+
+    // the calc only asks the stack for swap latency, so pass on a swap one of the layers picked up
+    uint32_t requestedMicros, pickedUpMicros;
+    if(layers.getSwapLatencyMicros(requestedMicros, pickedUpMicros)) {
+        swapLatencyRequestedMicros = requestedMicros;
+        swapPickedUpMicros = pickedUpMicros;
+        swapLatencyReady = true;
+    }
+}
+
+template <typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    layers.fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+}
+
+template <typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    layers.fillRefreshRow(hardwareY, refreshRow, brightnessShifts);
+}
+
+template <typename... LAYERS>
+void SMLayerStack<LAYERS...>::setRotation(rotationDegrees newrotation) {
+    layers.setRotation(newrotation);
+
+    layerRotation = newrotation;
+    localWidth = layers.layer->getLocalWidth();
+    localHeight = layers.layer->getLocalHeight();
+}
+
+template <typename... LAYERS>
+void SMLayerStack<LAYERS...>::setRefreshRate(uint8_t newRefreshRate) {
+    refreshRate = newRefreshRate;
+    layers.setRefreshRate(newRefreshRate);
+}
+
+template <typename... LAYERS>
+int SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::getRequestedBrightnessShifts() {
+    return layers.getRequestedBrightnessShifts();
+}
+
+template <typename... LAYERS>
+bool SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::isLayerChanged() {
+    return layers.isLayerChanged();
+}
+
+template <typename... LAYERS>
+bool SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::isLayerOpaque() {
+    return layers.layer->isLayerOpaque();
+}
+
+template <typename... LAYERS>
+bool SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::getChangedRows(uint16_t &firstRow, uint16_t &lastRow) {
+    return layers.getChangedRows(firstRow, lastRow);
+}
+
+template <typename... LAYERS>
+void SM_FLASH_SAFE_IRAM SMLayerStack<LAYERS...>::prefetchRefreshRow(uint16_t hardwareY) {
+    layers.prefetchRefreshRow(hardwareY);
+}
@@ -0,0 +1,98 @@
+/*
+ * SmartMatrix Library - Tile Map Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_TILEMAP_H_
+#define _LAYER_TILEMAP_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_TILEMAP_OPTIONS_NONE     0
+
+// tileset formats, each tile is tileSize x tileSize pixels stored row by row, tiles stored one after another
+typedef enum smTileFormat {
+    SM_TILE_FORMAT_RGB565,      // 16-bit rgb16 per pixel, always opaque
+    SM_TILE_FORMAT_INDEXED8,    // one byte per pixel into the tileset palette, index 0 is transparent
+} smTileFormat;
+
+// map entries with this value draw nothing
+#define SM_TILEMAP_EMPTY_TILE       0xFFFF
+
+template <typename RGB, unsigned int optionFlags>
+class SMLayerTileMap : public SM_Layer {
+    public:
+        SMLayerTileMap(uint16_t width, uint16_t height);
+        void begin(void);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts = 0);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts = 0);
+        void setRotation(rotationDegrees newrotation);
+
+        void enableColorCorrection(bool enabled);
+
+        // tiles and map are read during refresh and can stay in flash, tileSize is 8 or 16
+        void setTileset(const void * tiles, smTileFormat format, uint8_t tileSize, const RGB * palette = NULL);
+        // map holds mapWidth x mapHeight tile indexes row by row, the map repeats in both directions when scrolled past its edges
+        void setMap(const uint16_t * map, uint16_t mapWidth, uint16_t mapHeight);
+        // call after changing tiles, palette, or map entries in place
+        void markMapChanged(void);
+
+        // position of the map pixel shown in the upper left corner of the layer, applied at the start of the next refresh frame
+        void setScroll(int32_t x, int32_t y);
+        // optional table with one extra x offset per local row (localHeight entries), read while refreshing so it can be changed any time, NULL to disable
+        void setRowScroll(const int16_t * rowOffsets);
+
+    protected:
+        template <typename RGB_OUT>
+        void fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        // copies numPixels from row py of tile, starting at column px and stepping dx columns per pixel
+        template <typename RGB_OUT>
+        void getTilePixels(uint16_t tile, int px, int py, int dx, int numPixels, RGB_OUT * dst);
+        template <typename RGB_OUT>
+        void correctColor(const RGB & in, RGB_OUT & out);
+
+        const uint8_t * tileset = NULL;
+        const RGB * palette = NULL;
+        smTileFormat tileFormat = SM_TILE_FORMAT_RGB565;
+        uint8_t tileShift = 3;
+
+        const uint16_t * tileMap = NULL;
+        uint16_t mapWidth = 0;
+        uint16_t mapHeight = 0;
+
+        // scroll position set by the sketch, and the one used for refresh, latched in frameRefreshCallback()
+        volatile int32_t pendingScrollX = 0;
+        volatile int32_t pendingScrollY = 0;
+        int32_t scrollX = 0;
+        int32_t scrollY = 0;
+        const int16_t * volatile rowScroll = NULL;
+
+        smCoordinateMapFunction hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        volatile bool refreshSettingsChanged = true;
+};
+
+#include "Layer_TileMap_Impl.h"
+
+#endif
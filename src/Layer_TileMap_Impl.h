@@ -0,0 +1,212 @@
+/*
+ * SmartMatrix Library - Tile Map Layer Class
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// v modulo m, always in 0..m-1
+static inline int32_t smTileMapWrap(int32_t v, int32_t m) {
+    v %= m;
+    return (v < 0) ? v + m : v;
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerTileMap<RGB, optionFlags>::SMLayerTileMap(uint16_t width, uint16_t height) {
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::begin(void) {
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::frameRefreshCallback(void) {
+    this->clearChangedRows();
+
+    if(pendingScrollX != scrollX || pendingScrollY != scrollY) {
+        scrollX = pendingScrollX;
+        scrollY = pendingScrollY;
+        refreshSettingsChanged = true;
+    }
+
+    // the row scroll table can change at any time, so with one set every frame is treated as changed
+    if(refreshSettingsChanged || rowScroll) {
+        this->markAllRowsChanged();
+        refreshSettingsChanged = false;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::setRotation(rotationDegrees newrotation) {
+    SM_Layer::setRotation(newrotation);
+
+    if (this->layerRotation == rotation0)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation0>::hardwareToLocal;
+    else if (this->layerRotation == rotation180)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation180>::hardwareToLocal;
+    else if (this->layerRotation == rotation90)
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation90>::hardwareToLocal;
+    else /* if (layerRotation == rotation270)*/
+        hardwareToLocalForRotation = &SMRotationPolicy<rotation270>::hardwareToLocal;
+
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+inline void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::correctColor(const RGB & in, RGB_OUT & out) {
+    if(ccEnabled)
+        colorCorrection(in, out);
+    else
+        out = in;
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::getTilePixels(uint16_t tile, int px, int py, int dx, int numPixels, RGB_OUT * dst) {
+    if(tile == SM_TILEMAP_EMPTY_TILE)
+        return;
+
+    uint32_t index = ((uint32_t)tile << (2 * tileShift)) + (py << tileShift) + px;
+
+    if(tileFormat == SM_TILE_FORMAT_RGB565) {
+        const uint16_t * src = (const uint16_t *)tileset + index;
+        for(int i=0; i<numPixels; i++, src += dx)
+            correctColor(RGB(rgb16(*src)), dst[i]);
+    } else { /* if(tileFormat == SM_TILE_FORMAT_INDEXED8) */
+        const uint8_t * src = tileset + index;
+        for(int i=0; i<numPixels; i++, src += dx) {
+            if(*src)
+                correctColor(palette[*src], dst[i]);
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+template <typename RGB_OUT>
+void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::fillRefreshRowTemplated(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    if(!tileset || !tileMap || (tileFormat == SM_TILE_FORMAT_INDEXED8 && !palette))
+        return;
+
+    const int tileMask = (1 << tileShift) - 1;
+    const int32_t mapPixelWidth = (int32_t)mapWidth << tileShift;
+    const int32_t mapPixelHeight = (int32_t)mapHeight << tileShift;
+    const int16_t * offsets = rowScroll;
+
+    // local pixel of hardware column 0, and the local step for each following column
+    int16_t lx, ly, nextX, nextY;
+    hardwareToLocalForRotation(0, hardwareY, this->matrixWidth, this->matrixHeight, lx, ly);
+    hardwareToLocalForRotation(1, hardwareY, this->matrixWidth, this->matrixHeight, nextX, nextY);
+    int dx = nextX - lx;
+    int dy = nextY - ly;
+
+    if(dy == 0) {
+        // rotation0/180: the hardware row is one local row, copied a tile span at a time
+        int32_t wy = smTileMapWrap(ly + scrollY, mapPixelHeight);
+        int32_t wx = smTileMapWrap(lx + scrollX + (offsets ? offsets[ly] : 0), mapPixelWidth);
+        const uint16_t * mapRow = &tileMap[(wy >> tileShift) * mapWidth];
+        int py = wy & tileMask;
+
+        for(int i=0; i<this->matrixWidth; ) {
+            int px = wx & tileMask;
+            int run = std::min<int>((dx > 0) ? (tileMask + 1) - px : px + 1, this->matrixWidth - i);
+
+            getTilePixels(mapRow[wx >> tileShift], px, py, dx, run, &refreshRow[i]);
+
+            i += run;
+            wx += dx * run;
+            if(wx >= mapPixelWidth)
+                wx -= mapPixelWidth;
+            else if(wx < 0)
+                wx += mapPixelWidth;
+        }
+    } else {
+        // rotation90/270: the hardware row is one local column, each pixel is on a different local row with its own row offset
+        int32_t wy = smTileMapWrap(ly + scrollY, mapPixelHeight);
+        int32_t baseX = smTileMapWrap(lx + scrollX, mapPixelWidth);
+
+        for(int i=0; i<this->matrixWidth; i++, ly += dy) {
+            int32_t wx = offsets ? smTileMapWrap(baseX + offsets[ly], mapPixelWidth) : baseX;
+
+            getTilePixels(tileMap[(wy >> tileShift) * mapWidth + (wx >> tileShift)], wx & tileMask, wy & tileMask, 0, 1, &refreshRow[i]);
+
+            wy += dy;
+            if(wy >= mapPixelHeight)
+                wy -= mapPixelHeight;
+            else if(wy < 0)
+                wy += mapPixelHeight;
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SM_FLASH_SAFE_IRAM SMLayerTileMap<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[], int brightnessShifts) {
+    fillRefreshRowTemplated(hardwareY, refreshRow);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::setTileset(const void * tiles, smTileFormat format, uint8_t tileSize, const RGB * palette) {
+    tileset = NULL;
+    tileFormat = format;
+    tileShift = (tileSize == 16) ? 4 : 3;
+    this->palette = palette;
+    tileset = (const uint8_t *)tiles;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::setMap(const uint16_t * map, uint16_t mapWidth, uint16_t mapHeight) {
+    tileMap = NULL;
+    this->mapWidth = mapWidth;
+    this->mapHeight = mapHeight;
+    if(mapWidth && mapHeight)
+        tileMap = map;
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::markMapChanged(void) {
+    refreshSettingsChanged = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::setScroll(int32_t x, int32_t y) {
+    pendingScrollX = x;
+    pendingScrollY = y;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTileMap<RGB, optionFlags>::setRowScroll(const int16_t * rowOffsets) {
+    rowScroll = rowOffsets;
+    refreshSettingsChanged = true;
+}
@@ -0,0 +1,181 @@
+/*
+ * SmartMatrix Library - Animation Player
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_ANIMATION_H_
+#define _MATRIX_ANIMATION_H_
+
+// SmartMatrix animation files (.sma, made with extras/tools/smanim.py) store each frame as rectangles changed since the previous
+// frame, RLE compressed in the pixel format of the layer they're meant for, so decoded runs are copied into the drawing buffer a row
+// at a time with drawBitmap() (memcpy when the formats match and the layer isn't rotated by 90/270).  A file in another format still
+// plays, converted by drawBitmap().
+//
+// All values are little endian:
+//   header:    'S' 'M' 'A' '1' width(16) height(16) format(8, smBitmapFormat RGB24/RGB565/RGB332) flags(8) frameCount(16) reserved(32)
+//   frame:     delayMs(16) rectCount(16) then rectCount rectangles
+//   rectangle: x(16) y(16) width(16) height(16) then RLE data for width * height pixels in row-major order
+//   RLE:       code byte n < 0x80: n+1 pixels follow, n >= 0x80: one pixel repeated (n & 0x7F)+1 times, runs may span rows
+// The first frame covers the whole screen, so playback can loop back to it.
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.
+
+#include "Layer_Background.h"
+
+#define SM_ANIMATION_HEADER_SIZE    16
+#define SM_ANIMATION_CHUNK_SIZE     512
+
+// where the player reads an animation from: next() returns a pointer to the next length bytes (length 0 at the end), which stay
+// valid until the following next() call
+class SMDataSource {
+    public:
+        virtual const uint8_t * next(size_t &length) = 0;
+        virtual bool rewind(uint32_t position) = 0;
+};
+
+// an animation in memory: a const array in flash, or flash mapped into the address space, read in place without copying
+class SMMemorySource : public SMDataSource {
+    public:
+        SMMemorySource(const uint8_t * data = NULL, size_t size = 0) : data(data), size(size) {};
+        void setData(const uint8_t * data, size_t size) { this->data = data; this->size = size; position = 0; };
+        const uint8_t * next(size_t &length) {
+            length = size - position;
+            const uint8_t * chunk = data + position;
+            position = size;
+            return chunk;
+        };
+        bool rewind(uint32_t position) {
+            if(position > size)
+                return false;
+            this->position = position;
+            return true;
+        };
+
+    protected:
+        const uint8_t * data;
+        size_t size;
+        size_t position = 0;
+};
+
+// an animation in a file (SD, SdFat, SPIFFS or LittleFS File), read in SM_ANIMATION_CHUNK_SIZE chunks
+template <typename FILE>
+class SMFileSource : public SMDataSource {
+    public:
+        SMFileSource(FILE & file) : file(file) {};
+        const uint8_t * next(size_t &length) {
+            int received = file.read(buffer, SM_ANIMATION_CHUNK_SIZE);
+            length = (received > 0) ? received : 0;
+            return buffer;
+        };
+        bool rewind(uint32_t position) {
+            return file.seek(position);
+        };
+
+    protected:
+        FILE & file;
+        uint8_t buffer[SM_ANIMATION_CHUNK_SIZE];
+};
+
+typedef struct smAnimationStats {
+    uint32_t frames;            // frames decoded
+    uint32_t lateFrames;        // frames shown more than one frame delay after their time
+    uint32_t errors;            // corrupt frames, playback stops
+    uint32_t lastDecodeMicros;  // time to decode the last frame
+} smAnimationStats;
+
+template <typename RGB, unsigned int optionFlags>
+class SMAnimationPlayer {
+    public:
+        SMAnimationPlayer(SMLayerBackground<RGB, optionFlags> * layer);
+
+        // reads the header, decodes the first frame and starts playback, returns false if the animation doesn't fit the layer
+        bool begin(SMDataSource * source);
+        void stop(void) { playing = false; };
+        bool isPlaying(void) const { return playing; };
+        // play once instead of looping, isPlaying() is false after the last frame
+        void setLooping(bool loop) { looping = loop; };
+
+        // call from loop(), decodes and shows the next frame when it's due
+        void update(void);
+
+        // decodes the next frame into the layer's drawing buffer without swapping, for callers that do their own timing
+        // returns false at the end of the animation (after rewinding, if looping) or on a corrupt frame
+        bool decodeFrame(void);
+        uint16_t getFrameDelay(void) const { return frameDelay; };
+
+        uint16_t getWidth(void) const { return width; };
+        uint16_t getHeight(void) const { return height; };
+        uint16_t getFrameCount(void) const { return frameCount; };
+        const smAnimationStats & getStats(void) const { return stats; };
+
+#if defined(ESP32)
+        // decodes and swaps frames on a task pinned to core (the core not running loop() by default), so decoding the next frame
+        // overlaps with showing the current one; use a layer with SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER so the task has a buffer to
+        // decode into while the other two are refreshed.  update() does nothing while the pipeline runs
+        bool startPipeline(int core = -1, UBaseType_t priority = 1);
+        void stopPipeline(void);
+        bool isPipelineRunning(void) const { return pipelineRunning; };
+#endif
+
+    protected:
+        // moves lastFrameMillis on to when the next frame is due, or to now if decoding fell a whole frame behind
+        void advanceFrameTime(uint16_t shownDelay, uint32_t now);
+        bool readBytes(uint8_t * dst, size_t count);
+        bool readUint16(uint16_t &value);
+        // a pointer to count contiguous bytes in the current chunk, consumed, or NULL if they span chunks
+        const uint8_t * readInPlace(size_t count);
+        bool decodeRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+        void flushRow(uint16_t x, uint16_t y, uint16_t w);
+
+        SMLayerBackground<RGB, optionFlags> * layer;
+        SMDataSource * source = NULL;
+        const uint8_t * chunk = NULL;
+        size_t chunkRemaining = 0;
+
+        uint16_t width = 0;
+        uint16_t height = 0;
+        smBitmapFormat format = SM_BITMAP_FORMAT_RGB24;
+        uint8_t pixelBytes = 3;
+        uint16_t frameCount = 0;
+        uint16_t frameIndex = 0;
+        uint16_t frameDelay = 0;
+
+        volatile bool playing = false;
+        bool looping = true;
+        uint32_t lastFrameMillis = 0;
+
+        // one rectangle row, for runs and for literals that span chunks
+        uint8_t * rowBuffer = NULL;
+        uint16_t rowFill = 0;
+
+        smAnimationStats stats;
+
+#if defined(ESP32)
+        static void pipelineTaskFunction(void * player);
+        void runPipeline(void);
+        volatile bool pipelineRunning = false;
+        volatile bool pipelineStopRequested = false;
+#endif
+};
+
+#include "MatrixAnimation_Impl.h"
+
+#endif
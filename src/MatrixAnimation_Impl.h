@@ -0,0 +1,315 @@
+/*
+ * SmartMatrix Library - Animation Player
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+template <typename RGB, unsigned int optionFlags>
+SMAnimationPlayer<RGB, optionFlags>::SMAnimationPlayer(SMLayerBackground<RGB, optionFlags> * layer) {
+    this->layer = layer;
+    memset(&stats, 0, sizeof(stats));
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::begin(SMDataSource * source) {
+    const uint8_t formatPixelBytes[] = {3, 2, 1};
+    uint8_t header[SM_ANIMATION_HEADER_SIZE];
+
+    playing = false;
+    this->source = source;
+    chunkRemaining = 0;
+
+    if(!source->rewind(0) || !readBytes(header, SM_ANIMATION_HEADER_SIZE) || memcmp(header, "SMA1", 4) || header[8] > SM_BITMAP_FORMAT_RGB332) {
+        Serial.println("Error: not a SmartMatrix animation");
+        return false;
+    }
+
+    width = header[4] | (header[5] << 8);
+    height = header[6] | (header[7] << 8);
+    format = (smBitmapFormat)header[8];
+    pixelBytes = formatPixelBytes[format];
+    frameCount = header[10] | (header[11] << 8);
+
+    if(width != layer->getLocalWidth() || height != layer->getLocalHeight() || !frameCount) {
+        Serial.println("Error: animation size doesn't match the layer");
+        return false;
+    }
+
+    // a row in either orientation in the largest format, so the buffer can be reused for any animation that fits the layer
+    if(!rowBuffer)
+        rowBuffer = (uint8_t *)malloc((uint32_t)std::max(layer->getLocalWidth(), layer->getLocalHeight()) * 3);
+    if(!rowBuffer) {
+        Serial.println("Error: SMAnimationPlayer can't allocate row buffer");
+        return false;
+    }
+
+    frameIndex = 0;
+    if(!decodeFrame())
+        return false;
+
+    layer->swapBuffers(true);
+    lastFrameMillis = millis();
+    playing = true;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::update(void) {
+    if(!playing)
+        return;
+
+#if defined(ESP32)
+    if(pipelineRunning)
+        return;
+#endif
+
+    // frameDelay is still the delay of the frame being shown
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastFrameMillis;
+    if(elapsed < frameDelay)
+        return;
+
+    advanceFrameTime(frameDelay, now);
+
+    if(!decodeFrame()) {
+        playing = false;
+        return;
+    }
+
+    // frames after the first are deltas, so the next drawing buffer has to start as a copy of this frame
+    layer->swapBuffers(true);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::advanceFrameTime(uint16_t shownDelay, uint32_t now) {
+    // keep to the animation's timing, unless decoding fell a whole frame behind
+    if(now - lastFrameMillis >= 2 * (uint32_t)shownDelay) {
+        stats.lateFrames++;
+        lastFrameMillis = now;
+    } else {
+        lastFrameMillis += shownDelay;
+    }
+}
+
+#if defined(ESP32)
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::startPipeline(int core, UBaseType_t priority) {
+    if(!playing || pipelineRunning)
+        return false;
+
+    if(core < 0)
+        core = !xPortGetCoreID();
+
+    pipelineStopRequested = false;
+    pipelineRunning = true;
+    if(xTaskCreatePinnedToCore(pipelineTaskFunction, "SmartMatrixAnim", 3000, this, priority, NULL, core) != pdPASS) {
+        pipelineRunning = false;
+        Serial.println("Error: SMAnimationPlayer can't create pipeline task");
+        return false;
+    }
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::stopPipeline(void) {
+    pipelineStopRequested = true;
+    while(pipelineRunning)
+        vTaskDelay(1);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::pipelineTaskFunction(void * player) {
+    ((SMAnimationPlayer<RGB, optionFlags> *)player)->runPipeline();
+    vTaskDelete(NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::runPipeline(void) {
+    while(playing && !pipelineStopRequested) {
+        // decode the next frame while the current one is shown
+        uint16_t shownDelay = frameDelay;
+        if(!decodeFrame()) {
+            playing = false;
+            break;
+        }
+
+        // then hold it until the current frame has had its time
+        uint32_t elapsed = millis() - lastFrameMillis;
+        if(elapsed < shownDelay)
+            vTaskDelay(pdMS_TO_TICKS(shownDelay - elapsed));
+
+        // backpressure: with triple buffering, a frame refresh hasn't picked up yet would be replaced rather than shown
+        while(layer->isSwapPending() && !pipelineStopRequested)
+            vTaskDelay(1);
+
+        advanceFrameTime(shownDelay, millis());
+        layer->swapBuffers(true);
+    }
+    pipelineRunning = false;
+}
+#endif
+
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::decodeFrame(void) {
+    uint32_t startMicros = micros();
+    uint16_t rectCount;
+
+    if(!source)
+        return false;
+
+    if(frameIndex >= frameCount) {
+        if(!looping || !source->rewind(SM_ANIMATION_HEADER_SIZE))
+            return false;
+        chunkRemaining = 0;
+        frameIndex = 0;
+    }
+
+    if(!readUint16(frameDelay) || !readUint16(rectCount)) {
+        stats.errors++;
+        return false;
+    }
+
+    for(int i = 0; i < rectCount; i++) {
+        uint16_t x, y, w, h;
+        if(!readUint16(x) || !readUint16(y) || !readUint16(w) || !readUint16(h) || !decodeRect(x, y, w, h)) {
+            stats.errors++;
+            return false;
+        }
+    }
+
+    frameIndex++;
+    stats.frames++;
+    stats.lastDecodeMicros = micros() - startMicros;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::decodeRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    if(!w || !h || (uint32_t)x + w > width || (uint32_t)y + h > height)
+        return false;
+
+    uint32_t remaining = (uint32_t)w * h;
+    uint16_t row = y;
+    rowFill = 0;
+
+    while(remaining) {
+        uint8_t code;
+        if(!readBytes(&code, 1))
+            return false;
+
+        uint32_t count = (code & 0x7F) + 1;
+        if(count > remaining)
+            return false;
+        remaining -= count;
+
+        if(code & 0x80) {
+            uint8_t pixel[3];
+            if(!readBytes(pixel, pixelBytes))
+                return false;
+
+            while(count) {
+                uint16_t n = std::min<uint32_t>(count, w - rowFill);
+                uint8_t * dst = rowBuffer + rowFill * pixelBytes;
+                if(pixelBytes == 1) {
+                    memset(dst, pixel[0], n);
+                } else {
+                    for(int i = 0; i < n; i++, dst += pixelBytes)
+                        memcpy(dst, pixel, pixelBytes);
+                }
+                rowFill += n;
+                count -= n;
+                if(rowFill == w)
+                    flushRow(x, row++, w);
+            }
+        } else {
+            while(count) {
+                uint16_t n = std::min<uint32_t>(count, w - rowFill);
+
+                // a literal covering a whole row is drawn straight from the source, rgb16 rows need 2-byte alignment
+                const uint8_t * src = NULL;
+                if(!rowFill && n == w)
+                    src = readInPlace((size_t)n * pixelBytes);
+                if(src && pixelBytes == 2 && ((uintptr_t)src & 1)) {
+                    memcpy(rowBuffer, src, (size_t)n * pixelBytes);
+                    src = rowBuffer;
+                }
+
+                if(src) {
+                    layer->drawBitmap(x, row++, w, 1, src, format);
+                } else {
+                    if(!readBytes(rowBuffer + rowFill * pixelBytes, (size_t)n * pixelBytes))
+                        return false;
+                    rowFill += n;
+                    if(rowFill == w)
+                        flushRow(x, row++, w);
+                }
+                count -= n;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMAnimationPlayer<RGB, optionFlags>::flushRow(uint16_t x, uint16_t y, uint16_t w) {
+    layer->drawBitmap(x, y, w, 1, rowBuffer, format);
+    rowFill = 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::readBytes(uint8_t * dst, size_t count) {
+    while(count) {
+        if(!chunkRemaining) {
+            chunk = source->next(chunkRemaining);
+            if(!chunkRemaining)
+                return false;
+        }
+        size_t n = std::min(count, chunkRemaining);
+        memcpy(dst, chunk, n);
+        dst += n;
+        chunk += n;
+        chunkRemaining -= n;
+        count -= n;
+    }
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMAnimationPlayer<RGB, optionFlags>::readUint16(uint16_t &value) {
+    uint8_t bytes[2];
+    if(!readBytes(bytes, 2))
+        return false;
+    value = bytes[0] | (bytes[1] << 8);
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+const uint8_t * SMAnimationPlayer<RGB, optionFlags>::readInPlace(size_t count) {
+    if(!chunkRemaining)
+        chunk = source->next(chunkRemaining);
+    if(chunkRemaining < count)
+        return NULL;
+
+    const uint8_t * data = chunk;
+    chunk += count;
+    chunkRemaining -= count;
+    return data;
+}
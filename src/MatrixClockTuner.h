@@ -0,0 +1,89 @@
+/*
+ * SmartMatrix Library - Pixel Clock Tuner
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_CLOCK_TUNER_H_
+#define _MATRIX_CLOCK_TUNER_H_
+
+// Finds the fastest HUB75 pixel clock a Teensy 4 setup runs cleanly at.  Starting from the current divider, each step raises the
+// clock by one divider step (480 MHz / divider, dividers are even) and draws calibration patterns: alternating one pixel columns
+// toggle every data line at the pixel clock, which is the first thing to break on long cables or slow panels, with color bars,
+// gradients and a border to spot swapped or dropped lines.  The sketch reports what the panel looks like through confirm(), from a
+// button or a light sensor, and a step that isn't confirmed within stepTimeoutMs counts as unstable.  The first unstable step ends
+// tuning, the result is the last stable divider plus marginSteps steps of headroom, and it's applied with matrix.setPixelClockDivider()
+// which recalculates the row timing and refresh rate limits.
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.  Teensy 4 only, the ESP32 I2S clock is set when DMA is configured.
+//
+// store() saves the result to EEPROM, and load() applies a stored divider at startup, call it after matrix.begin():
+//   'S' 'C' divider(16-bit little endian) checksum(8-bit)
+
+#include "Layer_Background.h"
+
+#define SM_CLOCK_TUNER_RECORD_SIZE   5
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+class SMPixelClockTuner {
+    public:
+        SMPixelClockTuner(MATRIX * matrix, SMLayerBackground<RGB, optionFlags> * layer);
+        // call after matrix.begin(), stepTimeoutMs 0 waits for confirm() on every step
+        void begin(uint16_t stepTimeoutMs = 0, uint8_t marginSteps = 1);
+        // call from loop(), handles the step timeout, returns true while tuning
+        bool update(void);
+        // the panel looks right (or not) at the divider being tested
+        void confirm(bool stable);
+        // ends tuning early, keeping the last stable divider plus the margin
+        void finish(void);
+
+        bool isTuning(void) const { return tuning; };
+        uint16_t getTestDivider(void) const { return testDivider; };
+        // last divider confirmed stable, the starting divider if none were
+        uint16_t getStableDivider(void) const { return stableDivider; };
+        // divider applied when tuning finished
+        uint16_t getResult(void) const { return resultDivider; };
+
+        // EEPROM persistence, returns false where there's no EEPROM
+        bool store(int address) const;
+        static bool load(MATRIX * matrix, int address);
+
+    protected:
+        void startStep(uint16_t divider);
+        void drawPattern(void);
+        static uint8_t recordChecksum(uint16_t divider);
+
+        MATRIX * matrix;
+        SMLayerBackground<RGB, optionFlags> * layer;
+
+        bool tuning = false;
+        uint16_t stepTimeoutMs = 0;
+        uint8_t marginSteps = 1;
+        uint32_t stepStartMillis = 0;
+
+        uint16_t startDivider = 0;
+        uint16_t testDivider = 0;
+        uint16_t stableDivider = 0;
+        uint16_t resultDivider = 0;
+};
+
+#include "MatrixClockTuner_Impl.h"
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * SmartMatrix Library - Pixel Clock Tuner
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#if defined(__IMXRT1062__)
+#include <EEPROM.h>
+#endif
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+SMPixelClockTuner<MATRIX, RGB, optionFlags>::SMPixelClockTuner(MATRIX * matrix, SMLayerBackground<RGB, optionFlags> * layer) {
+    this->matrix = matrix;
+    this->layer = layer;
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+void SMPixelClockTuner<MATRIX, RGB, optionFlags>::begin(uint16_t stepTimeoutMs, uint8_t marginSteps) {
+    this->stepTimeoutMs = stepTimeoutMs;
+    this->marginSteps = marginSteps;
+
+    startDivider = matrix->getPixelClockDivider();
+    stableDivider = startDivider;
+    resultDivider = startDivider;
+    tuning = true;
+
+    drawPattern();
+    startStep(startDivider - 2);
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+void SMPixelClockTuner<MATRIX, RGB, optionFlags>::startStep(uint16_t divider) {
+    matrix->setPixelClockDivider(divider);
+
+    // the refresh clamps the divider, nothing faster left to try
+    if (matrix->getPixelClockDivider() >= stableDivider) {
+        finish();
+        return;
+    }
+
+    testDivider = matrix->getPixelClockDivider();
+    stepStartMillis = millis();
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+bool SMPixelClockTuner<MATRIX, RGB, optionFlags>::update(void) {
+    if (tuning && stepTimeoutMs && millis() - stepStartMillis >= stepTimeoutMs)
+        confirm(false);
+
+    return tuning;
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+void SMPixelClockTuner<MATRIX, RGB, optionFlags>::confirm(bool stable) {
+    if (!tuning)
+        return;
+
+    if (!stable) {
+        finish();
+        return;
+    }
+
+    stableDivider = testDivider;
+    startStep(testDivider - 2);
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+void SMPixelClockTuner<MATRIX, RGB, optionFlags>::finish(void) {
+    if (!tuning)
+        return;
+
+    // back off from the edge, but never slower than where we started
+    uint32_t divider = stableDivider + 2 * marginSteps;
+    if (divider > startDivider)
+        divider = startDivider;
+    if (divider < stableDivider)
+        divider = stableDivider;
+
+    matrix->setPixelClockDivider(divider);
+    resultDivider = matrix->getPixelClockDivider();
+    testDivider = resultDivider;
+    tuning = false;
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+void SMPixelClockTuner<MATRIX, RGB, optionFlags>::drawPattern(void) {
+    const rgb24 black(0, 0, 0);
+    const rgb24 white(0xff, 0xff, 0xff);
+    int16_t width = layer->getLocalWidth();
+    int16_t height = layer->getLocalHeight();
+
+    layer->fillScreen(black);
+
+    // top half: one pixel columns, every data line toggles each clock
+    for (int16_t x = 0; x < width; x += 2)
+        layer->drawFastVLine(x, 0, height / 2 - 1, white);
+
+    // bottom half: red, green and blue gradient bars above a white one, a missing bit or swapped line shows as a broken ramp
+    int16_t barHeight = (height - height / 2) / 4;
+    if (barHeight < 1)
+        barHeight = 1;
+    for (int16_t x = 0; x < width; x++) {
+        uint8_t level = (width > 1) ? (x * 0xff) / (width - 1) : 0xff;
+        int16_t y = height / 2;
+        layer->drawFastVLine(x, y, y + barHeight - 1, rgb24(level, 0, 0));
+        y += barHeight;
+        layer->drawFastVLine(x, y, y + barHeight - 1, rgb24(0, level, 0));
+        y += barHeight;
+        layer->drawFastVLine(x, y, y + barHeight - 1, rgb24(0, 0, level));
+        y += barHeight;
+        layer->drawFastVLine(x, y, height - 1, rgb24(level, level, level));
+    }
+
+    // the border shows the first and last pixels of each row are latched in the right place
+    layer->drawRectangle(0, 0, width - 1, height - 1, rgb24(0xff, 0, 0));
+
+    layer->swapBuffers(false);
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+uint8_t SMPixelClockTuner<MATRIX, RGB, optionFlags>::recordChecksum(uint16_t divider) {
+    return ~(uint8_t)('S' + 'C' + (divider & 0xff) + (divider >> 8));
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+bool SMPixelClockTuner<MATRIX, RGB, optionFlags>::store(int address) const {
+#if defined(__IMXRT1062__)
+    // update() skips bytes that haven't changed, saving flash wear when the result is stored every boot
+    EEPROM.update(address + 0, 'S');
+    EEPROM.update(address + 1, 'C');
+    EEPROM.update(address + 2, resultDivider & 0xff);
+    EEPROM.update(address + 3, resultDivider >> 8);
+    EEPROM.update(address + 4, recordChecksum(resultDivider));
+    return true;
+#else
+    return false;
+#endif
+}
+
+template <typename MATRIX, typename RGB, unsigned int optionFlags>
+bool SMPixelClockTuner<MATRIX, RGB, optionFlags>::load(MATRIX * matrix, int address) {
+#if defined(__IMXRT1062__)
+    if (EEPROM.read(address + 0) != 'S' || EEPROM.read(address + 1) != 'C')
+        return false;
+
+    uint16_t divider = EEPROM.read(address + 2) | (EEPROM.read(address + 3) << 8);
+    if (EEPROM.read(address + 4) != recordChecksum(divider))
+        return false;
+
+    matrix->setPixelClockDivider(divider);
+    return true;
+#else
+    return false;
+#endif
+}
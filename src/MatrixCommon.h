@@ -26,11 +26,18 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <string.h>
 
 #ifdef ARDUINO_ARCH_AVR
 #include "Arduino.h"
 #endif
 
+#if defined(ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#endif
+
 #if defined(__IMXRT1062__) // For Teensy 4.0/4.1, use PROGMEM to put LUT arrays into flash
   #define PROGMEM __attribute__((section(".progmem"))) // from <avr/pgmspace.h>
 #else
@@ -39,6 +46,8 @@
   #endif
 #endif
 
+#include "MatrixFlashSafe.h"
+
 // struct definitions for rgb24 and rgb48 with assignment operators
 // between them; adding rgb36 didn't seem to make sense because even when
 // packed with bitfields, it would only save 1 byte over rgb48.
@@ -48,43 +57,43 @@ struct rgb16;
 struct rgb24;
 struct rgb48;
 
-const uint8_t cs_scale2to5[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale2to5[] = {
   0, 10, 20, 31
 };
-const uint8_t cs_scale2to8[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale2to8[] = {
   0, 85, 170, 255
 };
-const uint8_t cs_scale3to5[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale3to5[] = {
   0, 4, 8, 13, 17, 22, 26, 31
 };
-const uint8_t cs_scale3to6[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale3to6[] = {
   0, 9, 18, 27, 36, 45, 54, 63
 };
-const uint8_t cs_scale3to8[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale3to8[] = {
   0, 36, 72, 109, 145, 182, 218, 255
 };
-const uint8_t cs_scale5to8[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale5to8[] = {
   0, 8, 16, 24, 32, 41, 49, 57, 65, 74, 82, 90, 98, 106, 115, 123, 131, 139, 148,
   156, 164, 172, 180, 189, 197, 205, 213, 222, 230, 238, 246, 255
 };
-const uint8_t cs_scale6to8[] = {
+const uint8_t SM_FLASH_SAFE_DRAM cs_scale6to8[] = {
   0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60, 64, 68, 72, 76, 80,
   85, 89, 93, 97, 101, 105, 109, 113, 117, 121, 125, 129, 133, 137, 141, 145, 149,
   153, 157, 161, 165, 170, 174, 178, 182, 186, 190, 194, 198, 202, 206, 210, 214,
   218, 222, 226, 230, 234, 238, 242, 246, 250, 255
 };
-const uint16_t cs_scale2to16[] = {
+const uint16_t SM_FLASH_SAFE_DRAM cs_scale2to16[] = {
   0, 21845, 43690, 65535
 };
-const uint16_t cs_scale3to16[] = {
+const uint16_t SM_FLASH_SAFE_DRAM cs_scale3to16[] = {
   0, 9362, 18724, 28086, 37448, 46810, 56172, 65535
 };
-const uint16_t cs_scale5to16[] = {
+const uint16_t SM_FLASH_SAFE_DRAM cs_scale5to16[] = {
   0, 2114, 4228, 6342, 8456, 10570, 12684, 14798, 16912, 19026, 21140, 23254, 25368,
   27482, 29596, 31710, 33824, 35938, 38052, 40166, 42280, 44394, 46508, 48622, 50736,
   52850, 54964, 57078, 59192, 61306, 63420, 65535
 };
-const uint16_t cs_scale6to16[] = {
+const uint16_t SM_FLASH_SAFE_DRAM cs_scale6to16[] = {
   0, 1040, 2080, 3120, 4160, 5201, 6241, 7281, 8321, 9362, 10402, 11442, 12482, 13523,
   14563, 15603, 16643, 17684, 18724, 19764, 20804, 21845, 22885, 23925, 24965, 26005, 27046,
   28086, 29126, 30166, 31207, 32247, 33287, 34327, 35368, 36408, 37448, 38488, 39529, 40569,
@@ -101,6 +110,7 @@ typedef struct rgb8 {  // RGB332
     rgb8& operator=(const rgb16& col);
     rgb8& operator=(const rgb24& col);
     rgb8& operator=(const rgb48& col);
+    bool operator==(const rgb8& col) const { return rgb == col.rgb; }
     rgb8( const rgb16& col );
     rgb8( const rgb24& col );
     rgb8( const rgb48& col );
@@ -124,7 +134,8 @@ typedef struct rgb16 { // RGB565
     rgb16& operator=(const rgb24& col);
     rgb16& operator=(const rgb48& col);
     rgb16& operator=(const uint16_t& col);
-    bool operator==(const rgb24& col);
+    bool operator==(const rgb24& col) const;
+    bool operator==(const rgb16& col) const { return rgb == col.rgb; }
 
     rgb16( const rgb8& col );
     rgb16( const rgb24& col );
@@ -177,6 +188,8 @@ typedef struct rgb48 {
     rgb48& operator=(const rgb8& col);
     rgb48& operator=(const rgb16& col);
     rgb48& operator=(const rgb24& col);
+    // declared because the copy constructor is user-provided, which deprecates the implicit one
+    rgb48& operator=(const rgb48& col) = default;
     bool operator==(const rgb48& col);
 
     rgb48 operator*(double d);
@@ -411,6 +424,304 @@ inline rgb48 rgb48::operator+(const rgb48 & other)
     return result;
 }
 
+// fixed-point blending, used by layers when compositing instead of the double operators above (no double FPU on Teensy 3 or ESP32)
+// alpha is 0-255 and is converted to an 8.8 weight (0-256), so alpha 255 returns the source exactly and alpha 0 returns the destination
+inline uint16_t blendAlphaToWeight(uint8_t alpha) {
+    return alpha + (alpha >> 7);
+}
+
+inline uint16_t blendChannel16(uint16_t dst, uint16_t src, uint16_t weight) {
+    return ((uint32_t)dst * (256 - weight) + (uint32_t)src * weight) >> 8;
+}
+
+// scale a color by an 8.8 weight, e.g. to premultiply a source once before blending it with blendRGBPremultiplied()
+inline rgb48 scaleRGB(const rgb48 & col, uint16_t weight) {
+    return rgb48(((uint32_t)col.red * weight) >> 8, ((uint32_t)col.green * weight) >> 8, ((uint32_t)col.blue * weight) >> 8);
+}
+
+inline rgb24 scaleRGB(const rgb24 & col, uint16_t weight) {
+    return rgb24((col.red * weight) >> 8, (col.green * weight) >> 8, (col.blue * weight) >> 8);
+}
+
+inline rgb48 blendRGB(const rgb48 & dst, const rgb48 & src, uint16_t weight) {
+    return rgb48(blendChannel16(dst.red, src.red, weight),
+        blendChannel16(dst.green, src.green, weight),
+        blendChannel16(dst.blue, src.blue, weight));
+}
+
+// red and blue are blended together in one 32-bit word (0x00RR00BB), then green on its own
+inline rgb24 blendRGB(const rgb24 & dst, const rgb24 & src, uint16_t weight) {
+    uint32_t dstRB = ((uint32_t)dst.red << 16) | dst.blue;
+    uint32_t srcRB = ((uint32_t)src.red << 16) | src.blue;
+    uint32_t rb = ((dstRB * (256 - weight) + srcRB * weight) >> 8) & 0x00FF00FF;
+    uint8_t g = (dst.green * (256 - weight) + src.green * weight) >> 8;
+    return rgb24(rb >> 16, g, rb & 0xFF);
+}
+
+// src has already been multiplied by weight (see scaleRGB()), so only dst needs to be scaled
+inline rgb48 blendRGBPremultiplied(const rgb48 & dst, const rgb48 & src, uint16_t weight) {
+    rgb48 result = scaleRGB(dst, 256 - weight);
+    return rgb48(std::min(0xFFFF, result.red + src.red),
+        std::min(0xFFFF, result.green + src.green),
+        std::min(0xFFFF, result.blue + src.blue));
+}
+
+inline rgb24 blendRGBPremultiplied(const rgb24 & dst, const rgb24 & src, uint16_t weight) {
+    rgb24 result = scaleRGB(dst, 256 - weight);
+    return rgb24(std::min(0xFF, result.red + src.red),
+        std::min(0xFF, result.green + src.green),
+        std::min(0xFF, result.blue + src.blue));
+}
+
+// how a layer combines its pixels with the lower layers, see SM_Layer::setBlendMode()
+typedef enum smBlendMode {
+    smBlendReplace = 0,
+    smBlendAdd = 1,
+    smBlendSubtract = 2,
+    smBlendMultiply = 3,
+    smBlendScreen = 4
+} smBlendMode;
+
+// saturating add/subtract of packed channels: Cortex-M4/M7 do all channels of a word in one instruction, other targets (ESP32) one
+// channel at a time.  rgb24 packs 0x00BBGGRR into one word, rgb48 packs 0xGGGGRRRR into one word and blue on its own
+#if defined(__ARM_FEATURE_DSP)
+inline uint32_t smUqadd8(uint32_t a, uint32_t b) { uint32_t result; __asm__ ("uqadd8 %0, %1, %2" : "=r" (result) : "r" (a), "r" (b)); return result; }
+inline uint32_t smUqsub8(uint32_t a, uint32_t b) { uint32_t result; __asm__ ("uqsub8 %0, %1, %2" : "=r" (result) : "r" (a), "r" (b)); return result; }
+inline uint32_t smUqadd16(uint32_t a, uint32_t b) { uint32_t result; __asm__ ("uqadd16 %0, %1, %2" : "=r" (result) : "r" (a), "r" (b)); return result; }
+inline uint32_t smUqsub16(uint32_t a, uint32_t b) { uint32_t result; __asm__ ("uqsub16 %0, %1, %2" : "=r" (result) : "r" (a), "r" (b)); return result; }
+#endif
+
+inline rgb24 addRGBSaturating(const rgb24 & dst, const rgb24 & src) {
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t sum = smUqadd8(dst.red | (dst.green << 8) | (dst.blue << 16), src.red | (src.green << 8) | (src.blue << 16));
+    return rgb24(sum & 0xFF, (sum >> 8) & 0xFF, sum >> 16);
+#else
+    return rgb24(std::min(0xFF, dst.red + src.red),
+        std::min(0xFF, dst.green + src.green),
+        std::min(0xFF, dst.blue + src.blue));
+#endif
+}
+
+inline rgb48 addRGBSaturating(const rgb48 & dst, const rgb48 & src) {
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t sum = smUqadd16(dst.red | ((uint32_t)dst.green << 16), src.red | ((uint32_t)src.green << 16));
+    return rgb48(sum & 0xFFFF, sum >> 16, smUqadd16(dst.blue, src.blue));
+#else
+    return rgb48(std::min(0xFFFF, dst.red + src.red),
+        std::min(0xFFFF, dst.green + src.green),
+        std::min(0xFFFF, dst.blue + src.blue));
+#endif
+}
+
+inline rgb24 subtractRGBSaturating(const rgb24 & dst, const rgb24 & src) {
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t difference = smUqsub8(dst.red | (dst.green << 8) | (dst.blue << 16), src.red | (src.green << 8) | (src.blue << 16));
+    return rgb24(difference & 0xFF, (difference >> 8) & 0xFF, difference >> 16);
+#else
+    return rgb24(std::max(0, dst.red - src.red),
+        std::max(0, dst.green - src.green),
+        std::max(0, dst.blue - src.blue));
+#endif
+}
+
+inline rgb48 subtractRGBSaturating(const rgb48 & dst, const rgb48 & src) {
+#if defined(__ARM_FEATURE_DSP)
+    uint32_t difference = smUqsub16(dst.red | ((uint32_t)dst.green << 16), src.red | ((uint32_t)src.green << 16));
+    return rgb48(difference & 0xFFFF, difference >> 16, smUqsub16(dst.blue, src.blue));
+#else
+    return rgb48(std::max(0, dst.red - src.red),
+        std::max(0, dst.green - src.green),
+        std::max(0, dst.blue - src.blue));
+#endif
+}
+
+// a * b / max, rounded, without a divide
+inline uint8_t multiplyChannel8(uint8_t a, uint8_t b) {
+    uint32_t product = (uint32_t)a * b + 0x80;
+    return (product + (product >> 8)) >> 8;
+}
+
+inline uint16_t multiplyChannel16(uint16_t a, uint16_t b) {
+    uint32_t product = (uint32_t)a * b + 0x8000;
+    return (product + (product >> 16)) >> 16;
+}
+
+inline rgb24 multiplyRGB(const rgb24 & dst, const rgb24 & src) {
+    return rgb24(multiplyChannel8(dst.red, src.red), multiplyChannel8(dst.green, src.green), multiplyChannel8(dst.blue, src.blue));
+}
+
+inline rgb48 multiplyRGB(const rgb48 & dst, const rgb48 & src) {
+    return rgb48(multiplyChannel16(dst.red, src.red), multiplyChannel16(dst.green, src.green), multiplyChannel16(dst.blue, src.blue));
+}
+
+// dst + src - dst * src, never more than max so it doesn't need to saturate
+inline rgb24 screenRGB(const rgb24 & dst, const rgb24 & src) {
+    return rgb24(dst.red + src.red - multiplyChannel8(dst.red, src.red),
+        dst.green + src.green - multiplyChannel8(dst.green, src.green),
+        dst.blue + src.blue - multiplyChannel8(dst.blue, src.blue));
+}
+
+inline rgb48 screenRGB(const rgb48 & dst, const rgb48 & src) {
+    return rgb48(dst.red + src.red - multiplyChannel16(dst.red, src.red),
+        dst.green + src.green - multiplyChannel16(dst.green, src.green),
+        dst.blue + src.blue - multiplyChannel16(dst.blue, src.blue));
+}
+
+// combines a layer pixel (src) with what the lower layers drew (dst)
+template <typename RGB_OUT>
+inline RGB_OUT blendRGBMode(const RGB_OUT & dst, const RGB_OUT & src, smBlendMode mode) {
+    switch(mode) {
+        case smBlendAdd:
+            return addRGBSaturating(dst, src);
+        case smBlendSubtract:
+            return subtractRGBSaturating(dst, src);
+        case smBlendMultiply:
+            return multiplyRGB(dst, src);
+        case smBlendScreen:
+            return screenRGB(dst, src);
+        default:
+            return src;
+    }
+}
+
+// the same at an 8.8 weight (layer brightness): add, subtract and screen scale src by weight first, multiply fades from dst to dst * src
+template <typename RGB_OUT>
+inline RGB_OUT blendRGBModeWeighted(const RGB_OUT & dst, const RGB_OUT & src, smBlendMode mode, uint16_t weight) {
+    if(mode == smBlendReplace)
+        return (weight >= 256) ? src : blendRGB(dst, src, weight);
+    if(mode == smBlendMultiply)
+        return (weight >= 256) ? multiplyRGB(dst, src) : blendRGB(dst, multiplyRGB(dst, src), weight);
+    return blendRGBMode(dst, (weight >= 256) ? src : scaleRGB(src, weight), mode);
+}
+
+// word type that may alias any pixel type, for the wide stores in fillRGB()
+typedef uint32_t __attribute__((__may_alias__)) sm_alias_uint32_t;
+// and for the channels of rgb48 pixels
+typedef uint16_t __attribute__((__may_alias__)) sm_alias_uint16_t;
+
+// fill count pixels with color, storing three 32-bit words at a time once dst is word aligned
+// 12 bytes holds a whole number of rgb8, rgb16, rgb24 and rgb48 pixels, so the same three words repeat for the whole run
+template <typename RGB>
+inline void fillRGB(RGB * dst, uint32_t count, const RGB & color) {
+    const uint32_t pixelsPerPattern = 12 / sizeof(RGB);
+
+    while(count && ((uint32_t)(uintptr_t)dst & 3)) {
+        *dst++ = color;
+        count--;
+    }
+
+    if(count >= pixelsPerPattern) {
+        RGB patternPixels[pixelsPerPattern];
+        for(uint32_t i=0; i<pixelsPerPattern; i++)
+            patternPixels[i] = color;
+
+        uint32_t pattern[3];
+        memcpy(pattern, patternPixels, sizeof(pattern));
+
+        sm_alias_uint32_t * wordPtr = (sm_alias_uint32_t *)dst;
+        for(; count >= pixelsPerPattern; count -= pixelsPerPattern) {
+            wordPtr[0] = pattern[0];
+            wordPtr[1] = pattern[1];
+            wordPtr[2] = pattern[2];
+            wordPtr += 3;
+        }
+        dst = (RGB *)wordPtr;
+    }
+
+    while(count--)
+        *dst++ = color;
+}
+
+// four 8-bit channels scaled by an 8.8 weight (0-256) in one word, the even and odd bytes are multiplied separately so they can't carry into each other
+inline uint32_t scaleChannels8x4(uint32_t word, uint16_t weight) {
+    uint32_t evenBytes = (((word & 0x00FF00FF) * weight) >> 8) & 0x00FF00FF;
+    uint32_t oddBytes = (((word >> 8) & 0x00FF00FF) * weight) & 0xFF00FF00;
+    return evenBytes | oddBytes;
+}
+
+// four 8-bit channels added with saturation in one word, the portable version adds the low 7 bits of each byte and fixes up the top bit
+inline uint32_t addChannels8x4Saturating(uint32_t a, uint32_t b) {
+#if defined(__ARM_FEATURE_DSP)
+    return smUqadd8(a, b);
+#else
+    uint32_t low = (a & 0x7F7F7F7F) + (b & 0x7F7F7F7F);
+    uint32_t overflow = ((a & b) | (low & (a | b))) & 0x80808080;
+    return (low & 0x7F7F7F7F) | ((a ^ b ^ low) & 0x80808080) | ((overflow >> 7) * 0xFF);
+#endif
+}
+
+// scale count 8-bit channels (e.g. the bytes of an rgb24 buffer) by an 8.8 weight, a word at a time once channels is word aligned
+inline void scaleChannels8(uint8_t * channels, uint32_t count, uint16_t weight) {
+    while(count && ((uint32_t)(uintptr_t)channels & 3)) {
+        *channels = (*channels * weight) >> 8;
+        channels++;
+        count--;
+    }
+
+    sm_alias_uint32_t * wordPtr = (sm_alias_uint32_t *)channels;
+    for(; count >= 4; count -= 4, wordPtr++)
+        *wordPtr = scaleChannels8x4(*wordPtr, weight);
+    channels = (uint8_t *)wordPtr;
+
+    while(count--) {
+        *channels = (*channels * weight) >> 8;
+        channels++;
+    }
+}
+
+// dst = dst + src * weight (8.8) with saturation for count 8-bit channels, src doesn't need to have the same word alignment as dst
+inline void addScaledChannels8(uint8_t * dst, const uint8_t * src, uint32_t count, uint16_t weight) {
+    while(count && ((uint32_t)(uintptr_t)dst & 3)) {
+        *dst = std::min(0xFF, *dst + ((*src * weight) >> 8));
+        dst++;
+        src++;
+        count--;
+    }
+
+    sm_alias_uint32_t * wordPtr = (sm_alias_uint32_t *)dst;
+    for(; count >= 4; count -= 4, wordPtr++, src += 4) {
+        uint32_t srcWord;
+        memcpy(&srcWord, src, sizeof(srcWord));
+        *wordPtr = addChannels8x4Saturating(*wordPtr, scaleChannels8x4(srcWord, weight));
+    }
+    dst = (uint8_t *)wordPtr;
+
+    while(count--) {
+        *dst = std::min(0xFF, *dst + ((*src * weight) >> 8));
+        dst++;
+        src++;
+    }
+}
+
+// ordered temporal dithering: a 4x4 Bayer pattern that moves to the next of its 16 positions every frame,
+// so each pixel sees every threshold once per 16 frames and the dropped low bits average out over time
+const uint8_t cs_ditherBayer4x4[16] = {
+  0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5
+};
+
+// adds the frame's threshold for row y to the bits below the top keptBits of each channel, saturating at full scale
+template <typename RGB>
+inline void ditherRGB(RGB row[], int count, int y, unsigned int frame, int keptBits) {
+    const int channelBits = sizeof(row[0].red) * 8;
+    const uint32_t fullScale = (1UL << channelBits) - 1;
+    const int droppedBits = channelBits - keptBits;
+    if(droppedBits <= 0)
+        return;
+
+    // the pattern repeats every 4 columns, so only four thresholds are needed per row, centered in the range of the dropped bits
+    const uint8_t * patternRow = &cs_ditherBayer4x4[((y + (frame >> 2)) & 3) * 4];
+    uint32_t thresholds[4];
+    for(int i=0; i<4; i++)
+        thresholds[i] = ((patternRow[(i + frame) & 3] * 2 + 1) << droppedBits) >> 5;
+
+    for(int x=0; x<count; x++) {
+        uint32_t t = thresholds[x & 3];
+        row[x].red = std::min<uint32_t>(fullScale, row[x].red + t);
+        row[x].green = std::min<uint32_t>(fullScale, row[x].green + t);
+        row[x].blue = std::min<uint32_t>(fullScale, row[x].blue + t);
+    }
+}
+
 inline rgb48::rgb48(const rgb8& col) {
     red =   cs_scale3to16[col.red];     // 3 -> 16
     green = cs_scale3to16[col.green];   // 3 -> 16
@@ -443,7 +754,7 @@ inline rgb48::rgb48(const rgb48& col) {
 #define color_chan_t uint16_t
 
 // source - somewhere on the internet (arduino forum?)
-static const PROGMEM uint8_t lightPowerMap8bit[256] = {
+static const PROGMEM SM_FLASH_SAFE_DRAM uint8_t lightPowerMap8bit[256] = {
     0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2,
     2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
     4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6,
@@ -466,7 +777,7 @@ static const PROGMEM uint8_t lightPowerMap8bit[256] = {
 // generated by adafruit utility included with matrix library
 // https://github.com/adafruit/RGB-matrix-Panel/blob/master/extras/gamma.c
 // options: planes = 16 and GAMMA = 2.5
-static const PROGMEM uint16_t lightPowerMap16bit[] = {
+static const PROGMEM SM_FLASH_SAFE_DRAM uint16_t lightPowerMap16bit[] = {
     0x00, 0x00, 0x00, 0x01, 0x02, 0x04, 0x06, 0x08,
     0x0b, 0x0f, 0x14, 0x19, 0x1f, 0x26, 0x2e, 0x37,
     0x41, 0x4b, 0x57, 0x63, 0x71, 0x80, 0x8f, 0xa0,
@@ -502,7 +813,7 @@ static const PROGMEM uint16_t lightPowerMap16bit[] = {
 };
 
 // adafruit matrix library
-static const PROGMEM uint8_t lightPowerMap4bit[256] = {
+static const PROGMEM SM_FLASH_SAFE_DRAM uint8_t lightPowerMap4bit[256] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -540,7 +851,7 @@ static const PROGMEM uint8_t lightPowerMap4bit[256] = {
 // Created with modified gamma.c utility (GAMMA=2.5, planes=16, tableSize=4096)
 // https://gist.github.com/embedded-creations/c2f6707af52de1c8e777b41e67265a58
 // This table takes a 12-bit intensity and maps it to a 16-bit gamma corrected value
-static const PROGMEM uint16_t lightPowerMap12to16bit[4096] = {
+static const PROGMEM SM_FLASH_SAFE_DRAM uint16_t lightPowerMap12to16bit[4096] = {
       0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,
       0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,
       0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,0x0000,
@@ -1055,19 +1366,43 @@ static const PROGMEM uint16_t lightPowerMap12to16bit[4096] = {
       0xfebf,0xfee7,0xff0f,0xff37,0xff5f,0xff87,0xffaf,0xffd7
 };
 
-inline void calculate8BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness) {
+// number of color_chan_t entries needed for a background layer's color correction LUT, with perChannel set there's a separate table for red, green, and blue
+#define SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(RGB, perChannel)    ((sizeof(RGB) <= 3 ? 256 : 4096) * ((perChannel) ? 3 : 1))
+
+// channelGain scales the table for white balance (255 = no change)
+// brightnessShifts is applied while building the table, so it's indexed with the unshifted 8-bit value
+inline void calculate8BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness, uint8_t channelGain = 255, int brightnessShifts = 0) {
     // update background table
     for(int i=0; i<256; i++)
-        lut[i] = (lightPowerMap16bit[i] * backgroundBrightness) / 256;
+        lut[i] = ((uint32_t)lightPowerMap16bit[std::min(255, i << brightnessShifts)] * backgroundBrightness * (channelGain + 1)) / 65536;
+}
+
+// table for one rgb8/rgb16 channel, indexed directly by the stored 2-6 bit value: expandTo8 (one of the cs_scaleNto8 tables) converts it to 8 bits before gamma
+inline void calculateNarrowBackgroundLUT(color_chan_t * lut, const uint8_t * expandTo8, int numEntries, uint8_t backgroundBrightness, uint8_t channelGain = 255, int brightnessShifts = 0) {
+    for(int i=0; i<numEntries; i++)
+        lut[i] = ((uint32_t)lightPowerMap16bit[std::min(255, expandTo8[i] << brightnessShifts)] * backgroundBrightness * (channelGain + 1)) / 65536;
 }
 
 // We use a 12-bit gamma correction table for RGB48, even though there's 16 bits per pixel - a 16-bit table would take up too much RAM and CPU
-inline void calculate12BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness) {
+// full brightness and gain give lightPowerMap12to16bit unchanged, so layers sharing tables can use it directly
+inline void calculate12BitBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness, uint8_t channelGain = 255) {
+    uint32_t weight = blendAlphaToWeight(backgroundBrightness) * blendAlphaToWeight(channelGain);
+
     // update background table
     for(int i=0; i<4096; i++)
-        lut[i] = (lightPowerMap12to16bit[i] * backgroundBrightness) / 256;
+        lut[i] = ((uint32_t)lightPowerMap12to16bit[i] * weight) / 65536;
 }
 
+// 12-bit tables for SM_BACKGROUND_OPTIONS_SHARED_LUT layers: one table per brightness and gain in use, freed when the last layer releases it
+// full brightness and gain return the const lightPowerMap12to16bit table and use no RAM; call from the sketch only, new tables are malloc'd
+// each layer holds the set refresh uses and the set queued for the next frame, up to 6 tables with white balance; combinations
+// beyond SM_SHARED_LUT_MAX_TABLES get a private table, which works the same but isn't shared
+#ifndef SM_SHARED_LUT_MAX_TABLES
+#define SM_SHARED_LUT_MAX_TABLES    4
+#endif
+const color_chan_t * smAcquireShared12BitLUT(uint8_t backgroundBrightness, uint8_t channelGain);
+void smReleaseShared12BitLUT(const color_chan_t * lut);
+
 template <typename RGB_IN>
 void colorCorrection(const RGB_IN& in, rgb48& out) {
     out.red = lightPowerMap16bit[in.red];
@@ -1102,6 +1437,290 @@ typedef enum ScrollMode {
     wrapForwardFromLeft = 5
 } ScrollMode;
 
+// called once per frame after the layers' frameRefreshCallback(), so a buffer swapped for this frame has already been taken by the refresh
+// Teensy: runs in the refresh ISR, ESP32: runs in the calc task; keep it short either way
+typedef void (*smFrameCallback)(uint32_t frameCount);
+
+#define SM_FRAME_EVENT_BIT      (1 << 0)
+
+// frame counter and frame-completion signals shared by the calc classes: signal() is called by the calc once per frame
+struct smFrameEvents {
+    // counts frames since begin(), wraps after 2^32 frames
+    volatile uint32_t frameCount = 0;
+    smFrameCallback callback = NULL;
+#if defined(ESP32)
+    // SM_FRAME_EVENT_BIT is set every frame, for sketches that want to wait on it together with their own bits
+    EventGroupHandle_t eventGroup = NULL;
+    // gets an xTaskNotifyGive() every frame, so a drawing task can block in ulTaskNotifyTake()
+    TaskHandle_t volatile notifyTask = NULL;
+
+    void begin(void) {
+        if(!eventGroup)
+            eventGroup = xEventGroupCreate();
+    }
+#else
+    void begin(void) {}
+#endif
+
+    void SM_FLASH_SAFE_IRAM signal(void) {
+        frameCount++;
+        if(callback)
+            callback(frameCount);
+#if defined(ESP32)
+        if(eventGroup)
+            xEventGroupSetBits(eventGroup, SM_FRAME_EVENT_BIT);
+        TaskHandle_t task = notifyTask;
+        if(task)
+            xTaskNotifyGive(task);
+#endif
+    }
+
+    // blocks until the next frame after the call completes, returns false on timeout
+    bool wait(uint32_t timeoutMs) {
+        uint32_t startFrame = frameCount;
+        uint32_t startMillis = millis();
+        while(frameCount == startFrame) {
+            uint32_t elapsed = millis() - startMillis;
+            if(elapsed >= timeoutMs)
+                return false;
+#if defined(ESP32)
+            // the bit may be left over from a frame before the call, the loop checks frameCount again and waits for the rest of the timeout
+            if(eventGroup)
+                xEventGroupWaitBits(eventGroup, SM_FRAME_EVENT_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMs - elapsed) + 1);
+            else
+                vTaskDelay(1);
+#else
+            // sleep until the next interrupt, the refresh interrupts wake the core many times per frame
+            yield();
+            asm volatile("wfi");
+#endif
+        }
+        return true;
+    }
+};
+
+// width of the sync output pulse: back to back digitalWrite() calls can make a pulse of well under a microsecond, too short for a
+// follower's edge interrupt to see reliably through a long wire
+#ifndef SM_FRAME_SYNC_PULSE_MICROS
+#define SM_FRAME_SYNC_PULSE_MICROS  1
+#endif
+
+#if defined(ESP32)
+#define SM_FRAME_SYNC_ISR_ATTR  IRAM_ATTR
+#else
+#define SM_FRAME_SYNC_ISR_ATTR
+#endif
+
+// lines up frames across several controllers driving one display: the master pulses an output pin at every frame start, the
+// others only start a frame (run the layers' frameRefreshCallback(), taking any pending swapBuffers()) after a pulse arrives.
+// A pulse can also come over the network, by calling pulse() when the master's frame message is received (send it from the
+// master's frame callback).  Without pulses for timeoutMicros, frames run free again so a lost master doesn't freeze the display.
+struct smFrameSync {
+    int8_t outputPin = -1;
+    int8_t inputPin = -1;
+    uint32_t timeoutMicros = 100000;
+
+    volatile uint32_t pulseCount = 0;
+    volatile uint32_t lastPulseMicros = 0;
+    uint32_t pulsesTaken = 0;
+    uint32_t lastFrameMicros = 0;
+    // microseconds from the pulse to the frame start that took it, the time this board trails the master
+    volatile int32_t drift = 0;
+    // pulses that arrived while a frame was still running, frames this board fell behind by
+    volatile uint32_t missedPulses = 0;
+
+    static smFrameSync *& inputInstance(void) {
+        static smFrameSync * instance = NULL;
+        return instance;
+    }
+
+    static void SM_FRAME_SYNC_ISR_ATTR inputISR(void) {
+        if(inputInstance())
+            inputInstance()->pulse();
+    }
+
+    void setOutput(int8_t pin) {
+        outputPin = pin;
+        if(pin >= 0) {
+            pinMode(pin, OUTPUT);
+            digitalWrite(pin, LOW);
+        }
+    }
+
+    void setInput(int8_t pin) {
+        if(inputPin >= 0)
+            detachInterrupt(digitalPinToInterrupt(inputPin));
+        inputPin = pin;
+        if(pin >= 0) {
+            inputInstance() = this;
+            pinMode(pin, INPUT);
+            attachInterrupt(digitalPinToInterrupt(pin), inputISR, RISING);
+        }
+    }
+
+    void SM_FRAME_SYNC_ISR_ATTR pulse(void) {
+        lastPulseMicros = micros();
+        pulseCount++;
+    }
+
+    bool SM_FLASH_SAFE_IRAM isFollowing(void) {
+        return (inputPin >= 0) || pulseCount;
+    }
+
+    // called by the calc at each frame start, returns false to hold the current frame until the next pulse
+    bool SM_FLASH_SAFE_IRAM frameStart(void) {
+        uint32_t now = micros();
+
+        if(isFollowing()) {
+            uint32_t pulses = pulseCount;
+            if(pulses == pulsesTaken) {
+                // without a master for timeoutMicros, run free
+                if(now - lastFrameMicros < timeoutMicros)
+                    return false;
+            } else {
+                missedPulses += pulses - pulsesTaken - 1;
+                pulsesTaken = pulses;
+                drift = now - lastPulseMicros;
+            }
+            lastFrameMicros = now;
+        }
+
+        // a follower can pass the pulse down a chain of boards
+        if(outputPin >= 0) {
+            digitalWrite(outputPin, HIGH);
+            delayMicroseconds(SM_FRAME_SYNC_PULSE_MICROS);
+            digitalWrite(outputPin, LOW);
+        }
+        return true;
+    }
+};
+
+// pixels in a readback buffer for setReadbackBuffer(), (width >> scaleShift) * (height >> scaleShift)
+#define SM_READBACK_BUFFER_PIXELS(width, height, scaleShift)    (((width) >> (scaleShift)) * ((height) >> (scaleShift)))
+
+// setReadbackBuffer(): the calc copies the composited rows of every intervalFrames-th frame into an rgb16 buffer as it fills them,
+// keeping every (1 << scaleShift)th pixel of every (1 << scaleShift)th row, in hardware orientation (as on the panels, not rotated)
+struct smReadbackTap {
+    struct geometry {
+        rgb16 * buffer;
+        uint16_t width;
+        uint8_t scaleShift;
+        uint16_t intervalFrames;
+    };
+    // written by setBuffer(), the sequence is odd while it's being written
+    geometry pending = {NULL, 0, 0, 1};
+    volatile uint32_t pendingSequence = 0;
+    // the calc's copy of pending, taken at the start of a frame
+    geometry current = {NULL, 0, 0, 1};
+    uint32_t currentSequence = 0;
+    uint16_t framesToNext = 0;
+    bool capturing = false;
+    // a new buffer is filled by a full frame, the ESP32 calc otherwise only fills the rows that changed
+    bool fullFrameNeeded = false;
+    // rows were packed in frames that weren't captured, so the next captured frame has to be full
+    bool packedSinceCapture = false;
+    // counts frames fully written to the buffer
+    volatile uint32_t framesCaptured = 0;
+
+    // called from the sketch, the calc stops writing to the old buffer before the next row, and starts on the new one at a frame start
+    void setBuffer(rgb16 * newBuffer, uint16_t matrixWidth, uint8_t newScaleShift, uint16_t newIntervalFrames) {
+        pendingSequence = pendingSequence + 1;
+        __sync_synchronize();
+        pending.buffer = newBuffer;
+        pending.width = matrixWidth >> newScaleShift;
+        pending.scaleShift = newScaleShift;
+        pending.intervalFrames = newIntervalFrames ? newIntervalFrames : 1;
+        __sync_synchronize();
+        pendingSequence = pendingSequence + 1;
+    }
+
+    // called by the calc at the start of each frame, true if the rows filled for this frame are captured
+    bool SM_FLASH_SAFE_IRAM startFrame(void) {
+        if(capturing) {
+            capturing = false;
+            fullFrameNeeded = false;
+            framesCaptured++;
+        }
+
+        uint32_t sequence = pendingSequence;
+        if(sequence != currentSequence) {
+            current.buffer = NULL;
+            // a setBuffer() still in progress, or one that overlapped the copy, is taken at a later frame
+            if(!(sequence & 1)) {
+                __sync_synchronize();
+                geometry copy = pending;
+                __sync_synchronize();
+                if(pendingSequence == sequence) {
+                    current = copy;
+                    currentSequence = sequence;
+                    framesToNext = 0;
+                    fullFrameNeeded = true;
+                }
+            }
+        }
+
+        if(!current.buffer)
+            return false;
+        if(framesToNext) {
+            framesToNext--;
+            return false;
+        }
+        framesToNext = current.intervalFrames - 1;
+        capturing = true;
+        if(packedSinceCapture)
+            fullFrameNeeded = true;
+        packedSinceCapture = false;
+        return true;
+    }
+
+    // called by a calc that doesn't pack every row of every frame (ESP32, Teensy 4 frame replay), for each frame it packs
+    void SM_FLASH_SAFE_IRAM framePacked(void) {
+        if(!capturing)
+            packedSinceCapture = true;
+    }
+
+    // row is the composited hardware row y, matrixWidth pixels, with values shifted down by brightnessShifts (ESP32)
+    template <typename RGB>
+    void SM_FLASH_SAFE_IRAM captureRow(int y, const RGB * row, int brightnessShifts = 0) {
+        rgb16 * dst = current.buffer;
+        const uint8_t scaleShift = current.scaleShift;
+        const uint16_t width = current.width;
+        if(!dst || pendingSequence != currentSequence || (y & ((1 << scaleShift) - 1)))
+            return;
+
+        dst += (y >> scaleShift) * width;
+        for(int x = 0; x < width; x++) {
+            if(brightnessShifts) {
+                rgb48 color = row[x << scaleShift];
+                color.red <<= brightnessShifts;
+                color.green <<= brightnessShifts;
+                color.blue <<= brightnessShifts;
+                dst[x] = color;
+            } else {
+                dst[x] = row[x << scaleShift];
+            }
+        }
+    }
+};
+
+// per-panel calibration for setPanelGain(): scales each panelWidth wide segment of a composited row by its panel's channel gains,
+// gains has one entry per panel across the row, 255 = no change
+template <typename RGB>
+inline void SM_FLASH_SAFE_IRAM applyPanelGains(RGB * row, int rowWidth, int panelWidth, const rgb24 * gains) {
+    for(int x = 0; x < rowWidth; x += panelWidth, gains++) {
+        const uint32_t r = gains->red + 1, g = gains->green + 1, b = gains->blue + 1;
+        if(r == 256 && g == 256 && b == 256)
+            continue;
+
+        const int end = (x + panelWidth < rowWidth) ? x + panelWidth : rowWidth;
+        for(int i = x; i < end; i++) {
+            row[i].red = (row[i].red * r) >> 8;
+            row[i].green = (row[i].green * g) >> 8;
+            row[i].blue = (row[i].blue * b) >> 8;
+        }
+    }
+}
+
 #ifndef SWAPint
 #define SWAPint(X,Y) { \
         int temp = X ; \
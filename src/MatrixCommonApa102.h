@@ -29,7 +29,10 @@
 #define SM_APA102_OPTIONS_GBC_MODE_SIMPLE      (0x1 << 0)
 #define SM_APA102_OPTIONS_GBC_MODE_NONE        (0x2 << 0)
 #define SM_APA102_OPTIONS_GBC_MODE_BRIGHTONLY  (0x3 << 0)
-#define SM_APA102_OPTIONS_GBC_MODE_MASK        (0x3 << 0)
+// each LED's 16-bit color (with setBrightness() applied) is split into the smallest GBC that fits it and 8-bit color, so dark colors
+// and low brightness keep all 8 bits of color, the mode is an extension bit past the color order and lanes fields
+#define SM_APA102_OPTIONS_GBC_MODE_SPLIT       (0x1 << 8)
+#define SM_APA102_OPTIONS_GBC_MODE_MASK        ((0x3 << 0) | (0x1 << 8))
 
 #define SM_APA102_OPTIONS_COLOR_ORDER_BGR      (0x0 << 2)
 #define SM_APA102_OPTIONS_COLOR_ORDER_RBG      (0x1 << 2)
@@ -39,4 +42,11 @@
 #define SM_APA102_OPTIONS_COLOR_ORDER_BRG      (0x5 << 2)
 #define SM_APA102_OPTIONS_COLOR_ORDER_MASK     (0x7 << 2)
 
+// Teensy 4 only: split the frame across 1-8 data lanes sharing one clock, pins are listed in FLEXIO_PIN_APA102_DAT_LANES
+// LEDs are split into equal runs, the first run on the first lane, lanes after the first start where the previous lane's run ends
+// 3 lanes are sent 4 bits wide and 5-7 lanes 8 bits wide, all lane pins must fit in a window of that many FlexIO pins
+#define SM_APA102_OPTIONS_LANES_SHIFT          5
+#define SM_APA102_OPTIONS_LANES(n)             ((((n) - 1) & 0x7) << SM_APA102_OPTIONS_LANES_SHIFT)
+#define SM_APA102_OPTIONS_LANES_MASK           (0x7 << SM_APA102_OPTIONS_LANES_SHIFT)
+
 #endif
\ No newline at end of file
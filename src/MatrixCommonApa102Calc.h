@@ -35,12 +35,20 @@ public:
     SmartMatrixApaCalc(uint8_t bufferrows = 0, frameDataStruct * rowDataBuffer = NULL);
     void begin(void);
     void addLayer(SM_Layer * newlayer);
+    // layers can be changed while refreshing, refresh picks up the new set at the start of the next frame, see smLayerChain
+    void removeLayer(SM_Layer * layer);
+    // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+    void moveLayer(SM_Layer * layer, SM_Layer * belowLayer);
+    void setLayerVisible(SM_Layer * layer, bool visible);
 
     // configuration
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
     void setRefreshRate(uint8_t newRefreshRate);
     void setSpiClockSpeed(uint32_t newClockSpeed);
+    // frames where no layer changed aren't packed or sent, as APA102 LEDs hold the last frame sent, keepAliveMs > 0 still resends
+    // the frame at least that often, so LEDs that lost their data to noise or a glitch on the supply recover
+    void setSkipUnchangedFrames(bool enabled, uint16_t keepAliveMs = 0);
 
     // get info
     uint16_t getScreenWidth(void) const;
@@ -49,6 +57,25 @@ public:
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
 
+    // frame events, a frame is counted each time the layers get their frameRefreshCallback()
+    void setFrameCallback(smFrameCallback callback);
+    uint32_t getFrameCount(void);
+    // sleeps until the next frame starts (a pending swapBuffers() has been taken), returns false after timeoutMs
+    bool waitForFrame(uint32_t timeoutMs);
+    // multi-controller frame sync, see smFrameSync: the master pulses an output pin at every frame start (-1 to stop), the
+    // others hold their frames for a pulse on an input pin, or for frameSyncPulse() calls from a network sync message
+    void setFrameSyncOutput(int8_t pin);
+    void setFrameSyncInput(int8_t pin);
+    void frameSyncPulse(void);
+    // microseconds this board's last frame started after the master's pulse, and frames lost to falling behind the master
+    int32_t getFrameSyncDrift(void);
+    uint32_t getFrameSyncMissedPulses(void);
+#if defined(ESP32)
+    // task gets an xTaskNotifyGive() every frame (NULL to stop), the event group gets SM_FRAME_EVENT_BIT set every frame
+    void setFrameNotifyTask(TaskHandle_t task);
+    EventGroupHandle_t getFrameEventGroup(void);
+#endif
+
     // debug
     int countFPS(void);
 
@@ -58,12 +85,22 @@ public:
 
 private:
     static SM_Layer * baseLayer;
+    static smLayerChain layerChain;
 
     // functions for refreshing
     static void loadMatrixBuffers(frameDataStruct * currentRowDataPtr, unsigned char currentRow);
+#if defined(__IMXRT1062__)
+    static void loadLaneBits(frameDataStruct * currentFramePtr, int ledIndex, const uint8_t * ledData);
+#endif
 
     // configuration
     static volatile bool rotationChange;
+    static volatile bool brightnessChange;
+    static volatile bool skipUnchangedFrames;
+    static uint16_t keepAliveMs;
+    static uint32_t lastFrameSentMillis;
+    static smFrameEvents frameEvents;
+    static smFrameSync frameSync;
     static volatile bool dmaBufferUnderrun;
     static int dimmingFactor;
     static const int dimmingMaximum = 255;
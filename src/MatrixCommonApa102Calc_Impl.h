@@ -33,6 +33,8 @@ uint32_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType,
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SM_Layer * SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smLayerChain SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::layerChain;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
@@ -53,14 +55,22 @@ SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFla
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addLayer(SM_Layer * newlayer) {
-    if(baseLayer) {
-        SM_Layer * templayer = baseLayer;
-        while(templayer->nextLayer)
-            templayer = templayer->nextLayer;
-        templayer->nextLayer = newlayer;
-    } else {
-        baseLayer = newlayer;
-    }
+    layerChain.add(newlayer, rotation);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::removeLayer(SM_Layer * layer) {
+    layerChain.remove(layer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::moveLayer(SM_Layer * layer, SM_Layer * belowLayer) {
+    layerChain.move(layer, belowLayer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setLayerVisible(SM_Layer * layer, bool visible) {
+    layerChain.setVisible(layer, visible);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -86,8 +96,75 @@ int SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optio
     return ret;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameCallback(smFrameCallback callback) {
+    frameEvents.callback = callback;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameCount(void) {
+    return frameEvents.frameCount;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForFrame(uint32_t timeoutMs) {
+    return frameEvents.wait(timeoutMs);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncOutput(int8_t pin) {
+    frameSync.setOutput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncInput(int8_t pin) {
+    frameSync.setInput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSyncPulse(void) {
+    frameSync.pulse();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int32_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncDrift(void) {
+    return frameSync.drift;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncMissedPulses(void) {
+    return frameSync.missedPulses;
+}
+
+#if defined(ESP32)
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameNotifyTask(TaskHandle_t task) {
+    frameEvents.notifyTask = task;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+EventGroupHandle_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameEventGroup(void) {
+    return frameEvents.eventGroup;
+}
+#endif
+
 #define MAX_MATRIXCALCULATIONS_LOOPS_WITHOUT_EXIT  5
 
+// "SPLIT" GBC mode: 14.18 factor taking a 16-bit color to the 8-bit color that gives the same output with a GBC of gbc
+#define APA102_SPLIT_COLOR_FACTOR(gbc)  ((0x1FUL * 0xFF * 0x40000 + (0xFFFFUL * (gbc)) / 2) / (0xFFFFUL * (gbc)))
+
+static const uint16_t apa102SplitColorFactors[32] = {
+    0,
+    APA102_SPLIT_COLOR_FACTOR(1),  APA102_SPLIT_COLOR_FACTOR(2),  APA102_SPLIT_COLOR_FACTOR(3),  APA102_SPLIT_COLOR_FACTOR(4),
+    APA102_SPLIT_COLOR_FACTOR(5),  APA102_SPLIT_COLOR_FACTOR(6),  APA102_SPLIT_COLOR_FACTOR(7),  APA102_SPLIT_COLOR_FACTOR(8),
+    APA102_SPLIT_COLOR_FACTOR(9),  APA102_SPLIT_COLOR_FACTOR(10), APA102_SPLIT_COLOR_FACTOR(11), APA102_SPLIT_COLOR_FACTOR(12),
+    APA102_SPLIT_COLOR_FACTOR(13), APA102_SPLIT_COLOR_FACTOR(14), APA102_SPLIT_COLOR_FACTOR(15), APA102_SPLIT_COLOR_FACTOR(16),
+    APA102_SPLIT_COLOR_FACTOR(17), APA102_SPLIT_COLOR_FACTOR(18), APA102_SPLIT_COLOR_FACTOR(19), APA102_SPLIT_COLOR_FACTOR(20),
+    APA102_SPLIT_COLOR_FACTOR(21), APA102_SPLIT_COLOR_FACTOR(22), APA102_SPLIT_COLOR_FACTOR(23), APA102_SPLIT_COLOR_FACTOR(24),
+    APA102_SPLIT_COLOR_FACTOR(25), APA102_SPLIT_COLOR_FACTOR(26), APA102_SPLIT_COLOR_FACTOR(27), APA102_SPLIT_COLOR_FACTOR(28),
+    APA102_SPLIT_COLOR_FACTOR(29), APA102_SPLIT_COLOR_FACTOR(30), APA102_SPLIT_COLOR_FACTOR(31)
+};
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunCallback(void) {
     dmaBufferUnderrun = true;
@@ -109,6 +186,17 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
 #endif
             // do once-per-frame updates
             if (!currentRow) {
+                // layers added, removed, moved or hidden since the last frame are picked up here, and need the per-frame setup
+                bool layersChanged = layerChain.publish(baseLayer);
+                if (layersChanged) {
+                    rotationChange = true;
+                    refreshRateChanged = true;
+                }
+
+                // a new brightness or rotation is part of the packed frame, and has to be sent even if the layers didn't change
+                bool refreshNeeded = initial || !skipUnchangedFrames || layersChanged || rotationChange || brightnessChange;
+                brightnessChange = false;
+
                 if (rotationChange) {
                     SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                     while(templayer) {
@@ -118,15 +206,39 @@ void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
                     rotationChange = false;
                 }
 
-                SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-                while(templayer) {
-                    if(refreshRateChanged) {
-                        templayer->setRefreshRate(refreshRate);
+                // with frame sync following a master, layers only advance to a new frame on the master's pulse (or a timeout)
+                if (frameSync.frameStart()) {
+                    // checked before frameRefreshCallback() takes a pending swap, layers that don't track changes always report a change
+                    SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+                    while(templayer && !refreshNeeded) {
+                        if(templayer->isLayerChanged())
+                            refreshNeeded = true;
+                        templayer = templayer->nextLayer;
+                    }
+
+                    templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+                    while(templayer) {
+                        if(refreshRateChanged) {
+                            templayer->setRefreshRate(refreshRate);
+                        }
+                        templayer->frameRefreshCallback();
+                        templayer = templayer->nextLayer;
                     }
-                    templayer->frameRefreshCallback();
-                    templayer = templayer->nextLayer;
+                    refreshRateChanged = false;
+                    frameEvents.signal();
                 }
-                refreshRateChanged = false;
+
+                if (!refreshNeeded && keepAliveMs && (millis() - lastFrameSentMillis >= keepAliveMs))
+                    refreshNeeded = true;
+
+                // the slot still fills a refresh period so the calc keeps its cadence, but the refresh doesn't send it
+                if (!refreshNeeded) {
+                    currentRowDataPtr->repeatFrame = true;
+                    SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(currentRow);
+                    continue;
+                }
+                currentRowDataPtr->repeatFrame = false;
+                lastFrameSentMillis = millis();
             }
 
             // do once-per-line updates
@@ -175,11 +287,30 @@ uint16_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType,
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotationChange = true;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameEvents SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameEvents;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameSync SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSync;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessChange = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::skipUnchangedFrames = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::keepAliveMs = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::lastFrameSentMillis = 0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
     dimmingFactor = dimmingMaximum - newBrightness;
+    brightnessChange = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setSkipUnchangedFrames(bool enabled, uint16_t newKeepAliveMs) {
+    keepAliveMs = newKeepAliveMs;
+    skipUnchangedFrames = enabled;
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -224,11 +355,10 @@ bool SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, opti
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(void)
 {
-    SM_Layer * templayer = baseLayer;
-    while(templayer) {
-        templayer->begin();
-        templayer = templayer->nextLayer;
-    }
+    frameEvents.begin();
+
+    layerChain.begin();
+    layerChain.publish(baseLayer);
 
     SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculations);
     SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixUnderrunCallback(dmaBufferUnderrunCallback);
@@ -246,21 +376,30 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[matrixWidth];
 
-    // clear buffer to prevent garbage data showing through transparent layers
-    memset(tempRow0, 0x00, sizeof(tempRow0));
+    // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+    if (!baseLayer || !baseLayer->isLayerOpaque()) {
+        memset(tempRow0, 0x00, sizeof(tempRow0));
+    }
 
     // get pixel data from layers
     SM_Layer * templayer = SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
     while(templayer) {
-        templayer->fillRefreshRow(currentRow, &tempRow0[0]);
+        templayer->fillCoveredRefreshRow(currentRow, &tempRow0[0]);
         templayer = templayer->nextLayer;        
     }
 
     if(!currentRow) {
-        // fill start and end frame markers
-        for(i=0; i<4; i++) {
-            currentRowDataPtr->data[i] = 0;
-            currentRowDataPtr->data[4 + (matrixWidth * matrixHeight * 4) + i] = 0xFF;
+        if(APA102_NUM_LANES > 1) {
+            // lane bits are ORed in, so clear everything (start frame and any padding LEDs on the last lane) ahead of the end frame
+            const int endFrameBytes = APA102_LANE_END_FRAME_CLOCKS * APA102_LANE_BITS / 8;
+            memset(currentRowDataPtr->data, 0x00, sizeof(currentRowDataPtr->data) - endFrameBytes);
+            memset(&currentRowDataPtr->data[sizeof(currentRowDataPtr->data) - endFrameBytes], 0xFF, endFrameBytes);
+        } else {
+            // fill start and end frame markers
+            for(i=0; i<4; i++) {
+                currentRowDataPtr->data[i] = 0;
+                currentRowDataPtr->data[4 + (matrixWidth * matrixHeight * 4) + i] = 0xFF;
+            }
         }
     }
 
@@ -273,6 +412,10 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
 
         uint16_t tempPixel1, tempPixel2, tempPixel3;
 
+        // multi-lane frames are bit-interleaved, the LED's bytes are built here and then spread over its lane's clocks
+        uint8_t laneLedData[4];
+        uint8_t * ledData = (APA102_NUM_LANES > 1) ? laneLedData : &currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4)];
+
         switch(optionFlags & SM_APA102_OPTIONS_COLOR_ORDER_MASK) {
             case SM_APA102_OPTIONS_COLOR_ORDER_RGB:
                 tempPixel1 = tempRow0[j].red;
@@ -318,10 +461,10 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
 
             uint16_t value  = (maxrgb * 31 * globalbrightness) / 0x10000 / 31;
 
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 0] = 0xE0 | (value+1);
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 1] = ((tempPixel1 * globalbrightness) / (value + 1)) >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 2] = ((tempPixel2 * globalbrightness) / (value + 1)) >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 3] = ((tempPixel3 * globalbrightness) / (value + 1)) >> 8;
+            ledData[0] = 0xE0 | (value+1);
+            ledData[1] = ((tempPixel1 * globalbrightness) / (value + 1)) >> 8;
+            ledData[2] = ((tempPixel2 * globalbrightness) / (value + 1)) >> 8;
+            ledData[3] = ((tempPixel3 * globalbrightness) / (value + 1)) >> 8;
         }
 
         // "SIMPLE" mode attempts to get 13-bit color per channel by first applying the setBrightness() value to the GBC bits, then dividing by two to attempt to get more bits for dimmer colors, this is not as good as "DEFAULT" mode, but is more efficient
@@ -344,11 +487,11 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
             localshift = 8 - localshift;
 
             // global brightness
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 0] = 0xE0 | globalbrightness;
+            ledData[0] = 0xE0 | globalbrightness;
 
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 1] = tempPixel1 >> localshift;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 2] = tempPixel2 >> localshift;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 3] = tempPixel3 >> localshift;
+            ledData[1] = tempPixel1 >> localshift;
+            ledData[2] = tempPixel2 >> localshift;
+            ledData[3] = tempPixel3 >> localshift;
         }
 
         // "BRIGHTONLY" applies the setBrightness() value to the GBC bits, so the same GBC is used across all LEDs
@@ -359,25 +502,73 @@ INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelTyp
                 globalbrightness = 0x1f;
 
             // global brightness
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 0] = 0xE0 | globalbrightness;
+            ledData[0] = 0xE0 | globalbrightness;
+
+            ledData[1] = tempPixel1 >> 8;
+            ledData[2] = tempPixel2 >> 8;
+            ledData[3] = tempPixel3 >> 8;
+        }
 
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 1] = tempPixel1 >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 2] = tempPixel2 >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 3] = tempPixel3 >> 8;
+        // "SPLIT" mode picks the smallest GBC that can show the brightest channel, and scales all three channels up to 8 bits for it,
+        // so a dark or dimmed LED uses a low GBC instead of losing color bits, giving up to 13 bits of range per channel
+        if((optionFlags & SM_APA102_OPTIONS_GBC_MODE_MASK) == SM_APA102_OPTIONS_GBC_MODE_SPLIT) {
+            if(dimmingFactor) {
+                tempPixel1 = (tempPixel1 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
+                tempPixel2 = (tempPixel2 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
+                tempPixel3 = (tempPixel3 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
+            }
+
+            uint16_t maxrgb = max(max(tempPixel1, tempPixel2), tempPixel3);
+            uint8_t globalbrightness = ((maxrgb * 0x1FUL) >> 16) + 1;
+            uint32_t factor = apa102SplitColorFactors[globalbrightness];
+
+            ledData[0] = 0xE0 | globalbrightness;
+
+            // the brightest channel can round up past 8 bits
+            uint32_t color1 = (tempPixel1 * factor + 0x20000) >> 18;
+            uint32_t color2 = (tempPixel2 * factor + 0x20000) >> 18;
+            uint32_t color3 = (tempPixel3 * factor + 0x20000) >> 18;
+            ledData[1] = (color1 > 0xFF) ? 0xFF : color1;
+            ledData[2] = (color2 > 0xFF) ? 0xFF : color2;
+            ledData[3] = (color3 > 0xFF) ? 0xFF : color3;
         }
 
         // "NONE" mode doesn't use GBC at all, the LED output is 24-bit color
         if((optionFlags & SM_APA102_OPTIONS_GBC_MODE_MASK) == SM_APA102_OPTIONS_GBC_MODE_NONE) {
             // global brightness
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 0] = 0xFF;
+            ledData[0] = 0xFF;
 
             tempPixel3 = (tempPixel3 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
             tempPixel2 = (tempPixel2 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
             tempPixel1 = (tempPixel1 * (dimmingMaximum - dimmingFactor)) / dimmingMaximum;
 
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 1] = tempPixel1 >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 2] = tempPixel2 >> 8;
-            currentRowDataPtr->data[4 + ((currentRow * matrixWidth + i) * 4) + 3] = tempPixel3 >> 8;
+            ledData[1] = tempPixel1 >> 8;
+            ledData[2] = tempPixel2 >> 8;
+            ledData[3] = tempPixel3 >> 8;
         }
+
+#if defined(__IMXRT1062__)
+        if(APA102_NUM_LANES > 1)
+            loadLaneBits(currentRowDataPtr, currentRow * matrixWidth + i, laneLedData);
+#endif
     }
 }
+
+#if defined(__IMXRT1062__)
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+INLINE void SmartMatrixApaCalc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadLaneBits(frameDataStruct * currentFramePtr, int ledIndex, const uint8_t * ledData) {
+    int lane = ledIndex / APA102_LEDS_PER_LANE;
+
+    // the LED's 32 bits go out on consecutive clocks, after the start frame and the LEDs ahead of it on the same lane
+    uint32_t bitOffset = (32 * ((ledIndex % APA102_LEDS_PER_LANE) + 1)) * APA102_LANE_BITS +
+        SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::laneBitOffsets[lane];
+    uint32_t ledWord = (ledData[0] << 24) | (ledData[1] << 16) | (ledData[2] << 8) | ledData[3];
+
+    // FlexIO shifts out the lowest bits of each word first, so clock n is sent from bits (n * APA102_LANE_BITS) and up
+    for(int j = 0; j < 32; j++) {
+        if(ledWord & (0x80000000 >> j))
+            currentFramePtr->data[bitOffset >> 3] |= (1 << (bitOffset & 0x07));
+        bitOffset += APA102_LANE_BITS;
+    }
+}
+#endif
@@ -24,11 +24,28 @@
 #ifndef SmartMatrixAPA102Refresh_h
 #define SmartMatrixAPA102Refresh_h
 
+// lane layout, only the Teensy 4 refresh can drive more than one lane
+#if defined(__IMXRT1062__)
+#define APA102_NUM_LANES                (((optionFlags & SM_APA102_OPTIONS_LANES_MASK) >> SM_APA102_OPTIONS_LANES_SHIFT) + 1)
+#else
+#define APA102_NUM_LANES                1
+#endif
+#define APA102_LANE_BITS                (APA102_NUM_LANES > 4 ? 8 : (APA102_NUM_LANES > 2 ? 4 : APA102_NUM_LANES))
+#define APA102_LEDS_PER_LANE            (((matrixWidth * matrixHeight) + APA102_NUM_LANES - 1) / APA102_NUM_LANES)
+// a lane needs at least one clock per two LEDs after its data to push it to the end of the chain, in 32-clock words
+#define APA102_LANE_END_FRAME_CLOCKS    (32 * ((APA102_LEDS_PER_LANE + 63) / 64))
+// multi-lane frames hold APA102_LANE_BITS bits per clock: a start frame, each lane's LEDs, and the end frame
+#define APA102_FRAME_BYTES              ((APA102_NUM_LANES == 1) ? (((matrixWidth*matrixHeight) * 4) + (4+4)) : \
+                                            (((32 * (APA102_LEDS_PER_LANE + 1)) + APA102_LANE_END_FRAME_CLOCKS) * APA102_LANE_BITS / 8))
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixAPA102Refresh {
 public:
     struct frameDataStruct {
-        uint8_t data[((matrixWidth*matrixHeight) * 4) + (4+4)];
+        // word aligned for the 32-bit multi-lane DMA
+        uint8_t data[APA102_FRAME_BYTES] __attribute__((aligned(4)));
+        // nothing changed since the last frame: data wasn't packed, and the refresh skips the transfer for this period
+        bool repeatFrame;
     };
 
     typedef void (*matrix_underrun_callback)(void);
@@ -50,15 +67,21 @@ public:
     static void setMatrixCalculationsCallback(matrix_calc_callback f);
     static void setMatrixUnderrunCallback(matrix_underrun_callback f);
 
+    // bit position of each lane within a clock's APA102_LANE_BITS, set from the FlexIO pin mapping in begin()
+    static uint8_t laneBitOffsets[8];
+
 private:
     // enable ISR access to private member variables
     template <int refreshDepth1, int matrixWidth1, int matrixHeight1, unsigned char panelType1, uint32_t optionFlags1>
     friend void apaRowCalculationISR(void);
     template <int refreshDepth1, int matrixWidth1, int matrixHeight1, unsigned char panelType1, uint32_t optionFlags1>
     friend void apaRowShiftCompleteISR(void);
+    template <int refreshDepth1, int matrixWidth1, int matrixHeight1, unsigned char panelType1, uint32_t optionFlags1>
+    friend void apaLaneShiftCompleteISR(void);
 
     // configuration helper functions
     static void calculateTimerLUT(void);
+    static bool beginLanes(void);
 
     static uint16_t rowBitStructBytesToShift;
     static uint8_t refreshRate;
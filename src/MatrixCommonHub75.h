@@ -24,6 +24,9 @@
 #ifndef SmartMatrixCommonHUB75_h
 #define SmartMatrixCommonHUB75_h
 
+#include <stdint.h>
+#include "MatrixFlashSafe.h"
+
 #define DEFAULT_PANEL_WIDTH_FOR_LINEAR_PANELS       32
 #define HUB75_RGB_COLOR_CHANNELS_IN_PARALLEL        2
 
@@ -142,7 +145,15 @@
                                                     (x == SMARTMATRIX_HUB75_8ROW_MOD4SCAN_ALT_ADDX ? 1 : 0))
 
 #define MATRIX_PANEL_HEIGHT (CONVERT_PANELTYPE_TO_MATRIXPANELHEIGHT(panelType))
-#define MATRIX_STACK_HEIGHT (matrixHeight / MATRIX_PANEL_HEIGHT)
+// Teensy 4 can refresh the top and bottom halves of the matrix on two chains in parallel (SM_HUB75_OPTIONS_T4_DUAL_CHAIN),
+// the refresh timing and buffers are then those of one chain, HUB75_CHAIN_HEIGHT rows high
+#if defined(__IMXRT1062__) || defined(SM_HOST_BUILD)
+#define HUB75_PARALLEL_CHAINS ((optionFlags & SM_HUB75_OPTIONS_T4_DUAL_CHAIN) ? 2 : 1)
+#else
+#define HUB75_PARALLEL_CHAINS 1
+#endif
+#define HUB75_CHAIN_HEIGHT (matrixHeight / HUB75_PARALLEL_CHAINS)
+#define MATRIX_STACK_HEIGHT (HUB75_CHAIN_HEIGHT / MATRIX_PANEL_HEIGHT)
 
 #define COLOR_CHANNELS_PER_PIXEL        3
 #define LATCHES_PER_ROW (refreshDepth/COLOR_CHANNELS_PER_PIXEL)
@@ -153,7 +164,10 @@
 #define ROW_PAIR_OFFSET (CONVERT_PANELTYPE_TO_MATRIXROWPAIROFFSET(panelType))
 #define MULTI_ROW_REFRESH_REQUIRED (PHYSICAL_ROWS_PER_REFRESH_ROW > 1)
 
-#define PIXELS_PER_LATCH    ((matrixWidth * matrixHeight) / MATRIX_PANEL_HEIGHT * PHYSICAL_ROWS_PER_REFRESH_ROW)
+#define PIXELS_PER_LATCH    ((matrixWidth * HUB75_CHAIN_HEIGHT) / MATRIX_PANEL_HEIGHT * PHYSICAL_ROWS_PER_REFRESH_ROW)
+// panels across and down the matrix for setPanelGain(), in hardware orientation
+#define PANEL_GAIN_COLUMNS  ((matrixWidth + COLS_PER_PANEL - 1) / COLS_PER_PANEL)
+#define PANEL_GAIN_ROWS     (matrixHeight / MATRIX_PANEL_HEIGHT)
 
 #define SM_HUB75_OPTIONS_NONE                       0
 #define SM_HUB75_OPTIONS_C_SHAPE_STACKING           (1 << 0)
@@ -164,6 +178,29 @@
 #define SM_HUB75_OPTIONS_ESP32_CALC_TASK_CORE_1     (1 << 5)
 #define SM_HUB75_OPTIONS_FM6126A_RESET_AT_START     (1 << 6)
 #define SM_HUB75_OPTIONS_T4_CLK_PIN_ALT             (1 << 7)
+#define SM_HUB75_OPTIONS_ESP32_CALC_DUAL_CORE       (1 << 8)
+#define SM_HUB75_OPTIONS_ESP32_SHARED_DESCRIPTORS   (1 << 9)
+// fill rows from the layers at 48-bit and dither the bits below refreshDepth over successive frames, e.g. 10-12 bit gradients at the RAM and refresh cost of refreshDepth 24
+// every row is recalculated every frame while enabled, as the dither pattern changes from frame to frame
+#define SM_HUB75_OPTIONS_TEMPORAL_DITHER            (1 << 10)
+// Teensy: treat the buffer_rows given to SMARTMATRIX_ALLOCATE_BUFFERS as a maximum, and only fill ahead as many rows as recent underruns and
+// ISR latency have needed, see smRowBufferGovernor
+#define SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER        (1 << 11)
+// ESP32: show each row's MSB sweeps in ESP32_BCM_SUBFRAMES passes over all rows instead of all at once, so the long bitplanes of a row
+// are spread across the frame (less flicker on camera) with the same descriptors and DMA bandwidth; needs an external ADDX latch
+#define SM_HUB75_OPTIONS_SCRAMBLED_BCM              (1 << 12)
+// Teensy 4: drive the bottom half of the matrix from a second set of RGB pins (FLEXIO_PIN_CHAIN1_*_TEENSY_PIN) on the same FlexIO,
+// sharing CLK, LAT, OE and the row address with the first chain, so each chain is half as long at the same refresh rate and depth
+#define SM_HUB75_OPTIONS_T4_DUAL_CHAIN              (1 << 13)
+// Teensy 4: composite each row into one of two sets of temp rows, and clear the other set with eDMA while this one is packed, so the
+// next row starts compositing without a memset in the calc, costs a second set of temp rows
+#define SM_HUB75_OPTIONS_T4_PIPELINED_ROWS          (1 << 14)
+// Teensy 4: blank the low bitplanes that are unlit at the current brightness or have no bits set anywhere in the previous frame, shorten
+// them to the minimum period and skip packing them, so the row is shown in less time and the refresh rate goes up
+#define SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES      (1 << 15)
+// Teensy 4: with buffer_rows of at least MATRIX_SCAN_MOD, every row of the frame stays packed in the row buffer, and the refresh shows
+// the stored rows again when the calc has nothing new, so frames where no layer changed aren't composited or packed at all
+#define SM_HUB75_OPTIONS_T4_FRAME_REPLAY            (1 << 16)
 
 // old naming convention kept for compatibility
 #define SMARTMATRIX_OPTIONS_NONE                    SM_HUB75_OPTIONS_NONE                   
@@ -175,6 +212,15 @@
 #define SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1  SM_HUB75_OPTIONS_ESP32_CALC_TASK_CORE_1 
 #define SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START  SM_HUB75_OPTIONS_FM6126A_RESET_AT_START 
 #define SMARTMATRIX_OPTIONS_T4_CLK_PIN_ALT          SM_HUB75_OPTIONS_T4_CLK_PIN_ALT         
+#define SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE    SM_HUB75_OPTIONS_ESP32_CALC_DUAL_CORE   
+#define SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS SM_HUB75_OPTIONS_ESP32_SHARED_DESCRIPTORS
+#define SMARTMATRIX_OPTIONS_TEMPORAL_DITHER         SM_HUB75_OPTIONS_TEMPORAL_DITHER
+#define SMARTMATRIX_OPTIONS_ADAPTIVE_ROW_BUFFER     SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER
+#define SMARTMATRIX_OPTIONS_SCRAMBLED_BCM           SM_HUB75_OPTIONS_SCRAMBLED_BCM
+#define SMARTMATRIX_OPTIONS_T4_DUAL_CHAIN           SM_HUB75_OPTIONS_T4_DUAL_CHAIN
+#define SMARTMATRIX_OPTIONS_T4_PIPELINED_ROWS       SM_HUB75_OPTIONS_T4_PIPELINED_ROWS
+#define SMARTMATRIX_OPTIONS_T4_ADAPTIVE_BITPLANES   SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES
+#define SMARTMATRIX_OPTIONS_T4_FRAME_REPLAY         SM_HUB75_OPTIONS_T4_FRAME_REPLAY
 
 
 // defines data bit order from bit 0-7, four times to fit in uint32_t
@@ -182,4 +228,352 @@
     p1b1:1, p1r2:1, p1g2:1, p1b2:1, p2r1:1, p2g1:1, p2b1:1, p2r2:1, \
     p2g2:1, p2b2:1, p3r1:1, p3g1:1, p3b1:1, p3r2:1, p3g2:1, p3b2:1 
     
+// linear global brightness fade, stepped by the calc once per frame so a fade needs no calls from the sketch
+struct smBrightnessFade {
+    uint8_t startBrightness = 0;
+    uint8_t targetBrightness = 0;
+    uint16_t numFrames = 0;
+    uint16_t framesDone = 0;
+
+    void SM_FLASH_SAFE_IRAM start(uint8_t from, uint8_t to, uint32_t frames) {
+        startBrightness = from;
+        targetBrightness = to;
+        numFrames = frames ? ((frames < 0xFFFF) ? frames : 0xFFFF) : 1;
+        framesDone = 0;
+    }
+    void SM_FLASH_SAFE_IRAM stop(void) { framesDone = numFrames; }
+    bool SM_FLASH_SAFE_IRAM isRunning(void) const { return framesDone < numFrames; }
+    // advances one frame and returns the brightness for it, the last frame returns targetBrightness exactly
+    uint8_t SM_FLASH_SAFE_IRAM step(void) {
+        framesDone++;
+        return startBrightness + ((int)(targetBrightness - startBrightness) * framesDone) / numFrames;
+    }
+};
+
+// the limited brightness is lowered by 1/(1 << SM_POWER_LIMIT_FALL_SHIFT) of the distance to the brightness that fits the budget
+// each frame (a few frames at normal refresh rates), and raised again by SM_POWER_LIMIT_RISE_STEP per frame
+#ifndef SM_POWER_LIMIT_FALL_SHIFT
+#define SM_POWER_LIMIT_FALL_SHIFT               2
+#endif
+#ifndef SM_POWER_LIMIT_RISE_STEP
+#define SM_POWER_LIMIT_RISE_STEP                1
+#endif
+
+// Teensy 4 current estimate and limiter for setPowerLimit(), fed once per frame with the sum of the 16-bit channel values the calc packed
+// in the last frame, and the lit and total ticks of one row from the timer LUT it was shown with: each channel is taken as lit for
+// value/65535 of the row's on-time, which matches the LUT's binary weighted bitplanes to within the rounding of their on-times
+struct smPowerLimit {
+    // current of one lit LED (one color of one pixel) at 100% on-time, set by the panel's constant current drivers, 0 = no estimate
+    uint16_t channelMilliamps = 0;
+    // 0 = limiter off
+    uint32_t budgetMilliamps = 0;
+
+    // state, readable with getEstimatedCurrent() and getPowerLimitedBrightness()
+    uint32_t estimatedMilliamps = 0;
+    uint8_t level = 255;
+    uint32_t limitedFrames = 0;
+
+    uint32_t estimate(uint64_t channelSum, uint32_t litTicks, uint32_t rowTicks, uint16_t scanMod) {
+        if(!rowTicks)
+            return 0;
+        return (channelSum * channelMilliamps * litTicks) / ((uint64_t)0xFFFF * rowTicks * scanMod);
+    }
+
+    // records the last frame's estimate, shown at appliedBrightness, and returns the brightness to show the next frame at
+    uint8_t update(uint64_t channelSum, uint32_t litTicks, uint32_t rowTicks, uint16_t scanMod, uint8_t appliedBrightness, uint8_t brightness) {
+        estimatedMilliamps = estimate(channelSum, litTicks, rowTicks, scanMod);
+
+        uint32_t fit = 255;
+        if(!budgetMilliamps || !channelMilliamps) {
+            level = 255;
+        } else {
+            // on-time scales with the brightness, so the current does as well, nothing is learned from a frame shown at brightness 0
+            if(estimatedMilliamps)
+                fit = ((uint32_t)appliedBrightness * budgetMilliamps) / estimatedMilliamps;
+            else if(!appliedBrightness)
+                fit = level;
+            if(fit > 255)
+                fit = 255;
+
+            // falling from above the brightness shown would take frames to have any effect
+            if(fit < appliedBrightness && level > appliedBrightness)
+                level = appliedBrightness;
+            if(fit < level)
+                level -= (level - fit + (1 << SM_POWER_LIMIT_FALL_SHIFT) - 1) >> SM_POWER_LIMIT_FALL_SHIFT;
+            else if(level < fit)
+                level = ((uint32_t)level + SM_POWER_LIMIT_RISE_STEP < fit) ? level + SM_POWER_LIMIT_RISE_STEP : fit;
+        }
+
+        if(level < brightness) {
+            limitedFrames++;
+            return level;
+        }
+        return brightness;
+    }
+};
+
+// the Teensy refresh rate in economy mode, Teensy has no frame buffer to keep showing, so rows are still packed every refresh frame
+#ifndef SM_ECONOMY_MODE_REFRESH_RATE
+#define SM_ECONOMY_MODE_REFRESH_RATE            60
+#endif
+
+// setEconomyMode(): while enabled the layers are only advanced to a new frame every intervalMs, or not at all with an interval of 0
+struct smEconomyMode {
+    volatile bool enabled = false;
+    volatile uint16_t intervalMs = 0;
+    volatile uint32_t lastUpdateMillis = 0;
+    // the refresh rate to go back to, for calcs that lower it
+    uint16_t savedRefreshRate = 0;
+
+    // called by the calc at the start of a frame with millis(), true if the layers can advance now
+    bool SM_FLASH_SAFE_IRAM frameDue(uint32_t now) {
+        if(!enabled)
+            return true;
+        if(!intervalMs || now - lastUpdateMillis < intervalMs)
+            return false;
+        lastUpdateMillis = now;
+        return true;
+    }
+};
+
+#ifndef SM_CALC_GOVERNOR_HYSTERESIS_PERCENT
+#define SM_CALC_GOVERNOR_HYSTERESIS_PERCENT     10
+#endif
+// frames a new divider is kept before the governor changes it again, long enough for the average to settle
+#ifndef SM_CALC_GOVERNOR_HOLD_FRAMES
+#define SM_CALC_GOVERNOR_HOLD_FRAMES            32
+#endif
+
+// the governor never calculates more often than every other refresh frame, the calc would otherwise use the whole core
+#ifndef SM_CALC_GOVERNOR_MIN_DIVIDER
+#define SM_CALC_GOVERNOR_MIN_DIVIDER            2
+#endif
+
+// ESP32 calc rate governor, fed the start and end time of every matrixCalculations() call (once per refresh frame, calc frames or not)
+// the divider is raised while the average share of time spent calculating is above maxCpuPercent, and otherwise steered toward the
+// divider closest to targetFrameRate (or SM_CALC_GOVERNOR_MIN_DIVIDER with targetFrameRate 0): raised to it at once, and lowered
+// one step at a time while the share predicted at the lower divider is SM_CALC_GOVERNOR_HYSTERESIS_PERCENT below maxCpuPercent
+struct smCalcGovernor {
+    uint8_t maxCpuPercent = 80;
+    uint16_t targetFrameRate = 0;
+
+    // state, readable with getCalcGovernorState()
+    uint8_t divider = 2;
+    uint16_t calcRefreshRate = 0;
+    // moving average (1/16 per frame) of the percentage of time spent in matrixCalculations(), 8.8 fixed point
+    uint16_t averageCpuPercent = 0;
+    uint16_t framesSinceChange = 0;
+    uint32_t dividerRaises = 0;
+    uint32_t dividerLowers = 0;
+    uint32_t lastStartMicros = 0;
+    // measured time between the last two calls, the refresh frame period
+    uint32_t intervalMicros = 0;
+
+    // returns the divider to use from now on
+    uint8_t update(uint32_t startMicros, uint32_t endMicros, uint16_t refreshRate) {
+        uint32_t interval = startMicros - lastStartMicros;
+        bool firstCall = !lastStartMicros;
+        lastStartMicros = startMicros;
+        if(firstCall || !interval)
+            return divider;
+        intervalMicros = interval;
+
+        uint32_t percent = ((uint64_t)(endMicros - startMicros) * (100 * 256)) / interval;
+        if(percent > 100 * 256)
+            percent = 100 * 256;
+        averageCpuPercent += ((int32_t)percent - (int32_t)averageCpuPercent) / 16;
+
+        if(divider < SM_CALC_GOVERNOR_MIN_DIVIDER) {
+            framesSinceChange = 0;
+            return SM_CALC_GOVERNOR_MIN_DIVIDER;
+        }
+
+        if(framesSinceChange < SM_CALC_GOVERNOR_HOLD_FRAMES) {
+            framesSinceChange++;
+            return divider;
+        }
+
+        uint32_t targetDivider = targetFrameRate ? (refreshRate + targetFrameRate / 2) / targetFrameRate : SM_CALC_GOVERNOR_MIN_DIVIDER;
+        targetDivider = (targetDivider < SM_CALC_GOVERNOR_MIN_DIVIDER) ? SM_CALC_GOVERNOR_MIN_DIVIDER : ((targetDivider > 255) ? 255 : targetDivider);
+
+        uint8_t newDivider = divider;
+        if(averageCpuPercent > maxCpuPercent * 256 && divider < 255)
+            newDivider = divider + 1;
+        else if(divider < targetDivider)
+            newDivider = targetDivider;
+        else if(divider > targetDivider && maxCpuPercent > SM_CALC_GOVERNOR_HYSTERESIS_PERCENT &&
+            ((uint32_t)averageCpuPercent * divider) / (divider - 1) < (uint32_t)(maxCpuPercent - SM_CALC_GOVERNOR_HYSTERESIS_PERCENT) * 256)
+            newDivider = divider - 1;
+
+        if(newDivider > divider)
+            dividerRaises++;
+        else if(newDivider < divider)
+            dividerLowers++;
+        if(newDivider != divider)
+            framesSinceChange = 0;
+
+        return newDivider;
+    }
+};
+
+#ifndef SM_IDLE_WORK_MAX_CALLBACKS
+#define SM_IDLE_WORK_MAX_CALLBACKS              4
+#endif
+// idle work stops this long before the next refresh frame is expected, to absorb jitter in waking the calc task
+#ifndef SM_IDLE_WORK_MARGIN_MICROS
+#define SM_IDLE_WORK_MARGIN_MICROS              200
+#endif
+
+// called with the microseconds it may run for, returns true if it has more work waiting, long work has to be split across calls
+typedef bool (*smIdleWorkCallback)(void * context, uint32_t budgetMicros);
+
+// ESP32 idle work: low priority callbacks the calc task runs round robin in the slack left in a refresh frame after matrixCalculations()
+// the calc task stops starting callbacks once the next refresh frame is due or has already signaled, a running callback isn't
+// interrupted, so frame work only waits for the callback that's running to return, calls past their budget are counted as overruns
+struct smIdleWork {
+    smIdleWorkCallback callbacks[SM_IDLE_WORK_MAX_CALLBACKS] = {};
+    void * contexts[SM_IDLE_WORK_MAX_CALLBACKS] = {};
+    uint32_t maxBudgetMicros[SM_IDLE_WORK_MAX_CALLBACKS] = {};
+    uint8_t next = 0;
+    uint32_t overruns = 0;
+    uint32_t microsUsed = 0;
+
+    // maxBudget = 0 lets a callback have all of the slack, returns false if all slots are in use
+    bool add(smIdleWorkCallback callback, void * context, uint32_t maxBudget) {
+        for(int i=0; i<SM_IDLE_WORK_MAX_CALLBACKS; i++) {
+            if(callbacks[i])
+                continue;
+            contexts[i] = context;
+            maxBudgetMicros[i] = maxBudget;
+            // the callback is written last, the calc task skips empty slots
+            callbacks[i] = callback;
+            return true;
+        }
+        return false;
+    }
+
+    // the callback can still be running in the calc task when this returns, unless this is called from the callback itself
+    void remove(smIdleWorkCallback callback, void * context) {
+        for(int i=0; i<SM_IDLE_WORK_MAX_CALLBACKS; i++) {
+            if(callbacks[i] == callback && contexts[i] == context)
+                callbacks[i] = 0;
+        }
+    }
+
+    // runs callbacks until deadlineMicros or until frameDue() returns true, starting after the last one run so they share the slack
+    // nowMicros() returns micros(), passed in as this header is also built without Arduino
+    template <typename FRAME_DUE, typename NOW_MICROS>
+    void run(uint32_t deadlineMicros, FRAME_DUE frameDue, NOW_MICROS nowMicros) {
+        // callbacks in a row without more work, once every slot was asked the rest of the slack is left idle
+        int idleSlots = 0;
+        while(idleSlots < SM_IDLE_WORK_MAX_CALLBACKS && !frameDue()) {
+            uint32_t now = nowMicros();
+            int32_t slack = (int32_t)(deadlineMicros - now);
+            if(slack <= 0)
+                break;
+
+            smIdleWorkCallback callback = callbacks[next];
+            void * context = contexts[next];
+            uint32_t budget = (maxBudgetMicros[next] && maxBudgetMicros[next] < (uint32_t)slack) ? maxBudgetMicros[next] : slack;
+            if(++next >= SM_IDLE_WORK_MAX_CALLBACKS)
+                next = 0;
+
+            if(!callback || !callback(context, budget)) {
+                idleSlots++;
+            } else {
+                idleSlots = 0;
+            }
+
+            if(callback) {
+                uint32_t elapsed = nowMicros() - now;
+                microsUsed += elapsed;
+                if(elapsed > budget)
+                    overruns++;
+            }
+        }
+    }
+};
+
+// frames in each window the adaptive row buffer looks at before giving up one row
+#ifndef SM_ROW_BUFFER_QUIET_FRAMES
+#define SM_ROW_BUFFER_QUIET_FRAMES              240
+#endif
+#define SM_ROW_BUFFER_MIN_ROWS                  2
+// rows that have to stay queued in the worst refill of a window after the depth drops: the row being shown plus one row of headroom
+#define SM_ROW_BUFFER_HEADROOM_ROWS             2
+
+// Teensy row buffer depth for SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER: the ring keeps all rows allocated, the calc only fills depth of them
+// rowsQueued() gets the rows still queued (including the one being shown) each time the calc starts refilling, one left means the calc
+// barely made it and the depth grows, underruns grow it faster.  The fewest rows queued is tracked over windows of
+// SM_ROW_BUFFER_QUIET_FRAMES, and the depth only drops by one when the worst refill of this and the last window would still have kept
+// SM_ROW_BUFFER_HEADROOM_ROWS queued.  It never drops below the depth the last spike or underrun grew it to.
+struct smRowBufferGovernor {
+    uint8_t depth = 0;
+    uint8_t maxDepth = 0;
+    // depth set after the last latency spike or underrun, the depth doesn't drop below it
+    uint8_t spikeDepth = SM_ROW_BUFFER_MIN_ROWS;
+    // fewest rows queued when the calc started refilling, in the current and the last window
+    uint8_t lowestQueued = 0xFF;
+    uint8_t lastWindowLowestQueued = 0xFF;
+    uint16_t quietFrames = 0;
+    uint32_t underruns = 0;
+    uint32_t latencySpikes = 0;
+    uint32_t grows = 0;
+    uint32_t shrinks = 0;
+
+    void begin(uint8_t rows) {
+        depth = maxDepth = rows;
+        spikeDepth = SM_ROW_BUFFER_MIN_ROWS;
+        lowestQueued = lastWindowLowestQueued = 0xFF;
+        quietFrames = 0;
+    }
+
+    // each returns the depth to use from now on
+    uint8_t rowsQueued(uint8_t queued) {
+        if(queued < lowestQueued)
+            lowestQueued = queued;
+        // at the minimum depth one row queued is the normal state, not a spike
+        if(queued <= 1 && depth > SM_ROW_BUFFER_MIN_ROWS) {
+            latencySpikes++;
+            return grow(1);
+        }
+        return depth;
+    }
+
+    uint8_t underrun(void) {
+        underruns++;
+        return grow(2);
+    }
+
+    uint8_t frame(void) {
+        if(++quietFrames < SM_ROW_BUFFER_QUIET_FRAMES)
+            return depth;
+
+        // a row less would have left one row fewer queued in every refill
+        uint8_t worstQueued = (lowestQueued < lastWindowLowestQueued) ? lowestQueued : lastWindowLowestQueued;
+        if(worstQueued != 0xFF && worstQueued > SM_ROW_BUFFER_HEADROOM_ROWS && depth > spikeDepth && depth > SM_ROW_BUFFER_MIN_ROWS) {
+            depth--;
+            shrinks++;
+            // the last window's refills were measured with the deeper buffer
+            lowestQueued = (lowestQueued == 0xFF) ? 0xFF : lowestQueued - 1;
+        }
+        quietFrames = 0;
+        lastWindowLowestQueued = lowestQueued;
+        lowestQueued = 0xFF;
+        return depth;
+    }
+
+    uint8_t grow(uint8_t rows) {
+        if(depth < maxDepth) {
+            depth = (depth + rows < maxDepth) ? depth + rows : maxDepth;
+            grows++;
+        }
+        spikeDepth = depth;
+        // refills measured with the shallower buffer don't say anything about the new depth
+        quietFrames = 0;
+        lowestQueued = lastWindowLowestQueued = 0xFF;
+        return depth;
+    }
+};
+
 #endif
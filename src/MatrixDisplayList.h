@@ -0,0 +1,206 @@
+/*
+ * SmartMatrix Library - Display List
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_DISPLAY_LIST_H_
+#define _MATRIX_DISPLAY_LIST_H_
+
+// Records background layer drawing calls as commands instead of drawing them, for a renderer to draw into the layer's drawing buffer
+// later, on another core or at a lower priority than the code recording them.  The commands between two endFrame() calls are a frame:
+// the renderer draws them and swaps.  Commands go through a single producer, single consumer ring, so recording and rendering don't
+// lock each other out; if the ring is full the recorder waits for the renderer task, or without one drops drawing commands (counted in
+// the stats) until render() makes room.  The last SM_DISPLAY_LIST_RESERVED_COMMANDS slots are kept for setFont(), endFrame() and the
+// static part markers, so a frame with dropped commands still ends where it was recorded.
+//
+// The static part of a scene is recorded once between beginStatic() and endStatic(): the renderer keeps those commands and replays
+// them at the start of every later frame, so only the parts that change have to be recorded each frame.  Record the static part first
+// in the frame it's (re)defined in, recording a new static part replaces the old one.
+//
+// Text is copied into the command, truncated to SM_DISPLAY_LIST_TEXT_LENGTH-1 characters.  Bitmaps are drawn from the pointer passed
+// in, which has to stay valid until the frame is rendered (or for as long as it's in the static part).
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.
+
+#include "Layer_Background.h"
+
+#ifndef SM_DISPLAY_LIST_TEXT_LENGTH
+#define SM_DISPLAY_LIST_TEXT_LENGTH     24
+#endif
+
+#ifndef SM_DISPLAY_LIST_RESERVED_COMMANDS
+#define SM_DISPLAY_LIST_RESERVED_COMMANDS   4
+#endif
+
+typedef struct smDisplayListStats {
+    uint32_t frames;            // frames rendered and swapped
+    uint32_t commands;          // commands rendered, not counting static replays
+    uint32_t recorderWaits;     // times the recorder found the ring full
+    uint32_t droppedCommands;   // commands not recorded because the ring was full and no renderer task was running
+    uint32_t lastRenderMicros;  // time to draw the last frame, including the static part
+} smDisplayListStats;
+
+template <typename RGB, unsigned int optionFlags>
+class SMDisplayList {
+    public:
+        SMDisplayList(SMLayerBackground<RGB, optionFlags> * layer);
+
+        // allocates the ring and the static command store, returns false if either can't be allocated, or the renderer is running
+        // maxCommands has to be more than SM_DISPLAY_LIST_RESERVED_COMMANDS
+        bool begin(uint16_t maxCommands = 256, uint16_t maxStaticCommands = 64);
+
+        // recording, same arguments as the SMLayerBackground calls
+        void fillScreen(const RGB& color);
+        void drawPixel(int16_t x, int16_t y, const RGB& color);
+        void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        void drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color);
+        void drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color);
+        void drawCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color);
+        void fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color);
+        void fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor);
+        void drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color);
+        void drawTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& color);
+        void fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& fillColor);
+        void drawRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        void fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        void fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& outlineColor, const RGB& fillColor);
+        void drawRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& outlineColor);
+        void fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& fillColor);
+        void setFont(fontChoices newFont);
+        void drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]);
+        void drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]);
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, smBitmapFormat format, uint16_t stride = 0, const rgb24 *palette = NULL);
+        void drawBitmapScaled(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, uint16_t srcWidth, uint16_t srcHeight,
+            smBitmapFormat format, smScaleMode mode = SM_SCALE_NEAREST, uint16_t stride = 0, const rgb24 *palette = NULL);
+
+        // the commands up to here are a frame, the renderer swaps after drawing them, copying the frame to the next drawing buffer if copy
+        // is true (otherwise the next frame starts from the static part, or from whatever was in the buffer)
+        void endFrame(bool copy = false);
+
+        // the commands up to endStatic() replace the static part, drawn now and replayed at the start of every later frame
+        void beginStatic(void);
+        void endStatic(void);
+        void clearStatic(void) { beginStatic(); endStatic(); };
+
+        // renders the commands recorded so far, up to and including the next endFrame(), returns true if it swapped a frame
+        // call from loop() or a low priority interrupt when not using startRenderer()
+        bool render(void);
+        // the frames recorded but not rendered yet
+        uint16_t getPendingFrames(void) const { return recordedFrames - renderedFrames; };
+
+#if defined(ESP32)
+        // renders on a task pinned to core (the core not running loop() by default)
+        bool startRenderer(int core = -1, UBaseType_t priority = 1);
+        void stopRenderer(void);
+        bool isRendererRunning(void) const { return rendererRunning; };
+#endif
+
+        const smDisplayListStats & getStats(void) const { return stats; };
+
+    protected:
+        typedef enum smDisplayListOp {
+            opFillScreen,
+            opDrawPixel,
+            opDrawLine,
+            opDrawFastVLine,
+            opDrawFastHLine,
+            opDrawCircle,
+            opFillCircle,
+            opFillCircleOutline,
+            opDrawEllipse,
+            opDrawTriangle,
+            opFillTriangle,
+            opDrawRectangle,
+            opFillRectangle,
+            opFillRectangleOutline,
+            opDrawRoundRectangle,
+            opFillRoundRectangle,
+            opSetFont,
+            opDrawString,
+            opDrawStringBackColor,
+            opDrawBitmap,
+            opDrawBitmapScaled,
+            opEndFrame,
+            opBeginStatic,
+            opEndStatic,
+        } smDisplayListOp;
+
+        typedef struct smDisplayListCommand {
+            uint8_t op;
+            uint8_t arg;                // font, bitmap format (and scale mode << 4) or the endFrame() copy flag
+            int16_t p[7];
+            RGB color;
+            RGB color2;
+            union {
+                char text[SM_DISPLAY_LIST_TEXT_LENGTH];
+                struct {
+                    const void * src;
+                    const rgb24 * palette;
+                } bitmap;
+            };
+        } smDisplayListCommand;
+
+        // fills in op, the first numParams of p and color, and returns the command to record any other arguments into
+        // a dropped command is filled into droppedCommand instead, and commitCommand() returns false without recording it
+        smDisplayListCommand * allocateCommand(uint8_t op, const RGB& color, int numParams, int16_t p0 = 0, int16_t p1 = 0, int16_t p2 = 0,
+            int16_t p3 = 0, int16_t p4 = 0, int16_t p5 = 0, int16_t p6 = 0);
+        bool commitCommand(void);
+        void drawCommand(const smDisplayListCommand & command);
+        void replayStatic(void);
+
+        SMLayerBackground<RGB, optionFlags> * layer;
+
+        // the ring: the recorder only writes head, the renderer only writes tail, both count up forever
+        smDisplayListCommand * ring = NULL;
+        uint16_t ringSize = 0;
+        volatile uint32_t head = 0;
+        volatile uint32_t tail = 0;
+        volatile uint16_t recordedFrames = 0;
+        volatile uint16_t renderedFrames = 0;
+        // owned by the recorder
+        smDisplayListCommand droppedCommand;
+        bool commandDropped = false;
+
+        // owned by the renderer
+        smDisplayListCommand * staticCommands = NULL;
+        uint16_t maxStatic = 0;
+        uint16_t numStatic = 0;
+        bool recordingStatic = false;
+        bool frameOpen = false;
+        uint32_t frameStartMicros = 0;
+        // the last font set, restored at the start of the static part
+        fontChoices font = font3x5;
+        bool fontSet = false;
+
+        smDisplayListStats stats;
+
+#if defined(ESP32)
+        static void rendererTaskFunction(void * displayList);
+        void runRenderer(void);
+        TaskHandle_t rendererTask = NULL;
+        volatile bool rendererRunning = false;
+        volatile bool rendererStopRequested = false;
+#endif
+};
+
+#include "MatrixDisplayList_Impl.h"
+
+#endif
@@ -0,0 +1,429 @@
+/*
+ * SmartMatrix Library - Display List
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+template <typename RGB, unsigned int optionFlags>
+SMDisplayList<RGB, optionFlags>::SMDisplayList(SMLayerBackground<RGB, optionFlags> * layer) : layer(layer) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMDisplayList<RGB, optionFlags>::begin(uint16_t maxCommands, uint16_t maxStaticCommands) {
+#if defined(ESP32)
+    if(rendererRunning)
+        return false;
+#endif
+
+    // buffers from an earlier begin() are replaced
+    free(ring);
+    free(staticCommands);
+    ringSize = 0;
+
+    // one extra static command for the font restored at the start of the static part
+    ring = (smDisplayListCommand *)malloc(sizeof(smDisplayListCommand) * maxCommands);
+    staticCommands = (smDisplayListCommand *)malloc(sizeof(smDisplayListCommand) * (maxStaticCommands + 1));
+    if(!ring || !staticCommands || maxCommands <= SM_DISPLAY_LIST_RESERVED_COMMANDS) {
+        Serial.println("Error: SMDisplayList can't allocate command buffers");
+        free(ring);
+        free(staticCommands);
+        ring = staticCommands = NULL;
+        return false;
+    }
+
+    ringSize = maxCommands;
+    maxStatic = maxStaticCommands + 1;
+    head = 0;
+    tail = 0;
+    recordedFrames = 0;
+    renderedFrames = 0;
+    numStatic = 0;
+    recordingStatic = false;
+    frameOpen = false;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+typename SMDisplayList<RGB, optionFlags>::smDisplayListCommand * SMDisplayList<RGB, optionFlags>::allocateCommand(uint8_t op, const RGB& color,
+    int numParams, int16_t p0, int16_t p1, int16_t p2, int16_t p3, int16_t p4, int16_t p5, int16_t p6) {
+
+    // drawing commands leave the last slots for the commands that keep frames and the static part in order
+    bool reserved = (op == opSetFont || op == opEndFrame || op == opBeginStatic || op == opEndStatic);
+    uint32_t limit = reserved ? ringSize : ringSize - SM_DISPLAY_LIST_RESERVED_COMMANDS;
+
+    commandDropped = false;
+    if(!ring) {
+        stats.droppedCommands++;
+        commandDropped = true;
+    } else if(head - tail >= limit) {
+        stats.recorderWaits++;
+#if defined(ESP32)
+        // only the renderer moves tail, rendering here too would make the recorder a second consumer
+        while(rendererRunning && head - tail >= limit)
+            vTaskDelay(1);
+#endif
+        if(head - tail >= limit) {
+            stats.droppedCommands++;
+            commandDropped = true;
+        }
+    }
+
+    smDisplayListCommand * command = commandDropped ? &droppedCommand : &ring[head % ringSize];
+    command->op = op;
+    command->arg = 0;
+    command->color = color;
+
+    const int16_t params[7] = { p0, p1, p2, p3, p4, p5, p6 };
+    for(int i = 0; i < numParams; i++)
+        command->p[i] = params[i];
+
+    return command;
+}
+
+// the command is written before head moves past it
+template <typename RGB, unsigned int optionFlags>
+bool SMDisplayList<RGB, optionFlags>::commitCommand(void) {
+    if(commandDropped)
+        return false;
+
+    __sync_synchronize();
+    head = head + 1;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillScreen(const RGB& color) {
+    allocateCommand(opFillScreen, color, 0);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
+    allocateCommand(opDrawPixel, color, 2, x, y);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    allocateCommand(opDrawLine, color, 4, x0, y0, x1, y1);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, int16_t y1, const RGB& color) {
+    allocateCommand(opDrawFastVLine, color, 3, x, y0, y1);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1, int16_t y, const RGB& color) {
+    allocateCommand(opDrawFastHLine, color, 3, x0, x1, y);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color) {
+    allocateCommand(opDrawCircle, color, 3, x0, y0, radius);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color) {
+    allocateCommand(opFillCircle, color, 3, x0, y0, radius);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& outlineColor, const RGB& fillColor) {
+    allocateCommand(opFillCircleOutline, outlineColor, 3, x0, y0, radius)->color2 = fillColor;
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color) {
+    allocateCommand(opDrawEllipse, color, 4, x0, y0, radiusX, radiusY);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& color) {
+    allocateCommand(opDrawTriangle, color, 6, x1, y1, x2, y2, x3, y3);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& fillColor) {
+    allocateCommand(opFillTriangle, fillColor, 6, x1, y1, x2, y2, x3, y3);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    allocateCommand(opDrawRectangle, color, 4, x0, y0, x1, y1);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    allocateCommand(opFillRectangle, color, 4, x0, y0, x1, y1);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& outlineColor, const RGB& fillColor) {
+    allocateCommand(opFillRectangleOutline, outlineColor, 4, x0, y0, x1, y1)->color2 = fillColor;
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& outlineColor) {
+    allocateCommand(opDrawRoundRectangle, outlineColor, 5, x0, y0, x1, y1, radius);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t radius, const RGB& fillColor) {
+    allocateCommand(opFillRoundRectangle, fillColor, 5, x0, y0, x1, y1, radius);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::setFont(fontChoices newFont) {
+    allocateCommand(opSetFont, RGB(0, 0, 0), 0)->arg = newFont;
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]) {
+    smDisplayListCommand * command = allocateCommand(opDrawString, charColor, 2, x, y);
+    strncpy(command->text, text, SM_DISPLAY_LIST_TEXT_LENGTH - 1);
+    command->text[SM_DISPLAY_LIST_TEXT_LENGTH - 1] = '\0';
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]) {
+    smDisplayListCommand * command = allocateCommand(opDrawStringBackColor, charColor, 2, x, y);
+    command->color2 = backColor;
+    strncpy(command->text, text, SM_DISPLAY_LIST_TEXT_LENGTH - 1);
+    command->text[SM_DISPLAY_LIST_TEXT_LENGTH - 1] = '\0';
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, smBitmapFormat format,
+    uint16_t stride, const rgb24 *palette) {
+
+    smDisplayListCommand * command = allocateCommand(opDrawBitmap, RGB(0, 0, 0), 5, x, y, width, height, stride);
+    command->arg = format;
+    command->bitmap.src = src;
+    command->bitmap.palette = palette;
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawBitmapScaled(int16_t x, int16_t y, uint16_t width, uint16_t height, const void *src, uint16_t srcWidth,
+    uint16_t srcHeight, smBitmapFormat format, smScaleMode mode, uint16_t stride, const rgb24 *palette) {
+
+    smDisplayListCommand * command = allocateCommand(opDrawBitmapScaled, RGB(0, 0, 0), 7, x, y, width, height, srcWidth, srcHeight, stride);
+    command->arg = format | (mode << 4);
+    command->bitmap.src = src;
+    command->bitmap.palette = palette;
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::endFrame(bool copy) {
+    allocateCommand(opEndFrame, RGB(0, 0, 0), 0)->arg = copy;
+    // with nowhere to record it, the frame carries on into the next one
+    if(!commitCommand())
+        return;
+    recordedFrames = recordedFrames + 1;
+
+#if defined(ESP32)
+    if(rendererTask)
+        xTaskNotifyGive(rendererTask);
+#endif
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::beginStatic(void) {
+    allocateCommand(opBeginStatic, RGB(0, 0, 0), 0);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::endStatic(void) {
+    allocateCommand(opEndStatic, RGB(0, 0, 0), 0);
+    commitCommand();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::drawCommand(const smDisplayListCommand & command) {
+    const int16_t * p = command.p;
+
+    switch(command.op) {
+        case opFillScreen:              layer->fillScreen(command.color); break;
+        case opDrawPixel:               layer->drawPixel(p[0], p[1], command.color); break;
+        case opDrawLine:                layer->drawLine(p[0], p[1], p[2], p[3], command.color); break;
+        case opDrawFastVLine:           layer->drawFastVLine(p[0], p[1], p[2], command.color); break;
+        case opDrawFastHLine:           layer->drawFastHLine(p[0], p[1], p[2], command.color); break;
+        case opDrawCircle:              layer->drawCircle(p[0], p[1], p[2], command.color); break;
+        case opFillCircle:              layer->fillCircle(p[0], p[1], p[2], command.color); break;
+        case opFillCircleOutline:       layer->fillCircle(p[0], p[1], p[2], command.color, command.color2); break;
+        case opDrawEllipse:             layer->drawEllipse(p[0], p[1], p[2], p[3], command.color); break;
+        case opDrawTriangle:            layer->drawTriangle(p[0], p[1], p[2], p[3], p[4], p[5], command.color); break;
+        case opFillTriangle:            layer->fillTriangle(p[0], p[1], p[2], p[3], p[4], p[5], command.color); break;
+        case opDrawRectangle:           layer->drawRectangle(p[0], p[1], p[2], p[3], command.color); break;
+        case opFillRectangle:           layer->fillRectangle(p[0], p[1], p[2], p[3], command.color); break;
+        case opFillRectangleOutline:    layer->fillRectangle(p[0], p[1], p[2], p[3], command.color, command.color2); break;
+        case opDrawRoundRectangle:      layer->drawRoundRectangle(p[0], p[1], p[2], p[3], p[4], command.color); break;
+        case opFillRoundRectangle:      layer->fillRoundRectangle(p[0], p[1], p[2], p[3], p[4], command.color); break;
+        case opDrawString:              layer->drawString(p[0], p[1], command.color, command.text); break;
+        case opDrawStringBackColor:     layer->drawString(p[0], p[1], command.color, command.color2, command.text); break;
+        case opDrawBitmap:
+            layer->drawBitmap(p[0], p[1], p[2], p[3], command.bitmap.src, (smBitmapFormat)command.arg, p[4], command.bitmap.palette);
+            break;
+        case opDrawBitmapScaled:
+            layer->drawBitmapScaled(p[0], p[1], p[2], p[3], command.bitmap.src, p[4], p[5], (smBitmapFormat)(command.arg & 0x0f),
+                (smScaleMode)(command.arg >> 4), p[6], command.bitmap.palette);
+            break;
+        case opSetFont:
+            font = (fontChoices)command.arg;
+            fontSet = true;
+            layer->setFont(font);
+            break;
+        default:
+            break;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::replayStatic(void) {
+    for(int i = 0; i < numStatic; i++)
+        drawCommand(staticCommands[i]);
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMDisplayList<RGB, optionFlags>::render(void) {
+    while(tail != head) {
+        __sync_synchronize();
+        const smDisplayListCommand & command = ring[tail % ringSize];
+
+        // the static part is replayed before a frame's first command, unless the frame starts by replacing it
+        if(!frameOpen) {
+            frameOpen = true;
+            frameStartMicros = micros();
+            if(command.op != opBeginStatic)
+                replayStatic();
+        }
+
+        bool swapped = false;
+        switch(command.op) {
+            case opBeginStatic:
+                recordingStatic = true;
+                numStatic = 0;
+                if(fontSet) {
+                    staticCommands[0].op = opSetFont;
+                    staticCommands[0].arg = font;
+                    numStatic = 1;
+                }
+                break;
+            case opEndStatic:
+                recordingStatic = false;
+                break;
+            case opEndFrame:
+                stats.lastRenderMicros = micros() - frameStartMicros;
+                layer->swapBuffers(command.arg);
+                stats.frames++;
+                frameOpen = false;
+                swapped = true;
+                break;
+            default:
+                if(recordingStatic) {
+                    if(numStatic < maxStatic)
+                        staticCommands[numStatic++] = command;
+                    else
+                        Serial.println("Error: SMDisplayList static part is full");
+                }
+                drawCommand(command);
+                stats.commands++;
+                break;
+        }
+
+        // the slot can be reused once tail moves past it
+        __sync_synchronize();
+        tail = tail + 1;
+
+        if(swapped) {
+            renderedFrames = renderedFrames + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(ESP32)
+template <typename RGB, unsigned int optionFlags>
+bool SMDisplayList<RGB, optionFlags>::startRenderer(int core, UBaseType_t priority) {
+    if(!ring || rendererRunning)
+        return false;
+
+    if(core < 0)
+        core = !xPortGetCoreID();
+
+    rendererStopRequested = false;
+    rendererRunning = true;
+    if(xTaskCreatePinnedToCore(rendererTaskFunction, "SmartMatrixList", 3000, this, priority, &rendererTask, core) != pdPASS) {
+        rendererRunning = false;
+        rendererTask = NULL;
+        Serial.println("Error: SMDisplayList can't create renderer task");
+        return false;
+    }
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::stopRenderer(void) {
+    rendererStopRequested = true;
+    if(rendererTask)
+        xTaskNotifyGive(rendererTask);
+    while(rendererRunning)
+        vTaskDelay(1);
+    rendererTask = NULL;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::rendererTaskFunction(void * displayList) {
+    ((SMDisplayList<RGB, optionFlags> *)displayList)->runRenderer();
+    vTaskDelete(NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMDisplayList<RGB, optionFlags>::runRenderer(void) {
+    while(!rendererStopRequested) {
+        // commands are drawn as they arrive, endFrame() wakes the task right away, and the timeout picks up a ring filled mid-frame
+        if(!render())
+            ulTaskNotifyTake(pdTRUE, 1);
+    }
+    rendererRunning = false;
+}
+#endif
@@ -24,8 +24,8 @@
 #ifndef SmartMatrixHUB75Calc_h
 #define SmartMatrixHUB75Calc_h
 
-extern SemaphoreHandle_t calcTaskSemaphore;
-extern void matrixCalculationsSignal(void);
+// with SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE, rows are split between a calc task on each core
+#define ESP32_NUM_CALC_TASKS    2
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixHub75Calc {
@@ -38,10 +38,27 @@ public:
     SmartMatrixHub75Calc(void);
     void begin(uint32_t dmaRamToKeepFreeBytes = 0);
     void addLayer(SM_Layer * newlayer);
+    // layers can be changed while refreshing, refresh picks up the new set at the start of the next frame, see smLayerChain
+    void removeLayer(SM_Layer * layer);
+    // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+    void moveLayer(SM_Layer * layer, SM_Layer * belowLayer);
+    void setLayerVisible(SM_Layer * layer, bool visible);
 
     // configuration
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
+    // fades the global brightness from its current value to targetBrightness, stepped by the calc each calculated frame
+    // the OE timing is packed into the frame, so the frame is repacked (and layers refilled) each time the fade reaches a new OE width
+    // setBrightness() cancels a running fade
+    void fadeBrightness(uint8_t targetBrightness, uint16_t durationMs);
+    // economy mode for OTA updates and network bursts: layers only advance to a new frame every updateIntervalMs (0 = frozen, a
+    // swapBuffers() waits until economy mode ends), between updates the calc packs nothing and DMA keeps showing the last frame
+    void setEconomyMode(bool enabled, uint16_t updateIntervalMs = 0);
+    bool getEconomyMode(void);
+    // per-panel calibration for panels that don't match in brightness or white point: the channels of the panel panelColumn across
+    // and panelRow down (COLS_PER_PANEL x MATRIX_PANEL_HEIGHT panels, in hardware orientation) are scaled by gain, 255 = no change
+    void setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain);
+    void clearPanelGains(void);
     void setRefreshRate(uint16_t newRefreshRate);
 
     // get info
@@ -51,9 +68,57 @@ public:
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
     void setMaxCalculationCpuPercentage(uint8_t newMaxCpuPercentage);
+    // the governor steers the calc rate toward frameRate calculated frames per second (0 = as fast as the CPU percentage allows)
+    // while staying under the max CPU percentage
+    void setCalcFrameRateTarget(uint16_t frameRate);
+    // the divider, calc rate, and average CPU percentage as currently chosen by the governor
+    void getCalcGovernorState(smCalcGovernor & state);
+    // idle work, see smIdleWork: the calc task calls callback(context, budgetMicros) in the time left before the next refresh frame,
+    // maxBudgetMicros (0 = all of it) caps each call, returns false if all SM_IDLE_WORK_MAX_CALLBACKS slots are in use
+    // callbacks run at the calc task's priority on its core, with SMARTMATRIX_FLASH_SAFE_REFRESH they should be in IRAM too
+    bool addIdleWork(smIdleWorkCallback callback, void * context = NULL, uint32_t maxBudgetMicros = 0);
+    void removeIdleWork(smIdleWorkCallback callback, void * context = NULL);
+    // calls that returned after their budget ran out, and the total time spent in idle work
+    uint32_t getIdleWorkOverruns(void);
+    uint32_t getIdleWorkMicros(void);
+    // changes the refresh timing while running: the lowest lsbMsbTransitionBit that reaches minRefreshRate, or a fixed lsbMsbTransitionBit
+    // (lower values show more bitplanes with binary timing, needing more descriptors and a lower refresh rate)
+    // applied at the next calculated frame, which is repacked and shown with the new descriptors, without blanking the display
+    // the frame buffers aren't reallocated, check getRefreshRate() afterwards, the old timing is kept if there isn't enough DMA RAM
+    void reconfigure(uint16_t minRefreshRate, int8_t lsbMsbTransitionBit = -1);
+
+    // frame events, a frame is counted each time the calc runs and no layer has a swap waiting: frames with nothing to repack count,
+    // frames held by economy mode or frame sync don't
+    void setFrameCallback(smFrameCallback callback);
+    uint32_t getFrameCount(void);
+    // readback tap for screenshots, see smReadbackTap: every intervalFrames-th calculated frame is copied into buffer as the rows are
+    // filled, buffer holds SM_READBACK_BUFFER_PIXELS(matrixWidth, matrixHeight, scaleShift) pixels, NULL stops the copies
+    void setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift = 0, uint16_t intervalFrames = 1);
+    // frames fully copied to the readback buffer, a change means it holds a complete frame
+    uint32_t getReadbackFrameCount(void);
+    // sleeps until the next frame starts (a pending swapBuffers() has been taken), returns false after timeoutMs
+    bool waitForFrame(uint32_t timeoutMs);
+    // multi-controller frame sync, see smFrameSync: the master pulses an output pin at every frame start (-1 to stop), the
+    // others hold their frames for a pulse on an input pin, or for frameSyncPulse() calls from a network sync message
+    void setFrameSyncOutput(int8_t pin);
+    void setFrameSyncInput(int8_t pin);
+    void frameSyncPulse(void);
+    // microseconds this board's last frame started after the master's pulse, and frames lost to falling behind the master
+    int32_t getFrameSyncDrift(void);
+    uint32_t getFrameSyncMissedPulses(void);
+    // task gets an xTaskNotifyGive() every frame (NULL to stop), the event group gets SM_FRAME_EVENT_BIT set every frame
+    void setFrameNotifyTask(TaskHandle_t task);
+    EventGroupHandle_t getFrameEventGroup(void);
 
     // debug
     int countFPS(void);
+    void getProfilingStats(smProfilingStats & stats);
+    void resetProfilingStats(void);
+    // refresh ISR trace, empty unless SM_ISR_TRACE_ENABLED is 1: copies up to maxEntries of the latest events oldest first, returns the number copied
+    int getIsrTrace(smIsrTraceEntry * entries, int maxEntries);
+    // per ISR counts, durations and entry intervals, with the buffer fill level histogram and underrun count
+    void getIsrTraceSummary(smIsrTraceSummary & summary);
+    void resetIsrTrace(void);
 
     // functions called by ISR
     static void matrixCalculations(void);
@@ -63,15 +128,28 @@ public:
 
 private:
     static SM_Layer * baseLayer;
+    static smLayerChain layerChain;
+
+    // only the main calc task records the per-row stages, the helper task on the other core isn't measured
+    static smProfilingStats profilingStats;
 
-    static void * tempRow0Ptr;
-    static void * tempRow1Ptr;
+    // temporary buffers for loadMatrixBuffers, one set per calc task
+    static void * tempRow0Ptr[ESP32_NUM_CALC_TASKS];
+    static void * tempRow1Ptr[ESP32_NUM_CALC_TASKS];
+    static uint8_t * tempPlaneBitsPtr[ESP32_NUM_CALC_TASKS];
+    // RGB bits in the DMA data for each combination of the six channel bits produced by transposeChannelBits()
+    static MATRIX_DATA_STORAGE_TYPE rgbBitsLUT[64];
 
     // functions for refreshing
-    static void loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts = 0);
-    static void loadMatrixBuffers48(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
-    static void loadMatrixBuffers24(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
+    static void loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts = 0, int calcTaskIndex = 0, int numCalcTasks = 1);
+    static uint32_t getRefreshRowsForHardwareRows(uint16_t firstRow, uint16_t lastRow);
+    static void loadMatrixBuffers48(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0, int calcTaskIndex = 0);
+    static void loadMatrixBuffers24(frameStruct * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0, int calcTaskIndex = 0);
+    static void prefetchLayerRows(int currentRow, int rowGroup);
+    template <typename RGB> static void finishCompositedRows(int row, RGB * tempRow0, RGB * tempRow1, int numBrightnessShifts);
     static void calcTask(void* pvParameters);
+    static void updateCalcGovernor(uint32_t startMicros, uint32_t endMicros);
+    static void calcHelperTask(void* pvParameters);
     static void resetMultiRowRefreshMapPosition(void);
     static void resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void);
     static void advanceMultiRowRefreshMapToNextRow(void);
@@ -79,27 +157,71 @@ private:
     static int getMultiRowRefreshRowOffset(void);
     static int getMultiRowRefreshNumPixelsToMap(void);
     static int getMultiRowRefreshPixelGroupOffset(void);
+    static void calculateMultiRowRefreshTables(void);
+    static void transposeChannelBits(uint8_t r0, uint8_t g0, uint8_t b0, uint8_t r1, uint8_t g1, uint8_t b1, uint8_t * planeBits, int stride, int numPlanes);
     
     // configuration
     static volatile bool brightnessChange;
     static volatile bool rotationChange;
+    static smFrameEvents frameEvents;
+    static smFrameSync frameSync;
     static volatile bool dmaBufferUnderrun;
     static int brightness;
+    // brightness as set by the sketch (0-255), and the fade requested by fadeBrightness(), started by the calc at the next frame
+    static uint8_t requestedBrightness;
+    static volatile bool brightnessFadeStart;
+    static uint8_t brightnessFadeTarget;
+    static uint16_t brightnessFadeDurationMs;
+    static smBrightnessFade brightnessFade;
+    static smEconomyMode economyMode;
+    static smReadbackTap readbackTap;
+    // setPanelGain() table, only applied while enabled
+    static rgb24 panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+    static volatile bool panelGainsEnabled;
+    // the rows packed with the old gains have to be repacked
+    static volatile bool panelGainsChanged;
     static int shiftedBrightness;
     static rotationDegrees rotation;
     static uint16_t calc_refreshRate;   
     static uint8_t calc_refreshRateDivider;
     static bool dmaBufferUnderrunSinceLastCheck;
     static uint8_t maxCalcCpuPercentage;
+    static smCalcGovernor calcGovernor;
+    static smIdleWork idleWork;
     static bool refreshRateLowered;
     static bool refreshRateChanged;
     static uint8_t lsbMsbTransitionBit;
+    // reconfigure() request, taken by the calc when the next frame buffer is free
+    static volatile bool reconfigurePending;
+    static uint16_t reconfigureMinRefreshRate;
+    static int8_t reconfigureLsbMsbTransitionBit;
     static TaskHandle_t calcTaskHandle;
+    // given by the refresh's shift complete callback, one per calc class so another matrix's calc (e.g. the _NT classes) isn't woken
+    static SemaphoreHandle_t calcTaskSemaphore;
+    // held by calcTask while it calculates a frame, begin() again takes it so refresh is restarted between frames
+    static SemaphoreHandle_t calcTaskMutex;
+    static void matrixCalculationsSignal(void);
+    // SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE: helper task on the other core calculates every other row of the frame
+    static TaskHandle_t calcHelperTaskHandle;
+    static SemaphoreHandle_t calcHelperStartSemaphore;
+    static SemaphoreHandle_t calcHelperDoneSemaphore;
+    static int calcHelperNumBrightnessShifts;
+    // bitmask of refresh rows (currentRow 0..MATRIX_SCAN_MOD-1) that need to be repacked, the rest are copied from the previous frame
+    static uint32_t changedRefreshRows;
+    // brightness shifts the last frame was packed with, a change repacks every row
+    static int lastBrightnessShifts;
+    // counts calculated frames, selecting the dither pattern position with SM_HUB75_OPTIONS_TEMPORAL_DITHER
+    static unsigned int ditherFrame;
     
     static int multiRowRefresh_mapIndex_CurrentRowGroups;
     static int multiRowRefresh_mapIndex_CurrentPixelGroup;
     static int multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
     static int multiRowRefresh_NumPanelsAlreadyMapped;
+
+    // multi row refresh map expanded in begin(): row offset of each physical row group within a refresh row, and refresh buffer position of each temp buffer pixel
+    static int numMultiRowRefreshRowGroups;
+    static int16_t multiRowRefreshRowOffsetTable[PHYSICAL_ROWS_PER_REFRESH_ROW];
+    static uint16_t multiRowRefreshBufferPositionTable[MULTI_ROW_REFRESH_REQUIRED ? PHYSICAL_ROWS_PER_REFRESH_ROW : 1][MULTI_ROW_REFRESH_REQUIRED ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
 };
 
 #endif
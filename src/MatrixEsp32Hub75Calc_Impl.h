@@ -33,20 +33,35 @@ uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType,
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRateDivider = 2;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smCalcGovernor SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcGovernor;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smIdleWork SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::idleWork;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRate = 120/SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRateDivider;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SM_Layer * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smLayerChain SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::layerChain;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow0Ptr[ESP32_NUM_CALC_TASKS];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow1Ptr[ESP32_NUM_CALC_TASKS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow0Ptr;
+uint8_t * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempPlaneBitsPtr[ESP32_NUM_CALC_TASKS];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRow1Ptr;
+MATRIX_DATA_STORAGE_TYPE SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rgbBitsLUT[64];
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smProfilingStats SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::profilingStats;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunSinceLastCheck = false;
@@ -61,6 +76,15 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::lsbMsbTransitionBit;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigurePending = false;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigureMinRefreshRate;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigureLsbMsbTransitionBit;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
 
@@ -73,20 +97,37 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_NumPanelsAlreadyMapped = 0;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::numMultiRowRefreshRowGroups = 1;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefreshRowOffsetTable[PHYSICAL_ROWS_PER_REFRESH_ROW];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefreshBufferPositionTable[MULTI_ROW_REFRESH_REQUIRED ? PHYSICAL_ROWS_PER_REFRESH_ROW : 1][MULTI_ROW_REFRESH_REQUIRED ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Calc(void) {
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addLayer(SM_Layer * newlayer) {
-    if(baseLayer) {
-        SM_Layer * templayer = baseLayer;
-        while(templayer->nextLayer)
-            templayer = templayer->nextLayer;
-        templayer->nextLayer = newlayer;
-    } else {
-        baseLayer = newlayer;
-    }
+    layerChain.add(newlayer, rotation);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::removeLayer(SM_Layer * layer) {
+    layerChain.remove(layer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::moveLayer(SM_Layer * layer, SM_Layer * belowLayer) {
+    layerChain.move(layer, belowLayer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setLayerVisible(SM_Layer * layer, bool visible) {
+    layerChain.setVisible(layer, visible);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -109,15 +150,122 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     return ret;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameCallback(smFrameCallback callback) {
+    frameEvents.callback = callback;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameCount(void) {
+    return frameEvents.frameCount;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForFrame(uint32_t timeoutMs) {
+    return frameEvents.wait(timeoutMs);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain) {
+    if(panelColumn >= PANEL_GAIN_COLUMNS || panelRow >= PANEL_GAIN_ROWS)
+        return;
+
+    if(!panelGainsEnabled) {
+        for(int y = 0; y < PANEL_GAIN_ROWS; y++) {
+            for(int x = 0; x < PANEL_GAIN_COLUMNS; x++)
+                panelGains[y][x] = rgb24(255, 255, 255);
+        }
+    }
+    panelGains[panelRow][panelColumn] = gain;
+    panelGainsEnabled = true;
+    panelGainsChanged = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelGains(void) {
+    panelGainsEnabled = false;
+    panelGainsChanged = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift, uint16_t intervalFrames) {
+    readbackTap.setBuffer(buffer, matrixWidth, scaleShift, intervalFrames);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getReadbackFrameCount(void) {
+    return readbackTap.framesCaptured;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncOutput(int8_t pin) {
+    frameSync.setOutput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncInput(int8_t pin) {
+    frameSync.setInput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSyncPulse(void) {
+    frameSync.pulse();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncDrift(void) {
+    return frameSync.drift;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncMissedPulses(void) {
+    return frameSync.missedPulses;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameNotifyTask(TaskHandle_t task) {
+    frameEvents.notifyTask = task;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+EventGroupHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameEventGroup(void) {
+    return frameEvents.eventGroup;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getProfilingStats(smProfilingStats & stats) {
+    // copied while the calculations may be updating it, so values can be off by one sample
+    stats = profilingStats;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetProfilingStats(void) {
+    profilingStats.reset();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTrace(smIsrTraceEntry * entries, int maxEntries) {
+    return smGetIsrTrace().copy(entries, maxEntries);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTraceSummary(smIsrTraceSummary & summary) {
+    smGetIsrTrace().getSummary(summary);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetIsrTrace(void) {
+    smGetIsrTrace().reset();
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunCallback(void) {
     dmaBufferUnderrun = true;
+    SM_PROFILE_COUNT(profilingStats.dmaUnderruns);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalculations() {
-    static unsigned long lastMillisStart;
-    static unsigned long lastMillisEnd;
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalculations() {
     static int refreshFramesSinceLastCalculation = 0;
     SM_Layer * templayer;
     static bool firstRun = true;
@@ -127,19 +275,53 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
     refreshFramesSinceLastCalculation = 0;
 
-    // safety check - if using up too much CPU, increase refresh rate divider to give more time for sketch to run
-    unsigned long calculationCpuTime = lastMillisEnd - lastMillisStart;
-    unsigned long totalCpuTime = millis() - lastMillisStart;
-    if(totalCpuTime && ((calculationCpuTime * 100) / totalCpuTime) > SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::maxCalcCpuPercentage) {
-        // increase CPU divider by 1
-        SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcRefreshRateDivider(SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalcRefreshRateDivider() + 1);
-        refreshRateLowered = true;
-    }
-
     // only do calculations if there is free space (should be redundant, as we only get called if there is free space)
     if (!SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameBufferFree())
         return;
 
+    // economy mode: nothing is packed between updates, and DMA keeps showing the last frame
+    if (!economyMode.frameDue(millis()))
+        return;
+
+    // nothing is refreshing from the spare descriptors while the frame buffer is free, the next frame is packed for the new timing
+    bool reconfigured = false;
+    if (reconfigurePending) {
+        reconfigurePending = false;
+        if(SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigure(reconfigureMinRefreshRate, reconfigureLsbMsbTransitionBit)) {
+            lsbMsbTransitionBit = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getLsbMsbTransitionBit();
+            setCalcRefreshRateDivider(calc_refreshRateDivider);
+            reconfigured = true;
+        }
+    }
+
+    // with frame sync following a master, hold this frame until the master's pulse (or a timeout) so swaps line up across boards
+    if (!frameSync.frameStart())
+        return;
+
+    // a setBrightness() since the last frame cancels a running fade
+    if (brightnessFadeStart) {
+        brightnessFadeStart = false;
+        brightnessFade.start(requestedBrightness, brightnessFadeTarget, ((uint32_t)brightnessFadeDurationMs * calc_refreshRate) / 1000);
+    } else if (brightnessChange) {
+        brightnessFade.stop();
+    }
+    // only steps that reach a new OE width (0-PIXELS_PER_LATCH) need the frame repacked
+    if (brightnessFade.isRunning()) {
+        requestedBrightness = brightnessFade.step();
+        int fadedBrightness = (PIXELS_PER_LATCH*requestedBrightness)/255;
+        if (fadedBrightness != brightness) {
+            brightness = fadedBrightness;
+            brightnessChange = true;
+        }
+    }
+
+    // layers added, removed, moved or hidden since the last frame are picked up here, and need the per-frame setup
+    bool layersChanged = layerChain.publish(baseLayer);
+    if (layersChanged) {
+        rotationChange = true;
+        refreshRateChanged = true;
+    }
+
     templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
     bool refreshNeeded = false;
     while(templayer) {
@@ -149,13 +331,40 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
         templayer = templayer->nextLayer;
     }
 
-    if(!refreshNeeded && !firstRun)
+    // a new brightness is part of the packed frame, and has to be applied even if the layers didn't change
+    if(brightnessChange || reconfigured || layersChanged)
+        refreshNeeded = true;
+
+    // the first frame copied to a new readback buffer fills every row, later ones only copy the rows that changed
+    bool readbackFullFrame = readbackTap.startFrame() && readbackTap.fullFrameNeeded;
+    if(readbackFullFrame)
+        refreshNeeded = true;
+
+    // new panel gains apply to every row
+    bool panelGainsFullFrame = panelGainsChanged;
+    if(panelGainsFullFrame) {
+        panelGainsChanged = false;
+        refreshNeeded = true;
+    }
+
+    // dithering changes every row every frame, even if the layers didn't change
+    // no layer has a swap pending either, so this still counts as a frame for waitForFrame() and the frame callback
+    if(!refreshNeeded && !firstRun && !(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)) {
+        frameEvents.signal();
         return;
+    }
 
+    // the first frame, and anything that affects every row, repacks the full frame
+    bool fullFrameChanged = firstRun || reconfigured || layersChanged || readbackFullFrame || panelGainsFullFrame;
     firstRun = false;
 
-    // now we know we're actually going to update the frame, keep track of the time we started updating
-    lastMillisStart = millis();
+    // rows changed in a frame between captures are only copied by making the next captured frame full
+    readbackTap.framePacked();
+
+    if(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) {
+        ditherFrame++;
+        fullFrameChanged = true;
+    }
 
     // do once-per-frame updates
     if (rotationChange) {
@@ -165,9 +374,11 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
             templayer = templayer->nextLayer;
         }
         rotationChange = false;
+        fullFrameChanged = true;
     }
 
     int largestRequestedBrightnessShifts = 0;
+    uint32_t newChangedRefreshRows = 0;
 
     templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
     while(templayer) {
@@ -176,14 +387,29 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
         }
 
         templayer->frameRefreshCallback();
+#if (SM_PROFILING_ENABLED == 1)
+        uint32_t requestedMicros, pickedUpMicros;
+        if(templayer->getSwapLatencyMicros(requestedMicros, pickedUpMicros))
+            profilingStats.swapToPickup.add(pickedUpMicros - requestedMicros);
+#endif
 
         int tempval = templayer->getRequestedBrightnessShifts();
         if(tempval > largestRequestedBrightnessShifts)
             largestRequestedBrightnessShifts = tempval;
 
+        uint16_t firstChangedRow, lastChangedRow;
+        if(templayer->getChangedRows(firstChangedRow, lastChangedRow))
+            newChangedRefreshRows |= getRefreshRowsForHardwareRows(firstChangedRow, lastChangedRow);
+
         templayer = templayer->nextLayer;
     }
     refreshRateChanged = false;
+    frameEvents.signal();
+
+    if(largestRequestedBrightnessShifts != lastBrightnessShifts) {
+        lastBrightnessShifts = largestRequestedBrightnessShifts;
+        fullFrameChanged = true;
+    }
 
     int tempBrightness = brightness >> largestRequestedBrightnessShifts;
 
@@ -196,13 +422,35 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     if (brightnessChange) {
         SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(shiftedBrightness);
         brightnessChange = false;
+        fullFrameChanged = true;
     }
 
-    SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts);
+    if(fullFrameChanged)
+        newChangedRefreshRows = getRefreshRowsForHardwareRows(0, matrixHeight - 1);
 
-    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(0);
+    // nothing visible changed, keep displaying the previous frame
+    if(!newChangedRefreshRows)
+        return;
+
+    changedRefreshRows = newChangedRefreshRows;
+
+    if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE) {
+        // the helper task on the other core calculates the odd rows while this task calculates the even rows
+        // fillRefreshRow() runs on both cores at once: layers may only read their state there, or store values that are the same for every row of the frame
+        calcHelperNumBrightnessShifts = largestRequestedBrightnessShifts;
+        xSemaphoreGive(calcHelperStartSemaphore);
 
-    lastMillisEnd = millis();
+        SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts, 0, ESP32_NUM_CALC_TASKS);
+
+        // wait for the helper task to finish its rows before passing the frame to the refresh class
+        xSemaphoreTake(calcHelperDoneSemaphore, portMAX_DELAY);
+    } else {
+        SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts);
+    }
+
+    SM_PROFILE_START(writeStart);
+    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(0);
+    SM_PROFILE_END(writeStart, profilingStats.bufferWrite);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -234,6 +482,10 @@ volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, pane
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotationChange = true;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameEvents SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameEvents;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameSync SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSync;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::shiftedBrightness;
@@ -241,13 +493,54 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 // brightness scales from 0-PIXELS_PER_LATCH
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness = PIXELS_PER_LATCH;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::requestedBrightness = 255;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeStart = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeTarget;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeDurationMs;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smBrightnessFade SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFade;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smEconomyMode SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::economyMode;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smReadbackTap SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::readbackTap;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+rgb24 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGainsEnabled = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGainsChanged = false;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
+    brightnessFadeStart = false;
+    requestedBrightness = newBrightness;
     brightness = (PIXELS_PER_LATCH*newBrightness)/255;
     brightnessChange = true;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::fadeBrightness(uint8_t targetBrightness, uint16_t durationMs) {
+    brightnessFadeTarget = targetBrightness;
+    brightnessFadeDurationMs = durationMs;
+    brightnessFadeStart = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setEconomyMode(bool enabled, uint16_t updateIntervalMs) {
+    economyMode.intervalMs = updateIntervalMs;
+    economyMode.lastUpdateMillis = millis();
+    economyMode.enabled = enabled;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getEconomyMode(void) {
+    return economyMode.enabled;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(uint16_t newRefreshRate) {
     calc_refreshRate = newRefreshRate / calc_refreshRateDivider;
@@ -265,7 +558,61 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcRefreshRateDivider(uint8_t newDivider) {
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcFrameRateTarget(uint16_t frameRate) {
+    calcGovernor.targetFrameRate = frameRate;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalcGovernorState(smCalcGovernor & state) {
+    state = calcGovernor;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addIdleWork(smIdleWorkCallback callback, void * context, uint32_t maxBudgetMicros) {
+    return idleWork.add(callback, context, maxBudgetMicros);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::removeIdleWork(smIdleWorkCallback callback, void * context) {
+    idleWork.remove(callback, context);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIdleWorkOverruns(void) {
+    return idleWork.overruns;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIdleWorkMicros(void) {
+    return idleWork.microsUsed;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigure(uint16_t minRefreshRate, int8_t lsbMsbTransitionBit) {
+    reconfigureMinRefreshRate = minRefreshRate;
+    reconfigureLsbMsbTransitionBit = lsbMsbTransitionBit;
+    reconfigurePending = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::updateCalcGovernor(uint32_t startMicros, uint32_t endMicros) {
+    calcGovernor.maxCpuPercent = maxCalcCpuPercentage;
+    calcGovernor.divider = calc_refreshRateDivider;
+    calcGovernor.calcRefreshRate = calc_refreshRate;
+
+    uint8_t newDivider = calcGovernor.update(startMicros, endMicros, SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRate());
+    if(newDivider == calc_refreshRateDivider)
+        return;
+
+    if(newDivider > calc_refreshRateDivider)
+        refreshRateLowered = true;
+    setCalcRefreshRateDivider(newDivider);
+    calcGovernor.divider = calc_refreshRateDivider;
+    calcGovernor.calcRefreshRate = calc_refreshRate;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setCalcRefreshRateDivider(uint8_t newDivider) {
     // TODO: improve so fractional results don't screw up the calc_refreshRate divider
     // TODO: improve to get actual refresh rate from refresh class
     if(newDivider == 0)
@@ -306,14 +653,42 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 TaskHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTaskHandle;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTaskSemaphore;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTaskMutex;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+TaskHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcHelperTaskHandle;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcHelperStartSemaphore;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+SemaphoreHandle_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcHelperDoneSemaphore;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcHelperNumBrightnessShifts = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::changedRefreshRows;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::lastBrightnessShifts = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+unsigned int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrame = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void IRAM_ATTR SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalculationsSignal(void) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    // Unblock the task by releasing the semaphore.
+    xSemaphoreGiveFromISR(calcTaskSemaphore, &xHigherPriorityTaskWoken);
+}
 
 /* Task2 with priority 2 */
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTask(void* pvParameters)
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcTask(void* pvParameters)
 {        
     static long lastMillis = 0;
     while(1) {   
+        SM_PROFILE_START(waitStart);
         if( xSemaphoreTake(calcTaskSemaphore, portMAX_DELAY) == pdTRUE ) {
+            SM_PROFILE_END(waitStart, profilingStats.waitForFreeBuffer);
+            xSemaphoreTake(calcTaskMutex, portMAX_DELAY);
 #ifdef DEBUG_PINS_ENABLED
             gpio_set_level(DEBUG_1_GPIO, 1);
 #endif
@@ -328,8 +703,18 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
             // we usually do this with an ISR in the refresh class, but ESP32 doesn't let us store a templated method in IRAM (at least not easily) so we call this from the calc task
             SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markRefreshComplete();
 
+            // the governor sees every call, including refresh frames that weren't calculated, so its average is the calc share of the core
+            uint32_t calcStart = micros();
             matrixCalculations();
+            updateCalcGovernor(calcStart, micros());
 
+            // idle work gets what's left of this refresh frame, as measured by the governor, unless the next frame has already signaled
+            if(calcGovernor.intervalMicros > SM_IDLE_WORK_MARGIN_MICROS) {
+                idleWork.run(calcStart + calcGovernor.intervalMicros - SM_IDLE_WORK_MARGIN_MICROS,
+                    []() { return uxSemaphoreGetCount(calcTaskSemaphore) > 0; }, []() { return (uint32_t)micros(); });
+            }
+
+            xSemaphoreGive(calcTaskMutex);
 #ifdef DEBUG_PINS_ENABLED
             gpio_set_level(DEBUG_1_GPIO, 0);
 #endif
@@ -337,84 +722,189 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcHelperTask(void* pvParameters)
+{
+    while(1) {
+        if( xSemaphoreTake(calcHelperStartSemaphore, portMAX_DELAY) == pdTRUE ) {
+            loadMatrixBuffers(lsbMsbTransitionBit, calcHelperNumBrightnessShifts, 1, ESP32_NUM_CALC_TASKS);
+
+            xSemaphoreGive(calcHelperDoneSemaphore);
+        }
+    }
+}
+
 #define MATRIX_CALC_TASK_DEFAULT_PRIORITY   2
 #define MATRIX_CALC_TASK_LOW_PRIORITY      1
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(uint32_t dmaRamToKeepFreeBytes)
 {
-    printf("\r\nStarting SmartMatrix Mallocs\r\n");
-    show_esp32_all_mem();
+    // begin() again: let the frame being calculated finish, then stop refresh before its DMA arena is reused or freed
+    // the tasks and semaphores from the first begin() are kept, calcTask waits on the mutex until refresh is running again
+    bool restarting = (calcTaskHandle != NULL);
+    if(restarting) {
+        xSemaphoreTake(calcTaskMutex, portMAX_DELAY);
+        SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stop();
+        xSemaphoreTake(calcTaskSemaphore, 0);
+    }
 
-    SM_Layer * templayer = baseLayer;
-    while(templayer) {
-        templayer->begin();
-        templayer = templayer->nextLayer;
+    SM_BEGIN_PRINTF("\r\nStarting SmartMatrix Mallocs\r\n");
+    SM_BEGIN_SHOW_MEM();
+
+    frameEvents.begin();
+
+    layerChain.begin();
+    layerChain.publish(baseLayer);
+
+    calculateMultiRowRefreshTables();
+
+    // lookup table from a bitplane's channel bits (see transposeChannelBits) to the RGB bits in the DMA data
+    for(int i=0; i<64; i++) {
+        MATRIX_DATA_STORAGE_TYPE v = 0;
+        if(i & 0x01) v|=BIT_R1;
+        if(i & 0x02) v|=BIT_G1;
+        if(i & 0x04) v|=BIT_B1;
+        if(i & 0x08) v|=BIT_R2;
+        if(i & 0x10) v|=BIT_G2;
+        if(i & 0x20) v|=BIT_B2;
+        rgbBitsLUT[i] = v;
     }
 
-    calcTaskSemaphore = xSemaphoreCreateBinary();
+    if(!restarting) {
+        calcTaskSemaphore = xSemaphoreCreateBinary();
+        calcTaskMutex = xSemaphoreCreateMutex();
 
-    int taskPriority = MATRIX_CALC_TASK_DEFAULT_PRIORITY;
-    if(optionFlags & SMARTMATRIX_OPTIONS_MATRIXCALC_LOWPRIORITY)
-        taskPriority = MATRIX_CALC_TASK_LOW_PRIORITY;
+        int taskPriority = MATRIX_CALC_TASK_DEFAULT_PRIORITY;
+        if(optionFlags & SMARTMATRIX_OPTIONS_MATRIXCALC_LOWPRIORITY)
+            taskPriority = MATRIX_CALC_TASK_LOW_PRIORITY;
 
-    // by default run on core 0, leaving more room for the main Arduino task on core 1
-    int calcTaskCore = 0;
-    if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1)
-        calcTaskCore = 1;
+        // by default run on core 0, leaving more room for the main Arduino task on core 1
+        int calcTaskCore = 0;
+        if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1)
+            calcTaskCore = 1;
 
-    // TODO: fine tune stack size: 1000 works with 64x64/32-24bit, 500 doesn't, does it change based on matrix size, depth?
-    xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", 1000, NULL, taskPriority, &calcTaskHandle, calcTaskCore);
+        // TODO: fine tune stack size: 1000 works with 64x64/32-24bit, 500 doesn't, does it change based on matrix size, depth?
+        xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", 1000, NULL, taskPriority, &calcTaskHandle, calcTaskCore);
 
-    printf("SmartMatrix Layers Allocated from Heap:\r\n");
+        // optionally use the other core to calculate half of the rows in each frame
+        if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE) {
+            calcHelperStartSemaphore = xSemaphoreCreateBinary();
+            calcHelperDoneSemaphore = xSemaphoreCreateBinary();
+            xTaskCreatePinnedToCore(calcHelperTask, "SmartMatrixCalc2", 1000, NULL, taskPriority, &calcHelperTaskHandle, !calcTaskCore);
+        }
+    }
+
+    SM_BEGIN_PRINTF("SmartMatrix Layers Allocated from Heap:\r\n");
+#if (SM_ESP32_BEGIN_DIAGNOSTICS == 1)
     show_esp32_heap_mem();
+#endif
 
 #if defined(ESP32)
-    // malloc temporary buffers needed for loadMatrixBuffers
+    // temporary buffers needed for loadMatrixBuffers are placed in the refresh class's DMA arena, so begin() reserves one block for everything
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
-    if((COLOR_DEPTH_BITS == 12) || (COLOR_DEPTH_BITS == 16)){
-        tempRow0Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
-        tempRow1Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
-    } else {
-        tempRow0Ptr = malloc(sizeof(rgb24) * numPixelsPerTempRow);
-        tempRow1Ptr = malloc(sizeof(rgb24) * numPixelsPerTempRow);
-    }
+    int numCalcTasks = (optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE) ? ESP32_NUM_CALC_TASKS : 1;
 
-    assert(tempRow0Ptr != NULL);
-    assert(tempRow1Ptr != NULL);
-#endif
+    const size_t alignMask = ESP32_DMA_ARENA_ALIGNMENT - 1;
+    bool tempRows48 = (COLOR_DEPTH_BITS == 12) || (COLOR_DEPTH_BITS == 16) || (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER);
+    size_t tempRowBytes = ((tempRows48 ? sizeof(rgb48) : sizeof(rgb24)) * numPixelsPerTempRow + alignMask) & ~alignMask;
+    size_t tempPlaneBitsBytes = (COLOR_DEPTH_BITS * numPixelsPerTempRow + alignMask) & ~alignMask;
+    size_t bytesPerCalcTask = 2 * tempRowBytes + tempPlaneBitsBytes;
 
-    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculationsSignal);
-    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(dmaRamToKeepFreeBytes);
+    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(dmaRamToKeepFreeBytes, numCalcTasks * bytesPerCalcTask);
+
+    uint8_t * calcBuffer = (uint8_t *)SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalcBuffer();
+    assert(calcBuffer != NULL);
+
+    for(int t=0; t<numCalcTasks; t++) {
+        tempRow0Ptr[t] = calcBuffer;
+        tempRow1Ptr[t] = calcBuffer + tempRowBytes;
+        tempPlaneBitsPtr[t] = calcBuffer + 2 * tempRowBytes;
+        calcBuffer += bytesPerCalcTask;
+    }
+#endif
 
     // refresh rate is now set, update calc refresh rate
     setCalcRefreshRateDivider(calc_refreshRateDivider);
     lsbMsbTransitionBit = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getLsbMsbTransitionBit();
 
-    // wait for matrixCalculations to be run for first time inside calcTask - fill initial buffer and set Layer properties that are only set after first pass through matrixCalculations()
-    while(rotationChange) {
-        delay(1);
+    // layer rotation and refresh rate are set up here instead of on the first pass through matrixCalculations(), so begin() doesn't wait for the first frame
+    SM_Layer * templayer = baseLayer;
+    while(templayer) {
+        templayer->setRotation(rotation);
+        templayer->setRefreshRate(calc_refreshRate);
+        templayer = templayer->nextLayer;
     }
+    rotationChange = false;
+
+    // DMA is already running, but matrixCalculations() isn't triggered until the temp buffers are in place
+    SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculationsSignal);
+
+    if(restarting)
+        xSemaphoreGive(calcTaskMutex);
+
+    // the first frame is filled by calcTask once DMA asks for it, begin() returns without waiting for it
 }
 
 #define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPosition(void) {   
+uint32_t SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRowsForHardwareRows(uint16_t firstRow, uint16_t lastRow) {
+    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+    const uint32_t allRefreshRows = 0xFFFFFFFF >> (32 - MATRIX_SCAN_MOD);
+    uint32_t refreshRows = 0;
+
+    if(firstRow > lastRow)
+        return 0;
+
+    // every row within a panel is covered
+    if(lastRow - firstRow + 1 >= MATRIX_PANEL_HEIGHT)
+        return allRefreshRows;
+
+    // loadMatrixBuffers48/24 fill hardware row y from refresh row currentRow where (y % MATRIX_PANEL_HEIGHT) is
+    // (currentRow + rowOffset) or (MATRIX_SCAN_MOD - (currentRow + rowOffset) - 1) for upside down C-shape stacks,
+    // plus ROW_PAIR_OFFSET for the second row of the pair.  Mark every refresh row that could match (a superset is fine)
+    for(int y = firstRow; y <= lastRow; y++) {
+        int panelRow = y % MATRIX_PANEL_HEIGHT;
+
+        for(int pair = 0; pair < 2; pair++) {
+            int q = panelRow - (pair ? ROW_PAIR_OFFSET : 0);
+            if(q < 0)
+                continue;
+
+            for(int flip = 0; flip < ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) ? 2 : 1); flip++) {
+                int x = flip ? (MATRIX_SCAN_MOD - q - 1) : q;
+
+                int i = 0;
+                do {
+                    int r = x - map[i].rowOffset;
+                    if(r >= 0 && r < MATRIX_SCAN_MOD)
+                        refreshRows |= (1UL << r);
+                } while(!IS_LAST_PANEL_MAP_ENTRY(map[i++]));
+            }
+        }
+    }
+
+    return refreshRows;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPosition(void) {   
     multiRowRefresh_mapIndex_CurrentRowGroups = 0;
     resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
     multiRowRefresh_mapIndex_CurrentPixelGroup = multiRowRefresh_mapIndex_CurrentRowGroups;
     multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
     multiRowRefresh_NumPanelsAlreadyMapped = 0;
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextRow(void) {   
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextRow(void) {   
     static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
 
     int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;
@@ -431,7 +921,7 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
     static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
 
     int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentPixelGroup].rowOffset;
@@ -459,7 +949,7 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
 // returns the row offset from the map, or -1 if we've gone through the whole map already
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshRowOffset(void) {   
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshRowOffset(void) {   
     static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
 
     if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])){
@@ -470,28 +960,158 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshNumPixelsToMap(void) {        
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshNumPixelsToMap(void) {        
     static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
 
     return map[multiRowRefresh_mapIndex_CurrentPixelGroup].numPixels;    
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshPixelGroupOffset(void) {        
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMultiRowRefreshPixelGroupOffset(void) {        
     static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
 
     return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calculateMultiRowRefreshTables(void) {
+    /*  Walk the multi row refresh map once, the same way loadMatrixBuffers used to for every refresh row, and record
+        the row offset of each physical row group and the refresh buffer position of each pixel in the temp buffer.
+        Pixel block direction and the offset from panels already mapped are folded into the positions, so packing
+        is a straight lookup per pixel */
+    const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
+    int multiRowRefreshRowOffset = 0;
+
+    numMultiRowRefreshRowGroups = 0;
+    resetMultiRowRefreshMapPosition();
+
+    do {
+        multiRowRefreshRowOffsetTable[numMultiRowRefreshRowGroups] = multiRowRefreshRowOffset;
+
+        if(MULTI_ROW_REFRESH_REQUIRED) {
+            int i = 0;
+
+            // start filling from the first panel again
+            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+
+            while(i < numPixelsPerTempRow) {
+                // get number of pixels to go through with current pass
+                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+
+                bool reversePixelBlock = false;
+                if(numPixelsToMap < 0) {
+                    reversePixelBlock = true;
+                    numPixelsToMap = abs(numPixelsToMap);
+                }
+
+                // get offset where pixels are written in the refresh buffer
+                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+
+                for(int k=0; (k < numPixelsToMap) && (i+k < numPixelsPerTempRow); k++) {
+                    if(reversePixelBlock) {
+                        multiRowRefreshBufferPositionTable[numMultiRowRefreshRowGroups][i+k] = currentMapOffset-k;
+                    } else {
+                        multiRowRefreshBufferPositionTable[numMultiRowRefreshRowGroups][i+k] = currentMapOffset+k;
+                    }
+                }
+
+                i += numPixelsToMap; // keep track of current position on this temp buffer
+                advanceMultiRowRefreshMapToNextPixelGroup();
+            }
+        }
+
+        numMultiRowRefreshRowGroups++;
+
+        advanceMultiRowRefreshMapToNextRow();
+        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
+    } while ((multiRowRefreshRowOffset > 0) && (numMultiRowRefreshRowGroups < PHYSICAL_ROWS_PER_REFRESH_ROW));
+}
+
 #define REFRESH_PRINTFS 0
 
 //#define OEPWM_TEST_ENABLE // this is likely broken now
 #define OEPWM_THRESHOLD_BIT 1
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::transposeChannelBits(uint8_t r0, uint8_t g0, uint8_t b0, uint8_t r1, uint8_t g1, uint8_t b1, uint8_t * planeBits, int stride, int numPlanes) {
+    // treat the six channels as rows of an 8x8 bit matrix and transpose it, byte n of the result holds bit n of every channel:
+    // bit 0 = r0, bit 1 = g0, bit 2 = b0, bit 3 = r1, bit 4 = g1, bit 5 = b1, matching the index into rgbBitsLUT
+    uint32_t lo = r0 | (g0 << 8) | (b0 << 16) | ((uint32_t)r1 << 24);
+    uint32_t hi = g1 | (b1 << 8);
+    uint32_t t;
+
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA;  lo = lo ^ t ^ (t << 7);
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA;  hi = hi ^ t ^ (t << 7);
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo = lo ^ t ^ (t << 14);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi = hi ^ t ^ (t << 14);
+    t = (lo ^ (hi << 4)) & 0xF0F0F0F0;  lo = lo ^ t;    hi = hi ^ (t >> 4);
+
+    for(int n=0; n < 8 && n < numPlanes; n++)
+        planeBits[n * stride] = (n < 4) ? (lo >> (8 * n)) : (hi >> (8 * (n - 4)));
+}
+
+// matches the hardware rows requested by the fillRefreshRow() calls in loadMatrixBuffers48/24, a mismatch only costs a cache miss
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::prefetchLayerRows(int currentRow, int rowGroup) {
+    int row = currentRow + multiRowRefreshRowOffsetTable[rowGroup];
+    int flippedRow = MATRIX_SCAN_MOD - row - 1;
+
+    SM_Layer * templayer = baseLayer;
+    while(templayer) {
+        for(int i=0; i<MATRIX_STACK_HEIGHT; i++) {
+            int stackRow;
+            if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING))
+                stackRow = (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING) ? row + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT : row + i*MATRIX_PANEL_HEIGHT;
+            else if(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)
+                stackRow = ((MATRIX_STACK_HEIGHT-i+1)%2) ? flippedRow + i*MATRIX_PANEL_HEIGHT : row + i*MATRIX_PANEL_HEIGHT;
+            else
+                stackRow = ((MATRIX_STACK_HEIGHT-i)%2) ? row + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT : flippedRow + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT;
+
+            templayer->prefetchRefreshRow(stackRow);
+            templayer->prefetchRefreshRow(stackRow + ROW_PAIR_OFFSET);
+        }
+        templayer = templayer->nextLayer;
+    }
+}
+
+// copies the composited temp rows to the readback buffer, then applies the per-panel calibration
+// the hardware rows are worked out the same way as in loadMatrixBuffers48/24
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+template <typename RGB>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::finishCompositedRows(int row, RGB * tempRow0, RGB * tempRow1, int numBrightnessShifts) {
+    int flippedRow = MATRIX_SCAN_MOD - row - 1;
+
+    for(int i=0; i<MATRIX_STACK_HEIGHT; i++) {
+        int y0, y1;
+        if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING)) {
+            y0 = (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING) ? row + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT : row + i*MATRIX_PANEL_HEIGHT;
+            y1 = y0 + ROW_PAIR_OFFSET;
+        } else {
+            int stackOffset = (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING) ? i*MATRIX_PANEL_HEIGHT : (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT;
+            bool flipped = (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING) ? ((MATRIX_STACK_HEIGHT-i+1)%2) : !((MATRIX_STACK_HEIGHT-i)%2);
+            if(flipped) {
+                y1 = flippedRow + stackOffset;
+                y0 = y1 + ROW_PAIR_OFFSET;
+            } else {
+                y0 = row + stackOffset;
+                y1 = y0 + ROW_PAIR_OFFSET;
+            }
+        }
+        if(readbackTap.capturing) {
+            readbackTap.captureRow(y0, &tempRow0[i*matrixWidth], numBrightnessShifts);
+            readbackTap.captureRow(y1, &tempRow1[i*matrixWidth], numBrightnessShifts);
+        }
+        // y0 and y1 are always on the same panel
+        if(panelGainsEnabled) {
+            applyPanelGains(&tempRow0[i*matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[y0 / MATRIX_PANEL_HEIGHT]);
+            applyPanelGains(&tempRow1[i*matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[y0 / MATRIX_PANEL_HEIGHT]);
+        }
+    }
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts, int calcTaskIndex) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
 #if (REFRESH_PRINTFS >= 1)
@@ -500,22 +1120,27 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 
 #if defined(ESP32)
     // use buffers malloc'd previously
-    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr;
-    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr;
+    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr[calcTaskIndex];
+    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr[calcTaskIndex];
+    uint8_t * tempPlaneBits = tempPlaneBitsPtr[calcTaskIndex];
 #else
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[numPixelsPerTempRow];
     static rgb48 tempRow1[numPixelsPerTempRow];
+    static uint8_t tempPlaneBits[COLOR_DEPTH_BITS * numPixelsPerTempRow];
 #endif
 
     int c = 0;
-    resetMultiRowRefreshMapPosition();
 
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset(tempRow0, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
-        memset(tempRow1, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
+    for(int rowGroup = 0; rowGroup < numMultiRowRefreshRowGroups; rowGroup++) {
+        int multiRowRefreshRowOffset = multiRowRefreshRowOffsetTable[rowGroup];
+
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        if (!baseLayer || !baseLayer->isLayerOpaque()) {
+            memset(tempRow0, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
+            memset(tempRow1, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
+        }
 
 #if (REFRESH_PRINTFS >= 1)
         printf("multiRowRefreshRowOffset = %d\r\n", multiRowRefreshRowOffset);
@@ -523,224 +1148,214 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 
         // get a row of physical pixel data (HUB75 paired) from the layers
         SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+        int layerIndex = 0;
         while(templayer) {
+            SM_PROFILE_START(layerStart);
             for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
                 // Z-shape, bottom to top
                 if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // Z-shape, top to bottom
                 } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // C-shape, bottom to top
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // alternate direction of filling (or loading) for each matrixwidth
                     // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
                     if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 // C-shape, top to bottom
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     if((MATRIX_STACK_HEIGHT-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 }
             }
-            templayer = templayer->nextLayer;        
+            if(!calcTaskIndex)
+                SM_PROFILE_END(layerStart, profilingStats.layerFill[layerIndex]);
+            if(layerIndex < SM_PROFILING_MAX_LAYERS - 1)
+                layerIndex++;
+            templayer = templayer->nextLayer;
         }
 
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
-            
-            int i=0;
-
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+        // the composited rows go to the readback tap and get the per-panel calibration, before dithering
+        if(readbackTap.capturing || panelGainsEnabled)
+            finishCompositedRows(currentRow + multiRowRefreshRowOffset, tempRow0, tempRow1, numBrightnessShifts);
+
+        // with a single calc task, stage the layer rows needed by the next row group while this one is packed
+        // (with two tasks the rows are filled out of order on both cores, and the layer caches aren't safe to share)
+        if(!(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE)) {
+            if(rowGroup + 1 < numMultiRowRefreshRowGroups)
+                prefetchLayerRows(currentRow, rowGroup + 1);
+            else if(currentRow + 1 < MATRIX_SCAN_MOD)
+                prefetchLayerRows(currentRow + 1, 0);
+        }
 
-            while(i < numPixelsPerTempRow) {
-                // get number of pixels to go through with current pass
-                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+        SM_PROFILE_START(packingStart);
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("numPixelsToMap = %d\r\n", numPixelsToMap);
-#endif
+        // tempRow1 is offset from tempRow0 in the pattern so the two halves of the panel don't dither in lockstep
+        if(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) {
+            ditherRGB(tempRow0, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset, ditherFrame, COLOR_DEPTH_BITS);
+            ditherRGB(tempRow1, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 2, ditherFrame, COLOR_DEPTH_BITS);
+        }
 
-                bool reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
+        // transpose the color channels of each pixel, so each bitplane gets a byte with one bit per channel, 8 bitplanes at a time
+        // this replaces six data-dependent branches per pixel per bitplane with a table lookup in the bitplane loop below
+        const int maskoffset = 16 - COLOR_DEPTH_BITS;   // 36-bit color uses the upper 12 bits of each channel, dithered 24-bit color the upper 8 bits
 
-                // get offset where pixels are written in the refresh buffer
-                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        for(int k=0; k < numPixelsPerTempRow; k++) {
+            for(int bitindex = 0; bitindex < COLOR_DEPTH_BITS; bitindex += 8) {
+                const int shift = maskoffset + bitindex;
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("currentMapOffset = %d\r\n", currentMapOffset);
-#endif
+                transposeChannelBits(tempRow0[k].red >> shift, tempRow0[k].green >> shift, tempRow0[k].blue >> shift,
+                    tempRow1[k].red >> shift, tempRow1[k].green >> shift, tempRow1[k].blue >> shift,
+                    &tempPlaneBits[bitindex * numPixelsPerTempRow + k], numPixelsPerTempRow, COLOR_DEPTH_BITS - bitindex);
+            }
+        }
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+            const uint8_t * planeBits = &tempPlaneBits[j * numPixelsPerTempRow];
+            
+            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
+            
+            // parse through the temp buffer, writing each pixel to the refresh buffer position calculated in begin()
+            for(int k=0; k < numPixelsPerTempRow; k++) {
+                int v=0;
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
+                int refreshBufferPosition = MULTI_ROW_REFRESH_REQUIRED ? multiRowRefreshBufferPositionTable[rowGroup][k] : k;
 
 #if (REFRESH_PRINTFS >= 2)
-                printf("j = %02d, i = %03d, c = %03d, k = %03d, pos = %03d\r\n", j, i, c, k, refreshBufferPosition);
+                printf("j = %02d, c = %03d, k = %03d, pos = %03d\r\n", j, c, k, refreshBufferPosition);
 #endif
 
 #if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
-
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;                        
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
-                    }
+                // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
+                int gpioRowAddress = currentRow;
+                // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
+                if(j == 0)
+                    gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
+
+                if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
+                    gpioRowAddress = ~(0x01 << gpioRowAddress);
+
+                if (gpioRowAddress & 0x01) v|=BIT_A;
+                if (gpioRowAddress & 0x02) v|=BIT_B;
+                if (gpioRowAddress & 0x04) v|=BIT_C;
+                if (gpioRowAddress & 0x08) v|=BIT_D;
+                if (gpioRowAddress & 0x10) v|=BIT_E;                        
+
+                // need to disable OE after latch to hide row transition
+                if((refreshBufferPosition) == 0) v|=BIT_OE;
+
+                // drive latch while shifting out last bit of RGB data
+                if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
+
+                // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
+                if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
+                    if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
+                    if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
+                }
 #endif
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+                // turn off OE after brightness value is reached when displaying MSBs
+                // MSBs always output normal brightness
+                // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
+                if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
 
 #ifndef OEPWM_TEST_ENABLE
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
+                // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+                if(j && j <= lsbMsbTransitionBit) {
+                    // divide brightness in half for each bit below lsbMsbTransitionBit
+                    int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
+                    if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
+                }
+#else
+                // TODO: this is probably not working after adding support for multi-row refresh panels
+                // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+                if(j && j <= lsbMsbTransitionBit) {
+                    // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
+                    if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
+                        // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
+                        int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
+                        // now setting brightness for LSB, use PWM OE
+                        if((k%2) || k >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
+                    } else {
                         // divide brightness in half for each bit below lsbMsbTransitionBit
                         int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
                         if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
                     }
-#else
-                    // TODO: this is probably not working after adding support for multi-row refresh panels
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
-                        if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
-                            // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
-                            int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
-                            // now setting brightness for LSB, use PWM OE
-                            if((k%2) || k >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
-                        } else {
-                            // divide brightness in half for each bit below lsbMsbTransitionBit
-                            int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                            if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                        }
-                    }                
+                }                
 #endif
-                    
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
+                
+                // need to turn off OE one clock before latch, otherwise can get ghosting
 #if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
+                if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
 #else
-                    if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
+                if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
 #endif
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
+                // RGB data bits for this pixel and bitplane, transposed before the bitplane loop
+                v|=rgbBitsLUT[planeBits[k]];
 
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
+                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
+                    // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
 
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
+                    if(v & BIT_OE) {
+                        v = v & ~(BIT_OE);
+                    } else {
+                        v |= BIT_OE;
+                    }
 
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
+                    if(v & BIT_R1) {
+                        v = v & ~(BIT_R1);
+                    } else {
+                        v |= BIT_R1;
+                    }
+                }               
 
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
+                if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((k/matrixWidth)%2)) {
+                    //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
+                    //TODO: support C-shape stacking
+                } else {
+                    if(!I2S_PARALLEL_FIFO_REORDER) {
+                        p->data[refreshBufferPosition] = v;
+                    } else if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
+                        //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
+                        if(refreshBufferPosition%4 == 0){
+                            p->data[(refreshBufferPosition)+2] = v;
+                        } else if(refreshBufferPosition%4 == 1) {
+                            p->data[(refreshBufferPosition)+2] = v;
+                        } else if(refreshBufferPosition%4 == 2) {
+                            p->data[(refreshBufferPosition)-2] = v;
+                        } else { //if(refreshBufferPosition%4 == 3)
+                            p->data[(refreshBufferPosition)-2] = v;
+                        }
                     } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p->data[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p->data[(refreshBufferPosition)-2] = v;
-                            }
+                        //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
+                        if(refreshBufferPosition%2){
+                            p->data[(refreshBufferPosition)-1] = v;
                         } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p->data[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p->data[(refreshBufferPosition)+1] = v;
-                            }
+                            p->data[(refreshBufferPosition)+1] = v;
                         }
                     }
                 }
-
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
             }
 
             // TODO: insert latch data for all color depth bits all at once at the end, saving a few cycles?
@@ -789,7 +1404,9 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
                     }
                 }
 
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
+                if(!I2S_PARALLEL_FIFO_REORDER) {
+                    p->data[k] = v;
+                } else if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
                     //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
                     if(k%4 == 0){
                         p->data[k+2] = v;
@@ -812,228 +1429,218 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 #endif
         }
 
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+        if(!calcTaskIndex)
+            SM_PROFILE_END(packingStart, profilingStats.bitplanePacking);
 
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers24(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers24(frameStruct * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts, int calcTaskIndex) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
 
 #if defined(ESP32)
     // use buffers malloc'd previously
-    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr;
-    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr;
+    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr[calcTaskIndex];
+    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr[calcTaskIndex];
+    uint8_t * tempPlaneBits = tempPlaneBitsPtr[calcTaskIndex];
 #else
     // static to avoid putting large buffer on the stack
     static rgb24 tempRow0[numPixelsPerTempRow];
     static rgb24 tempRow1[numPixelsPerTempRow];
+    static uint8_t tempPlaneBits[COLOR_DEPTH_BITS * numPixelsPerTempRow];
 #endif
 
     int c = 0;
-    resetMultiRowRefreshMapPosition();
 
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset(tempRow0, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
-        memset(tempRow1, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+    for(int rowGroup = 0; rowGroup < numMultiRowRefreshRowGroups; rowGroup++) {
+        int multiRowRefreshRowOffset = multiRowRefreshRowOffsetTable[rowGroup];
+
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        if (!baseLayer || !baseLayer->isLayerOpaque()) {
+            memset(tempRow0, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+            memset(tempRow1, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+        }
 
         // get a row of physical pixel data (HUB75 paired) from the layers
         SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+        int layerIndex = 0;
         while(templayer) {
+            SM_PROFILE_START(layerStart);
             for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
                 // Z-shape, bottom to top
                 if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // Z-shape, top to bottom
                 } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + i*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + i*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // C-shape, bottom to top
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // alternate direction of filling (or loading) for each matrixwidth
                     // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
                     if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (i)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 // C-shape, top to bottom
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     if((MATRIX_STACK_HEIGHT-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + ROW_PAIR_OFFSET + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((MATRIX_SCAN_MOD-(currentRow + multiRowRefreshRowOffset)-1) + (MATRIX_STACK_HEIGHT-i-1)*MATRIX_PANEL_HEIGHT, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 }
             }
-            templayer = templayer->nextLayer;        
+            if(!calcTaskIndex)
+                SM_PROFILE_END(layerStart, profilingStats.layerFill[layerIndex]);
+            if(layerIndex < SM_PROFILING_MAX_LAYERS - 1)
+                layerIndex++;
+            templayer = templayer->nextLayer;
         }
-  
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
-            
-            int i=0;
 
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+        // the composited rows go to the readback tap and get the per-panel calibration, before dithering
+        if(readbackTap.capturing || panelGainsEnabled)
+            finishCompositedRows(currentRow + multiRowRefreshRowOffset, tempRow0, tempRow1, numBrightnessShifts);
+
+        // with a single calc task, stage the layer rows needed by the next row group while this one is packed
+        // (with two tasks the rows are filled out of order on both cores, and the layer caches aren't safe to share)
+        if(!(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_DUAL_CORE)) {
+            if(rowGroup + 1 < numMultiRowRefreshRowGroups)
+                prefetchLayerRows(currentRow, rowGroup + 1);
+            else if(currentRow + 1 < MATRIX_SCAN_MOD)
+                prefetchLayerRows(currentRow + 1, 0);
+        }
 
-            while(i < numPixelsPerTempRow) {
-                // get number of pixels to go through with current pass
-                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+        SM_PROFILE_START(packingStart);
 
-                bool reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
-
-                // get offset where pixels are written in the refresh buffer
-                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        // transpose the color channels of each pixel, so each bitplane gets a byte with one bit per channel
+        // this replaces six data-dependent branches per pixel per bitplane with a table lookup in the bitplane loop below
+        for(int k=0; k < numPixelsPerTempRow; k++) {
+            transposeChannelBits(tempRow0[k].red, tempRow0[k].green, tempRow0[k].blue,
+                tempRow1[k].red, tempRow1[k].green, tempRow1[k].blue,
+                &tempPlaneBits[k], numPixelsPerTempRow, COLOR_DEPTH_BITS);
+        }
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+            const uint8_t * planeBits = &tempPlaneBits[j * numPixelsPerTempRow];
+            
+            SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStruct *p=&(frameBuffer->rowdata[currentRow].rowbits[j]); //bitplane location to write to
+            
+            // parse through the temp buffer, writing each pixel to the refresh buffer position calculated in begin()
+            for(int k=0; k < numPixelsPerTempRow; k++) {
+                int v=0;
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
+                int refreshBufferPosition = MULTI_ROW_REFRESH_REQUIRED ? multiRowRefreshBufferPositionTable[rowGroup][k] : k;
 
 #if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
-
-                    if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
-                        gpioRowAddress = ~(0x01 << gpioRowAddress);
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;                        
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
-                    }
+                // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
+                int gpioRowAddress = currentRow;
+                // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
+                if(j == 0)
+                    gpioRowAddress = (currentRow-1 + MATRIX_SCAN_MOD) % MATRIX_SCAN_MOD;
+
+                if(PANEL_USES_ALT_ADDRESSING_MODE(panelType))
+                    gpioRowAddress = ~(0x01 << gpioRowAddress);
+
+                if (gpioRowAddress & 0x01) v|=BIT_A;
+                if (gpioRowAddress & 0x02) v|=BIT_B;
+                if (gpioRowAddress & 0x04) v|=BIT_C;
+                if (gpioRowAddress & 0x08) v|=BIT_D;
+                if (gpioRowAddress & 0x10) v|=BIT_E;                        
+
+                // need to disable OE after latch to hide row transition
+                if((refreshBufferPosition) == 0) v|=BIT_OE;
+
+                // drive latch while shifting out last bit of RGB data
+                if((refreshBufferPosition) == PIXELS_PER_LATCH-1) v|=BIT_LAT;
+
+                // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
+                if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
+                    if((refreshBufferPosition) == PIXELS_PER_LATCH-2) v|=BIT_LAT;
+                    if((refreshBufferPosition) == PIXELS_PER_LATCH-3) v|=BIT_LAT;
+                }
 #endif
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+                // turn off OE after brightness value is reached when displaying MSBs
+                // MSBs always output normal brightness
+                // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
+                if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
 
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // divide brightness in half for each bit below lsbMsbTransitionBit
-                        int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                        if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                    }
+                // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+                if(j && j <= lsbMsbTransitionBit) {
+                    // divide brightness in half for each bit below lsbMsbTransitionBit
+                    int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
+                    if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
+                }
 
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
+                // need to turn off OE one clock before latch, otherwise can get ghosting
 #if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
+                if((refreshBufferPosition)==PIXELS_PER_LATCH-1) v|=BIT_OE;
 #else
-                    if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
+                if((refreshBufferPosition)>=PIXELS_PER_LATCH-2) v|=BIT_OE;
 #endif
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
+                // RGB data bits for this pixel and bitplane, transposed before the bitplane loop
+                v|=rgbBitsLUT[planeBits[k]];
 
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
+                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
+                    // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
 
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
+                    if(v & BIT_OE) {
+                        v = v & ~(BIT_OE);
+                    } else {
+                        v |= BIT_OE;
+                    }
 
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
+                    if(v & BIT_R1) {
+                        v = v & ~(BIT_R1);
+                    } else {
+                        v |= BIT_R1;
+                    }
+                }               
 
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
+                if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((k/matrixWidth)%2)) {
+                    //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
+                    //TODO: support C-shape stacking
+                } else {
+                    if(!I2S_PARALLEL_FIFO_REORDER) {
+                        p->data[refreshBufferPosition] = v;
+                    } else if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
+                        //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
+                        if(refreshBufferPosition%4 == 0){
+                            p->data[(refreshBufferPosition)+2] = v;
+                        } else if(refreshBufferPosition%4 == 1) {
+                            p->data[(refreshBufferPosition)+2] = v;
+                        } else if(refreshBufferPosition%4 == 2) {
+                            p->data[(refreshBufferPosition)-2] = v;
+                        } else { //if(refreshBufferPosition%4 == 3)
+                            p->data[(refreshBufferPosition)-2] = v;
+                        }
                     } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                p->data[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p->data[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p->data[(refreshBufferPosition)-2] = v;
-                            }
+                        //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
+                        if(refreshBufferPosition%2){
+                            p->data[(refreshBufferPosition)-1] = v;
                         } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p->data[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p->data[(refreshBufferPosition)+1] = v;
-                            }
+                            p->data[(refreshBufferPosition)+1] = v;
                         }
                     }
                 }
-
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
             }
 
 #if (CLKS_DURING_LATCH > 0)
@@ -1071,7 +1678,9 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
                     }
                 }
 
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
+                if(!I2S_PARALLEL_FIFO_REORDER) {
+                    p->data[k] = v;
+                } else if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
                     //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
                     if(k%4 == 0){
                         p->data[k+2] = v;
@@ -1094,28 +1703,53 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 #endif
         }
 
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+        if(!calcTaskIndex)
+            SM_PROFILE_END(packingStart, profilingStats.bitplanePacking);
 
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts, int calcTaskIndex, int numCalcTasks) {
 #if 1
     unsigned char currentRow;
 
     frameStruct * currentFrameDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr();
+    frameStruct * previousFrameDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPreviousFrameBufferPtr();
+
+    // with more than one calc task, each task fills a disjoint set of rows
+    for(currentRow = calcTaskIndex; currentRow < MATRIX_SCAN_MOD; currentRow += numCalcTasks) {
+        // copying an unchanged row from the previous frame is much faster than filling it from the layers and repacking
+        if(!(changedRefreshRows & (1UL << currentRow))) {
+            if(currentFrameDataPtr != previousFrameDataPtr) {
+                SM_PROFILE_START(copyStart);
+                memcpy(&currentFrameDataPtr->rowdata[currentRow], &previousFrameDataPtr->rowdata[currentRow], sizeof(rowDataStruct));
+                if(!calcTaskIndex)
+                    SM_PROFILE_END(copyStart, profilingStats.bufferCopy);
+            }
+            continue;
+        }
 
-    for(currentRow = 0; currentRow < MATRIX_SCAN_MOD; currentRow++) {
         // TODO: support rgb36/48 with same function, copy function to rgb24
         if(COLOR_DEPTH_BITS == 16)
-            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts, calcTaskIndex);
         else if(COLOR_DEPTH_BITS == 12)
-            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts, calcTaskIndex);
+        else if(COLOR_DEPTH_BITS == 8 && (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER))
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts, calcTaskIndex);
         else if(COLOR_DEPTH_BITS == 8)
-            loadMatrixBuffers24(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+            loadMatrixBuffers24(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts, calcTaskIndex);
+
+        // bitplanes padded for PSRAM DMA (see ESP32_CLKS_PER_BITPLANE) repeat their last clock with LAT released, OE is already blanked there
+        if(ESP32_CLKS_PER_BITPLANE > PIXELS_PER_LATCH + CLKS_DURING_LATCH) {
+            for(int j=0; j<COLOR_DEPTH_BITS; j++) {
+                MATRIX_DATA_STORAGE_TYPE * data = currentFrameDataPtr->rowdata[currentRow].rowbits[j].data;
+                MATRIX_DATA_STORAGE_TYPE padding = data[PIXELS_PER_LATCH + CLKS_DURING_LATCH - 1] & ~BIT_LAT;
+                for(int k=PIXELS_PER_LATCH + CLKS_DURING_LATCH; k<(int)ESP32_CLKS_PER_BITPLANE; k++)
+                    data[k] = padding;
+            }
+        }
     }
 #endif
 }
@@ -35,7 +35,8 @@ public:
     SmartMatrixHub75Calc_NT(SmartMatrixHub75Refresh_NT<0>* matrixRefresh, uint16_t width, uint16_t height, uint8_t depth, uint8_t type, uint32_t options) :
         _matrixRefresh(matrixRefresh), matrixWidth(width), matrixHeight(height), optionFlags(options), panelType(type), refreshDepth(depth), pixels_per_latch(PIXELS_PER_LATCH),
         matrix_panel_height(MATRIX_PANEL_HEIGHT), matrix_stack_height(MATRIX_STACK_HEIGHT), color_depth_bits(COLOR_DEPTH_BITS), matrix_scan_mod(MATRIX_SCAN_MOD),
-        cols_per_panel(COLS_PER_PANEL), physical_rows_per_refresh_row(PHYSICAL_ROWS_PER_REFRESH_ROW), row_pair_offset(ROW_PAIR_OFFSET) {
+        cols_per_panel(COLS_PER_PANEL), physical_rows_per_refresh_row(PHYSICAL_ROWS_PER_REFRESH_ROW), row_pair_offset(ROW_PAIR_OFFSET),
+        panelMap(getMultiRowRefreshPanelMap(type)) {
             // parameter defaults
             maxCalcCpuPercentage = 80; // to avoid 100% CPU usage, we by default don't calculate on every frame.  Calc refresh rate will be a fraction of Refresh refresh rate
             calc_refreshRateDivider = 2;
@@ -52,13 +53,43 @@ public:
             rotationChange = true;
             rotation = rotation0;
             brightness = pixels_per_latch;
+            requestedBrightness = 255;
+            brightnessFadeStart = false;
+            brightnessFadeTarget = 255;
+            brightnessFadeDurationMs = 0;
+            changedRefreshRows = 0;
+            lastBrightnessShifts = 0;
+            ditherFrame = 0;
+            numMultiRowRefreshRowGroups = 1;
+            multiRowRefreshRowOffsetTable = NULL;
+            packingRuns = NULL;
+            packingRunIndex = NULL;
+            numPackingRuns = 0;
+            hub12InvertBits = 0;
+            packBitplanesKernel = NULL;
+            calcTaskHandle = NULL;
+            tempRow0Ptr = tempRow1Ptr = NULL;
+            tempPlaneBitsPtr = NULL;
         };
     void begin(uint32_t dmaRamToKeepFreeBytes = 0);
     void addLayer(SM_Layer * newlayer);
+    // layers can be changed while refreshing, refresh picks up the new set at the start of the next frame, see smLayerChain
+    void removeLayer(SM_Layer * layer);
+    // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+    void moveLayer(SM_Layer * layer, SM_Layer * belowLayer);
+    void setLayerVisible(SM_Layer * layer, bool visible);
 
     // configuration
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
+    // fades the global brightness from its current value to targetBrightness, stepped by the calc each calculated frame
+    // the OE timing is packed into the frame, so the frame is repacked (and layers refilled) each time the fade reaches a new OE width
+    // setBrightness() cancels a running fade
+    void fadeBrightness(uint8_t targetBrightness, uint16_t durationMs);
+    // economy mode for OTA updates and network bursts: layers only advance to a new frame every updateIntervalMs (0 = frozen, a
+    // swapBuffers() waits until economy mode ends), between updates the calc packs nothing and DMA keeps showing the last frame
+    void setEconomyMode(bool enabled, uint16_t updateIntervalMs = 0);
+    bool getEconomyMode(void);
     void setRefreshRate(uint16_t newRefreshRate);
 
     // get info
@@ -68,6 +99,37 @@ public:
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
     void setMaxCalculationCpuPercentage(uint8_t newMaxCpuPercentage);
+    // the governor steers the calc rate toward frameRate calculated frames per second (0 = as fast as the CPU percentage allows)
+    // while staying under the max CPU percentage
+    void setCalcFrameRateTarget(uint16_t frameRate);
+    // the divider, calc rate, and average CPU percentage as currently chosen by the governor
+    void getCalcGovernorState(smCalcGovernor & state);
+    // idle work, see smIdleWork: the calc task calls callback(context, budgetMicros) in the time left before the next refresh frame,
+    // maxBudgetMicros (0 = all of it) caps each call, returns false if all SM_IDLE_WORK_MAX_CALLBACKS slots are in use
+    // callbacks run at the calc task's priority on its core, with SMARTMATRIX_FLASH_SAFE_REFRESH they should be in IRAM too
+    bool addIdleWork(smIdleWorkCallback callback, void * context = NULL, uint32_t maxBudgetMicros = 0);
+    void removeIdleWork(smIdleWorkCallback callback, void * context = NULL);
+    // calls that returned after their budget ran out, and the total time spent in idle work
+    uint32_t getIdleWorkOverruns(void);
+    uint32_t getIdleWorkMicros(void);
+
+    // frame events, a frame is counted each time the calc runs and no layer has a swap waiting: frames with nothing to repack count,
+    // frames held by economy mode or frame sync don't
+    void setFrameCallback(smFrameCallback callback);
+    uint32_t getFrameCount(void);
+    // sleeps until the next frame starts (a pending swapBuffers() has been taken), returns false after timeoutMs
+    bool waitForFrame(uint32_t timeoutMs);
+    // multi-controller frame sync, see smFrameSync: the master pulses an output pin at every frame start (-1 to stop), the
+    // others hold their frames for a pulse on an input pin, or for frameSyncPulse() calls from a network sync message
+    void setFrameSyncOutput(int8_t pin);
+    void setFrameSyncInput(int8_t pin);
+    void frameSyncPulse(void);
+    // microseconds this board's last frame started after the master's pulse, and frames lost to falling behind the master
+    int32_t getFrameSyncDrift(void);
+    uint32_t getFrameSyncMissedPulses(void);
+    // task gets an xTaskNotifyGive() every frame (NULL to stop), the event group gets SM_FRAME_EVENT_BIT set every frame
+    void setFrameNotifyTask(TaskHandle_t task);
+    EventGroupHandle_t getFrameEventGroup(void);
 
     // debug
     int countFPS(void);
@@ -80,15 +142,21 @@ public:
 
 private:
     SM_Layer * baseLayer;
+    smLayerChain layerChain;
 
     void * tempRow0Ptr;
     void * tempRow1Ptr;
+    uint8_t * tempPlaneBitsPtr;
+    // RGB bits in the DMA data for each combination of the six channel bits produced by transposeChannelBits()
+    MATRIX_DATA_STORAGE_TYPE rgbBitsLUT[64];
 
     // functions for refreshing
     void loadMatrixBuffers(int lsbMsbTransitionBit, int numBrightnessShifts = 0);
+    uint32_t getRefreshRowsForHardwareRows(uint16_t firstRow, uint16_t lastRow);
     void loadMatrixBuffers48(MATRIX_DATA_STORAGE_TYPE * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
     void loadMatrixBuffers24(MATRIX_DATA_STORAGE_TYPE * currentFrameDataPtr, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts = 0);
     static void calcTask(void* pvParameters);
+    void updateCalcGovernor(uint32_t startMicros, uint32_t endMicros);
     void resetMultiRowRefreshMapPosition(void);
     void resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void);
     void advanceMultiRowRefreshMapToNextRow(void);
@@ -96,12 +164,31 @@ private:
     int getMultiRowRefreshRowOffset(void);
     int getMultiRowRefreshNumPixelsToMap(void);
     int getMultiRowRefreshPixelGroupOffset(void);
+    void calculateMultiRowRefreshTables(void);
+    void addPackingRun(int tempRowOffset, int numPixels, int bufferPosition, int step);
+    void transposeChannelBits(uint8_t r0, uint8_t g0, uint8_t b0, uint8_t r1, uint8_t g1, uint8_t b1, uint8_t * planeBits, int stride, int numPlanes);
+    // writes the bitplanes of a row group from tempPlaneBitsPtr, with colorDepthBits and pixelsPerLatch as constants (0 = the runtime value)
+    template <int colorDepthBits, int pixelsPerLatch, bool multiRowRefresh>
+    void packBitplanes(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int rowGroup, int lsbMsbTransitionBit);
+    // picks the packBitplanes() specialized for this configuration, or the generic one (SM_NT_SPECIALIZED_PACKING 0 keeps only the generic)
+    void selectPackingKernel(void);
+    typedef void (SmartMatrixHub75Calc_NT::*packBitplanesFunction)(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int rowGroup, int lsbMsbTransitionBit);
+    packBitplanesFunction packBitplanesKernel;
     
     // configuration
     volatile bool brightnessChange;
     volatile bool rotationChange;
+    smFrameEvents frameEvents;
+    smFrameSync frameSync;
     volatile bool dmaBufferUnderrun;
     int brightness;
+    // brightness as set by the sketch (0-255), and the fade requested by fadeBrightness(), started by the calc at the next frame
+    uint8_t requestedBrightness;
+    volatile bool brightnessFadeStart;
+    uint8_t brightnessFadeTarget;
+    uint16_t brightnessFadeDurationMs;
+    smBrightnessFade brightnessFade;
+    smEconomyMode economyMode;
     int shiftedBrightness;
     rotationDegrees rotation;
     uint16_t calc_refreshRate;   
@@ -109,16 +196,42 @@ private:
     bool dmaBufferUnderrunSinceLastCheck;
     // to avoid 100% CPU usage, we by default don't calculate on every frame.  Calc refresh rate will be a fraction of Refresh refresh rate
     uint8_t maxCalcCpuPercentage;
+    smCalcGovernor calcGovernor;
+    smIdleWork idleWork;
     bool refreshRateLowered;
     bool refreshRateChanged;
     uint8_t lsbMsbTransitionBit;
     TaskHandle_t calcTaskHandle;
+    // held by calcTask while it calculates a frame, begin() again takes it so refresh is restarted between frames
+    SemaphoreHandle_t calcTaskMutex;
+    // bitmask of refresh rows (currentRow 0..matrix_scan_mod-1) that need to be repacked, the rest are copied from the previous frame
+    uint32_t changedRefreshRows;
+    // brightness shifts the last frame was packed with, a change repacks every row
+    int lastBrightnessShifts;
+    // counts calculated frames, selecting the dither pattern position with SM_HUB75_OPTIONS_TEMPORAL_DITHER
+    unsigned int ditherFrame;
     
     int multiRowRefresh_mapIndex_CurrentRowGroups;
     int multiRowRefresh_mapIndex_CurrentPixelGroup;
     int multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
     int multiRowRefresh_NumPanelsAlreadyMapped;
 
+    // multi row refresh map expanded in begin(): row offset of each physical row group within a refresh row, and the packing runs
+    // of each row group, packingRuns[packingRunIndex[rowGroup]] up to packingRuns[packingRunIndex[rowGroup + 1]]
+    int numMultiRowRefreshRowGroups;
+    int16_t * multiRowRefreshRowOffsetTable;
+    // numPixels temp buffer pixels from tempRowOffset go to the refresh buffer from bufferPosition, with step 1 or -1
+    typedef struct packingRun {
+        uint16_t tempRowOffset;
+        uint16_t numPixels;
+        uint16_t bufferPosition;
+        int16_t step;
+    } packingRun;
+    packingRun * packingRuns;
+    uint16_t * packingRunIndex;
+    int numPackingRuns;
+    MATRIX_DATA_STORAGE_TYPE hub12InvertBits;
+
     SmartMatrixHub75Refresh_NT<0> * _matrixRefresh;
     const uint16_t matrixWidth;
     const uint16_t matrixHeight;
@@ -135,6 +248,8 @@ private:
     const uint16_t cols_per_panel;
     const uint16_t physical_rows_per_refresh_row;
     const uint8_t row_pair_offset;
+    // panel map for panelType, looked up once per instance as panelType isn't known at compile time
+    const PanelMappingEntry * const panelMap;
 };
 
 #endif
@@ -28,14 +28,22 @@
 
 template <int dummyvar>
 void SmartMatrixHub75Calc_NT<dummyvar>::addLayer(SM_Layer * newlayer) {
-    if(baseLayer) {
-        SM_Layer * templayer = baseLayer;
-        while(templayer->nextLayer)
-            templayer = templayer->nextLayer;
-        templayer->nextLayer = newlayer;
-    } else {
-        baseLayer = newlayer;
-    }
+    layerChain.add(newlayer, rotation);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::removeLayer(SM_Layer * layer) {
+    layerChain.remove(layer);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::moveLayer(SM_Layer * layer, SM_Layer * belowLayer) {
+    layerChain.move(layer, belowLayer);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setLayerVisible(SM_Layer * layer, bool visible) {
+    layerChain.setVisible(layer, visible);
 }
 
 template <int dummyvar>
@@ -59,15 +67,63 @@ int SmartMatrixHub75Calc_NT<dummyvar>::countFPS(void) {
     return ret;
 }
 
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setFrameCallback(smFrameCallback callback) {
+    frameEvents.callback = callback;
+}
+
+template <int dummyvar>
+uint32_t SmartMatrixHub75Calc_NT<dummyvar>::getFrameCount(void) {
+    return frameEvents.frameCount;
+}
+
+template <int dummyvar>
+bool SmartMatrixHub75Calc_NT<dummyvar>::waitForFrame(uint32_t timeoutMs) {
+    return frameEvents.wait(timeoutMs);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setFrameSyncOutput(int8_t pin) {
+    frameSync.setOutput(pin);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setFrameSyncInput(int8_t pin) {
+    frameSync.setInput(pin);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::frameSyncPulse(void) {
+    frameSync.pulse();
+}
+
+template <int dummyvar>
+int32_t SmartMatrixHub75Calc_NT<dummyvar>::getFrameSyncDrift(void) {
+    return frameSync.drift;
+}
+
+template <int dummyvar>
+uint32_t SmartMatrixHub75Calc_NT<dummyvar>::getFrameSyncMissedPulses(void) {
+    return frameSync.missedPulses;
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setFrameNotifyTask(TaskHandle_t task) {
+    frameEvents.notifyTask = task;
+}
+
+template <int dummyvar>
+EventGroupHandle_t SmartMatrixHub75Calc_NT<dummyvar>::getFrameEventGroup(void) {
+    return frameEvents.eventGroup;
+}
+
 template <int dummyvar>
 void SmartMatrixHub75Calc_NT<dummyvar>::dmaBufferUnderrunCallback(void) {
     dmaBufferUnderrun = true;
 }
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
-    static unsigned long lastMillisStart;
-    static unsigned long lastMillisEnd;
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
     static int refreshFramesSinceLastCalculation = 0;
     SM_Layer * templayer;
     static bool firstRun = true;
@@ -77,19 +133,42 @@ void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
 
     refreshFramesSinceLastCalculation = 0;
 
-    // safety check - if using up too much CPU, increase refresh rate divider to give more time for sketch to run
-    unsigned long calculationCpuTime = lastMillisEnd - lastMillisStart;
-    unsigned long totalCpuTime = millis() - lastMillisStart;
-    if(totalCpuTime && ((calculationCpuTime * 100) / totalCpuTime) > maxCalcCpuPercentage) {
-        // increase CPU divider by 1
-        setCalcRefreshRateDivider(getCalcRefreshRateDivider() + 1);
-        refreshRateLowered = true;
-    }
-
     // only do calculations if there is free space (should be redundant, as we only get called if there is free space)
     if (!_matrixRefresh->isFrameBufferFree())
         return;
 
+    // economy mode: nothing is packed between updates, and DMA keeps showing the last frame
+    if (!economyMode.frameDue(millis()))
+        return;
+
+    // with frame sync following a master, hold this frame until the master's pulse (or a timeout) so swaps line up across boards
+    if (!frameSync.frameStart())
+        return;
+
+    // a setBrightness() since the last frame cancels a running fade
+    if (brightnessFadeStart) {
+        brightnessFadeStart = false;
+        brightnessFade.start(requestedBrightness, brightnessFadeTarget, ((uint32_t)brightnessFadeDurationMs * calc_refreshRate) / 1000);
+    } else if (brightnessChange) {
+        brightnessFade.stop();
+    }
+    // only steps that reach a new OE width (0-pixels_per_latch) need the frame repacked
+    if (brightnessFade.isRunning()) {
+        requestedBrightness = brightnessFade.step();
+        int fadedBrightness = (pixels_per_latch*requestedBrightness)/255;
+        if (fadedBrightness != brightness) {
+            brightness = fadedBrightness;
+            brightnessChange = true;
+        }
+    }
+
+    // layers added, removed, moved or hidden since the last frame are picked up here, and need the per-frame setup
+    bool layersChanged = layerChain.publish(baseLayer);
+    if (layersChanged) {
+        rotationChange = true;
+        refreshRateChanged = true;
+    }
+
     templayer = baseLayer;
     bool refreshNeeded = false;
     while(templayer) {
@@ -99,13 +178,25 @@ void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
         templayer = templayer->nextLayer;
     }
 
-    if(!refreshNeeded && !firstRun)
+    // a new brightness is part of the packed frame, and has to be applied even if the layers didn't change
+    if(brightnessChange || layersChanged)
+        refreshNeeded = true;
+
+    // dithering changes every row every frame, even if the layers didn't change
+    // no layer has a swap pending either, so this still counts as a frame for waitForFrame() and the frame callback
+    if(!refreshNeeded && !firstRun && !(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)) {
+        frameEvents.signal();
         return;
+    }
 
+    // the first frame, and anything that affects every row, repacks the full frame
+    bool fullFrameChanged = firstRun || layersChanged;
     firstRun = false;
 
-    // now we know we're actually going to update the frame, keep track of the time we started updating
-    lastMillisStart = millis();
+    if(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) {
+        ditherFrame++;
+        fullFrameChanged = true;
+    }
 
     // do once-per-frame updates
     if (rotationChange) {
@@ -115,9 +206,11 @@ void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
             templayer = templayer->nextLayer;
         }
         rotationChange = false;
+        fullFrameChanged = true;
     }
 
     int largestRequestedBrightnessShifts = 0;
+    uint32_t newChangedRefreshRows = 0;
 
     templayer = baseLayer;
     while(templayer) {
@@ -131,9 +224,19 @@ void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
         if(tempval > largestRequestedBrightnessShifts)
             largestRequestedBrightnessShifts = tempval;
 
+        uint16_t firstChangedRow, lastChangedRow;
+        if(templayer->getChangedRows(firstChangedRow, lastChangedRow))
+            newChangedRefreshRows |= getRefreshRowsForHardwareRows(firstChangedRow, lastChangedRow);
+
         templayer = templayer->nextLayer;
     }
     refreshRateChanged = false;
+    frameEvents.signal();
+
+    if(largestRequestedBrightnessShifts != lastBrightnessShifts) {
+        lastBrightnessShifts = largestRequestedBrightnessShifts;
+        fullFrameChanged = true;
+    }
 
     int tempBrightness = brightness >> largestRequestedBrightnessShifts;
 
@@ -146,13 +249,22 @@ void SmartMatrixHub75Calc_NT<dummyvar>::matrixCalculations() {
     if (brightnessChange) {
         _matrixRefresh->setBrightness(shiftedBrightness);
         brightnessChange = false;
+        fullFrameChanged = true;
     }
 
+    if(fullFrameChanged)
+        newChangedRefreshRows = getRefreshRowsForHardwareRows(0, matrixHeight - 1);
+
+    // nothing visible changed, keep displaying the previous frame
+    if(!newChangedRefreshRows)
+        return;
+
+    changedRefreshRows = newChangedRefreshRows;
+
     loadMatrixBuffers(lsbMsbTransitionBit, largestRequestedBrightnessShifts);
 
     _matrixRefresh->writeFrameBuffer(0);
 
-    lastMillisEnd = millis();
 }
 
 template <int dummyvar>
@@ -182,10 +294,31 @@ uint16_t SmartMatrixHub75Calc_NT<dummyvar>::getScreenHeight(void) const {
 // brightness scales from 0-pixels_per_latch
 template <int dummyvar>
 void SmartMatrixHub75Calc_NT<dummyvar>::setBrightness(uint8_t newBrightness) {
+    brightnessFadeStart = false;
+    requestedBrightness = newBrightness;
     brightness = (pixels_per_latch*newBrightness)/255;
     brightnessChange = true;
 }
 
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::fadeBrightness(uint8_t targetBrightness, uint16_t durationMs) {
+    brightnessFadeTarget = targetBrightness;
+    brightnessFadeDurationMs = durationMs;
+    brightnessFadeStart = true;
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::setEconomyMode(bool enabled, uint16_t updateIntervalMs) {
+    economyMode.intervalMs = updateIntervalMs;
+    economyMode.lastUpdateMillis = millis();
+    economyMode.enabled = enabled;
+}
+
+template <int dummyvar>
+bool SmartMatrixHub75Calc_NT<dummyvar>::getEconomyMode(void) {
+    return economyMode.enabled;
+}
+
 template <int dummyvar>
 void SmartMatrixHub75Calc_NT<dummyvar>::setRefreshRate(uint16_t newRefreshRate) {
     calc_refreshRate = newRefreshRate / calc_refreshRateDivider;
@@ -203,7 +336,54 @@ void SmartMatrixHub75Calc_NT<dummyvar>::setMaxCalculationCpuPercentage(uint8_t n
 }
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::setCalcRefreshRateDivider(uint8_t newDivider) {
+void SmartMatrixHub75Calc_NT<dummyvar>::setCalcFrameRateTarget(uint16_t frameRate) {
+    calcGovernor.targetFrameRate = frameRate;
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::getCalcGovernorState(smCalcGovernor & state) {
+    state = calcGovernor;
+}
+
+template <int dummyvar>
+bool SmartMatrixHub75Calc_NT<dummyvar>::addIdleWork(smIdleWorkCallback callback, void * context, uint32_t maxBudgetMicros) {
+    return idleWork.add(callback, context, maxBudgetMicros);
+}
+
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::removeIdleWork(smIdleWorkCallback callback, void * context) {
+    idleWork.remove(callback, context);
+}
+
+template <int dummyvar>
+uint32_t SmartMatrixHub75Calc_NT<dummyvar>::getIdleWorkOverruns(void) {
+    return idleWork.overruns;
+}
+
+template <int dummyvar>
+uint32_t SmartMatrixHub75Calc_NT<dummyvar>::getIdleWorkMicros(void) {
+    return idleWork.microsUsed;
+}
+
+template <int dummyvar>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::updateCalcGovernor(uint32_t startMicros, uint32_t endMicros) {
+    calcGovernor.maxCpuPercent = maxCalcCpuPercentage;
+    calcGovernor.divider = calc_refreshRateDivider;
+    calcGovernor.calcRefreshRate = calc_refreshRate;
+
+    uint8_t newDivider = calcGovernor.update(startMicros, endMicros, _matrixRefresh->getRefreshRate());
+    if(newDivider == calc_refreshRateDivider)
+        return;
+
+    if(newDivider > calc_refreshRateDivider)
+        refreshRateLowered = true;
+    setCalcRefreshRateDivider(newDivider);
+    calcGovernor.divider = calc_refreshRateDivider;
+    calcGovernor.calcRefreshRate = calc_refreshRate;
+}
+
+template <int dummyvar>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::setCalcRefreshRateDivider(uint8_t newDivider) {
     // TODO: improve so fractional results don't screw up the calc_refreshRate divider
     // TODO: improve to get actual refresh rate from refresh class
     if(newDivider == 0)
@@ -244,12 +424,13 @@ bool SmartMatrixHub75Calc_NT<dummyvar>::getRefreshRateLoweredFlag(void) {
 
 /* Task2 with priority 2 */
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::calcTask(void* pvParameters)
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::calcTask(void* pvParameters)
 {        
     static long lastMillis = 0;
     SmartMatrixHub75Calc_NT* thisPtr = (SmartMatrixHub75Calc_NT*)pvParameters;
     while(1) {   
         if( xSemaphoreTake(calcTaskSemaphore, portMAX_DELAY) == pdTRUE ) {
+            xSemaphoreTake(thisPtr->calcTaskMutex, portMAX_DELAY);
 #ifdef DEBUG_PINS_ENABLED
             gpio_set_level(DEBUG_1_GPIO, 1);
 #endif
@@ -264,8 +445,18 @@ void SmartMatrixHub75Calc_NT<dummyvar>::calcTask(void* pvParameters)
             // we usually do this with an ISR in the refresh class, but ESP32 doesn't let us store a templated method in IRAM (at least not easily) so we call this from the calc task
             thisPtr->_matrixRefresh->markRefreshComplete();
 
+            // the governor sees every call, including refresh frames that weren't calculated, so its average is the calc share of the core
+            uint32_t calcStart = micros();
             thisPtr->matrixCalculations();
+            thisPtr->updateCalcGovernor(calcStart, micros());
+
+            // idle work gets what's left of this refresh frame, as measured by the governor, unless the next frame has already signaled
+            if(thisPtr->calcGovernor.intervalMicros > SM_IDLE_WORK_MARGIN_MICROS) {
+                thisPtr->idleWork.run(calcStart + thisPtr->calcGovernor.intervalMicros - SM_IDLE_WORK_MARGIN_MICROS,
+                    []() { return uxSemaphoreGetCount(calcTaskSemaphore) > 0; }, []() { return (uint32_t)micros(); });
+            }
 
+            xSemaphoreGive(thisPtr->calcTaskMutex);
 #ifdef DEBUG_PINS_ENABLED
             gpio_set_level(DEBUG_1_GPIO, 0);
 #endif
@@ -279,28 +470,39 @@ void SmartMatrixHub75Calc_NT<dummyvar>::calcTask(void* pvParameters)
 template <int dummyvar>
 void SmartMatrixHub75Calc_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
 {    
+    // begin() again: let the frame being calculated finish, then stop refresh before its buffers are reused or freed
+    // the task and semaphores from the first begin() are kept, calcTask waits on the mutex until refresh is running again
+    bool restarting = (calcTaskHandle != NULL);
+    if(restarting) {
+        xSemaphoreTake(calcTaskMutex, portMAX_DELAY);
+        _matrixRefresh->stop();
+        xSemaphoreTake(calcTaskSemaphore, 0);
+    }
+
     printf("\r\nStarting SmartMatrix Mallocs\r\n");
     show_esp32_all_mem();
 
-    SM_Layer * templayer = baseLayer;
-    while(templayer) {
-        templayer->begin();
-        templayer = templayer->nextLayer;
-    }
+    frameEvents.begin();
+
+    layerChain.begin();
+    layerChain.publish(baseLayer);
 
-    calcTaskSemaphore = xSemaphoreCreateBinary();
+    if(!restarting) {
+        calcTaskSemaphore = xSemaphoreCreateBinary();
+        calcTaskMutex = xSemaphoreCreateMutex();
 
-    int taskPriority = MATRIX_CALC_TASK_DEFAULT_PRIORITY;
-    if(optionFlags & SMARTMATRIX_OPTIONS_MATRIXCALC_LOWPRIORITY)
-        taskPriority = MATRIX_CALC_TASK_LOW_PRIORITY;
+        int taskPriority = MATRIX_CALC_TASK_DEFAULT_PRIORITY;
+        if(optionFlags & SMARTMATRIX_OPTIONS_MATRIXCALC_LOWPRIORITY)
+            taskPriority = MATRIX_CALC_TASK_LOW_PRIORITY;
 
-    // by default run on core 0, leaving more room for the main Arduino task on core 1
-    int calcTaskCore = 0;
-    if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1)
-        calcTaskCore = 1;
+        // by default run on core 0, leaving more room for the main Arduino task on core 1
+        int calcTaskCore = 0;
+        if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_CALC_TASK_CORE_1)
+            calcTaskCore = 1;
 
-    // TODO: fine tune stack size: 1000 works with 64x64/32-24bit, 500 doesn't, does it change based on matrix size, depth?
-    xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", 1000, this, taskPriority, &calcTaskHandle, calcTaskCore);
+        // TODO: fine tune stack size: 1000 works with 64x64/32-24bit, 500 doesn't, does it change based on matrix size, depth?
+        xTaskCreatePinnedToCore(calcTask, "SmartMatrixCalc", 1000, this, taskPriority, &calcTaskHandle, calcTaskCore);
+    }
 
     printf("SmartMatrix Layers Allocated from Heap:\r\n");
     show_esp32_heap_mem();
@@ -309,7 +511,12 @@ void SmartMatrixHub75Calc_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
     // malloc temporary buffers needed for loadMatrixBuffers
     int numPixelsPerTempRow = pixels_per_latch/physical_rows_per_refresh_row;
 
-    if((COLOR_DEPTH_BITS == 12) || (COLOR_DEPTH_BITS == 16)){
+    // buffers from a previous begin() aren't used anymore now that refresh is stopped
+    free(tempRow0Ptr);
+    free(tempRow1Ptr);
+    free(tempPlaneBitsPtr);
+
+    if((COLOR_DEPTH_BITS == 12) || (COLOR_DEPTH_BITS == 16) || (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)){
         tempRow0Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
         tempRow1Ptr = malloc(sizeof(rgb48) * numPixelsPerTempRow);
     } else {
@@ -317,10 +524,48 @@ void SmartMatrixHub75Calc_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
         tempRow1Ptr = malloc(sizeof(rgb24) * numPixelsPerTempRow);
     }
 
+    tempPlaneBitsPtr = (uint8_t*)malloc(COLOR_DEPTH_BITS * numPixelsPerTempRow);
+
     assert(tempRow0Ptr != NULL);
     assert(tempRow1Ptr != NULL);
+    assert(tempPlaneBitsPtr != NULL);
 #endif
 
+    // expand the multi row refresh map into tables used by loadMatrixBuffers
+    free(multiRowRefreshRowOffsetTable);
+    free(packingRunIndex);
+    free(packingRuns);
+    packingRuns = NULL;
+    numPackingRuns = 0;
+    multiRowRefreshRowOffsetTable = (int16_t*)malloc(sizeof(int16_t) * physical_rows_per_refresh_row);
+    assert(multiRowRefreshRowOffsetTable != NULL);
+
+    packingRunIndex = (uint16_t*)malloc(sizeof(uint16_t) * (physical_rows_per_refresh_row + 1));
+    assert(packingRunIndex != NULL);
+
+    // the first pass only counts the packing runs
+    calculateMultiRowRefreshTables();
+    packingRuns = (packingRun*)malloc(sizeof(packingRun) * numPackingRuns);
+    assert(packingRuns != NULL);
+    calculateMultiRowRefreshTables();
+
+    // HUB12 inverts the data (assume we're only using R1 for now), and OE signals
+    hub12InvertBits = (optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) ? (BIT_OE | BIT_R1) : 0;
+
+    selectPackingKernel();
+
+    // lookup table from a bitplane's channel bits (see transposeChannelBits) to the RGB bits in the DMA data
+    for(int i=0; i<64; i++) {
+        MATRIX_DATA_STORAGE_TYPE v = 0;
+        if(i & 0x01) v|=BIT_R1;
+        if(i & 0x02) v|=BIT_G1;
+        if(i & 0x04) v|=BIT_B1;
+        if(i & 0x08) v|=BIT_R2;
+        if(i & 0x10) v|=BIT_G2;
+        if(i & 0x20) v|=BIT_B2;
+        rgbBitsLUT[i] = v;
+    }
+
     _matrixRefresh->setMatrixCalculationsCallback(matrixCalculationsSignal);
     _matrixRefresh->begin(dmaRamToKeepFreeBytes);
 
@@ -328,6 +573,9 @@ void SmartMatrixHub75Calc_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
     setCalcRefreshRateDivider(calc_refreshRateDivider);
     lsbMsbTransitionBit = _matrixRefresh->getLsbMsbTransitionBit();
 
+    if(restarting)
+        xSemaphoreGive(calcTaskMutex);
+
     // wait for matrixCalculations to be run for first time inside calcTask - fill initial buffer and set Layer properties that are only set after first pass through matrixCalculations()
     while(rotationChange) {
         delay(1);
@@ -337,21 +585,62 @@ void SmartMatrixHub75Calc_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
 #define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::resetMultiRowRefreshMapPosition(void) {   
+uint32_t SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::getRefreshRowsForHardwareRows(uint16_t firstRow, uint16_t lastRow) {
+    const PanelMappingEntry * map = panelMap;
+    const uint32_t allRefreshRows = 0xFFFFFFFF >> (32 - matrix_scan_mod);
+    uint32_t refreshRows = 0;
+
+    if(firstRow > lastRow)
+        return 0;
+
+    // every row within a panel is covered
+    if(lastRow - firstRow + 1 >= matrix_panel_height)
+        return allRefreshRows;
+
+    // loadMatrixBuffers48/24 fill hardware row y from refresh row currentRow where (y % matrix_panel_height) is
+    // (currentRow + rowOffset) or (matrix_scan_mod - (currentRow + rowOffset) - 1) for upside down C-shape stacks,
+    // plus row_pair_offset for the second row of the pair.  Mark every refresh row that could match (a superset is fine)
+    for(int y = firstRow; y <= lastRow; y++) {
+        int panelRow = y % matrix_panel_height;
+
+        for(int pair = 0; pair < 2; pair++) {
+            int q = panelRow - (pair ? row_pair_offset : 0);
+            if(q < 0)
+                continue;
+
+            for(int flip = 0; flip < ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) ? 2 : 1); flip++) {
+                int x = flip ? (matrix_scan_mod - q - 1) : q;
+
+                int i = 0;
+                do {
+                    int r = x - map[i].rowOffset;
+                    if(r >= 0 && r < matrix_scan_mod)
+                        refreshRows |= (1UL << r);
+                } while(!IS_LAST_PANEL_MAP_ENTRY(map[i++]));
+            }
+        }
+    }
+
+    return refreshRows;
+}
+
+
+template <int dummyvar>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::resetMultiRowRefreshMapPosition(void) {   
     multiRowRefresh_mapIndex_CurrentRowGroups = 0;
     resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 }
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void) {   
     multiRowRefresh_mapIndex_CurrentPixelGroup = multiRowRefresh_mapIndex_CurrentRowGroups;
     multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped = 0;
     multiRowRefresh_NumPanelsAlreadyMapped = 0;
 }
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextRow(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextRow(void) {   
+    const PanelMappingEntry * map = panelMap;
 
     int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentRowGroups].rowOffset;
 
@@ -367,8 +656,8 @@ void SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextRow(void)
 }
 
 template <int dummyvar>
-void SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextPixelGroup(void) {   
+    const PanelMappingEntry * map = panelMap;
 
     int currentRowOffset = map[multiRowRefresh_mapIndex_CurrentPixelGroup].rowOffset;
 
@@ -395,8 +684,8 @@ void SmartMatrixHub75Calc_NT<dummyvar>::advanceMultiRowRefreshMapToNextPixelGrou
 
 // returns the row offset from the map, or -1 if we've gone through the whole map already
 template <int dummyvar>
-int SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshRowOffset(void) {   
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshRowOffset(void) {   
+    const PanelMappingEntry * map = panelMap;
 
     if(IS_LAST_PANEL_MAP_ENTRY(map[multiRowRefresh_mapIndex_CurrentRowGroups])){
         return -1;
@@ -406,126 +695,77 @@ int SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshRowOffset(void) {
 }
 
 template <int dummyvar>
-int SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshNumPixelsToMap(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshNumPixelsToMap(void) {        
+    const PanelMappingEntry * map = panelMap;
 
     return map[multiRowRefresh_mapIndex_CurrentPixelGroup].numPixels;    
 }
 
 template <int dummyvar>
-int SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshPixelGroupOffset(void) {        
-    static const PanelMappingEntry * map = getMultiRowRefreshPanelMap(panelType);
+int SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::getMultiRowRefreshPixelGroupOffset(void) {        
+    const PanelMappingEntry * map = panelMap;
 
     return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
 }
 
-#define REFRESH_PRINTFS 0
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::addPackingRun(int tempRowOffset, int numPixels, int bufferPosition, int step) {
+    while(numPixels > 0) {
+        int numRunPixels = numPixels;
+        bool skipped = false;
+
+        // split at the stacks with C-shape stacking, which isn't supported yet: every other stack isn't written
+        if(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) {
+            numRunPixels = std::min(numPixels, matrixWidth - (tempRowOffset % matrixWidth));
+            skipped = !((tempRowOffset / matrixWidth) % 2);
+        }
 
-//#define OEPWM_TEST_ENABLE // this is likely broken now
-#define OEPWM_THRESHOLD_BIT 1
+        if(!skipped) {
+            if(packingRuns) {
+                packingRuns[numPackingRuns].tempRowOffset = tempRowOffset;
+                packingRuns[numPackingRuns].numPixels = numRunPixels;
+                packingRuns[numPackingRuns].bufferPosition = bufferPosition;
+                packingRuns[numPackingRuns].step = step;
+            }
+            numPackingRuns++;
+        }
+
+        tempRowOffset += numRunPixels;
+        bufferPosition += numRunPixels * step;
+        numPixels -= numRunPixels;
+    }
+}
 
 template <int dummyvar>
-INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers48(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
-    int i;
+void SmartMatrixHub75Calc_NT<dummyvar>::calculateMultiRowRefreshTables(void) {
+    /*  Walk the multi row refresh map once, the same way loadMatrixBuffers used to for every refresh row, and record
+        the row offset of each physical row group, and split the temp buffer of each row group into runs of pixels going
+        to consecutive refresh buffer positions (in one direction), see packingRun.  Pixel block direction, the offset
+        from panels already mapped and stacking are folded into the runs, so packing has no per pixel mode branches.
+        Only counts the runs while packingRuns is NULL */
+    const int numPixelsPerTempRow = pixels_per_latch/physical_rows_per_refresh_row;
     int multiRowRefreshRowOffset = 0;
-    int numPixelsPerTempRow = pixels_per_latch/physical_rows_per_refresh_row;
-
-#if (REFRESH_PRINTFS >= 1)
-    printf("numPixelsPerTempRow = %d\r\n", numPixelsPerTempRow);
-#endif
-
-#if defined(ESP32)
-    // use buffers malloc'd previously
-    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr;
-    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr;
-#else
-    // static to avoid putting large buffer on the stack
-    static rgb48 tempRow0[numPixelsPerTempRow];
-    static rgb48 tempRow1[numPixelsPerTempRow];
-#endif
 
-    int c = 0;
+    numMultiRowRefreshRowGroups = 0;
+    numPackingRuns = 0;
     resetMultiRowRefreshMapPosition();
 
-    // go through this process for each physical row that is contained in the refresh row
     do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset(tempRow0, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
-        memset(tempRow1, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
-
-#if (REFRESH_PRINTFS >= 1)
-        printf("multiRowRefreshRowOffset = %d\r\n", multiRowRefreshRowOffset);
-#endif
-
-        // get a row of physical pixel data (HUB75 paired) from the layers
-        SM_Layer * templayer = baseLayer;
-        while(templayer) {
-            for(i=0; i<matrix_stack_height; i++) {
-                // Z-shape, bottom to top
-                if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // Z-shape, top to bottom
-                } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + i*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                // C-shape, bottom to top
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // alternate direction of filling (or loading) for each matrixwidth
-                    // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                    if((matrix_stack_height-i+1)%2) {
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
-                // C-shape, top to bottom
-                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    if((matrix_stack_height-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    } else {
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
-                    }
-                }
-            }
-            templayer = templayer->nextLayer;        
-        }
-
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            MATRIX_DATA_STORAGE_TYPE *p=&(frameBuffer[GET_DATA_OFFSET_FROM_ROW_AND_COLOR_DEPTH_BIT(currentRow, j)]); //bitplane location to write to
+        multiRowRefreshRowOffsetTable[numMultiRowRefreshRowGroups] = multiRowRefreshRowOffset;
+        packingRunIndex[numMultiRowRefreshRowGroups] = numPackingRuns;
 
-            int i=0;
+        if(physical_rows_per_refresh_row == 1) {
+            addPackingRun(0, numPixelsPerTempRow, 0, 1);
+        } else {
+            int i = 0;
 
-            // reset pixel map offset so we start filling from the first panel again
+            // start filling from the first panel again
             resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
 
             while(i < numPixelsPerTempRow) {
                 // get number of pixels to go through with current pass
                 int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("numPixelsToMap = %d\r\n", numPixelsToMap);
-#endif
-
                 bool reversePixelBlock = false;
                 if(numPixelsToMap < 0) {
                     reversePixelBlock = true;
@@ -535,251 +775,299 @@ INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers48(MATRIX_DATA_S
                 // get offset where pixels are written in the refresh buffer
                 int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
 
-#if (REFRESH_PRINTFS >= 1)
-                printf("currentMapOffset = %d\r\n", currentMapOffset);
+                addPackingRun(i, std::min(numPixelsToMap, numPixelsPerTempRow - i), currentMapOffset, reversePixelBlock ? -1 : 1);
+
+                i += numPixelsToMap; // keep track of current position on this temp buffer
+                advanceMultiRowRefreshMapToNextPixelGroup();
+            }
+        }
+
+        numMultiRowRefreshRowGroups++;
+
+        advanceMultiRowRefreshMapToNextRow();
+        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
+    } while ((multiRowRefreshRowOffset > 0) && (numMultiRowRefreshRowGroups < physical_rows_per_refresh_row));
+
+    packingRunIndex[numMultiRowRefreshRowGroups] = numPackingRuns;
+}
+
+#define REFRESH_PRINTFS 0
+
+//#define OEPWM_TEST_ENABLE // this is likely broken now
+#define OEPWM_THRESHOLD_BIT 1
+
+template <int dummyvar>
+INLINE void SmartMatrixHub75Calc_NT<dummyvar>::transposeChannelBits(uint8_t r0, uint8_t g0, uint8_t b0, uint8_t r1, uint8_t g1, uint8_t b1, uint8_t * planeBits, int stride, int numPlanes) {
+    // treat the six channels as rows of an 8x8 bit matrix and transpose it, byte n of the result holds bit n of every channel:
+    // bit 0 = r0, bit 1 = g0, bit 2 = b0, bit 3 = r1, bit 4 = g1, bit 5 = b1, matching the index into rgbBitsLUT
+    uint32_t lo = r0 | (g0 << 8) | (b0 << 16) | ((uint32_t)r1 << 24);
+    uint32_t hi = g1 | (b1 << 8);
+    uint32_t t;
+
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA;  lo = lo ^ t ^ (t << 7);
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA;  hi = hi ^ t ^ (t << 7);
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo = lo ^ t ^ (t << 14);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi = hi ^ t ^ (t << 14);
+    t = (lo ^ (hi << 4)) & 0xF0F0F0F0;  lo = lo ^ t;    hi = hi ^ (t >> 4);
+
+    for(int n=0; n < 8 && n < numPlanes; n++)
+        planeBits[n * stride] = (n < 4) ? (lo >> (8 * n)) : (hi >> (8 * (n - 4)));
+}
+
+#ifndef SM_NT_SPECIALIZED_PACKING
+#define SM_NT_SPECIALIZED_PACKING 1
 #endif
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+template <int dummyvar>
+void SmartMatrixHub75Calc_NT<dummyvar>::selectPackingKernel(void) {
+    typedef SmartMatrixHub75Calc_NT<dummyvar> calc;
+
+    // kernels with the common configurations as constants, 0 = the runtime value
+    static const struct {
+        uint8_t colorDepthBits;
+        uint16_t pixelsPerLatch;
+        bool multiRowRefresh;
+        packBitplanesFunction function;
+    } kernels[] = {
+#if (SM_NT_SPECIALIZED_PACKING)
+        { 8,   32, false, &calc::template packBitplanes<8, 32, false> },
+        { 8,   64, false, &calc::template packBitplanes<8, 64, false> },
+        { 8,  128, false, &calc::template packBitplanes<8, 128, false> },
+        { 8,  256, false, &calc::template packBitplanes<8, 256, false> },
+        { 12,  32, false, &calc::template packBitplanes<12, 32, false> },
+        { 12,  64, false, &calc::template packBitplanes<12, 64, false> },
+        { 12, 128, false, &calc::template packBitplanes<12, 128, false> },
+        { 12, 256, false, &calc::template packBitplanes<12, 256, false> },
+        { 8,    0, true,  &calc::template packBitplanes<8, 0, true> },
+        { 12,   0, true,  &calc::template packBitplanes<12, 0, true> },
+#endif
+        { 0,    0, false, &calc::template packBitplanes<0, 0, false> },
+        { 0,    0, true,  &calc::template packBitplanes<0, 0, true> },
+    };
+
+    bool multiRowRefresh = (physical_rows_per_refresh_row > 1);
+
+    for(unsigned int i=0; i < sizeof(kernels)/sizeof(kernels[0]); i++) {
+        if((kernels[i].colorDepthBits && kernels[i].colorDepthBits != color_depth_bits) ||
+            (kernels[i].pixelsPerLatch && kernels[i].pixelsPerLatch != pixels_per_latch) ||
+            kernels[i].multiRowRefresh != multiRowRefresh)
+            continue;
+
+        packBitplanesKernel = kernels[i].function;
+        if(kernels[i].colorDepthBits)
+            printf("SmartMatrix packing specialized for %d bits, %d pixels per latch\r\n", color_depth_bits, pixels_per_latch);
+        else
+            printf("SmartMatrix packing with the generic kernel\r\n");
+        return;
+    }
+}
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
-#if 1
-#if (REFRESH_PRINTFS >= 2)
-                printf("j = %02d, i = %03d, c = %03d, k = %03d, pos = %03d\r\n", j, i, c, k, refreshBufferPosition);
+template <int dummyvar>
+template <int colorDepthBits, int pixelsPerLatch, bool multiRowRefresh>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Calc_NT<dummyvar>::packBitplanes(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int rowGroup, int lsbMsbTransitionBit) {
+    // the same as the members when specialized, but constants the compiler can fold into the loops
+    const int numColorDepthBits = colorDepthBits ? colorDepthBits : color_depth_bits;
+    const int numPixelsPerLatch = pixelsPerLatch ? pixelsPerLatch : pixels_per_latch;
+    const int numPixelsPerTempRow = multiRowRefresh ? pixels_per_latch/physical_rows_per_refresh_row : numPixelsPerLatch;
+    const int rowBitsWords = numPixelsPerLatch + CLKS_DURING_LATCH;
+
+    const uint8_t * tempPlaneBits = tempPlaneBitsPtr;
+    const int i2sOrderSwap = (MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) ? 2 : 1;
+#if (CLKS_DURING_LATCH == 0)
+    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
+    const int latchStartPosition = numPixelsPerLatch - ((optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) ? 3 : 1);
+#endif
+
+    for(int j=0; j<numColorDepthBits; j++) {
+        const uint8_t * planeBits = &tempPlaneBits[j * numPixelsPerTempRow];
+
+        // bitplane location to write to, as GET_DATA_OFFSET_FROM_ROW_AND_COLOR_DEPTH_BIT(currentRow, j)
+        MATRIX_DATA_STORAGE_TYPE *p=&(frameBuffer[(currentRow * numColorDepthBits + j) * rowBitsWords]);
+
+#if (CLKS_DURING_LATCH == 0)
+        // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
+        int gpioRowAddress = currentRow;
+        // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
+        if(j == 0)
+            gpioRowAddress = currentRow-1;
+
+        int rowAddressBits = 0;
+        if (gpioRowAddress & 0x01) rowAddressBits|=BIT_A;
+        if (gpioRowAddress & 0x02) rowAddressBits|=BIT_B;
+        if (gpioRowAddress & 0x04) rowAddressBits|=BIT_C;
+        if (gpioRowAddress & 0x08) rowAddressBits|=BIT_D;
+        if (gpioRowAddress & 0x10) rowAddressBits|=BIT_E;
 #endif
 
+        // each run writes consecutive temp buffer pixels to refresh buffer positions going one way, see calculateMultiRowRefreshTables()
+        for(int r = packingRunIndex[rowGroup]; r < packingRunIndex[rowGroup + 1]; r++) {
+            const int firstPixel = packingRuns[r].tempRowOffset;
+            const int endPixel = firstPixel + packingRuns[r].numPixels;
+            const int step = multiRowRefresh ? packingRuns[r].step : 1;
+            int refreshBufferPosition = packingRuns[r].bufferPosition;
+
+            for(int k=firstPixel; k < endPixel; k++, refreshBufferPosition += step) {
+                int v=0;
+
 #if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = currentRow-1;
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == pixels_per_latch-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == pixels_per_latch-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == pixels_per_latch-3) v|=BIT_LAT;
-                    }
+                v|=rowAddressBits;
+
+                // need to disable OE after latch to hide row transition
+                if((refreshBufferPosition) == 0) v|=BIT_OE;
+
+                // drive latch while shifting out last bit of RGB data (or the last 3 bits with FM6126A)
+                if((refreshBufferPosition) >= latchStartPosition) v|=BIT_LAT;
 #endif
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+                // turn off OE after brightness value is reached when displaying MSBs
+                // MSBs always output normal brightness
+                // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
+                if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
 
 #ifndef OEPWM_TEST_ENABLE
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
+                // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+                if(j && j <= lsbMsbTransitionBit) {
+                    // divide brightness in half for each bit below lsbMsbTransitionBit
+                    int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
+                    if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
+                }
+#else
+                // TODO: this is probably not working after adding support for multi-row refresh panels
+                // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
+                if(j && j <= lsbMsbTransitionBit) {
+                    // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
+                    if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
+                        // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
+                        int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
+                        // now setting brightness for LSB, use PWM OE
+                        if((k%2) || k >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
+                    } else {
                         // divide brightness in half for each bit below lsbMsbTransitionBit
                         int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
                         if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
                     }
-#else
-                    // TODO: this is probably not working after adding support for multi-row refresh panels
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // all bits through OEPWM_THRESHOLD_BIT we handle by toggling short PWM pulses smaller than one clock cycle
-                        if(j >= 1 && j <= OEPWM_THRESHOLD_BIT) {
-                            // width of pwm OE pulse is ~1/2 the width of a DMA OE pulse (so shift lsbPwmBrightnessPulses one fewer times than lsbBrightness)
-                            int lsbPwmBrightnessPulses = (shiftedBrightness) >> (lsbMsbTransitionBit - j + 1 - 1);
-                            // now setting brightness for LSB, use PWM OE
-                            if((k%2) || k >= (2 * lsbPwmBrightnessPulses)) v|=BIT_OE;
-                        } else {
-                            // divide brightness in half for each bit below lsbMsbTransitionBit
-                            int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                            if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                        }
-                    }                
-#endif
-                    
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
-#if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==pixels_per_latch-1) v|=BIT_OE;
-#else
-                    if((refreshBufferPosition)>=pixels_per_latch-2) v|=BIT_OE;
+                }
 #endif
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
-
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
-
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
-
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
+                // need to turn off OE one clock before latch, otherwise can get ghosting
+#if (CLKS_DURING_LATCH > 0)
+                if((refreshBufferPosition)==numPixelsPerLatch-1) v|=BIT_OE;
 #else
-                    v|=BIT_G1;
+                if((refreshBufferPosition)>=numPixelsPerLatch-2) v|=BIT_OE;
 #endif
 
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
-                    } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                //p->data[(refreshBufferPosition)+2] = v;
-                                p[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                //p->data[(refreshBufferPosition)+2] = v;
-                                p[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p[(refreshBufferPosition)-2] = v;
-                            }
-                        } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p[(refreshBufferPosition)+1] = v;
-                            }
-                        }
-                    }
-                }
+                // RGB data bits for this pixel and bitplane, transposed before the bitplane loop
+                v|=rgbBitsLUT[planeBits[k]];
 
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
+                // HUB12 inverts R1 and OE (hub12InvertBits is 0 otherwise), saved in the reversed order I2S Tx FIFO mode1 expects,
+                // the same as the latch clocks below
+                p[refreshBufferPosition ^ i2sOrderSwap] = v ^ hub12InvertBits;
             }
+        }
 
-            // TODO: insert latch data for all color depth bits all at once at the end, saving a few cycles?
-            // TODO: prefill latch across all frames during begin() and only need to update when brightness/refreshrate changed?
+        // TODO: insert latch data for all color depth bits all at once at the end, saving a few cycles?
+        // TODO: prefill latch across all frames during begin() and only need to update when brightness/refreshrate changed?
 #if (CLKS_DURING_LATCH > 0)
-            // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
-            for(int k=pixels_per_latch; k < pixels_per_latch + CLKS_DURING_LATCH; k++) {
-                int v = 0;
-#if 1
-                // after data is shifted in, pulse latch for one clock cycle
-                if(k == pixels_per_latch) {
-                    v|=BIT_LAT;
-                }
+        // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
+        for(int k=numPixelsPerLatch; k < numPixelsPerLatch + CLKS_DURING_LATCH; k++) {
+            int v = 0;
+            // after data is shifted in, pulse latch for one clock cycle
+            if(k == numPixelsPerLatch) {
+                v|=BIT_LAT;
+            }
 
-                //Do not show image while the line bits are changing
-                v|=BIT_OE;
-
-                // set ADDX values to high while latch is high, keep them high while latch drops to clock it in to ADDX latch
-                if(k >= pixels_per_latch) {               
-                    if (currentRow & 0x01) v|=BIT_R1;
-                    if (currentRow & 0x02) v|=BIT_G1;
-                    if (currentRow & 0x04) v|=BIT_B1;
-                    if (currentRow & 0x08) v|=BIT_R2;
-                    if (currentRow & 0x10) v|=BIT_G2;
-                    // reserve B2 for OE SWITCH
+            //Do not show image while the line bits are changing
+            v|=BIT_OE;
+
+            // set ADDX values to high while latch is high, keep them high while latch drops to clock it in to ADDX latch
+            if(k >= numPixelsPerLatch) {
+                if (currentRow & 0x01) v|=BIT_R1;
+                if (currentRow & 0x02) v|=BIT_G1;
+                if (currentRow & 0x04) v|=BIT_B1;
+                if (currentRow & 0x08) v|=BIT_R2;
+                if (currentRow & 0x10) v|=BIT_G2;
+                // reserve B2 for OE SWITCH
 #ifdef OEPWM_TEST_ENABLE
-                    //if(j == 0) {
-                    // set the MUX to output PWM_OE instead of DMA_OE, for the latches corresponding to bit 0 - OEPWM_THRESHOLD_BIT
-                    if(j < OEPWM_THRESHOLD_BIT) {
-                        // now setting brightness for LSB, use PWM OE
-                        v|=BIT_B2;
-                    }
-#endif
+                // set the MUX to output PWM_OE instead of DMA_OE, for the latches corresponding to bit 0 - OEPWM_THRESHOLD_BIT
+                if(j < OEPWM_THRESHOLD_BIT) {
+                    // now setting brightness for LSB, use PWM OE
+                    v|=BIT_B2;
                 }
+#endif
+            }
 
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    // HUB12 inverts data (irrelevant here) and OE signals
-                    if(v & BIT_OE) {
-                        v = v & ~(BIT_OE);
-                    } else {
-                        v |= BIT_OE;
-                    }
+            if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
+                // HUB12 inverts data (irrelevant here) and OE signals
+                if(v & BIT_OE) {
+                    v = v & ~(BIT_OE);
+                } else {
+                    v |= BIT_OE;
                 }
-#else
-                v|=BIT_G1;
-#endif
+            }
 
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                    //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                    if(k%4 == 0){
-                        p[k+2] = v;
-                    } else if(k%4 == 1) {
-                        p[k+2] = v;
-                    } else if(k%4 == 2) {
-                        p[k-2] = v;
-                    } else { //if(k%4 == 3)
-                        p[k-2] = v;
-                    }
+            if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
+                //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
+                if(k%4 == 0){
+                    p[k+2] = v;
+                } else if(k%4 == 1) {
+                    p[k+2] = v;
+                } else if(k%4 == 2) {
+                    p[k-2] = v;
+                } else { //if(k%4 == 3)
+                    p[k-2] = v;
+                }
+            } else {
+                //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
+                if(k%2){
+                    p[k-1] = v;
                 } else {
-                    //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                    if(k%2){
-                        p[k-1] = v;
-                    } else {
-                        p[k+1] = v;
-                    }
+                    p[k+1] = v;
                 }
             }
-#endif
         }
-
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
-
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+#endif
+    }
 }
 
 template <int dummyvar>
-INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers24(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers48(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
     int i;
-    int multiRowRefreshRowOffset = 0;
     int numPixelsPerTempRow = pixels_per_latch/physical_rows_per_refresh_row;
 
+    // buffers from a previous begin() aren't used anymore now that refresh is stopped
+    free(tempRow0Ptr);
+    free(tempRow1Ptr);
+    free(tempPlaneBitsPtr);
+
+#if (REFRESH_PRINTFS >= 1)
+    printf("numPixelsPerTempRow = %d\r\n", numPixelsPerTempRow);
+#endif
+
 #if defined(ESP32)
     // use buffers malloc'd previously
-    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr;
-    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr;
+    rgb48 * tempRow0 = (rgb48*)tempRow0Ptr;
+    rgb48 * tempRow1 = (rgb48*)tempRow1Ptr;
+    uint8_t * tempPlaneBits = (uint8_t*)tempPlaneBitsPtr;
 #else
     // static to avoid putting large buffer on the stack
-    static rgb24 tempRow0[numPixelsPerTempRow];
-    static rgb24 tempRow1[numPixelsPerTempRow];
+    static rgb48 tempRow0[numPixelsPerTempRow];
+    static rgb48 tempRow1[numPixelsPerTempRow];
+    static uint8_t tempPlaneBits[COLOR_DEPTH_BITS * numPixelsPerTempRow];
 #endif
 
-    int c = 0;
-    resetMultiRowRefreshMapPosition();
-
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset(tempRow0, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
-        memset(tempRow1, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+    for(int rowGroup = 0; rowGroup < numMultiRowRefreshRowGroups; rowGroup++) {
+        int multiRowRefreshRowOffset = multiRowRefreshRowOffsetTable[rowGroup];
+
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        if (!baseLayer || !baseLayer->isLayerOpaque()) {
+            memset(tempRow0, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
+            memset(tempRow1, 0x00, sizeof(rgb48) * numPixelsPerTempRow);
+        }
+
+#if (REFRESH_PRINTFS >= 1)
+        printf("multiRowRefreshRowOffset = %d\r\n", multiRowRefreshRowOffset);
+#endif
 
         // get a row of physical pixel data (HUB75 paired) from the layers
         SM_Layer * templayer = baseLayer;
@@ -789,246 +1077,152 @@ INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers24(MATRIX_DATA_S
                 if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // Z-shape, top to bottom
                 } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // fill data from top to bottom, so top panel is the one closest to Teensy
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + i*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                    templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + i*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + i*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + i*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                 // C-shape, bottom to top
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
                     (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     // alternate direction of filling (or loading) for each matrixwidth
                     // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
                     if((matrix_stack_height-i+1)%2) {
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 // C-shape, top to bottom
                 } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
                     !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
                     if((matrix_stack_height-i)%2) {
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
-                        templayer->fillRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 }
             }
-            templayer = templayer->nextLayer;        
+            templayer = templayer->nextLayer;
         }
-  
-        for(int j=0; j<COLOR_DEPTH_BITS; j++) {
-            int maskoffset = 0;
-            if(COLOR_DEPTH_BITS == 12)   // 36-bit color
-                maskoffset = 4;
-            else if (COLOR_DEPTH_BITS == 16) // 48-bit color
-                maskoffset = 0;
-            else if (COLOR_DEPTH_BITS == 8)  // 24-bit color
-                maskoffset = 0;
-
-            uint16_t mask = (1 << (j + maskoffset));
-            
-            MATRIX_DATA_STORAGE_TYPE *p=&(frameBuffer[GET_DATA_OFFSET_FROM_ROW_AND_COLOR_DEPTH_BIT(currentRow, j)]); //bitplane location to write to
-            
-            int i=0;
-
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
-
-            while(i < numPixelsPerTempRow) {
-                // get number of pixels to go through with current pass
-                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
 
-                bool reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
+        // tempRow1 is offset from tempRow0 in the pattern so the two halves of the panel don't dither in lockstep
+        if(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) {
+            ditherRGB(tempRow0, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset, ditherFrame, COLOR_DEPTH_BITS);
+            ditherRGB(tempRow1, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 2, ditherFrame, COLOR_DEPTH_BITS);
+        }
 
-                // get offset where pixels are written in the refresh buffer
-                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        // transpose the color channels of each pixel, so each bitplane gets a byte with one bit per channel, 8 bitplanes at a time
+        // this replaces six data-dependent branches per pixel per bitplane with a table lookup in the bitplane loop below
+        const int maskoffset = 16 - COLOR_DEPTH_BITS;   // 36-bit color uses the upper 12 bits of each channel, dithered 24-bit color the upper 8 bits
 
-                // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-                for(int k=0; k < numPixelsToMap; k++) {
-                    int v=0;
+        for(int k=0; k < numPixelsPerTempRow; k++) {
+            for(int bitindex = 0; bitindex < COLOR_DEPTH_BITS; bitindex += 8) {
+                const int shift = maskoffset + bitindex;
 
-                    int refreshBufferPosition;
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
+                transposeChannelBits(tempRow0[k].red >> shift, tempRow0[k].green >> shift, tempRow0[k].blue >> shift,
+                    tempRow1[k].red >> shift, tempRow1[k].green >> shift, tempRow1[k].blue >> shift,
+                    &tempPlaneBits[bitindex * numPixelsPerTempRow + k], numPixelsPerTempRow, COLOR_DEPTH_BITS - bitindex);
+            }
+        }
 
-#if (CLKS_DURING_LATCH == 0)
-                    // if there is no latch to hold address, output ADDX lines directly to GPIO and latch data at end of cycle
-                    int gpioRowAddress = currentRow;
-                    // normally output current rows ADDX, special case for LSB, output previous row's ADDX (as previous row is being displayed for one latch cycle)
-                    if(j == 0)
-                        gpioRowAddress = currentRow-1;
-
-                    if (gpioRowAddress & 0x01) v|=BIT_A;
-                    if (gpioRowAddress & 0x02) v|=BIT_B;
-                    if (gpioRowAddress & 0x04) v|=BIT_C;
-                    if (gpioRowAddress & 0x08) v|=BIT_D;
-                    if (gpioRowAddress & 0x10) v|=BIT_E;
-
-                    // need to disable OE after latch to hide row transition
-                    if((refreshBufferPosition) == 0) v|=BIT_OE;
-
-                    // drive latch while shifting out last bit of RGB data
-                    if((refreshBufferPosition) == pixels_per_latch-1) v|=BIT_LAT;
-
-                    // experimental FM6126A support on ESP32 without external latch: make LAT pulse 3x clocks wide, matching the FM6126A "DATA_LATCH" command (and not the "RESET_OEN" command)
-                    if(optionFlags & SMARTMATRIX_OPTIONS_FM6126A_RESET_AT_START) {
-                        if((refreshBufferPosition) == pixels_per_latch-2) v|=BIT_LAT;
-                        if((refreshBufferPosition) == pixels_per_latch-3) v|=BIT_LAT;
-                    }
-#endif
+        // write the bitplanes with the kernel selected in begin()
+        (this->*packBitplanesKernel)(frameBuffer, currentRow, rowGroup, lsbMsbTransitionBit);
+    }
+}
 
-                    // turn off OE after brightness value is reached when displaying MSBs
-                    // MSBs always output normal brightness
-                    // LSB (!j) outputs normal brightness as MSB from previous row is being displayed
-                    if((j > lsbMsbTransitionBit || !j) && ((refreshBufferPosition) >= shiftedBrightness)) v|=BIT_OE;
+template <int dummyvar>
+INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers24(MATRIX_DATA_STORAGE_TYPE * frameBuffer, int currentRow, int lsbMsbTransitionBit, int numBrightnessShifts) {
+    int i;
+    int numPixelsPerTempRow = pixels_per_latch/physical_rows_per_refresh_row;
 
-                    // special case for the bits *after* LSB through (lsbMsbTransitionBit) - OE is output after data is shifted, so need to set OE to fractional brightness
-                    if(j && j <= lsbMsbTransitionBit) {
-                        // divide brightness in half for each bit below lsbMsbTransitionBit
-                        int lsbBrightness = shiftedBrightness >> (lsbMsbTransitionBit - j + 1);
-                        if((refreshBufferPosition) >= lsbBrightness) v|=BIT_OE;
-                    }
+    // buffers from a previous begin() aren't used anymore now that refresh is stopped
+    free(tempRow0Ptr);
+    free(tempRow1Ptr);
+    free(tempPlaneBitsPtr);
 
-                    // need to turn off OE one clock before latch, otherwise can get ghosting
-#if (CLKS_DURING_LATCH > 0)
-                    if((refreshBufferPosition)==pixels_per_latch-1) v|=BIT_OE;
+#if defined(ESP32)
+    // use buffers malloc'd previously
+    rgb24 * tempRow0 = (rgb24*)tempRow0Ptr;
+    rgb24 * tempRow1 = (rgb24*)tempRow1Ptr;
+    uint8_t * tempPlaneBits = (uint8_t*)tempPlaneBitsPtr;
 #else
-                    if((refreshBufferPosition)>=pixels_per_latch-2) v|=BIT_OE;
+    // static to avoid putting large buffer on the stack
+    static rgb24 tempRow0[numPixelsPerTempRow];
+    static rgb24 tempRow1[numPixelsPerTempRow];
+    static uint8_t tempPlaneBits[COLOR_DEPTH_BITS * numPixelsPerTempRow];
 #endif
 
-                    if (tempRow0[i+k].red & mask)
-                        v|=BIT_R1;
-                    if (tempRow0[i+k].green & mask)
-                        v|=BIT_G1;
-                    if (tempRow0[i+k].blue & mask)
-                        v|=BIT_B1;
-                    if (tempRow1[i+k].red & mask)
-                        v|=BIT_R2;
-                    if (tempRow1[i+k].green & mask)
-                        v|=BIT_G2;
-                    if (tempRow1[i+k].blue & mask)
-                        v|=BIT_B2;
-
-                    if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                        // HUB12 format inverts the data (assume we're only using R1 for now), and OE signals
-
-                        if(v & BIT_OE) {
-                            v = v & ~(BIT_OE);
-                        } else {
-                            v |= BIT_OE;
-                        }
-
-                        if(v & BIT_R1) {
-                            v = v & ~(BIT_R1);
-                        } else {
-                            v |= BIT_R1;
-                        }
-                    }               
-
-                    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-                        //currentRowDataPtr->rowbits[j].data[(((i+matrixWidth-1)-k)*DMA_UPDATES_PER_CLOCK)] = o0.word;
-                        //TODO: support C-shape stacking
-                    } else {
-                        if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                            //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%4 == 0){
-                                p[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 1) {
-                                p[(refreshBufferPosition)+2] = v;
-                            } else if(refreshBufferPosition%4 == 2) {
-                                p[(refreshBufferPosition)-2] = v;
-                            } else { //if(refreshBufferPosition%4 == 3)
-                                p[(refreshBufferPosition)-2] = v;
-                            }
-                        } else {
-                            //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                            if(refreshBufferPosition%2){
-                                p[(refreshBufferPosition)-1] = v;
-                            } else {
-                                p[(refreshBufferPosition)+1] = v;
-                            }
-                        }
-                    }
-                }
-
-                i += numPixelsToMap; // keep track of current position on this temp buffer
-                advanceMultiRowRefreshMapToNextPixelGroup();
-            }
-
-#if (CLKS_DURING_LATCH > 0)
-            // if external latch is used to hold ADDX lines, load the ADDX latch and latch the RGB data here
-            for(int k=pixels_per_latch; k < pixels_per_latch + CLKS_DURING_LATCH; k++) {
-                int v = 0;
-                // after data is shifted in, pulse latch for one clock cycle
-                if(k == pixels_per_latch) {
-                    v|=BIT_LAT;
-                }
+    // go through this process for each physical row that is contained in the refresh row
+    for(int rowGroup = 0; rowGroup < numMultiRowRefreshRowGroups; rowGroup++) {
+        int multiRowRefreshRowOffset = multiRowRefreshRowOffsetTable[rowGroup];
 
-                //Do not show image while the line bits are changing
-                v|=BIT_OE;
-
-                // set ADDX values to high while latch is high, keep them high while latch drops to clock it in to ADDX latch
-                if(k >= pixels_per_latch) {               
-                    if (currentRow & 0x01) v|=BIT_R1;
-                    if (currentRow & 0x02) v|=BIT_G1;
-                    if (currentRow & 0x04) v|=BIT_B1;
-                    if (currentRow & 0x08) v|=BIT_R2;
-                    if (currentRow & 0x10) v|=BIT_G2;
-                    // reserve B2 for OE SWITCH
-                }
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        if (!baseLayer || !baseLayer->isLayerOpaque()) {
+            memset(tempRow0, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+            memset(tempRow1, 0x00, sizeof(rgb24) * numPixelsPerTempRow);
+        }
 
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    // HUB12 inverts data (irrelevant here) and OE signals
-                    if(v & BIT_OE) {
-                        v = v & ~(BIT_OE);
+        // get a row of physical pixel data (HUB75 paired) from the layers
+        SM_Layer * templayer = baseLayer;
+        while(templayer) {
+            for(i=0; i<matrix_stack_height; i++) {
+                // Z-shape, bottom to top
+                if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
+                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
+                    // fill data from bottom to top, so bottom panel is the one closest to Teensy
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                // Z-shape, top to bottom
+                } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
+                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
+                    // fill data from top to bottom, so top panel is the one closest to Teensy
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + i*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                    templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + i*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
+                // C-shape, bottom to top
+                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
+                    (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
+                    // alternate direction of filling (or loading) for each matrixwidth
+                    // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
+                    if((matrix_stack_height-i+1)%2) {
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        v |= BIT_OE;
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (i)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (i)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
-                }
-
-                if(MATRIX_I2S_MODE == I2S_PARALLEL_BITS_8) {
-                    //Save the calculated value to the bitplane memory in 16-bit reversed order to account for I2S Tx FIFO mode1 ordering
-                    if(k%4 == 0){
-                        p[k+2] = v;
-                    } else if(k%4 == 1) {
-                        p[k+2] = v;
-                    } else if(k%4 == 2) {
-                        p[k-2] = v;
-                    } else { //if(k%4 == 3)
-                        p[k-2] = v;
-                    }
-                } else {
-                    //Save the calculated value to the bitplane memory in reverse order to account for I2S Tx FIFO mode1 ordering
-                    if(k%2){
-                        p[k-1] = v;
+                // C-shape, top to bottom
+                } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
+                    !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
+                    if((matrix_stack_height-i)%2) {
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((currentRow + multiRowRefreshRowOffset) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     } else {
-                        p[k+1] = v;
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + row_pair_offset + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow0[i*matrixWidth], numBrightnessShifts);
+                        templayer->fillCoveredRefreshRow((matrix_scan_mod-(currentRow + multiRowRefreshRowOffset)-1) + (matrix_stack_height-i-1)*matrix_panel_height, &tempRow1[i*matrixWidth], numBrightnessShifts);
                     }
                 }
             }
-#endif
+            templayer = templayer->nextLayer;
         }
 
-        c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
+        // transpose the color channels of each pixel, so each bitplane gets a byte with one bit per channel
+        // this replaces six data-dependent branches per pixel per bitplane with a table lookup in the bitplane loop below
+        for(int k=0; k < numPixelsPerTempRow; k++) {
+            transposeChannelBits(tempRow0[k].red, tempRow0[k].green, tempRow0[k].blue,
+                tempRow1[k].red, tempRow1[k].green, tempRow1[k].blue,
+                &tempPlaneBits[k], numPixelsPerTempRow, COLOR_DEPTH_BITS);
+        }
 
-        advanceMultiRowRefreshMapToNextRow();
-        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-    } while (multiRowRefreshRowOffset > 0);
+        // write the bitplanes with the kernel selected in begin()
+        (this->*packBitplanesKernel)(frameBuffer, currentRow, rowGroup, lsbMsbTransitionBit);
+    }
 }
 
 template <int dummyvar>
@@ -1037,13 +1231,23 @@ INLINE void SmartMatrixHub75Calc_NT<dummyvar>::loadMatrixBuffers(int lsbMsbTrans
     unsigned char currentRow;
 
     MATRIX_DATA_STORAGE_TYPE * currentFrameDataPtr = _matrixRefresh->getNextFrameBufferPtr();
+    MATRIX_DATA_STORAGE_TYPE * previousFrameDataPtr = _matrixRefresh->getPreviousFrameBufferPtr();
 
     for(currentRow = 0; currentRow < matrix_scan_mod; currentRow++) {
+        // copying an unchanged row from the previous frame is much faster than filling it from the layers and repacking
+        if(!(changedRefreshRows & (1UL << currentRow))) {
+            if(currentFrameDataPtr != previousFrameDataPtr)
+                memcpy(&currentFrameDataPtr[GET_DATA_OFFSET_FROM_ROW_AND_COLOR_DEPTH_BIT(currentRow, 0)], &previousFrameDataPtr[GET_DATA_OFFSET_FROM_ROW_AND_COLOR_DEPTH_BIT(currentRow, 0)], SIZE_OF_ROWDATASTRUCT);
+            continue;
+        }
+
         // TODO: support rgb36/48 with same function, copy function to rgb24
         if(COLOR_DEPTH_BITS == 16)
             loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
         else if(COLOR_DEPTH_BITS == 12)
             loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
+        else if(COLOR_DEPTH_BITS == 8 && (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER))
+            loadMatrixBuffers48(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
         else if(COLOR_DEPTH_BITS == 8)
             loadMatrixBuffers24(currentFrameDataPtr, currentRow, lsbMsbTransitionBit, numBrightnessShifts);
     }
@@ -28,11 +28,68 @@
 
 #define ESP32_NUM_FRAME_BUFFERS   2
 
+// frame buffers, descriptors and the calc buffer are placed in one DMA capable block, each starting on this boundary
+#define ESP32_DMA_ARENA_ALIGNMENT   4
+
+// ESP32-S3 with SMARTMATRIX_USE_PSRAM: frame buffers come from PSRAM, read directly by GDMA in 64-byte blocks, descriptors stay in internal RAM
+// PSRAM can't be read while flash is written, so SMARTMATRIX_FLASH_SAFE_REFRESH keeps the frame buffers in internal RAM
+#if CONFIG_IDF_TARGET_ESP32S3 && defined(BOARD_HAS_PSRAM) && defined(SMARTMATRIX_USE_PSRAM) && !defined(SMARTMATRIX_FLASH_SAFE_REFRESH)
+    #define ESP32_FRAMES_IN_PSRAM   1
+#else
+    #define ESP32_FRAMES_IN_PSRAM   0
+#endif
+#define ESP32_PSRAM_DMA_ALIGNMENT   64
+
+// clocks stored for each bitplane of a row.  Descriptors start on bitplanes, so with frames in PSRAM each bitplane is padded to a whole
+// number of ESP32_PSRAM_DMA_ALIGNMENT blocks; the calc fills the padding with the last clock blanked and LAT released, which adds the same
+// dark time to every bitplane and keeps the BCM weights
+#if ESP32_FRAMES_IN_PSRAM
+    #define ESP32_CLKS_PER_BITPLANE     ((((PIXELS_PER_LATCH + CLKS_DURING_LATCH) * sizeof(MATRIX_DATA_STORAGE_TYPE) + ESP32_PSRAM_DMA_ALIGNMENT - 1) & \
+                                          ~(ESP32_PSRAM_DMA_ALIGNMENT - 1)) / sizeof(MATRIX_DATA_STORAGE_TYPE))
+#else
+    #define ESP32_CLKS_PER_BITPLANE     (PIXELS_PER_LATCH + CLKS_DURING_LATCH)
+#endif
+
+// with SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS, the first rows of each frame keep their own descriptors so DMA is busy with them while
+// the frame start ISR re-points the shared descriptors for the remaining rows; more rows give the ISR more time to get ahead of DMA
+#ifndef ESP32_SHARED_DESCRIPTORS_HEAD_ROWS
+#define ESP32_SHARED_DESCRIPTORS_HEAD_ROWS  2
+#endif
+
+// with SMARTMATRIX_OPTIONS_SCRAMBLED_BCM, the number of passes over all rows each frame is split into, each showing ~1/n of every row's bitplanes
+#ifndef ESP32_BCM_SUBFRAMES
+#define ESP32_BCM_SUBFRAMES                 4
+#endif
+
+// begin() prints its RAM search and allocations, set to 0 to leave out those prints (and the heap walks that go with them) at startup
+// errors are still printed
+#ifndef SM_ESP32_BEGIN_DIAGNOSTICS
+#define SM_ESP32_BEGIN_DIAGNOSTICS          1
+#endif
+
+#if (SM_ESP32_BEGIN_DIAGNOSTICS == 1)
+    #define SM_BEGIN_PRINTF(...)            printf(__VA_ARGS__)
+    #define SM_BEGIN_SHOW_MEM()             show_esp32_all_mem()
+#else
+    #define SM_BEGIN_PRINTF(...)
+    #define SM_BEGIN_SHOW_MEM()
+#endif
+
+// keep the lsbMsbTransitionBit begin() settles on in NVS, keyed by a hash of the configuration, so the next boot with the same
+// configuration checks that one layout fits instead of searching for it
+#ifndef SM_ESP32_CACHE_REFRESH_CONFIG
+#define SM_ESP32_CACHE_REFRESH_CONFIG       0
+#endif
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixHub75Refresh {
 public:
+    // one bitplane of one row as clocked out by I2S, one MATRIX_DATA_STORAGE_TYPE per clock
+    // uint16_t is needed when the address and LAT/OE lines are output directly on I2S bits 6-12 (BIT_LAT 6, BIT_OE 7, BIT_A-BIT_E 8-12);
+    // pinouts with an external address latch use uint8_t
+    // (address shifted out on the RGB pins during CLKS_DURING_LATCH extra clocks), which halves the frame buffer size
     struct rowBitStruct {
-        MATRIX_DATA_STORAGE_TYPE data[PIXELS_PER_LATCH + CLKS_DURING_LATCH];
+        MATRIX_DATA_STORAGE_TYPE data[ESP32_CLKS_PER_BITPLANE];
     };
 
     struct rowDataStruct {
@@ -47,10 +104,13 @@ public:
 
     // init
     SmartMatrixHub75Refresh();
-    static void begin(uint32_t dmaRamToKeepFreeBytes = 0);
+    static void begin(uint32_t dmaRamToKeepFreeBytes = 0, size_t calcBufferBytes = 0);
+    // stops DMA and the shift complete interrupt, begin() calls this itself before reusing or freeing the buffers of a previous begin()
+    static void stop(void);
 
     // refresh API
     static frameStruct * getNextFrameBufferPtr(void);
+    static frameStruct * getPreviousFrameBufferPtr(void);
     static void writeFrameBuffer(uint8_t currentFrame);
     static void recoverFromDmaUnderrun(void);
     static bool isFrameBufferFree(void);
@@ -60,6 +120,12 @@ public:
     static void setMatrixCalculationsCallback(matrix_calc_callback f);
     static void markRefreshComplete(void);
     static uint8_t getLsbMsbTransitionBit(void);
+    // relinks the descriptors for a new minimum refresh rate, or a fixed lsbMsbTransitionBit (-1 picks the lowest that meets the refresh rate)
+    // the new chains are built in the spare descriptor block and swapped in by the next writeFrameBuffer(), which must be packed for the new
+    // lsbMsbTransitionBit.  The spare block is allocated by the first call, sized for any lsbMsbTransitionBit, and reused after that.
+    // Call only while isFrameBufferFree(), returns false if there isn't enough DMA RAM or with shared descriptors
+    static bool reconfigure(uint16_t newMinRefreshRate, int8_t newLsbMsbTransitionBit = -1);
+    static void * getCalcBuffer(void);
 
 private:
     static uint16_t refreshRate;
@@ -70,6 +136,43 @@ private:
     static matrix_calc_callback matrixCalcCallback;
 
     static CircularBuffer_SM dmaBuffer;
+
+    // single block holding all refresh allocations, reserved once in begin() so the largest free DMA block is all that matters
+    static uint8_t * dmaArena;
+    static size_t dmaArenaSize;
+    static size_t dmaArenaUsed;
+    static void * calcBuffer;
+    static size_t getDmaArenaBytes(int numDescriptors, size_t calcBufferBytes);
+    static void * allocateFromDmaArena(size_t bytes);
+
+    // shared descriptor chain: descriptors for rows after the head rows, currently pointing into matrixUpdateFrames[sharedDescriptorsFrame]
+    static lldesc_t * sharedDescriptors;
+    static int sharedDescriptorsCount;
+    static lldesc_t * sharedHeadDescriptors[ESP32_NUM_FRAME_BUFFERS];
+    static int sharedHeadDescriptorsCount;
+    static uint8_t sharedDescriptorsFrame;
+    static void sharedDescriptorsFrameStartISR(void);
+#if (SM_ISR_TRACE_ENABLED == 1)
+    static void traceShiftCompleteISR(void);
+#endif
+    // descriptor blocks for reconfigure(): the one from the arena and one from the heap, each frame's chain is in the active block
+    static lldesc_t * arenaDescriptors;
+    static int arenaDescriptorsCapacity;
+    static lldesc_t * heapDescriptors;
+    static int heapDescriptorsCapacity;
+    static lldesc_t * activeDescriptors;
+    static lldesc_t * pendingDescriptors;
+    static int pendingDescriptorsCount;
+    static volatile bool descriptorSwapPending;
+    static int getNumDescriptorsPerRow(int transitionBit);
+    static int getRefreshRateForTransitionBit(int transitionBit);
+    // everything the search in begin() depends on
+    static uint32_t getRefreshConfigHash(uint32_t dmaRamToKeepFreeBytes, size_t calcBufferBytes);
+    // returns -1 if nothing is stored for configHash
+    static int loadCachedTransitionBit(uint32_t configHash);
+    static void storeCachedTransitionBit(uint32_t configHash, int transitionBit);
+    static lldesc_t * linkRowDescriptors(lldesc_t * dmadesc, lldesc_t * prevdmadesc, frameStruct * frame, int row);
+    static void scrambleFrameDescriptors(lldesc_t * dmadesc, int numDescriptorsPerRow);
 };
 
 #endif
@@ -35,11 +35,17 @@
 #include "freertos/queue.h"
 
 #include "esp_heap_caps.h"
+#if (SM_ESP32_CACHE_REFRESH_CONFIG == 1)
+#include "nvs.h"
+#endif
 #include "i2s_parallel.h"
 #endif
 
 #include "Esp32MemDisplay.h"
-#include "rom/lldesc.h"
+
+#if ESP32_FRAMES_IN_PSRAM
+#include "esp32s3/rom/cache.h"
+#endif
 
 #define INLINE __attribute__( ( always_inline ) ) inline
 
@@ -65,12 +71,63 @@ uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelTy
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrames[ESP32_NUM_FRAME_BUFFERS];
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaArena = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+size_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaArenaSize = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+size_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaArenaUsed = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calcBuffer = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedDescriptors = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedDescriptorsCount = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedHeadDescriptors[ESP32_NUM_FRAME_BUFFERS];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedHeadDescriptorsCount = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedDescriptorsFrame = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::arenaDescriptors = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::arenaDescriptorsCapacity = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::heapDescriptors = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::heapDescriptorsCapacity = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::activeDescriptors = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::pendingDescriptors = NULL;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::pendingDescriptorsCount = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::descriptorSwapPending = false;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Refresh(void) {
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameBufferFree(void) {
+bool SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameBufferFree(void) {
     if(cbIsFull(&dmaBuffer))
         return false;
     else
@@ -78,14 +135,33 @@ bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr(void) {
+typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr(void) {
     return matrixUpdateFrames[cbGetNextWrite(&dmaBuffer)];
 }
 
+// returns the frame most recently written with writeFrameBuffer()
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPreviousFrameBufferPtr(void) {
+    return matrixUpdateFrames[(cbGetNextWrite(&dmaBuffer) + ESP32_NUM_FRAME_BUFFERS - 1) % ESP32_NUM_FRAME_BUFFERS];
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(uint8_t currentFrame) {
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeFrameBuffer(uint8_t currentFrame) {
     //SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameStruct * currentFramePtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextFrameBufferPtr();
-    i2s_parallel_flip_to_buffer(&I2S1, cbGetNextWrite(&dmaBuffer));
+#if ESP32_FRAMES_IN_PSRAM
+    // GDMA reads PSRAM directly, the calc's writes have to leave the cache before the frame is shown
+    Cache_WriteBack_Addr((uint32_t)getNextFrameBufferPtr(), sizeof(frameStruct));
+#endif
+
+    // a frame packed after reconfigure() is shown with the new chains, the switch happens where DMA would have flipped to this frame
+    if(descriptorSwapPending) {
+        i2s_parallel_replace_descriptors(&I2S1, pendingDescriptors, pendingDescriptorsCount,
+            pendingDescriptors + pendingDescriptorsCount, pendingDescriptorsCount, cbGetNextWrite(&dmaBuffer));
+        activeDescriptors = pendingDescriptors;
+        descriptorSwapPending = false;
+    } else {
+        i2s_parallel_flip_to_buffer(&I2S1, cbGetNextWrite(&dmaBuffer));
+    }
     cbWrite(&dmaBuffer);
 }
 
@@ -99,12 +175,195 @@ typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelT
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrix_calc_callback f) {
-    setShiftCompleteCallback(f);
     matrixCalcCallback = f;
+#if (SM_ISR_TRACE_ENABLED == 1)
+    setShiftCompleteCallback(traceShiftCompleteISR);
+#else
+    if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS)
+        setShiftCompleteCallback(sharedDescriptorsFrameStartISR);
+    else
+        setShiftCompleteCallback(f);
+#endif
+}
+
+#if (SM_ISR_TRACE_ENABLED == 1)
+// wraps the shift complete callback with ISR trace events, DMA repeats the last frame instead of underrunning so there are no underrun events
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void IRAM_ATTR SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::traceShiftCompleteISR(void) {
+    SM_TRACE_ISR(SM_ISR_TRACE_FRAME_SHIFT, SM_ISR_TRACE_ENTRY, dmaBuffer.count);
+    if(optionFlags & SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS)
+        sharedDescriptorsFrameStartISR();
+    else if(matrixCalcCallback)
+        matrixCalcCallback();
+    SM_TRACE_ISR(SM_ISR_TRACE_FRAME_SHIFT, SM_ISR_TRACE_EXIT, dmaBuffer.count);
+}
+#endif
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNumDescriptorsPerRow(int transitionBit) {
+    int numDescriptorsPerRow = 1;
+    for(int i=transitionBit + 1; i<COLOR_DEPTH_BITS; i++)
+        numDescriptorsPerRow += 1<<(i - transitionBit - 1);
+    return numDescriptorsPerRow;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRateForTransitionBit(int transitionBit) {
+    int psPerClock = 1000000000000UL/ESP32_I2S_CLOCK_SPEED;
+    int nsPerLatch = (ESP32_CLKS_PER_BITPLANE * psPerClock) / 1000;
+
+    // add time to shift out LSBs + LSB-MSB transition bit - this ignores fractions...
+    int nsPerRow = COLOR_DEPTH_BITS * nsPerLatch;
+
+    // add time to shift out MSBs
+    for(int i=transitionBit + 1; i<COLOR_DEPTH_BITS; i++)
+        nsPerRow += (1<<(i - transitionBit - 1)) * (COLOR_DEPTH_BITS - i) * nsPerLatch;
+
+    int nsPerFrame = nsPerRow * MATRIX_SCAN_MOD;
+    return 1000000000UL/(nsPerFrame);
 }
 
+// FNV-1a over the template parameters and the settings passed to begin()
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
+uint32_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshConfigHash(uint32_t dmaRamToKeepFreeBytes, size_t calcBufferBytes) {
+    const uint32_t values[] = { refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags, minRefreshRate, dmaRamToKeepFreeBytes,
+        (uint32_t)calcBufferBytes, ESP32_I2S_CLOCK_SPEED, (uint32_t)sizeof(frameStruct) };
+
+    uint32_t hash = 2166136261UL;
+    for(unsigned int i=0; i<sizeof(values)/sizeof(values[0]); i++) {
+        for(int b=0; b<4; b++)
+            hash = (hash ^ ((values[i] >> (b * 8)) & 0xFF)) * 16777619UL;
+    }
+    return hash;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadCachedTransitionBit(uint32_t configHash) {
+#if (SM_ESP32_CACHE_REFRESH_CONFIG == 1)
+    nvs_handle handle;
+    if(nvs_open("smartmatrix", NVS_READONLY, &handle) != ESP_OK)
+        return -1;
+
+    char key[16];
+    snprintf(key, sizeof(key), "tb%08x", configHash);
+    uint8_t transitionBit;
+    esp_err_t result = nvs_get_u8(handle, key, &transitionBit);
+    nvs_close(handle);
+
+    if(result != ESP_OK || transitionBit >= COLOR_DEPTH_BITS)
+        return -1;
+    return transitionBit;
+#else
+    return -1;
+#endif
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::storeCachedTransitionBit(uint32_t configHash, int transitionBit) {
+#if (SM_ESP32_CACHE_REFRESH_CONFIG == 1)
+    nvs_handle handle;
+    if(nvs_open("smartmatrix", NVS_READWRITE, &handle) != ESP_OK)
+        return;
+
+    char key[16];
+    snprintf(key, sizeof(key), "tb%08x", configHash);
+    if(nvs_set_u8(handle, key, transitionBit) == ESP_OK)
+        nvs_commit(handle);
+    nvs_close(handle);
+#endif
+}
+
+// links the descriptors for one row starting at dmadesc, returns the last descriptor used (numDescriptorsPerRow in total)
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+lldesc_t * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::linkRowDescriptors(lldesc_t * dmadesc, lldesc_t * prevdmadesc, frameStruct * frame, int row) {
+    // first set of data is LSB through MSB, single pass - all color bits are displayed once, which takes care of everything below and inlcluding LSBMSB_TRANSITION_BIT
+    // TODO: size must be less than DMA_MAX - worst case for SmartMatrix Library: 16-bpp with 256 pixels per row would exceed this, need to break into two
+    link_dma_desc(dmadesc, prevdmadesc, frame->rowdata[row].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
+    prevdmadesc = dmadesc++;
+
+    for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++) {
+        // binary time division setup: we need 2 of bit (LSBMSB_TRANSITION_BIT + 1) four of (LSBMSB_TRANSITION_BIT + 2), etc
+        // because we sweep through to MSB each time, it divides the number of times we have to sweep in half (saving linked list RAM)
+        // we need 2^(i - LSBMSB_TRANSITION_BIT - 1) == 1 << (i - LSBMSB_TRANSITION_BIT - 1) passes from i to MSB
+        for(int k=0; k < 1<<(i - lsbMsbTransitionBit - 1); k++) {
+            link_dma_desc(dmadesc, prevdmadesc, frame->rowdata[row].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
+            prevdmadesc = dmadesc++;
+        }
+    }
+
+    return prevdmadesc;
+}
+
+// relinks one frame's descriptors (linked in row order by linkRowDescriptors()) as ESP32_BCM_SUBFRAMES passes over all rows, each pass
+// showing the next run of every row's descriptors, split so each run takes about the same number of latches
+// rows keep their descriptors and data, only the order changes, so this needs the row address latched with each bitplane (CLKS_DURING_LATCH > 0)
+// the chain still starts with row 0's first descriptor and ends with the last row's last descriptor, the first and last in memory
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::scrambleFrameDescriptors(lldesc_t * dmadesc, int numDescriptorsPerRow) {
+    const int numSubframes = (ESP32_BCM_SUBFRAMES < numDescriptorsPerRow) ? ESP32_BCM_SUBFRAMES : numDescriptorsPerRow;
+
+    // latches shown by each descriptor: the first sweeps all bits, the passes for bit i sweep bits i through MSB
+    int descriptorLatches[numDescriptorsPerRow];
+    int totalLatches = 0;
+    int d = 0;
+    descriptorLatches[d++] = COLOR_DEPTH_BITS;
+    for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++) {
+        for(int k=0; k < 1<<(i - lsbMsbTransitionBit - 1); k++)
+            descriptorLatches[d++] = COLOR_DEPTH_BITS - i;
+    }
+    for(int i=0; i<numDescriptorsPerRow; i++)
+        totalLatches += descriptorLatches[i];
+
+    // firstDescriptor[s] is the first descriptor of each row shown in subframe s, every subframe gets at least one
+    int firstDescriptor[ESP32_BCM_SUBFRAMES + 1];
+    int latches = 0;
+    d = 0;
+    for(int s=0; s<numSubframes; s++) {
+        firstDescriptor[s] = d;
+        do {
+            latches += descriptorLatches[d++];
+        } while(d < numDescriptorsPerRow - (numSubframes - 1 - s) && latches * numSubframes < totalLatches * (s + 1));
+    }
+    firstDescriptor[numSubframes] = numDescriptorsPerRow;
+
+    lldesc_t * prevdmadesc = NULL;
+    for(int s=0; s<numSubframes; s++) {
+        for(int j=0; j<MATRIX_SCAN_MOD; j++) {
+            for(int k=firstDescriptor[s]; k<firstDescriptor[s + 1]; k++) {
+                lldesc_t * desc = &dmadesc[j * numDescriptorsPerRow + k];
+                if(prevdmadesc)
+                    prevdmadesc->qe.stqe_next = desc;
+                prevdmadesc = desc;
+            }
+        }
+    }
+}
+
+// called at the end of each frame, when DMA has just moved on to the head rows of the next frame: point the shared descriptors at the same frame
+// descriptors are patched in row order, staying ahead of DMA as long as the ISR starts before the head rows are finished
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void IRAM_ATTR SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::sharedDescriptorsFrameStartISR(void) {
+    // the head segment DMA is currently reading tells us which frame is being refreshed
+    uint32_t currentDescriptor = (uint32_t)i2s_parallel_get_current_descriptor(&I2S1);
+    uint8_t newFrame = sharedDescriptorsFrame;
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++) {
+        if(currentDescriptor >= (uint32_t)sharedHeadDescriptors[i] && currentDescriptor < (uint32_t)(sharedHeadDescriptors[i] + sharedHeadDescriptorsCount))
+            newFrame = i;
+    }
+
+    if(newFrame != sharedDescriptorsFrame) {
+        int32_t offset = (uint8_t *)matrixUpdateFrames[newFrame] - (uint8_t *)matrixUpdateFrames[sharedDescriptorsFrame];
+        for(int i=0; i<sharedDescriptorsCount; i++)
+            sharedDescriptors[i].buf += offset;
+        sharedDescriptorsFrame = newFrame;
+    }
+
+    if(matrixCalcCallback)
+        matrixCalcCallback();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -121,27 +380,48 @@ uint16_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelT
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(uint32_t dmaRamToKeepFreeBytes) {
-    cbInit(&dmaBuffer, ESP32_NUM_FRAME_BUFFERS);
+size_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getDmaArenaBytes(int numDescriptors, size_t calcBufferBytes) {
+    const size_t alignMask = ESP32_DMA_ARENA_ALIGNMENT - 1;
+    const size_t frameBytes = ESP32_FRAMES_IN_PSRAM ? 0 : ((sizeof(frameStruct) + alignMask) & ~alignMask);
+    return ESP32_NUM_FRAME_BUFFERS * frameBytes +
+        ((numDescriptors * sizeof(lldesc_t) + alignMask) & ~alignMask) +
+        ((calcBufferBytes + alignMask) & ~alignMask);
+}
 
-    printf("Starting SmartMatrix DMA Mallocs\r\n");
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::allocateFromDmaArena(size_t bytes) {
+    const size_t alignMask = ESP32_DMA_ARENA_ALIGNMENT - 1;
+    bytes = (bytes + alignMask) & ~alignMask;
+    if(!dmaArena || dmaArenaUsed + bytes > dmaArenaSize)
+        return NULL;
+
+    void * ptr = dmaArena + dmaArenaUsed;
+    dmaArenaUsed += bytes;
+    return ptr;
+}
 
-    // TODO: malloc this buffer before other smaller buffers as this is (by far) the largest buffer to allocate?
-    matrixUpdateFrames[0] = (frameStruct *)heap_caps_malloc(sizeof(frameStruct), MALLOC_CAP_DMA);
-    assert(matrixUpdateFrames[0] != NULL);
-    matrixUpdateFrames[1] = (frameStruct *)heap_caps_malloc(sizeof(frameStruct), MALLOC_CAP_DMA);
-    assert(matrixUpdateFrames[1] != NULL);
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getCalcBuffer(void) {
+    return calcBuffer;
+}
 
-    printf("sizeof framestruct: %08X\r\n", (uint32_t)sizeof(frameStruct));
-    show_esp32_dma_mem("DMA Memory Available before ptr1 alloc");
-    printf("matrixUpdateFrames[0] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[0]);
-    show_esp32_dma_mem("DMA Memory Available before ptr2 alloc");
-    printf("matrixUpdateFrames[1] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[1]);
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stop(void) {
+    i2s_parallel_stop(&I2S1);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(uint32_t dmaRamToKeepFreeBytes, size_t calcBufferBytes) {
+    // begin() again: DMA is still reading the frames and descriptors of the previous begin(), which are reused or freed below
+    if(dmaArena)
+        stop();
+
+    cbInit(&dmaBuffer, ESP32_NUM_FRAME_BUFFERS);
 
-    printf("Frame Structs Allocated from Heap:\r\n");
-    show_esp32_all_mem();
+    SM_BEGIN_PRINTF("Starting SmartMatrix DMA Mallocs\r\n");
 
-    printf("Allocating refresh buffer:\r\n");
+    SM_BEGIN_PRINTF("sizeof framestruct: %08X\r\n", (uint32_t)sizeof(frameStruct));
+    SM_BEGIN_SHOW_MEM();
 
     // setup debug output
 #ifdef DEBUG_PINS_ENABLED
@@ -158,135 +438,227 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
 #endif
 #endif
 
-    // calculate the lowest LSBMSB_TRANSITION_BIT value that will fit in memory
-    int numDescriptorsPerRow;
-    lsbMsbTransitionBit = 0;
-    while(1) {
-        numDescriptorsPerRow = 1;
-        for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++) {
-            numDescriptorsPerRow += 1<<(i - lsbMsbTransitionBit - 1);
-        }
-
-        int ramrequired = numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NUM_FRAME_BUFFERS * sizeof(lldesc_t);
-        int largestblockfree = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+    // rows that need a set of descriptors: every row of every frame, or with shared descriptors the head rows of each frame plus one set for the rest
+    const int numHeadRows = (ESP32_SHARED_DESCRIPTORS_HEAD_ROWS < MATRIX_SCAN_MOD) ? ESP32_SHARED_DESCRIPTORS_HEAD_ROWS : MATRIX_SCAN_MOD - 1;
+    const bool sharedDescriptorChain = (optionFlags & SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS) && numHeadRows > 0;
+    const int numDescriptorRows = sharedDescriptorChain ? (ESP32_NUM_FRAME_BUFFERS * numHeadRows + (MATRIX_SCAN_MOD - numHeadRows)) : (ESP32_NUM_FRAME_BUFFERS * MATRIX_SCAN_MOD);
 
-        printf("lsbMsbTransitionBit of %d requires %d RAM, %d available, leaving %d free: \r\n", lsbMsbTransitionBit, ramrequired, largestblockfree, largestblockfree - ramrequired);
+    int numDescriptorsPerRow;
 
-        if(largestblockfree > dmaRamToKeepFreeBytes && ramrequired < (largestblockfree - dmaRamToKeepFreeBytes))
-            break;
+    // a transition bit stored by a previous boot with the same configuration is used if it still fits
+    const uint32_t configHash = getRefreshConfigHash(dmaRamToKeepFreeBytes, calcBufferBytes);
+    const int cachedTransitionBit = loadCachedTransitionBit(configHash);
+    bool useCachedTransitionBit = false;
 
-        if(lsbMsbTransitionBit < COLOR_DEPTH_BITS - 1)
-            lsbMsbTransitionBit++;
-        else
-            break;
-    }
+    if(cachedTransitionBit >= 0) {
+        int ramrequired = getDmaArenaBytes(getNumDescriptorsPerRow(cachedTransitionBit) * numDescriptorRows, calcBufferBytes);
+        int largestblockfree = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+        if(dmaArena && dmaArenaSize > largestblockfree)
+            largestblockfree = dmaArenaSize;
 
-    if(numDescriptorsPerRow * MATRIX_SCAN_MOD * ESP32_NUM_FRAME_BUFFERS * sizeof(lldesc_t) > heap_caps_get_largest_free_block(MALLOC_CAP_DMA)){
-        printf("not enough RAM for SmartMatrix descriptors\r\n");
-        return;
+        useCachedTransitionBit = (largestblockfree > dmaRamToKeepFreeBytes && ramrequired < (largestblockfree - dmaRamToKeepFreeBytes));
     }
 
-    printf("Raised lsbMsbTransitionBit to %d/%d to fit in RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1);
+    if(useCachedTransitionBit) {
+        lsbMsbTransitionBit = cachedTransitionBit;
+        refreshRate = getRefreshRateForTransitionBit(lsbMsbTransitionBit);
+        SM_BEGIN_PRINTF("Using stored lsbMsbTransitionBit %d/%d, %d Hz refresh\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, refreshRate);
+    } else {
+        // calculate the lowest LSBMSB_TRANSITION_BIT value that will fit in memory
+        lsbMsbTransitionBit = 0;
+        while(1) {
+            numDescriptorsPerRow = getNumDescriptorsPerRow(lsbMsbTransitionBit);
+
+            // the arena from a previous begin() will be handed back if the new one doesn't fit in it, so it counts as free
+            int ramrequired = getDmaArenaBytes(numDescriptorsPerRow * numDescriptorRows, calcBufferBytes);
+            int largestblockfree = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+            if(dmaArena && dmaArenaSize > largestblockfree)
+                largestblockfree = dmaArenaSize;
+
+            SM_BEGIN_PRINTF("lsbMsbTransitionBit of %d requires %d RAM, %d available, leaving %d free: \r\n", lsbMsbTransitionBit, ramrequired, largestblockfree, largestblockfree - ramrequired);
+
+            if(largestblockfree > dmaRamToKeepFreeBytes && ramrequired < (largestblockfree - dmaRamToKeepFreeBytes))
+                break;
+
+            if(lsbMsbTransitionBit < COLOR_DEPTH_BITS - 1)
+                lsbMsbTransitionBit++;
+            else
+                break;
+        }
 
-    // calculate the lowest LSBMSB_TRANSITION_BIT value that will fit in memory that will meet or exceed the configured refresh rate
-    while(1) {
-        int psPerClock = 1000000000000UL/ESP32_I2S_CLOCK_SPEED;
-        int nsPerLatch = ((PIXELS_PER_LATCH + CLKS_DURING_LATCH) * psPerClock) / 1000;
-        //printf("ns per latch: %d: \r\n", nsPerLatch);        
+        size_t largestArenaAvailable = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+        if(dmaArena && dmaArenaSize > largestArenaAvailable)
+            largestArenaAvailable = dmaArenaSize;
 
-        // add time to shift out LSBs + LSB-MSB transition bit - this ignores fractions...
-        int nsPerRow = COLOR_DEPTH_BITS * nsPerLatch;
+        if(getDmaArenaBytes(numDescriptorsPerRow * numDescriptorRows, calcBufferBytes) > largestArenaAvailable){
+            printf("not enough RAM for SmartMatrix descriptors\r\n");
+            return;
+        }
 
-        // add time to shift out MSBs
-        for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++)
-            nsPerRow += (1<<(i - lsbMsbTransitionBit - 1)) * (COLOR_DEPTH_BITS - i) * nsPerLatch;
+        SM_BEGIN_PRINTF("Raised lsbMsbTransitionBit to %d/%d to fit in RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1);
 
-        //printf("nsPerRow: %d: \r\n", nsPerRow);        
+        // calculate the lowest LSBMSB_TRANSITION_BIT value that will fit in memory that will meet or exceed the configured refresh rate
+        while(1) {
+            int actualRefreshRate = getRefreshRateForTransitionBit(lsbMsbTransitionBit);
 
-        int nsPerFrame = nsPerRow * MATRIX_SCAN_MOD;
-        //printf("nsPerFrame: %d: \r\n", nsPerFrame);        
+            refreshRate = actualRefreshRate;
 
-        int actualRefreshRate = 1000000000UL/(nsPerFrame);
+            SM_BEGIN_PRINTF("lsbMsbTransitionBit of %d gives %d Hz refresh, %d requested: \r\n", lsbMsbTransitionBit, actualRefreshRate, minRefreshRate);        
 
-        refreshRate = actualRefreshRate;
+            if(actualRefreshRate >= minRefreshRate)
+                break;
 
-        printf("lsbMsbTransitionBit of %d gives %d Hz refresh, %d requested: \r\n", lsbMsbTransitionBit, actualRefreshRate, minRefreshRate);        
+            if(lsbMsbTransitionBit < COLOR_DEPTH_BITS - 1)
+                lsbMsbTransitionBit++;
+            else
+                break;
+        }
 
-        if(actualRefreshRate >= minRefreshRate)
-            break;
+        SM_BEGIN_PRINTF("Raised lsbMsbTransitionBit to %d/%d to meet minimum refresh rate\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1);
 
-        if(lsbMsbTransitionBit < COLOR_DEPTH_BITS - 1)
-            lsbMsbTransitionBit++;
-        else
-            break;
+        if(lsbMsbTransitionBit != cachedTransitionBit)
+            storeCachedTransitionBit(configHash, lsbMsbTransitionBit);
     }
 
-    printf("Raised lsbMsbTransitionBit to %d/%d to meet minimum refresh rate\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1);
-
     // TODO: completely fill buffer with data before enabling DMA - can't do this now, lsbMsbTransition bit isn't set in the calc class - also this call will probably have no effect as matrixCalcDivider will skip the first call
     //matrixCalcCallback();
 
     // lsbMsbTransition Bit is now finalized - redo descriptor count in case it changed to hit min refresh rate
-    numDescriptorsPerRow = 1;
-    for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++) {
-        numDescriptorsPerRow += 1<<(i - lsbMsbTransitionBit - 1);
-    }
+    numDescriptorsPerRow = getNumDescriptorsPerRow(lsbMsbTransitionBit);
 
-    printf("Descriptors for lsbMsbTransitionBit %d/%d with %d rows require %d bytes of DMA RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, MATRIX_SCAN_MOD, 2 * numDescriptorsPerRow * MATRIX_SCAN_MOD * sizeof(lldesc_t));
+    SM_BEGIN_PRINTF("Descriptors for lsbMsbTransitionBit %d/%d with %d rows require %d bytes of DMA RAM\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, MATRIX_SCAN_MOD, numDescriptorsPerRow * numDescriptorRows * sizeof(lldesc_t));
 
-    // malloc the DMA linked list descriptors that i2s_parallel will need
-    int desccount = numDescriptorsPerRow * MATRIX_SCAN_MOD;
-    lldesc_t * dmadesc_a = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    if(!dmadesc_a) {
-        printf("can't malloc dmadesc_a");
-        return;
+    // reserve one block for everything, keeping the arena from a previous begin() if the new layout fits inside it
+    size_t arenaBytes = getDmaArenaBytes(numDescriptorsPerRow * numDescriptorRows, calcBufferBytes);
+    if(dmaArena && dmaArenaSize < arenaBytes) {
+        heap_caps_free(dmaArena);
+        dmaArena = NULL;
     }
-    lldesc_t * dmadesc_b = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    if(!dmadesc_b) {
-        printf("can't malloc dmadesc_b");
-        return;
+    if(!dmaArena) {
+        dmaArena = (uint8_t *)heap_caps_malloc(arenaBytes, MALLOC_CAP_DMA);
+        if(!dmaArena) {
+            printf("can't malloc SmartMatrix DMA arena");
+            return;
+        }
+        dmaArenaSize = arenaBytes;
+#if !ESP32_FRAMES_IN_PSRAM
+        smRecordAllocation(smMemoryFrames, dmaArena, ESP32_NUM_FRAME_BUFFERS * sizeof(frameStruct));
+#endif
+        smRecordAllocation(smMemoryDescriptors, dmaArena, numDescriptorsPerRow * numDescriptorRows * sizeof(lldesc_t));
+        smRecordAllocation(smMemoryTempRows, dmaArena, calcBufferBytes);
     }
+    dmaArenaUsed = 0;
+
+    SM_BEGIN_PRINTF("SmartMatrix DMA arena: %d bytes at %08X\r\n", dmaArenaSize, (uint32_t)dmaArena);
+
+    // largest buffers first, everything in the arena is sized above so none of these can fail
+#if ESP32_FRAMES_IN_PSRAM
+    // PSRAM frames are kept from a previous begin(), only the arena is resized
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++) {
+        if(matrixUpdateFrames[i])
+            continue;
+        size_t frameBytes = (sizeof(frameStruct) + ESP32_PSRAM_DMA_ALIGNMENT - 1) & ~(ESP32_PSRAM_DMA_ALIGNMENT - 1);
+        matrixUpdateFrames[i] = (frameStruct *)heap_caps_aligned_alloc(ESP32_PSRAM_DMA_ALIGNMENT, frameBytes, MALLOC_CAP_SPIRAM);
+        if(!matrixUpdateFrames[i]) {
+            printf("can't malloc SmartMatrix frames in PSRAM");
+            return;
+        }
+        smRecordAllocation(smMemoryFrames, matrixUpdateFrames[i], frameBytes);
+    }
+#else
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++)
+        matrixUpdateFrames[i] = (frameStruct *)allocateFromDmaArena(sizeof(frameStruct));
+#endif
 
-    printf("SmartMatrix Mallocs Complete\r\n");
-    show_esp32_all_mem();
+    // DMA starts before the calc has packed a frame, so the frames are filled with OE inactive (inverted for HUB12), keeping the panels dark
+    // until the first frame is ready instead of showing whatever the heap held
+    const MATRIX_DATA_STORAGE_TYPE blankWord = (optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) ? 0 : BIT_OE;
+    for(int i=0; i<ESP32_NUM_FRAME_BUFFERS; i++) {
+        MATRIX_DATA_STORAGE_TYPE * data = (MATRIX_DATA_STORAGE_TYPE *)matrixUpdateFrames[i];
+        for(unsigned int j=0; j<sizeof(frameStruct) / sizeof(MATRIX_DATA_STORAGE_TYPE); j++)
+            data[j] = blankWord;
+#if ESP32_FRAMES_IN_PSRAM
+        Cache_WriteBack_Addr((uint32_t)matrixUpdateFrames[i], sizeof(frameStruct));
+#endif
+    }
 
-    lldesc_t *prevdmadesca = 0;
-    lldesc_t *prevdmadescb = 0;
-    int currentDescOffset = 0;
+    // the DMA linked list descriptors that i2s_parallel will need
+    int desccount_a, desccount_b;
+    lldesc_t * dmadesc_a;
+    lldesc_t * dmadesc_b;
+
+    if(sharedDescriptorChain) {
+        // one block: head rows of frame 0, head rows of frame 1, then the shared rows.  Both chains end with the same (shared) last descriptor,
+        // so i2s_parallel_flip_to_buffer() still switches frames by pointing the last descriptor at one of the heads
+        int headcount = numDescriptorsPerRow * numHeadRows;
+        int totalcount = ESP32_NUM_FRAME_BUFFERS * headcount + numDescriptorsPerRow * (MATRIX_SCAN_MOD - numHeadRows);
+        dmadesc_a = (lldesc_t *)allocateFromDmaArena(totalcount * sizeof(lldesc_t));
+        dmadesc_b = dmadesc_a + headcount;
+        desccount_a = totalcount;
+        desccount_b = totalcount - headcount;
+
+        sharedHeadDescriptors[0] = dmadesc_a;
+        sharedHeadDescriptors[1] = dmadesc_b;
+        sharedHeadDescriptorsCount = headcount;
+        sharedDescriptors = dmadesc_a + ESP32_NUM_FRAME_BUFFERS * headcount;
+        sharedDescriptorsCount = totalcount - ESP32_NUM_FRAME_BUFFERS * headcount;
+        sharedDescriptorsFrame = 0;
+        activeDescriptors = NULL;
+    } else {
+        int desccount = numDescriptorsPerRow * MATRIX_SCAN_MOD;
+        dmadesc_a = (lldesc_t *)allocateFromDmaArena(ESP32_NUM_FRAME_BUFFERS * desccount * sizeof(lldesc_t));
+        dmadesc_b = dmadesc_a + desccount;
+        desccount_a = desccount;
+        desccount_b = desccount;
+
+        arenaDescriptors = dmadesc_a;
+        arenaDescriptorsCapacity = ESP32_NUM_FRAME_BUFFERS * desccount;
+        activeDescriptors = dmadesc_a;
+        descriptorSwapPending = false;
+    }
 
-    // fill DMA linked lists for both frames
-    for(int j=0; j<MATRIX_SCAN_MOD; j++) {
-        // first set of data is LSB through MSB, single pass - all color bits are displayed once, which takes care of everything below and inlcluding LSBMSB_TRANSITION_BIT
-        // TODO: size must be less than DMA_MAX - worst case for SmartMatrix Library: 16-bpp with 256 pixels per row would exceed this, need to break into two
-        link_dma_desc(&dmadesc_a[currentDescOffset], prevdmadesca, matrixUpdateFrames[0]->rowdata[j].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
-        prevdmadesca = &dmadesc_a[currentDescOffset];
-        link_dma_desc(&dmadesc_b[currentDescOffset], prevdmadescb, matrixUpdateFrames[1]->rowdata[j].rowbits[0].data, sizeof(rowBitStruct) * COLOR_DEPTH_BITS);
-        prevdmadescb = &dmadesc_b[currentDescOffset];
-        currentDescOffset++;
-        //printf("row %d: \r\n", j);
-
-        for(int i=lsbMsbTransitionBit + 1; i<COLOR_DEPTH_BITS; i++) {
-            // binary time division setup: we need 2 of bit (LSBMSB_TRANSITION_BIT + 1) four of (LSBMSB_TRANSITION_BIT + 2), etc
-            // because we sweep through to MSB each time, it divides the number of times we have to sweep in half (saving linked list RAM)
-            // we need 2^(i - LSBMSB_TRANSITION_BIT - 1) == 1 << (i - LSBMSB_TRANSITION_BIT - 1) passes from i to MSB
-            //printf("buffer %d: repeat %d times, size: %d, from %d - %d\r\n", nextBufdescIndex, 1<<(i - LSBMSB_TRANSITION_BIT - 1), (COLOR_DEPTH_BITS - i), i, COLOR_DEPTH_BITS-1);
-            for(int k=0; k < 1<<(i - lsbMsbTransitionBit - 1); k++) {
-                link_dma_desc(&dmadesc_a[currentDescOffset], prevdmadesca, matrixUpdateFrames[0]->rowdata[j].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
-                prevdmadesca = &dmadesc_a[currentDescOffset];
-                link_dma_desc(&dmadesc_b[currentDescOffset], prevdmadescb, matrixUpdateFrames[1]->rowdata[j].rowbits[i].data, sizeof(rowBitStruct) * (COLOR_DEPTH_BITS - i));
-                prevdmadescb = &dmadesc_b[currentDescOffset];
-
-                currentDescOffset++;
-                //printf("i %d, j %d, k %d\r\n", i, j, k);
-            }
+    calcBuffer = calcBufferBytes ? allocateFromDmaArena(calcBufferBytes) : NULL;
+
+    SM_BEGIN_PRINTF("SmartMatrix Mallocs Complete\r\n");
+    SM_BEGIN_SHOW_MEM();
+
+    if(sharedDescriptorChain) {
+        // head rows for each frame, the last head descriptor of each frame continues into the shared rows
+        lldesc_t *lastHeadDesc[ESP32_NUM_FRAME_BUFFERS];
+        for(int f=0; f<ESP32_NUM_FRAME_BUFFERS; f++) {
+            lldesc_t *prevdmadesc = 0;
+            for(int j=0; j<numHeadRows; j++)
+                prevdmadesc = linkRowDescriptors(&sharedHeadDescriptors[f][j * numDescriptorsPerRow], prevdmadesc, matrixUpdateFrames[f], j);
+            lastHeadDesc[f] = prevdmadesc;
+        }
+
+        // shared rows start out pointing at frame 0, which is where DMA starts
+        lldesc_t *prevdmadesc = lastHeadDesc[0];
+        for(int j=numHeadRows; j<MATRIX_SCAN_MOD; j++)
+            prevdmadesc = linkRowDescriptors(&sharedDescriptors[(j - numHeadRows) * numDescriptorsPerRow], prevdmadesc, matrixUpdateFrames[0], j);
+        for(int f=1; f<ESP32_NUM_FRAME_BUFFERS; f++)
+            lastHeadDesc[f]->qe.stqe_next = &sharedDescriptors[0];
+    } else {
+        // fill DMA linked lists for both frames
+        lldesc_t *prevdmadesca = 0;
+        lldesc_t *prevdmadescb = 0;
+        for(int j=0; j<MATRIX_SCAN_MOD; j++) {
+            prevdmadesca = linkRowDescriptors(&dmadesc_a[j * numDescriptorsPerRow], prevdmadesca, matrixUpdateFrames[0], j);
+            prevdmadescb = linkRowDescriptors(&dmadesc_b[j * numDescriptorsPerRow], prevdmadescb, matrixUpdateFrames[1], j);
+        }
+
+        // the shared chain depends on rows being in order (head rows first), so scrambling is only done with a chain per frame
+        if((optionFlags & SMARTMATRIX_OPTIONS_SCRAMBLED_BCM) && CLKS_DURING_LATCH > 0) {
+            scrambleFrameDescriptors(dmadesc_a, numDescriptorsPerRow);
+            scrambleFrameDescriptors(dmadesc_b, numDescriptorsPerRow);
         }
     }
 
-    //End markers
-    dmadesc_a[desccount-1].eof = 1;
-    dmadesc_b[desccount-1].eof = 1;
-    dmadesc_a[desccount-1].qe.stqe_next=(lldesc_t*)&dmadesc_a[0];
-    dmadesc_b[desccount-1].qe.stqe_next=(lldesc_t*)&dmadesc_b[0];
+    //End markers (with shared descriptors both are the same descriptor, and it's left pointing at frame 0 where DMA starts)
+    dmadesc_b[desccount_b-1].eof = 1;
+    dmadesc_b[desccount_b-1].qe.stqe_next=(lldesc_t*)&dmadesc_b[0];
+    dmadesc_a[desccount_a-1].eof = 1;
+    dmadesc_a[desccount_a-1].qe.stqe_next=(lldesc_t*)&dmadesc_a[0];
 
     //printf("\n");
 
@@ -454,8 +826,8 @@ void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType,
         .bits=MATRIX_I2S_MODE,
         .bufa=0,
         .bufb=0,
-        .desccount_a=desccount,
-        .desccount_b=desccount,
+        .desccount_a=desccount_a,
+        .desccount_b=desccount_b,
         .lldesc_a=dmadesc_a,
         .lldesc_b=dmadesc_b
     };
@@ -476,3 +848,73 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getLsbMsbTransitionBit(void) {
     return lsbMsbTransitionBit;
 }
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::reconfigure(uint16_t newMinRefreshRate, int8_t newLsbMsbTransitionBit) {
+    // the shared chain is spliced between frames by the frame start ISR, and isn't rebuilt here
+    if(!activeDescriptors || descriptorSwapPending)
+        return false;
+
+    int transitionBit = 0;
+    if(newLsbMsbTransitionBit >= 0) {
+        transitionBit = (newLsbMsbTransitionBit < COLOR_DEPTH_BITS - 1) ? newLsbMsbTransitionBit : COLOR_DEPTH_BITS - 1;
+    } else {
+        while(transitionBit < COLOR_DEPTH_BITS - 1 && getRefreshRateForTransitionBit(transitionBit) < newMinRefreshRate)
+            transitionBit++;
+    }
+
+    const int numDescriptorsPerRow = getNumDescriptorsPerRow(transitionBit);
+    const int desccount = numDescriptorsPerRow * MATRIX_SCAN_MOD;
+
+    // the block that isn't active is free: DMA left it when the frame buffer became free after the last swap
+    lldesc_t * dmadesc_a;
+    if(activeDescriptors == heapDescriptors) {
+        if(arenaDescriptorsCapacity < ESP32_NUM_FRAME_BUFFERS * desccount) {
+            printf("not enough RAM in the SmartMatrix DMA arena for lsbMsbTransitionBit %d\r\n", transitionBit);
+            return false;
+        }
+        dmadesc_a = arenaDescriptors;
+    } else {
+        // allocated once, for lsbMsbTransitionBit 0 (the most descriptors), so later reconfigures never free and malloc again from the calc task
+        if(!heapDescriptors) {
+            const int worstCaseDescriptors = ESP32_NUM_FRAME_BUFFERS * getNumDescriptorsPerRow(0) * MATRIX_SCAN_MOD;
+            heapDescriptors = (lldesc_t *)heap_caps_malloc(worstCaseDescriptors * sizeof(lldesc_t), MALLOC_CAP_DMA);
+            if(!heapDescriptors) {
+                printf("can't malloc %d bytes for the spare SmartMatrix descriptors\r\n", (int)(worstCaseDescriptors * sizeof(lldesc_t)));
+                return false;
+            }
+            heapDescriptorsCapacity = worstCaseDescriptors;
+            smRecordAllocation(smMemoryDescriptors, heapDescriptors, heapDescriptorsCapacity * sizeof(lldesc_t));
+        }
+        dmadesc_a = heapDescriptors;
+    }
+    lldesc_t * dmadesc_b = dmadesc_a + desccount;
+
+    // linkRowDescriptors() and the calc read the new value from here on, the chains currently refreshing are already linked
+    lsbMsbTransitionBit = transitionBit;
+    minRefreshRate = newMinRefreshRate;
+    refreshRate = getRefreshRateForTransitionBit(transitionBit);
+
+    lldesc_t *prevdmadesca = 0;
+    lldesc_t *prevdmadescb = 0;
+    for(int j=0; j<MATRIX_SCAN_MOD; j++) {
+        prevdmadesca = linkRowDescriptors(&dmadesc_a[j * numDescriptorsPerRow], prevdmadesca, matrixUpdateFrames[0], j);
+        prevdmadescb = linkRowDescriptors(&dmadesc_b[j * numDescriptorsPerRow], prevdmadescb, matrixUpdateFrames[1], j);
+    }
+
+    if((optionFlags & SMARTMATRIX_OPTIONS_SCRAMBLED_BCM) && CLKS_DURING_LATCH > 0) {
+        scrambleFrameDescriptors(dmadesc_a, numDescriptorsPerRow);
+        scrambleFrameDescriptors(dmadesc_b, numDescriptorsPerRow);
+    }
+
+    // the last descriptors are pointed at the active chain by i2s_parallel_replace_descriptors()
+    dmadesc_a[desccount-1].eof = 1;
+    dmadesc_b[desccount-1].eof = 1;
+
+    pendingDescriptors = dmadesc_a;
+    pendingDescriptorsCount = desccount;
+    descriptorSwapPending = true;
+
+    SM_BEGIN_PRINTF("SmartMatrix reconfigured: lsbMsbTransitionBit %d/%d gives %d Hz refresh\r\n", lsbMsbTransitionBit, COLOR_DEPTH_BITS - 1, refreshRate);
+    return true;
+}
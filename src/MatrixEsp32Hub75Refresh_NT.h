@@ -48,11 +48,16 @@ public:
             refreshRate = 120;
             minRefreshRate = 120;
             lsbMsbTransitionBit = 0;
+            matrixUpdateFrames[0] = matrixUpdateFrames[1] = NULL;
+            dmadesc_a = dmadesc_b = NULL;
         };
     void begin(uint32_t dmaRamToKeepFreeBytes = 0);
+    // stops DMA and the shift complete interrupt, begin() calls this itself before reusing or freeing the buffers of a previous begin()
+    void stop(void);
 
     // refresh API
     MATRIX_DATA_STORAGE_TYPE * getNextFrameBufferPtr(void);
+    MATRIX_DATA_STORAGE_TYPE * getPreviousFrameBufferPtr(void);
     void writeFrameBuffer(uint8_t currentFrame);
     void recoverFromDmaUnderrun(void);
     bool isFrameBufferFree(void);
@@ -68,6 +73,8 @@ private:
     uint16_t minRefreshRate;
     uint8_t lsbMsbTransitionBit;
     MATRIX_DATA_STORAGE_TYPE * matrixUpdateFrames[ESP32_NUM_FRAME_BUFFERS];
+    lldesc_t * dmadesc_a;
+    lldesc_t * dmadesc_b;
 
     matrix_calc_callback matrixCalcCallback;
 
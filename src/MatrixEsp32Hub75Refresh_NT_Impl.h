@@ -50,7 +50,7 @@ template <int dummyvar>
 void frameShiftCompleteISR(void);    
 
 template <int dummyvar>
-bool SmartMatrixHub75Refresh_NT<dummyvar>::isFrameBufferFree(void) {
+bool SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh_NT<dummyvar>::isFrameBufferFree(void) {
     if(cbIsFull(&dmaBuffer))
         return false;
     else
@@ -58,12 +58,18 @@ bool SmartMatrixHub75Refresh_NT<dummyvar>::isFrameBufferFree(void) {
 }
 
 template <int dummyvar>
-MATRIX_DATA_STORAGE_TYPE * SmartMatrixHub75Refresh_NT<dummyvar>::getNextFrameBufferPtr(void) {
+MATRIX_DATA_STORAGE_TYPE * SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh_NT<dummyvar>::getNextFrameBufferPtr(void) {
     return matrixUpdateFrames[cbGetNextWrite(&dmaBuffer)];
 }
 
+// returns the frame most recently written with writeFrameBuffer()
 template <int dummyvar>
-void SmartMatrixHub75Refresh_NT<dummyvar>::writeFrameBuffer(uint8_t currentFrame) {
+MATRIX_DATA_STORAGE_TYPE * SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh_NT<dummyvar>::getPreviousFrameBufferPtr(void) {
+    return matrixUpdateFrames[(cbGetNextWrite(&dmaBuffer) + ESP32_NUM_FRAME_BUFFERS - 1) % ESP32_NUM_FRAME_BUFFERS];
+}
+
+template <int dummyvar>
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh_NT<dummyvar>::writeFrameBuffer(uint8_t currentFrame) {
     //SmartMatrixHub75Refresh_NT<dummyvar>::frameStruct * currentFramePtr = SmartMatrixHub75Refresh_NT<dummyvar>::getNextFrameBufferPtr();
     i2s_parallel_flip_to_buffer(&I2S1, cbGetNextWrite(&dmaBuffer));
     cbWrite(&dmaBuffer);
@@ -82,7 +88,7 @@ void SmartMatrixHub75Refresh_NT<dummyvar>::setMatrixCalculationsCallback(matrix_
 
 template <int dummyvar>
 
-void SmartMatrixHub75Refresh_NT<dummyvar>::setBrightness(uint8_t newBrightness) {
+void SM_FLASH_SAFE_IRAM SmartMatrixHub75Refresh_NT<dummyvar>::setBrightness(uint8_t newBrightness) {
 }
 
 template <int dummyvar>
@@ -98,8 +104,21 @@ uint16_t SmartMatrixHub75Refresh_NT<dummyvar>::getRefreshRate(void) {
     return refreshRate;
 }
 
+template <int dummyvar>
+void SmartMatrixHub75Refresh_NT<dummyvar>::stop(void) {
+    i2s_parallel_stop(&I2S1);
+}
+
 template <int dummyvar>
 void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes) {
+    // begin() again: stop DMA before the previous frames are reused and the previous descriptors are freed
+    if(matrixUpdateFrames[0]) {
+        stop();
+        heap_caps_free(dmadesc_a);
+        heap_caps_free(dmadesc_b);
+        dmadesc_a = dmadesc_b = NULL;
+    }
+
     cbInit(&dmaBuffer, ESP32_NUM_FRAME_BUFFERS);
 
     printf("Starting SmartMatrix DMA Mallocs\r\n");
@@ -108,13 +127,16 @@ void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
     show_esp32_dma_mem("DMA Memory Available before ptr1 alloc");
 
     // TODO: malloc this buffer before other smaller buffers as this is (by far) the largest buffer to allocate?
-    matrixUpdateFrames[0] = (MATRIX_DATA_STORAGE_TYPE *)heap_caps_malloc(SIZE_OF_FRAMESTRUCT, MALLOC_CAP_DMA);
+    // the frame size doesn't depend on anything begin() changes, frames from a previous begin() are kept
+    if(!matrixUpdateFrames[0])
+        matrixUpdateFrames[0] = (MATRIX_DATA_STORAGE_TYPE *)heap_caps_malloc(SIZE_OF_FRAMESTRUCT, MALLOC_CAP_DMA);
     assert(matrixUpdateFrames[0] != NULL);
 
     printf("matrixUpdateFrames[0] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[0]);
     show_esp32_dma_mem("DMA Memory Available before ptr2 alloc");
 
-    matrixUpdateFrames[1] = (MATRIX_DATA_STORAGE_TYPE *)heap_caps_malloc(SIZE_OF_FRAMESTRUCT, MALLOC_CAP_DMA);
+    if(!matrixUpdateFrames[1])
+        matrixUpdateFrames[1] = (MATRIX_DATA_STORAGE_TYPE *)heap_caps_malloc(SIZE_OF_FRAMESTRUCT, MALLOC_CAP_DMA);
     assert(matrixUpdateFrames[1] != NULL);
 
     printf("matrixUpdateFrames[1] pointer: %08X\r\n", (uint32_t)matrixUpdateFrames[1]);
@@ -216,12 +238,12 @@ void SmartMatrixHub75Refresh_NT<dummyvar>::begin(uint32_t dmaRamToKeepFreeBytes)
 
     // malloc the DMA linked list descriptors that i2s_parallel will need
     int desccount = numDescriptorsPerRow * MATRIX_SCAN_MOD;
-    lldesc_t * dmadesc_a = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
+    dmadesc_a = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
     if(!dmadesc_a) {
         printf("can't malloc dmadesc_a");
         return;
     }
-    lldesc_t * dmadesc_b = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
+    dmadesc_b = (lldesc_t *)heap_caps_malloc(desccount * sizeof(lldesc_t), MALLOC_CAP_DMA);
     if(!dmadesc_b) {
         printf("can't malloc dmadesc_b");
         return;
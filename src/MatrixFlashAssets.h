@@ -0,0 +1,203 @@
+/*
+ * SmartMatrix Library - Flash Asset Packs
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_FLASH_ASSETS_H_
+#define _MATRIX_FLASH_ASSETS_H_
+
+// Asset packs (made with extras/tools/smassets.py) hold bitmaps and animations in flash that's mapped into the address space, so
+// they're drawn with drawBitmap() and played with SMAnimationPlayer straight from flash, without reading them into RAM first.
+//   ESP32:     the pack is written to a data partition (see smassets.py), begin("assets") maps the partition with esp_partition_mmap()
+//   Teensy 4:  flash is executed in place (XIP) at 0x60000000, pass begin() a PROGMEM array made with smassets.py --header, or the
+//              address of a pack written to flash past the program
+// Mapped flash is read through the flash cache, slower than RAM for the first read of each cache line, but no copy is made.
+//
+// All values are little endian, offsets are from the start of the pack and 4-byte aligned:
+//   header: 'S' 'M' 'A' 'P' assetCount(16) reserved(16) then assetCount entries
+//   entry:  name(16, NUL padded) offset(32) size(32) type(8) format(8, smBitmapFormat) width(16) height(16) reserved(16)
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.
+
+#include "Layer_Background.h"
+#include "MatrixAnimation.h"
+
+#if defined(ESP32)
+#include "esp_partition.h"
+#endif
+
+#define SM_ASSET_PACK_HEADER_SIZE   8
+#define SM_ASSET_ENTRY_SIZE         32
+#define SM_ASSET_NAME_LENGTH        16
+
+typedef enum smAssetType {
+    SM_ASSET_BITMAP,        // width * height pixels in format, row-major
+    SM_ASSET_ANIMATION,     // a SmartMatrix animation file (.sma)
+    SM_ASSET_DATA,          // anything else
+} smAssetType;
+
+typedef struct smAsset {
+    const uint8_t * data;
+    uint32_t size;
+    smAssetType type;
+    smBitmapFormat format;
+    uint16_t width;
+    uint16_t height;
+} smAsset;
+
+class SMFlashAssets {
+    public:
+        // a pack already in the address space: a PROGMEM/const array, or flash mapped by the caller
+        bool begin(const uint8_t * pack, uint32_t size = 0) {
+            if(memcmp(pack, "SMAP", 4)) {
+                Serial.println("Error: not a SmartMatrix asset pack");
+                return false;
+            }
+            assetCount = pack[4] | (pack[5] << 8);
+            if(size && SM_ASSET_PACK_HEADER_SIZE + (uint32_t)assetCount * SM_ASSET_ENTRY_SIZE > size) {
+                Serial.println("Error: asset pack is truncated");
+                return false;
+            }
+            this->pack = pack;
+            this->size = size;
+            return true;
+        };
+
+#if defined(ESP32)
+        // maps a data partition (by label, from the partition table) holding a pack, the mapping lasts until end()
+        bool begin(const char * partitionLabel) {
+            const esp_partition_t * partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+            const void * mapped;
+
+            if(!partition) {
+                Serial.println("Error: asset partition not found");
+                return false;
+            }
+            if(esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &mapHandle) != ESP_OK) {
+                Serial.println("Error: can't map asset partition");
+                return false;
+            }
+            partitionMapped = true;
+            if(!begin((const uint8_t *)mapped, partition->size)) {
+                end();
+                return false;
+            }
+            return true;
+        };
+
+        void end(void) {
+            if(partitionMapped)
+                spi_flash_munmap(mapHandle);
+            partitionMapped = false;
+            pack = NULL;
+            assetCount = 0;
+        };
+#endif
+
+        uint16_t getAssetCount(void) const { return assetCount; };
+
+        // fills in asset and returns true if index is in the pack and its data lies inside the pack
+        bool getAsset(uint16_t index, smAsset &asset) const {
+            if(!pack || index >= assetCount)
+                return false;
+
+            const uint8_t * entry = pack + SM_ASSET_PACK_HEADER_SIZE + (uint32_t)index * SM_ASSET_ENTRY_SIZE;
+            uint32_t offset = read32(entry + SM_ASSET_NAME_LENGTH);
+            asset.size = read32(entry + SM_ASSET_NAME_LENGTH + 4);
+            if(size && ((uint64_t)offset + asset.size > size))
+                return false;
+
+            asset.data = pack + offset;
+            asset.type = (smAssetType)entry[SM_ASSET_NAME_LENGTH + 8];
+            asset.format = (smBitmapFormat)entry[SM_ASSET_NAME_LENGTH + 9];
+            asset.width = entry[SM_ASSET_NAME_LENGTH + 10] | (entry[SM_ASSET_NAME_LENGTH + 11] << 8);
+            asset.height = entry[SM_ASSET_NAME_LENGTH + 12] | (entry[SM_ASSET_NAME_LENGTH + 13] << 8);
+            return true;
+        };
+
+        const char * getAssetName(uint16_t index) const {
+            if(!pack || index >= assetCount)
+                return NULL;
+            return (const char *)(pack + SM_ASSET_PACK_HEADER_SIZE + (uint32_t)index * SM_ASSET_ENTRY_SIZE);
+        };
+
+        // linear search, look assets up once in setup() when the pack is large
+        bool find(const char * name, smAsset &asset) const {
+            for(uint16_t i = 0; i < assetCount; i++) {
+                if(!strncmp(getAssetName(i), name, SM_ASSET_NAME_LENGTH))
+                    return getAsset(i, asset);
+            }
+            return false;
+        };
+
+        // draws a bitmap asset into the layer's drawing buffer, rows are copied from flash by drawBitmap() (memcpy when the asset's
+        // format matches the layer's storage and the layer isn't rotated by 90/270), returns false if the asset is smaller than width * height pixels
+        template <typename RGB, unsigned int optionFlags>
+        bool draw(SMLayerBackground<RGB, optionFlags> * layer, const smAsset &asset, int16_t x, int16_t y) const {
+            if(asset.type != SM_ASSET_BITMAP || asset.format > SM_BITMAP_FORMAT_RGB332)
+                return false;
+            // a corrupt or truncated entry would have drawBitmap() read past the asset's data
+            if((uint64_t)asset.width * asset.height * getBitmapBytesPerPixel(asset.format) > asset.size)
+                return false;
+            layer->drawBitmap(x, y, asset.width, asset.height, asset.data, asset.format);
+            return true;
+        };
+
+        template <typename RGB, unsigned int optionFlags>
+        bool draw(SMLayerBackground<RGB, optionFlags> * layer, const char * name, int16_t x, int16_t y) const {
+            smAsset asset;
+            return find(name, asset) && draw(layer, asset, x, y);
+        };
+
+        // points source at an animation asset, for SMAnimationPlayer::begin(), frames are decoded from flash in place
+        bool openAnimation(const char * name, SMMemorySource &source) const {
+            smAsset asset;
+            if(!find(name, asset) || asset.type != SM_ASSET_ANIMATION)
+                return false;
+            source.setData(asset.data, asset.size);
+            return true;
+        };
+
+    protected:
+        static uint8_t getBitmapBytesPerPixel(smBitmapFormat format) {
+            if(format == SM_BITMAP_FORMAT_RGB24)
+                return 3;
+            else if(format == SM_BITMAP_FORMAT_RGB565)
+                return 2;
+            else
+                return 1;
+        };
+
+        static uint32_t read32(const uint8_t * p) {
+            return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+        };
+
+        const uint8_t * pack = NULL;
+        uint32_t size = 0;
+        uint16_t assetCount = 0;
+
+#if defined(ESP32)
+        spi_flash_mmap_handle_t mapHandle;
+        bool partitionMapped = false;
+#endif
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * SmartMatrix Library - Flash Safe Refresh Placement
+ *
+ * Copyright (c) 2024 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_FLASH_SAFE_H_
+#define _MATRIX_FLASH_SAFE_H_
+
+// ESP32: define SMARTMATRIX_FLASH_SAFE_REFRESH before including SmartMatrix.h to place the calc, the layers' row fills and the LUTs they
+// read in IRAM/DRAM, so they don't wait on flash cache misses after a flash write or OTA step has had the cache disabled.  The library's
+// .cpp files (the SM_Layer defaults, the glyph lookups, the panel maps) only see it as a build flag, e.g. -DSMARTMATRIX_FLASH_SAFE_REFRESH
+#if defined(ESP32) && defined(SMARTMATRIX_FLASH_SAFE_REFRESH)
+  #include "esp_attr.h"
+  #define SM_FLASH_SAFE_IRAM    IRAM_ATTR
+  #define SM_FLASH_SAFE_DRAM    DRAM_ATTR
+#else
+  #define SM_FLASH_SAFE_IRAM
+  #define SM_FLASH_SAFE_DRAM
+#endif
+
+#endif
@@ -21,63 +21,347 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
 #include "MatrixFontCommon.h"
+#include "MatrixFlashSafe.h"
 
 // depends on letters in font->Index table being arranged in ascending order
 // save location of last lookup to speed up repeated lookups of the same letter
 // TODO: use successive approximation to located index faster
-int getBitmapFontLocation(unsigned char letter, const bitmap_font *font) {
+int SM_FLASH_SAFE_IRAM getBitmapFontLocation(uint32_t letter, const bitmap_font *font) {
     static int location = 0;
 
-    if(location < 0)
-        location = 0;
+    // letters outside the table are rejected without a search, e.g. codepoints past 0xFF in the bundled Latin-1 fonts
+    if(!font->Chars || letter < font->Index[0] || letter > font->Index[font->Chars - 1])
+        return -1;
 
-    if(font->Index[location] == letter)
-        return location;
+    // the saved location may be from a larger font, or left one past the end of the table by a search that missed
+    int i = location;
+    if(i < 0 || i >= font->Chars)
+        i = 0;
 
-    if(font->Index[location] < letter) {
-        for (; location < font->Chars; location++) {
-            if (font->Index[location] == letter)
-                return location;
+    if(font->Index[i] < letter) {
+        for (; i < font->Chars; i++) {
+            if (font->Index[i] >= letter)
+                break;
         }
     } else {
-        for (; location >= 0; location--) {
-            if (font->Index[location] == letter)
-                return location;
+        for (; i > 0; i--) {
+            if (font->Index[i] <= letter)
+                break;
         }
     }
 
+    if (font->Index[i] != letter)
+        return -1;
+
+    location = i;
+    return i;
+}
+
+// order needs to match fontChoices enum
+static const bitmap_font * const SM_FLASH_SAFE_DRAM fontArray[] = {
+    &apple3x5,
+    &apple5x7,
+    &apple6x10,
+    &apple8x13,
+    &gohufont6x11,
+    &gohufont6x11b,
+};
+
+#define NUM_CACHED_FONTS    (sizeof(fontArray) / sizeof(fontArray[0]))
+
+// direct mapped cache of font->Index locations
+// each entry is one 32-bit word: font number (+1, 0 is empty) in bits 31-24, letter in bits 23-16, location in bits 15-0 (0xFFFF: not in font)
+// packing it in a single word keeps a lookup from an interrupt in the middle of a cache update from seeing half of an entry
+#define GLYPH_CACHE_SIZE            256
+#define GLYPH_CACHE_NOT_IN_FONT     0xFFFF
+
+static uint32_t glyphCache[GLYPH_CACHE_SIZE];
+
+static int SM_FLASH_SAFE_IRAM getCachedFontNumber(const bitmap_font *font) {
+    for (unsigned int i = 0; i < NUM_CACHED_FONTS; i++) {
+        if (fontArray[i] == font)
+            return i;
+    }
+    return -1;
+}
+
+static int SM_FLASH_SAFE_IRAM getCachedBitmapFontLocation(unsigned char letter, const bitmap_font *font) {
+    int fontNumber = getCachedFontNumber(font);
+
+    // fonts not in fontArray aren't cached
+    if (fontNumber < 0)
+        return getBitmapFontLocation(letter, font);
+
+    uint32_t key = ((uint32_t)(fontNumber + 1) << 24) | ((uint32_t)letter << 16);
+    unsigned int slot = (letter + (fontNumber * 37)) % GLYPH_CACHE_SIZE;
+
+    uint32_t entry = glyphCache[slot];
+    if ((entry & 0xFFFF0000) == key)
+        return ((entry & 0xFFFF) == GLYPH_CACHE_NOT_IN_FONT) ? -1 : (int)(entry & 0xFFFF);
+
+    int location = getBitmapFontLocation(letter, font);
+    glyphCache[slot] = key | ((location < 0) ? GLYPH_CACHE_NOT_IN_FONT : location);
+    return location;
+}
+
+// binary search of the sparse index, ranges are sorted and don't overlap
+static int SM_FLASH_SAFE_IRAM getRangedBitmapFontLocation(uint32_t codepoint, const bitmap_font *font) {
+    int low = 0;
+    int high = font->NumRanges - 1;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        const bitmap_font_range *range = &font->Ranges[middle];
+
+        if (codepoint < range->First)
+            high = middle - 1;
+        else if (codepoint - range->First >= range->Count)
+            low = middle + 1;
+        else
+            return range->Glyph + (codepoint - range->First);
+    }
+
+    return -1;
+}
+
+static int SM_FLASH_SAFE_IRAM getBitmapFontCodepointLocation(uint32_t codepoint, const bitmap_font *font) {
+    if (font->Ranges)
+        return getRangedBitmapFontLocation(codepoint, font);
+
+    if (codepoint <= 0xFF)
+        return getCachedBitmapFontLocation(codepoint, font);
+
+    if (codepoint <= 0xFFFF)
+        return getBitmapFontLocation(codepoint, font);
+
     return -1;
 }
 
+// direct mapped cache of decoded packed characters, an entry's font is cleared while it's decoded into
+typedef struct packedGlyphCacheEntry {
+    const bitmap_font * volatile font;
+    int location;
+    unsigned char rows[SM_FONT_PACKED_MAX_HEIGHT];
+} packedGlyphCacheEntry;
+
+// the refresh context has its own cache, so a glyph it decodes can't be overwritten by a sketch drawing text in the middle, or the
+// other way around
+static packedGlyphCacheEntry packedGlyphCache[SM_FONT_PACKED_CACHE_SIZE];
+static packedGlyphCacheEntry packedGlyphRefreshCache[SM_FONT_PACKED_CACHE_SIZE];
+
+static const unsigned char * SM_FLASH_SAFE_IRAM getPackedBitmapFontRows(int location, const bitmap_font *font, packedGlyphCacheEntry *cache) {
+    unsigned int slot = (location + ((uintptr_t)font >> 2)) % SM_FONT_PACKED_CACHE_SIZE;
+    packedGlyphCacheEntry *entry = &cache[slot];
+
+    if (entry->font == font && entry->location == location)
+        return entry->rows;
+
+    entry->font = 0;
+
+    const unsigned char *packed = &font->Bitmap[font->Offsets[location]];
+    int height = (font->Height < SM_FONT_PACKED_MAX_HEIGHT) ? font->Height : SM_FONT_PACKED_MAX_HEIGHT;
+    int width = (font->Width < 8) ? font->Width : 8;
+    int firstRow = packed[0];
+    // loadPackedBitmapFont() rejects rows past the font's height, this keeps a compiled in font in bounds too
+    int numRows = (firstRow + packed[1] <= height) ? packed[1] : ((firstRow < height) ? height - firstRow : 0);
+    const unsigned char *bits = &packed[2];
+    unsigned int bitPosition = 0;
+    unsigned char row = 0;
+
+    memset(entry->rows, 0x00, sizeof(entry->rows));
+
+    for (int i = 0; i < numRows; i++) {
+        bool repeat = bits[bitPosition / 8] & (0x80 >> (bitPosition % 8));
+        bitPosition++;
+
+        if (!repeat) {
+            row = 0;
+            for (int x = 0; x < width; x++, bitPosition++) {
+                if (bits[bitPosition / 8] & (0x80 >> (bitPosition % 8)))
+                    row |= 0x80 >> x;
+            }
+        }
+
+        entry->rows[firstRow + i] = row;
+    }
+
+    entry->location = location;
+    entry->font = font;
+    return entry->rows;
+}
+
+static const unsigned char * SM_FLASH_SAFE_IRAM getBitmapFontCodepointRowsFromCache(uint32_t codepoint, const bitmap_font *font, packedGlyphCacheEntry *cache) {
+    int location = getBitmapFontCodepointLocation(codepoint, font);
+
+    if (location < 0)
+        return 0;
+
+    if (font->Offsets)
+        return getPackedBitmapFontRows(location, font, cache);
+
+    return &font->Bitmap[location * font->Height];
+}
+
+const unsigned char * SM_FLASH_SAFE_IRAM getBitmapFontCodepointRows(uint32_t codepoint, const bitmap_font *font) {
+    return getBitmapFontCodepointRowsFromCache(codepoint, font, packedGlyphCache);
+}
+
+const unsigned char * SM_FLASH_SAFE_IRAM getBitmapFontCodepointRowsForRefresh(uint32_t codepoint, const bitmap_font *font) {
+    return getBitmapFontCodepointRowsFromCache(codepoint, font, packedGlyphRefreshCache);
+}
+
+unsigned char getBitmapFontCodepointWidth(uint32_t codepoint, const bitmap_font *font) {
+    if (!font->Widths)
+        return font->Width;
+
+    int location = getBitmapFontCodepointLocation(codepoint, font);
+
+    if (location < 0)
+        return 0;
+
+    return font->Widths[location];
+}
+
+const unsigned char *getBitmapFontGlyphRows(unsigned char letter, const bitmap_font *font) {
+    return getBitmapFontCodepointRows(letter, font);
+}
+
+unsigned char getBitmapFontGlyphWidth(unsigned char letter, const bitmap_font *font) {
+    return getBitmapFontCodepointWidth(letter, font);
+}
+
+uint32_t getNextUtf8Codepoint(const char **text) {
+    const unsigned char *bytes = (const unsigned char *)*text;
+    uint32_t codepoint = bytes[0];
+    int length;
+
+    if (codepoint >= 0xC2 && codepoint <= 0xDF) {
+        length = 2;
+        codepoint &= 0x1F;
+    } else if (codepoint >= 0xE0 && codepoint <= 0xEF) {
+        length = 3;
+        codepoint &= 0x0F;
+    } else if (codepoint >= 0xF0 && codepoint <= 0xF4) {
+        length = 4;
+        codepoint &= 0x07;
+    } else {
+        (*text)++;
+        return codepoint;
+    }
+
+    // a NUL fails the continuation byte test, so a truncated sequence never reads past the end of the string
+    for (int i = 1; i < length; i++) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            (*text)++;
+            return bytes[0];
+        }
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+
+    // reject overlong encodings, surrogates and codepoints past U+10FFFF
+    if ((length == 3 && codepoint < 0x800) || (length == 4 && (codepoint < 0x10000 || codepoint > 0x10FFFF)) ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        (*text)++;
+        return bytes[0];
+    }
+
+    *text += length;
+    return codepoint;
+}
+
+// packed font image, little endian, the arrays are used in place:
+//   header: 'S' 'M' 'F' '1' width(8) height(8) flags(8, bit 0: has widths) reserved(8) numRanges(16) chars(16) bitmapSize(32)
+//   then numRanges bitmap_font_range entries (8 bytes each), chars offsets(16), with widths chars widths(8), bitmapSize bytes of bitmap
+#define PACKED_FONT_HEADER_SIZE     16
+#define PACKED_FONT_HAS_WIDTHS      0x01
+
+bool loadPackedBitmapFont(bitmap_font *font, const uint8_t *image, uint32_t size) {
+    if (size < PACKED_FONT_HEADER_SIZE || memcmp(image, "SMF1", 4) || ((uintptr_t)image & 3))
+        return false;
+
+    uint8_t width = image[4];
+    uint8_t height = image[5];
+    uint8_t flags = image[6];
+    uint16_t numRanges = image[8] | (image[9] << 8);
+    uint16_t chars = image[10] | (image[11] << 8);
+    uint32_t bitmapSize = image[12] | (image[13] << 8) | ((uint32_t)image[14] << 16) | ((uint32_t)image[15] << 24);
+
+    if (width > 8 || height > SM_FONT_PACKED_MAX_HEIGHT)
+        return false;
+
+    uint32_t rangesStart = PACKED_FONT_HEADER_SIZE;
+    uint32_t offsetsStart = rangesStart + (uint32_t)numRanges * sizeof(bitmap_font_range);
+    uint32_t widthsStart = offsetsStart + (uint32_t)chars * sizeof(unsigned short);
+    uint32_t bitmapStart = widthsStart + ((flags & PACKED_FONT_HAS_WIDTHS) ? chars : 0);
+
+    if (bitmapStart + bitmapSize > size)
+        return false;
+
+    const bitmap_font_range *ranges = (const bitmap_font_range *)&image[rangesStart];
+    const unsigned short *offsets = (const unsigned short *)&image[offsetsStart];
+
+    // check once here, so lookups and decoding don't need to
+    for (int i = 0; i < numRanges; i++) {
+        if ((uint32_t)ranges[i].Glyph + ranges[i].Count > chars)
+            return false;
+        if (i && ranges[i].First < ranges[i - 1].First + ranges[i - 1].Count)
+            return false;
+    }
+    for (int i = 0; i < chars; i++) {
+        // the two byte row header plus the longest possible bit stream
+        if ((uint32_t)offsets[i] + 2 + ((height * (width + 1)) + 7) / 8 > bitmapSize)
+            return false;
+        // and the rows with pixels have to fit in the font's height
+        const uint8_t *packed = &image[bitmapStart + offsets[i]];
+        if (packed[0] + packed[1] > height)
+            return false;
+    }
+
+    font->Width = width;
+    font->Height = height;
+    font->Chars = chars;
+    font->Widths = (flags & PACKED_FONT_HAS_WIDTHS) ? &image[widthsStart] : 0;
+    font->Index = 0;
+    font->Bitmap = &image[bitmapStart];
+    font->Ranges = ranges;
+    font->NumRanges = numRanges;
+    font->Offsets = offsets;
+    return true;
+}
+
+void preloadBitmapFontGlyphs(const bitmap_font *font, unsigned char first, unsigned char last) {
+    for (unsigned int letter = first; letter <= last; letter++)
+        getCachedBitmapFontLocation(letter, font);
+}
+
 bool getBitmapFontPixelAtXY(unsigned char letter, unsigned char x, unsigned char y, const bitmap_font *font)
 {
-    int location;
     if (y >= font->Height)
         return false;
 
-    location = getBitmapFontLocation(letter, font);
+    const unsigned char *rows = getBitmapFontCodepointRows(letter, font);
 
-    if (location < 0)
+    if (!rows)
         return false;
 
-    if (font->Bitmap[(location * font->Height) + y] & (0x80 >> x))
+    if (rows[y] & (0x80 >> x))
         return true;
     else
         return false;
 }
 
 uint16_t getBitmapFontRowAtXY(unsigned char letter, unsigned char y, const bitmap_font *font) {
-    int location;
     if (y >= font->Height)
         return 0x0000;
 
-    location = getBitmapFontLocation(letter, font);
+    const unsigned char *rows = getBitmapFontCodepointRows(letter, font);
 
-    if (location < 0)
+    if (!rows)
         return 0x0000;
 
-    return(font->Bitmap[(location * font->Height) + y]);
+    return rows[y];
 }
 
 bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap) {
@@ -87,16 +371,6 @@ bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, con
     return (mask & bitmap[cell]);
 }
 
-// order needs to match fontChoices enum
-static const bitmap_font *fontArray[] = {
-    &apple3x5,
-    &apple5x7,
-    &apple6x10,
-    &apple8x13,
-    &gohufont6x11,
-    &gohufont6x11b,
-};
-
 const bitmap_font *fontLookup(fontChoices font) {
     return fontArray[font];
 }
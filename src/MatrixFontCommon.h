@@ -27,6 +27,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+	/// run of consecutive codepoints in a sparse font index
+typedef struct bitmap_font_range {
+	uint32_t First;			///< first codepoint in the run
+	unsigned short Count;		///< number of codepoints in the run
+	unsigned short Glyph;		///< character index of the first codepoint
+} bitmap_font_range;
+
 	/// bitmap font structure
 typedef struct bitmap_font {
 	unsigned char Width;		///< max. character width
@@ -35,8 +42,19 @@ typedef struct bitmap_font {
 	const unsigned char *Widths;	///< width of each character
 	const unsigned short *Index;	///< encoding to character index
 	const unsigned char *Bitmap;	///< bitmap of all characters
+	const bitmap_font_range *Ranges;	///< sparse index sorted by codepoint, used instead of Index if not NULL
+	unsigned short NumRanges;	///< number of entries in Ranges
+	const unsigned short *Offsets;	///< start of each packed character in Bitmap, NULL if Bitmap has Height bytes per character
 } bitmap_font;
 
+// packed characters (Offsets != NULL) start with the first row that has pixels and the number of rows with pixels, one byte each,
+// followed by a bit stream (MSB first) with for each of those rows a 1 to repeat the previous row, or a 0 and the Width leftmost
+// pixels of the row.  They're decoded into a small cache the first time they're drawn
+#ifndef SM_FONT_PACKED_CACHE_SIZE
+#define SM_FONT_PACKED_CACHE_SIZE   16
+#endif
+#define SM_FONT_PACKED_MAX_HEIGHT   32
+
 
 extern const bitmap_font apple3x5;
 extern const bitmap_font apple5x7;
@@ -59,6 +77,28 @@ const bitmap_font *fontLookup(fontChoices font);
 uint16_t getBitmapFontRowAtXY(unsigned char letter, unsigned char y, const bitmap_font *font);
 bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap);
 
+// glyph lookups are cached, so drawing the same letters again skips the search through font->Index
+// rows: font->Height bytes, MSB is the leftmost pixel, NULL if the letter isn't in the font
+const unsigned char *getBitmapFontGlyphRows(unsigned char letter, const bitmap_font *font);
+unsigned char getBitmapFontGlyphWidth(unsigned char letter, const bitmap_font *font);
+// define SM_FONT_PRELOAD_ASCII before including SmartMatrix.h to have setFont() fill the cache with printable ASCII
+void preloadBitmapFontGlyphs(const bitmap_font *font, unsigned char first, unsigned char last);
+
+// the same lookups by Unicode codepoint: the bundled fonts cover 0-255 (Latin-1), fonts with Ranges can cover any codepoint
+const unsigned char *getBitmapFontCodepointRows(uint32_t codepoint, const bitmap_font *font);
+unsigned char getBitmapFontCodepointWidth(uint32_t codepoint, const bitmap_font *font);
+// the same as getBitmapFontCodepointRows(), for layers drawing text from frameRefreshCallback(): packed characters are decoded into
+// a separate cache, so the rows aren't overwritten by the sketch drawing text at the same time
+const unsigned char *getBitmapFontCodepointRowsForRefresh(uint32_t codepoint, const bitmap_font *font);
+// returns the next character of a UTF-8 string and advances *text past it, a byte that doesn't start a valid sequence is returned
+// on its own as a Latin-1 character, so strings written for the bundled fonts' Latin-1 glyphs still draw the same
+uint32_t getNextUtf8Codepoint(const char **text);
+
+// fills font from a packed font image (made with extras/tools/smfont.py) that's already in memory: a PROGMEM array, an asset in
+// mapped flash, or a file read from SD into RAM.  Nothing is copied, the image has to stay in place while font is used, and has to
+// be 4-byte aligned.  Returns false if the image isn't a packed font or is truncated
+bool loadPackedBitmapFont(bitmap_font *font, const uint8_t *image, uint32_t size);
+
 /// @{ defines to have human readable font files
 #define ________ 0x00
 #define _______X 0x01
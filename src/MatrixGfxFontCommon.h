@@ -36,4 +36,9 @@
 #include "FontGfx_gohufont6x11b.h"
 #include "FontGfx_tom_thumb.h"
 
+// Adafruit_GFX lines and rectangles are given as a start and a length that may be negative, returns the last coordinate covered (length must not be 0)
+static inline int16_t smGfxSpanEnd(int16_t start, int16_t length) {
+    return (length > 0) ? start + length - 1 : start + length + 1;
+}
+
 #endif
@@ -0,0 +1,170 @@
+/*
+ * SmartMatrix Library - Memory Budget and Allocation Report
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_MEMORY_PLANNER_H_
+#define _MATRIX_MEMORY_PLANNER_H_
+
+#include <stdint.h>
+
+#if defined(ESP32)
+#include "soc/soc_memory_layout.h"
+#endif
+
+/*
+ * Compile-time sizes of the buffers created by SMARTMATRIX_ALLOCATE_BUFFERS() and SMARTMATRIX_ALLOCATE_*_LAYER(), taking the same
+ * arguments as the allocation macros.  On Teensy these buffers are static, on ESP32 they're allocated from the heap in begin(),
+ * but the sizes are the same, so a sketch can check a configuration fits before flashing, e.g.:
+ *
+ *   SM_MEMORY_STATIC_ASSERT_BUDGET(SM_MEMORY_HUB75_REFRESH_BYTES(kMatrixWidth, kMatrixHeight, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions) +
+ *                                  SM_MEMORY_ESP32_DESCRIPTOR_BYTES(kRefreshDepth, kPanelType, kMatrixOptions, 2), 120 * 1024);
+ */
+
+// background layer: frame buffers, color correction LUT and (if enabled) the row cache
+#define SM_MEMORY_BACKGROUND_LAYER_BYTES(width, height, storage_depth, background_options) \
+    (SM_BACKGROUND_NUM_BUFFERS(background_options) * (width) * (height) * sizeof(RGB_TYPE(storage_depth)) + \
+     SM_BACKGROUND_LUT_BUFFER_SIZE(RGB_TYPE(storage_depth), background_options) * sizeof(color_chan_t) + \
+     (((background_options) & SM_BACKGROUND_OPTIONS_ROW_CACHE) ? SM_BACKGROUND_ROW_CACHE_ROWS * (width) * sizeof(RGB_TYPE(storage_depth)) : 0))
+
+#define SM_MEMORY_SCROLLING_LAYER_BYTES(width, height)      ((width) * ((height) / 8))
+#define SM_MEMORY_INDEXED_LAYER_BYTES(width, height)        (2 * (width) * ((height) / 8))
+#define SM_MEMORY_GFX_MONO_LAYER_BYTES(layerwidth, layerheight) \
+    (2 * ROUND_UP_TO_MULTIPLE_OF_8(layerwidth) * (ROUND_UP_TO_MULTIPLE_OF_8(layerheight) / 8))
+// sprite layer: draw table, two refresh tables, and one active sprite mask per hardware row
+#define SM_MEMORY_SPRITE_LAYER_BYTES(height, storage_depth, max_sprites) \
+    (3 * (max_sprites) * sizeof(SMLayerSprites<RGB_TYPE(storage_depth), 0>::sprite) + (height) * sizeof(uint64_t))
+// RGBA layer: drawing and refresh buffers of premultiplied pixels, and their row spans
+#define SM_MEMORY_RGBA_LAYER_BYTES(width, height) \
+    (2 * (width) * (height) * sizeof(rgba32) + SM_RGBA_SPAN_BUFFER_SIZE(height) * sizeof(uint16_t))
+
+// refresh buffers for HUB75 panels, all in DMA capable RAM
+#if defined(ESP32)
+    #define SM_MEMORY_HUB75_REFRESH_BYTES(width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
+        (ESP32_NUM_FRAME_BUFFERS * sizeof(typename SmartMatrixHub75Refresh<pwm_depth, width, height, panel_type, option_flags>::frameStruct))
+#elif defined(__IMXRT1062__) || defined(SM_HOST_BUILD)
+    #define SM_MEMORY_HUB75_REFRESH_BYTES(width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
+        ((buffer_rows) * sizeof(typename SmartMatrixRefreshT4<pwm_depth, width, height, panel_type, option_flags>::rowDataStruct))
+#else
+    #define SM_MEMORY_HUB75_REFRESH_BYTES(width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
+        ((buffer_rows) * sizeof(typename SmartMatrixHub75Refresh<pwm_depth, width, height, panel_type, option_flags>::rowDataStruct))
+#endif
+
+// one descriptor for the bitplanes up to lsbMsbTransitionBit, and 2^(n-1) descriptors for the nth bitplane above it (see begin() in
+// MatrixEsp32Hub75Refresh_Impl.h), no larger than the sum because each added descriptor repeats a bitplane to double its on time
+#define SM_MEMORY_ESP32_LLDESC_BYTES    12
+
+constexpr uint32_t smEsp32DescriptorsPerRow(int colorDepthBits, int lsbMsbTransitionBit) {
+    return (lsbMsbTransitionBit >= colorDepthBits - 1) ? 1 : (1UL << (colorDepthBits - lsbMsbTransitionBit - 1));
+}
+
+// ESP32_SHARED_DESCRIPTORS keeps only the head rows per frame buffer, otherwise every frame buffer has descriptors for all rows
+constexpr uint32_t smEsp32DescriptorBytes(int colorDepthBits, int scanMod, int lsbMsbTransitionBit, bool sharedDescriptors, int headRows) {
+    return smEsp32DescriptorsPerRow(colorDepthBits, lsbMsbTransitionBit) * SM_MEMORY_ESP32_LLDESC_BYTES *
+        (sharedDescriptors ? (2 * headRows + (scanMod - headRows)) : (2 * scanMod));
+}
+
+#define SM_MEMORY_ESP32_DESCRIPTOR_BYTES(pwm_depth, panel_type, option_flags, lsbMsbTransitionBit) \
+    smEsp32DescriptorBytes((pwm_depth) / 3, CONVERT_PANELTYPE_TO_MATRIXSCANMOD(panel_type), lsbMsbTransitionBit, \
+        ((option_flags) & SMARTMATRIX_OPTIONS_ESP32_SHARED_DESCRIPTORS) != 0, ESP32_SHARED_DESCRIPTORS_HEAD_ROWS)
+
+// fails the build with a readable message if bytes is over budget; SM_MEMORY_BUDGET_BYTES is used by SM_MEMORY_CHECK_BUDGET()
+#define SM_MEMORY_STATIC_ASSERT_BUDGET(bytes, budget) \
+    static_assert((bytes) <= (budget), "SmartMatrix buffers exceed the memory budget, lower refreshDepth or raise lsbMsbTransitionBit")
+
+#ifdef SM_MEMORY_BUDGET_BYTES
+#define SM_MEMORY_CHECK_BUDGET(bytes)   SM_MEMORY_STATIC_ASSERT_BUDGET(bytes, SM_MEMORY_BUDGET_BYTES)
+#else
+#define SM_MEMORY_CHECK_BUDGET(bytes)
+#endif
+
+/*
+ * Runtime report of what the library actually allocated, filled in as buffers are malloc'd in begin() (ESP32) and printed with
+ * smPrintMemoryReport().  Static buffers on Teensy aren't recorded, use the compile-time sizes above instead.
+ */
+typedef enum smMemorySubsystem {
+    smMemoryFrames,
+    smMemoryDescriptors,
+    smMemoryTempRows,
+    smMemoryLayers,
+    smMemoryLUTs,
+    smMemoryNumSubsystems
+} smMemorySubsystem;
+
+typedef enum smMemoryType {
+    smMemoryDMA,
+    smMemoryInternal,
+    smMemoryPSRAM,
+    smMemoryNumTypes
+} smMemoryType;
+
+typedef struct smMemoryReport {
+    uint32_t bytes[smMemoryNumSubsystems][smMemoryNumTypes];
+
+    smMemoryReport() { reset(); }
+
+    void reset(void) {
+        for(int i=0; i<smMemoryNumSubsystems; i++)
+            for(int j=0; j<smMemoryNumTypes; j++)
+                bytes[i][j] = 0;
+    }
+
+    uint32_t total(smMemoryType type) const {
+        uint32_t sum = 0;
+        for(int i=0; i<smMemoryNumSubsystems; i++)
+            sum += bytes[i][type];
+        return sum;
+    }
+} smMemoryReport;
+
+inline smMemoryReport & smGetMemoryReport(void) {
+    static smMemoryReport report;
+    return report;
+}
+
+// classify by where the pointer landed rather than what was asked for, so malloc() falling back to PSRAM is reported correctly
+inline void smRecordAllocation(smMemorySubsystem subsystem, const void * ptr, uint32_t bytes) {
+    if(!ptr) return;
+
+    smMemoryType type = smMemoryInternal;
+#if defined(ESP32)
+    if(esp_ptr_external_ram(ptr))
+        type = smMemoryPSRAM;
+    else if(esp_ptr_dma_capable(ptr))
+        type = smMemoryDMA;
+#endif
+    smGetMemoryReport().bytes[subsystem][type] += bytes;
+}
+
+inline void smPrintMemoryReport(void) {
+    static const char * const subsystemNames[smMemoryNumSubsystems] = { "frames", "descriptors", "temp rows", "layers", "LUTs" };
+    const smMemoryReport & report = smGetMemoryReport();
+
+    Serial.printf("%-12s %9s %9s %9s\r\n", "SmartMatrix", "DMA", "internal", "PSRAM");
+    for(int i=0; i<smMemoryNumSubsystems; i++) {
+        Serial.printf("%-12s %9lu %9lu %9lu\r\n", subsystemNames[i], (unsigned long)report.bytes[i][smMemoryDMA],
+            (unsigned long)report.bytes[i][smMemoryInternal], (unsigned long)report.bytes[i][smMemoryPSRAM]);
+    }
+    Serial.printf("%-12s %9lu %9lu %9lu\r\n", "total", (unsigned long)report.total(smMemoryDMA),
+        (unsigned long)report.total(smMemoryInternal), (unsigned long)report.total(smMemoryPSRAM));
+}
+
+#endif
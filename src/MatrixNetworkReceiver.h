@@ -0,0 +1,120 @@
+/*
+ * SmartMatrix Library - Network Frame Receiver (DDP, E1.31, Art-Net)
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_NETWORK_RECEIVER_H_
+#define _MATRIX_NETWORK_RECEIVER_H_
+
+// Parses DDP, E1.31 (sACN) and Art-Net packets straight into the drawing buffer of an SMLayerBackground, with whole rows copied by
+// drawBitmap() (memcpy for rgb24 layers without 90/270 rotation) instead of a drawPixel() call per pixel, and swaps buffers at frame
+// boundaries.  Pixel data is 8-bit RGB in local (rotated) row-major order, starting at the top left.
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.  Feed received UDP payloads to handlePacket(), or on ESP32 call
+// begin(port) to receive them with AsyncUDP, which hands over the payload in the network stack's buffer without another copy.
+// Packets are written from the caller's (or AsyncUDP's) task, so the sketch shouldn't draw to the same layer.  swapBuffers() waits
+// for refresh to take the previous frame unless the layer uses SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER, which is recommended here.
+
+#include "Layer_Background.h"
+
+#if defined(ESP32) && !defined(SM_NETWORK_RECEIVER_NO_ASYNCUDP)
+#include <AsyncUDP.h>
+#define SM_NETWORK_RECEIVER_ASYNCUDP
+#endif
+
+#define SM_DDP_PORT                 4048
+#define SM_E131_PORT                5568
+#define SM_ARTNET_PORT              6454
+
+// universes tracked for E1.31/Art-Net sequence numbers, a 128x64 frame takes 49 universes of 170 pixels
+#ifndef SM_NETWORK_RECEIVER_MAX_UNIVERSES
+#define SM_NETWORK_RECEIVER_MAX_UNIVERSES   64
+#endif
+
+typedef struct smNetworkReceiverStats {
+    uint32_t packets;       // packets accepted
+    uint32_t frames;        // buffer swaps
+    uint32_t dropped;       // packets missing from sequence number gaps
+    uint32_t outOfOrder;    // late packets, discarded
+    uint32_t invalid;       // packets that weren't pixel data for this receiver, or were malformed
+} smNetworkReceiverStats;
+
+template <typename RGB, unsigned int optionFlags>
+class SMNetworkFrameReceiver {
+    public:
+        SMNetworkFrameReceiver(SMLayerBackground<RGB, optionFlags> * layer);
+
+#if defined(SM_NETWORK_RECEIVER_ASYNCUDP)
+        // listen for unicast packets on port, E1.31 multicast needs a call to listenMulticast() on the AsyncUDP object instead
+        bool begin(uint16_t port = SM_DDP_PORT);
+        AsyncUDP & getUDP(void) { return udp; };
+#endif
+        // detects the protocol from the packet header, returns false if the packet was ignored
+        bool handlePacket(const uint8_t * data, size_t length);
+
+        // E1.31/Art-Net: the universe holding the first pixels, and the channels used per universe (the rest are ignored)
+        void setUniverses(uint16_t firstUniverse, uint16_t channelsPerUniverse = 510);
+        // copy the frame into the new drawing buffer on swap, needed for senders that only update part of the frame
+        void setCopyOnSwap(bool copy) { copyOnSwap = copy; };
+
+        const smNetworkReceiverStats & getStats(void) const { return stats; };
+        void resetStats(void);
+
+    protected:
+        bool handleDdp(const uint8_t * data, size_t length);
+        bool handleE131(const uint8_t * data, size_t length);
+        bool handleArtNet(const uint8_t * data, size_t length);
+
+        // writes length bytes of pixel data at byte offset into the drawing buffer, a pixel split across packets is carried over
+        void writePixelBytes(uint32_t offset, const uint8_t * data, uint32_t length);
+        void writePixels(uint32_t firstPixel, const uint8_t * data, uint32_t numPixels);
+        void swapFrame(void);
+        // checks a per-universe sequence number, returns false for a late packet
+        bool checkUniverseSequence(uint16_t universeIndex, uint8_t sequence, bool zeroDisables);
+
+        SMLayerBackground<RGB, optionFlags> * layer;
+        bool copyOnSwap = true;
+        uint16_t firstUniverse = 1;
+        uint16_t channelsPerUniverse = 510;
+        uint32_t frameBytes(void) const { return (uint32_t)layer->getLocalWidth() * layer->getLocalHeight() * 3; };
+
+        // frames are swapped on a sync packet instead of when the last pixel arrives, once the sender has used sync
+        bool e131SyncSeen = false;
+        bool artNetSyncSeen = false;
+
+        uint8_t ddpLastSequence = 0;
+        uint8_t universeSequence[SM_NETWORK_RECEIVER_MAX_UNIVERSES];
+        bool universeSequenceValid[SM_NETWORK_RECEIVER_MAX_UNIVERSES];
+
+        uint8_t carry[3];
+        uint8_t carryBytes = 0;
+        uint32_t carryOffset = 0;
+
+        smNetworkReceiverStats stats;
+
+#if defined(SM_NETWORK_RECEIVER_ASYNCUDP)
+        AsyncUDP udp;
+#endif
+};
+
+#include "MatrixNetworkReceiver_Impl.h"
+
+#endif
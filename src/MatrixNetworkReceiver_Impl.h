@@ -0,0 +1,349 @@
+/*
+ * SmartMatrix Library - Network Frame Receiver (DDP, E1.31, Art-Net)
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// DDP header: flags, sequence, data type, destination id, 32-bit offset, 16-bit length (big endian), optional 32-bit timecode
+#define SM_DDP_HEADER_SIZE          10
+#define SM_DDP_FLAGS_VERSION_MASK   0xC0
+#define SM_DDP_FLAGS_VERSION_1      0x40
+#define SM_DDP_FLAGS_TIMECODE       0x10
+#define SM_DDP_FLAGS_QUERY          0x02
+#define SM_DDP_FLAGS_REPLY          0x04
+#define SM_DDP_FLAGS_PUSH           0x01
+#define SM_DDP_ID_DISPLAY           1
+// data type byte: bits 3-5 are the pixel type, 0 (undefined) and 1 (RGB) are taken as 3 bytes per pixel
+#define SM_DDP_TYPE_PIXEL_TYPE(type)    (((type) >> 3) & 0x07)
+#define SM_DDP_TYPE_UNDEFINED       0
+#define SM_DDP_TYPE_RGB             1
+
+// E1.31 offsets into the root, framing and DMP layers
+#define SM_E131_ROOT_VECTOR         18
+#define SM_E131_FRAMING_VECTOR      40
+#define SM_E131_SYNC_ADDRESS        109
+#define SM_E131_SEQUENCE            111
+#define SM_E131_OPTIONS             112
+#define SM_E131_UNIVERSE            113
+#define SM_E131_PROPERTY_COUNT      123
+#define SM_E131_START_CODE          125
+#define SM_E131_DATA                126
+#define SM_E131_SYNC_PACKET_SIZE    49
+#define SM_E131_VECTOR_ROOT_DATA        0x00000004
+#define SM_E131_VECTOR_ROOT_EXTENDED    0x00000008
+#define SM_E131_VECTOR_FRAMING_DATA     0x00000002
+#define SM_E131_VECTOR_FRAMING_SYNC     0x00000001
+#define SM_E131_OPTIONS_PREVIEW         0x80
+#define SM_E131_OPTIONS_TERMINATED      0x40
+
+#define SM_ARTNET_OP_DMX            0x5000
+#define SM_ARTNET_OP_SYNC           0x5200
+#define SM_ARTNET_DMX_HEADER_SIZE   18
+
+static inline uint16_t smReadBigEndian16(const uint8_t * p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t smReadBigEndian32(const uint8_t * p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+template <typename RGB, unsigned int optionFlags>
+SMNetworkFrameReceiver<RGB, optionFlags>::SMNetworkFrameReceiver(SMLayerBackground<RGB, optionFlags> * layer) {
+    this->layer = layer;
+    memset(universeSequenceValid, 0, sizeof(universeSequenceValid));
+    resetStats();
+}
+
+#if defined(SM_NETWORK_RECEIVER_ASYNCUDP)
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::begin(uint16_t port) {
+    if(!udp.listen(port)) {
+        Serial.println("Error: SMNetworkFrameReceiver can't listen on UDP port");
+        return false;
+    }
+
+    // the packet data is the payload in lwIP's buffer, parsed in place
+    udp.onPacket([this](AsyncUDPPacket & packet) {
+        handlePacket(packet.data(), packet.length());
+    });
+    return true;
+}
+#endif
+
+template <typename RGB, unsigned int optionFlags>
+void SMNetworkFrameReceiver<RGB, optionFlags>::setUniverses(uint16_t firstUniverse, uint16_t channelsPerUniverse) {
+    this->firstUniverse = firstUniverse;
+    // universes hold whole pixels, a pixel split between universes would need the carry to span packets of different universes
+    this->channelsPerUniverse = std::max(3, std::min(512, channelsPerUniverse - (channelsPerUniverse % 3)));
+    memset(universeSequenceValid, 0, sizeof(universeSequenceValid));
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMNetworkFrameReceiver<RGB, optionFlags>::resetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::handlePacket(const uint8_t * data, size_t length) {
+    bool accepted = false;
+
+    if(length >= 12 && !memcmp(data, "Art-Net", 8))
+        accepted = handleArtNet(data, length);
+    else if(length >= SM_E131_SYNC_PACKET_SIZE && smReadBigEndian16(data) == 0x0010 && !memcmp(data + 4, "ASC-E1.17\0\0\0", 12))
+        accepted = handleE131(data, length);
+    else if(length >= SM_DDP_HEADER_SIZE && (data[0] & SM_DDP_FLAGS_VERSION_MASK) == SM_DDP_FLAGS_VERSION_1)
+        accepted = handleDdp(data, length);
+
+    if(accepted)
+        stats.packets++;
+    else
+        stats.invalid++;
+
+    return accepted;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::handleDdp(const uint8_t * data, size_t length) {
+    // the whole header, with the timecode if there is one, has to be there before any of it is read
+    if(length < SM_DDP_HEADER_SIZE)
+        return false;
+
+    uint8_t flags = data[0];
+    size_t headerSize = SM_DDP_HEADER_SIZE + ((flags & SM_DDP_FLAGS_TIMECODE) ? 4 : 0);
+    if(length < headerSize)
+        return false;
+
+    uint8_t sequence = data[1] & 0x0F;
+    uint8_t pixelType = SM_DDP_TYPE_PIXEL_TYPE(data[2]);
+
+    // queries and replies are for DDP discovery, which isn't supported, and the other ids are control/config/status
+    if((flags & (SM_DDP_FLAGS_QUERY | SM_DDP_FLAGS_REPLY)) || data[3] != SM_DDP_ID_DISPLAY)
+        return false;
+
+    // other pixel types (HSL, RGBW, grayscale) don't have 3 bytes per pixel
+    if(pixelType != SM_DDP_TYPE_UNDEFINED && pixelType != SM_DDP_TYPE_RGB)
+        return false;
+
+    uint32_t offset = smReadBigEndian32(data + 4);
+    uint16_t dataLength = smReadBigEndian16(data + 8);
+    if(length < headerSize + dataLength)
+        return false;
+
+    // sequence numbers run 1-15, 0 means the sender doesn't use them
+    if(sequence) {
+        if(ddpLastSequence)
+            stats.dropped += (sequence + 15 - (ddpLastSequence % 15 + 1)) % 15;
+        ddpLastSequence = sequence;
+    }
+
+    writePixelBytes(offset, data + headerSize, dataLength);
+
+    if(flags & SM_DDP_FLAGS_PUSH)
+        swapFrame();
+
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::handleE131(const uint8_t * data, size_t length) {
+    uint32_t rootVector = smReadBigEndian32(data + SM_E131_ROOT_VECTOR);
+    uint32_t framingVector = smReadBigEndian32(data + SM_E131_FRAMING_VECTOR);
+
+    if(rootVector == SM_E131_VECTOR_ROOT_EXTENDED) {
+        if(framingVector != SM_E131_VECTOR_FRAMING_SYNC)
+            return false;
+        e131SyncSeen = true;
+        swapFrame();
+        return true;
+    }
+
+    if(rootVector != SM_E131_VECTOR_ROOT_DATA || framingVector != SM_E131_VECTOR_FRAMING_DATA || length <= SM_E131_DATA)
+        return false;
+
+    // start code 0 is dimmer (pixel) data, preview data isn't meant for live output
+    if(data[SM_E131_START_CODE] != 0 || (data[SM_E131_OPTIONS] & (SM_E131_OPTIONS_PREVIEW | SM_E131_OPTIONS_TERMINATED)))
+        return false;
+
+    uint16_t universe = smReadBigEndian16(data + SM_E131_UNIVERSE);
+    if(universe < firstUniverse)
+        return false;
+    uint16_t universeIndex = universe - firstUniverse;
+
+    if(!checkUniverseSequence(universeIndex, data[SM_E131_SEQUENCE], false))
+        return true;
+
+    // the property count includes the start code
+    uint16_t channels = smReadBigEndian16(data + SM_E131_PROPERTY_COUNT);
+    if(!channels || length < (size_t)SM_E131_DATA + channels - 1)
+        return false;
+    channels = std::min<uint16_t>(channels - 1, channelsPerUniverse);
+
+    uint32_t offset = (uint32_t)universeIndex * channelsPerUniverse;
+    writePixelBytes(offset, data + SM_E131_DATA, channels);
+
+    // without a sync address the frame is complete when the universe holding the last pixel arrives
+    if(!smReadBigEndian16(data + SM_E131_SYNC_ADDRESS))
+        e131SyncSeen = false;
+    if(!e131SyncSeen && offset + channels >= frameBytes())
+        swapFrame();
+
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::handleArtNet(const uint8_t * data, size_t length) {
+    uint16_t opcode = data[8] | ((uint16_t)data[9] << 8);
+
+    if(opcode == SM_ARTNET_OP_SYNC) {
+        artNetSyncSeen = true;
+        swapFrame();
+        return true;
+    }
+
+    if(opcode != SM_ARTNET_OP_DMX || length <= SM_ARTNET_DMX_HEADER_SIZE)
+        return false;
+
+    // 15-bit port address: net, then subnet and universe
+    uint16_t universe = data[14] | ((uint16_t)(data[15] & 0x7F) << 8);
+    if(universe < firstUniverse)
+        return false;
+    uint16_t universeIndex = universe - firstUniverse;
+
+    // sequence numbers run 1-255, 0 means the sender doesn't use them
+    if(!checkUniverseSequence(universeIndex, data[12], true))
+        return true;
+
+    uint16_t channels = smReadBigEndian16(data + 16);
+    if(length < (size_t)SM_ARTNET_DMX_HEADER_SIZE + channels)
+        return false;
+    channels = std::min(channels, channelsPerUniverse);
+
+    uint32_t offset = (uint32_t)universeIndex * channelsPerUniverse;
+    writePixelBytes(offset, data + SM_ARTNET_DMX_HEADER_SIZE, channels);
+
+    // once a sender has used ArtSync, frames are only swapped on ArtSync
+    if(!artNetSyncSeen && offset + channels >= frameBytes())
+        swapFrame();
+
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMNetworkFrameReceiver<RGB, optionFlags>::checkUniverseSequence(uint16_t universeIndex, uint8_t sequence, bool zeroDisables) {
+    if(universeIndex >= SM_NETWORK_RECEIVER_MAX_UNIVERSES || (zeroDisables && !sequence))
+        return true;
+
+    if(universeSequenceValid[universeIndex]) {
+        uint8_t last = universeSequence[universeIndex];
+        int diff = (int8_t)(sequence - last);
+        // Art-Net skips 0 when wrapping
+        if(zeroDisables && sequence < last && diff > 0)
+            diff--;
+
+        // E1.31 treats packets up to 20 behind as late, anything further back as the sender restarting
+        if(diff <= 0 && diff > -20) {
+            stats.outOfOrder++;
+            return false;
+        }
+        if(diff > 1)
+            stats.dropped += diff - 1;
+    }
+
+    universeSequence[universeIndex] = sequence;
+    universeSequenceValid[universeIndex] = true;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMNetworkFrameReceiver<RGB, optionFlags>::writePixelBytes(uint32_t offset, const uint8_t * data, uint32_t length) {
+    // finish a pixel split by the previous packet
+    if(carryBytes) {
+        if(offset == carryOffset + carryBytes) {
+            uint32_t count = std::min<uint32_t>(3 - carryBytes, length);
+            memcpy(carry + carryBytes, data, count);
+            carryBytes += count;
+            data += count;
+            offset += count;
+            length -= count;
+
+            if(carryBytes < 3)
+                return;
+            writePixels(carryOffset / 3, carry, 1);
+        }
+        carryBytes = 0;
+    }
+
+    // the start of this pixel was in a packet that was lost
+    uint32_t skip = (3 - (offset % 3)) % 3;
+    if(skip >= length)
+        return;
+    data += skip;
+    offset += skip;
+    length -= skip;
+
+    uint32_t numPixels = length / 3;
+    writePixels(offset / 3, data, numPixels);
+
+    carryBytes = length - (numPixels * 3);
+    if(carryBytes) {
+        carryOffset = offset + (numPixels * 3);
+        memcpy(carry, data + (numPixels * 3), carryBytes);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMNetworkFrameReceiver<RGB, optionFlags>::writePixels(uint32_t firstPixel, const uint8_t * data, uint32_t numPixels) {
+    uint16_t width = layer->getLocalWidth();
+    uint32_t totalPixels = (uint32_t)width * layer->getLocalHeight();
+
+    if(firstPixel >= totalPixels)
+        return;
+    numPixels = std::min(numPixels, totalPixels - firstPixel);
+
+    uint16_t x = firstPixel % width;
+    uint16_t y = firstPixel / width;
+
+    // the rest of a partial first row, then the full rows in one drawBitmap() call, then the start of the last row
+    if(x && numPixels) {
+        uint16_t count = std::min<uint32_t>(numPixels, width - x);
+        layer->drawBitmap(x, y, count, 1, data, SM_BITMAP_FORMAT_RGB24);
+        data += count * 3;
+        numPixels -= count;
+        y++;
+    }
+
+    if(numPixels >= width) {
+        uint16_t rows = numPixels / width;
+        layer->drawBitmap(0, y, width, rows, data, SM_BITMAP_FORMAT_RGB24);
+        data += (uint32_t)rows * width * 3;
+        numPixels -= (uint32_t)rows * width;
+        y += rows;
+    }
+
+    if(numPixels)
+        layer->drawBitmap(0, y, numPixels, 1, data, SM_BITMAP_FORMAT_RGB24);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMNetworkFrameReceiver<RGB, optionFlags>::swapFrame(void) {
+    layer->swapBuffers(copyOnSwap);
+    stats.frames++;
+}
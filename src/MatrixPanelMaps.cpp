@@ -25,13 +25,13 @@
 #include "MatrixPanelMaps.h"
 
 // use this for all linear panels (e.g. panels that draw a single left-to-right line for each RGB channel)
-const PanelMappingEntry defaultPanelMap[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM defaultPanelMap[] =
 {
     {0, 0, DEFAULT_PANEL_WIDTH_FOR_LINEAR_PANELS},
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap32x16Mod2[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod2[] =
 {
     {0, 71,  -8},
     {0, 87,  -8},
@@ -52,7 +52,7 @@ const PanelMappingEntry panelMap32x16Mod2[] =
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMapHub12_32x16Mod4[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMapHub12_32x16Mod4[] =
 {
     {0,  24,  8},
     {0,  56,  8},
@@ -73,7 +73,7 @@ const PanelMappingEntry panelMapHub12_32x16Mod4[] =
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap32x16Mod4[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod4[] =
 {
     {0, 0,  8},
     {0, 16, 8},
@@ -86,7 +86,7 @@ const PanelMappingEntry panelMap32x16Mod4[] =
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap32x16Mod4V2[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod4V2[] =
 {
     {0, 15, -8},
     {0, 31, -8},
@@ -99,7 +99,7 @@ const PanelMappingEntry panelMap32x16Mod4V2[] =
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap32x16Mod4V3[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod4V3[] =
 {
     {0, 8, 8},
     {0, 24, 8},
@@ -112,14 +112,14 @@ const PanelMappingEntry panelMap32x16Mod4V3[] =
     {0, 0, 0} // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap64x32Mod8[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap64x32Mod8[] =
 {
     {0, 64, 64},
     {8, 0, 64},
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap64x64Mod16[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap64x64Mod16[] =
 {
 {0,64,64},
 {16,0,64},
@@ -127,7 +127,7 @@ const PanelMappingEntry panelMap64x64Mod16[] =
 };
 
 // Applied patch from https://community.pixelmatix.com/t/mapping-assistance-32x16-p10/889/23 not fully integrated (ESP32 only)
-const PanelMappingEntry panelMap32x16Mod4V4[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod4V4[] =
 {
     {0, 7, -8},
     {0, 23, -8},
@@ -140,7 +140,7 @@ const PanelMappingEntry panelMap32x16Mod4V4[] =
     {0, 0, 0}   // last entry is all zeros
 };
 
-const PanelMappingEntry panelMap32x16Mod2V2[] =
+const PanelMappingEntry SM_FLASH_SAFE_DRAM panelMap32x16Mod2V2[] =
 {
     {0, 31, -8},
     {0, 63, -8},
@@ -0,0 +1,301 @@
+/*
+ * SmartMatrix Library - Refresh Pipeline Profiling
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_PROFILING_H_
+#define _MATRIX_PROFILING_H_
+
+#include <stdint.h>
+
+// Define SM_PROFILING_ENABLED as 1 before including SmartMatrix.h to record CPU cycles spent in each stage of the matrix calculations
+// Disabled by default, the SM_PROFILE_* macros compile to nothing and getProfilingStats() returns empty stats
+#ifndef SM_PROFILING_ENABLED
+#define SM_PROFILING_ENABLED    0
+#endif
+
+// layers past this are counted in the last entry
+#define SM_PROFILING_MAX_LAYERS     4
+
+typedef struct smProfilingStage {
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t count;
+
+    smProfilingStage() { reset(); }
+
+    void reset(void) {
+        minCycles = 0xFFFFFFFF;
+        maxCycles = 0;
+        totalCycles = 0;
+        count = 0;
+    }
+
+    void add(uint32_t cycles) {
+        if(cycles < minCycles) minCycles = cycles;
+        if(cycles > maxCycles) maxCycles = cycles;
+        totalCycles += cycles;
+        count++;
+    }
+
+    uint32_t avgCycles(void) const {
+        return count ? (uint32_t)(totalCycles / count) : 0;
+    }
+} smProfilingStage;
+
+// bucket i counts latencies under (SM_LATENCY_BUCKET0_MICROS << i), the last bucket counts everything longer
+#define SM_LATENCY_BUCKETS          12
+#define SM_LATENCY_BUCKET0_MICROS   128
+
+typedef struct smLatencyHistogram {
+    uint32_t buckets[SM_LATENCY_BUCKETS];
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint64_t totalMicros;
+    uint32_t count;
+
+    smLatencyHistogram() { reset(); }
+
+    void reset(void) {
+        for(int i=0; i<SM_LATENCY_BUCKETS; i++)
+            buckets[i] = 0;
+        minMicros = 0xFFFFFFFF;
+        maxMicros = 0;
+        totalMicros = 0;
+        count = 0;
+    }
+
+    void add(uint32_t latencyMicros) {
+        int i = 0;
+        while(i < SM_LATENCY_BUCKETS - 1 && latencyMicros >= ((uint32_t)SM_LATENCY_BUCKET0_MICROS << i))
+            i++;
+        buckets[i]++;
+        if(latencyMicros < minMicros) minMicros = latencyMicros;
+        if(latencyMicros > maxMicros) maxMicros = latencyMicros;
+        totalMicros += latencyMicros;
+        count++;
+    }
+
+    uint32_t avgMicros(void) const {
+        return count ? (uint32_t)(totalMicros / count) : 0;
+    }
+
+    // upper limit of bucket i, 0 for the last bucket which has none
+    static uint32_t bucketLimitMicros(int i) {
+        return (i < SM_LATENCY_BUCKETS - 1) ? ((uint32_t)SM_LATENCY_BUCKET0_MICROS << i) : 0;
+    }
+} smLatencyHistogram;
+
+typedef struct smProfilingStats {
+    smProfilingStage layerFill[SM_PROFILING_MAX_LAYERS];    // fillRefreshRow() for one layer, all panel stacks in a refresh row
+    smProfilingStage bitplanePacking;                       // converting a refresh row of pixels to bitplane data
+    smProfilingStage bufferCopy;                            // copying an unchanged refresh row from the previous frame (ESP32)
+    smProfilingStage bufferWrite;                           // handing a finished row (Teensy 4) or frame (ESP32) to the refresh class
+    smProfilingStage waitForFreeBuffer;                     // calc task blocked waiting for refresh to free a frame buffer (ESP32)
+    uint32_t dmaUnderruns;
+    // time from a layer's swapBuffers() to the refresh picking up the new buffer, to the first row of that frame being packed (Teensy 4),
+    // and to the refresh starting to shift that row out to the panel (Teensy 4)
+    smLatencyHistogram swapToPickup;
+    smLatencyHistogram swapToFirstRowPacked;
+    smLatencyHistogram swapToFirstRowShift;
+
+    smProfilingStats() : dmaUnderruns(0) {}
+
+    void reset(void) {
+        for(int i=0; i<SM_PROFILING_MAX_LAYERS; i++)
+            layerFill[i].reset();
+        bitplanePacking.reset();
+        bufferCopy.reset();
+        bufferWrite.reset();
+        waitForFreeBuffer.reset();
+        dmaUnderruns = 0;
+        swapToPickup.reset();
+        swapToFirstRowPacked.reset();
+        swapToFirstRowShift.reset();
+    }
+} smProfilingStats;
+
+// Define SM_ISR_TRACE_ENABLED as 1 before including SmartMatrix.h to log refresh ISR entry and exit to a ring in RAM, with the row (or
+// frame) buffer fill level and underruns, for finding other interrupts that delay the refresh.  Disabled by default, SM_TRACE_ISR()
+// then compiles to nothing and getIsrTrace() returns no entries
+#ifndef SM_ISR_TRACE_ENABLED
+#define SM_ISR_TRACE_ENABLED    0
+#endif
+
+// entries kept in the ring, a power of two
+#ifndef SM_ISR_TRACE_ENTRIES
+#define SM_ISR_TRACE_ENTRIES    256
+#endif
+
+// traced ISRs: the Teensy row shift ISR (rowShiftCompleteISR, or the first bitplane of each row in the Teensy LC's rowBitShiftCompleteISR),
+// the Teensy rowCalculationISR, and the ESP32 shift complete callback (once per frame)
+#define SM_ISR_TRACE_ROW_SHIFT      0
+#define SM_ISR_TRACE_ROW_CALC       1
+#define SM_ISR_TRACE_FRAME_SHIFT    2
+#define SM_ISR_TRACE_SOURCES        3
+
+#define SM_ISR_TRACE_ENTRY          0
+#define SM_ISR_TRACE_EXIT           1
+#define SM_ISR_TRACE_UNDERRUN       2
+
+// fill levels counted in smIsrTraceSummary::fillLevels, the last entry counts higher levels as well
+#define SM_ISR_TRACE_FILL_LEVELS    16
+
+typedef struct smIsrTraceEntry {
+    uint32_t cycles;
+    uint8_t source;
+    uint8_t event;
+    // rows (Teensy) or frames (ESP32) queued for the refresh when the event was logged, including the one being shown
+    uint8_t fillLevel;
+} smIsrTraceEntry;
+
+typedef struct smIsrTraceSource {
+    uint32_t count;
+    uint32_t maxDurationCycles;
+    uint64_t totalDurationCycles;
+    // cycles between entries, the jitter is maxIntervalCycles - minIntervalCycles
+    uint32_t minIntervalCycles;
+    uint32_t maxIntervalCycles;
+    uint32_t lastEntryCycles;
+
+    uint32_t avgDurationCycles(void) const {
+        return count ? (uint32_t)(totalDurationCycles / count) : 0;
+    }
+} smIsrTraceSource;
+
+typedef struct smIsrTraceSummary {
+    smIsrTraceSource sources[SM_ISR_TRACE_SOURCES];
+    // fill level when each row or frame shift started
+    uint32_t fillLevels[SM_ISR_TRACE_FILL_LEVELS];
+    uint32_t underruns;
+} smIsrTraceSummary;
+
+// one trace for the program, written by the refresh ISRs through SM_TRACE_ISR(), no constructor so it's zeroed before any ISR runs
+typedef struct smIsrTrace {
+    smIsrTraceEntry entries[SM_ISR_TRACE_ENTRIES];
+    // events logged since the last reset, the ring holds the latest SM_ISR_TRACE_ENTRIES of them
+    uint32_t eventCount;
+    smIsrTraceSummary summary;
+    uint32_t entryCycles[SM_ISR_TRACE_SOURCES];
+    // set while the sketch copies the trace, events are dropped meanwhile
+    volatile bool paused;
+
+    // inlined so it runs from RAM along with the FASTRUN/IRAM_ATTR ISRs
+    __attribute__((always_inline)) void record(uint32_t cycles, uint8_t source, uint8_t event, uint8_t fillLevel) {
+        if(paused)
+            return;
+
+        smIsrTraceEntry & entry = entries[eventCount++ & (SM_ISR_TRACE_ENTRIES - 1)];
+        entry.cycles = cycles;
+        entry.source = source;
+        entry.event = event;
+        entry.fillLevel = fillLevel;
+
+        smIsrTraceSource & stats = summary.sources[source];
+        if(event == SM_ISR_TRACE_ENTRY) {
+            if(stats.count) {
+                uint32_t interval = cycles - stats.lastEntryCycles;
+                if(stats.count == 1 || interval < stats.minIntervalCycles) stats.minIntervalCycles = interval;
+                if(interval > stats.maxIntervalCycles) stats.maxIntervalCycles = interval;
+            }
+            stats.lastEntryCycles = entryCycles[source] = cycles;
+            stats.count++;
+            if(source != SM_ISR_TRACE_ROW_CALC)
+                summary.fillLevels[(fillLevel < SM_ISR_TRACE_FILL_LEVELS) ? fillLevel : SM_ISR_TRACE_FILL_LEVELS - 1]++;
+        } else if(event == SM_ISR_TRACE_EXIT) {
+            uint32_t duration = cycles - entryCycles[source];
+            if(duration > stats.maxDurationCycles) stats.maxDurationCycles = duration;
+            stats.totalDurationCycles += duration;
+        } else {
+            summary.underruns++;
+        }
+    }
+
+    // copies up to maxEntries of the latest events, oldest first, and returns the number copied
+    int copy(smIsrTraceEntry * out, int maxEntries) {
+        paused = true;
+        uint32_t available = (eventCount < SM_ISR_TRACE_ENTRIES) ? eventCount : SM_ISR_TRACE_ENTRIES;
+        if((uint32_t)maxEntries < available)
+            available = maxEntries;
+        for(uint32_t i = 0; i < available; i++)
+            out[i] = entries[(eventCount - available + i) & (SM_ISR_TRACE_ENTRIES - 1)];
+        paused = false;
+        return available;
+    }
+
+    void getSummary(smIsrTraceSummary & out) {
+        paused = true;
+        out = summary;
+        paused = false;
+    }
+
+    void reset(void) {
+        paused = true;
+        eventCount = 0;
+        summary = smIsrTraceSummary();
+        paused = false;
+    }
+} smIsrTrace;
+
+inline smIsrTrace & smGetIsrTrace(void) {
+    static smIsrTrace trace;
+    return trace;
+}
+
+#if (SM_ISR_TRACE_ENABLED == 1)
+    #if defined(ESP32)
+        #define SM_TRACE_GET_CYCLES()       ESP.getCycleCount()
+    #elif defined(KINETISL)
+        // no cycle counter on the Teensy LC
+        #define SM_TRACE_GET_CYCLES()       micros()
+    #else
+        #define SM_TRACE_GET_CYCLES()       ARM_DWT_CYCCNT
+    #endif
+
+    #define SM_TRACE_ISR(source, event, fillLevel)  smGetIsrTrace().record(SM_TRACE_GET_CYCLES(), source, event, fillLevel)
+#else
+    #define SM_TRACE_ISR(source, event, fillLevel)  do {} while(0)
+#endif
+
+#if (SM_PROFILING_ENABLED == 1)
+    #if defined(ESP32)
+        // cycle counter of the core the calc task runs on
+        #define SM_PROFILE_GET_CYCLES()     ESP.getCycleCount()
+    #else
+        #define SM_PROFILE_GET_CYCLES()     ARM_DWT_CYCCNT
+    #endif
+
+    #define SM_PROFILE_START(name)          uint32_t name = SM_PROFILE_GET_CYCLES()
+    #define SM_PROFILE_END(name, stage)     (stage).add(SM_PROFILE_GET_CYCLES() - name)
+    #define SM_PROFILE_COUNT(counter)       (counter)++
+    // swap latency timestamps, see SM_Layer::getSwapLatencyMicros()
+    #define SM_PROFILE_SWAP_REQUESTED()     recordSwapRequested()
+    #define SM_PROFILE_SWAP_PICKED_UP()     recordSwapPickedUp()
+#else
+    #define SM_PROFILE_START(name)          do {} while(0)
+    #define SM_PROFILE_END(name, stage)     do {} while(0)
+    #define SM_PROFILE_COUNT(counter)       do {} while(0)
+    #define SM_PROFILE_SWAP_REQUESTED()     do {} while(0)
+    #define SM_PROFILE_SWAP_PICKED_UP()     do {} while(0)
+#endif
+
+#endif
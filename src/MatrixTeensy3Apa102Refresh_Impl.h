@@ -28,9 +28,9 @@
 #define INLINE __attribute__( ( always_inline ) ) inline
 
 #if defined(KINETISL)
-    #define ROW_CALCULATION_ISR_PRIORITY   192   // Cortex-M0 Acceptable values: 0,64,128,192
+    #define APA_ROW_CALCULATION_ISR_PRIORITY   192   // Cortex-M0 Acceptable values: 0,64,128,192
 #elif defined(KINETISK)
-    #define ROW_CALCULATION_ISR_PRIORITY   240 // M4 acceptable values: 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224,240
+    #define APA_ROW_CALCULATION_ISR_PRIORITY   240 // M4 acceptable values: 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224,240
 #endif
 
 //#define USE_INTERVALTIMER_NOT_FTM
@@ -186,7 +186,7 @@ void SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType
     dmaClockOutDataApa.triggerAtHardwareEvent(DMAMUX_SOURCE_SPI0_TX);
     dmaClockOutDataApa.attachInterrupt(apaRowCalculationISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
     dmaClockOutDataApa.interruptAtCompletion();
-    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + dmaClockOutDataApa.channel, ROW_CALCULATION_ISR_PRIORITY);
+    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + dmaClockOutDataApa.channel, APA_ROW_CALCULATION_ISR_PRIORITY);
 
 #ifndef USE_INTERVALTIMER_NOT_FTM
     // setup FTM2
@@ -249,19 +249,25 @@ void apaRowShiftCompleteISR(void) {
     // TODO: if underrun
         // set flag so other ISR can enable DMA again when data is ready
         //SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = true;
-    // else, start SPI
-    SPI.endTransaction();
-
-    // disable SPI interrupts
-    SPI0_RSER = 0;
-    // clear flags
-    SPI0_SR = SPI_SR_TCF | SPI_SR_EOQF | SPI_SR_TFUF | SPI_SR_TFFF | SPI_SR_RFOF | SPI_SR_RFDF;
-    dmaClockOutDataApa.sourceBuffer(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].data,
-        ((matrixWidth * matrixHeight)*4) + (4+4));
-    // Enable Transmit Fill DMA Requests
-    SPI0_RSER = SPI_RSER_TFFF_RE | SPI_RSER_TFFF_DIRS;
-    SPI.beginTransaction(SPISettings(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::spiClockSpeed, MSBFIRST, SPI_MODE0));
-    dmaClockOutDataApa.enable();
+
+    // unchanged frame: the LEDs keep the last frame sent, run the calc ISR as if the transfer had completed
+    if(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].repeatFrame) {
+        NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaClockOutDataApa.channel);
+    } else {
+        // start SPI
+        SPI.endTransaction();
+
+        // disable SPI interrupts
+        SPI0_RSER = 0;
+        // clear flags
+        SPI0_SR = SPI_SR_TCF | SPI_SR_EOQF | SPI_SR_TFUF | SPI_SR_TFFF | SPI_SR_RFOF | SPI_SR_RFDF;
+        dmaClockOutDataApa.sourceBuffer(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].data,
+            ((matrixWidth * matrixHeight)*4) + (4+4));
+        // Enable Transmit Fill DMA Requests
+        SPI0_RSER = SPI_RSER_TFFF_RE | SPI_RSER_TFFF_DIRS;
+        SPI.beginTransaction(SPISettings(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::spiClockSpeed, MSBFIRST, SPI_MODE0));
+        dmaClockOutDataApa.enable();
+    }
 
 #ifndef USE_INTERVALTIMER_NOT_FTM
     // clear timer overflow bit before leaving ISR
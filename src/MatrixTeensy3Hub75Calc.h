@@ -33,10 +33,27 @@ public:
     SmartMatrixHub75Calc(uint8_t bufferrows, rowDataStruct * rowDataBuffer);
     void begin(void);
     void addLayer(SM_Layer * newlayer);
+    // layers can be changed while refreshing, refresh picks up the new set at the start of the next frame, see smLayerChain
+    void removeLayer(SM_Layer * layer);
+    // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+    void moveLayer(SM_Layer * layer, SM_Layer * belowLayer);
+    void setLayerVisible(SM_Layer * layer, bool visible);
 
     // configuration
     void setRotation(rotationDegrees rotation);
     void setBrightness(uint8_t newBrightness);
+    // fades the global brightness from its current value to targetBrightness, stepped by the calc each refresh frame
+    // setBrightness() cancels a running fade
+    void fadeBrightness(uint8_t targetBrightness, uint16_t durationMs);
+    // economy mode for OTA updates and network bursts: layers only advance to a new frame every updateIntervalMs (0 = frozen, a
+    // swapBuffers() waits until economy mode ends), and the refresh rate drops to SM_ECONOMY_MODE_REFRESH_RATE, as Teensy still
+    // packs every row each refresh frame
+    void setEconomyMode(bool enabled, uint16_t updateIntervalMs = 0);
+    bool getEconomyMode(void);
+    // per-panel calibration for panels that don't match in brightness or white point: the channels of the panel panelColumn across
+    // and panelRow down (COLS_PER_PANEL x MATRIX_PANEL_HEIGHT panels, in hardware orientation) are scaled by gain, 255 = no change
+    void setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain);
+    void clearPanelGains(void);
     void setRefreshRate(uint8_t newRefreshRate);
 
     // get info
@@ -44,10 +61,36 @@ public:
     uint16_t getScreenHeight(void) const;
     uint8_t getRefreshRate(void);
     bool getdmaBufferUnderrunFlag(void);
+    // depth chosen with SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER, and the underruns and latency spikes that changed it
+    void getRowBufferState(smRowBufferGovernor & state);
     bool getRefreshRateLoweredFlag(void);
 
+    // frame events, a frame is counted each time the layers get their frameRefreshCallback()
+    void setFrameCallback(smFrameCallback callback);
+    uint32_t getFrameCount(void);
+    // readback tap for screenshots, see smReadbackTap: every intervalFrames-th frame is copied into buffer as the rows are filled,
+    // buffer holds SM_READBACK_BUFFER_PIXELS(matrixWidth, matrixHeight, scaleShift) pixels, NULL stops the copies
+    void setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift = 0, uint16_t intervalFrames = 1);
+    // frames fully copied to the readback buffer, a change means it holds a complete frame
+    uint32_t getReadbackFrameCount(void);
+    // sleeps until the next frame starts (a pending swapBuffers() has been taken), returns false after timeoutMs
+    bool waitForFrame(uint32_t timeoutMs);
+    // multi-controller frame sync, see smFrameSync: the master pulses an output pin at every frame start (-1 to stop), the
+    // others hold their frames for a pulse on an input pin, or for frameSyncPulse() calls from a network sync message
+    void setFrameSyncOutput(int8_t pin);
+    void setFrameSyncInput(int8_t pin);
+    void frameSyncPulse(void);
+    // microseconds this board's last frame started after the master's pulse, and frames lost to falling behind the master
+    int32_t getFrameSyncDrift(void);
+    uint32_t getFrameSyncMissedPulses(void);
+
     // debug
     void countFPS(void);
+    // refresh ISR trace, empty unless SM_ISR_TRACE_ENABLED is 1: copies up to maxEntries of the latest events oldest first, returns the number copied
+    int getIsrTrace(smIsrTraceEntry * entries, int maxEntries);
+    // per ISR counts, durations and entry intervals, with the buffer fill level histogram and underrun count
+    void getIsrTraceSummary(smIsrTraceSummary & summary);
+    void resetIsrTrace(void);
 
     // functions called by ISR
     static void matrixCalculations(bool initial);
@@ -55,6 +98,7 @@ public:
 
 private:
     static SM_Layer * baseLayer;
+    static smLayerChain layerChain;
 
     // functions for refreshing
     static void loadMatrixBuffers(unsigned char currentRow);
@@ -71,13 +115,28 @@ private:
     // configuration
     static volatile bool brightnessChange;
     static volatile bool rotationChange;
+    static smFrameEvents frameEvents;
+    static smFrameSync frameSync;
     static volatile bool dmaBufferUnderrun;
     static int brightness;
+    // fade requested by fadeBrightness(), started by the calc at the next frame
+    static volatile bool brightnessFadeStart;
+    static uint8_t brightnessFadeTarget;
+    static uint16_t brightnessFadeDurationMs;
+    static smBrightnessFade brightnessFade;
+    static smEconomyMode economyMode;
+    static smReadbackTap readbackTap;
+    // setPanelGain() table, only applied while enabled
+    static rgb24 panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+    static volatile bool panelGainsEnabled;
+    static smRowBufferGovernor rowBufferGovernor;
     static rotationDegrees rotation;
     static uint8_t calc_refreshRate;   
     static bool dmaBufferUnderrunSinceLastCheck;
     static bool refreshRateLowered;
     static bool refreshRateChanged;
+    // counts refresh frames, selecting the dither pattern position with SM_HUB75_OPTIONS_TEMPORAL_DITHER
+    static unsigned int ditherFrame;
 
     static int multiRowRefresh_mapIndex_CurrentRowGroups;
     static int multiRowRefresh_mapIndex_CurrentPixelGroup;
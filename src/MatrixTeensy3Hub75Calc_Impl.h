@@ -29,6 +29,8 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calc_refreshRate = 120;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SM_Layer * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smLayerChain SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::layerChain;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
@@ -42,6 +44,8 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 // set to true initially so all layers get the initial refresh rate
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRateChanged = true;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+unsigned int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrame = 0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
@@ -57,18 +61,27 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Calc(uint8_t bufferrows, rowDataStruct * rowDataBuffer) {
+    rowBufferGovernor.begin(bufferrows);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addLayer(SM_Layer * newlayer) {
-    if(baseLayer) {
-        SM_Layer * templayer = baseLayer;
-        while(templayer->nextLayer)
-            templayer = templayer->nextLayer;
-        templayer->nextLayer = newlayer;
-    } else {
-        baseLayer = newlayer;
-    }
+    layerChain.add(newlayer, rotation);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::removeLayer(SM_Layer * layer) {
+    layerChain.remove(layer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::moveLayer(SM_Layer * layer, SM_Layer * belowLayer) {
+    layerChain.move(layer, belowLayer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setLayerVisible(SM_Layer * layer, bool visible) {
+    layerChain.setVisible(layer, visible);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -90,6 +103,71 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
   }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTrace(smIsrTraceEntry * entries, int maxEntries) {
+    return smGetIsrTrace().copy(entries, maxEntries);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTraceSummary(smIsrTraceSummary & summary) {
+    smGetIsrTrace().getSummary(summary);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetIsrTrace(void) {
+    smGetIsrTrace().reset();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameCallback(smFrameCallback callback) {
+    frameEvents.callback = callback;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameCount(void) {
+    return frameEvents.frameCount;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForFrame(uint32_t timeoutMs) {
+    return frameEvents.wait(timeoutMs);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift, uint16_t intervalFrames) {
+    readbackTap.setBuffer(buffer, matrixWidth, scaleShift, intervalFrames);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getReadbackFrameCount(void) {
+    return readbackTap.framesCaptured;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncOutput(int8_t pin) {
+    frameSync.setOutput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncInput(int8_t pin) {
+    frameSync.setInput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSyncPulse(void) {
+    frameSync.pulse();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncDrift(void) {
+    return frameSync.drift;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncMissedPulses(void) {
+    return frameSync.missedPulses;
+}
+
 #define MAX_MATRIXCALCULATIONS_LOOPS_WITHOUT_EXIT  5
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -102,6 +180,10 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     static unsigned char currentRow = 0;
     unsigned char numLoopsWithoutExit = 0;
 
+    // rows left when the ISR gets to run show how close the last refill came to an underrun
+    if ((optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER) && !initial)
+        SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.rowsQueued(SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferQueuedRows()));
+
     // only run the loop if there is free space, and fill the entire buffer before returning
     while (SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isRowBufferFree()) {
         // check to see if the refresh rate is too high, and the application doesn't have time to run
@@ -121,6 +203,13 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
         // do once-per-frame updates
         if (!currentRow) {
+            if (optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER)
+                SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.frame());
+            // layers added, removed, moved or hidden since the last frame are picked up here, and need the per-frame setup
+            if (layerChain.publish(baseLayer)) {
+                rotationChange = true;
+                refreshRateChanged = true;
+            }
             if (rotationChange) {
                 SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                 while(templayer) {
@@ -130,19 +219,38 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
                 rotationChange = false;
             }
 
-            SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-            while(templayer) {
-                if(refreshRateChanged) {
-                    templayer->setRefreshRate(calc_refreshRate);
+            // with frame sync following a master, layers only advance to a new frame on the master's pulse (or a timeout), and in
+            // economy mode only every economy interval
+            if (economyMode.frameDue(millis()) && frameSync.frameStart()) {
+                SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+                while(templayer) {
+                    if(refreshRateChanged) {
+                        templayer->setRefreshRate(calc_refreshRate);
+                    }
+                    templayer->frameRefreshCallback();
+                    templayer = templayer->nextLayer;
                 }
-                templayer->frameRefreshCallback();
-                templayer = templayer->nextLayer;
+                refreshRateChanged = false;
+                frameEvents.signal();
+            }
+            // a setBrightness() since the last frame cancels a running fade, fade steps only rewrite the timer LUT
+            if (brightnessFadeStart) {
+                brightnessFadeStart = false;
+                brightnessFade.start(brightness, brightnessFadeTarget, ((uint32_t)brightnessFadeDurationMs * calc_refreshRate) / 1000);
+            } else if (brightnessChange) {
+                brightnessFade.stop();
+            }
+            if (brightnessFade.isRunning()) {
+                brightness = brightnessFade.step();
+                brightnessChange = true;
             }
-            refreshRateChanged = false;
             if (brightnessChange) {
                 SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(brightness);
                 brightnessChange = false;
             }
+            if (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)
+                ditherFrame++;
+            readbackTap.startFrame();
         }
 
         // do once-per-line updates
@@ -156,8 +264,11 @@ void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
             currentRow = 0;
 
         if(dmaBufferUnderrun) {
-            // if refreshrate is too high, lower - minimum set to avoid overflowing timer at low refresh rates
-            if(calc_refreshRate > MIN_REFRESH_RATE) {
+            // an adaptive row buffer grows first, the refresh rate is only lowered once all rows are in use
+            if((optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER) && rowBufferGovernor.depth < rowBufferGovernor.maxDepth) {
+                SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.underrun());
+            } else if(calc_refreshRate > MIN_REFRESH_RATE) {
+                // if refreshrate is too high, lower - minimum set to avoid overflowing timer at low refresh rates
                 calc_refreshRate--;
                 SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(calc_refreshRate);
                 refreshRateLowered = true;
@@ -200,17 +311,90 @@ volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, pane
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotationChange = true;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameEvents SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameEvents;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameSync SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSync;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeStart = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeTarget;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeDurationMs;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smBrightnessFade SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFade;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smEconomyMode SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::economyMode;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smReadbackTap SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::readbackTap;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+rgb24 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGainsEnabled = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smRowBufferGovernor SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBufferGovernor;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
+    brightnessFadeStart = false;
     brightness = newBrightness;
     brightnessChange = true;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::fadeBrightness(uint8_t targetBrightness, uint16_t durationMs) {
+    brightnessFadeTarget = targetBrightness;
+    brightnessFadeDurationMs = durationMs;
+    brightnessFadeStart = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setEconomyMode(bool enabled, uint16_t updateIntervalMs) {
+    economyMode.intervalMs = updateIntervalMs;
+    economyMode.lastUpdateMillis = millis();
+    if (enabled == economyMode.enabled)
+        return;
+
+    // the lower refresh rate is what saves CPU on Teensy, the rows are packed from the layers every refresh frame regardless
+    if (enabled) {
+        economyMode.savedRefreshRate = calc_refreshRate;
+        if (calc_refreshRate > SM_ECONOMY_MODE_REFRESH_RATE)
+            setRefreshRate(SM_ECONOMY_MODE_REFRESH_RATE);
+    } else {
+        setRefreshRate(economyMode.savedRefreshRate);
+    }
+    economyMode.enabled = enabled;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getEconomyMode(void) {
+    return economyMode.enabled;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain) {
+    if(panelColumn >= PANEL_GAIN_COLUMNS || panelRow >= PANEL_GAIN_ROWS)
+        return;
+
+    if(!panelGainsEnabled) {
+        for(int y = 0; y < PANEL_GAIN_ROWS; y++) {
+            for(int x = 0; x < PANEL_GAIN_COLUMNS; x++)
+                panelGains[y][x] = rgb24(255, 255, 255);
+        }
+    }
+    panelGains[panelRow][panelColumn] = gain;
+    panelGainsEnabled = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelGains(void) {
+    panelGainsEnabled = false;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(uint8_t newRefreshRate) {
     if(newRefreshRate > MIN_REFRESH_RATE)
@@ -235,6 +419,11 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
     return false;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferState(smRowBufferGovernor & state) {
+    state = rowBufferGovernor;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRateLoweredFlag(void) {
     if(refreshRateLowered) {
@@ -247,11 +436,10 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(void)
 {
-    SM_Layer * templayer = baseLayer;
-    while(templayer) {
-        templayer->begin();
-        templayer = templayer->nextLayer;
-    }
+    frameEvents.begin();
+
+    layerChain.begin();
+    layerChain.publish(baseLayer);
 
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculations);
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixUnderrunCallback(dmaBufferUnderrunCallback);
@@ -362,9 +550,11 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
 
     // go through this process for each physical row that is contained in the refresh row
     do {
-        // clear buffer to prevent garbage data showing through transparent layers
-        memset(tempRow0, 0x00, sizeof(tempRow0));
-        memset(tempRow1, 0x00, sizeof(tempRow1));
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        if (!baseLayer || !baseLayer->isLayerOpaque()) {
+            memset(tempRow0, 0x00, sizeof(tempRow0));
+            memset(tempRow1, 0x00, sizeof(tempRow1));
+        }
 
         // get pixel data from layers
         SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
@@ -416,12 +606,30 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
                         y0 = y1 + ROW_PAIR_OFFSET;
                     }
                 }
-                templayer->fillRefreshRow(y0, &tempRow0[i * matrixWidth]);
-                templayer->fillRefreshRow(y1, &tempRow1[i * matrixWidth]);
+                templayer->fillCoveredRefreshRow(y0, &tempRow0[i * matrixWidth]);
+                templayer->fillCoveredRefreshRow(y1, &tempRow1[i * matrixWidth]);
+
+                // the composited rows once the last layer is in, before dithering
+                if (readbackTap.capturing && !templayer->nextLayer) {
+                    readbackTap.captureRow(y0, &tempRow0[i * matrixWidth]);
+                    readbackTap.captureRow(y1, &tempRow1[i * matrixWidth]);
+                }
+                // per-panel calibration, y0 and y1 are always on the same panel
+                if (panelGainsEnabled && !templayer->nextLayer) {
+                    applyPanelGains(&tempRow0[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[y0 / MATRIX_PANEL_HEIGHT]);
+                    applyPanelGains(&tempRow1[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[y0 / MATRIX_PANEL_HEIGHT]);
+                }
             }
             templayer = templayer->nextLayer;        
         }
 
+        // dithering always uses rgb48 temp rows, see loadMatrixBuffers()
+        if((optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) && sizeof(RGB_TEMP) > 3) {
+            // tempRow1 is offset from tempRow0 in the pattern so the two halves of the panel don't dither in lockstep
+            ditherRGB((rgb48 *)tempRow0, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset, ditherFrame, COLOR_DEPTH_BITS);
+            ditherRGB((rgb48 *)tempRow1, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 2, ditherFrame, COLOR_DEPTH_BITS);
+        }
+
         union {
             uint8_t word;
             struct {
@@ -573,7 +781,8 @@ INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelT
     rowDataStruct * currentRowDataPtr = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferPtr();
 
     // same function supports any refresh depth up to 48, choose between rgb24 and rgb48 for temporary storage to save RAM
-    if(COLOR_DEPTH_BITS <= 8)
+    // dithering needs the bits below the refresh depth, so always uses rgb48
+    if(COLOR_DEPTH_BITS <= 8 && !(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER))
         loadMatrixBuffers48(currentRowDataPtr, currentRow, rgb24(0,0,0));
     else
         loadMatrixBuffers48(currentRowDataPtr, currentRow, rgb48(0,0,0));
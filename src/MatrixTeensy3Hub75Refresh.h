@@ -70,6 +70,10 @@ public:
     static void writeRowBuffer(uint8_t currentRow);
     static void recoverFromDmaUnderrun(void);
     static bool isRowBufferFree(void);
+    // rows the calc fills ahead, 2 up to the buffer_rows allocated
+    static void setRowBufferDepth(uint8_t rows);
+    // rows ready for refresh, including the one being shown
+    static uint8_t getRowBufferQueuedRows(void);
     static void setRefreshRate(uint8_t newRefreshRate);
     static void setBrightness(uint8_t newBrightness);
     static void setMatrixCalculationsCallback(matrix_calc_callback f);
@@ -96,6 +100,7 @@ private:
     static uint16_t rowBitStructBytesToShift;
     static uint8_t refreshRate;
     static uint8_t dmaBufferNumRows;
+    static volatile uint8_t dmaBufferDepth;
     static rowDataStruct * matrixUpdateRows;
 
     static timerpair timerLUT[LATCHES_PER_ROW];
@@ -29,7 +29,8 @@
 #if defined(KINETISL)
     #define ROW_CALCULATION_ISR_PRIORITY   192   // Cortex-M0 Acceptable values: 0,64,128,192
 #elif defined(KINETISK)
-    #define ROW_CALCULATION_ISR_PRIORITY   240 // M4 acceptable values: 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224,240
+    // one step above the APA102 calc, so with both on one Teensy a HUB75 row isn't held up behind a whole APA102 frame
+    #define ROW_CALCULATION_ISR_PRIORITY   224 // M4 acceptable values: 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224,240
 #endif
 
 // hardware-specific definitions
@@ -86,6 +87,8 @@ CircularBuffer_SM SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeigh
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferNumRows;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferDepth;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRate = 120;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -133,6 +136,7 @@ typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelT
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Refresh(uint8_t bufferrows, rowDataStruct * rowDataBuffer) {
     dmaBufferNumRows = bufferrows;
+    dmaBufferDepth = bufferrows;
 
     matrixUpdateRows = rowDataBuffer;
 
@@ -142,12 +146,22 @@ SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, opti
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isRowBufferFree(void) {
-    if(cbIsFull(&dmaBuffer))
+    if(cbIsFull(&dmaBuffer) || dmaBuffer.count >= dmaBufferDepth)
         return false;
     else
         return true;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(uint8_t rows) {
+    dmaBufferDepth = constrain(rows, 2, dmaBufferNumRows);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferQueuedRows(void) {
+    return dmaBuffer.count;
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct * SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferPtr(void) {
     return &(matrixUpdateRows[cbGetNextWrite(&dmaBuffer)]);
@@ -299,6 +313,12 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 void SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(void) {
     cbInit(&dmaBuffer, dmaBufferNumRows);
 
+#if (SM_ISR_TRACE_ENABLED == 1) && defined(KINETISK)
+    // start the cycle counter used to stamp the ISR trace
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+
 #ifndef ADDX_UPDATE_ON_DATA_PINS
     int i;
     // fill addressLUT
@@ -681,22 +701,34 @@ void rowCalculationISR(void) {
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_2, HIGH); // oscilloscope trigger
 #endif
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_ENTRY, SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
 
     SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalcCallback(false);
 
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_EXIT, SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_2, LOW);
 #endif
 }
 
 #ifdef KINETISL
+// runs once per bitplane, the Teensy LC's DMA has no TCDs to chain the timer updates and data transfers of a row like the eDMA on Teensy 3.x,
+// so this is kept short and runs from RAM to skip the flash wait states
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-void rowBitShiftCompleteISR(void) {
+FASTRUN void rowBitShiftCompleteISR(void) {
+    typedef SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags> refresh;
     static bool alternateDmaBuffer = false;
     static int currentLatchBit = 0;
-    static int currentRow = 0;
+    // row being shown, looked up once when the row starts
+    static typename refresh::rowDataStruct * currentRowPtr = NULL;
 
+#ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
+#endif
+    // only the first bitplane of each row is traced, so the entry intervals are row periods
+    bool rowStart = (currentLatchBit == 0 || currentLatchBit >= LATCHES_PER_ROW);
+    if(rowStart)
+        SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_ENTRY, refresh::dmaBuffer.count);
 
     if(currentLatchBit >= LATCHES_PER_ROW) {
         currentLatchBit = 0;
@@ -727,6 +759,8 @@ void rowBitShiftCompleteISR(void) {
             // set flag so other ISR can enable DMA again when data is ready
             SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback();
 
+            SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_UNDERRUN, 0);
+            SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_EXIT, 0);
 #ifdef DEBUG_PINS_ENABLED
             digitalWriteFast(DEBUG_PIN_1, LOW);
 #endif
@@ -735,20 +769,21 @@ void rowBitShiftCompleteISR(void) {
 
         } else {
             // get next row to draw to display
-            currentRow = cbGetNextRead(&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
+            currentRowPtr = &refresh::matrixUpdateRows[cbGetNextRead(&refresh::dmaBuffer)];
         }
     }
 
-    FTM2_MOD = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[currentLatchBit].timerValues.timer_period;
-    FTM2_C1V = SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[currentLatchBit].timerValues.timer_oe;
+    typename refresh::rowBitStruct * bitPtr = &currentRowPtr->rowbits[currentLatchBit];
+    FTM2_MOD = bitPtr->timerValues.timer_period;
+    FTM2_C1V = bitPtr->timerValues.timer_oe;
 
     // clear Timer Overflow Flag while keeping timer running with interrupts enabled - this also clears the FTM_SC_DMA flag, so dmaClockOutData won't trigger unless we want it to (it can be set later in the ISR)
     FTM2_SC = (FTM_SC_CLKS(1) | FTM_SC_PS(LATCH_TIMER_PRESCALE)) | FTM_SC_TOIE | FTM_SC_TOF;
 
     if(!alternateDmaBuffer) {
         dmaClockOutData2.clearComplete();
-        dmaClockOutData2.CFG->SAR = (uint8_t*)&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[currentLatchBit].data[0];
-        dmaClockOutData2.transferCount(SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStructBytesToShift);
+        dmaClockOutData2.CFG->SAR = (uint8_t*)&bitPtr->data[0];
+        dmaClockOutData2.transferCount(refresh::rowBitStructBytesToShift);
         
         // enable PORTA DMA request on edge again - enabling trigger for dmaClockOutData2, now that we've passed the previous trigger we wanted to ignore
         ENABLE_LATCH_RISING_EDGE_GPIO_INT();
@@ -759,8 +794,8 @@ void rowBitShiftCompleteISR(void) {
         CORE_PIN3_CONFIG &= ~PORT_PCR_IRQC_MASK;
     
         dmaClockOutData.clearComplete();
-        dmaClockOutData.CFG->SAR = (uint8_t*)&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[currentLatchBit].data[0];
-        dmaClockOutData.transferCount(SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStructBytesToShift);
+        dmaClockOutData.CFG->SAR = (uint8_t*)&bitPtr->data[0];
+        dmaClockOutData.transferCount(refresh::rowBitStructBytesToShift);
     
         // enable DMA flag for FTM2 - enabling trigger for dmaClockOutData
         FTM2_SC |= FTM_SC_DMA;
@@ -778,7 +813,11 @@ void rowBitShiftCompleteISR(void) {
 
     currentLatchBit++;
 
+    if(rowStart)
+        SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_EXIT, refresh::dmaBuffer.count);
+#ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, LOW);
+#endif
 }
 
 #elif defined(KINETISK)
@@ -790,6 +829,8 @@ void rowShiftCompleteISR(void) {
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
 #endif
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_ENTRY, SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
+
     // done with previous row, mark it as read
     cbRead(&SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
 
@@ -808,6 +849,7 @@ void rowShiftCompleteISR(void) {
         // set flag so other ISR can enable DMA again when data is ready
         SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback();
 
+        SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_UNDERRUN, 0);
 #ifdef DEBUG_PINS_ENABLED
         digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
 #endif
@@ -827,6 +869,7 @@ void rowShiftCompleteISR(void) {
     // clear pending int
     dmaClockOutData.clearInterrupt();
 
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_EXIT, SmartMatrixHub75Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
 #endif
@@ -33,4 +33,5 @@
     #include <EventResponder.h>
     IntervalTimer myTimer;
     EventResponder apa102ShiftCompleteEvent;
+    DMAChannel apa102LaneDma(false);
 #endif
@@ -32,17 +32,27 @@
 // set to lowest priority as it is a very time consuming ISR
 #define ROW_CALC_ISR_PRIORITY       240
 
-// set to next lowest priority as it can take 10s of microseconds to complete
-#define SHIFT_COMPLETE_ISR_PRIORITY 224
+// only starts DMA on a frame already flushed from the cache by writeRowBuffer(), so it's short and can run at a high priority for steady frame timing
+#define SHIFT_COMPLETE_ISR_PRIORITY 96 // one step above USB priority
 
 extern IntervalTimer myTimer;
 extern EventResponder apa102ShiftCompleteEvent;
 extern FlexIOSPI SPIFLEX;
+extern DMAChannel apa102LaneDma;
+
+// one Teensy pin per lane, on the same FlexIO as FLEXIO_PIN_APA102_CLK, define before including SmartMatrix.h to use more than one lane
+#ifndef FLEXIO_PIN_APA102_DAT_LANES
+#define FLEXIO_PIN_APA102_DAT_LANES     { FLEXIO_PIN_APA102_DAT }
+#endif
+
+#define APA102_LANE_FLEXIO_CLOCK_HZ     480000000L
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void apaRowShiftCompleteISR(void);
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void apaRowCalculationISR(void);
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void apaLaneShiftCompleteISR(void);
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 CircularBuffer_SM SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer;
@@ -66,6 +76,9 @@ uint16_t SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panel
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameDataStruct * SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::laneBitOffsets[8];
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixAPA102Refresh(uint8_t bufferrows, frameDataStruct * frameDataBuffer) {
     dmaBufferNumRows = bufferrows;
@@ -88,6 +101,11 @@ typename SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panel
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(uint8_t currentRow) {
+    // the calc writes the frame through the cache: flush it here as the frame is finished, instead of in the ISR starting DMA
+    frameDataStruct * currentFramePtr = getNextRowBufferPtr();
+    if((uint32_t)currentFramePtr >= 0x20200000u)
+        arm_dcache_flush(currentFramePtr, sizeof(frameDataStruct));
+
     cbWrite(&dmaBuffer);
 }
 
@@ -151,22 +169,119 @@ void SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType
     digitalWriteFast(DEBUG_PIN_3, LOW);
 #endif
 
-    // completely fill buffer with data before enabling DMA
-    matrixCalcCallback(true);
+    if(APA102_NUM_LANES > 1) {
+        // sets laneBitOffsets, which the calc needs to fill the buffer, leave the LEDs alone if the pins can't be used
+        if(!beginLanes())
+            return;
 
-    // setup SPI and DMA to feed it
-    SPIFLEX.begin();
-    SPIFLEX.flexIOHandler()->setClockSettings(3, 0, 0); // not exactly sure what this does, but without it the clock seems limited to ~7.5MHz
-    SPIFLEX.beginTransaction(FlexIOSPISettings(spiClockSpeed, MSBFIRST, SPI_MODE0));
+        // completely fill buffer with data before enabling DMA
+        matrixCalcCallback(true);
+    } else {
+        // completely fill buffer with data before enabling DMA
+        matrixCalcCallback(true);
+
+        // setup SPI and DMA to feed it
+        SPIFLEX.begin();
+        SPIFLEX.flexIOHandler()->setClockSettings(3, 0, 0); // not exactly sure what this does, but without it the clock seems limited to ~7.5MHz
+        SPIFLEX.beginTransaction(FlexIOSPISettings(spiClockSpeed, MSBFIRST, SPI_MODE0));
+    }
 
     // set interrupt with low priority for long compute time ISR
     apa102ShiftCompleteEvent.attachInterrupt((EventResponderFunction)&apaRowCalculationISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>, ROW_CALC_ISR_PRIORITY);
 
-    // Give apaRowShiftCompleteISR a low priority, as it can some time (10s of microseconds) to return
     myTimer.priority(SHIFT_COMPLETE_ISR_PRIORITY);
     myTimer.begin(apaRowShiftCompleteISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>, TIME_PER_FRAME_US);
 }
 
+// FlexIOSPI only drives one data pin: for multiple lanes, one FlexIO shifter outputs APA102_LANE_BITS pins in parallel, fed 32 bits at a time by DMA
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::beginLanes(void) {
+    static const uint8_t lanePins[] = FLEXIO_PIN_APA102_DAT_LANES;
+    uint8_t clkFlexPin, laneFlexPins[8];
+    uint8_t lowestFlexPin = 0xFF;
+    uint8_t highestFlexPin = 0;
+    bool correctFlexConfig = (sizeof(lanePins) >= APA102_NUM_LANES);
+
+    FlexIOHandler * pFlex = FlexIOHandler::mapIOPinToFlexIOHandler(FLEXIO_PIN_APA102_CLK, clkFlexPin); // get FlexIO handler
+    if (!pFlex || !correctFlexConfig) {
+        Serial.println("Error: incorrect FlexIO pin configuration!");
+        return false;
+    }
+    IMXRT_FLEXIO_t * flexIO = &pFlex->port();
+
+    pFlex->setClockSettings(3, 0, 0); // 480 MHz PLL3_SW_CLK clock
+
+    // Set up pin muxes and determine FlexIO hardware pin numbers, all lanes must be on the clock's FlexIO
+    pFlex->setIOPinToFlexMode(FLEXIO_PIN_APA102_CLK);
+    for (int i = 0; i < APA102_NUM_LANES; i++) {
+        laneFlexPins[i] = pFlex->mapIOPinToFlexPin(lanePins[i]);
+        if (laneFlexPins[i] == 0xFF) {
+            correctFlexConfig = false;
+            continue;
+        }
+        pFlex->setIOPinToFlexMode(lanePins[i]);
+        lowestFlexPin = min(lowestFlexPin, laneFlexPins[i]);
+        highestFlexPin = max(highestFlexPin, laneFlexPins[i]);
+    }
+
+    // Validate that the lanes fit in the shifter's parallel width, without the clock pin in between
+    correctFlexConfig = correctFlexConfig && (highestFlexPin < lowestFlexPin + APA102_LANE_BITS) &&
+        ((clkFlexPin < lowestFlexPin) || (clkFlexPin >= lowestFlexPin + APA102_LANE_BITS));
+    if (!correctFlexConfig) {
+        Serial.println("Error: incorrect FlexIO pin configuration!");
+        return false;
+    }
+
+    for (int i = 0; i < APA102_NUM_LANES; i++)
+        laneBitOffsets[i] = laneFlexPins[i] - lowestFlexPin;
+
+    // Enable the clock
+    pFlex->hardware().clock_gate_register |= pFlex->hardware().clock_gate_mask;
+
+    // Enable FlexIO with fast register access
+    flexIO->CTRL = FLEXIO_CTRL_FLEXEN | FLEXIO_CTRL_FASTACC;
+
+    // Shifter 0 outputs APA102_LANE_BITS bits per clock, changing data on the falling edge (SPI mode 0)
+    flexIO->SHIFTCFG[0] = FLEXIO_SHIFTCFG_PWIDTH(APA102_LANE_BITS - 1) | FLEXIO_SHIFTCFG_SSTOP(0) | FLEXIO_SHIFTCFG_SSTART(0);
+    flexIO->SHIFTCTL[0] = FLEXIO_SHIFTCTL_TIMSEL(0) | FLEXIO_SHIFTCTL_TIMPOL * (1) | FLEXIO_SHIFTCTL_PINCFG(3) |
+        FLEXIO_SHIFTCTL_PINSEL(lowestFlexPin) | FLEXIO_SHIFTCTL_PINPOL * (0) | FLEXIO_SHIFTCTL_SMOD(2);
+
+    // Timer 0 generates the clock, enabled each time DMA loads the shifter and disabled after the word is shifted out
+    flexIO->TIMCFG[0] = FLEXIO_TIMCFG_TIMOUT(1) | FLEXIO_TIMCFG_TIMDEC(0) | FLEXIO_TIMCFG_TIMRST(0) | FLEXIO_TIMCFG_TIMDIS(2) |
+        FLEXIO_TIMCFG_TIMENA(2) | FLEXIO_TIMCFG_TSTOP(0) | FLEXIO_TIMCFG_TSTART * (0);
+    flexIO->TIMCTL[0] = FLEXIO_TIMCTL_TRGSEL(1) /* shifter 0 status flag */ | FLEXIO_TIMCTL_TRGPOL * (1) | FLEXIO_TIMCTL_TRGSRC * (1) | FLEXIO_TIMCTL_PINCFG(3) |
+        FLEXIO_TIMCTL_PINSEL(clkFlexPin) | FLEXIO_TIMCTL_PINPOL * (0) | FLEXIO_TIMCTL_TIMOD(1);
+
+    // Lower 8 bits set the FlexIO clock divide ratio, upper 8 bits the number of clocks per 32-bit word
+    uint32_t clockDivider = APA102_LANE_FLEXIO_CLOCK_HZ / spiClockSpeed;
+    if(clockDivider < 2)
+        clockDivider = 2;
+    if(clockDivider > 512)
+        clockDivider = 512;
+    uint8_t shiftsPerReload = 32 / APA102_LANE_BITS;
+    flexIO->TIMCMP[0] = ((shiftsPerReload * 2 - 1) << 8) | ((clockDivider / 2 - 1) << 0);
+
+    // DMA request whenever the shifter buffer is empty
+    flexIO->SHIFTSDEN |= (1 << 0);
+
+    apa102LaneDma.begin(false);
+    apa102LaneDma.disable();
+    apa102LaneDma.destination(flexIO->SHIFTBUF[0]);
+    apa102LaneDma.disableOnCompletion(); // enabled for each frame by apaRowShiftCompleteISR(), or it would transfer continuously
+    apa102LaneDma.triggerAtHardwareEvent(pFlex->hardware().shifters_dma_channel[0]);
+    apa102LaneDma.interruptAtCompletion();
+    apa102LaneDma.attachInterrupt(apaLaneShiftCompleteISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + apa102LaneDma.channel, SHIFT_COMPLETE_ISR_PRIORITY);
+    return true;
+}
+
+// multi-lane frame handed to the shifter, the event runs the calc at low priority like FlexIOSPI's completion
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void apaLaneShiftCompleteISR(void) {
+    apa102LaneDma.clearInterrupt();
+    apa102ShiftCompleteEvent.triggerEvent();
+}
+
 // low priority ISR
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void apaRowCalculationISR(void) {
@@ -191,17 +306,26 @@ void apaRowShiftCompleteISR(void) {
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
 #endif
-    int currentRow = cbGetNextRead(&SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
-
-    // TODO: if underrun
-        // set flag so other ISR can enable DMA again when data is ready
-        //SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = true;
-    // else, start SPI
-
-    // SPIFLEX.transfer calls arm_dcache_flush() which can take 10s of microseconds to complete - this is why this ISR has low priority
-    // TODO: modify FlexIOSPI to allow for calling arm_dcache_flush() from less time sensitive location
-    SPIFLEX.transfer(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].data,
-        NULL, ((matrixWidth * matrixHeight)*4) + (4+4), apa102ShiftCompleteEvent);
+    // underrun: the frame at the read position (if any) is still being written, the LEDs keep showing the last frame sent until the next period
+    if(cbIsEmpty(&SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer)) {
+        if(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback)
+            SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback();
+    } else {
+        int currentRow = cbGetNextRead(&SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
+
+        if(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].repeatFrame) {
+            // unchanged frame: the LEDs keep the last frame sent, run the calc as if the transfer had completed
+            apa102ShiftCompleteEvent.triggerEvent();
+        } else if(APA102_NUM_LANES > 1) {
+            apa102LaneDma.sourceBuffer((volatile uint32_t *)SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].data,
+                APA102_FRAME_BYTES);
+            apa102LaneDma.enable();
+        } else {
+            // the frame was flushed by writeRowBuffer(), skip FlexIOSPI's cache maintenance, the slow part of starting the transfer
+            SPIFLEX.transfer(SmartMatrixAPA102Refresh<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateFrame[currentRow].data,
+                NULL, APA102_FRAME_BYTES, apa102ShiftCompleteEvent, false);
+        }
+    }
 
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
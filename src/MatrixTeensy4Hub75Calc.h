@@ -24,30 +24,110 @@
 #ifndef SMARTMATRIXCALCT4_H
 #define SMARTMATRIXCALCT4_H
 
+#if defined(__IMXRT1062__)
+#include "DMAChannel.h"
+#endif
+
+// Implementation used by loadMatrixBuffers48 to convert pixels into FlexIO bitplane words
+//   SM_T4_PACKING_SCALAR: mask and shift each color channel into place for every bitplane
+//   SM_T4_PACKING_TRANSPOSE: 8x8 bit-matrix transpose of the six channels, then a pin LUT lookup per bitplane
+#define SM_T4_PACKING_SCALAR        0
+#define SM_T4_PACKING_TRANSPOSE     1
+
+#ifndef SM_T4_PIXEL_PACKING
+#define SM_T4_PIXEL_PACKING         SM_T4_PACKING_TRANSPOSE
+#endif
+
+// loadMatrixBuffers48 fills rgb24 temp rows when refresh only shows up to 8 bits per channel (without temporal dithering, which
+// needs the bits below those), halving the temp row traffic for 24-bit refresh, define as 0 to always use rgb48 temp rows
+#ifndef SM_T4_RGB24_TEMP_ROWS
+#define SM_T4_RGB24_TEMP_ROWS       1
+#endif
+
+template <bool eightBitChannels> struct smT4TempRow { typedef rgb48 type; };
+template <> struct smT4TempRow<true> { typedef rgb24 type; };
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixHub75Calc {
     public:
         typedef typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct rowDataStruct;
+        typedef typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clockWord clockWord;
 
         // init
         SmartMatrixHub75Calc(uint8_t bufferrows, volatile rowDataStruct * rowDataBuf);
         void begin(void);
         void addLayer(SM_Layer * newlayer);
+        // layers can be changed while refreshing, refresh picks up the new set at the start of the next frame, see smLayerChain
+        void removeLayer(SM_Layer * layer);
+        // moves layer to just above belowLayer, or to the bottom with belowLayer NULL
+        void moveLayer(SM_Layer * layer, SM_Layer * belowLayer);
+        void setLayerVisible(SM_Layer * layer, bool visible);
 
         // configuration
         void setRotation(rotationDegrees newrotation);
         void setBrightness(uint8_t newBrightness);
+        // fades the global brightness from its current value to targetBrightness, stepped by the calc each refresh frame
+        // setBrightness() cancels a running fade
+        void fadeBrightness(uint8_t targetBrightness, uint16_t durationMs);
+        // economy mode for OTA updates and network bursts: layers only advance to a new frame every updateIntervalMs (0 = frozen, a
+        // swapBuffers() waits until economy mode ends), and the refresh rate drops to SM_ECONOMY_MODE_REFRESH_RATE, as Teensy still
+        // packs every row each refresh frame
+        void setEconomyMode(bool enabled, uint16_t updateIntervalMs = 0);
+        bool getEconomyMode(void);
         void setRefreshRate(uint16_t newRefreshRate);
+        // HUB75 pixel clock, 480 MHz / divider, see SmartMatrixRefreshT4::setPixelClockDivider() and SMPixelClockTuner
+        void setPixelClockDivider(uint16_t divider);
+        uint16_t getPixelClockDivider(void);
+        // current estimate and limiter, see smPowerLimit: channelMilliamps is the current of one lit LED (one color of one pixel) at full
+        // on-time, and while the estimate is over budgetMilliamps (0 = no limit) the brightness shown is lowered below setBrightness()
+        void setPowerLimit(uint16_t channelMilliamps, uint32_t budgetMilliamps);
+        // per-panel calibration for panels that don't match in brightness or white point: the channels of the panel panelColumn across
+        // and panelRow down (COLS_PER_PANEL x MATRIX_PANEL_HEIGHT panels, in hardware orientation) are scaled by gain, 255 = no change
+        void setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain);
+        void clearPanelGains(void);
 
         // get info
         uint16_t getScreenWidth(void) const;
         uint16_t getScreenHeight(void) const;
         uint16_t getRefreshRate(void);
         bool getdmaBufferUnderrunFlag(void);
+        // depth chosen with SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER, and the underruns and latency spikes that changed it
+        void getRowBufferState(smRowBufferGovernor & state);
         bool getRefreshRateLoweredFlag(void);
+        // estimated panel LED current of the last frame, and the brightness it's limited to (255 when not limited)
+        uint32_t getEstimatedCurrent(void);
+        uint8_t getPowerLimitedBrightness(void);
+
+        // frame events, a frame is counted each time the layers get their frameRefreshCallback()
+        void setFrameCallback(smFrameCallback callback);
+        uint32_t getFrameCount(void);
+        // SM_HUB75_OPTIONS_T4_FRAME_REPLAY: frames shown again from the row buffer because nothing in them changed
+        uint32_t getReplayedFrames(void);
+        // readback tap for screenshots, see smReadbackTap: every intervalFrames-th frame is copied into buffer as the rows are filled,
+        // buffer holds SM_READBACK_BUFFER_PIXELS(matrixWidth, matrixHeight, scaleShift) pixels, NULL stops the copies
+        void setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift = 0, uint16_t intervalFrames = 1);
+        // frames fully copied to the readback buffer, a change means it holds a complete frame
+        uint32_t getReadbackFrameCount(void);
+        // sleeps until the next frame starts (a pending swapBuffers() has been taken), returns false after timeoutMs
+        bool waitForFrame(uint32_t timeoutMs);
+        // multi-controller frame sync, see smFrameSync: the master pulses an output pin at every frame start (-1 to stop), the
+        // others hold their frames for a pulse on an input pin, or for frameSyncPulse() calls from a network sync message
+        void setFrameSyncOutput(int8_t pin);
+        void setFrameSyncInput(int8_t pin);
+        void frameSyncPulse(void);
+        // microseconds this board's last frame started after the master's pulse, and frames lost to falling behind the master
+        int32_t getFrameSyncDrift(void);
+        uint32_t getFrameSyncMissedPulses(void);
 
         // debug
         int countFPS(void);
+        void getProfilingStats(smProfilingStats & stats);
+        void resetProfilingStats(void);
+        // refresh ISR trace, empty unless SM_ISR_TRACE_ENABLED is 1: copies up to maxEntries of the latest events oldest first, returns the number copied
+        int getIsrTrace(smIsrTraceEntry * entries, int maxEntries);
+        // per ISR counts, durations and entry intervals, with the buffer fill level histogram and underrun count
+        void getIsrTraceSummary(smIsrTraceSummary & summary);
+        void resetIsrTrace(void);
 
         // functions called by ISR
         static void matrixCalculations(bool initial);
@@ -55,10 +135,15 @@ class SmartMatrixHub75Calc {
 
     private:
         static SM_Layer * baseLayer;
+        static smLayerChain layerChain;
 
         // functions for refreshing
+        typedef typename smT4TempRow<SM_T4_RGB24_TEMP_ROWS && (COLOR_DEPTH_BITS <= 8) && !(optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)>::type tempRowRGB;
         static void loadMatrixBuffers(unsigned int currentRow);
         static void loadMatrixBuffers48(volatile rowDataStruct * currentRowDataPtr, unsigned int currentRow);
+        static void prefetchLayerRows(unsigned int currentRow, int rowGroup);
+        static void startTempRowClear(void * tempRows, uint32_t numBytes);
+        static void waitForTempRowClear(void);
         static void resetMultiRowRefreshMapPosition(void);
         static void resetMultiRowRefreshMapPositionPixelGroupToStartOfRow(void);
         static void advanceMultiRowRefreshMapToNextRow(void);
@@ -66,22 +151,84 @@ class SmartMatrixHub75Calc {
         static int getMultiRowRefreshRowOffset(void);
         static int getMultiRowRefreshNumPixelsToMap(void);
         static int getMultiRowRefreshPixelGroupOffset(void);
+        static void calculateMultiRowRefreshTables(void);
+        static void calculateStackingTables(void);
+        static void calculatePackingLUT(void);
+        static void transposeBitplanes(uint16_t r0, uint16_t g0, uint16_t b0, uint16_t r1, uint16_t g1, uint16_t b1, int shift, uint32_t & lo, uint32_t & hi);
 
         // configuration
         static volatile bool brightnessChange;
         static volatile bool rotationChange;
+        static smFrameEvents frameEvents;
+        static smFrameSync frameSync;
         static volatile bool dmaBufferUnderrun;
         static uint8_t brightness;
+        // fade requested by fadeBrightness(), started by the calc at the next frame
+        static volatile bool brightnessFadeStart;
+        static uint8_t brightnessFadeTarget;
+        static uint16_t brightnessFadeDurationMs;
+        static smBrightnessFade brightnessFade;
+        static smEconomyMode economyMode;
+        // brightness set in the timer LUT, lower than brightness while the power limit is reached
+        static uint8_t appliedBrightness;
+        static smPowerLimit powerLimit;
+        // sum of every channel value packed since the frame started, for the power estimate
+        static uint64_t powerChannelSum;
+        // OR of every channel value packed since the frame started with bit 0 as bitplane 0, for SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES
+        static uint16_t frameChannelOr;
+        static smRowBufferGovernor rowBufferGovernor;
+        static smReadbackTap readbackTap;
+        // setPanelGain() table, only applied while enabled
+        static rgb24 panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+        static volatile bool panelGainsEnabled;
+        static volatile bool panelGainsChanged;
+        // SM_HUB75_OPTIONS_T4_FRAME_REPLAY: the rows in the buffer don't all belong to one frame and the next one has to be packed, and
+        // the frame being shown is replayed
+        static volatile bool replayFrameInvalid;
+        static bool replaySkipping;
+        static uint32_t replayedFrames;
         static rotationDegrees rotation;
         static uint16_t calc_refreshRate;
         static bool dmaBufferUnderrunSinceLastCheck;
         static bool refreshRateLowered;
         static bool refreshRateChanged;
+        static smProfilingStats profilingStats;
+        // the swap being timed to its first row packed and shifted out, one at a time
+        static uint32_t latencySwapMicros;
+        static bool latencyFirstRowPending;
+        static bool latencyShiftPending;
+        // counts refresh frames, selecting the dither pattern position with SM_HUB75_OPTIONS_TEMPORAL_DITHER
+        static unsigned int ditherFrame;
+        // SM_HUB75_OPTIONS_T4_PIPELINED_ROWS: temp row set the next row is composited into, and whether a clear of it is still running
+        static uint8_t tempRowSet;
+        static bool tempRowClearPending;
+#if defined(__IMXRT1062__)
+        static DMAChannel * tempRowClearDMA;
+#endif
 
         static int multiRowRefresh_mapIndex_CurrentRowGroups;
         static int multiRowRefresh_mapIndex_CurrentPixelGroup;
         static int multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
         static int multiRowRefresh_NumPanelsAlreadyMapped;
+
+        // multi row refresh map expanded in begin(): row offset of each physical row group within a refresh row, and refresh buffer position of each temp buffer pixel
+        static int numMultiRowRefreshRowGroups;
+        static int16_t multiRowRefreshRowOffsetTable[PHYSICAL_ROWS_PER_REFRESH_ROW];
+        static uint16_t multiRowRefreshBufferPositionTable[MULTI_ROW_REFRESH_REQUIRED ? PHYSICAL_ROWS_PER_REFRESH_ROW : 1][MULTI_ROW_REFRESH_REQUIRED ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
+
+        // panel stacking tables, calculated once in begin() so loadMatrixBuffers48 only does lookups
+        // source rows (y0, y1) for each refresh row and each stack, before adding the multi row refresh offset
+        static int16_t stackingRowTable[MATRIX_SCAN_MOD][MATRIX_STACK_HEIGHT][2];
+        // source index in the temp row for each refresh buffer pixel, only needed for C-shape stacking
+        static uint16_t stackingPixelIndexTable[(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
+
+#if (SM_T4_PIXEL_PACKING == SM_T4_PACKING_TRANSPOSE)
+        // maps one transposed byte (bit n = channel n: r0, g0, b0, r1, g1, b1) to the FlexIO word for that bitplane
+        static clockWord packingPinLUT[256];
+        // the same for the second chain's pins with SM_HUB75_OPTIONS_T4_DUAL_CHAIN
+        static clockWord packingPinLUTChain1[(HUB75_PARALLEL_CHAINS > 1) ? 256 : 1];
+        static bool packingLUTValid;
+#endif
 };
 
 #endif
@@ -34,6 +34,8 @@
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SM_Layer * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smLayerChain SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::layerChain;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunSinceLastCheck = false;
@@ -49,9 +51,67 @@ volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, pane
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotationChange = true;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameEvents SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameEvents;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smFrameSync SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSync;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 rotationDegrees SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rotation = rotation0;
+// the refresh starts at full brightness
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness = 255;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeStart = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeTarget;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFadeDurationMs;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smBrightnessFade SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightnessFade;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smEconomyMode SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::economyMode;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::appliedBrightness = 255;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smPowerLimit SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerLimit;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint64_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::powerChannelSum = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameChannelOr = 0;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smReadbackTap SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::readbackTap;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+rgb24 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGains[PANEL_GAIN_ROWS][PANEL_GAIN_COLUMNS];
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGainsEnabled = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::panelGainsChanged = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::replayFrameInvalid = true;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::replaySkipping = false;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::brightness;
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::replayedFrames = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smRowBufferGovernor SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBufferGovernor;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+smProfilingStats SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::profilingStats;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latencySwapMicros;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latencyFirstRowPending = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latencyShiftPending = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRowSet = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRowClearPending = false;
+#if defined(__IMXRT1062__)
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+DMAChannel * SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::tempRowClearDMA = NULL;
+#endif
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+unsigned int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrame = 0;
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_mapIndex_CurrentRowGroups = 0;
@@ -65,22 +125,57 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefresh_NumPanelsAlreadyMapped = 0;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::numMultiRowRefreshRowGroups = 1;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefreshRowOffsetTable[PHYSICAL_ROWS_PER_REFRESH_ROW];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::multiRowRefreshBufferPositionTable[MULTI_ROW_REFRESH_REQUIRED ? PHYSICAL_ROWS_PER_REFRESH_ROW : 1][MULTI_ROW_REFRESH_REQUIRED ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stackingRowTable[MATRIX_SCAN_MOD][MATRIX_STACK_HEIGHT][2];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::stackingPixelIndexTable[(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) ? (PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW) : 1];
+
+#if (SM_T4_PIXEL_PACKING == SM_T4_PACKING_TRANSPOSE)
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clockWord SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packingPinLUT[256];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clockWord SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packingPinLUTChain1[(HUB75_PARALLEL_CHAINS > 1) ? 256 : 1];
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packingLUTValid = false;
+#endif
+
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixHub75Calc(uint8_t bufferrows, volatile rowDataStruct * rowDataBuf) {
+    rowBufferGovernor.begin(bufferrows);
 }
 
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addLayer(SM_Layer * newlayer) {
-    if (baseLayer) {
-        SM_Layer * templayer = baseLayer;
-        while (templayer->nextLayer)
-            templayer = templayer->nextLayer;
-        templayer->nextLayer = newlayer;
-    } else {
-        baseLayer = newlayer;
-    }
+    layerChain.add(newlayer, rotation);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::removeLayer(SM_Layer * layer) {
+    layerChain.remove(layer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::moveLayer(SM_Layer * layer, SM_Layer * belowLayer) {
+    layerChain.move(layer, belowLayer);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setLayerVisible(SM_Layer * layer, bool visible) {
+    layerChain.setVisible(layer, visible);
 }
 
 
@@ -107,10 +202,83 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     return ret;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameCallback(smFrameCallback callback) {
+    frameEvents.callback = callback;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getReplayedFrames(void) {
+    return replayedFrames;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameCount(void) {
+    return frameEvents.frameCount;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForFrame(uint32_t timeoutMs) {
+    return frameEvents.wait(timeoutMs);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncOutput(int8_t pin) {
+    frameSync.setOutput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameSyncInput(int8_t pin) {
+    frameSync.setInput(pin);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameSyncPulse(void) {
+    frameSync.pulse();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncDrift(void) {
+    return frameSync.drift;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameSyncMissedPulses(void) {
+    return frameSync.missedPulses;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getProfilingStats(smProfilingStats & stats) {
+    // copied while the calculations may be updating it, so values can be off by one sample
+    stats = profilingStats;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetProfilingStats(void) {
+    profilingStats.reset();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTrace(smIsrTraceEntry * entries, int maxEntries) {
+    return smGetIsrTrace().copy(entries, maxEntries);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getIsrTraceSummary(smIsrTraceSummary & summary) {
+    smGetIsrTrace().getSummary(summary);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetIsrTrace(void) {
+    smGetIsrTrace().reset();
+}
+
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrunCallback(void) {
     dmaBufferUnderrun = true;
+    SM_PROFILE_COUNT(profilingStats.dmaUnderruns);
 }
 
 
@@ -119,12 +287,50 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalculations(bool initial) {
     static unsigned int currentRow = 0;   // keeps track of the next row to write into the buffer
     unsigned char numLoopsWithoutExit = 0;
+    // with SM_HUB75_OPTIONS_T4_FRAME_REPLAY the buffer slot written next is always the next row, and the rows after a replayed frame
+    // are packed ahead in one go, which doesn't mean the refresh rate is too high
+    const bool replay = (optionFlags & SM_HUB75_OPTIONS_T4_FRAME_REPLAY) && SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isFrameReplayAvailable();
+    bool replayRefill = false;
+
+#if (SM_PROFILING_ENABLED == 1)
+    uint32_t shiftMicros;
+    if (latencyShiftPending && SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMarkedRowShiftMicros(shiftMicros)) {
+        profilingStats.swapToFirstRowShift.add(shiftMicros - latencySwapMicros);
+        latencyShiftPending = false;
+    }
+#endif
+
+    // rows left when the ISR gets to run show how close the last refill came to an underrun
+    if ((optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER) && !initial)
+        SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.rowsQueued(SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferQueuedRows()));
 
     // only run the loop if there is free space, and fill the entire buffer before returning
     while (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isRowBufferFree()) {
 
+        if (replay) {
+            unsigned int nextRow = SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferIndex();
+            if (nextRow != currentRow) {
+                // the refresh replayed rows this frame hadn't packed yet, they show the last frame until the next frame is packed in full
+                if (!replaySkipping) {
+                    replayFrameInvalid = true;
+                    SM_PROFILE_COUNT(profilingStats.dmaUnderruns);
+                    dmaBufferUnderrunSinceLastCheck = true;
+                    if (calc_refreshRate > MIN_REFRESH_RATE) {
+                        calc_refreshRate--;
+                        SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(calc_refreshRate);
+                        refreshRateLowered = true;
+                        refreshRateChanged = true;
+                    }
+                }
+                currentRow = nextRow;
+            }
+            // the rest of a replayed frame is shown from the buffer
+            if (replaySkipping && currentRow)
+                break;
+        }
+
         // check to see if the refresh rate is too high, and the application doesn't have time to run
-        if (++numLoopsWithoutExit > MAX_MATRIXCALCULATIONS_LOOPS_WITHOUT_EXIT) {
+        if (!replayRefill && ++numLoopsWithoutExit > MAX_MATRIXCALCULATIONS_LOOPS_WITHOUT_EXIT) {
             // minimum set to avoid overflowing timer at low refresh rates
             if (!initial && calc_refreshRate > MIN_REFRESH_RATE) {
                 calc_refreshRate--;
@@ -138,7 +344,25 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
 
         // do once-per-frame updates
         if (!currentRow) {
+            // with frame replay the frame is only packed if something that goes into the packed rows changed, dithering changes every
+            // row every frame
+            bool refreshNeeded = !replay || replayFrameInvalid || (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER);
+            if (optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER)
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.frame());
+#if (SM_T4_PIXEL_PACKING == SM_T4_PACKING_TRANSPOSE)
+            // the FlexIO pin configuration isn't known until the refresh hardware is set up, which is after the initial call
+            if (!initial && !packingLUTValid) {
+                calculatePackingLUT();
+                packingLUTValid = true;
+            }
+#endif
+            // layers added, removed, moved or hidden since the last frame are picked up here, and need the per-frame setup
+            if (layerChain.publish(baseLayer)) {
+                rotationChange = true;
+                refreshRateChanged = true;
+            }
             if (rotationChange) {
+                refreshNeeded = true;
                 SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
                 while (templayer) {
                     templayer->setRotation(rotation);
@@ -146,19 +370,90 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
                 }
                 rotationChange = false;
             }
-            SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-            while (templayer) {
-                if (refreshRateChanged) {
-                    templayer->setRefreshRate(calc_refreshRate);
+            // with frame sync following a master, layers only advance to a new frame on the master's pulse (or a timeout), and in
+            // economy mode only every economy interval
+            if (economyMode.frameDue(millis()) && frameSync.frameStart()) {
+                SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
+                while (templayer) {
+                    // checked before frameRefreshCallback() takes a pending swap, layers that don't track changes always report a change
+                    if (replay && !refreshNeeded && templayer->isLayerChanged())
+                        refreshNeeded = true;
+                    if (refreshRateChanged) {
+                        templayer->setRefreshRate(calc_refreshRate);
+                    }
+                    templayer->frameRefreshCallback();
+#if (SM_PROFILING_ENABLED == 1)
+                    uint32_t requestedMicros, pickedUpMicros;
+                    if (templayer->getSwapLatencyMicros(requestedMicros, pickedUpMicros)) {
+                        profilingStats.swapToPickup.add(pickedUpMicros - requestedMicros);
+                        // the first row and shift are timed for the first layer that swapped, once the last swap timed is out
+                        if (!latencyFirstRowPending && !latencyShiftPending) {
+                            latencySwapMicros = requestedMicros;
+                            latencyFirstRowPending = true;
+                        }
+                    }
+#endif
+                    templayer = templayer->nextLayer;
                 }
-                templayer->frameRefreshCallback();
-                templayer = templayer->nextLayer;
+                refreshRateChanged = false;
+                frameEvents.signal();
+            }
+            // a setBrightness() since the last frame cancels a running fade, fade steps only rewrite the timer LUT
+            if (brightnessFadeStart) {
+                brightnessFadeStart = false;
+                brightnessFade.start(brightness, brightnessFadeTarget, ((uint32_t)brightnessFadeDurationMs * calc_refreshRate) / 1000);
+            } else if (brightnessChange) {
+                brightnessFade.stop();
+            }
+            if (brightnessFade.isRunning()) {
+                brightness = brightnessFade.step();
+                brightnessChange = true;
             }
-            refreshRateChanged = false;
-            if (brightnessChange) {
-                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(brightness);
+            // the last frame's estimate uses the timer LUT it was shown with, the limit is applied through the same LUT
+            uint8_t limitedBrightness = powerLimit.update(powerChannelSum,
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowLitTicks(),
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowPeriodTicks(),
+                MATRIX_SCAN_MOD, appliedBrightness, brightness);
+            if (brightnessChange || limitedBrightness != appliedBrightness) {
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(limitedBrightness);
+                appliedBrightness = limitedBrightness;
                 brightnessChange = false;
             }
+            // bitplanes below the lowest bit set anywhere in the last frame are blanked for this one, the refresh adds planes unlit at
+            // the brightness just set
+            if (optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) {
+                uint8_t lowPlanes = 0;
+                while (lowPlanes < COLOR_DEPTH_BITS - 1 && !(frameChannelOr & (1 << lowPlanes)))
+                    lowPlanes++;
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setContentLowPlanes(lowPlanes);
+            }
+            if (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER)
+                ditherFrame++;
+            // a captured frame is packed if the readback buffer is new, or a frame was packed since the last capture, otherwise the
+            // replayed rows are already in the buffer
+            if (readbackTap.startFrame() && readbackTap.fullFrameNeeded)
+                refreshNeeded = true;
+            if (panelGainsChanged) {
+                panelGainsChanged = false;
+                refreshNeeded = true;
+            }
+            // brightness, power limit, refresh rate and blanked bitplanes all go into the timer values stored with each row
+            if (replay && SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getTimerLUTChanged())
+                refreshNeeded = true;
+
+            if (!refreshNeeded) {
+                // the refresh shows the rows packed for the last frame again, the power estimate and bitplane use carry over with them
+                replaySkipping = true;
+                replayedFrames++;
+                break;
+            }
+            if (replaySkipping)
+                replayRefill = true;
+            replaySkipping = false;
+            replayFrameInvalid = false;
+            readbackTap.framePacked();
+            powerChannelSum = 0;
+            frameChannelOr = 0;
         }
 
         // do once-per-line updates
@@ -166,13 +461,34 @@ FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panel
 
         // enqueue row
         SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(currentRow);
+#if (SM_PROFILING_ENABLED == 1)
+        // the first row of the frame that picked up the timed swap
+        bool latencyFirstRow = latencyFirstRowPending && !currentRow;
+        if (latencyFirstRow)
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markNextRowBuffer();
+#endif
+        SM_PROFILE_START(writeStart);
         SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::writeRowBuffer(currentRow);
+        SM_PROFILE_END(writeStart, profilingStats.bufferWrite);
+        // every slot holds a packed row once the first frame is written
+        if (replay && currentRow == MATRIX_SCAN_MOD - 1)
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameReplay(true);
+#if (SM_PROFILING_ENABLED == 1)
+        if (latencyFirstRow) {
+            profilingStats.swapToFirstRowPacked.add(micros() - latencySwapMicros);
+            latencyFirstRowPending = false;
+            latencyShiftPending = true;
+        }
+#endif
 
         if (++currentRow >= MATRIX_SCAN_MOD) currentRow = 0;
 
         if (dmaBufferUnderrun) {
-            // if refreshrate is too high, lower - minimum set to avoid overflowing timer at low refresh rates
-            if (calc_refreshRate > MIN_REFRESH_RATE) {
+            // an adaptive row buffer grows first, the refresh rate is only lowered once all rows are in use
+            if ((optionFlags & SM_HUB75_OPTIONS_ADAPTIVE_ROW_BUFFER) && rowBufferGovernor.depth < rowBufferGovernor.maxDepth) {
+                SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(rowBufferGovernor.underrun());
+            } else if (calc_refreshRate > MIN_REFRESH_RATE) {
+                // if refreshrate is too high, lower - minimum set to avoid overflowing timer at low refresh rates
                 calc_refreshRate--;
                 SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(calc_refreshRate);
                 refreshRateLowered = true;
@@ -215,10 +531,91 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setBrightness(uint8_t newBrightness) {
+    brightnessFadeStart = false;
     brightness = newBrightness;
     brightnessChange = true;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::fadeBrightness(uint8_t targetBrightness, uint16_t durationMs) {
+    brightnessFadeTarget = targetBrightness;
+    brightnessFadeDurationMs = durationMs;
+    brightnessFadeStart = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setEconomyMode(bool enabled, uint16_t updateIntervalMs) {
+    economyMode.intervalMs = updateIntervalMs;
+    economyMode.lastUpdateMillis = millis();
+    if (enabled == economyMode.enabled)
+        return;
+
+    // the lower refresh rate is what saves CPU on Teensy, the rows are packed from the layers every refresh frame regardless
+    if (enabled) {
+        economyMode.savedRefreshRate = calc_refreshRate;
+        if (calc_refreshRate > SM_ECONOMY_MODE_REFRESH_RATE)
+            setRefreshRate(SM_ECONOMY_MODE_REFRESH_RATE);
+    } else {
+        setRefreshRate(economyMode.savedRefreshRate);
+    }
+    economyMode.enabled = enabled;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getEconomyMode(void) {
+    return economyMode.enabled;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPowerLimit(uint16_t channelMilliamps, uint32_t budgetMilliamps) {
+    powerLimit.channelMilliamps = channelMilliamps;
+    powerLimit.budgetMilliamps = budgetMilliamps;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getEstimatedCurrent(void) {
+    return powerLimit.estimatedMilliamps;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPowerLimitedBrightness(void) {
+    return powerLimit.level;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPanelGain(uint8_t panelColumn, uint8_t panelRow, const rgb24 & gain) {
+    if(panelColumn >= PANEL_GAIN_COLUMNS || panelRow >= PANEL_GAIN_ROWS)
+        return;
+
+    if(!panelGainsEnabled) {
+        for(int y = 0; y < PANEL_GAIN_ROWS; y++) {
+            for(int x = 0; x < PANEL_GAIN_COLUMNS; x++)
+                panelGains[y][x] = rgb24(255, 255, 255);
+        }
+    }
+    panelGains[panelRow][panelColumn] = gain;
+    panelGainsEnabled = true;
+    panelGainsChanged = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::clearPanelGains(void) {
+    panelGainsEnabled = false;
+    panelGainsChanged = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setReadbackBuffer(rgb16 * buffer, uint8_t scaleShift, uint16_t intervalFrames) {
+    readbackTap.setBuffer(buffer, matrixWidth, scaleShift, intervalFrames);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getReadbackFrameCount(void) {
+    return readbackTap.framesCaptured;
+}
+
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(uint16_t newRefreshRate) {
@@ -239,6 +636,21 @@ uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType
 }
 
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPixelClockDivider(uint16_t divider) {
+    SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPixelClockDivider(divider);
+
+    // a slower clock can lower the highest refresh rate
+    setRefreshRate(calc_refreshRate);
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPixelClockDivider(void) {
+    return SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPixelClockDivider();
+}
+
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getdmaBufferUnderrunFlag(void) {
     if (dmaBufferUnderrunSinceLastCheck) {
@@ -249,6 +661,12 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 }
 
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferState(smRowBufferGovernor & state) {
+    state = rowBufferGovernor;
+}
+
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRefreshRateLoweredFlag(void) {
     if (refreshRateLowered) {
@@ -261,17 +679,101 @@ bool SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(void) {
-    SM_Layer * templayer = baseLayer;
-    while (templayer) {
-        templayer->begin();
-        templayer = templayer->nextLayer;
-    }
+    frameEvents.begin();
+
+    layerChain.begin();
+    layerChain.publish(baseLayer);
+
+    calculateStackingTables();
+    calculateMultiRowRefreshTables();
+
+#if defined(__IMXRT1062__)
+    if ((optionFlags & SM_HUB75_OPTIONS_T4_PIPELINED_ROWS) && !tempRowClearDMA)
+        tempRowClearDMA = new DMAChannel();
+#endif
 
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixCalculationsCallback(matrixCalculations);
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setMatrixUnderrunCallback(dmaBufferUnderrunCallback);
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin();
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calculateStackingTables(void) {
+    /*  The mapping from (refresh row, stack) to the source rows only depends on optionFlags and the panel geometry,
+        so calculate it once here instead of going through the stacking options for every stack on every refresh row.
+        Z-shape stacking: load data buffer with the panels furthest from the Teensy first, as initial data is shifted out the furthest
+          Bottom to Top Stacking: top panels are at the furthest end of the chain
+          Top to Bottom Stacking: bottom panels are at the furthest end of the chain
+        C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
+          swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
+          the last stack is always right-side up, figure out orientation of other stacks based on that */
+    for (int row = 0; row < MATRIX_SCAN_MOD; row++) {
+        for (int i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+            int stackRowOffset;
+            if (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)
+                stackRowOffset = i * MATRIX_PANEL_HEIGHT;
+            else
+                stackRowOffset = (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
+
+            // is i the last stack, or an even number of stacks away from the last stack?
+            bool upsideDown = (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2));
+
+            if (!upsideDown) {
+                // stacks of the second chain are at the same positions, HUB75_CHAIN_HEIGHT rows lower
+                stackingRowTable[row][i][0] = row + stackRowOffset;
+                stackingRowTable[row][i][1] = row + stackRowOffset + ROW_PAIR_OFFSET;
+            } else {
+                stackingRowTable[row][i][1] = (MATRIX_SCAN_MOD - row - 1) + stackRowOffset;
+                stackingRowTable[row][i][0] = (MATRIX_SCAN_MOD - row - 1) + stackRowOffset + ROW_PAIR_OFFSET;
+            }
+        }
+    }
+
+    if (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) {
+        const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
+
+        for (int j = 0; j < numPixelsPerTempRow; j++) {
+            // for upside down stacks, flip order
+            int currentStack = j/matrixWidth;
+            if (!((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
+                // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
+                stackingPixelIndexTable[j] = (currentStack*matrixWidth) + (matrixWidth-1) - (j%matrixWidth);
+            } else {
+                // load data to buffer in normal order
+                stackingPixelIndexTable[j] = j;
+            }
+        }
+    }
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calculatePackingLUT(void) {
+#if (SM_T4_PIXEL_PACKING == SM_T4_PACKING_TRANSPOSE)
+    for (int chain = 0; chain < HUB75_PARALLEL_CHAINS; chain++) {
+        const uint8_t channelShifts[6] = {
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).r0,
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).g0,
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).b0,
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).r1,
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).g1,
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(chain).b1
+        };
+
+        for (int i = 0; i < 256; i++) {
+            uint32_t rgbdata = 0;
+            for (int j = 0; j < 6; j++) {
+                if (i & (1 << j))
+                    rgbdata |= 1UL << channelShifts[j];
+            }
+            if (chain)
+                packingPinLUTChain1[i] = rgbdata;
+            else
+                packingPinLUT[i] = rgbdata;
+        }
+    }
+#endif
+}
+
 #define IS_LAST_PANEL_MAP_ENTRY(x) (!x.rowOffset && !x.bufferOffset && !x.numPixels)
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -357,162 +859,346 @@ int SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     return map[multiRowRefresh_mapIndex_CurrentPixelGroup].bufferOffset + multiRowRefresh_PixelOffsetFromPanelsAlreadyMapped;
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FLASHMEM void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calculateMultiRowRefreshTables(void) {
+    /*  Walk the multi row refresh map once, the same way loadMatrixBuffers used to for every refresh row, and record
+        the row offset of each physical row group and the refresh buffer position of each pixel in the temp buffer.
+        Pixel block direction and the offset from panels already mapped are folded into the positions, so packing
+        is a straight lookup per pixel */
+    const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
+    int multiRowRefreshRowOffset = 0;
+
+    numMultiRowRefreshRowGroups = 0;
+    resetMultiRowRefreshMapPosition();
+
+    do {
+        multiRowRefreshRowOffsetTable[numMultiRowRefreshRowGroups] = multiRowRefreshRowOffset;
+
+        if(MULTI_ROW_REFRESH_REQUIRED) {
+            int i = 0;
+
+            // start filling from the first panel again
+            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+
+            while(i < numPixelsPerTempRow) {
+                // get number of pixels to go through with current pass
+                int numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+
+                bool reversePixelBlock = false;
+                if(numPixelsToMap < 0) {
+                    reversePixelBlock = true;
+                    numPixelsToMap = abs(numPixelsToMap);
+                }
+
+                // get offset where pixels are written in the refresh buffer
+                int currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+
+                for(int k=0; (k < numPixelsToMap) && (i+k < numPixelsPerTempRow); k++) {
+                    if(reversePixelBlock) {
+                        multiRowRefreshBufferPositionTable[numMultiRowRefreshRowGroups][i+k] = currentMapOffset-k;
+                    } else {
+                        multiRowRefreshBufferPositionTable[numMultiRowRefreshRowGroups][i+k] = currentMapOffset+k;
+                    }
+                }
+
+                i += numPixelsToMap; // keep track of current position on this temp buffer
+                advanceMultiRowRefreshMapToNextPixelGroup();
+            }
+        }
+
+        numMultiRowRefreshRowGroups++;
+
+        advanceMultiRowRefreshMapToNextRow();
+        multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
+    } while ((multiRowRefreshRowOffset > 0) && (numMultiRowRefreshRowGroups < PHYSICAL_ROWS_PER_REFRESH_ROW));
+}
+
+// requests the same rows as the fillRefreshRow() calls in loadMatrixBuffers48(), a mismatch only costs a cache miss
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::prefetchLayerRows(unsigned int currentRow, int rowGroup) {
+    int multiRowRefreshRowOffset = MULTI_ROW_REFRESH_REQUIRED ? multiRowRefreshRowOffsetTable[rowGroup] : 0;
+
+    SM_Layer * templayer = baseLayer;
+    while (templayer) {
+        for (int i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+            templayer->prefetchRefreshRow(stackingRowTable[currentRow][i][0] + multiRowRefreshRowOffset);
+            templayer->prefetchRefreshRow(stackingRowTable[currentRow][i][1] + multiRowRefreshRowOffset);
+            if (HUB75_PARALLEL_CHAINS > 1) {
+                templayer->prefetchRefreshRow(stackingRowTable[currentRow][i][0] + multiRowRefreshRowOffset + HUB75_CHAIN_HEIGHT);
+                templayer->prefetchRefreshRow(stackingRowTable[currentRow][i][1] + multiRowRefreshRowOffset + HUB75_CHAIN_HEIGHT);
+            }
+        }
+        templayer = templayer->nextLayer;
+    }
+}
+
+// clears a temp row set with eDMA, the calc carries on packing the other set while it runs
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::startTempRowClear(void * tempRows, uint32_t numBytes) {
+#if defined(__IMXRT1062__)
+    // the temp rows are in DTCM, which eDMA writes without going through the data cache
+    static uint32_t zero = 0;
+
+    int transferSize = (((uint32_t)tempRows | numBytes) & 3) ? 1 : 4;
+    tempRowClearDMA->TCD->SADDR = &zero;
+    tempRowClearDMA->TCD->SOFF = 0;
+    tempRowClearDMA->TCD->ATTR = (transferSize == 4) ? (DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2)) : (DMA_TCD_ATTR_SSIZE(0) | DMA_TCD_ATTR_DSIZE(0));
+    tempRowClearDMA->TCD->NBYTES_MLNO = numBytes;
+    tempRowClearDMA->TCD->SLAST = 0;
+    tempRowClearDMA->TCD->DADDR = tempRows;
+    tempRowClearDMA->TCD->DOFF = transferSize;
+    tempRowClearDMA->TCD->CITER_ELINKNO = 1;
+    tempRowClearDMA->TCD->DLASTSGA = 0;
+    tempRowClearDMA->TCD->BITER_ELINKNO = 1;
+    tempRowClearDMA->TCD->CSR = DMA_TCD_CSR_DREQ;
+    tempRowClearDMA->triggerManual();
+#else
+    memset(tempRows, 0, numBytes);
+#endif
+    tempRowClearPending = true;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForTempRowClear(void) {
+#if defined(__IMXRT1062__)
+    while (!tempRowClearDMA->complete());
+    tempRowClearDMA->clearComplete();
+#endif
+    tempRowClearPending = false;
+}
+
+// treat the six channels as rows of an 8x8 bit matrix (eight bitplanes starting at shift) and transpose it, so that
+// each byte of lo (bitplanes 0-3) and hi (bitplanes 4-7) holds one bitplane with one bit per channel
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::transposeBitplanes(uint16_t r0, uint16_t g0, uint16_t b0, uint16_t r1, uint16_t g1, uint16_t b1, int shift, uint32_t & lo, uint32_t & hi) {
+    uint32_t t;
+
+    lo = ((r0 >> shift) & 0xFF) | (((g0 >> shift) & 0xFF) << 8) | (((b0 >> shift) & 0xFF) << 16) | (((r1 >> shift) & 0xFF) << 24);
+    hi = ((g1 >> shift) & 0xFF) | (((b1 >> shift) & 0xFF) << 8);
+
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA;  lo = lo ^ t ^ (t << 7);
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA;  hi = hi ^ t ^ (t << 7);
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo = lo ^ t ^ (t << 14);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi = hi ^ t ^ (t << 14);
+    t = (lo ^ (hi << 4)) & 0xF0F0F0F0;  lo = lo ^ t;    hi = hi ^ (t >> 4);
+}
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(volatile rowDataStruct * currentRowDataPtr, unsigned int currentRow) {
     /*  Read a new row of pixel data from the layers, extract the bitplanes for each pixel, reformat
         the data into the format needed for FlexIO, and store that in the rowDataBuffer.
-        Bit depths are supported from 1 bit per color channel (3 bits per pixel) to 16 bits per color channel (48 bits per pixel). */
+        Bit depths are supported from 1 bit per color channel (3 bits per pixel) to 16 bits per color channel (48 bits per pixel).
+        The layers fill rgb24 temp rows when the refresh has 8 bits per channel or fewer, see SM_T4_RGB24_TEMP_ROWS */
 
     int i;
-    int multiRowRefreshRowOffset = 0;
     const int numPixelsPerTempRow = PIXELS_PER_LATCH/PHYSICAL_ROWS_PER_REFRESH_ROW;
-
     // Temporary buffers to store rgb pixel data for reformatting (static to avoid putting large buffer on the stack)
-    static rgb48 tempRow0[numPixelsPerTempRow];
-    static rgb48 tempRow1[numPixelsPerTempRow];
-
-    int c = 0;
-
-    // multi row refresh isn't very efficient, slowing this function down by ~30% for panels that don't even need multi row refresh.  For now, only enable the code if needed
-    if(MULTI_ROW_REFRESH_REQUIRED) { 
-        resetMultiRowRefreshMapPosition();
-    }
+    // each set holds tempRow0 and tempRow1, then tempRow2 and tempRow3: the same rows of the second chain, HUB75_CHAIN_HEIGHT lower
+    // with SM_HUB75_OPTIONS_T4_PIPELINED_ROWS a row is composited into one set while the other is cleared for the next row
+    const int numTempRowsPerSet = 2 * HUB75_PARALLEL_CHAINS;
+    const int numTempRowSets = (optionFlags & SM_HUB75_OPTIONS_T4_PIPELINED_ROWS) ? 2 : 1;
+    static tempRowRGB tempRowSets[numTempRowSets][numTempRowsPerSet * numPixelsPerTempRow];
+    const uint32_t tempRowSetBytes = sizeof(tempRowSets[0]);
+    // bits per channel in the temp rows, the bitplanes shown are the top COLOR_DEPTH_BITS
+    const int channelBits = sizeof(tempRowSets[0][0].red) * 8;
 
     // go through this process for each physical row that is contained in the refresh row
-    do {
-        // clear buffer to prevent garbage data showing
-        memset(tempRow0, 0, sizeof(tempRow0));
-        memset(tempRow1, 0, sizeof(tempRow1));
+    // the multi row refresh map was expanded into tables in begin(), panels that don't need multi row refresh have a single row group
+    for (int rowGroup = 0; rowGroup < (MULTI_ROW_REFRESH_REQUIRED ? numMultiRowRefreshRowGroups : 1); rowGroup++) {
+        int multiRowRefreshRowOffset = MULTI_ROW_REFRESH_REQUIRED ? multiRowRefreshRowOffsetTable[rowGroup] : 0;
+
+        tempRowRGB * tempRow0 = tempRowSets[tempRowSet];
+        tempRowRGB * tempRow1 = tempRow0 + numPixelsPerTempRow;
+        tempRowRGB * tempRow2 = (HUB75_PARALLEL_CHAINS > 1) ? tempRow0 + 2 * numPixelsPerTempRow : tempRow0;
+        tempRowRGB * tempRow3 = (HUB75_PARALLEL_CHAINS > 1) ? tempRow0 + 3 * numPixelsPerTempRow : tempRow1;
+
+        // clear buffer to prevent garbage data showing through transparent layers, skipped if the first layer overwrites every pixel
+        // a set cleared while the last row was packed only needs its clear to finish
+        if (tempRowClearPending)
+            waitForTempRowClear();
+        else if (!baseLayer || !baseLayer->isLayerOpaque())
+            memset((void *)tempRow0, 0, tempRowSetBytes);
 
         // Get pixel data from layers and store in tempRow0 and tempRow1
         // Scan through the entire chain of panels and extract rows from each one
         // using the stacking options to get the correct rows (some panels can be upside down).
         SM_Layer * templayer = SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::baseLayer;
-        int y0, y1; // positions of the two rows we need
+        int layerIndex = 0;
         while (templayer) {
+            SM_PROFILE_START(layerStart);
             for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
-                // Z-shape, bottom to top
-                if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                        (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + i * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // Z-shape, top to bottom
-                } else if (!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-                    y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                    y1 = y0 + ROW_PAIR_OFFSET;
-                // C-shape, bottom to top
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Bottom to Top Stacking: load data buffer with top panels first, bottom panels last, as top panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (i) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (i) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
-                // C-shape, top to bottom
-                } else if ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                           !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                    // C-shaped stacking: alternate direction of filling (or loading) for each matrixwidth-sized stack, stack closest to Teensy is right-side up
-                    //   swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half when upside down)
-                    //   the last stack is always right-side up, figure out orientation of other stacks based on that
-                    // Top to Bottom Stacking: load data buffer with bottom panels first, top panels last, as bottom panels are at the furthest end of the chain (initial data is shifted out the furthest)
-
-                    // is i the last stack, or an even number of stacks away from the last stack?
-                    if((i % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2)) {
-                        y0 = currentRow + multiRowRefreshRowOffset + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y1 = y0 + ROW_PAIR_OFFSET;
-                    } else {
-                        y1 = (MATRIX_SCAN_MOD - currentRow + multiRowRefreshRowOffset - 1) + (MATRIX_STACK_HEIGHT - i - 1) * MATRIX_PANEL_HEIGHT;
-                        y0 = y1 + ROW_PAIR_OFFSET;
-                    }
+                // positions of the two rows we need come from the table calculated in begin()
+                int y0 = stackingRowTable[currentRow][i][0] + multiRowRefreshRowOffset;
+                int y1 = stackingRowTable[currentRow][i][1] + multiRowRefreshRowOffset;
+                templayer->fillCoveredRefreshRow(y0, &tempRow0[i * matrixWidth]);
+                templayer->fillCoveredRefreshRow(y1, &tempRow1[i * matrixWidth]);
+                if (HUB75_PARALLEL_CHAINS > 1) {
+                    templayer->fillCoveredRefreshRow(y0 + HUB75_CHAIN_HEIGHT, &tempRow2[i * matrixWidth]);
+                    templayer->fillCoveredRefreshRow(y1 + HUB75_CHAIN_HEIGHT, &tempRow3[i * matrixWidth]);
                 }
-                templayer->fillRefreshRow(y0, &tempRow0[i * matrixWidth]);
-                templayer->fillRefreshRow(y1, &tempRow1[i * matrixWidth]);
             }
+            SM_PROFILE_END(layerStart, profilingStats.layerFill[layerIndex]);
+            if (layerIndex < SM_PROFILING_MAX_LAYERS - 1)
+                layerIndex++;
             templayer = templayer->nextLayer;
         }
 
-        i=0;
+        // the composited rows, before dithering
+        if (readbackTap.capturing) {
+            for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+                int y0 = stackingRowTable[currentRow][i][0] + multiRowRefreshRowOffset;
+                int y1 = stackingRowTable[currentRow][i][1] + multiRowRefreshRowOffset;
+                readbackTap.captureRow(y0, &tempRow0[i * matrixWidth]);
+                readbackTap.captureRow(y1, &tempRow1[i * matrixWidth]);
+                if (HUB75_PARALLEL_CHAINS > 1) {
+                    readbackTap.captureRow(y0 + HUB75_CHAIN_HEIGHT, &tempRow2[i * matrixWidth]);
+                    readbackTap.captureRow(y1 + HUB75_CHAIN_HEIGHT, &tempRow3[i * matrixWidth]);
+                }
+            }
+        }
 
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            // reset pixel map offset so we start filling from the first panel again
-            resetMultiRowRefreshMapPositionPixelGroupToStartOfRow();
+        // per-panel calibration, y0 and y1 are always on the same panel
+        if (panelGainsEnabled) {
+            for (i = 0; i < MATRIX_STACK_HEIGHT; i++) {
+                int panelRow = (stackingRowTable[currentRow][i][0] + multiRowRefreshRowOffset) / MATRIX_PANEL_HEIGHT;
+                applyPanelGains(&tempRow0[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[panelRow]);
+                applyPanelGains(&tempRow1[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[panelRow]);
+                if (HUB75_PARALLEL_CHAINS > 1) {
+                    applyPanelGains(&tempRow2[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[panelRow + MATRIX_STACK_HEIGHT]);
+                    applyPanelGains(&tempRow3[i * matrixWidth], matrixWidth, COLS_PER_PANEL, panelGains[panelRow + MATRIX_STACK_HEIGHT]);
+                }
+            }
         }
 
-        while(i < numPixelsPerTempRow) {
+        // start copying the layer rows for the next row group, layers with a row cache stage them while this one is packed
+        if (rowGroup + 1 < (MULTI_ROW_REFRESH_REQUIRED ? numMultiRowRefreshRowGroups : 1))
+            prefetchLayerRows(currentRow, rowGroup + 1);
+        else
+            prefetchLayerRows((currentRow + 1) % MATRIX_SCAN_MOD, 0);
 
-            int numPixelsToMap;
-            int currentMapOffset;
-            bool reversePixelBlock;
+        // switch sets and start clearing the one the next row group is composited into, it's done by the time packing this one finishes
+        if (optionFlags & SM_HUB75_OPTIONS_T4_PIPELINED_ROWS) {
+            tempRowSet ^= 1;
+            if (!baseLayer || !baseLayer->isLayerOpaque())
+                startTempRowClear(tempRowSets[tempRowSet], tempRowSetBytes);
+        }
 
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                // get number of pixels to go through with current pass
-                numPixelsToMap = getMultiRowRefreshNumPixelsToMap();
+        SM_PROFILE_START(packingStart);
 
-                reversePixelBlock = false;
-                if(numPixelsToMap < 0) {
-                    reversePixelBlock = true;
-                    numPixelsToMap = abs(numPixelsToMap);
-                }
+        // tempRow1 is offset from tempRow0 in the pattern so the two halves of the panel don't dither in lockstep
+        if (optionFlags & SM_HUB75_OPTIONS_TEMPORAL_DITHER) {
+            ditherRGB(tempRow0, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset, ditherFrame, COLOR_DEPTH_BITS);
+            ditherRGB(tempRow1, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 2, ditherFrame, COLOR_DEPTH_BITS);
+            if (HUB75_PARALLEL_CHAINS > 1) {
+                ditherRGB(tempRow2, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 1, ditherFrame, COLOR_DEPTH_BITS);
+                ditherRGB(tempRow3, numPixelsPerTempRow, currentRow + multiRowRefreshRowOffset + 3, ditherFrame, COLOR_DEPTH_BITS);
+            }
+        }
 
-                // get offset where pixels are written in the refresh buffer
-                currentMapOffset = getMultiRowRefreshPixelGroupOffset();
+        // sum of the channel values for the power estimate: each position adds 6 channels of up to 65535 (12 with two parallel chains,
+        // 8-bit channels are scaled to 65535 below), so it fits 32 bits up to 10922 positions per temp row (5461 with two chains)
+        uint32_t rowChannelSum = 0;
+        uint16_t rowChannelOr = 0;
+        // blanked bitplanes aren't shown, so what's left in their buffer from an earlier row doesn't matter
+        const int firstPlane = (optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) ?
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getSkippedPlanes() : 0;
+
+        // parse through the temp buffer, loading each pixel and writing it to the refresh buffer position calculated in begin()
+        for (i = 0; i < numPixelsPerTempRow; i++) {
+            uint16_t r0, g0, b0, r1, g1, b1;
+            uint16_t c1r0 = 0, c1g0 = 0, c1b0 = 0, c1r1 = 0, c1g1 = 0, c1b1 = 0;
+            int ind;
+
+            int refreshBufferPosition;
+            if(MULTI_ROW_REFRESH_REQUIRED) {
+                refreshBufferPosition = multiRowRefreshBufferPositionTable[rowGroup][i];
             } else {
-                numPixelsToMap = matrixWidth;
+                refreshBufferPosition = i;
             }
 
-            // parse through grouping of pixels, loading from temp buffer and writing to refresh buffer
-            for(int k=0; k < numPixelsToMap; k++) {
-                uint16_t r0, g0, b0, r1, g1, b1;
-                int ind;
+            // for upside down stacks, the table flips the order
+            if(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) {
+                ind = stackingPixelIndexTable[i];
+            } else {
+                // load data to buffer in normal order
+                ind = i;
+            }
+            r0 = tempRow0[ind].red;
+            g0 = tempRow0[ind].green;
+            b0 = tempRow0[ind].blue;
+            r1 = tempRow1[ind].red;
+            g1 = tempRow1[ind].green;
+            b1 = tempRow1[ind].blue;
+            if (HUB75_PARALLEL_CHAINS > 1) {
+                c1r0 = tempRow2[ind].red;
+                c1g0 = tempRow2[ind].green;
+                c1b0 = tempRow2[ind].blue;
+                c1r1 = tempRow3[ind].red;
+                c1g1 = tempRow3[ind].green;
+                c1b1 = tempRow3[ind].blue;
+            }
 
-                int refreshBufferPosition;
-                if(MULTI_ROW_REFRESH_REQUIRED) { 
-                    if(reversePixelBlock) {
-                        refreshBufferPosition = currentMapOffset-k;
-                    } else {
-                        refreshBufferPosition = currentMapOffset+k;
-                    }
-                } else {
-                    refreshBufferPosition = i+k;
-                }
+            rowChannelSum += r0 + g0 + b0 + r1 + g1 + b1;
+            if (HUB75_PARALLEL_CHAINS > 1)
+                rowChannelSum += c1r0 + c1g0 + c1b0 + c1r1 + c1g1 + c1b1;
 
-                // for upside down stacks, flip order
-                int currentStack = i/matrixWidth;
-                if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((currentStack % 2) == ((MATRIX_STACK_HEIGHT - 1) % 2))) {
-                    // reverse order of this stack's data if it's reversed (if currentStack is the last stack, or an even number of stacks away from the last stack)
-                    ind = (currentStack*matrixWidth) + (matrixWidth-1) - ((i+k)%matrixWidth);
-                } else {
-                    // load data to buffer in normal order
-                    ind = i+k;
-                }
-                r0 = tempRow0[ind].red;
-                g0 = tempRow0[ind].green;
-                b0 = tempRow0[ind].blue;
-                r1 = tempRow1[ind].red;
-                g1 = tempRow1[ind].green;
-                b1 = tempRow1[ind].blue;
-
-                if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
-                    r0 = ~r0;
-                }
+            if(optionFlags & SMARTMATRIX_OPTIONS_HUB12_MODE) {
+                r0 = ~r0;
+                c1r0 = ~c1r0;
+            }
 
-                // loop through each bitplane in the current pixel's RGB values and format the bits to match the FlexIO pin configuration
-                uint32_t rgbdata;
-                uint8_t shift = (16 - COLOR_DEPTH_BITS);
-                uint16_t mask = 1 << shift;
+            if (optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) {
+                rowChannelOr |= r0 | g0 | b0 | r1 | g1 | b1;
+                if (HUB75_PARALLEL_CHAINS > 1)
+                    rowChannelOr |= c1r0 | c1g0 | c1b0 | c1r1 | c1g1 | c1b1;
+            }
 
-                for (int bitindex = 0; bitindex < COLOR_DEPTH_BITS; bitindex++) {
+#if (SM_T4_PIXEL_PACKING == SM_T4_PACKING_TRANSPOSE)
+            // transpose eight bitplanes at a time, then look up the FlexIO word for each bitplane byte
+            for (int bitindex = firstPlane & ~7; bitindex < COLOR_DEPTH_BITS; bitindex += 8) {
+                const int shift = (channelBits - COLOR_DEPTH_BITS) + bitindex;
+                uint32_t lo, hi, lo1 = 0, hi1 = 0;
+
+                transposeBitplanes(r0, g0, b0, r1, g1, b1, shift, lo, hi);
+                if (HUB75_PARALLEL_CHAINS > 1)
+                    transposeBitplanes(c1r0, c1g0, c1b0, c1r1, c1g1, c1b1, shift, lo1, hi1);
+
+                // store these pixel bits in the rowDataBuffer, leaving the initial pixels as padding
+                for (int k2 = 0; k2 < 8 && (bitindex + k2) < COLOR_DEPTH_BITS; k2++) {
+                    if (bitindex + k2 < firstPlane)
+                        continue;
+                    uint8_t bitplane = (k2 < 4) ? (lo >> (8 * k2)) : (hi >> (8 * (k2 - 4)));
+                    clockWord rgbdata = packingPinLUT[bitplane];
+                    if (HUB75_PARALLEL_CHAINS > 1) {
+                        uint8_t bitplane1 = (k2 < 4) ? (lo1 >> (8 * k2)) : (hi1 >> (8 * (k2 - 4)));
+                        rgbdata |= packingPinLUTChain1[bitplane1];
+                    }
+                    currentRowDataPtr->rowbits[bitindex + k2].data[PAD_PIXELS + refreshBufferPosition] = rgbdata;
+                }
+            }
+#else
+            // loop through each bitplane in the current pixel's RGB values and format the bits to match the FlexIO pin configuration
+            uint32_t rgbdata;
+            uint8_t shift = (channelBits - COLOR_DEPTH_BITS) + firstPlane;
+            uint16_t mask = 1 << shift;
+
+            for (int bitindex = firstPlane; bitindex < COLOR_DEPTH_BITS; bitindex++) {
+                if (HUB75_PARALLEL_CHAINS > 1) {
+                    // pins can be anywhere in a 32-bit word, so move each bit down to bit 0 before shifting it into place
+                    typedef SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags> refreshT4;
+                    rgbdata  = ((r0 >> shift) & 1) << refreshT4::getFlexPinConfig(0).r0;
+                    rgbdata |= ((g0 >> shift) & 1) << refreshT4::getFlexPinConfig(0).g0;
+                    rgbdata |= ((b0 >> shift) & 1) << refreshT4::getFlexPinConfig(0).b0;
+                    rgbdata |= ((r1 >> shift) & 1) << refreshT4::getFlexPinConfig(0).r1;
+                    rgbdata |= ((g1 >> shift) & 1) << refreshT4::getFlexPinConfig(0).g1;
+                    rgbdata |= ((b1 >> shift) & 1) << refreshT4::getFlexPinConfig(0).b1;
+                    rgbdata |= ((c1r0 >> shift) & 1) << refreshT4::getFlexPinConfig(1).r0;
+                    rgbdata |= ((c1g0 >> shift) & 1) << refreshT4::getFlexPinConfig(1).g0;
+                    rgbdata |= ((c1b0 >> shift) & 1) << refreshT4::getFlexPinConfig(1).b0;
+                    rgbdata |= ((c1r1 >> shift) & 1) << refreshT4::getFlexPinConfig(1).r1;
+                    rgbdata |= ((c1g1 >> shift) & 1) << refreshT4::getFlexPinConfig(1).g1;
+                    rgbdata |= ((c1b1 >> shift) & 1) << refreshT4::getFlexPinConfig(1).b1;
+                } else {
                     rgbdata  = (r0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().r0);
                     rgbdata |= (g0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().g0);
                     rgbdata |= (b0 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().b0);
@@ -520,19 +1206,21 @@ FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight
                     rgbdata |= (g1 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().g1);
                     rgbdata |= (b1 & mask) << (SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig().b1);
                     rgbdata >>= shift;
+                }
 
-                    shift++;
-                    mask <<= 1;
+                shift++;
+                mask <<= 1;
 
-                    // store these pixel bits in the rowDataBuffer, leaving the initial pixels as padding
-                    currentRowDataPtr->rowbits[bitindex].data[PAD_PIXELS + refreshBufferPosition] = rgbdata;
-                }
-            }
-            i += numPixelsToMap; // keep track of current position on this temp buffer
-            if(MULTI_ROW_REFRESH_REQUIRED) { 
-                advanceMultiRowRefreshMapToNextPixelGroup();
+                // store these pixel bits in the rowDataBuffer, leaving the initial pixels as padding
+                currentRowDataPtr->rowbits[bitindex].data[PAD_PIXELS + refreshBufferPosition] = rgbdata;
             }
+#endif
         }
+        // the power estimate expects 16-bit channels, 8-bit channels are scaled the way rgb24 expands to rgb48
+        if (channelBits == 8)
+            rowChannelSum *= 257;
+        powerChannelSum += rowChannelSum;
+        frameChannelOr |= rowChannelOr >> (channelBits - COLOR_DEPTH_BITS);
 
         unsigned int addressbits;
 
@@ -544,13 +1232,8 @@ FASTRUN INLINE void SmartMatrixHub75Calc<refreshDepth, matrixWidth, matrixHeight
         // record the address in the first rowAddress field in the rowBitStruct (other rowAddress fields are unused)
         currentRowDataPtr->rowbits[0].rowAddress = addressbits;
 
-        if(MULTI_ROW_REFRESH_REQUIRED) { 
-            c += numPixelsPerTempRow; // keep track of cumulative number of pixels filled in refresh buffer before this temp buffer
-
-            advanceMultiRowRefreshMapToNextRow();
-            multiRowRefreshRowOffset = getMultiRowRefreshRowOffset();
-        }
-    } while (MULTI_ROW_REFRESH_REQUIRED ? (multiRowRefreshRowOffset > 0) : 0);
+        SM_PROFILE_END(packingStart, profilingStats.bitplanePacking);
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
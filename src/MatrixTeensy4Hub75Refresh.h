@@ -26,6 +26,23 @@
 
 #include <lib/FlexIO_t4/FlexIO_t4.h> // requires FlexIO_t4 library from https://github.com/KurtE/FlexIO_t4
 
+// Where SMARTMATRIX_ALLOCATE_BUFFERS puts the row buffers, define SM_T4_ROW_BUFFER_PLACEMENT before including SmartMatrix.h:
+//   SM_T4_ROW_BUFFER_OCRAM: DMAMEM (RAM2), packing writes go through the data cache and each row is flushed before DMA reads it
+//   SM_T4_ROW_BUFFER_DTCM: RAM1 with the sketch's variables, which isn't cached, so rows are packed at full speed and need no flush,
+//                          but RAM1 is shared with FASTRUN code and the stack
+#define SM_T4_ROW_BUFFER_OCRAM          0
+#define SM_T4_ROW_BUFFER_DTCM           1
+
+#ifndef SM_T4_ROW_BUFFER_PLACEMENT
+#define SM_T4_ROW_BUFFER_PLACEMENT      SM_T4_ROW_BUFFER_OCRAM
+#endif
+
+#if (SM_T4_ROW_BUFFER_PLACEMENT == SM_T4_ROW_BUFFER_DTCM)
+#define SM_T4_ROW_BUFFER_MEMSECTION
+#else
+#define SM_T4_ROW_BUFFER_MEMSECTION     DMAMEM
+#endif
+
 // Number of 32-bit FlexIO shifters to use for data buffering.
 // Larger numbers decrease DMA usage.
 // Known working: 1, 2, 3, 4
@@ -34,19 +51,26 @@
 // Padding added to the row data struct to ensure it is divided evenly by the FlexIO buffer size plus extra padding for robustness
 #define PAD_PIXELS                      (((-PIXELS_PER_LATCH) % SHIFTER_PIXELS + SHIFTER_PIXELS) % SHIFTER_PIXELS + SHIFTER_PIXELS)
 
-#define PIXELS_PER_WORD                 2
+// a 32-bit shifter holds two 16-bit clocks of RGB data, or one 32-bit clock when a second chain needs more than 16 pins
+#define PIXELS_PER_WORD                 ((HUB75_PARALLEL_CHAINS > 1) ? 1 : 2)
 #define SHIFTER_PIXELS                  (RGBDATA_SHIFTERS*PIXELS_PER_WORD)
 
+template <bool wide> struct smT4ClockWord { typedef uint16_t type; };
+template <> struct smT4ClockWord<true> { typedef uint32_t type; };
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 class SmartMatrixRefreshT4 {
     public:
+        // RGB data output on one clock, for all chains
+        typedef typename smT4ClockWord<(HUB75_PARALLEL_CHAINS > 1)>::type clockWord;
+
         struct __attribute__((packed, aligned(2))) timerpair {
             uint16_t timer_oe;
             uint16_t timer_period;
         };
 
         struct __attribute__((packed, aligned(4))) rowBitStruct {
-            uint16_t data[PAD_PIXELS + PIXELS_PER_LATCH];
+            clockWord data[PAD_PIXELS + PIXELS_PER_LATCH];
             uint32_t rowAddress;
             timerpair timerValues __attribute__((aligned(2)));
         };
@@ -77,12 +101,43 @@ class SmartMatrixRefreshT4 {
         static void writeRowBuffer(uint8_t currentRow);
         static void recoverFromDmaUnderrun(void);
         static bool isRowBufferFree(void);
+        // rows the calc fills ahead, 2 up to the buffer_rows allocated
+        static void setRowBufferDepth(uint8_t rows);
+        // rows ready for refresh, including the one being shown
+        static uint8_t getRowBufferQueuedRows(void);
+        // SM_HUB75_OPTIONS_T4_FRAME_REPLAY: true when the buffer has a slot for every row, so buffer slot n always holds row n, and the
+        // slot writeRowBuffer() fills next, which is the next row the calc writes
+        static bool isFrameReplayAvailable(void) { return frameReplayAvailable; };
+        static uint8_t getNextRowBufferIndex(void);
+        // once the buffer holds a full frame: with the buffer empty, the row after the one just shown is shown again from its slot
+        // instead of underrunning, and the calc is only called before row 0
+        static void setFrameReplay(bool enabled);
+        // true once after the timer LUT changed, the timer values stored with replayed rows are out of date
+        static bool getTimerLUTChanged(void);
         static void setRefreshRate(uint16_t newRefreshRate);
         static void setBrightness(uint8_t newBrightness);
+        // pixel clock is 480 MHz / divider, FLEXIO_CLOCK_DIVIDER from the hardware header by default, rounded to an even divider from
+        // SM_T4_MIN_PIXEL_CLOCK_DIVIDER to 512: the timer LUT is recalculated for the new shift time, and the refresh rate lowered if needed
+        static void setPixelClockDivider(uint16_t divider);
+        static uint16_t getPixelClockDivider(void) { return pixelClockDivider; };
+        // ticks the LEDs of one row are lit for at full value (all bitplanes), and the ticks taken to show the row, from the timer LUT
+        static uint32_t getRowLitTicks(void);
+        static uint32_t getRowPeriodTicks(void);
+        // with SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES: the bitplanes below lowPlanes have no bits set in the content, called by the calc
+        // at each frame start, and the number of low bitplanes the calc can skip packing, which includes bitplanes unlit at the current
+        // brightness.  A drop in that number is packed at once, but only unblanked in the timer LUT two frame starts later, once every
+        // row written has been packed with the lower number
+        static void setContentLowPlanes(uint8_t lowPlanes);
+        static uint8_t getSkippedPlanes(void);
         static void setMatrixCalculationsCallback(matrix_calc_callback f);
         static void setMatrixUnderrunCallback(matrix_underrun_callback f);
-        static const flexPinConfigStruct & getFlexPinConfig(void);
+        // chain 1 is only configured with SM_HUB75_OPTIONS_T4_DUAL_CHAIN
+        static const flexPinConfigStruct & getFlexPinConfig(uint8_t chain = 0);
         static void setRowAddress(unsigned int row);
+        // for the swap latency stats: mark the row buffer the next writeRowBuffer() fills, and get micros() from when refresh started
+        // shifting it out, which returns false until then (SM_PROFILING_ENABLED only)
+        static void markNextRowBuffer(void);
+        static bool getMarkedRowShiftMicros(uint32_t & shiftMicros);
 
     private:
         // enable ISR access to private member variables
@@ -96,15 +151,28 @@ class SmartMatrixRefreshT4 {
 
         // configuration helper function
         static void calculateTimerLUT(void);
+        static void checkMarkedRowBuffer(int row);
 
         static int dimmingFactor;
         static const int dimmingMaximum = 255;
         static uint16_t rowBitStructBytesToShift;
         static uint16_t refreshRate;
+        static uint16_t pixelClockDivider;
         static uint8_t dmaBufferNumRows;
+        static volatile uint8_t dmaBufferDepth;
         static volatile rowDataStruct * matrixUpdateRows;
+        static bool frameReplayAvailable;
+        static volatile bool frameReplay;
+        static volatile bool timerLUTChanged;
 
         static timerpair timerLUT[LATCHES_PER_ROW];
+        static uint32_t rowLitTicks;
+        static uint32_t rowPeriodTicks;
+        static uint8_t contentLowPlanes;
+        // blanked in the timer LUT, packed by the calc, and the frame starts left before a lower packedPlanes is unblanked
+        static uint8_t skippedPlanes;
+        static uint8_t packedPlanes;
+        static uint8_t unblankFrames;
         static timerpair timerPairIdle;
         static matrix_calc_callback matrixCalcCallback;
         static matrix_underrun_callback matrixUnderrunCallback;
@@ -116,7 +184,12 @@ class SmartMatrixRefreshT4 {
         static uint8_t submodule;
         static volatile uint8_t enablerSourceByte;
         static flexPinConfigStruct flexPinConfig;
+        static flexPinConfigStruct chain1PinConfig;
         static flexPinConfigStruct addxPinConfig;
+
+        static volatile int8_t markedRowBuffer;
+        static volatile bool markedRowShifted;
+        static volatile uint32_t markedRowShiftMicros;
 };
 
 #endif
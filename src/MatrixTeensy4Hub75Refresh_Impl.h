@@ -37,7 +37,10 @@
 #define LATCH_TIMER_PULSE_WIDTH_TICKS   NS_TO_TICKS(LATCH_TIMER_PULSE_WIDTH_NS)
 #define TICKS_PER_ROW                   ((TIMER_FREQUENCY)/refreshRate/(MATRIX_SCAN_MOD))
 #define IDEAL_MSB_BLOCK_TICKS           (TICKS_PER_ROW/2) * (1<<LATCHES_PER_ROW) / ((1<<LATCHES_PER_ROW) - 1)
-#define MIN_BLOCK_PERIOD_NS             (LATCH_TO_CLK_DELAY_NS + ((PANEL_32_PIXELDATA_TRANSFER_MAXIMUM_NS*(PAD_PIXELS+PIXELS_PER_LATCH))/32))
+// the hardware header's transfer time is for FLEXIO_CLOCK_DIVIDER, adjusted by the time 32 clocks take at the divider set at runtime
+#define PIXELDATA_32_TRANSFER_NS        (PANEL_32_PIXELDATA_TRANSFER_MAXIMUM_NS + \
+                                            (32 * ((int)SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPixelClockDivider() - FLEXIO_CLOCK_DIVIDER) * 1000 / 480))
+#define MIN_BLOCK_PERIOD_NS             (LATCH_TO_CLK_DELAY_NS + ((PIXELDATA_32_TRANSFER_NS*(PAD_PIXELS+PIXELS_PER_LATCH))/32))
 
 #define MIN_BLOCK_PERIOD_TICKS          (NS_TO_TICKS(MIN_BLOCK_PERIOD_NS))
 //#define MSB_BLOCK_TICKS_ADJUSTMENT_INCREMENT    10
@@ -45,11 +48,27 @@
 #define MIN_REFRESH_RATE                (((TIMER_FREQUENCY)/65535*(1<<LATCHES_PER_ROW)/((1<<LATCHES_PER_ROW) - 1)/(MATRIX_SCAN_MOD)/2) + 1) // cannot refresh slower than this due to PWM register overflow
 #define MAX_REFRESH_RATE                ((TIMER_FREQUENCY)/(MIN_BLOCK_PERIOD_TICKS)/(MATRIX_SCAN_MOD)/(LATCHES_PER_ROW) - 1) // cannot refresh faster than this due to output bandwidth
 
-#define ROW_CALCULATION_ISR_PRIORITY    240 // lowest priority for IMXRT1062
+// one step above the lowest priority (240), where the APA102 calc runs, so with both on one Teensy a HUB75 row isn't held up behind a whole APA102 frame
+// FlexIO's baud mode divides by an even number, 10 (48 MHz) is already past what HUB75 panels and buffers are specified for
+#ifndef SM_T4_MIN_PIXEL_CLOCK_DIVIDER
+#define SM_T4_MIN_PIXEL_CLOCK_DIVIDER   10
+#endif
+
+#define ROW_CALCULATION_ISR_PRIORITY    224
 #define ROW_SHIFT_COMPLETE_ISR_PRIORITY 96 // one step above USB priority
 #define TIMER_REGISTERS_TO_UPDATE       2
 
 
+// second chain for SM_HUB75_OPTIONS_T4_DUAL_CHAIN, define the pins (on the same FlexIO as the first chain) before including SmartMatrix.h
+#ifndef FLEXIO_PIN_CHAIN1_R0_TEENSY_PIN
+#define FLEXIO_PIN_CHAIN1_R0_TEENSY_PIN 0xFF
+#define FLEXIO_PIN_CHAIN1_G0_TEENSY_PIN 0xFF
+#define FLEXIO_PIN_CHAIN1_B0_TEENSY_PIN 0xFF
+#define FLEXIO_PIN_CHAIN1_R1_TEENSY_PIN 0xFF
+#define FLEXIO_PIN_CHAIN1_G1_TEENSY_PIN 0xFF
+#define FLEXIO_PIN_CHAIN1_B1_TEENSY_PIN 0xFF
+#endif
+
 extern DMAChannel dmaClockOutData;
 extern DMAChannel dmaEnable;
 extern DMAChannel dmaUpdateTimer;
@@ -77,16 +96,39 @@ CircularBuffer_SM SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight,
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferNumRows;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferDepth;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint16_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRate = 240;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint16_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::pixelClockDivider = FLEXIO_CLOCK_DIVIDER;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 uint16_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowBitStructBytesToShift;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerpair SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerLUT[LATCHES_PER_ROW];
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowLitTicks = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowPeriodTicks = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::contentLowPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::skippedPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packedPlanes = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::unblankFrames = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 DMAMEM typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerpair SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 volatile typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct * SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameReplayAvailable = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameReplay = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerLUTChanged = false;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrix_underrun_callback SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrix_calc_callback SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalcCallback;
@@ -100,6 +142,15 @@ template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char pan
 volatile uint8_t DMAMEM SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::enablerSourceByte;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfig;
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::chain1PinConfig;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile int8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowBuffer = -1;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowShifted;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+volatile uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markedRowShiftMicros;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::addxPinConfig;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
@@ -109,6 +160,7 @@ IMXRT_FLEXIO_t * SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, p
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FLASHMEM SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrixRefreshT4(uint8_t bufferrows, volatile rowDataStruct * rowDataBuf) {
     dmaBufferNumRows = bufferrows;
+    dmaBufferDepth = bufferrows;
     matrixUpdateRows = rowDataBuf;
     timerPairIdle.timer_period = MIN_BLOCK_PERIOD_TICKS;
     timerPairIdle.timer_oe = MIN_BLOCK_PERIOD_TICKS + 1;
@@ -117,20 +169,54 @@ FLASHMEM SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType
     // initialize matrixUpdateRows to all zeros to ensure all padding pixels are blank
     for (int row = 0; row < dmaBufferNumRows; row++) {
         memset((void*) &matrixUpdateRows[row], 0, sizeof(rowDataStruct));
-        arm_dcache_flush((void*) &matrixUpdateRows[row], sizeof(rowDataStruct));
+        if (SM_T4_ROW_BUFFER_PLACEMENT == SM_T4_ROW_BUFFER_OCRAM)
+            arm_dcache_flush((void*) &matrixUpdateRows[row], sizeof(rowDataStruct));
     }
 }
 
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FASTRUN bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::isRowBufferFree(void) {
-    if (cbIsFull(&dmaBuffer))
+    if (cbIsFull(&dmaBuffer) || dmaBuffer.count >= dmaBufferDepth)
         return false;
     else
         return true;
 }
 
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowBufferDepth(uint8_t rows) {
+    dmaBufferDepth = constrain(rows, 2, dmaBufferNumRows);
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBufferQueuedRows(void) {
+    return dmaBuffer.count;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferIndex(void) {
+    return cbGetNextWrite(&dmaBuffer);
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameReplay(bool enabled) {
+    frameReplay = enabled && frameReplayAvailable;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getTimerLUTChanged(void) {
+    if (!timerLUTChanged)
+        return false;
+    timerLUTChanged = false;
+    return true;
+}
+
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FASTRUN INLINE volatile typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::rowDataStruct * SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferPtr(void) {
     return &(matrixUpdateRows[cbGetNextWrite(&dmaBuffer)]);
@@ -144,8 +230,9 @@ FASTRUN INLINE void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight
         currentRowDataPtr->rowbits[i].timerValues.timer_period = timerLUT[i].timer_period;
         currentRowDataPtr->rowbits[i].timerValues.timer_oe = timerLUT[i].timer_oe;
     }
-    // Now we have refreshed the rowDataStruct for this row and we need to flush cache so that the changes are seen by DMA
-    arm_dcache_flush((void*) currentRowDataPtr, sizeof(rowDataStruct));
+    // Now we have refreshed the rowDataStruct for this row and we need to flush cache so that the changes are seen by DMA, DTCM isn't cached
+    if (SM_T4_ROW_BUFFER_PLACEMENT == SM_T4_ROW_BUFFER_OCRAM)
+        arm_dcache_flush((void*) currentRowDataPtr, sizeof(rowDataStruct));
     cbWrite(&dmaBuffer); // after cache is flushed, mark this row as ready to be displayed
 }
 
@@ -157,6 +244,7 @@ FASTRUN void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panel
 
     // point DMA addresses to the next buffer
     int currentRow = cbGetNextRead(&dmaBuffer);
+    checkMarkedRowBuffer(currentRow);
 
     dmaUpdateTimer.TCD->SADDR = &(SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[0].timerValues.timer_oe);
     dmaClockOutData.TCD->SADDR = SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[0].data;
@@ -185,6 +273,36 @@ void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, op
 }
 
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::markNextRowBuffer(void) {
+    markedRowShifted = false;
+    markedRowBuffer = cbGetNextWrite(&dmaBuffer);
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+bool SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getMarkedRowShiftMicros(uint32_t & shiftMicros) {
+    if (!markedRowShifted)
+        return false;
+    shiftMicros = markedRowShiftMicros;
+    markedRowShifted = false;
+    return true;
+}
+
+
+// called with each row buffer DMA starts shifting out
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+FASTRUN INLINE void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::checkMarkedRowBuffer(int row) {
+#if (SM_PROFILING_ENABLED == 1)
+    if (row == markedRowBuffer) {
+        markedRowShiftMicros = micros();
+        markedRowShifted = true;
+        markedRowBuffer = -1;
+    }
+#endif
+}
+
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::calculateTimerLUT(void) {
     int i;
@@ -224,6 +342,41 @@ void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, op
         timerLUT[i].timer_oe = ontime;
     }
 
+    // low bitplanes with nothing to show are blanked and shortened to the time it takes to shift them, the MSB is always kept as the
+    // ISR updating the next row relies on it being the longest
+    if (optionFlags & SM_HUB75_OPTIONS_T4_ADAPTIVE_BITPLANES) {
+        for (i = 0; i < LATCHES_PER_ROW - 1; i++) {
+            bool unlit = (timerLUT[i].timer_period + 1 <= timerLUT[i].timer_oe);
+            if (i >= contentLowPlanes && !unlit)
+                break;
+        }
+
+        // the calc packs from the new count at once.  Blanking more planes is safe for rows already queued, but a plane unblanked now
+        // would show whatever an earlier row left in the rows packed without it, so a lower count stays blanked until
+        // setContentLowPlanes() has seen a full frame packed from it
+        if (i >= skippedPlanes) {
+            skippedPlanes = i;
+            unblankFrames = 0;
+        } else if (!unblankFrames || i < packedPlanes) {
+            unblankFrames = 2;
+        }
+        packedPlanes = i;
+
+        for (i = 0; i < skippedPlanes; i++) {
+            timerLUT[i].timer_period = MIN_BLOCK_PERIOD_TICKS - 1;
+            timerLUT[i].timer_oe = MIN_BLOCK_PERIOD_TICKS;
+        }
+    }
+
+    // OE is enabled from timer_oe to the end of the period
+    rowLitTicks = 0;
+    rowPeriodTicks = 0;
+    for (i = 0; i < LATCHES_PER_ROW; i++) {
+        rowLitTicks += timerLUT[i].timer_period + 1 - timerLUT[i].timer_oe;
+        rowPeriodTicks += timerLUT[i].timer_period + 1;
+    }
+    timerLUTChanged = true;
+
 #if 0
     // print look-up table (for debugging)
     Serial.print("Refresh rate: "); Serial.print(refreshRate); Serial.print(" (Min/Max: "); Serial.print(MIN_REFRESH_RATE); Serial.print("/"); Serial.print(MAX_REFRESH_RATE); Serial.println(")");
@@ -244,6 +397,62 @@ void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, op
 }
 
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setContentLowPlanes(uint8_t lowPlanes) {
+    // two frame starts after the count dropped, the frame in between was packed from it whenever the drop happened
+    bool unblank = unblankFrames && !--unblankFrames;
+    if (lowPlanes == contentLowPlanes && !unblank)
+        return;
+    contentLowPlanes = lowPlanes;
+    if (unblank)
+        skippedPlanes = packedPlanes;
+    calculateTimerLUT();
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint8_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getSkippedPlanes(void) {
+    return packedPlanes;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowLitTicks(void) {
+    return rowLitTicks;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+uint32_t SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowPeriodTicks(void) {
+    return rowPeriodTicks;
+}
+
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
+void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setPixelClockDivider(uint16_t divider) {
+    divider &= ~1;
+    if (divider < SM_T4_MIN_PIXEL_CLOCK_DIVIDER)
+        divider = SM_T4_MIN_PIXEL_CLOCK_DIVIDER;
+    if (divider > 512)
+        divider = 512;
+    pixelClockDivider = divider;
+
+    // the idle period has to fit a row's shift at the new clock too
+    timerPairIdle.timer_period = MIN_BLOCK_PERIOD_TICKS;
+    timerPairIdle.timer_oe = MIN_BLOCK_PERIOD_TICKS + 1;
+    arm_dcache_flush((void*)&timerPairIdle, sizeof(timerPairIdle));
+
+    // takes effect from the next shifter reload, a row being shifted out while this is written can show garbage for one refresh
+    if (flexIO) {
+        uint8_t shiftsPerReload = RGBDATA_SHIFTERS * PIXELS_PER_WORD;
+        flexIO->TIMCMP[0] = ((shiftsPerReload * 2 - 1) << 8) | ((pixelClockDivider / 2 - 1) << 0);
+    }
+
+    // clamps the refresh rate to what the new clock can reach, and recalculates the timer LUT
+    setRefreshRate(refreshRate);
+}
+
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRefreshRate(uint16_t newRefreshRate) {
     if (newRefreshRate <= MIN_REFRESH_RATE)
@@ -258,7 +467,15 @@ void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, op
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::begin(void) {
-    cbInit(&dmaBuffer, dmaBufferNumRows);
+    // a ring of exactly MATRIX_SCAN_MOD slots keeps every row in its own slot, as the calc writes the rows in order
+    frameReplayAvailable = false;
+    if (optionFlags & SM_HUB75_OPTIONS_T4_FRAME_REPLAY) {
+        if (dmaBufferNumRows >= MATRIX_SCAN_MOD)
+            frameReplayAvailable = true;
+        else
+            Serial.println("Error: SM_HUB75_OPTIONS_T4_FRAME_REPLAY needs buffer_rows of at least MATRIX_SCAN_MOD, frames won't be replayed");
+    }
+    cbInit(&dmaBuffer, frameReplayAvailable ? MATRIX_SCAN_MOD : dmaBufferNumRows);
 
     // set refresh rate and fill timerLUT
     setRefreshRate(refreshRate);
@@ -443,6 +660,14 @@ FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, pane
     pFlex->setIOPinToFlexMode(FLEXIO_PIN_G0_TEENSY_PIN);
     pFlex->setIOPinToFlexMode(FLEXIO_PIN_G1_TEENSY_PIN);
     pFlex->setIOPinToFlexMode(FLEXIO_PIN_B1_TEENSY_PIN);
+    if (HUB75_PARALLEL_CHAINS > 1) {
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_R0_TEENSY_PIN);
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_G0_TEENSY_PIN);
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_B0_TEENSY_PIN);
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_R1_TEENSY_PIN);
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_G1_TEENSY_PIN);
+        pFlex->setIOPinToFlexMode(FLEXIO_PIN_CHAIN1_B1_TEENSY_PIN);
+    }
 
     // Enable the clock
     pFlex->hardware().clock_gate_register |= pFlex->hardware().clock_gate_mask;
@@ -470,11 +695,26 @@ FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, pane
     highestFlexPin = max(highestFlexPin, g1FlexPin);
     highestFlexPin = max(highestFlexPin, b1FlexPin);
 
+    // the second chain's pins share the shifter output window, a pin that isn't on this FlexIO maps to 0xFF and fails validation
+    bool correctChain1Config = true;
+    if (HUB75_PARALLEL_CHAINS > 1) {
+        const uint8_t chain1Pins[6] = { FLEXIO_PIN_CHAIN1_R0_TEENSY_PIN, FLEXIO_PIN_CHAIN1_G0_TEENSY_PIN, FLEXIO_PIN_CHAIN1_B0_TEENSY_PIN,
+                                        FLEXIO_PIN_CHAIN1_R1_TEENSY_PIN, FLEXIO_PIN_CHAIN1_G1_TEENSY_PIN, FLEXIO_PIN_CHAIN1_B1_TEENSY_PIN };
+        for (int i = 0; i < 6; i++) {
+            uint8_t flexPin = pFlex->mapIOPinToFlexPin(chain1Pins[i]);
+            correctChain1Config = correctChain1Config && (flexPin != 0xFF);
+            lowestFlexPin = min(lowestFlexPin, flexPin);
+            highestFlexPin = max(highestFlexPin, flexPin);
+        }
+    }
+
     // To ensure that 16 bit shifting is used, we must use at least 9 contiguous pins (no more than 16)
-    highestFlexPin = max(highestFlexPin, lowestFlexPin + 8);
+    // two chains need more than 16 pins, so shift 32 bits per clock: at least 17 contiguous pins (no more than 32)
+    const uint8_t shifterWidth = (HUB75_PARALLEL_CHAINS > 1) ? 32 : 16;
+    highestFlexPin = max(highestFlexPin, lowestFlexPin + shifterWidth / 2);
 
     // Validate that the pin configuration is correct
-    const bool correctFlexConfig = (highestFlexPin < lowestFlexPin + 16) & ((clkFlexPin < lowestFlexPin) | (clkFlexPin > highestFlexPin));
+    const bool correctFlexConfig = correctChain1Config & (highestFlexPin < lowestFlexPin + shifterWidth) & ((clkFlexPin < lowestFlexPin) | (clkFlexPin > highestFlexPin));
     if (!correctFlexConfig) {
         Serial.println("Error: incorrect FlexIO pin configuration!");
     }
@@ -487,6 +727,15 @@ FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, pane
     flexPinConfig.g1 = pFlex->mapIOPinToFlexPin(G_1_SIGNAL) - lowestFlexPin;
     flexPinConfig.b1 = pFlex->mapIOPinToFlexPin(B_1_SIGNAL) - lowestFlexPin;
 
+    if (HUB75_PARALLEL_CHAINS > 1) {
+        chain1PinConfig.r0 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_R0_TEENSY_PIN) - lowestFlexPin;
+        chain1PinConfig.g0 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_G0_TEENSY_PIN) - lowestFlexPin;
+        chain1PinConfig.b0 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_B0_TEENSY_PIN) - lowestFlexPin;
+        chain1PinConfig.r1 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_R1_TEENSY_PIN) - lowestFlexPin;
+        chain1PinConfig.g1 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_G1_TEENSY_PIN) - lowestFlexPin;
+        chain1PinConfig.b1 = pFlex->mapIOPinToFlexPin(FLEXIO_PIN_CHAIN1_B1_TEENSY_PIN) - lowestFlexPin;
+    }
+
     // determine the bit offsets of the address signals
     addxPinConfig.addx0 = pFlex->mapIOPinToFlexPin(ADDX_0_SIGNAL) - lowestFlexPin;
     addxPinConfig.addx1 = pFlex->mapIOPinToFlexPin(ADDX_1_SIGNAL) - lowestFlexPin;
@@ -566,7 +815,7 @@ FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, pane
     // Lower 8 bits configure the FlexIO clock divide ratio to generate the pixel clock
     // Upper 8 bits configure the number of pixel clock cycles to be generated each time the shifters are reloaded
     uint8_t shiftsPerReload = RGBDATA_SHIFTERS * PIXELS_PER_WORD;
-    flexIO->TIMCMP[0] = ((shiftsPerReload * 2 - 1) << 8) | ((FLEXIO_CLOCK_DIVIDER / 2 - 1) << 0);
+    flexIO->TIMCMP[0] = ((shiftsPerReload * 2 - 1) << 8) | ((pixelClockDivider / 2 - 1) << 0);
 
     // Enable DMA trigger when data is loaded into the last data shifter so that reloading will occur automatically
     flexIO->SHIFTSDEN |= (1 << (RGBDATA_SHIFTERS - 1));
@@ -757,7 +1006,9 @@ FLASHMEM void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, pane
 // low priority ISR triggered by software interrupt on a DMA channel that doesn't need interrupts otherwise
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
 FASTRUN void rowCalculationISR(void) {
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_ENTRY, SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
     SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixCalcCallback(false);
+    SM_TRACE_ISR(SM_ISR_TRACE_ROW_CALC, SM_ISR_TRACE_EXIT, SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
 }
 
 
@@ -776,8 +1027,17 @@ FASTRUN void rowShiftCompleteISR(void) {
     dmaClockOutData.clearInterrupt();
 
     if ((dmaEnable.TCD->CITER) == (dmaEnable.TCD->BITER)) {
+        // only the end of each row is traced, so the entry intervals are row periods
+        SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_ENTRY, SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
         cbRead(&SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
 
+        // nothing new from the calc, the next slot still holds the next row from the last frame packed, queue it again
+        bool replayed = false;
+        if (cbIsEmpty(&SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer) && SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameReplay) {
+            cbWrite(&SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
+            replayed = true;
+        }
+
         if (cbIsEmpty(&SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer)) { // underrun
             // point dmaUpdateTimer to repeatedly load from values that set mod to MIN_BLOCK_PERIOD_TICKS and disable OE
             dmaUpdateTimer.TCD->SADDR = &SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle;
@@ -788,23 +1048,28 @@ FASTRUN void rowShiftCompleteISR(void) {
 
             // set flag so other ISR can enable DMA again when data is ready
             SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUnderrunCallback();
+            SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_UNDERRUN, 0);
         } else {
             // get next row to draw to display and update DMA pointers
             int currentRow = cbGetNextRead(&SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer);
             dmaClockOutData.TCD->SADDR = SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[0].data;
             dmaUpdateTimer.TCD->SADDR = &(SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[currentRow].rowbits[0].timerValues.timer_oe);
             SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setRowAddress(currentRow); // change the row address we send to the panel
+            SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::checkMarkedRowBuffer(currentRow);
         }
 
-        // trigger software interrupt to call rowCalculationISR() (DMA channel interrupt used instead of actual softint)
-        NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaUpdateTimer.channel);
+        // trigger software interrupt to call rowCalculationISR() (DMA channel interrupt used instead of actual softint), while rows are
+        // replayed the calc has nothing to do until the next frame starts
+        if (!replayed || SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getNextRowBufferIndex() == 0)
+            NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaUpdateTimer.channel);
+        SM_TRACE_ISR(SM_ISR_TRACE_ROW_SHIFT, SM_ISR_TRACE_EXIT, SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBuffer.count);
     } // if the last bitplane was not just completed, do nothing
 }
 
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, uint32_t optionFlags>
-FASTRUN INLINE const typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct & SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(void) {
-    return flexPinConfig;
+FASTRUN INLINE const typename SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::flexPinConfigStruct & SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFlexPinConfig(uint8_t chain) {
+    return chain ? chain1PinConfig : flexPinConfig;
 }
 
 
@@ -813,7 +1078,8 @@ FASTRUN void SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panel
     // Row addressing makes use of the same pins that output RGB color data. This is enabled by additional hardware on the SmartLED Shield.
     // The row address signals are latched when the BUFFER_LATCH pin goes high. We need to output the address data without any clock pulses
     // to avoid garbage pixel data. We can do this by putting the address data into a final FlexIO shifter which outputs when the data shifters
-    // are emptied (at the end of the row transfer after the DMA channel completes). Only the lower 16 bits will output. */
+    // are emptied (at the end of the row transfer after the DMA channel completes). Only the lower 16 bits (32 with two chains) will output.
+    // With two chains the address is only output on the first chain's pins, the address latch drives both chains. */
     unsigned int currentRowAddress = SmartMatrixRefreshT4<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateRows[row].rowbits[0].rowAddress;
 
     uint32_t addressData = 0;
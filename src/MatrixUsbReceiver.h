@@ -0,0 +1,120 @@
+/*
+ * SmartMatrix Library - USB Frame Stream Receiver
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MATRIX_USB_RECEIVER_H_
+#define _MATRIX_USB_RECEIVER_H_
+
+// Receives frames from a host over USB serial (or any Stream) into an SMLayerBackground, swapping buffers after each frame.
+// Call update() from loop(), it reads whatever has arrived without waiting for more.  Teensy 4's USB serial runs at 480 Mbit, and
+// readBytes() copies straight out of the USB receive buffers, so raw frames for an rgb24 layer without rotation are read directly
+// into the drawing buffer; other layers and encodings go through a one row buffer and drawBitmap().
+//
+// Not included by SmartMatrix.h, include it after SmartMatrix.h.  extras/tools/smusbsend.py is a reference sender.
+//
+// Each frame is an 8 byte header followed by the encoded frame, pixels are 8-bit RGB in local (rotated) row-major order:
+//   'S' 'M' 'F' encoding width(16-bit little endian) height(16-bit little endian)
+//   SM_USB_FRAME_RAW:          width * height pixels
+//   SM_USB_FRAME_RLE:          runs until the frame is full, code byte n < 0x80: n+1 pixels follow, n >= 0x80: one pixel repeated (n & 0x7F)+1 times
+//   SM_USB_FRAME_DELTA_ROWS:   changed rows only: row number (16-bit little endian) then width pixels, until row number 0xFFFF
+// A header that doesn't match the layer's size is counted as an error and skipped, the receiver resyncs on the next 'SMF'.
+
+#include "Layer_Background.h"
+
+#define SM_USB_FRAME_RAW            0
+#define SM_USB_FRAME_RLE            1
+#define SM_USB_FRAME_DELTA_ROWS     2
+
+#define SM_USB_FRAME_HEADER_SIZE    8
+#define SM_USB_FRAME_END_OF_ROWS    0xFFFF
+
+typedef struct smUsbReceiverStats {
+    uint32_t bytes;         // bytes read, including headers
+    uint32_t frames;        // buffer swaps
+    uint32_t errors;        // headers with an unknown encoding or size, and delta rows out of range
+    uint32_t resyncs;       // bytes skipped looking for a header
+    uint32_t startMillis;   // when the stats were last reset
+} smUsbReceiverStats;
+
+template <typename RGB, unsigned int optionFlags>
+class SMUsbFrameReceiver {
+    public:
+        SMUsbFrameReceiver(SMLayerBackground<RGB, optionFlags> * layer, Stream & stream = Serial);
+        // call after the layer has been added to the matrix, allocates the row buffer
+        bool begin(void);
+        void update(void);
+
+        const smUsbReceiverStats & getStats(void) const { return stats; };
+        void resetStats(void);
+        // received bytes per second since the stats were reset
+        uint32_t getBytesPerSecond(void) const;
+        uint32_t getFramesPerSecond(void) const;
+
+    protected:
+        typedef enum {
+            stateHeader,
+            stateRaw,
+            stateRleCode,
+            stateRlePixel,
+            stateRleLiteral,
+            stateDeltaRow,
+            stateDeltaData,
+        } receiverState;
+
+        void startFrame(void);
+        void finishFrame(void);
+        // row buffer helpers for the RLE and delta encodings, rowFill is the number of bytes in rowBuffer
+        void flushRow(void);
+        void fillRun(void);
+        size_t readInto(uint8_t * dst, size_t count);
+
+        SMLayerBackground<RGB, optionFlags> * layer;
+        Stream * stream;
+        receiverState state = stateHeader;
+
+        uint8_t header[SM_USB_FRAME_HEADER_SIZE];
+        uint8_t headerBytes = 0;
+
+        uint16_t width = 0;
+        uint16_t height = 0;
+        uint32_t rowBytes = 0;
+        uint8_t * rowBuffer = NULL;
+        uint32_t rowFill = 0;
+        uint16_t currentRow = 0;
+
+        // raw frames read straight into the drawing buffer, NULL when going through rowBuffer
+        uint8_t * directBuffer = NULL;
+        uint32_t directFill = 0;
+
+        uint8_t runPixel[3];
+        uint8_t runPixelBytes = 0;
+        uint16_t runLength = 0;
+        uint32_t literalBytes = 0;
+        uint8_t deltaRowBytes[2];
+        uint8_t deltaRowByteCount = 0;
+
+        smUsbReceiverStats stats;
+};
+
+#include "MatrixUsbReceiver_Impl.h"
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * SmartMatrix Library - USB Frame Stream Receiver
+ *
+ * Copyright (c) 2020 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+template <typename RGB, unsigned int optionFlags>
+SMUsbFrameReceiver<RGB, optionFlags>::SMUsbFrameReceiver(SMLayerBackground<RGB, optionFlags> * layer, Stream & stream) {
+    this->layer = layer;
+    this->stream = &stream;
+    resetStats();
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMUsbFrameReceiver<RGB, optionFlags>::begin(void) {
+    // big enough for a row in either orientation, so rotation can change later
+    uint32_t maxRowBytes = (uint32_t)std::max(layer->getLocalWidth(), layer->getLocalHeight()) * 3;
+    if(!rowBuffer)
+        rowBuffer = (uint8_t *)malloc(maxRowBytes);
+    if(!rowBuffer) {
+        Serial.println("Error: SMUsbFrameReceiver can't allocate row buffer");
+        return false;
+    }
+    state = stateHeader;
+    headerBytes = 0;
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::resetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+    stats.startMillis = millis();
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMUsbFrameReceiver<RGB, optionFlags>::getBytesPerSecond(void) const {
+    uint32_t elapsed = millis() - stats.startMillis;
+    return elapsed ? (uint32_t)(((uint64_t)stats.bytes * 1000) / elapsed) : 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMUsbFrameReceiver<RGB, optionFlags>::getFramesPerSecond(void) const {
+    uint32_t elapsed = millis() - stats.startMillis;
+    return elapsed ? (uint32_t)(((uint64_t)stats.frames * 1000) / elapsed) : 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+size_t SMUsbFrameReceiver<RGB, optionFlags>::readInto(uint8_t * dst, size_t count) {
+    size_t received = stream->readBytes((char *)dst, count);
+    stats.bytes += received;
+    return received;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::startFrame(void) {
+    uint8_t encoding = header[3];
+    width = header[4] | (header[5] << 8);
+    height = header[6] | (header[7] << 8);
+    headerBytes = 0;
+
+    if(!rowBuffer || encoding > SM_USB_FRAME_DELTA_ROWS || width != layer->getLocalWidth() || height != layer->getLocalHeight()) {
+        stats.errors++;
+        state = stateHeader;
+        return;
+    }
+
+    rowBytes = (uint32_t)width * 3;
+    rowFill = 0;
+    currentRow = 0;
+    directBuffer = NULL;
+
+    if(encoding == SM_USB_FRAME_RAW) {
+        // an rgb24 drawing buffer without rotation has the same layout as the stream
+        if(sizeof(RGB) == sizeof(rgb24) && layer->getLayerRotation() == rotation0) {
+            directBuffer = (uint8_t *)layer->backBuffer();
+            directFill = 0;
+        }
+        state = stateRaw;
+    } else if(encoding == SM_USB_FRAME_RLE) {
+        state = stateRleCode;
+    } else {
+        deltaRowByteCount = 0;
+        state = stateDeltaRow;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::finishFrame(void) {
+    // delta frames build on the previous frame, so the drawing buffer always starts as a copy of what was just sent
+    layer->swapBuffers(true);
+    stats.frames++;
+    state = stateHeader;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::flushRow(void) {
+    layer->drawBitmap(0, currentRow, width, 1, rowBuffer, SM_BITMAP_FORMAT_RGB24);
+    rowFill = 0;
+    currentRow++;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::fillRun(void) {
+    while(runLength && currentRow < height) {
+        uint32_t count = std::min<uint32_t>(runLength, (rowBytes - rowFill) / 3);
+        for(uint32_t i = 0; i < count; i++, rowFill += 3)
+            memcpy(rowBuffer + rowFill, runPixel, 3);
+        runLength -= count;
+        if(rowFill == rowBytes)
+            flushRow();
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMUsbFrameReceiver<RGB, optionFlags>::update(void) {
+    static const char magic[] = "SMF";
+    int available;
+
+    while((available = stream->available()) > 0) {
+        switch(state) {
+            case stateHeader: {
+                uint8_t c = stream->read();
+                stats.bytes++;
+                // drop bytes until the magic lines up, a mismatched byte may itself start the magic
+                if(headerBytes < 3 && c != (uint8_t)magic[headerBytes]) {
+                    stats.resyncs++;
+                    headerBytes = 0;
+                    if(c != (uint8_t)magic[0])
+                        break;
+                }
+                header[headerBytes++] = c;
+                if(headerBytes == SM_USB_FRAME_HEADER_SIZE)
+                    startFrame();
+                break;
+            }
+
+            case stateRaw:
+                if(directBuffer) {
+                    directFill += readInto(directBuffer + directFill, std::min<uint32_t>(available, rowBytes * height - directFill));
+                    if(directFill == rowBytes * height)
+                        finishFrame();
+                } else {
+                    rowFill += readInto(rowBuffer + rowFill, std::min<uint32_t>(available, rowBytes - rowFill));
+                    if(rowFill == rowBytes)
+                        flushRow();
+                    if(currentRow == height)
+                        finishFrame();
+                }
+                break;
+
+            case stateRleCode: {
+                uint8_t code = stream->read();
+                stats.bytes++;
+                if(code & 0x80) {
+                    runLength = (code & 0x7F) + 1;
+                    runPixelBytes = 0;
+                    state = stateRlePixel;
+                } else {
+                    literalBytes = ((uint32_t)code + 1) * 3;
+                    state = stateRleLiteral;
+                }
+                break;
+            }
+
+            case stateRlePixel:
+                runPixel[runPixelBytes++] = stream->read();
+                stats.bytes++;
+                if(runPixelBytes == 3) {
+                    fillRun();
+                    if(currentRow == height)
+                        finishFrame();
+                    else
+                        state = stateRleCode;
+                }
+                break;
+
+            case stateRleLiteral: {
+                uint32_t count = std::min<uint32_t>(std::min<uint32_t>(available, literalBytes), rowBytes - rowFill);
+                count = readInto(rowBuffer + rowFill, count);
+                rowFill += count;
+                literalBytes -= count;
+                if(rowFill == rowBytes)
+                    flushRow();
+                // a literal running past the end of the frame is cut short, the rest is skipped while resyncing
+                if(currentRow == height)
+                    finishFrame();
+                else if(!literalBytes)
+                    state = stateRleCode;
+                break;
+            }
+
+            case stateDeltaRow:
+                deltaRowBytes[deltaRowByteCount++] = stream->read();
+                stats.bytes++;
+                if(deltaRowByteCount == 2) {
+                    uint16_t row = deltaRowBytes[0] | (deltaRowBytes[1] << 8);
+                    deltaRowByteCount = 0;
+                    if(row == SM_USB_FRAME_END_OF_ROWS) {
+                        finishFrame();
+                    } else if(row >= height) {
+                        // the rest of the frame is lost, keep what was drawn for the next frame
+                        stats.errors++;
+                        state = stateHeader;
+                    } else {
+                        currentRow = row;
+                        rowFill = 0;
+                        state = stateDeltaData;
+                    }
+                }
+                break;
+
+            case stateDeltaData:
+                rowFill += readInto(rowBuffer + rowFill, std::min<uint32_t>(available, rowBytes - rowFill));
+                if(rowFill == rowBytes) {
+                    flushRow();
+                    state = stateDeltaRow;
+                }
+                break;
+        }
+    }
+}
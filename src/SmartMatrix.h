@@ -48,11 +48,22 @@
 #include "Arduino.h"
 
 #include "MatrixCommon.h"
+#include "MatrixProfiling.h"
+#include "MatrixMemoryPlanner.h"
 #include "CircularBuffer_SM.h"
 
 #include "Layer_Scrolling.h"
 #include "Layer_Indexed.h"
 #include "Layer_Background.h"
+#include "Layer_Sprites.h"
+#include "Layer_TileMap.h"
+#include "Layer_RGBA.h"
+#include "Layer_Paletted.h"
+#include "Layer_Planar.h"
+#include "Layer_External.h"
+#include "Layer_RowCallback.h"
+#include "Layer_Stack.h"
+#include "Layer_Flattened.h"
 
 // For backwards compatiblity, this needs to be defined at the top of the sketch, so that "Adafruit_GFX.h" is only included if desired
 #ifdef USE_ADAFRUIT_GFX_LAYERS
@@ -93,6 +104,11 @@
     #include "MatrixEsp32Hub75Calc_NT.h"
 #endif
 
+#if defined(SM_HOST_BUILD) // desktop build for profiling, see extras/host
+    #include "MatrixHostHub75Refresh.h"
+    #include "MatrixTeensy4Hub75Calc.h"
+#endif
+
 #include "MatrixCommonApa102Refresh.h"
 #include "MatrixCommonApa102Calc.h"
 
@@ -102,9 +118,9 @@
     #define BACKGROUND_MEMSECTION
 #endif
 
-#if defined(__arm__) && defined(CORE_TEENSY)
+#if (defined(__arm__) && defined(CORE_TEENSY)) || defined(SM_HOST_BUILD)
     // TODO: use same definition for Teensy 3.x and 4.x HUB75 SMARTMATRIX_ALLOCATE_BUFFERS() if possible 
-    #if !defined(__IMXRT1062__) // Teensy 3.x
+    #if !defined(__IMXRT1062__) && !defined(SM_HOST_BUILD) // Teensy 3.x
         #define SMARTMATRIX_ALLOCATE_BUFFERS(matrix_name, width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
             static DMAMEM SmartMatrixHub75Refresh<pwm_depth, width, height, panel_type, option_flags>::rowDataStruct rowsDataBuffer[buffer_rows]; \
             SmartMatrixHub75Refresh<pwm_depth, width, height, panel_type, option_flags> matrix_name##Refresh(buffer_rows, rowsDataBuffer); \
@@ -113,9 +129,9 @@
             static DMAMEM SmartMatrixAPA102Refresh<pwm_depth, width, height, panel_type, option_flags>::frameDataStruct frameDataBuffer[buffer_rows]; \
             SmartMatrixAPA102Refresh<pwm_depth, width, height, panel_type, option_flags> matrix_name##Refresh(buffer_rows, frameDataBuffer); \
             SmartMatrixApaCalc<pwm_depth, width, height, panel_type, option_flags> matrix_name(buffer_rows, frameDataBuffer)
-    #else   // Teensy 4.x
+    #else   // Teensy 4.x, and the host build
         #define SMARTMATRIX_ALLOCATE_BUFFERS(matrix_name, width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
-            static volatile DMAMEM SmartMatrixRefreshT4<pwm_depth, width, height, panel_type, option_flags>::rowDataStruct rowsDataBuffer[buffer_rows]; \
+            static volatile SM_T4_ROW_BUFFER_MEMSECTION SmartMatrixRefreshT4<pwm_depth, width, height, panel_type, option_flags>::rowDataStruct rowsDataBuffer[buffer_rows]; \
             SmartMatrixRefreshT4<pwm_depth, width, height, panel_type, option_flags> matrix_name##Refresh(buffer_rows, rowsDataBuffer); \
             SmartMatrixHub75Calc<pwm_depth, width, height, panel_type, option_flags> matrix_name(buffer_rows, rowsDataBuffer)
         #define SMARTMATRIX_APA_ALLOCATE_BUFFERS(matrix_name, width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
@@ -125,11 +141,21 @@
             SmartMatrixApaCalc<pwm_depth, width, height, panel_type, option_flags> matrix_name(buffer_rows, frameDataBuffer)
     #endif
 
+    // the row cache is only used on Teensy 4 here, other boards don't get the static buffer
+    #if defined(__IMXRT1062__)
+        #define SM_ALLOCATE_BACKGROUND_ROW_CACHE(layer_name, storage_depth, background_options, width) \
+            static RGB_TYPE(storage_depth) layer_name##RowCache[SM_BACKGROUND_ROW_CACHE_SIZE(background_options, width)];
+        #define SM_BACKGROUND_ROW_CACHE_BUFFER(layer_name)  layer_name##RowCache
+    #else
+        #define SM_ALLOCATE_BACKGROUND_ROW_CACHE(layer_name, storage_depth, background_options, width)
+        #define SM_BACKGROUND_ROW_CACHE_BUFFER(layer_name)  NULL
+    #endif
+
 #ifdef USE_ADAFRUIT_GFX_LAYERS
         #define SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(layer_name, width, height, storage_depth, background_options) \
             typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
             static BACKGROUND_MEMSECTION RGB_TYPE(storage_depth) layer_name##Bitmap[2*width*height];                                        \
-            static color_chan_t layer_name##colorCorrectionLUT[sizeof(SM_RGB) <= 3 ? 256 : 4096];                          \
+            static color_chan_t layer_name##colorCorrectionLUT[SM_BACKGROUND_COLOR_CORRECTION_LUT_SIZE(SM_RGB, (background_options) & SM_BACKGROUND_GFX_OPTIONS_WHITE_BALANCE)]; \
             static SMLayerBackgroundGFX<RGB_TYPE(storage_depth), background_options> layer_name(layer_name##Bitmap, width, height, layer_name##colorCorrectionLUT)  
 
         #define SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(layer_name, width, height, storage_depth, adafruitgfxlayer_options) \
@@ -149,9 +175,10 @@
 #else
         #define SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(layer_name, width, height, storage_depth, background_options) \
             typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
-            static BACKGROUND_MEMSECTION RGB_TYPE(storage_depth) layer_name##Bitmap[2*width*height];                                        \
-            static color_chan_t layer_name##colorCorrectionLUT[sizeof(SM_RGB) <= 3 ? 256 : 4096];                          \
-            static SMLayerBackground<RGB_TYPE(storage_depth), background_options> layer_name(layer_name##Bitmap, width, height, layer_name##colorCorrectionLUT)  
+            static BACKGROUND_MEMSECTION RGB_TYPE(storage_depth) layer_name##Bitmap[SM_BACKGROUND_NUM_BUFFERS(background_options)*width*height]; \
+            static color_chan_t layer_name##colorCorrectionLUT[SM_BACKGROUND_LUT_BUFFER_SIZE(SM_RGB, background_options)]; \
+            SM_ALLOCATE_BACKGROUND_ROW_CACHE(layer_name, storage_depth, background_options, width)                    \
+            static SMLayerBackground<RGB_TYPE(storage_depth), background_options> layer_name(layer_name##Bitmap, width, height, layer_name##colorCorrectionLUT, SM_BACKGROUND_ROW_CACHE_BUFFER(layer_name))  
 
         #define SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(layer_name, width, height, storage_depth, scrolling_options) \
             typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
@@ -210,6 +237,65 @@
 #endif
 #endif
 
+// the sprite tables are small, so every platform allocates them statically
+#define SMARTMATRIX_ALLOCATE_SPRITE_LAYER(layer_name, width, height, storage_depth, max_sprites, sprite_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerSprites<RGB_TYPE(storage_depth), sprite_options>::sprite layer_name##Sprites[3 * (max_sprites)]; \
+    static uint64_t layer_name##RowMasks[height];                                                           \
+    static SMLayerSprites<RGB_TYPE(storage_depth), sprite_options> layer_name(layer_name##Sprites, layer_name##RowMasks, max_sprites, width, height)
+
+// the tileset and map belong to the sketch, the layer itself has no buffers
+#define SMARTMATRIX_ALLOCATE_TILEMAP_LAYER(layer_name, width, height, storage_depth, tilemap_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerTileMap<RGB_TYPE(storage_depth), tilemap_options> layer_name(width, height)
+
+// the pixel buffers belong to the sketch, the layer itself has no buffers
+#define SMARTMATRIX_ALLOCATE_EXTERNAL_LAYER(layer_name, width, height, storage_depth, external_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerExternal<RGB_TYPE(storage_depth), external_options> layer_name(width, height)
+
+// the sketch's callback draws each row during refresh, the layer only allocates one line of pixels in begin()
+#define SMARTMATRIX_ALLOCATE_ROW_CALLBACK_LAYER(layer_name, width, height, storage_depth, rowcallback_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMLayerRowCallback<RGB_TYPE(storage_depth), rowcallback_options> layer_name(width, height)
+
+// like the background layer, the RGBA buffers are allocated from the heap on ESP32 and statically elsewhere
+#if defined(ESP32)
+    #define SMARTMATRIX_ALLOCATE_RGBA_LAYER(layer_name, width, height, storage_depth, rgba_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static SMLayerRGBA<RGB_TYPE(storage_depth), rgba_options> layer_name(width, height)
+#else
+    #define SMARTMATRIX_ALLOCATE_RGBA_LAYER(layer_name, width, height, storage_depth, rgba_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static BACKGROUND_MEMSECTION rgba32 layer_name##Bitmap[2 * width * height];                             \
+        static uint16_t layer_name##Spans[SM_RGBA_SPAN_BUFFER_SIZE(height)];                                    \
+        static SMLayerRGBA<RGB_TYPE(storage_depth), rgba_options> layer_name(layer_name##Bitmap, layer_name##Spans, width, height)
+#endif
+
+// the paletted buffers are allocated the same way, 2, 4 or 8 bits per pixel set by paletted_options
+#if defined(ESP32)
+    #define SMARTMATRIX_ALLOCATE_PALETTED_LAYER(layer_name, width, height, storage_depth, paletted_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static SMLayerPaletted<RGB_TYPE(storage_depth), paletted_options> layer_name(width, height)
+#else
+    #define SMARTMATRIX_ALLOCATE_PALETTED_LAYER(layer_name, width, height, storage_depth, paletted_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static BACKGROUND_MEMSECTION uint8_t layer_name##Bitmap[2 * SM_PALETTED_BUFFER_SIZE(width, height, paletted_options)]; \
+        static SMLayerPaletted<RGB_TYPE(storage_depth), paletted_options> layer_name(layer_name##Bitmap, width, height)
+#endif
+
+// the planar buffers are allocated the same way, one plane per channel of 8 bits (16 bits for rgb48) for each of the two buffers
+#if defined(ESP32)
+    #define SMARTMATRIX_ALLOCATE_PLANAR_LAYER(layer_name, width, height, storage_depth, planar_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static SMLayerPlanar<RGB_TYPE(storage_depth), planar_options> layer_name(width, height)
+#else
+    #define SMARTMATRIX_ALLOCATE_PLANAR_LAYER(layer_name, width, height, storage_depth, planar_options) \
+        typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+        static BACKGROUND_MEMSECTION SMPlanarTraits<RGB_TYPE(storage_depth)>::channel layer_name##Bitmap[SM_PLANAR_BUFFER_SIZE(width, height)]; \
+        static SMLayerPlanar<RGB_TYPE(storage_depth), planar_options> layer_name(layer_name##Bitmap, width, height)
+#endif
+
 // platform-specific
 #if defined(__arm__) && defined(CORE_TEENSY) && !defined(__IMXRT1062__)  // Teensy 3.x
     #include "MatrixTeensy3Hub75Refresh_Impl.h"
@@ -234,4 +320,8 @@
     #include "MatrixCommonApa102Calc_Impl.h"
 #endif
 
+#if defined(SM_HOST_BUILD)
+    #include "MatrixTeensy4Hub75Calc_Impl.h"
+#endif
+
 #endif
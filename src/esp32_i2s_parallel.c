@@ -14,6 +14,11 @@
 
 #if defined(ESP32)
 
+#include "sdkconfig.h"
+
+// the ESP32-S3 uses esp32s3_lcd_parallel.c instead
+#if !CONFIG_IDF_TARGET_ESP32S3
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -40,6 +45,7 @@ typedef struct {
 } i2s_parallel_state_t;
 
 static i2s_parallel_state_t *i2s_state[2]={NULL, NULL};
+static intr_handle_t i2s_intr_handle[2]={NULL, NULL};
 
 callback shiftCompleteCallback;
 
@@ -383,7 +389,7 @@ void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config
     // setup I2S Interrupt
     SET_PERI_REG_BITS(I2S_INT_ENA_REG(1), I2S_OUT_EOF_INT_ENA_V, 1, I2S_OUT_EOF_INT_ENA_S);
     // allocate a level 1 intterupt: lowest priority, as ISR isn't urgent and may take a long time to complete
-    esp_intr_alloc(ETS_I2S1_INTR_SOURCE, (int)(ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL1), i2s_isr, NULL, NULL);
+    esp_intr_alloc(ETS_I2S1_INTR_SOURCE, (int)(ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL1), i2s_isr, NULL, &i2s_intr_handle[i2snum(dev)]);
 
     //Start dma on front buffer
     dev->lc_conf.val=I2S_OUT_DATA_BURST_EN | I2S_OUTDSCR_BURST_EN | I2S_OUT_DATA_BURST_EN;
@@ -392,8 +398,30 @@ void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config
     dev->conf.tx_start=1;
 }
 
+void i2s_parallel_stop(i2s_dev_t *dev) {
+    int no=i2snum(dev);
+    if (i2s_state[no]==NULL) return;
+
+    // stop fetching descriptors and data, then reset DMA so nothing already fetched is still being read
+    dev->conf.tx_start=0;
+    dev->out_link.stop=1;
+    dev->out_link.start=0;
+    dma_reset(dev);
+    fifo_reset(dev);
+
+    SET_PERI_REG_BITS(I2S_INT_ENA_REG(no), I2S_OUT_EOF_INT_ENA_V, 0, I2S_OUT_EOF_INT_ENA_S);
+    if(i2s_intr_handle[no]) {
+        esp_intr_free(i2s_intr_handle[no]);
+        i2s_intr_handle[no]=NULL;
+    }
+
+    free(i2s_state[no]);
+    i2s_state[no]=NULL;
+    previousBufferFree = true;
+}
+
 //Flip to a buffer: 0 for bufa, 1 for bufb
-void i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid) {
+void IRAM_ATTR i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid) {
     int no=i2snum(dev);
     if (i2s_state[no]==NULL) return;
     lldesc_t *active_dma_chain;
@@ -411,8 +439,37 @@ void i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid) {
     previousBufferFree = false;
 }
 
-bool i2s_parallel_is_previous_buffer_free() {
+// Flip to a buffer in a new pair of chains: DMA finishes the current chain, then continues in the new chain for bufid
+// the old chains are in use until i2s_parallel_is_previous_buffer_free() returns true again, and can't be relinked or freed before then
+void IRAM_ATTR i2s_parallel_replace_descriptors(i2s_dev_t *dev, lldesc_t *lldesc_a, int desccount_a, lldesc_t *lldesc_b, int desccount_b, int bufid) {
+    int no=i2snum(dev);
+    if (i2s_state[no]==NULL) return;
+    lldesc_t *active_dma_chain = (bufid==0) ? &lldesc_a[0] : &lldesc_b[0];
+
+    lldesc_a[desccount_a-1].qe.stqe_next=active_dma_chain;
+    lldesc_b[desccount_b-1].qe.stqe_next=active_dma_chain;
+
+    // the end of the old chains (only one of them is being refreshed) leads into the new chain
+    i2s_state[no]->dmadesc_a[i2s_state[no]->desccount_a-1].qe.stqe_next=active_dma_chain;
+    i2s_state[no]->dmadesc_b[i2s_state[no]->desccount_b-1].qe.stqe_next=active_dma_chain;
+
+    i2s_state[no]->dmadesc_a=lldesc_a;
+    i2s_state[no]->dmadesc_b=lldesc_b;
+    i2s_state[no]->desccount_a=desccount_a;
+    i2s_state[no]->desccount_b=desccount_b;
+
+    previousBufferFree = false;
+}
+
+// the descriptor DMA is currently reading
+lldesc_t * IRAM_ATTR i2s_parallel_get_current_descriptor(i2s_dev_t *dev) {
+    return (lldesc_t *)dev->out_link_dscr;
+}
+
+bool IRAM_ATTR i2s_parallel_is_previous_buffer_free() {
     return previousBufferFree;
 }
 
 #endif
+
+#endif
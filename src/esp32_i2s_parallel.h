@@ -9,8 +9,18 @@
 extern "C" {
 #endif
 
+#include "sdkconfig.h"
 #include "soc/i2s_struct.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+// LCD_CAM backend (esp32s3_lcd_parallel.c): bytes are sent in memory order
+#include "esp32s3/rom/lldesc.h"
+#define I2S_PARALLEL_FIFO_REORDER   0
+#else
+// I2S1 in LCD mode: the Tx FIFO (mode1) sends each pair of 16-bit values in reverse order, the calc stores data to match
 #include "rom/lldesc.h"
+#define I2S_PARALLEL_FIFO_REORDER   1
+#endif
 
 typedef enum {
     I2S_PARALLEL_BITS_8=8,
@@ -39,8 +49,12 @@ typedef struct {
 
 void i2s_parallel_setup(i2s_dev_t *dev, const i2s_parallel_config_t *cfg);
 void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config_t *cfg);
+// stops DMA and the shift complete interrupt, the descriptors and buffers can be relinked or freed once this returns
+void i2s_parallel_stop(i2s_dev_t *dev);
 void i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid);
+void i2s_parallel_replace_descriptors(i2s_dev_t *dev, lldesc_t *lldesc_a, int desccount_a, lldesc_t *lldesc_b, int desccount_b, int bufid);
 bool i2s_parallel_is_previous_buffer_free();
+lldesc_t * i2s_parallel_get_current_descriptor(i2s_dev_t *dev);
 void link_dma_desc(volatile lldesc_t *dmadesc, volatile lldesc_t *prevdmadesc, void *memory, size_t size);
 
 typedef void (*callback)(void);
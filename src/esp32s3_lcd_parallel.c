@@ -0,0 +1,246 @@
+// ESP32-S3 backend for the esp32_i2s_parallel.h interface: the LCD_CAM peripheral in i8080 mode, fed by a GDMA channel
+//
+// The ESP32-S3 has no parallel mode on its I2S peripherals, but LCD_CAM can clock out 8 or 16 bits in parallel continuously from
+// the same kind of looped descriptor chains (GDMA descriptors share the lldesc_t layout).  Data is sent in memory order, without the
+// I2S Tx FIFO mode1 reordering of the ESP32 (I2S_PARALLEL_FIFO_REORDER is 0).  The dev argument is ignored, there's one LCD_CAM.
+
+#if defined(ESP32)
+
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_gpio.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
+#include "driver/periph_ctrl.h"
+#include "esp_private/gdma.h"
+#include "hal/gdma_ll.h"
+#include "hal/gpio_hal.h"
+#include "soc/lcd_cam_struct.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/gdma_channel.h"
+#include "esp32_i2s_parallel.h"
+
+// LCD_CAM clock source 3 is PLL_F160M
+#define LCD_CAM_CLOCK_SOURCE_HZ     160000000L
+
+typedef struct {
+    volatile lldesc_t *dmadesc_a, *dmadesc_b;
+    int desccount_a, desccount_b;
+} i2s_parallel_state_t;
+
+static i2s_parallel_state_t *lcd_state = NULL;
+static gdma_channel_handle_t dma_chan = NULL;
+static int dma_chan_id = 0;
+
+callback shiftCompleteCallback;
+
+void setShiftCompleteCallback(callback f) {
+    shiftCompleteCallback = f;
+}
+
+volatile bool previousBufferFree = true;
+
+// called from the GDMA ISR each time a chain's last (eof) descriptor has been sent
+static bool IRAM_ATTR lcd_dma_eof_callback(gdma_channel_handle_t chan, gdma_event_data_t *event_data, void *user_data) {
+    // at this point, the previously active buffer is free, go ahead and write to it
+    previousBufferFree = true;
+
+    if(shiftCompleteCallback)
+        shiftCompleteCallback();
+
+    return false;
+}
+
+#define DMA_MAX (4096-4)
+
+void link_dma_desc(volatile lldesc_t *dmadesc, volatile lldesc_t *prevdmadesc, void *memory, size_t size) {
+    if(size > DMA_MAX) size = DMA_MAX;
+
+    dmadesc->size = size;
+    dmadesc->length = size;
+    dmadesc->buf = memory;
+    dmadesc->eof = 0;
+    dmadesc->sosf = 0;
+    dmadesc->owner = 1;
+    dmadesc->qe.stqe_next = 0;  // will need to set this elsewhere
+    dmadesc->offset = 0;
+
+    // link previous to current
+    if(prevdmadesc)
+        prevdmadesc->qe.stqe_next = (lldesc_t*)dmadesc;
+}
+
+static void gpio_setup_out(int gpio, int sig, bool invert) {
+    if (gpio==-1) return;
+    gpio_hal_iomux_func_sel(GPIO_PIN_MUX_REG[gpio], PIN_FUNC_GPIO);
+    gpio_set_direction(gpio, GPIO_MODE_DEF_OUTPUT);
+    gpio_set_drive_capability((gpio_num_t)gpio, GPIO_DRIVE_CAP_3);
+    esp_rom_gpio_connect_out_signal(gpio, sig, invert, false);
+}
+
+void i2s_parallel_setup(i2s_dev_t *dev, const i2s_parallel_config_t *cfg) {
+    // chains are always linked by the caller on the ESP32-S3
+    i2s_parallel_setup_without_malloc(dev, cfg);
+}
+
+void i2s_parallel_setup_without_malloc(i2s_dev_t *dev, const i2s_parallel_config_t *cfg) {
+    printf("Setting up parallel LCD_CAM bus\n");
+
+    // 32-bit output isn't available from LCD_CAM
+    int bits = (cfg->bits == I2S_PARALLEL_BITS_8) ? 8 : 16;
+
+    periph_module_enable(PERIPH_LCD_CAM_MODULE);
+    periph_module_reset(PERIPH_LCD_CAM_MODULE);
+
+    LCD_CAM.lcd_user.lcd_reset = 1;
+    esp_rom_delay_us(100);
+
+    // PCLK = 160MHz / clkm_div_num / (clkcnt_n + 1), clkcnt_n = 1 gives a 50% duty cycle
+    int div = LCD_CAM_CLOCK_SOURCE_HZ / (2 * cfg->clkspeed_hz);
+    if(div < 2) div = 2;
+    LCD_CAM.lcd_clock.val = 0;
+    LCD_CAM.lcd_clock.clk_en = 1;
+    LCD_CAM.lcd_clock.lcd_clk_sel = 3;
+    LCD_CAM.lcd_clock.lcd_clkm_div_num = div;
+    LCD_CAM.lcd_clock.lcd_clkm_div_a = 0;
+    LCD_CAM.lcd_clock.lcd_clkm_div_b = 0;
+    LCD_CAM.lcd_clock.lcd_clk_equ_sysclk = 0;
+    LCD_CAM.lcd_clock.lcd_clkcnt_n = 1;
+    LCD_CAM.lcd_clock.lcd_ck_idle_edge = 0;
+    LCD_CAM.lcd_clock.lcd_ck_out_edge = 0;
+
+    // i8080 mode without command or dummy phases, data only, repeating for as long as the descriptor chain loops
+    LCD_CAM.lcd_ctrl.lcd_rgb_mode_en = 0;
+    LCD_CAM.lcd_rgb_yuv.lcd_conv_bypass = 0;
+    LCD_CAM.lcd_misc.val = 0;
+    LCD_CAM.lcd_misc.lcd_bk_en = 1;
+    LCD_CAM.lcd_data_dout_mode.val = 0;
+    LCD_CAM.lcd_user.val = 0;
+    LCD_CAM.lcd_user.lcd_2byte_en = (bits == 16);
+    LCD_CAM.lcd_user.lcd_always_out_en = 1;
+    LCD_CAM.lcd_user.lcd_dout = 1;
+    LCD_CAM.lcd_user.lcd_update = 1;
+    LCD_CAM.lc_dma_int_ena.val = 0;
+
+    // route the signals
+    for (int x=0; x<bits; x++) {
+        gpio_setup_out(cfg->gpio_bus[x], LCD_DATA_OUT0_IDX+x, false);
+    }
+    gpio_setup_out(cfg->gpio_clk, LCD_PCLK_IDX, cfg->clk_inversion);
+
+    lcd_state = malloc(sizeof(i2s_parallel_state_t));
+    assert(lcd_state != NULL);
+    lcd_state->desccount_a = cfg->desccount_a;
+    lcd_state->desccount_b = cfg->desccount_b;
+    lcd_state->dmadesc_a = cfg->lldesc_a;
+    lcd_state->dmadesc_b = cfg->lldesc_b;
+
+    // descriptors are linked once and reused every frame, so GDMA must neither check nor clear the owner bit
+    gdma_channel_alloc_config_t dma_chan_config = {
+        .sibling_chan = NULL,
+        .direction = GDMA_CHANNEL_DIRECTION_TX,
+        .flags = {
+            .reserve_sibling = 0
+        }
+    };
+    gdma_new_channel(&dma_chan_config, &dma_chan);
+    gdma_get_channel_id(dma_chan, &dma_chan_id);
+    gdma_connect(dma_chan, GDMA_MAKE_TRIGGER(GDMA_TRIG_PERIPH_LCD, 0));
+    gdma_strategy_config_t strategy_config = {
+        .owner_check = false,
+        .auto_update_desc = false
+    };
+    gdma_apply_strategy(dma_chan, &strategy_config);
+
+    // frame buffers may be in PSRAM, which GDMA reads in 64-byte blocks
+    gdma_transfer_ability_t ability = {
+        .sram_trans_align = 4,
+        .psram_trans_align = 64,
+    };
+    gdma_set_transfer_ability(dma_chan, &ability);
+
+    gdma_tx_event_callbacks_t tx_cbs = {
+        .on_trans_eof = lcd_dma_eof_callback
+    };
+    gdma_register_tx_event_callbacks(dma_chan, &tx_cbs, NULL);
+
+    //Start dma on front buffer
+    gdma_start(dma_chan, (intptr_t)&lcd_state->dmadesc_a[0]);
+    esp_rom_delay_us(1);
+    LCD_CAM.lcd_user.lcd_update = 1;
+    LCD_CAM.lcd_user.lcd_start = 1;
+}
+
+void i2s_parallel_stop(i2s_dev_t *dev) {
+    if (lcd_state==NULL) return;
+
+    LCD_CAM.lcd_user.lcd_start = 0;
+    LCD_CAM.lcd_user.lcd_update = 1;
+    gdma_stop(dma_chan);
+    gdma_reset(dma_chan);
+    gdma_disconnect(dma_chan);
+    gdma_del_channel(dma_chan);
+    dma_chan = NULL;
+
+    free(lcd_state);
+    lcd_state = NULL;
+    previousBufferFree = true;
+}
+
+//Flip to a buffer: 0 for bufa, 1 for bufb
+void IRAM_ATTR i2s_parallel_flip_to_buffer(i2s_dev_t *dev, int bufid) {
+    if (lcd_state==NULL) return;
+    lldesc_t *active_dma_chain;
+    if (bufid==0) {
+        active_dma_chain=(lldesc_t*)&lcd_state->dmadesc_a[0];
+    } else {
+        active_dma_chain=(lldesc_t*)&lcd_state->dmadesc_b[0];
+    }
+
+    // setup linked list to refresh from new buffer (continuously) when the end of the current list has been reached
+    lcd_state->dmadesc_a[lcd_state->desccount_a-1].qe.stqe_next=active_dma_chain;
+    lcd_state->dmadesc_b[lcd_state->desccount_b-1].qe.stqe_next=active_dma_chain;
+
+    // we're still refreshing the previously buffer, so it shouldn't be written to yet
+    previousBufferFree = false;
+}
+
+// Flip to a buffer in a new pair of chains, see esp32_i2s_parallel.c
+void IRAM_ATTR i2s_parallel_replace_descriptors(i2s_dev_t *dev, lldesc_t *lldesc_a, int desccount_a, lldesc_t *lldesc_b, int desccount_b, int bufid) {
+    if (lcd_state==NULL) return;
+    lldesc_t *active_dma_chain = (bufid==0) ? &lldesc_a[0] : &lldesc_b[0];
+
+    lldesc_a[desccount_a-1].qe.stqe_next=active_dma_chain;
+    lldesc_b[desccount_b-1].qe.stqe_next=active_dma_chain;
+
+    lcd_state->dmadesc_a[lcd_state->desccount_a-1].qe.stqe_next=active_dma_chain;
+    lcd_state->dmadesc_b[lcd_state->desccount_b-1].qe.stqe_next=active_dma_chain;
+
+    lcd_state->dmadesc_a=lldesc_a;
+    lcd_state->dmadesc_b=lldesc_b;
+    lcd_state->desccount_a=desccount_a;
+    lcd_state->desccount_b=desccount_b;
+
+    previousBufferFree = false;
+}
+
+lldesc_t * IRAM_ATTR i2s_parallel_get_current_descriptor(i2s_dev_t *dev) {
+    return (lldesc_t *)gdma_ll_tx_get_current_desc_addr(&GDMA, dma_chan_id);
+}
+
+bool IRAM_ATTR i2s_parallel_is_previous_buffer_free() {
+    return previousBufferFree;
+}
+
+#endif
+
+#endif
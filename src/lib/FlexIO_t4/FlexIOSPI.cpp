@@ -409,7 +409,7 @@ void dumpDMA_TCD(DMABaseClass *dmabc)
 }
 #endif
 
-bool FlexIOSPI::transfer(const void *buf, void *retbuf, size_t count, EventResponderRef event_responder) {
+bool FlexIOSPI::transfer(const void *buf, void *retbuf, size_t count, EventResponderRef event_responder, bool cacheMaintenance) {
 	if (_dma_state == DMAState::notAllocated) {
 		if (!initDMAChannels())
 			return false;
@@ -440,7 +440,7 @@ bool FlexIOSPI::transfer(const void *buf, void *retbuf, size_t count, EventRespo
 	if (buf) {
 		_dmaTX->sourceBuffer((uint8_t*)write_data, count);  
 		_dmaTX->TCD->SLAST = 0;	// Finish with it pointing to next location
-		if ((uint32_t)write_data >= 0x20200000u)  arm_dcache_flush(write_data, count);
+		if (cacheMaintenance && (uint32_t)write_data >= 0x20200000u)  arm_dcache_flush(write_data, count);
 	} else {
 		_dmaTX->source((uint8_t&)_transferWriteFill);   // maybe have setable value
 		_dmaTX->transferCount(count);
@@ -450,7 +450,7 @@ bool FlexIOSPI::transfer(const void *buf, void *retbuf, size_t count, EventRespo
 		_dmaRX->TCD->ATTR_SRC = 0;		//Make sure set for 8 bit mode...
 		_dmaRX->destinationBuffer((uint8_t*)retbuf, count);
 		_dmaRX->TCD->DLASTSGA = 0;		// At end point after our bufffer
-		if ((uint32_t)retbuf >= 0x20200000u)  arm_dcache_delete(retbuf, count);
+		if (cacheMaintenance && (uint32_t)retbuf >= 0x20200000u)  arm_dcache_delete(retbuf, count);
 	} else {
 			// Write  only mode
 		_dmaRX->TCD->ATTR_SRC = 0;		//Make sure set for 8 bit mode...
@@ -461,7 +461,8 @@ bool FlexIOSPI::transfer(const void *buf, void *retbuf, size_t count, EventRespo
 	_dma_event_responder = &event_responder;
 	// Now try to start it?
 	// Setup DMA main object
-	yield();
+	if (cacheMaintenance)
+		yield();
 
 #ifdef DEBUG_DMA_TRANSFERS
 	// Lets dump TX, RX
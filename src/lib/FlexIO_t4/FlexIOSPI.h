@@ -78,7 +78,8 @@ public:
 	void transfer(const void * buf, void * retbuf, size_t count);
 
 	// Asynch support (DMA )
-	bool transfer(const void *txBuffer, void *rxBuffer, size_t count,  EventResponderRef  event_responder);
+	// cacheMaintenance = false: the caller has already flushed txBuffer (and will invalidate rxBuffer), and may be calling from an ISR
+	bool transfer(const void *txBuffer, void *rxBuffer, size_t count,  EventResponderRef  event_responder, bool cacheMaintenance = true);
 
 	static void _dma_rxISR0(void);
 	static void _dma_rxISR1(void);